@@ -0,0 +1,93 @@
+#ifndef ALPM_TRANSACTION_HPP
+#define ALPM_TRANSACTION_HPP
+
+#include "gucc/error.hpp"
+
+#include <cstdint>  // for uint8_t, uint32_t, uint64_t
+
+#include <functional>   // for function
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <utility>      // for pair
+#include <vector>       // for vector
+
+namespace gucc::alpm {
+
+enum class EventKind : std::uint8_t {
+    /// Bytes of the whole transaction
+    Download,
+    /// Packages extracted so far
+    Install,
+    /// Hooks run so far
+    Hook,
+};
+
+/// @brief Progress of a transaction, straight from the libalpm callbacks.
+struct TransactionEvent final {
+    EventKind kind{EventKind::Download};
+    /// file being downloaded, package being installed or hook being run
+    std::string_view name{};
+    std::uint64_t done{};
+    std::uint64_t total{};
+};
+
+using EventSink = std::function<void(const TransactionEvent&)>;
+
+/// @brief Receives the events of every transaction, like ProcessRunner::set_line_sink does for lines.
+void set_event_sink(EventSink sink) noexcept;
+
+struct TransactionConfig final {
+    std::string_view mountpoint{};
+    /// Repos, servers, architectures and SigLevel are read from it
+    std::string_view pacman_config{};
+    std::vector<std::string> packages{};
+    /// The first writable one gets the downloads. Empty means the CacheDir of pacman_config,
+    /// `/var/cache/pacman/pkg` without one, what `pacstrap -c` ends up with
+    std::vector<std::string> cache_dirs{};
+    /// Keyring the signatures are checked against
+    std::string gpg_dir{"/etc/pacman.d/gnupg"};
+    /// Run the hooks of the target after the transaction, off leaves them to the caller
+    bool run_hooks{true};
+    /// Mount proc, sys, dev and run below the target for scriptlets and hooks
+    bool mount_api_filesystems{true};
+};
+
+/// @brief Whether gucc was built with libalpm.
+[[nodiscard]] auto available() noexcept -> bool;
+
+/// @brief Syncs the repos of config.pacman_config and installs config.packages into the target,
+/// what `pacstrap -C <conf> <mnt> <packages>` does without spawning pacman.
+///
+/// Targets are package names, `repo/name`, groups or anything provided by a package.
+/// @return Unsupported without libalpm
+auto install_packages(const TransactionConfig& config) noexcept -> Result<void>;
+
+}  // namespace gucc::alpm
+
+namespace gucc::alpm::detail {
+
+/// @brief The [options] of a pacman.conf the transaction needs.
+struct PacmanOptions final {
+    /// `auto` is replaced by the machine's architecture
+    std::vector<std::string> architectures{};
+    std::uint32_t parallel_downloads{1};
+    std::vector<std::string> cache_dirs{};
+    std::vector<std::string> sig_level{};
+    std::vector<std::string> local_file_sig_level{};
+    std::vector<std::string> remote_file_sig_level{};
+};
+
+/// @brief A repo section, in the order of the file.
+struct RepoSection final {
+    std::string name{};
+    /// Servers with $repo and $arch substituted
+    std::vector<std::string> servers{};
+    std::vector<std::string> sig_level{};
+};
+
+/// @brief Parses pacman.conf content, `Include =` files are read from disk.
+auto parse_pacman_conf(std::string_view content, std::string_view machine_arch) noexcept -> std::pair<PacmanOptions, std::vector<RepoSection>>;
+
+}  // namespace gucc::alpm::detail
+
+#endif  // ALPM_TRANSACTION_HPP
@@ -4,8 +4,12 @@
 #include "gucc/error.hpp"
 #include "gucc/partition.hpp"
 
+#include <cstdint>  // for uint8_t, uint64_t
+
+#include <optional>     // for optional
 #include <string>       // for string
 #include <string_view>  // for string_view
+#include <utility>      // for pair
 #include <vector>       // for vector
 
 namespace gucc::fs {
@@ -13,6 +17,40 @@ namespace gucc::fs {
 struct BtrfsSubvolume final {
     std::string subvolume;
     std::string mountpoint;
+    /// chattr +C on the empty subvolume, every file created in it skips copy-on-write
+    bool nocow{false};
+    /// btrfs.compression property (zstd, lzo, zlib or none), empty keeps the mount default
+    std::string compression{};
+    /// Replaces the shared mount options, only VFS flags (noatime, nodev, ...) can differ per subvolume
+    std::optional<std::string> mount_opts{};
+};
+
+/// @brief What a subvolume holds, picks its COW and compression policy.
+enum class BtrfsSubvolumeRole : std::uint8_t {
+    General,
+    /// Rewrites pages in place, COW fragments the files (postgres, mysql)
+    Database,
+    /// Large images with random writes (libvirt)
+    VmImages,
+    /// Image layers, compress well (podman, buildah)
+    Containers,
+    /// Holds a swapfile, which has to be NOCOW and uncompressed
+    Swap,
+};
+
+/// @brief Builds a subvolume with the policy for @p role.
+auto btrfs_role_subvolume(std::string subvolume, std::string mountpoint, BtrfsSubvolumeRole role) noexcept -> BtrfsSubvolume;
+
+/// @brief Checks the compression value and that it isn't combined with nocow.
+auto validate_btrfs_subvolume(const BtrfsSubvolume& subvol) noexcept -> Result<void>;
+
+/// @brief Sets NOCOW and the compression property on the mounted, still empty @p subvol.
+auto apply_btrfs_subvolume_policy(const BtrfsSubvolume& subvol, std::string_view root_mountpoint) noexcept -> Result<void>;
+
+/// @brief A subvolume which couldn't be created or mounted, the others are still processed.
+struct BtrfsSubvolumeError final {
+    std::string subvolume;
+    Error error;
 };
 
 // Creates btrfs subvolume
@@ -24,6 +62,19 @@ auto btrfs_create_subvols(const std::vector<BtrfsSubvolume>& subvols, std::strin
 // Mounts btrfs subvolumes
 auto btrfs_mount_subvols(const std::vector<BtrfsSubvolume>& subvols, std::string_view device, std::string_view root_mountpoint, std::string_view mount_opts) noexcept -> Result<void>;
 
+/// @brief Creates @p subvols below the mounted top level with BTRFS_IOC_SUBVOL_CREATE.
+///
+/// The COW and compression policy is applied right away, while the subvolumes are empty.
+/// @return One entry per subvolume that failed, empty on success.
+auto create_btrfs_subvolumes(const std::vector<BtrfsSubvolume>& subvols, std::string_view root_mountpoint) noexcept -> std::vector<BtrfsSubvolumeError>;
+
+/// @brief Mounts @p subvols of @p device under @p root_mountpoint with the new mount API.
+///
+/// The filesystem is set up once and every subvolume is cloned from it, instead
+/// of a `mount` call per subvolume. Falls back to `mount` on kernels without fsopen.
+/// @return One entry per subvolume that failed, empty on success.
+auto mount_btrfs_subvolumes(const std::vector<BtrfsSubvolume>& subvols, std::string_view device, std::string_view root_mountpoint, std::string_view mount_opts) noexcept -> std::vector<BtrfsSubvolumeError>;
+
 // Appends btrfs subvolumes into Partition scheme
 // with sorting scheme by device field
 auto btrfs_append_subvolumes(std::vector<Partition>& partitions, const std::vector<BtrfsSubvolume>& subvols) noexcept -> Result<void>;
@@ -33,4 +84,37 @@ auto create_btrfs_installation_snapshot(std::string_view root_mountpoint) noexce
 
 }  // namespace gucc::fs
 
+namespace gucc::fs::detail {
+
+/// @brief Mount options split for fsconfig and fsmount.
+struct BtrfsMountParams final {
+    /// MOUNT_ATTR_* flags, set per mount
+    std::uint64_t attr_flags{};
+    /// Filesystem parameters, the value is empty for flags (e.g "ssd")
+    std::vector<std::pair<std::string, std::string>> fs_params{};
+};
+
+/// @brief Splits fstab style @p mount_opts into mount attributes and btrfs parameters.
+///
+/// Options only meaningful to userspace (defaults, nofail, x-*, ...) and subvol
+/// selection are dropped.
+auto split_mount_options(std::string_view mount_opts) noexcept -> BtrfsMountParams;
+
+/// @brief Path of @p subvolume below the top level mounted at @p top_level.
+///
+/// Names are taken with or without the leading slash, "@home" as listed by
+/// the filesystem and "/@home" as in the default layouts.
+auto btrfs_subvolume_path(std::string_view top_level, std::string_view subvolume) noexcept -> std::string;
+
+/// @brief Orders @p subvols so every mountpoint comes after the one it is nested in.
+auto btrfs_mount_order(const std::vector<BtrfsSubvolume>& subvols) noexcept -> std::vector<BtrfsSubvolume>;
+
+// Creates btrfs subvolumes with `btrfs subvolume create`, remounts them with `mount`
+auto btrfs_create_subvols_exec(const std::vector<BtrfsSubvolume>& subvols, std::string_view device, std::string_view root_mountpoint, std::string_view mount_opts) noexcept -> Result<void>;
+
+// Mounts btrfs subvolumes with a `mount` call each
+auto btrfs_mount_subvols_exec(const std::vector<BtrfsSubvolume>& subvols, std::string_view device, std::string_view root_mountpoint, std::string_view mount_opts) noexcept -> Result<void>;
+
+}  // namespace gucc::fs::detail
+
 #endif  // BTRFS_HPP
@@ -3,8 +3,10 @@
 
 #include "gucc/btrfs.hpp"
 
-#include <cstdint>      // for uint64_t
+#include <cstdint>      // for uint8_t, uint32_t, uint64_t
+#include <map>          // for map
 #include <optional>     // for optional
+#include <span>         // for span
 #include <string>       // for string
 #include <string_view>  // for string_view
 #include <vector>       // for vector
@@ -76,7 +78,7 @@ auto list_btrfs_snapshots(std::string_view mountpoint, std::string_view filter_p
 auto list_btrfs_subvolumes_detailed(std::string_view mountpoint, std::string_view filter_prefix = "@") noexcept -> std::vector<BtrfsSubvolumeInfo>;
 
 /// @brief Gets btrfs filesystem usage information
-/// @param mountpoint_or_device Path to mounted btrfs or device path
+/// @param mountpoint_or_device Path to mounted btrfs or device path, a device has to be mounted somewhere
 /// @return Optional BtrfsFilesystemInfo, std::nullopt on failure
 auto get_btrfs_info(std::string_view mountpoint_or_device) noexcept -> std::optional<BtrfsFilesystemInfo>;
 
@@ -93,6 +95,54 @@ namespace gucc::fs::btrfs_query::detail {
 auto parse_subvolume_list(std::string_view output, std::string_view filter_prefix) noexcept
     -> std::vector<BtrfsSubvolumeInfo>;
 
+/// @brief Position in a btrfs tree, ordered by (objectid, type, offset).
+struct BtrfsKey final {
+    std::uint64_t objectid{0};
+    std::uint8_t type{0};
+    std::uint64_t offset{0};
+};
+
+/// @brief A subvolume as found in the root tree, before its path is resolved.
+struct BtrfsRootRecord final {
+    /// path only holds the name inside @ref dir_path until resolved
+    BtrfsSubvolumeInfo info{};
+    /// Directory of the parent subvolume which holds the subvolume
+    std::uint64_t dir_id{0};
+    /// Path of @ref dir_id inside the parent subvolume, empty or ending with '/'
+    std::string dir_path{};
+    /// Deleted subvolumes are left without ROOT_BACKREF until cleaned up
+    bool has_backref{false};
+};
+
+/// @brief Usage of one block group type, as reported by BTRFS_IOC_SPACE_INFO.
+struct BtrfsSpaceUsage final {
+    std::uint64_t flags{0};
+    std::uint64_t total_bytes{0};
+    std::uint64_t used_bytes{0};
+};
+
+/// @brief Decodes ROOT_ITEM and ROOT_BACKREF items of a BTRFS_IOC_TREE_SEARCH_V2 result.
+/// @param buffer The search result, a search header followed by the item data for every item.
+/// @param nr_items Number of items the kernel returned.
+/// @param records Subvolumes by ID, items of one subvolume may come from separate searches.
+/// @return Key of the last item, the next search continues after it.
+auto decode_root_tree_items(std::span<const std::uint8_t> buffer, std::uint32_t nr_items,
+    std::map<std::uint64_t, BtrfsRootRecord>& records) noexcept -> std::optional<BtrfsKey>;
+
+/// @brief Joins the names of @p records into paths relative to the top level.
+///
+/// Yields the same entries in the same order as `btrfs subvolume list -puq`.
+auto resolve_subvolume_paths(const std::map<std::uint64_t, BtrfsRootRecord>& records, std::string_view filter_prefix) noexcept
+    -> std::vector<BtrfsSubvolumeInfo>;
+
+/// @brief Name of the allocation profile of @p flags, as printed by `btrfs filesystem df`.
+auto btrfs_profile_name(std::uint64_t flags) noexcept -> std::string_view;
+
+/// @brief Fills profiles, used and estimated free space of @p info.
+/// @param spaces Usage of every block group type.
+/// @param device_size Sum of the sizes of all devices.
+void apply_space_usage(BtrfsFilesystemInfo& info, const std::vector<BtrfsSpaceUsage>& spaces, std::uint64_t device_size) noexcept;
+
 }  // namespace gucc::fs::btrfs_query::detail
 
 #endif  // BTRFS_QUERY_HPP
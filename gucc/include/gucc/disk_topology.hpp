@@ -0,0 +1,70 @@
+#ifndef DISK_TOPOLOGY_HPP
+#define DISK_TOPOLOGY_HPP
+
+#include <cstdint>  // for uint8_t, uint16_t, uint32_t, uint64_t
+
+#include <optional>     // for optional
+#include <span>         // for span
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+namespace gucc::disk {
+
+/// @brief One entry of the NVMe namespace LBA format list
+struct NvmeLbaFormat final {
+    /// Index as used by `nvme format --lbaf=`
+    std::uint32_t index{};
+    /// LBA data size in bytes
+    std::uint32_t data_size{};
+    /// Metadata bytes per LBA
+    std::uint16_t metadata_size{};
+    /// 0 = best, 3 = degraded
+    std::uint8_t relative_performance{};
+    /// Whether the namespace is formatted with this entry
+    bool in_use{false};
+
+    constexpr bool operator==(const NvmeLbaFormat&) const = default;
+};
+
+/// @brief I/O limits the kernel exposes for a block device
+struct DiskTopology final {
+    std::uint32_t logical_block_size{512};
+    std::uint32_t physical_block_size{512};
+    std::uint32_t minimum_io_size{0};
+    std::uint32_t optimal_io_size{0};
+    std::uint32_t alignment_offset{0};
+    /// MD RAID chunk size in bytes, 0 when not an md array
+    std::uint32_t raid_chunk_size{0};
+    /// Empty unless the device is an NVMe namespace
+    std::vector<NvmeLbaFormat> nvme_lba_formats{};
+};
+
+/// @brief Reads the I/O topology of the device from sysfs (and NVMe identify data).
+/// @param device The device path (e.g., "/dev/nvme0n1")
+/// @return topology, std::nullopt if sysfs doesn't know the device
+auto query_disk_topology(std::string_view device) noexcept -> std::optional<DiskTopology>;
+
+/// @brief Boundary every partition start and size should be aligned to.
+/// At least 1MiB, grown to cover physical block, minimum/optimal I/O and RAID chunk sizes.
+auto compute_partition_alignment(const DiskTopology& topology) noexcept -> std::uint64_t;
+
+/// @brief Whether the device emulates 512 byte sectors on top of 4K physical ones.
+auto is_512e(const DiskTopology& topology) noexcept -> bool;
+
+/// @brief Finds a metadata-less 4K LBA format the namespace could be switched to.
+auto find_native_4k_lba_format(const DiskTopology& topology) noexcept -> std::optional<NvmeLbaFormat>;
+
+/// @brief Human-readable warnings about the topology, e.g running 512e while 4Kn is available.
+auto get_topology_warnings(std::string_view device, const DiskTopology& topology) noexcept -> std::vector<std::string>;
+
+}  // namespace gucc::disk
+
+namespace gucc::disk::detail {
+
+/// @brief Parses the LBA format list out of an NVMe Identify Namespace (CNS 0) data structure.
+auto parse_nvme_id_ns_lba_formats(std::span<const std::uint8_t> id_ns) noexcept -> std::vector<NvmeLbaFormat>;
+
+}  // namespace gucc::disk::detail
+
+#endif  // DISK_TOPOLOGY_HPP
@@ -1,18 +1,78 @@
 #ifndef FETCH_FILE_HPP
 #define FETCH_FILE_HPP
 
+#include <chrono>       // for milliseconds, seconds
+#include <cstdint>      // for int64_t, uint8_t
 #include <optional>     // for optional
 #include <string>       // for string
 #include <string_view>  // for string_view
 
 namespace gucc::fetch {
 
+/// @brief Where fetched content came from.
+enum class FetchSource : std::uint8_t {
+    /// downloaded from the primary url
+    Primary,
+    /// on-disk copy the server confirmed unchanged
+    Revalidated,
+    /// the fallback url answered first
+    Fallback,
+    /// on-disk copy, neither url answered
+    Stale,
+};
+
+struct FetchOptions final {
+    /// The fallback starts when the primary url hasn't answered by then, or failed earlier
+    std::chrono::milliseconds hedge_delay{1500};
+    std::chrono::milliseconds timeout{30000};
+    /// Copies of remote files revalidated with ETag/Last-Modified, empty disables the cache
+    std::string cache_dir{"/var/cache/cachyos-installer/fetch"};
+};
+
+struct FetchedFile final {
+    std::string content;
+    /// The url that delivered the content
+    std::string url;
+    FetchSource source{FetchSource::Primary};
+    /// Since the content was last confirmed by its server, or since the file:// changed
+    std::chrono::seconds age{};
+};
+
+/// @brief Name of @p source for logs.
+auto fetch_source_to_string(FetchSource source) noexcept -> std::string_view;
+
 // Fetch a single file from url into memory
 auto fetch_file(std::string_view url) noexcept -> std::optional<std::string>;
 
-// Fetch file from url into memory
+/// @brief Fetches @p url, hedged with @p fallback_url after options.hedge_delay.
+///
+/// Whichever answers first wins and the other transfer is aborted. Remote content is
+/// cached in options.cache_dir and revalidated on the next fetch. If neither url
+/// answers, the cached copy is returned as Stale.
+auto fetch_file_hedged(std::string_view url, std::string_view fallback_url, const FetchOptions& options = {}) noexcept -> std::optional<FetchedFile>;
+
+// Fetch file from url into memory, hedged with the fallback url
 auto fetch_file_from_url(std::string_view url, std::string_view fallback_url) noexcept -> std::optional<std::string>;
 
 }  // namespace gucc::fetch
 
+namespace gucc::fetch::detail {
+
+/// @brief Validators of a cached remote file.
+struct CacheMeta final {
+    std::string url;
+    std::string etag;
+    std::string last_modified;
+    /// unix time the server last confirmed the content
+    std::int64_t validated_at{};
+};
+
+/// @brief File name the cached copy of @p url is stored under, without extension.
+auto cache_key(std::string_view url) noexcept -> std::string;
+
+auto render_cache_meta(const CacheMeta& meta) noexcept -> std::string;
+auto parse_cache_meta(std::string_view content) noexcept -> std::optional<CacheMeta>;
+
+}  // namespace gucc::fetch::detail
+
 #endif  // FETCH_FILE_HPP
@@ -0,0 +1,69 @@
+#ifndef FS_TUNING_HPP
+#define FS_TUNING_HPP
+
+#include "gucc/disk_topology.hpp"
+#include "gucc/partition_config.hpp"
+#include "gucc/system_query.hpp"
+
+#include <cstdint>      // for uint8_t, uint64_t
+#include <optional>     // for optional
+#include <string>       // for string
+#include <string_view>  // for string_view
+
+namespace gucc::fs {
+
+/// @brief Class of block device the mkfs and mount tuning is picked for
+enum class DeviceClass : std::uint8_t {
+    Nvme,
+    Ssd,
+    Hdd,
+    Removable,
+    Virtual,
+    /// No device specific tuning, the static per-filesystem defaults
+    Generic
+};
+
+/// @brief What we know about the device a filesystem is created on
+struct DeviceProfile final {
+    disk::DiskTransport transport{disk::DiskTransport::Unknown};
+    bool is_rotational{true};
+    bool is_removable{false};
+    std::uint64_t size_bytes{0};
+    disk::DiskTopology topology{};
+};
+
+/// @brief mkfs command (without the target device) and mount options for a filesystem
+struct FsTuning final {
+    std::string mkfs_command;
+    std::string mount_opts;
+
+    constexpr bool operator==(const FsTuning&) const = default;
+};
+
+/// @brief Convert device class enum to string representation
+auto device_class_to_string(DeviceClass device_class) noexcept -> std::string_view;
+
+/// @brief Convert string to device class enum
+/// @return device class, std::nullopt if the name is unknown
+auto string_to_device_class(std::string_view class_name) noexcept -> std::optional<DeviceClass>;
+
+/// @brief Collects transport, rotational flag, size and I/O topology of the device.
+/// @param device The disk device path (e.g., "/dev/nvme0n1")
+/// @return profile, std::nullopt if the device couldn't be queried
+auto query_device_profile(std::string_view device) noexcept -> std::optional<DeviceProfile>;
+
+/// @brief Picks the device class of the profile. Unknown transports are Generic.
+auto classify_device(const DeviceProfile& profile) noexcept -> DeviceClass;
+
+/// @brief Picks mkfs parameters and mount options for the filesystem on that device class.
+/// @param fs_type The filesystem type
+/// @param device_class The device class, Generic returns get_mkfs_command/get_default_mount_opts
+/// @param profile The device profile, used for stripe geometry and size
+/// @param read_by_bootloader Whether the bootloader reads kernels from this filesystem,
+/// keeps features GRUB can't read (non-crc32c btrfs checksums, f2fs compression) off
+/// @return tuned mkfs command and mount options
+auto get_fs_tuning(FilesystemType fs_type, DeviceClass device_class, const DeviceProfile& profile, bool read_by_bootloader = false) noexcept -> FsTuning;
+
+}  // namespace gucc::fs
+
+#endif  // FS_TUNING_HPP
@@ -18,6 +18,8 @@ struct InitcpioConfig {
     bool is_btrfs_multi_device{false};
     // native zfs encryption on the root pool
     bool is_zfs_encrypted{false};
+    // root (or a volume below it) on an md array
+    bool is_mdadm{false};
 };
 
 // Configure mkinitcpio.conf for the given filesystem/encryption setup.
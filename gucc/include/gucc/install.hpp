@@ -3,8 +3,11 @@
 
 #include "gucc/error.hpp"
 #include "gucc/initcpio.hpp"
+#include "gucc/package_download.hpp"
 #include "gucc/partition_config.hpp"
 
+#include <cstdint>  // for uint8_t
+
 #include <string>       // for string
 #include <string_view>  // for string_view
 #include <utility>      // for pair
@@ -15,13 +18,32 @@ namespace gucc::install {
 // A file to copy from host into the target: {source, destination_relative_to_mountpoint}
 using FileCopyEntry = std::pair<std::string, std::string>;
 
+// What puts packages into the target
+enum class PackageBackend : std::uint8_t {
+    Pacstrap,
+    // in-process through libalpm, pacstrap when gucc was built without it
+    Alpm,
+};
+
 struct InstallConfig {
     std::string_view mountpoint;
     std::string_view packages;
     std::string_view keymap;
     initcpio::InitcpioConfig initcpio_config{};
     bool is_zfs{false};
+    // an md array holds the root, its mdadm.conf goes into the initramfs
+    bool is_mdadm{false};
     bool hostcache{true};
+    // with hostcache, downloads go to the target disk instead of the host cache, which
+    // lives in RAM on the live ISO. What the host cache already holds is still used
+    bool target_cache{false};
+    PackageBackend backend{PackageBackend::Pacstrap};
+    // install from an offline bundle instead of the mirrors, see gucc/offline_bundle.hpp.
+    // The target's pacman.conf points at it too and it stays attached, until the caller detaches it
+    std::string_view bundle_dir;
+
+    // Fetched into the host cache ahead of pacstrap, only with hostcache
+    std::vector<download::PackageFile> prefetch{};
 
     // Additional files to copy from host into the target
     std::vector<FileCopyEntry> host_files_to_copy{};
@@ -32,6 +54,10 @@ struct InstallConfig {
 
 [[nodiscard]] auto install_base(const InstallConfig& config) noexcept -> Result<void>;
 
+/// @brief Installs space separated @p packages into @p mountpoint, what pacstrap does
+/// including the copy of the host keyring and mirrorlist.
+[[nodiscard]] auto install_packages(std::string_view mountpoint, std::string_view packages, std::string_view pacman_config, bool hostcache, PackageBackend backend) noexcept -> Result<void>;
+
 }  // namespace gucc::install
 
 #endif  // INSTALL_HPP
@@ -0,0 +1,74 @@
+#ifndef KEYRING_HPP
+#define KEYRING_HPP
+
+#include "gucc/error.hpp"
+
+#include <cstddef>  // for size_t
+
+#include <optional>     // for optional
+#include <span>         // for span
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+namespace gucc::keyring {
+
+/// The pacman keyring of the host, validated by the ISO's keyring packages
+inline constexpr std::string_view kHostKeyringDir = "/etc/pacman.d/gnupg";
+/// Where the keyring packages put `<name>.gpg` and `<name>-trusted`
+inline constexpr std::string_view kKeyringsDir = "/usr/share/pacman/keyrings";
+
+struct SeedOptions final {
+    std::string host_dir{kHostKeyringDir};
+    std::string keyrings_dir{kKeyringsDir};
+};
+
+struct SeedResult final {
+    /// false when the target had a keyring already
+    bool copied{false};
+    /// primary keys and subkeys in the target keyring
+    std::size_t keys{};
+    /// trusted keys of the keyring packages the target keyring lacks
+    std::size_t missing_trusted{};
+};
+
+/// @brief Uppercase hex fingerprints of the v4 keys and subkeys in `<keyring_dir>/pubring.gpg`.
+auto read_fingerprints(std::string_view keyring_dir) noexcept -> Result<std::vector<std::string>>;
+
+/// @brief Fingerprints listed in the `*-trusted` files of @p keyrings_dir, what `pacman-key --populate` signs.
+auto trusted_fingerprints(std::string_view keyrings_dir = kKeyringsDir) noexcept -> std::vector<std::string>;
+
+/// @brief Whether @p key, a fingerprint or a 16 digit key id, is one of @p fingerprints.
+auto has_key(std::span<const std::string> fingerprints, std::string_view key) noexcept -> bool;
+
+/// @brief Copies the host keyring into `<mountpoint>/etc/pacman.d/gnupg`, unless the target has one,
+/// which is what pacstrap does without -G, minus `pacman-key --init` in the target.
+///
+/// The target keyring should hold every trusted key of the host's keyring packages afterwards,
+/// so the keyring scriptlets have nothing to fetch. A missing one is only a warning, the copy is
+/// what pacstrap hands the target anyway and the scriptlets' populate adds what it lacks.
+auto seed_target(std::string_view mountpoint, const SeedOptions& options = {}) noexcept -> Result<SeedResult>;
+
+/// @brief Checks that @p keyring_dir holds the key named as issuer of every signature in @p sig_files.
+///
+/// Only the presence of the signer is checked, the signatures themselves are verified by
+/// pacman or libalpm. A file that doesn't exist, one never downloaded, has nothing to check.
+/// @return the number of signers found
+auto check_signers(std::string_view keyring_dir, std::span<const std::string> sig_files) noexcept -> Result<std::size_t>;
+
+}  // namespace gucc::keyring
+
+namespace gucc::keyring::detail {
+
+/// @brief A public key (sub)packet body as its v4 fingerprint, nullopt for other versions.
+auto v4_fingerprint(std::string_view key_body) noexcept -> std::optional<std::string>;
+
+/// @brief Fingerprints of every public key and subkey packet in a binary keyring.
+auto keyring_fingerprints(std::string_view keyring) noexcept -> Result<std::vector<std::string>>;
+
+/// @brief Issuer of a binary detached signature: the fingerprint when it carries one, else the key id.
+auto signature_issuer(std::string_view signature) noexcept -> std::optional<std::string>;
+
+}  // namespace gucc::keyring::detail
+
+#endif  // KEYRING_HPP
@@ -0,0 +1,60 @@
+#ifndef LOCAL_DB_HPP
+#define LOCAL_DB_HPP
+
+#include "gucc/error.hpp"
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint32_t
+
+#include <optional>       // for optional
+#include <string>         // for string
+#include <string_view>    // for string_view
+#include <unordered_map>  // for unordered_map
+#include <vector>         // for vector
+
+namespace gucc::localdb {
+
+/// @brief Packages installed under a root, read from `<root>/var/lib/pacman/local`.
+///
+/// Opening lists the `<name>-<version>` dirs only, that answers installed and version
+/// queries. The files list of a package is read when asked for.
+class LocalDatabase final {
+ public:
+    LocalDatabase() = default;
+
+    LocalDatabase(const LocalDatabase&)                    = delete;
+    LocalDatabase(LocalDatabase&&)                         = default;
+    auto operator=(const LocalDatabase&) -> LocalDatabase& = delete;
+    auto operator=(LocalDatabase&&) -> LocalDatabase&      = default;
+
+    /// @brief Lists the local db of @p root_mountpoint, e.g "/" for the host or "/mnt" for the target.
+    static auto open(std::string_view root_mountpoint) noexcept -> Result<LocalDatabase>;
+
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return m_dirs.size(); }
+
+    /// @brief Whether a package named exactly @p name is installed, like `pacman -Qq <name>`.
+    [[nodiscard]] auto is_installed(std::string_view name) const noexcept -> bool;
+
+    /// @brief `[epoch:]pkgver-pkgrel` of the installed @p name.
+    [[nodiscard]] auto version(std::string_view name) const noexcept -> std::optional<std::string_view>;
+
+    /// @brief Paths owned by @p name, relative to the root, like `pacman -Qlq <name>`.
+    [[nodiscard]] auto files(std::string_view name) const noexcept -> Result<std::vector<std::string>>;
+
+    /// @brief Names of all installed packages, sorted.
+    [[nodiscard]] auto package_names() const noexcept -> std::vector<std::string_view>;
+
+ private:
+    std::string m_local_dir{};
+    /// `<name>-<version>` dir names, never resized once indexed
+    std::vector<std::string> m_dirs{};
+    /// name (viewing m_dirs) -> index into m_dirs
+    std::unordered_map<std::string_view, std::uint32_t> m_by_name{};
+};
+
+/// @brief One-shot `pacman -Qq <name>` against @p root_mountpoint, false if there is no local db.
+auto is_installed(std::string_view name, std::string_view root_mountpoint) noexcept -> bool;
+
+}  // namespace gucc::localdb
+
+#endif  // LOCAL_DB_HPP
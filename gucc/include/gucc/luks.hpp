@@ -3,20 +3,90 @@
 
 #include "gucc/error.hpp"
 
+#include <cstdint>  // for uint32_t
+
+#include <optional>     // for optional
+#include <string>       // for string
 #include <string_view>  // for string_view
 
 namespace gucc::crypto {
 
-auto luks1_open(std::string_view luks_pass, std::string_view partition, std::string_view luks_name) noexcept -> Result<void>;
+/// @brief Argon2id cost of a LUKS2 keyslot, as measured by `cryptsetup benchmark`.
+struct LuksPbkdfParams final {
+    /// time cost, passed as --pbkdf-force-iterations
+    std::uint32_t iterations{};
+    /// memory cost in KiB
+    std::uint32_t memory_kib{};
+    /// threads
+    std::uint32_t parallel{};
+
+    constexpr bool operator==(const LuksPbkdfParams&) const = default;
+};
+
+/// @brief dm-crypt settings picked for the device under a LUKS2 volume.
+struct LuksPerfOptions final {
+    /// dm-crypt sector size in bytes, 0 leaves it to cryptsetup
+    std::uint32_t sector_size{};
+    /// Encrypt/decrypt in the submitting context instead of the kcryptd workqueues,
+    /// only worth it on low latency devices like NVMe
+    bool no_read_workqueue{false};
+    bool no_write_workqueue{false};
+
+    constexpr bool operator==(const LuksPerfOptions&) const = default;
+};
+
+auto luks1_open(std::string_view luks_pass, std::string_view partition, std::string_view luks_name, std::string_view additional_flags = {}) noexcept -> Result<void>;
 auto luks1_format(std::string_view luks_pass, std::string_view partition, std::string_view additional_flags = {}) noexcept -> Result<void>;
 auto luks1_add_key(std::string_view dest_file, std::string_view partition, std::string_view additional_flags = {}) noexcept -> Result<void>;
 auto luks1_setup_keyfile(std::string_view dest_file, std::string_view mountpoint, std::string_view partition, std::string_view additional_flags = {}) noexcept -> Result<void>;
 
-auto luks2_open(std::string_view luks_pass, std::string_view partition, std::string_view luks_name) noexcept -> Result<void>;
+// luks2_format and luks2_add_key reuse the calibrated Argon2id cost of luks2_pbkdf_params,
+// unless additional_flags picks the PBKDF itself
+auto luks2_open(std::string_view luks_pass, std::string_view partition, std::string_view luks_name, std::string_view additional_flags = {}) noexcept -> Result<void>;
 auto luks2_format(std::string_view luks_pass, std::string_view partition, std::string_view additional_flags = {}) noexcept -> Result<void>;
 auto luks2_add_key(std::string_view dest_file, std::string_view partition, std::string_view additional_flags = {}) noexcept -> Result<void>;
 auto luks2_setup_keyfile(std::string_view dest_file, std::string_view mountpoint, std::string_view partition, std::string_view additional_flags = {}) noexcept -> Result<void>;
 
+/// @brief Argon2id cost for new LUKS2 keyslots.
+///
+/// Runs `cryptsetup benchmark --pbkdf argon2id` on the first call only, every later
+/// keyslot of the install reuses the result instead of benchmarking again.
+/// @return params, std::nullopt if the benchmark failed and cryptsetup has to calibrate itself
+auto luks2_pbkdf_params() noexcept -> std::optional<LuksPbkdfParams>;
+
+/// @brief cryptsetup flags creating a keyslot with @p params.
+auto luks2_pbkdf_flags(const LuksPbkdfParams& params) noexcept -> std::string;
+
+/// @brief Picks the dm-crypt settings for @p device.
+/// 4K sectors when the physical sectors are 4K, the workqueue bypass for NVMe when
+/// @p bypass_workqueues is set.
+auto query_luks_perf_options(std::string_view device, bool bypass_workqueues) noexcept -> LuksPerfOptions;
+
+/// @brief luksFormat flags for @p options, e.g "--sector-size 4096".
+auto luks2_format_perf_flags(const LuksPerfOptions& options) noexcept -> std::string;
+
+/// @brief open flags for @p options. The workqueue flags are stored in the LUKS2 header
+/// with --persistent, so every later activation (initramfs included) uses them too.
+auto luks2_open_perf_flags(const LuksPerfOptions& options) noexcept -> std::string;
+
+/// @brief open flags for @p options without --persistent. A LUKS1 header can't store
+/// them, crypttab has to carry them to the later activations.
+auto luks1_open_perf_flags(const LuksPerfOptions& options) noexcept -> std::string;
+
+/// @brief The same workqueue settings as crypttab(5) options, e.g "no-read-workqueue,no-write-workqueue".
+auto luks_crypttab_perf_options(const LuksPerfOptions& options) noexcept -> std::string;
+
 }  // namespace gucc::crypto
 
+namespace gucc::crypto::detail {
+
+/// @brief Parses the argon2id line of `cryptsetup benchmark --pbkdf argon2id` output.
+auto parse_pbkdf_benchmark(std::string_view output) noexcept -> std::optional<LuksPbkdfParams>;
+
+/// @brief Prepends the flags of @p params to @p additional_flags, unless they already
+/// choose the PBKDF or its cost.
+auto with_pbkdf_flags(std::string_view additional_flags, const std::optional<LuksPbkdfParams>& params) noexcept -> std::string;
+
+}  // namespace gucc::crypto::detail
+
 #endif  // LUKS_HPP
@@ -3,9 +3,10 @@
 
 #include "gucc/error.hpp"
 
+#include <cstdint>  // for uint32_t, uint64_t
+
 #include <string>       // for string
 #include <string_view>  // for string_view
-#include <utility>      // for pair
 #include <vector>       // for vector
 
 namespace gucc::lvm {
@@ -21,20 +22,87 @@ struct LvmInfo {
     }
 };
 
+/// @brief A physical volume, sizes in bytes.
+struct LvmPhysicalVolume final {
+    std::string name;
+    std::string uuid;
+    /// Empty for a PV which doesn't belong to any VG
+    std::string vg_name;
+    std::uint64_t size{};
+    std::uint64_t free{};
+};
+
+/// @brief A volume group, sizes in bytes.
+struct LvmVolumeGroup final {
+    std::string name;
+    std::string uuid;
+    std::uint64_t size{};
+    std::uint64_t free{};
+    std::uint64_t extent_size{};
+};
+
+/// @brief One segment of a logical volume.
+struct LvmSegment final {
+    /// Offset into the LV in bytes
+    std::uint64_t start{};
+    std::uint64_t size{};
+    /// linear, striped, raid1, thin-pool, cache, ...
+    std::string type;
+    std::uint32_t stripes{1};
+    /// PVs or hidden sub LVs backing the segment, without the extent offsets
+    std::vector<std::string> devices{};
+};
+
+/// @brief A logical volume, sizes in bytes.
+struct LvmLogicalVolume final {
+    std::string name;
+    std::string uuid;
+    std::string vg_name;
+    /// /dev/<vg>/<lv>, empty for hidden LVs
+    std::string path;
+    std::uint64_t size{};
+    /// lv_attr, e.g "-wi-a-----"
+    std::string attr;
+    /// Thin pool of a thin LV
+    std::string pool_lv;
+    /// Origin of a snapshot
+    std::string origin;
+    std::vector<LvmSegment> segments{};
+
+    [[nodiscard]] constexpr bool is_active() const noexcept {
+        return attr.size() > 4 && attr[4] == 'a';
+    }
+};
+
+/// @brief Everything LVM knows about, from a single `lvm fullreport`.
+struct LvmReport final {
+    std::vector<LvmPhysicalVolume> physical_volumes{};
+    std::vector<LvmVolumeGroup> volume_groups{};
+    std::vector<LvmLogicalVolume> logical_volumes{};
+};
+
+/// @brief Runs `lvm fullreport` once and returns PVs, VGs, LVs and their segments.
+/// @return An empty report when LVM isn't installed or nothing was found.
+auto read_lvm_report() noexcept -> Result<LvmReport>;
+
 // Detect existing LVM setup
 auto detect_lvm() noexcept -> LvmInfo;
 
 // Activate LVM volumes (load dm-mod, vgscan, vgchange)
 auto activate_lvm() noexcept -> Result<void>;
 
-// Show volume groups with their sizes
-auto show_volume_groups() noexcept -> std::vector<std::pair<std::string, std::string>>;
+}  // namespace gucc::lvm
 
-/// @brief Parse vgs command output (tab-separated vg_name and vg_size)
-/// @param output Raw output from: vgs -o vg_name,vg_size --noheading --separator='\t' --units=g
-/// @return Vector of pairs (vg_name, vg_size)
-auto parse_vgs_output(std::string_view output) noexcept -> std::vector<std::pair<std::string, std::string>>;
+namespace gucc::lvm::detail {
 
-}  // namespace gucc::lvm
+/// @brief Parses `lvm fullreport --reportformat json --units b --nosuffix` output.
+///
+/// Accepts sizes as strings (json) and as numbers (json_std).
+auto parse_lvm_fullreport(std::string_view json_output) noexcept -> Result<LvmReport>;
+
+/// @brief Splits the `devices` field of a segment, e.g "/dev/sda2(0),/dev/sdb1(512)".
+auto parse_segment_devices(std::string_view devices) noexcept -> std::vector<std::string>;
+
+}  // namespace gucc::lvm::detail
 
 #endif  // LVM_HPP
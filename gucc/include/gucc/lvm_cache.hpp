@@ -0,0 +1,87 @@
+#ifndef LVM_CACHE_HPP
+#define LVM_CACHE_HPP
+
+#include "gucc/error.hpp"
+
+#include <cstdint>  // for uint8_t, uint64_t
+
+#include <optional>     // for optional
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+namespace gucc::lvm {
+
+/// @brief How the fast device caches the logical volume.
+enum class LvmCacheMode : std::uint8_t {
+    /// dm-cache, writes reach the origin before they complete
+    Writethrough,
+    /// dm-cache, writes complete on the cache and are flushed later
+    Writeback,
+    /// dm-writecache, only writes are cached
+    Writecache,
+};
+
+/// @brief Converts a cache mode name ("writethrough", "writeback", "writecache").
+auto string_to_lvm_cache_mode(std::string_view mode) noexcept -> std::optional<LvmCacheMode>;
+
+/// @brief Name of @p mode as accepted by string_to_lvm_cache_mode.
+auto lvm_cache_mode_to_string(LvmCacheMode mode) noexcept -> std::string_view;
+
+/// @brief A logical volume on slow devices, cached by a fast one.
+struct LvmCacheConfig final {
+    std::string vg_name{"vgcachyos"};
+    std::string lv_name{"root"};
+    /// Slow devices (e.g HDDs) the data lives on, the LV spans all of them
+    std::vector<std::string> origin_devices{};
+    /// Fast device (e.g a NVMe partition) holding the cache
+    std::string cache_device;
+    LvmCacheMode mode{LvmCacheMode::Writethrough};
+};
+
+/// @brief Sizes picked for the cache, in bytes.
+struct LvmCachePlan final {
+    std::uint64_t origin_size{};
+    std::uint64_t cache_size{};
+    /// dm-cache block size, 0 for dm-writecache
+    std::uint64_t chunk_size{};
+    /// Layout is valid, but probably not what was intended
+    std::vector<std::string> warnings{};
+};
+
+/// @brief Picks the cache sizes for the free space of the VG.
+///
+/// The cache takes the whole fast device, rounded down to extents. The
+/// dm-cache chunk size grows in powers of two from 64KiB, so the cache
+/// never tracks more than a million chunks.
+/// @param config The layout, only the mode is consulted.
+/// @param origin_free Free bytes on the origin devices.
+/// @param cache_free Free bytes on the cache device.
+/// @param extent_size Extent size of the VG.
+/// @return The plan, an error when the cache is too small or as large as the origin.
+auto plan_lvm_cache(const LvmCacheConfig& config, std::uint64_t origin_free, std::uint64_t cache_free, std::uint64_t extent_size) noexcept -> Result<LvmCachePlan>;
+
+/// @brief Creates the VG, the origin LV and attaches the cache to it.
+/// @warning wipes every device of @p config.
+/// @return The path of the cached LV, e.g "/dev/vgcachyos/root".
+auto create_cached_lv(const LvmCacheConfig& config) noexcept -> Result<std::string>;
+
+}  // namespace gucc::lvm
+
+namespace gucc::lvm::detail {
+
+/// @brief Builds `vgcreate` over the origin devices and the cache device.
+auto vgcreate_cmd(const LvmCacheConfig& config) noexcept -> std::string;
+
+/// @brief Builds `lvcreate` of the origin LV, restricted to the origin devices.
+auto lvcreate_origin_cmd(const LvmCacheConfig& config) noexcept -> std::string;
+
+/// @brief Builds `lvcreate` of the cache volume on the cache device.
+auto lvcreate_cachevol_cmd(const LvmCacheConfig& config, const LvmCachePlan& plan) noexcept -> std::string;
+
+/// @brief Builds `lvconvert` attaching the cache volume to the origin LV.
+auto lvconvert_cache_cmd(const LvmCacheConfig& config, const LvmCachePlan& plan) noexcept -> std::string;
+
+}  // namespace gucc::lvm::detail
+
+#endif  // LVM_CACHE_HPP
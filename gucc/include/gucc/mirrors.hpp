@@ -2,8 +2,132 @@
 
 #include "gucc/error.hpp"
 
+#include <chrono>       // for seconds, milliseconds
+#include <cstddef>      // for size_t
+#include <cstdint>      // for int64_t, uint32_t, uint64_t
+#include <optional>     // for optional
+#include <span>         // for span
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
 namespace gucc::mirrors {
 
-auto rank_mirrors() noexcept -> Result<void>;
+/// @brief A mirrorlist to rank.
+struct MirrorList final {
+    std::string path;
+    /// Substituted for $repo, its database is what the probes download
+    std::string probe_repo;
+};
+
+/// @brief What probing one URL measured.
+struct MirrorProbe final {
+    std::string url;
+    bool reachable{false};
+    /// HEAD round trip
+    double latency_ms{};
+    /// Short ranged GET, 0 when the mirror wasn't among the transfer probes
+    double bytes_per_sec{};
+};
+
+/// @brief Outcome of probing a batch of URLs.
+struct ProbeReport final {
+    /// Same order as the probed URLs
+    std::vector<MirrorProbe> probes;
+    /// What the concurrent transfer probes pulled together, a stand-in for the link speed
+    double bandwidth{};
+};
+
+/// @brief How hard to probe.
+struct ProbeOptions final {
+    /// Per request, a mirror slower than that is unreachable
+    std::chrono::milliseconds timeout{3000};
+    /// Bytes fetched by each transfer probe
+    std::uint64_t probe_bytes{256 * 1024};
+    /// Only the lowest latency mirrors get a transfer probe
+    std::size_t transfer_candidates{8};
+    /// HEAD requests in flight at once. Hundreds of handshakes on one link
+    /// measure the link, not the mirrors
+    std::size_t latency_batch{24};
+};
+
+/// @brief The mirrorlists of an Arch + CachyOS host.
+auto default_mirrorlists() noexcept -> std::vector<MirrorList>;
+
+struct RankOptions final {
+    std::vector<MirrorList> mirrorlists{default_mirrorlists()};
+    /// Ranked copies of the mirrorlists, reused while younger than cache_ttl
+    std::string cache_dir{"/var/cache/cachyos-installer/mirrors"};
+    std::chrono::seconds cache_ttl{std::chrono::hours{1}};
+    ProbeOptions probe{};
+};
+
+struct RankResult final {
+    /// ParallelDownloads for the measured bandwidth
+    std::uint32_t parallel_downloads{};
+    double bandwidth{};
+    /// Mirrorlists taken from the cache without probing
+    std::size_t cached_lists{};
+    std::size_t probed_lists{};
+};
+
+/// @brief Active `Server =` URLs of a mirrorlist, in order.
+auto parse_mirrorlist(std::string_view content) noexcept -> std::vector<std::string>;
+
+/// @brief Expands the $repo and $arch variables of a mirrorlist server, without a trailing slash.
+auto server_url(std::string_view server, std::string_view repo, std::string_view arch = "x86_64") noexcept -> std::string;
+
+/// @brief Probes every URL concurrently.
+///
+/// Waves of latency_batch HEAD requests measure latency. The transfer_candidates lowest
+/// latency mirrors then get a ranged GET of probe_bytes, all at once.
+auto probe_mirrors(std::span<const std::string> urls, const ProbeOptions& options) noexcept -> ProbeReport;
+
+/// @brief ParallelDownloads worth using on a link of @p bandwidth bytes per second.
+/// One stream per 2MiB/s, between 2 and 16.
+auto parallel_downloads_for(double bandwidth) noexcept -> std::uint32_t;
+
+/// @brief Sets ParallelDownloads in the [options] of the pacman.conf at @p conf_path.
+auto set_parallel_downloads(std::string_view conf_path, std::uint32_t parallel_downloads) noexcept -> Result<void>;
+
+/// @brief Ranks every mirrorlist of @p options in place.
+///
+/// Mirrorlists ranked less than cache_ttl ago, with the same set of servers, are
+/// restored from the cache without probing. The rest are probed in one batch.
+/// Under dry-run nothing is probed or written, the result has the minimal ParallelDownloads.
+/// @return error if no mirror of any list answered
+auto rank_mirrors(const RankOptions& options = {}) noexcept -> Result<RankResult>;
 
 }  // namespace gucc::mirrors
+
+namespace gucc::mirrors::detail {
+
+/// @brief Header of a ranked mirrorlist.
+struct RankHeader final {
+    std::int64_t ranked_at{};
+    /// mirror_set_hash of the servers it was ranked from
+    std::string source{};
+    double bandwidth{};
+};
+
+/// @brief URL probed for @p server, e.g "https://mirror/$repo/os/$arch" -> "https://mirror/core/os/x86_64/core.db".
+auto probe_url(std::string_view server, std::string_view repo) noexcept -> std::string;
+
+/// @brief Order independent hash of the servers.
+auto mirror_set_hash(std::vector<std::string> servers) noexcept -> std::string;
+
+/// @brief Indices of @p probes best first.
+/// Mirrors with a transfer probe by time to fetch a 1MiB package, then the others
+/// by latency, unreachable mirrors last in their original order.
+auto rank_order(std::span<const MirrorProbe> probes) noexcept -> std::vector<std::size_t>;
+
+/// @brief Renders a ranked mirrorlist with its header.
+auto render_mirrorlist(std::span<const std::string> servers, const RankHeader& header) noexcept -> std::string;
+
+/// @brief Parses the header written by render_mirrorlist.
+auto parse_rank_header(std::string_view content) noexcept -> std::optional<RankHeader>;
+
+/// @brief Replaces or adds the ParallelDownloads line of the [options] section.
+auto with_parallel_downloads(std::string_view conf, std::uint32_t parallel_downloads) noexcept -> std::string;
+
+}  // namespace gucc::mirrors::detail
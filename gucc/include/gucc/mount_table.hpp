@@ -0,0 +1,85 @@
+#ifndef MOUNT_TABLE_HPP
+#define MOUNT_TABLE_HPP
+
+#include "gucc/error.hpp"
+
+#include <cstdint>  // for uint32_t
+
+#include <span>           // for span
+#include <string>         // for string
+#include <string_view>    // for string_view
+#include <unordered_map>  // for unordered_map
+#include <vector>         // for vector
+
+namespace gucc::mtab {
+
+/// @brief One line of /proc/self/mountinfo.
+/// Views point into the MountTable that parsed it, octal escapes are already decoded.
+struct MountInfoEntry final {
+    std::uint32_t mount_id{};
+    std::uint32_t parent_id{};
+    std::uint32_t major{};
+    std::uint32_t minor{};
+    /// Path inside the filesystem that is mounted, e.g /@home for a btrfs subvolume
+    std::string_view root{};
+    std::string_view mountpoint{};
+    /// Per-mount options
+    std::string_view mount_opts{};
+    std::string_view fstype{};
+    std::string_view source{};
+    /// Per-superblock options
+    std::string_view super_opts{};
+};
+
+/// @brief Parsed mountinfo, indexed by mount ID and by mountpoint.
+///
+/// The content is kept in a single buffer, entries reference it without copies.
+class MountTable final {
+ public:
+    MountTable() = default;
+
+    MountTable(const MountTable&)                    = delete;
+    MountTable(MountTable&&)                         = default;
+    auto operator=(const MountTable&) -> MountTable& = delete;
+    auto operator=(MountTable&&) -> MountTable&      = default;
+
+    /// @brief Reads and parses mountinfo of the current process.
+    static auto read(std::string_view mountinfo_path = "/proc/self/mountinfo") noexcept -> Result<MountTable>;
+
+    /// @brief Parses mountinfo content.
+    static auto parse(std::string_view mountinfo_content) noexcept -> Result<MountTable>;
+
+    /// @brief All mounts in mountinfo order, which is the order they were mounted in.
+    [[nodiscard]] auto entries() const noexcept -> std::span<const MountInfoEntry> {
+        return m_entries;
+    }
+
+    [[nodiscard]] auto find_by_id(std::uint32_t mount_id) const noexcept -> const MountInfoEntry*;
+
+    /// @brief The visible mount at exactly @p mountpoint, the topmost one if mounts are stacked.
+    [[nodiscard]] auto find_by_mountpoint(std::string_view mountpoint) const noexcept -> const MountInfoEntry*;
+
+    /// @brief @p root_mountpoint and everything mounted below it, children before their parents.
+    /// Umounting in that order never hits a busy parent.
+    [[nodiscard]] auto mounts_under(std::string_view root_mountpoint) const noexcept -> std::vector<const MountInfoEntry*>;
+
+ private:
+    std::vector<char> m_buffer{};
+    std::vector<MountInfoEntry> m_entries{};
+    /// mount ID -> index into m_entries
+    std::unordered_map<std::uint32_t, std::uint32_t> m_by_id{};
+    /// indices into m_entries, sorted by mountpoint, then by mount order
+    std::vector<std::uint32_t> m_by_mountpoint{};
+    /// indices into m_entries of the mounts on top of each entry
+    std::vector<std::vector<std::uint32_t>> m_children{};
+
+    auto parse_buffer() noexcept -> Result<void>;
+    void build_index() noexcept;
+};
+
+/// @brief Decodes the octal escapes (e.g `\040` for space) the kernel puts into mount paths.
+auto decode_mount_escapes(std::string_view escaped) noexcept -> std::string;
+
+}  // namespace gucc::mtab
+
+#endif  // MOUNT_TABLE_HPP
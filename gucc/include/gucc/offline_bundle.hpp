@@ -0,0 +1,74 @@
+#ifndef OFFLINE_BUNDLE_HPP
+#define OFFLINE_BUNDLE_HPP
+
+#include "gucc/error.hpp"
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+
+#include <span>         // for span
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+namespace gucc::bundle {
+
+/// `<bundle>/repos/<repo>` holds `<repo>.db` and the package files, one local repo per sync repo
+inline constexpr std::string_view kReposDir = "repos";
+/// `<bundle>/profiles` holds the profile TOMLs the package set was resolved from
+inline constexpr std::string_view kProfilesDir = "profiles";
+/// `<bundle>/sync` holds the sync dbs the package set was resolved against
+inline constexpr std::string_view kSyncDir = "sync";
+
+struct BuildOptions final {
+    /// Repos and servers the packages come from
+    std::string pacman_config{"/etc/pacman.conf"};
+    /// Synced dbs of those repos. Left empty, fresh `<repo>.db` files are fetched from the
+    /// servers of pacman_config into `<bundle>/sync` first, the host dbs are as old as its last -Sy
+    std::string sync_dir{};
+    /// Transfers in flight over all mirrors
+    std::size_t max_connections{8};
+};
+
+struct BuildResult final {
+    std::size_t packages{};
+    std::uint64_t download_size{};
+    std::uint64_t install_size{};
+};
+
+/// @brief `<bundle_dir>/repos/<repo>`, the local repo of @p repo.
+auto repo_dir(std::string_view bundle_dir, std::string_view repo) noexcept -> std::string;
+
+/// @brief Builds a bundle at @p bundle_dir holding the dependency closure of @p targets.
+///
+/// Packages and signatures are downloaded into the local repo of their sync repo, next to a db
+/// with their sync db entries. Every repo of the pacman.conf gets a db, empty when none of its
+/// packages were needed, so a pacman.conf pointed at the bundle syncs without a network.
+/// Running it again only downloads what changed.
+/// @return error if the targets don't resolve or a package couldn't be fetched
+auto build(std::string_view bundle_dir, std::span<const std::string> targets, const BuildOptions& options = {}) noexcept -> Result<BuildResult>;
+
+/// @brief Points the repos of the pacman.conf at @p conf_path to the bundle at @p bundle_dir.
+///
+/// Repos the bundle doesn't carry are dropped, pacman would fail to sync them offline.
+auto use_bundle(std::string_view conf_path, std::string_view bundle_dir) noexcept -> Result<void>;
+
+/// @brief Bind mounts the bundle at its own path below @p mountpoint, so pacman run in a chroot
+/// of the target finds it as well.
+auto attach(std::string_view bundle_dir, std::string_view mountpoint) noexcept -> Result<void>;
+
+/// @brief Undoes attach and gives the target @p host_conf back as its pacman.conf,
+/// the installed system has no bundle to sync from.
+auto detach(std::string_view bundle_dir, std::string_view mountpoint, std::string_view host_conf = "/etc/pacman.conf") noexcept -> Result<void>;
+
+}  // namespace gucc::bundle
+
+namespace gucc::bundle::detail {
+
+/// @brief @p conf with each repo section of @p repos served from `file://<bundle_dir>/repos/$repo`
+/// and every other repo section removed.
+auto with_bundle_servers(std::string_view conf, std::string_view bundle_dir, std::span<const std::string> repos) noexcept -> std::string;
+
+}  // namespace gucc::bundle::detail
+
+#endif  // OFFLINE_BUNDLE_HPP
@@ -0,0 +1,49 @@
+#ifndef PACKAGE_CACHE_HPP
+#define PACKAGE_CACHE_HPP
+
+#include "gucc/error.hpp"
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint64_t
+
+#include <span>         // for span
+#include <string>       // for string
+#include <string_view>  // for string_view
+
+namespace gucc::pkgcache {
+
+/// The cache pacman uses on the host, a RAM-backed overlay on the live ISO
+inline constexpr std::string_view kHostCacheDir = "/var/cache/pacman/pkg";
+
+/// @brief `<mountpoint>/var/cache/pacman/pkg`, where the installed system keeps its packages.
+auto target_cache_dir(std::string_view mountpoint) noexcept -> std::string;
+
+/// @brief Points the pacman.conf at @p conf_path to a cache on the target disk.
+///
+/// The target cache comes first, pacman downloads into the first writable CacheDir.
+/// The host cache stays second, whatever the ISO already holds is read from there.
+/// Only takes effect for `pacstrap -c`, without it pacstrap passes its own --cachedir.
+/// @return the target cache dir, created if missing
+auto use_target_cache(std::string_view conf_path, std::string_view mountpoint) noexcept -> Result<std::string>;
+
+struct PruneResult final {
+    std::size_t files{};
+    std::uint64_t bytes{};
+};
+
+/// @brief Removes the packages, signatures and partial downloads from @p cache_dir, like `pacman -Scc`.
+auto prune(std::string_view cache_dir) noexcept -> Result<PruneResult>;
+
+}  // namespace gucc::pkgcache
+
+namespace gucc::pkgcache::detail {
+
+/// @brief @p conf with its CacheDir lines replaced by @p cache_dirs, in order, in [options].
+auto with_cache_dirs(std::string_view conf, std::span<const std::string> cache_dirs) noexcept -> std::string;
+
+/// @brief Whether @p filename is something pacman puts into a cache dir.
+auto is_cache_file(std::string_view filename) noexcept -> bool;
+
+}  // namespace gucc::pkgcache::detail
+
+#endif  // PACKAGE_CACHE_HPP
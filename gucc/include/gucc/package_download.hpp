@@ -0,0 +1,86 @@
+#ifndef PACKAGE_DOWNLOAD_HPP
+#define PACKAGE_DOWNLOAD_HPP
+
+#include "gucc/error.hpp"
+
+#include <chrono>       // for milliseconds, seconds
+#include <cstddef>      // for size_t
+#include <cstdint>      // for int32_t, uint64_t
+#include <functional>   // for less
+#include <map>          // for map
+#include <optional>     // for optional
+#include <span>         // for span
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+namespace gucc::download {
+
+/// @brief A package file as recorded in its sync DB.
+struct PackageFile final {
+    /// Substituted for $repo in the servers
+    std::string repo;
+    /// e.g "linux-cachyos-6.11.1-1-x86_64_v3.pkg.tar.zst"
+    std::string filename;
+    /// %CSIZE%, 0 if unknown
+    std::uint64_t size{};
+    /// %SHA256SUM%, empty skips the verification
+    std::string sha256sum;
+};
+
+/// @brief Ranked `Server =` entries of every repo, unexpanded.
+using RepoServers = std::map<std::string, std::vector<std::string>, std::less<>>;
+
+struct DownloadOptions final {
+    /// The host cache `pacstrap -c` hands to pacman
+    std::string cache_dir{"/var/cache/pacman/pkg"};
+    std::string arch{"x86_64"};
+    /// Transfers in flight over all mirrors
+    std::size_t max_connections{8};
+    /// Transfers in flight to one server, the best ranked fill up first
+    std::size_t connections_per_mirror{3};
+    /// Checksum workers, 0 picks the number of CPUs
+    std::size_t verify_workers{0};
+    std::chrono::milliseconds connect_timeout{5000};
+    /// A transfer slower than 1KiB/s for that long moves to the next mirror
+    std::chrono::seconds stall_timeout{30};
+    /// Fetch the detached .sig next to every package
+    bool signatures{true};
+};
+
+struct DownloadResult final {
+    /// Complete and verified in the cache before we started
+    std::size_t cached{};
+    std::size_t downloaded{};
+    /// Downloads that continued a .part file
+    std::size_t resumed{};
+    std::uint64_t bytes{};
+    /// Files no mirror could deliver intact
+    std::vector<std::string> failed{};
+};
+
+/// @brief Servers of every repo of the pacman.conf at @p conf_path, following `Include =`.
+auto repo_servers(std::string_view conf_path) noexcept -> RepoServers;
+
+/// @brief Fetches @p packages and their signatures into options.cache_dir.
+///
+/// Transfers run concurrently over the servers of each repo, at most connections_per_mirror
+/// to one server. Interrupted transfers leave a .part file which the next run resumes. The
+/// checksums are verified by a separate pool of workers, a mismatch is fetched again from
+/// the next mirror.
+/// @return error if the cache can't be written, partial failures are in DownloadResult::failed
+auto download_packages(std::span<const PackageFile> packages, const RepoServers& servers, const DownloadOptions& options) noexcept -> Result<DownloadResult>;
+
+}  // namespace gucc::download
+
+namespace gucc::download::detail {
+
+/// @brief Status code of an HTTP status line, e.g "HTTP/1.1 206 Partial Content" -> 206.
+auto parse_status_line(std::string_view line) noexcept -> std::optional<std::int32_t>;
+
+/// @brief Whether the file at @p file_path is @p package, by size and checksum.
+auto matches_package(const PackageFile& package, std::string_view file_path) noexcept -> bool;
+
+}  // namespace gucc::download::detail
+
+#endif  // PACKAGE_DOWNLOAD_HPP
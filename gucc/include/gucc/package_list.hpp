@@ -1,7 +1,10 @@
 #pragma once
 
+#include "gucc/fetch_file.hpp"
 #include "gucc/package_profiles.hpp"
+#include "gucc/profile_index.hpp"
 
+#include <memory>       // for shared_ptr
 #include <optional>     // for optional
 #include <string>       // for string
 #include <string_view>  // for string_view
@@ -19,8 +22,16 @@ struct NetProfileInfo {
     // Optional url to a user-provided netprofiles overlay merged on top of
     // the base document.
     std::string net_profs_user_path;
+    // Hedging and caching of the url and its fallback.
+    fetch::FetchOptions fetch_options{};
+    // Where compiled indexes are kept per source revision for warm starts,
+    // empty disables them.
+    std::string index_snapshot_dir{"/var/cache/cachyos-installer/profiles"};
 };
 
+// Get the net profiles index, compiled once and shared until the urls change
+auto get_profile_index(NetProfileInfo net_profile_info) noexcept -> std::shared_ptr<const profile::ProfileIndex>;
+
 // Get base profile packages
 auto get_pkglist_base(std::string_view packages, std::string_view root_filesystem, bool server_mode, NetProfileInfo net_profile_info) noexcept -> std::optional<std::vector<std::string>>;
 
@@ -32,11 +32,6 @@ struct DesktopProfile {
     std::vector<std::string> packages{};
 };
 
-struct NetProfiles {
-    BaseProfiles base_profiles{};
-    std::vector<DesktopProfile> desktop_profiles{};
-};
-
 /// Groups may nest via `subgroups`.
 struct NetinstallGroup {
     std::string name{};
@@ -53,6 +48,12 @@ struct NetinstallGroup {
     std::vector<NetinstallGroup> subgroups{};
 };
 
+struct NetProfiles {
+    BaseProfiles base_profiles{};
+    std::vector<DesktopProfile> desktop_profiles{};
+    std::vector<NetinstallGroup> netinstall_groups{};
+};
+
 // Parse base profiles
 auto parse_base_profiles(std::string_view config_content) noexcept -> std::optional<BaseProfiles>;
 
@@ -8,6 +8,13 @@
 namespace gucc::detail::pacmanconf {
 bool push_repos_front(std::string_view file_path, std::string_view value) noexcept;
 auto get_repo_list(std::string_view file_path) noexcept -> std::vector<std::string>;
+
+/// @brief Sets @p key in the [options] section of @p conf to @p lines.
+///
+/// The first @p key line, commented out or not, turns into @p lines and the others go.
+/// Without one @p lines go right after [options], a missing section is appended.
+/// @p lines are whole lines, each ending with a newline.
+auto with_options_key(std::string_view conf, std::string_view key, std::string_view lines) noexcept -> std::string;
 }  // namespace gucc::detail::pacmanconf
 
 #endif  // PACMANCONF_REPO_HPP
@@ -21,6 +21,10 @@ struct Partition final {
     // if device is ssd, mount options for ssd should be appended
     std::string mount_opts{};
 
+    // mkfs command the partition gets formatted with (without the device),
+    // empty means the plain per-filesystem default
+    std::string mkfs_command{};
+
     /*
     // subvolumes per partition
     // e.g we have partition /dev/nvme0n1p1 with subvolumes: /@, /@home, /@cache
@@ -33,6 +37,9 @@ struct Partition final {
     std::optional<std::string> luks_mapper_name{};
     std::optional<std::string> luks_uuid{};
     std::optional<std::string> luks_passphrase{};
+    // crypttab options the volume needs whatever the key is,
+    // e.g "no-read-workqueue,no-write-workqueue"
+    std::optional<std::string> luks_crypttab_opts{};
 
     constexpr bool operator==(const Partition&) const = default;
 };
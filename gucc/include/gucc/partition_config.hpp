@@ -1,7 +1,7 @@
 #ifndef PARTITION_CONFIG_HPP
 #define PARTITION_CONFIG_HPP
 
-#include <cstdint>      // for uint8_t
+#include <cstdint>      // for uint8_t, uint64_t
 #include <optional>     // for optional
 #include <string>       // for string
 #include <string_view>  // for string_view
@@ -55,6 +55,12 @@ struct DefaultPartitionSchemaConfig final {
     /// Whether to create btrfs subvolumes (only applies when root_fs_type is Btrfs)
     bool create_btrfs_subvolumes{true};
 
+    /// Partition sizes are rounded up to this boundary (default: 1MiB, see compute_partition_alignment)
+    std::uint64_t alignment_bytes{1024 * 1024};
+
+    /// Custom mkfs command for root partition (if empty, get_mkfs_command is used)
+    std::optional<std::string> root_mkfs_command{};
+
     constexpr bool operator<=>(const DefaultPartitionSchemaConfig&) const = default;
 };
 
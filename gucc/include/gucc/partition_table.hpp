@@ -0,0 +1,105 @@
+#ifndef PARTITION_TABLE_HPP
+#define PARTITION_TABLE_HPP
+
+#include "gucc/error.hpp"
+#include "gucc/partition.hpp"
+
+#include <cstdint>  // for uint8_t, uint32_t, uint64_t
+
+#include <array>        // for array
+#include <optional>     // for optional
+#include <span>         // for span
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+namespace gucc::disk {
+
+enum class PartitionTableType : std::uint8_t {
+    Gpt,
+    Dos,
+};
+
+/// On-disk (mixed-endian) GUID bytes.
+using Guid = std::array<std::uint8_t, 16>;
+
+/// What the kernel reports about the block device.
+struct DiskGeometry final {
+    std::uint32_t logical_sector_size{512};
+    std::uint64_t size_bytes{};
+    /// Partition starts and sizes are rounded to this boundary.
+    std::uint64_t alignment_bytes{1024 * 1024};
+};
+
+struct PartitionTableEntry final {
+    std::uint32_t number{};
+    std::uint64_t start_lba{};
+    // inclusive
+    std::uint64_t end_lba{};
+    Guid type_guid{};
+    Guid unique_guid{};
+    std::uint8_t mbr_type{};
+    bool bootable{false};
+    std::string device{};
+};
+
+struct PartitionTableLayout final {
+    PartitionTableType type{PartitionTableType::Gpt};
+    DiskGeometry geometry{};
+    // for DOS only the first 4 bytes are used as the disk signature
+    Guid disk_guid{};
+    std::uint64_t first_usable_lba{};
+    std::uint64_t last_usable_lba{};
+    std::vector<PartitionTableEntry> entries{};
+};
+
+/// @brief Parses a partition size the way sfdisk does.
+/// @param size e.g "512M", "2GiB", "900G", "10GB", "50%" or a plain sector count
+/// @param sector_size The logical sector size of the device
+/// @param usable_bytes Space percentages are computed against
+/// @return Size in bytes, or nullopt if the string is not a size
+auto parse_partition_size(std::string_view size, std::uint32_t sector_size, std::uint64_t usable_bytes) noexcept -> std::optional<std::uint64_t>;
+
+/// @brief Reads logical sector size and capacity of the device.
+auto query_disk_geometry(std::string_view device) noexcept -> Result<DiskGeometry>;
+
+/// @brief Computes aligned partition offsets for the schema.
+/// @param device The target device (e.g., "/dev/nvme0n1")
+/// @param partitions The partition schema, same ordering rules as gen_sfdisk_command
+/// @param geometry The target device geometry
+/// @param is_efi GPT for UEFI, DOS otherwise
+/// @return The planned layout with freshly generated GUIDs
+auto plan_partition_table(std::string_view device, const std::vector<fs::Partition>& partitions, const DiskGeometry& geometry, bool is_efi) noexcept -> Result<PartitionTableLayout>;
+
+/// @brief Writes the table to the device and registers the partitions with the kernel.
+/// Waits only for the device nodes of the created partitions.
+auto write_partition_table(std::string_view device, const PartitionTableLayout& layout) noexcept -> Result<void>;
+
+/// @brief Plans and writes the partition table for the schema in-process.
+auto make_partition_table(std::string_view device, const std::vector<fs::Partition>& partitions, bool is_efi) noexcept -> Result<void>;
+
+}  // namespace gucc::disk
+
+namespace gucc::disk::detail {
+
+/// CRC32 (IEEE 802.3) as used by the GPT header and entry array.
+auto crc32(std::span<const std::uint8_t> data) noexcept -> std::uint32_t;
+
+/// Converts "C12A7328-F81F-11D2-BA4B-00A0C93EC93B" into on-disk byte order.
+auto parse_guid(std::string_view guid_str) noexcept -> std::optional<Guid>;
+
+/// Inverse of parse_guid, upper-case.
+auto format_guid(const Guid& guid) noexcept -> std::string;
+
+/// Sector 0. Protective MBR for GPT, the full table for DOS.
+auto serialize_mbr(const PartitionTableLayout& layout) noexcept -> std::vector<std::uint8_t>;
+
+/// 128 entries of 128 bytes, padded to whole sectors.
+auto serialize_gpt_entries(const PartitionTableLayout& layout) noexcept -> std::vector<std::uint8_t>;
+
+/// One sector holding the primary or backup GPT header.
+auto serialize_gpt_header(const PartitionTableLayout& layout, std::uint32_t entries_crc, bool is_primary) noexcept -> std::vector<std::uint8_t>;
+
+}  // namespace gucc::disk::detail
+
+#endif  // PARTITION_TABLE_HPP
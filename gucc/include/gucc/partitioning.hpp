@@ -14,6 +14,9 @@ namespace gucc::disk {
 // Erases disk
 auto erase_disk(std::string_view device) noexcept -> Result<void>;
 
+// Deduplicated partitions in the order they end up in the partition table
+auto get_partition_table_order(const std::vector<fs::Partition>& partitions) noexcept -> std::vector<fs::Partition>;
+
 // Generates sfdisk commands from Partition scheme
 auto gen_sfdisk_command(const std::vector<fs::Partition>& partitions, bool is_efi) noexcept -> std::string;
 
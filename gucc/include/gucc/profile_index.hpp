@@ -0,0 +1,74 @@
+#ifndef PROFILE_INDEX_HPP
+#define PROFILE_INDEX_HPP
+
+#include "gucc/error.hpp"
+#include "gucc/package_profiles.hpp"
+
+#include <cstdint>  // for uint32_t
+
+#include <span>           // for span
+#include <string>         // for string
+#include <string_view>    // for string_view
+#include <unordered_map>  // for unordered_map
+#include <vector>         // for vector
+
+namespace gucc::profile {
+
+/// @brief A net-profiles doc parsed once, indexed by desktop and netinstall group id.
+///
+/// Immutable after it's built, so one instance can be shared by every consumer of the
+/// same source revision. Group packages are expanded with their subgroups up front.
+class ProfileIndex final {
+ public:
+    ProfileIndex() = default;
+
+    ProfileIndex(const ProfileIndex&)                    = delete;
+    ProfileIndex(ProfileIndex&&)                         = default;
+    auto operator=(const ProfileIndex&) -> ProfileIndex& = delete;
+    auto operator=(ProfileIndex&&) -> ProfileIndex&      = default;
+
+    /// @brief Parses a (merged) net-profiles doc.
+    /// @param revision identifies the source, the SHA-256 of @p net_profiles_content if empty
+    static auto build(std::string_view net_profiles_content, std::string revision = {}) noexcept -> Result<ProfileIndex>;
+
+    /// @brief Loads a snapshot written by serialize().
+    /// Fails on a corrupt snapshot, or one built from another revision than @p expected_revision.
+    static auto deserialize(std::string_view snapshot, std::string_view expected_revision) noexcept -> Result<ProfileIndex>;
+
+    /// @brief Binary snapshot of the index, loaded back without parsing any TOML.
+    [[nodiscard]] auto serialize() const noexcept -> std::string;
+
+    [[nodiscard]] auto revision() const noexcept -> std::string_view { return m_revision; }
+    [[nodiscard]] auto base() const noexcept -> const BaseProfiles& { return m_base; }
+    [[nodiscard]] auto desktops() const noexcept -> std::span<const DesktopProfile> { return m_desktops; }
+    [[nodiscard]] auto groups() const noexcept -> std::span<const NetinstallGroup> { return m_groups; }
+
+    /// @brief The [desktop.'id'] profile, nullptr if the doc has none.
+    [[nodiscard]] auto find_desktop(std::string_view desktop_id) const noexcept -> const DesktopProfile*;
+
+    /// @brief The top-level netinstall group named @p group_id, the first one if the name repeats.
+    [[nodiscard]] auto find_group(std::string_view group_id) const noexcept -> const NetinstallGroup*;
+
+    /// @brief Packages of the group and of all its subgroups, nullptr if there is no such group.
+    [[nodiscard]] auto group_packages(std::string_view group_id) const noexcept -> const std::vector<std::string>*;
+
+ private:
+    std::string m_revision{};
+    BaseProfiles m_base{};
+    std::vector<DesktopProfile> m_desktops{};
+    std::vector<NetinstallGroup> m_groups{};
+    /// expanded packages, parallel to m_groups
+    std::vector<std::vector<std::string>> m_group_packages{};
+    /// keys view the names in m_desktops/m_groups, their buffers survive a move
+    std::unordered_map<std::string_view, std::uint32_t> m_desktop_by_id{};
+    std::unordered_map<std::string_view, std::uint32_t> m_group_by_id{};
+
+    void build_lookup() noexcept;
+};
+
+/// @brief Revision of a layered net-profiles source, changes whenever any layer does.
+auto layers_revision(const std::vector<std::string_view>& layers) noexcept -> std::string;
+
+}  // namespace gucc::profile
+
+#endif  // PROFILE_INDEX_HPP
@@ -0,0 +1,108 @@
+#ifndef RAID_HPP
+#define RAID_HPP
+
+#include "gucc/disk_topology.hpp"
+#include "gucc/error.hpp"
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t, uint64_t
+
+#include <optional>     // for optional
+#include <span>         // for span
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+namespace gucc::raid {
+
+/// @brief Redundancy profile, shared by md arrays and btrfs.
+enum class RaidLevel : std::uint8_t {
+    /// striped, no redundancy
+    Raid0,
+    /// every device holds a full copy
+    Raid1,
+    /// striped mirrors, half of the capacity
+    Raid10,
+};
+
+/// @brief Who assembles the devices into one filesystem.
+enum class RaidBackend : std::uint8_t {
+    /// md array formatted with any single-device filesystem
+    Mdadm,
+    /// btrfs spanning the devices natively
+    Btrfs,
+};
+
+/// @brief Converts a level name ("raid0", "raid1", "raid10").
+auto string_to_raid_level(std::string_view level) noexcept -> std::optional<RaidLevel>;
+
+/// @brief Name of @p level as accepted by string_to_raid_level, mdadm and mkfs.btrfs.
+auto raid_level_to_string(RaidLevel level) noexcept -> std::string_view;
+
+/// @brief Fewest devices @p level is allowed with.
+/// raid10 needs 4, two striped mirrors of two devices are plain raid1.
+auto raid_min_devices(RaidLevel level) noexcept -> std::size_t;
+
+/// @brief A filesystem spanning several devices.
+struct RaidSetup final {
+    RaidBackend backend{RaidBackend::Mdadm};
+    RaidLevel level{RaidLevel::Raid1};
+    /// btrfs metadata profile, mirrored by default even with raid0 data
+    RaidLevel metadata_level{RaidLevel::Raid1};
+    /// md array name, assembled as /dev/md/<name>
+    std::string name{"cachyos"};
+    /// Every member, the partition on the install device first
+    std::vector<std::string> devices{};
+    /// md chunk size in bytes, 0 for raid1 which has no stripes
+    std::uint64_t chunk_size{};
+};
+
+/// @brief Checks the device count and the md parameters of @p setup.
+auto validate_raid_setup(const RaidSetup& setup) noexcept -> Result<void>;
+
+/// @brief Picks the md chunk size for the members.
+///
+/// Starts at the mdadm default of 512KiB and grows to the largest physical
+/// block, minimum or optimal I/O size a member reports, rounded up to a power
+/// of two. Hints above 64MiB are ignored, same as for partition alignment.
+/// @return The chunk size in bytes, 0 for raid1.
+auto md_chunk_size_for(RaidLevel level, std::span<const disk::DiskTopology> members) noexcept -> std::uint64_t;
+
+/// @brief The topology the kernel will report for the array, usable for fs tuning
+/// before the array exists.
+auto md_array_topology(const RaidSetup& setup, std::span<const disk::DiskTopology> members) noexcept -> disk::DiskTopology;
+
+/// @brief Creates the md array of @p setup.
+/// @warning wipes every device of @p setup.
+/// @return The path of the array, e.g "/dev/md/cachyos".
+auto create_md_array(const RaidSetup& setup) noexcept -> Result<std::string>;
+
+/// @brief Assembles the existing md array of @p setup from its members.
+/// @return The path of the array, e.g "/dev/md/cachyos".
+auto assemble_md_array(const RaidSetup& setup) noexcept -> Result<std::string>;
+
+/// @brief Stops the md array at @p array_path.
+auto stop_md_array(std::string_view array_path) noexcept -> Result<void>;
+
+/// @brief Adds the running arrays to {mountpoint}/etc/mdadm.conf.
+/// mkinitcpio bundles the file, mdadm_udev assembles the arrays from it at boot.
+auto write_mdadm_conf(std::string_view mountpoint) noexcept -> Result<void>;
+
+/// @brief Appends the data and metadata profiles and the other members to a btrfs mkfs command.
+/// The first member is left out, it gets appended when formatting like for any partition.
+auto btrfs_raid_mkfs_command(std::string_view mkfs_command, const RaidSetup& setup) noexcept -> std::string;
+
+}  // namespace gucc::raid
+
+namespace gucc::raid::detail {
+
+/// @brief Builds `mdadm --create` for @p setup.
+auto mdadm_create_cmd(const RaidSetup& setup) noexcept -> std::string;
+
+/// @brief Appends the ARRAY lines of `mdadm --detail --scan` output @p conf doesn't
+/// list yet, arrays are matched by UUID.
+auto merge_mdadm_conf(std::string_view conf, std::string_view scan_output) noexcept -> std::string;
+
+}  // namespace gucc::raid::detail
+
+#endif  // RAID_HPP
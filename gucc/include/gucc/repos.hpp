@@ -7,7 +7,7 @@
 
 namespace gucc::repos {
 
-// Installs keyring on the host.
+// Installs keyring on the host, from the local keyring package before any keyserver.
 auto install_cachyos_keyring() noexcept -> Result<void>;
 
 // Creates pacman.conf for target.
@@ -0,0 +1,40 @@
+#ifndef SHA256_HPP
+#define SHA256_HPP
+
+#include <array>        // for array
+#include <cstddef>      // for size_t
+#include <cstdint>      // for uint8_t, uint32_t, uint64_t
+#include <optional>     // for optional
+#include <string>       // for string
+#include <string_view>  // for string_view
+
+namespace gucc::hash {
+
+/// @brief Incremental SHA-256, what the sync DB records for every package.
+class Sha256 final {
+ public:
+    Sha256() noexcept;
+
+    void update(std::string_view data) noexcept;
+    /// @brief Lowercase hex digest. The hasher is spent afterwards.
+    auto finish() noexcept -> std::string;
+
+ private:
+    void compress(const std::uint8_t* block) noexcept;
+
+    std::array<std::uint32_t, 8> m_state{};
+    std::array<std::uint8_t, 64> m_buffer{};
+    std::size_t m_buffered{};
+    std::uint64_t m_total_bytes{};
+};
+
+/// @brief SHA-256 of @p data as lowercase hex.
+auto sha256_hex(std::string_view data) noexcept -> std::string;
+
+/// @brief SHA-256 of the file at @p file_path as lowercase hex, read in 1MiB chunks.
+/// @return nullopt if the file can't be read
+auto sha256_file(std::string_view file_path) noexcept -> std::optional<std::string>;
+
+}  // namespace gucc::hash
+
+#endif  // SHA256_HPP
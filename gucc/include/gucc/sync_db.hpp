@@ -0,0 +1,201 @@
+#ifndef SYNC_DB_HPP
+#define SYNC_DB_HPP
+
+#include "gucc/error.hpp"
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t, uint32_t, uint64_t
+
+#include <memory>         // for unique_ptr
+#include <optional>       // for optional
+#include <span>           // for span
+#include <string>         // for string
+#include <string_view>    // for string_view
+#include <unordered_map>  // for unordered_map
+#include <vector>         // for vector
+
+namespace gucc::syncdb {
+
+/// @brief Version constraint of a dependency, e.g `>=` in `glibc>=2.40`.
+enum class DepMod : std::uint8_t {
+    Any,
+    Eq,
+    Ge,
+    Le,
+    Gt,
+    Lt,
+};
+
+/// @brief A depends/provides/conflicts entry, viewing the string it was parsed from.
+struct Dependency final {
+    std::string_view name{};
+    std::string_view version{};
+    DepMod mod{DepMod::Any};
+};
+
+/// @brief Splits e.g `libfoo.so=1-64` into name, constraint and version.
+auto parse_dependency(std::string_view depstring) noexcept -> Dependency;
+
+/// @brief Compares two `[epoch:]version[-release]` strings the way pacman does.
+/// @return <0, 0 or >0 like strcmp
+auto vercmp(std::string_view lhs, std::string_view rhs) noexcept -> int;
+
+/// @brief Package of a sync db. Views stay valid while the SyncDatabase lives.
+struct PackageInfo final {
+    std::string_view repo{};
+    std::string_view name{};
+    std::string_view version{};
+    std::string_view filename{};
+    std::string_view sha256sum{};
+    /// %CSIZE%
+    std::uint64_t download_size{};
+    /// %ISIZE%
+    std::uint64_t install_size{};
+};
+
+/// @brief A target or dependency nothing in the repos satisfies.
+struct MissingDependency final {
+    std::string dependency{};
+    /// empty for a target
+    std::string required_by{};
+};
+
+struct PackageConflict final {
+    std::string package{};
+    std::string conflicts_with{};
+    /// the %CONFLICTS% entry that matched
+    std::string rule{};
+};
+
+struct Resolution final {
+    /// The dependency closure, every package after its dependencies
+    std::vector<PackageInfo> packages{};
+    std::vector<MissingDependency> missing{};
+    std::vector<PackageConflict> conflicts{};
+    std::uint64_t download_size{};
+    std::uint64_t install_size{};
+
+    [[nodiscard]] auto ok() const noexcept -> bool { return missing.empty() && conflicts.empty(); }
+};
+
+namespace detail {
+
+/// @brief Append-only string interner. Strings live in fixed blocks and never move.
+class StringPool final {
+ public:
+    StringPool() noexcept;
+
+    /// @brief Id of @p value, added on first sight. Id 0 is the empty string.
+    auto intern(std::string_view value) noexcept -> std::uint32_t;
+    /// @brief Id of @p value if it was ever interned.
+    [[nodiscard]] auto find(std::string_view value) const noexcept -> std::optional<std::uint32_t>;
+    [[nodiscard]] auto view(std::uint32_t id) const noexcept -> std::string_view { return m_strings[id]; }
+    [[nodiscard]] auto size() const noexcept -> std::size_t { return m_strings.size(); }
+
+ private:
+    std::vector<std::unique_ptr<char[]>> m_blocks{};
+    std::size_t m_block_used{};
+    std::vector<std::string_view> m_strings{};
+    std::unordered_map<std::string_view, std::uint32_t> m_ids{};
+};
+
+/// @brief Dependency with interned name and version.
+struct DepEntry final {
+    std::uint32_t name{};
+    std::uint32_t version{};
+    DepMod mod{DepMod::Any};
+};
+
+/// @brief [first, first + count) in one of the flat entry vectors.
+struct EntryRange final {
+    std::uint32_t first{};
+    std::uint32_t count{};
+};
+
+struct PackageRecord final {
+    std::uint32_t repo{};
+    std::uint32_t name{};
+    std::uint32_t version{};
+    std::uint32_t filename{};
+    std::uint32_t sha256sum{};
+    std::uint64_t download_size{};
+    std::uint64_t install_size{};
+    EntryRange depends{};
+    EntryRange provides{};
+    EntryRange conflicts{};
+    EntryRange groups{};
+};
+
+}  // namespace detail
+
+/// @brief Packages of pacman sync databases, indexed by name, provides and group.
+///
+/// Repos are added in pacman.conf order, the first one carrying a package wins like in pacman.
+class SyncDatabase final {
+ public:
+    SyncDatabase() = default;
+
+    SyncDatabase(const SyncDatabase&)                    = delete;
+    SyncDatabase(SyncDatabase&&)                         = default;
+    auto operator=(const SyncDatabase&) -> SyncDatabase& = delete;
+    auto operator=(SyncDatabase&&) -> SyncDatabase&      = default;
+
+    /// @brief Loads `<sync_dir>/<repo>.db` for every repo, in priority order.
+    static auto load(std::string_view sync_dir, std::span<const std::string> repos) noexcept -> Result<SyncDatabase>;
+
+    /// @brief Adds the db file of @p repo, below the repos already loaded.
+    /// Plain tars are parsed from a read-only mapping, compressed ones through the system zstd/gzip/xz.
+    auto add_file(std::string_view repo, std::string_view db_path) noexcept -> Result<void>;
+
+    /// @brief Adds @p repo from the content of an uncompressed db tar.
+    auto add_tar(std::string_view repo, std::string_view tar_content) noexcept -> Result<void>;
+
+    [[nodiscard]] auto package_count() const noexcept -> std::size_t { return m_packages.size(); }
+    [[nodiscard]] auto repos() const noexcept -> const std::vector<std::string>& { return m_repos; }
+
+    /// @brief The package named @p name in the highest priority repo.
+    [[nodiscard]] auto find(std::string_view name) const noexcept -> std::optional<PackageInfo>;
+
+    /// @brief Dependency closure of @p targets, the way `pacman -S` would pick it.
+    ///
+    /// Targets are package names, `repo/name`, groups or anything provided by a package.
+    [[nodiscard]] auto resolve(std::span<const std::string> targets) const noexcept -> Resolution;
+
+ private:
+    detail::StringPool m_strings{};
+    std::vector<std::string> m_repos{};
+    std::vector<detail::PackageRecord> m_packages{};
+    std::vector<detail::DepEntry> m_entries{};
+    std::vector<std::uint32_t> m_group_entries{};
+    /// name -> packages in repo order
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> m_by_name{};
+    /// provided name -> packages in repo order
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> m_providers{};
+    /// group name -> packages in repo order
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> m_groups{};
+
+    [[nodiscard]] auto info_of(std::uint32_t package) const noexcept -> PackageInfo;
+    [[nodiscard]] auto entries_of(detail::EntryRange range) const noexcept -> std::span<const detail::DepEntry>;
+    [[nodiscard]] auto dep_to_string(const detail::DepEntry& dep) const noexcept -> std::string;
+};
+
+/// @brief A package dir of a sync db, `desc` the way repo-add wrote it.
+struct DbEntry final {
+    /// `<name>-<version>`
+    std::string dir{};
+    /// old dbs keep the dependencies in a separate `depends`, appended here
+    std::string desc{};
+};
+
+/// @brief Every package dir of the db file at @p db_path, compressed or not.
+auto read_db_entries(std::string_view db_path) noexcept -> Result<std::vector<DbEntry>>;
+
+/// @brief An uncompressed db tar holding @p entries, which pacman reads like repo-add's output.
+auto write_db_tar(std::span<const DbEntry> entries) noexcept -> std::string;
+
+/// @brief Repo names of @p conf_path in priority order, e.g {"cachyos", "core", "extra"}.
+auto repos_of_pacman_conf(std::string_view conf_path) noexcept -> std::vector<std::string>;
+
+}  // namespace gucc::syncdb
+
+#endif  // SYNC_DB_HPP
@@ -24,10 +24,19 @@ auto zfs_create_zvol(std::string_view zsize, std::string_view zpath) noexcept ->
 auto zfs_create_dataset(std::string_view zpath, std::string_view zmount) noexcept -> Result<void>;
 
 /// @brief Creates multiple ZFS datasets based on a list.
+///
+/// Datasets are created parents first with their properties, one `zfs create -p`
+/// each. Creation stops at the first dataset that fails.
 /// @param zdatasets A vector of ZfsDataset definitions.
-/// @return Empty result if all datasets were created successfully, an error otherwise.
+/// @return Empty result if all datasets were created successfully, an error naming
+///         the dataset that failed otherwise.
 auto zfs_create_datasets(const std::vector<ZfsDataset>& zdatasets) noexcept -> Result<void>;
 
+/// @brief Returns the properties tuning a dataset for @p role.
+/// @param role The workload of the dataset.
+/// @return Properties to put into ZfsDataset::properties, empty for ZfsDatasetRole::General.
+auto zfs_role_properties(ZfsDatasetRole role) noexcept -> std::vector<ZfsProperty>;
+
 /// @brief Destroys a ZFS dataset or volume.
 /// @param zdataset The ZFS path of the dataset/volume to destroy.
 /// @return Empty result on success, an error otherwise.
@@ -59,6 +68,8 @@ auto zfs_set_property(std::string_view property, std::string_view dataset) noexc
 auto zpool_set_property(std::string_view property, std::string_view pool_name) noexcept -> Result<void>;
 
 /// @brief Creates a zpool with the specified arguments.
+///
+/// The ashift is picked from the physical sector size unless @p pool_options set it.
 /// @param device_path The full path to the device to create on.
 /// @param pool_name The name of the pool.
 /// @param pool_options The options of the pool.
@@ -66,8 +77,18 @@ auto zpool_set_property(std::string_view property, std::string_view pool_name) n
 /// @return Empty result if the creation was successful, an error otherwise.
 auto zfs_create_zpool(std::string_view device_path, std::string_view pool_name, std::string_view pool_options, std::optional<std::string_view> passphrase = std::nullopt) noexcept -> Result<void>;
 
+/// @brief Creates a zpool over @p vdevs in a single `zpool create`.
+///
+/// The layout is checked with plan_zpool first, which also picks the ashift.
+/// @param vdevs The pool topology, see zfs_merge_root_device.
+/// @param pool_name The name of the pool.
+/// @param pool_options The options of the pool.
+/// @param passphrase The optional password for the pool, in case the password specified zpool is created with encryption.
+/// @return Empty result if the creation was successful, an error otherwise.
+auto zfs_create_zpool(const std::vector<ZfsVdev>& vdevs, std::string_view pool_name, std::string_view pool_options, std::optional<std::string_view> passphrase = std::nullopt) noexcept -> Result<void>;
+
 /// @brief Creates a ZFS pool and specified datasets from a configuration struct.
-/// @param device_path The full path to the device to create on.
+/// @param device_path The full path to the device to create on, it joins ZfsSetupConfig::vdevs.
 /// @param zfs_config Configuration containing pool details and datasets to create.
 /// @return Empty result if the pool and all datasets are created successfully, an error otherwise.
 auto zfs_create_with_config(std::string_view device_path, const fs::ZfsSetupConfig& zfs_config) noexcept -> Result<void>;
@@ -82,4 +103,16 @@ auto copy_hostid_to_target(std::string_view target_root, std::string_view host_h
 
 }  // namespace gucc::fs
 
+namespace gucc::fs::detail {
+
+/// @brief Orders @p zdatasets so that parents are created before their children.
+///
+/// The relative order of datasets at the same depth is kept.
+auto zfs_creation_order(const std::vector<ZfsDataset>& zdatasets) noexcept -> std::vector<const ZfsDataset*>;
+
+/// @brief Builds the `zfs create -p` invocation of a single dataset.
+auto zfs_create_cmd(const ZfsDataset& zdataset) noexcept -> std::string;
+
+}  // namespace gucc::fs::detail
+
 #endif  // ZFS_HPP
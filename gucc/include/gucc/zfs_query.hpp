@@ -101,6 +101,7 @@ auto get_zfs_dataset_info(std::string_view dataset_path) noexcept -> std::option
 
 /// @brief Checks if ZFS is available on the system
 /// @return True if zfs and zpool commands are available
+/// @note The PATH lookup is done once, later calls return the cached result
 auto is_zfs_available() noexcept -> bool;
 
 }  // namespace gucc::fs
@@ -118,6 +119,15 @@ auto split_tsv(std::string_view line) noexcept -> std::vector<std::string>;
 auto parse_dataset_fields(std::vector<std::string> fields) noexcept
     -> std::optional<ZfsDatasetInfo>;
 
+/// @brief Decode `zpool list -v -Hp -PL -o name,size,alloc,free,frag,cap,health,altroot` output.
+/// Pool rows start with the pool name, vdev rows with a tab.
+/// Only leaf devices (absolute paths) end up in ZfsPoolInfo::devices.
+auto parse_zpool_list(std::string_view output) noexcept -> std::vector<ZfsPoolInfo>;
+
+/// @brief Fill bootfs_set and version of @p pools from
+/// `zpool get -Hp -o name,property,value bootfs,version` output.
+void apply_zpool_properties(std::string_view output, std::vector<ZfsPoolInfo>& pools) noexcept;
+
 }  // namespace gucc::fs::zfs_query::detail
 
 #endif  // ZFS_QUERY_HPP
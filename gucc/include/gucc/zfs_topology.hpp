@@ -0,0 +1,67 @@
+#ifndef ZFS_TOPOLOGY_HPP
+#define ZFS_TOPOLOGY_HPP
+
+#include "gucc/error.hpp"
+#include "gucc/zfs_types.hpp"
+
+#include <cstdint>  // for uint32_t, uint64_t
+
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+namespace gucc::fs {
+
+/// @brief Size and sector size of a device going into a vdev.
+struct ZfsVdevMember final {
+    std::string device;
+    std::uint64_t size_bytes{};
+    std::uint32_t physical_block_size{512};
+};
+
+/// @brief Checked pool layout, ready for `zpool create`.
+struct ZpoolPlan final {
+    /// Covers the largest physical sector of all members
+    std::uint32_t ashift{12};
+    /// Usable bytes of the data vdevs, before ZFS overhead
+    std::uint64_t data_capacity{};
+    /// Layout is valid, but probably not what was intended
+    std::vector<std::string> warnings{};
+};
+
+/// @brief Reads size and physical sector size of @p device from sysfs.
+/// @param device The device path, symlinks (e.g /dev/disk/by-id) are resolved.
+auto query_zfs_vdev_member(std::string_view device) noexcept -> Result<ZfsVdevMember>;
+
+/// @brief Smallest ashift that covers @p physical_block_size, never below 12 (4K).
+auto zfs_ashift_for_block_size(std::uint32_t physical_block_size) noexcept -> std::uint32_t;
+
+/// @brief Validates @p vdevs against their @p members and picks the ashift.
+///
+/// Rejects layouts zpool would refuse or which are easy to lose data with, e.g
+/// a single special device next to mirrored data vdevs.
+/// @param vdevs The pool topology.
+/// @param members Size information of every device in @p vdevs.
+/// @return The plan, an error describing the first problem otherwise.
+auto plan_zpool(const std::vector<ZfsVdev>& vdevs, const std::vector<ZfsVdevMember>& members) noexcept -> Result<ZpoolPlan>;
+
+/// @brief Adds @p root_device to the first data vdev, unless @p vdevs already contain it.
+///
+/// Without a data vdev, @p root_device becomes one.
+auto zfs_merge_root_device(std::string_view root_device, std::vector<ZfsVdev> vdevs) noexcept -> std::vector<ZfsVdev>;
+
+}  // namespace gucc::fs
+
+namespace gucc::fs::detail {
+
+/// @brief Builds the vdev part of `zpool create`, data vdevs first then grouped by class.
+auto zpool_vdev_args(const std::vector<ZfsVdev>& vdevs) noexcept -> std::string;
+
+/// @brief Builds `zpool create` for the whole topology, without the passphrase.
+///
+/// `-o ashift=` is only added when @p pool_options doesn't set it already.
+auto zpool_create_cmd(std::string_view pool_name, std::string_view pool_options, const std::vector<ZfsVdev>& vdevs, std::uint32_t ashift, bool encrypted) noexcept -> std::string;
+
+}  // namespace gucc::fs::detail
+
+#endif  // ZFS_TOPOLOGY_HPP
@@ -1,15 +1,38 @@
 #ifndef ZFS_TYPES_HPP
 #define ZFS_TYPES_HPP
 
-#include <optional>  // for optional
-#include <string>    // for string
-#include <vector>    // for vector
+#include <cstdint>  // for uint8_t
+
+#include <optional>     // for optional
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
 
 #include <fmt/format.h>
 #include <fmt/ranges.h>
 
 namespace gucc::fs {
 
+/// @brief A ZFS property set with `-o name=value` when the dataset is created.
+struct ZfsProperty {
+    std::string name;
+    std::string value;
+};
+
+/// @brief Workloads which have a built-in property preset, see zfs_role_properties.
+enum class ZfsDatasetRole : std::uint8_t {
+    /// Inherits everything from the pool
+    General,
+    /// Small random I/O, e.g PostgreSQL or MariaDB data directories
+    Database,
+    /// Disk images of virtual machines
+    VmImages,
+    /// Append-only text, e.g /var/log
+    Logs,
+    /// Large files which can be refetched, e.g /var/cache
+    Cache,
+};
+
 /// @brief Represents a single ZFS dataset, defining its ZFS path and mount point.
 struct ZfsDataset {
     /// @brief The ZFS path for the dataset (e.g., "poolname/datasetname", "poolname/parent/child").
@@ -19,8 +42,55 @@ struct ZfsDataset {
 
     /// @brief The desired filesystem mount point for this dataset (e.g., "/", "/home").
     std::string mountpoint;
+
+    /// @brief Properties applied on creation, in addition to the mountpoint.
+    ///
+    /// Anything not listed is inherited from the parent dataset.
+    std::vector<ZfsProperty> properties{};
+};
+
+/// @brief Redundancy of a top-level vdev.
+enum class ZfsVdevType : std::uint8_t {
+    /// Every device is its own top-level vdev
+    Stripe,
+    Mirror,
+    Raidz1,
+    Raidz2,
+    Raidz3,
+};
+
+/// @brief Allocation class of a top-level vdev.
+enum class ZfsVdevClass : std::uint8_t {
+    /// Regular pool storage
+    Data,
+    /// Metadata and small blocks
+    Special,
+    /// Separate intent log (SLOG)
+    Log,
+    /// L2ARC, cache devices are always striped
+    Cache,
+};
+
+/// @brief A top-level vdev of a pool, e.g a mirror of two disks used as special vdev.
+struct ZfsVdev {
+    ZfsVdevClass vdev_class{ZfsVdevClass::Data};
+    ZfsVdevType type{ZfsVdevType::Stripe};
+    /// @brief Member device paths (e.g., "/dev/disk/by-id/nvme-...-part2").
+    std::vector<std::string> devices{};
 };
 
+/// @brief Returns the zpool keyword of the vdev type, "stripe" for ZfsVdevType::Stripe.
+auto zfs_vdev_type_to_string(ZfsVdevType type) noexcept -> std::string_view;
+
+/// @brief Parses a vdev type name (e.g., "mirror", "raidz2").
+auto string_to_zfs_vdev_type(std::string_view type_name) noexcept -> std::optional<ZfsVdevType>;
+
+/// @brief Returns the zpool keyword of the vdev class, "data" for ZfsVdevClass::Data.
+auto zfs_vdev_class_to_string(ZfsVdevClass vdev_class) noexcept -> std::string_view;
+
+/// @brief Parses a vdev class name (e.g., "special", "log").
+auto string_to_zfs_vdev_class(std::string_view class_name) noexcept -> std::optional<ZfsVdevClass>;
+
 /// @brief Configuration structure for setting up a ZFS pool and its initial datasets.
 ///
 /// @note This struct aggregates all the necessary parameters required by the
@@ -41,17 +111,42 @@ struct ZfsSetupConfig {
     /// @brief A list of ZFS datasets to create within the pool immediately after
     /// the pool itself is created.
     std::vector<ZfsDataset> datasets;
+
+    /// @brief Additional vdevs of the pool.
+    ///
+    /// The device passed to zfs_create_with_config joins the first data vdev,
+    /// unless it is listed already. Empty means a pool on that device only.
+    std::vector<ZfsVdev> vdevs{};
 };
 
 }  // namespace gucc::fs
 
+template <>
+struct fmt::formatter<gucc::fs::ZfsProperty> : fmt::formatter<std::string> {
+    // parse is inherited from fmt::formatter<std::string>.
+    template <typename FormatContext>
+    auto format(const gucc::fs::ZfsProperty& c, FormatContext& ctx) const -> decltype(ctx.out()) {
+        return fmt::format_to(ctx.out(), "{}={}", c.name, c.value);
+    }
+};
+
 template <>
 struct fmt::formatter<gucc::fs::ZfsDataset> : fmt::formatter<std::string> {
     // parse is inherited from fmt::formatter<std::string>.
     template <typename FormatContext>
     auto format(const gucc::fs::ZfsDataset& c, FormatContext& ctx) const -> decltype(ctx.out()) {
-        return fmt::format_to(ctx.out(), "(zpath:'{}', mountpoint:'{}')",
-            c.zpath, c.mountpoint);
+        return fmt::format_to(ctx.out(), "(zpath:'{}', mountpoint:'{}', properties:{})",
+            c.zpath, c.mountpoint, c.properties);
+    }
+};
+
+template <>
+struct fmt::formatter<gucc::fs::ZfsVdev> : fmt::formatter<std::string> {
+    // parse is inherited from fmt::formatter<std::string>.
+    template <typename FormatContext>
+    auto format(const gucc::fs::ZfsVdev& c, FormatContext& ctx) const -> decltype(ctx.out()) {
+        return fmt::format_to(ctx.out(), "(class:{}, type:{}, devices:{})",
+            gucc::fs::zfs_vdev_class_to_string(c.vdev_class), gucc::fs::zfs_vdev_type_to_string(c.type), c.devices);
     }
 };
 
@@ -60,8 +155,8 @@ struct fmt::formatter<gucc::fs::ZfsSetupConfig> : fmt::formatter<std::string> {
     // parse is inherited from fmt::formatter<std::string>.
     template <typename FormatContext>
     auto format(const gucc::fs::ZfsSetupConfig& c, FormatContext& ctx) const -> decltype(ctx.out()) {
-        return fmt::format_to(ctx.out(), "(zpool_name:'{}', zpool_options:'{}', datasets:{})",
-            c.zpool_name, c.zpool_options, c.datasets);
+        return fmt::format_to(ctx.out(), "(zpool_name:'{}', zpool_options:'{}', datasets:{}, vdevs:{})",
+            c.zpool_name, c.zpool_options, c.datasets, c.vdevs);
     }
 };
 
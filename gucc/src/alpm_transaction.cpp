@@ -0,0 +1,573 @@
+#include "gucc/alpm_transaction.hpp"
+#include "gucc/file_utils.hpp"
+#include "gucc/mirrors.hpp"
+#include "gucc/process.hpp"
+#include "gucc/string_utils.hpp"
+
+#include <sys/utsname.h>  // for uname
+
+#include <charconv>    // for from_chars
+#include <filesystem>  // for exists, create_directories
+#include <mutex>       // for mutex, lock_guard
+#include <optional>    // for optional
+#include <utility>     // for move, pair
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include <spdlog/spdlog.h>
+
+#ifdef GUCC_HAVE_ALPM
+#include <sys/mount.h>  // for mount, umount2
+
+#include <array>          // for array
+#include <cstdlib>        // for free
+#include <cstring>        // for strerror
+#include <unordered_map>  // for unordered_map
+
+#include <alpm.h>
+#include <alpm_list.h>
+#endif
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+std::mutex s_sink_mutex;
+gucc::alpm::EventSink s_sink{};
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+
+void emit_event(const gucc::alpm::TransactionEvent& event) noexcept {
+    const std::lock_guard<std::mutex> lock(s_sink_mutex);
+    if (s_sink) {
+        s_sink(event);
+    }
+}
+
+auto host_arch() noexcept -> std::string {
+    struct utsname un{};
+    if (::uname(&un) != 0) {
+        return "x86_64";
+    }
+    return un.machine;
+}
+
+// pacman.conf values are separated by any amount of spaces
+void append_words(std::vector<std::string>& words, std::string_view value) noexcept {
+    for (auto&& word : gucc::utils::make_split_view(value, ' ')) {
+        const auto& trimmed = gucc::utils::trim(word);
+        if (!trimmed.empty()) {
+            words.emplace_back(trimmed);
+        }
+    }
+}
+
+#ifdef GUCC_HAVE_ALPM
+
+auto alpm_error(alpm_handle_t* handle, std::string_view what) noexcept -> gucc::Error {
+    return gucc::Error{gucc::ErrorCode::Unknown, fmt::format(FMT_COMPILE("{}: {}"), what, alpm_strerror(alpm_errno(handle)))};
+}
+
+/// SigLevel words as pacman's process_siglevel reads them, @p base is the level they refine.
+auto to_siglevel(const std::vector<std::string>& words, int base) noexcept -> int {
+    int level = base;
+    for (std::string_view word : words) {
+        bool package{true};
+        bool database{true};
+        if (word.starts_with("Package"sv)) {
+            database = false;
+            word.remove_prefix("Package"sv.size());
+        } else if (word.starts_with("Database"sv)) {
+            package = false;
+            word.remove_prefix("Database"sv.size());
+        }
+
+        int set{};
+        int unset{};
+        if (word == "Never"sv) {
+            unset = ALPM_SIG_PACKAGE | ALPM_SIG_DATABASE;
+        } else if (word == "Optional"sv) {
+            set = ALPM_SIG_PACKAGE | ALPM_SIG_PACKAGE_OPTIONAL | ALPM_SIG_DATABASE | ALPM_SIG_DATABASE_OPTIONAL;
+        } else if (word == "Required"sv) {
+            set   = ALPM_SIG_PACKAGE | ALPM_SIG_DATABASE;
+            unset = ALPM_SIG_PACKAGE_OPTIONAL | ALPM_SIG_DATABASE_OPTIONAL;
+        } else if (word == "TrustedOnly"sv) {
+            unset = ALPM_SIG_PACKAGE_MARGINAL_OK | ALPM_SIG_PACKAGE_UNKNOWN_OK | ALPM_SIG_DATABASE_MARGINAL_OK | ALPM_SIG_DATABASE_UNKNOWN_OK;
+        } else if (word == "TrustAll"sv) {
+            set = ALPM_SIG_PACKAGE_MARGINAL_OK | ALPM_SIG_PACKAGE_UNKNOWN_OK | ALPM_SIG_DATABASE_MARGINAL_OK | ALPM_SIG_DATABASE_UNKNOWN_OK;
+        } else {
+            spdlog::warn("[alpm] ignoring unknown SigLevel '{}'", word);
+            continue;
+        }
+
+        constexpr int package_bits  = ALPM_SIG_PACKAGE | ALPM_SIG_PACKAGE_OPTIONAL | ALPM_SIG_PACKAGE_MARGINAL_OK | ALPM_SIG_PACKAGE_UNKNOWN_OK;
+        constexpr int database_bits = ALPM_SIG_DATABASE | ALPM_SIG_DATABASE_OPTIONAL | ALPM_SIG_DATABASE_MARGINAL_OK | ALPM_SIG_DATABASE_UNKNOWN_OK;
+        const int mask              = (package ? package_bits : 0) | (database ? database_bits : 0);
+        level                       = (level | (set & mask)) & ~(unset & mask);
+    }
+    return level;
+}
+
+/// Byte and package counters of the running transaction, handed to the callbacks as their ctx.
+struct CallbackState final {
+    std::unordered_map<std::string, std::uint64_t> file_bytes{};
+    std::uint64_t downloaded{};
+    std::uint64_t download_total{};
+};
+
+void on_download(void* ctx, const char* filename, alpm_download_event_type_t type, void* data) {
+    auto* state = static_cast<CallbackState*>(ctx);
+    if (type != ALPM_DOWNLOAD_PROGRESS && type != ALPM_DOWNLOAD_COMPLETED) {
+        return;
+    }
+    const auto bytes = (type == ALPM_DOWNLOAD_PROGRESS)
+        ? static_cast<std::uint64_t>(static_cast<alpm_download_event_progress_t*>(data)->downloaded)
+        : static_cast<std::uint64_t>(static_cast<alpm_download_event_completed_t*>(data)->total);
+
+    // progress is per file, the event carries the sum over the transaction
+    auto& last = state->file_bytes[filename];
+    if (bytes > last) {
+        state->downloaded += bytes - last;
+        last = bytes;
+    }
+    emit_event({.kind = gucc::alpm::EventKind::Download, .name = filename, .done = state->downloaded, .total = state->download_total});
+}
+
+void on_progress(void* /*ctx*/, alpm_progress_t progress, const char* pkg, int percent, std::size_t howmany, std::size_t current) {
+    // one event per package, once it is done
+    if (progress != ALPM_PROGRESS_ADD_START || percent != 100) {
+        return;
+    }
+    emit_event({.kind = gucc::alpm::EventKind::Install, .name = (pkg != nullptr) ? pkg : "", .done = current, .total = howmany});
+}
+
+void on_event(void* ctx, alpm_event_t* event) {
+    auto* state = static_cast<CallbackState*>(ctx);
+    switch (event->type) {
+    case ALPM_EVENT_PKG_RETRIEVE_START:
+        // the repo dbs came before, only the packages count
+        state->file_bytes.clear();
+        state->downloaded     = 0;
+        state->download_total = static_cast<std::uint64_t>(event->pkg_retrieve.total_size);
+        break;
+    case ALPM_EVENT_HOOK_RUN_START: {
+        const auto& hook = event->hook_run;
+        emit_event({.kind = gucc::alpm::EventKind::Hook, .name = (hook.desc != nullptr) ? hook.desc : hook.name, .done = hook.position, .total = hook.total});
+        break;
+    }
+    case ALPM_EVENT_SCRIPTLET_INFO:
+        spdlog::info("{}", gucc::utils::rtrim(event->scriptlet_info.line));
+        break;
+    default:
+        break;
+    }
+}
+
+// the answers `pacman --noconfirm` gives, which is what pacstrap runs with
+void on_question(void* /*ctx*/, alpm_question_t* question) {
+    switch (question->type) {
+    case ALPM_QUESTION_INSTALL_IGNOREPKG:
+        question->install_ignorepkg.install = 1;
+        break;
+    case ALPM_QUESTION_REPLACE_PKG:
+        question->replace.replace = 1;
+        break;
+    case ALPM_QUESTION_CONFLICT_PKG:
+        question->conflict.remove = 0;
+        break;
+    case ALPM_QUESTION_CORRUPTED_PKG:
+        question->corrupted.remove = 1;
+        break;
+    case ALPM_QUESTION_REMOVE_PKGS:
+        question->remove_pkgs.skip = 0;
+        break;
+    case ALPM_QUESTION_SELECT_PROVIDER:
+        question->select_provider.use_index = 0;
+        break;
+    case ALPM_QUESTION_IMPORT_KEY:
+        question->import_key.import = 1;
+        break;
+    default:
+        break;
+    }
+}
+
+/// proc, sys, dev and run below the target while scriptlets and hooks run, like pacstrap's chroot_setup.
+class ApiMounts final {
+ public:
+    explicit ApiMounts(std::string_view mountpoint) noexcept {
+        struct ApiMount final {
+            const char* source;
+            std::string_view target;
+            const char* fstype;
+            unsigned long flags;
+            const char* data;
+        };
+        static constexpr std::array kMounts{
+            ApiMount{"proc", "proc"sv, "proc", MS_NOSUID | MS_NOEXEC | MS_NODEV, nullptr},
+            ApiMount{"sys", "sys"sv, "sysfs", MS_NOSUID | MS_NOEXEC | MS_NODEV | MS_RDONLY, nullptr},
+            ApiMount{"udev", "dev"sv, "devtmpfs", MS_NOSUID, "mode=0755"},
+            ApiMount{"devpts", "dev/pts"sv, "devpts", MS_NOSUID | MS_NOEXEC, "mode=0620,gid=5"},
+            ApiMount{"shm", "dev/shm"sv, "tmpfs", MS_NOSUID | MS_NODEV, "mode=1777"},
+            ApiMount{"run", "run"sv, "tmpfs", MS_NOSUID | MS_NODEV, "mode=0755"},
+            ApiMount{"tmp", "tmp"sv, "tmpfs", MS_STRICTATIME | MS_NODEV | MS_NOSUID, "mode=1777"},
+        };
+        for (const auto& api : kMounts) {
+            auto target = fmt::format(FMT_COMPILE("{}/{}"), mountpoint, api.target);
+            std::error_code ec{};
+            fs::create_directories(target, ec);
+            if (::mount(api.source, target.c_str(), api.fstype, api.flags, api.data) != 0) {
+                spdlog::warn("[alpm] failed to mount {} on '{}': {}", api.fstype, target, std::strerror(errno));
+                continue;
+            }
+            m_targets.emplace_back(std::move(target));
+        }
+    }
+
+    ApiMounts(const ApiMounts&)                    = delete;
+    ApiMounts(ApiMounts&&)                         = delete;
+    auto operator=(const ApiMounts&) -> ApiMounts& = delete;
+    auto operator=(ApiMounts&&) -> ApiMounts&      = delete;
+
+    ~ApiMounts() {
+        for (auto it = m_targets.rbegin(); it != m_targets.rend(); ++it) {
+            if (::umount2(it->c_str(), MNT_DETACH) != 0) {
+                spdlog::warn("[alpm] failed to unmount '{}': {}", *it, std::strerror(errno));
+            }
+        }
+    }
+
+ private:
+    std::vector<std::string> m_targets{};
+};
+
+/// Releases the handle, and the transaction with it, on every path out.
+struct HandleGuard final {
+    alpm_handle_t* handle{};
+    bool in_transaction{false};
+
+    explicit HandleGuard(alpm_handle_t* alpm_handle) noexcept : handle(alpm_handle) { }
+
+    HandleGuard(const HandleGuard&)                    = delete;
+    HandleGuard(HandleGuard&&)                         = delete;
+    auto operator=(const HandleGuard&) -> HandleGuard& = delete;
+    auto operator=(HandleGuard&&) -> HandleGuard&      = delete;
+
+    ~HandleGuard() {
+        if (in_transaction) {
+            alpm_trans_release(handle);
+        }
+        alpm_release(handle);
+    }
+};
+
+/// `repo/name`, a package name, something provided by a package or a group, in the order pacman -S tries them.
+auto add_target(alpm_handle_t* handle, std::string_view target) noexcept -> gucc::Result<void> {
+    alpm_list_t* syncdbs = alpm_get_syncdbs(handle);
+    const std::string target_str{target};
+
+    std::vector<alpm_pkg_t*> pkgs{};
+    if (const auto slash = target.find('/'); slash != std::string_view::npos) {
+        const auto repo = target.substr(0, slash);
+        for (auto* it = syncdbs; it != nullptr; it = it->next) {
+            auto* db = static_cast<alpm_db_t*>(it->data);
+            if (repo == alpm_db_get_name(db)) {
+                if (auto* pkg = alpm_db_get_pkg(db, target_str.c_str() + slash + 1); pkg != nullptr) {
+                    pkgs.push_back(pkg);
+                }
+                break;
+            }
+        }
+    } else if (auto* pkg = alpm_find_dbs_satisfier(handle, syncdbs, target_str.c_str()); pkg != nullptr) {
+        pkgs.push_back(pkg);
+    } else {
+        alpm_list_t* group = alpm_find_group_pkgs(syncdbs, target_str.c_str());
+        for (auto* it = group; it != nullptr; it = it->next) {
+            pkgs.push_back(static_cast<alpm_pkg_t*>(it->data));
+        }
+        alpm_list_free(group);
+    }
+    if (pkgs.empty()) {
+        return gucc::make_error(gucc::ErrorCode::NotFound, fmt::format(FMT_COMPILE("target not found: {}"), target));
+    }
+
+    for (auto* pkg : pkgs) {
+        // the same package asked for twice, e.g through a group
+        if (alpm_add_pkg(handle, pkg) != 0 && alpm_errno(handle) != ALPM_ERR_TRANS_DUP_TARGET) {
+            return std::unexpected(alpm_error(handle, fmt::format(FMT_COMPILE("failed to add '{}'"), alpm_pkg_get_name(pkg))));
+        }
+    }
+    return {};
+}
+
+/// Logs what alpm_trans_prepare/commit left in @p data and frees it.
+void report_failure(alpm_handle_t* handle, alpm_list_t* data) noexcept {
+    const auto err = alpm_errno(handle);
+    for (auto* it = data; it != nullptr; it = it->next) {
+        switch (err) {
+        case ALPM_ERR_UNSATISFIED_DEPS: {
+            auto* miss        = static_cast<alpm_depmissing_t*>(it->data);
+            char* dep_string  = alpm_dep_compute_string(miss->depend);
+            spdlog::error("[alpm] unable to satisfy '{}' required by {}", dep_string, miss->target);
+            std::free(dep_string);  // NOLINT(cppcoreguidelines-no-malloc)
+            alpm_depmissing_free(miss);
+            break;
+        }
+        case ALPM_ERR_CONFLICTING_DEPS: {
+            auto* conflict = static_cast<alpm_conflict_t*>(it->data);
+            spdlog::error("[alpm] {} and {} are in conflict", alpm_pkg_get_name(conflict->package1), alpm_pkg_get_name(conflict->package2));
+            alpm_conflict_free(conflict);
+            break;
+        }
+        case ALPM_ERR_FILE_CONFLICTS: {
+            auto* conflict = static_cast<alpm_fileconflict_t*>(it->data);
+            spdlog::error("[alpm] {}: '{}' already exists", conflict->target, conflict->file);
+            alpm_fileconflict_free(conflict);
+            break;
+        }
+        case ALPM_ERR_PKG_INVALID:
+        case ALPM_ERR_PKG_INVALID_CHECKSUM:
+        case ALPM_ERR_PKG_INVALID_SIG:
+            spdlog::error("[alpm] '{}' is invalid or corrupted", static_cast<const char*>(it->data));
+            std::free(it->data);  // NOLINT(cppcoreguidelines-no-malloc)
+            break;
+        default:
+            break;
+        }
+    }
+    alpm_list_free(data);
+}
+
+#endif
+
+}  // namespace
+
+namespace gucc::alpm {
+
+void set_event_sink(EventSink sink) noexcept {
+    const std::lock_guard<std::mutex> lock(s_sink_mutex);
+    s_sink = std::move(sink);
+}
+
+#ifdef GUCC_HAVE_ALPM
+
+auto available() noexcept -> bool {
+    return true;
+}
+
+auto install_packages(const TransactionConfig& config) noexcept -> Result<void> {
+    if (config.mountpoint.empty() || config.packages.empty()) {
+        return make_error(ErrorCode::InvalidArgument, "mountpoint and packages must not be empty"s);
+    }
+    const auto& conf_content = file_utils::read_whole_file(config.pacman_config);
+    if (conf_content.empty()) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to read '{}'"), config.pacman_config));
+    }
+    const auto& [options, repos] = detail::parse_pacman_conf(conf_content, host_arch());
+    if (repos.empty()) {
+        return make_error(ErrorCode::ParseError, fmt::format(FMT_COMPILE("'{}' lists no repos"), config.pacman_config));
+    }
+    // pacstrap is a Mutate process, skipped the same way
+    if (utils::default_runner().dry_run()) {
+        spdlog::info("[dry-run] would install {} packages into '{}' through libalpm", config.packages.size(), config.mountpoint);
+        return {};
+    }
+
+    auto cache_dirs = config.cache_dirs.empty() ? options.cache_dirs : config.cache_dirs;
+    if (cache_dirs.empty()) {
+        cache_dirs.emplace_back("/var/cache/pacman/pkg"sv);
+    }
+    const auto& db_path = fmt::format(FMT_COMPILE("{}/var/lib/pacman"), config.mountpoint);
+    const auto& log_dir = fmt::format(FMT_COMPILE("{}/var/log"), config.mountpoint);
+    for (const auto& dir : {db_path, cache_dirs.front(), log_dir}) {
+        std::error_code ec{};
+        fs::create_directories(dir, ec);
+        if (ec) {
+            return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to create '{}': {}"), dir, ec.message()));
+        }
+    }
+
+    const std::string root{config.mountpoint};
+    alpm_errno_t init_err{};
+    alpm_handle_t* handle = alpm_initialize(root.c_str(), db_path.c_str(), &init_err);
+    if (handle == nullptr) {
+        return make_error(ErrorCode::Unknown, fmt::format(FMT_COMPILE("failed to initialize libalpm on '{}': {}"), root, alpm_strerror(init_err)));
+    }
+    HandleGuard guard{handle};
+
+    CallbackState state{};
+    alpm_option_set_dlcb(handle, on_download, &state);
+    alpm_option_set_progresscb(handle, on_progress, &state);
+    alpm_option_set_eventcb(handle, on_event, &state);
+    alpm_option_set_questioncb(handle, on_question, &state);
+
+    const std::string gpg_dir{config.gpg_dir};
+    const auto& log_file  = fmt::format(FMT_COMPILE("{}/pacman.log"), log_dir);
+    const auto& hooks_dir = fmt::format(FMT_COMPILE("{}/etc/pacman.d/hooks"), config.mountpoint);
+    for (const auto& dir : cache_dirs) {
+        alpm_option_add_cachedir(handle, dir.c_str());
+    }
+    alpm_option_set_gpgdir(handle, gpg_dir.c_str());
+    alpm_option_set_logfile(handle, log_file.c_str());
+    alpm_option_set_parallel_downloads(handle, options.parallel_downloads);
+    for (const auto& arch : options.architectures) {
+        alpm_option_add_architecture(handle, arch.c_str());
+    }
+    if (config.run_hooks) {
+        alpm_option_add_hookdir(handle, hooks_dir.c_str());
+    } else {
+        alpm_option_set_hookdirs(handle, nullptr);
+    }
+
+    // pacman's defaults, before the config refines them
+    const int default_level = to_siglevel(options.sig_level, ALPM_SIG_PACKAGE | ALPM_SIG_PACKAGE_OPTIONAL | ALPM_SIG_DATABASE | ALPM_SIG_DATABASE_OPTIONAL);
+    alpm_option_set_default_siglevel(handle, default_level);
+    alpm_option_set_local_file_siglevel(handle, to_siglevel(options.local_file_sig_level, default_level));
+    alpm_option_set_remote_file_siglevel(handle, to_siglevel(options.remote_file_sig_level, default_level));
+
+    for (const auto& repo : repos) {
+        const int level = repo.sig_level.empty() ? ALPM_SIG_USE_DEFAULT : to_siglevel(repo.sig_level, default_level);
+        alpm_db_t* db   = alpm_register_syncdb(handle, repo.name.c_str(), level);
+        if (db == nullptr) {
+            return std::unexpected(alpm_error(handle, fmt::format(FMT_COMPILE("failed to register [{}]"), repo.name)));
+        }
+        for (const auto& server : repo.servers) {
+            alpm_db_add_server(db, server.c_str());
+        }
+    }
+
+    spdlog::info("[alpm] synchronizing {} repos into '{}'", repos.size(), db_path);
+    if (alpm_db_update(handle, alpm_get_syncdbs(handle), 0) < 0) {
+        return std::unexpected(alpm_error(handle, "failed to synchronize the repos"sv));
+    }
+
+    if (alpm_trans_init(handle, 0) != 0) {
+        return std::unexpected(alpm_error(handle, "failed to start the transaction"sv));
+    }
+    guard.in_transaction = true;
+    for (const auto& target : config.packages) {
+        if (auto res = add_target(handle, target); !res) {
+            return res;
+        }
+    }
+
+    alpm_list_t* data{};
+    if (alpm_trans_prepare(handle, &data) != 0) {
+        auto error = alpm_error(handle, "failed to prepare the transaction"sv);
+        report_failure(handle, data);
+        return std::unexpected(std::move(error));
+    }
+
+    spdlog::info("[alpm] installing {} packages into '{}'", alpm_list_count(alpm_trans_get_add(handle)), root);
+    std::optional<ApiMounts> api_mounts{};
+    if (config.mount_api_filesystems) {
+        api_mounts.emplace(config.mountpoint);
+    }
+    if (alpm_trans_commit(handle, &data) != 0) {
+        auto error = alpm_error(handle, "failed to commit the transaction"sv);
+        report_failure(handle, data);
+        return std::unexpected(std::move(error));
+    }
+    return {};
+}
+
+#else
+
+auto available() noexcept -> bool {
+    return false;
+}
+
+auto install_packages(const TransactionConfig& /*config*/) noexcept -> Result<void> {
+    return make_error(ErrorCode::Unsupported, "gucc was built without libalpm"s);
+}
+
+#endif
+
+}  // namespace gucc::alpm
+
+namespace gucc::alpm::detail {
+
+auto parse_pacman_conf(std::string_view content, std::string_view machine_arch) noexcept -> std::pair<PacmanOptions, std::vector<RepoSection>> {
+    PacmanOptions options{};
+    std::vector<RepoSection> repos{};
+    bool in_options{false};
+    // servers keep their variables until the architecture is known, [options] may come last
+    for (auto&& line : utils::make_split_view(content)) {
+        const auto& trimmed = utils::trim(line);
+        if (trimmed.empty() || trimmed.starts_with('#')) {
+            continue;
+        }
+        if (trimmed.starts_with('[') && trimmed.ends_with(']')) {
+            const auto& section = trimmed.substr(1, trimmed.size() - 2);
+            in_options          = (section == "options"sv);
+            if (!in_options) {
+                repos.emplace_back(RepoSection{.name = std::string{section}});
+            }
+            continue;
+        }
+        const auto eq_pos = trimmed.find('=');
+        if (eq_pos == std::string_view::npos || (!in_options && repos.empty())) {
+            continue;
+        }
+        const auto& key   = utils::trim(trimmed.substr(0, eq_pos));
+        const auto& value = utils::trim(trimmed.substr(eq_pos + 1));
+
+        if (in_options) {
+            if (key == "Architecture"sv) {
+                append_words(options.architectures, value);
+            } else if (key == "ParallelDownloads"sv) {
+                std::uint32_t parallel{};
+                const auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), parallel);
+                if (ec == std::errc{} && parallel > 0) {
+                    options.parallel_downloads = parallel;
+                }
+            } else if (key == "CacheDir"sv) {
+                append_words(options.cache_dirs, value);
+            } else if (key == "SigLevel"sv) {
+                append_words(options.sig_level, value);
+            } else if (key == "LocalFileSigLevel"sv) {
+                append_words(options.local_file_sig_level, value);
+            } else if (key == "RemoteFileSigLevel"sv) {
+                append_words(options.remote_file_sig_level, value);
+            }
+            continue;
+        }
+
+        auto& repo = repos.back();
+        if (key == "Server"sv) {
+            repo.servers.emplace_back(value);
+        } else if (key == "SigLevel"sv) {
+            append_words(repo.sig_level, value);
+        } else if (key == "Include"sv) {
+            const std::string include_path{value};
+            std::error_code ec;
+            if (!fs::exists(include_path, ec)) {
+                spdlog::warn("'{}' included by [{}] doesn't exist", include_path, repo.name);
+                continue;
+            }
+            for (auto&& server : mirrors::parse_mirrorlist(file_utils::read_whole_file(include_path))) {
+                repo.servers.emplace_back(std::move(server));
+            }
+        }
+    }
+
+    if (options.architectures.empty()) {
+        options.architectures.emplace_back("auto"sv);
+    }
+    for (auto& arch : options.architectures) {
+        if (arch == "auto"sv) {
+            arch = machine_arch;
+        }
+    }
+    for (auto& repo : repos) {
+        for (auto& server : repo.servers) {
+            server = mirrors::server_url(server, repo.name, options.architectures.front());
+        }
+    }
+    return {std::move(options), std::move(repos)};
+}
+
+}  // namespace gucc::alpm::detail
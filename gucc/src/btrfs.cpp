@@ -1,18 +1,32 @@
 #include "gucc/btrfs.hpp"
 #include "gucc/io_utils.hpp"
+#include "gucc/local_db.hpp"
 #include "gucc/partition.hpp"
 #include "gucc/process.hpp"
 #include "gucc/string_utils.hpp"
 
-#include <algorithm>   // for find_if
+#include <fcntl.h>         // for open, O_*, AT_FDCWD
+#include <linux/btrfs.h>   // for BTRFS_IOC_SUBVOL_CREATE, btrfs_ioctl_vol_args
+#include <linux/fs.h>      // for FS_IOC_GETFLAGS, FS_IOC_SETFLAGS, FS_NOCOW_FL
+#include <sys/ioctl.h>     // for ioctl
+#include <sys/mount.h>     // for fsopen, fsconfig, fsmount, move_mount, open_tree, mount_setattr, umount2
+#include <sys/xattr.h>     // for fsetxattr
+#include <unistd.h>        // for close, read, rmdir
+
+#include <algorithm>   // for find_if, stable_sort, count, copy
+#include <array>       // for array
+#include <cerrno>      // for errno
+#include <cstdlib>     // for mkdtemp
+#include <cstring>     // for strerror
 #include <filesystem>  // for create_directories
 #include <fstream>     // for ofstream
 #include <optional>    // for optional
 #include <ranges>      // for ranges::*
-#include <utility>     // for make_optional
+#include <utility>     // for make_optional, move
 
 #include <fmt/compile.h>
 #include <fmt/format.h>
+#include <fmt/ranges.h>
 
 #include <spdlog/spdlog.h>
 
@@ -21,6 +35,13 @@ using namespace std::string_view_literals;
 
 namespace {
 
+// values the btrfs.compression property takes
+constexpr std::array kBtrfsCompressions{"zstd"sv, "lzo"sv, "zlib"sv, "none"sv};
+
+// per mount flags split_mount_options knows about, cleared unless a subvolume sets them
+constexpr std::uint64_t kKnownMountAttrs = MOUNT_ATTR_RDONLY | MOUNT_ATTR_NOSUID | MOUNT_ATTR_NODEV | MOUNT_ATTR_NOEXEC
+    | MOUNT_ATTR_NODIRATIME | MOUNT_ATTR_NOSYMFOLLOW;
+
 // same behaviour as os.path.dirname from python
 constexpr auto get_dirname(std::string_view full_path) noexcept -> std::string_view {
     if (full_path == "/"sv) {
@@ -33,6 +54,213 @@ constexpr auto get_dirname(std::string_view full_path) noexcept -> std::string_v
     return full_path.substr(0, pos);
 }
 
+constexpr auto get_basename(std::string_view full_path) noexcept -> std::string_view {
+    const auto pos = full_path.find_last_of('/');
+    return (pos == std::string_view::npos) ? full_path : full_path.substr(pos + 1);
+}
+
+// mountpoints in the installed system, "/" is the outermost
+constexpr auto mountpoint_depth(std::string_view mountpoint) noexcept -> std::size_t {
+    if (mountpoint == "/"sv) {
+        return 0;
+    }
+    return static_cast<std::size_t>(std::ranges::count(mountpoint, '/'));
+}
+
+constexpr auto is_nested_in(std::string_view mountpoint, std::string_view parent) noexcept -> bool {
+    if (parent == "/"sv) {
+        return mountpoint != parent;
+    }
+    return mountpoint.starts_with(parent) && mountpoint.size() > parent.size() && mountpoint[parent.size()] == '/';
+}
+
+auto errno_to_code(int err) noexcept -> gucc::ErrorCode {
+    switch (err) {
+    case EPERM:
+    case EACCES:
+        return gucc::ErrorCode::PermissionDenied;
+    case ENOENT:
+        return gucc::ErrorCode::NotFound;
+    case ENOSYS:
+        return gucc::ErrorCode::Unsupported;
+    default:
+        return gucc::ErrorCode::FileIo;
+    }
+}
+
+class ScopedFd final {
+ public:
+    explicit ScopedFd(int fd) noexcept : m_fd(fd) { }
+    ~ScopedFd() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+
+    ScopedFd(const ScopedFd&)                    = delete;
+    auto operator=(const ScopedFd&) -> ScopedFd& = delete;
+    ScopedFd(ScopedFd&&)                         = delete;
+    auto operator=(ScopedFd&&) -> ScopedFd&      = delete;
+
+    [[nodiscard]] auto get() const noexcept -> int { return m_fd; }
+    [[nodiscard]] auto valid() const noexcept -> bool { return m_fd >= 0; }
+
+ private:
+    int m_fd{-1};
+};
+
+// Private directory the btrfs top level is parked on while the subvolumes are cloned from it.
+// Detached and removed on every way out, rmdir is tried even when the detach fails.
+class StagingDir final {
+ public:
+    StagingDir() noexcept {
+        if (::mkdtemp(m_path.data()) == nullptr) {
+            m_path.clear();
+        }
+    }
+    ~StagingDir() {
+        if (m_path.empty()) {
+            return;
+        }
+        if (m_mounted && ::umount2(m_path.c_str(), MNT_DETACH) != 0) {
+            spdlog::warn("Failed to detach btrfs staging mount {}: {}", m_path, std::strerror(errno));
+        }
+        if (::rmdir(m_path.c_str()) != 0) {
+            spdlog::warn("Failed to remove btrfs staging directory {}: {}", m_path, std::strerror(errno));
+        }
+    }
+
+    StagingDir(const StagingDir&)                    = delete;
+    auto operator=(const StagingDir&) -> StagingDir& = delete;
+    StagingDir(StagingDir&&)                         = delete;
+    auto operator=(StagingDir&&) -> StagingDir&      = delete;
+
+    [[nodiscard]] auto path() const noexcept -> const std::string& { return m_path; }
+    [[nodiscard]] auto valid() const noexcept -> bool { return !m_path.empty(); }
+    void set_mounted() noexcept { m_mounted = true; }
+
+ private:
+    std::string m_path{"/tmp/gucc-btrfs.XXXXXX"};
+    bool m_mounted{false};
+};
+
+// the kernel queues "e <message>" lines on the fs context, which say much more than errno
+auto fs_context_message(int fs_fd) noexcept -> std::string {
+    std::array<char, 512> buffer{};
+    const auto len = ::read(fs_fd, buffer.data(), buffer.size());
+    if (len <= 0) {
+        return {};
+    }
+    auto message = std::string_view{buffer.data(), static_cast<std::size_t>(len)};
+    if (message.size() > 2 && message[1] == ' ') {
+        message.remove_prefix(2);
+    }
+    return std::string{gucc::utils::trim(message)};
+}
+
+auto fs_context_error(int fs_fd, int err, std::string_view what) noexcept -> std::unexpected<gucc::Error> {
+    const auto& message = fs_context_message(fs_fd);
+    if (message.empty()) {
+        return gucc::make_error(errno_to_code(err), fmt::format(FMT_COMPILE("{}: {}"), what, std::strerror(err)));
+    }
+    return gucc::make_error(errno_to_code(err), fmt::format(FMT_COMPILE("{}: {} ({})"), what, std::strerror(err), message));
+}
+
+// Sets up the top level (subvolid 5) of @p device and returns the detached mount.
+auto open_btrfs_top_level(int fs_fd, std::string_view device, const gucc::fs::detail::BtrfsMountParams& params) noexcept -> gucc::Result<int> {
+    const std::string device_str{device};
+    if (::fsconfig(fs_fd, FSCONFIG_SET_STRING, "source", device_str.c_str(), 0) != 0) {
+        return fs_context_error(fs_fd, errno, fmt::format(FMT_COMPILE("Failed to set source {}"), device));
+    }
+    for (const auto& [key, value] : params.fs_params) {
+        const auto res = value.empty() ? ::fsconfig(fs_fd, FSCONFIG_SET_FLAG, key.c_str(), nullptr, 0)
+                                       : ::fsconfig(fs_fd, FSCONFIG_SET_STRING, key.c_str(), value.c_str(), 0);
+        if (res != 0) {
+            return fs_context_error(fs_fd, errno, fmt::format(FMT_COMPILE("Failed to set btrfs option '{}'"), key));
+        }
+    }
+    if (::fsconfig(fs_fd, FSCONFIG_SET_STRING, "subvolid", "5", 0) != 0) {
+        return fs_context_error(fs_fd, errno, "Failed to select the btrfs top level"sv);
+    }
+    if (::fsconfig(fs_fd, FSCONFIG_CMD_CREATE, nullptr, nullptr, 0) != 0) {
+        return fs_context_error(fs_fd, errno, fmt::format(FMT_COMPILE("Failed to open btrfs on {}"), device));
+    }
+
+    const auto mount_fd = ::fsmount(fs_fd, FSMOUNT_CLOEXEC, static_cast<unsigned int>(params.attr_flags));
+    if (mount_fd < 0) {
+        return fs_context_error(fs_fd, errno, fmt::format(FMT_COMPILE("Failed to mount btrfs on {}"), device));
+    }
+    return mount_fd;
+}
+
+// Clones @p source (a path inside the staged top level) onto @p target.
+// @p attr_flags replace the mount flags of the top level for this mount only.
+auto attach_subvolume(std::string_view source, std::string_view target, std::optional<std::uint64_t> attr_flags) noexcept -> gucc::Result<void> {
+    std::error_code err{};
+    ::fs::create_directories(target, err);
+    if (err) {
+        return gucc::make_error(gucc::ErrorCode::FileIo, fmt::format("Failed to create directories for btrfs subvols mountpoint {}: {}", target, err.message()));
+    }
+
+    const ScopedFd tree{::open_tree(AT_FDCWD, std::string{source}.c_str(), OPEN_TREE_CLONE | OPEN_TREE_CLOEXEC)};
+    if (!tree.valid()) {
+        return gucc::make_error(errno_to_code(errno), fmt::format(FMT_COMPILE("Failed to clone {}: {}"), source, std::strerror(errno)));
+    }
+    if (attr_flags) {
+        mount_attr attr{};
+        attr.attr_set = *attr_flags;
+        attr.attr_clr = (kKnownMountAttrs & ~*attr_flags) | MOUNT_ATTR__ATIME;
+        if (::mount_setattr(tree.get(), "", AT_EMPTY_PATH, &attr, sizeof(attr)) != 0) {
+            return gucc::make_error(errno_to_code(errno), fmt::format(FMT_COMPILE("Failed to set mount options of {}: {}"), source, std::strerror(errno)));
+        }
+    }
+    if (::move_mount(tree.get(), "", AT_FDCWD, std::string{target}.c_str(), MOVE_MOUNT_F_EMPTY_PATH) != 0) {
+        return gucc::make_error(errno_to_code(errno), fmt::format(FMT_COMPILE("Failed to mount {} on {}: {}"), source, target, std::strerror(errno)));
+    }
+    return {};
+}
+
+auto mount_subvolume_exec(const gucc::fs::BtrfsSubvolume& subvol, std::string_view device, std::string_view root_mountpoint, std::string_view shared_mount_opts) noexcept -> gucc::Result<void> {
+    const auto mount_opts = subvol.mount_opts ? std::string_view{*subvol.mount_opts} : shared_mount_opts;
+
+    auto mount_option = fmt::format(FMT_COMPILE("subvol={},{}"), subvol.subvolume, mount_opts);
+    if (subvol.subvolume.empty()) {
+        mount_option = mount_opts;
+    }
+
+    // mount at the actual mountpoint where subvolume is going to be mounted after install
+    const auto& subvolume_mountpoint = fmt::format(FMT_COMPILE("{}{}"), root_mountpoint, subvol.mountpoint);
+
+    std::error_code err{};
+    ::fs::create_directories(subvolume_mountpoint, err);
+    if (err) {
+        return gucc::make_error(gucc::ErrorCode::FileIo, fmt::format("Failed to create directories for btrfs subvols mountpoint {}: {}", subvolume_mountpoint, err.message()));
+    }
+
+    // now mount subvolume
+    const auto& mount_cmd = fmt::format(FMT_COMPILE("mount -o {} \"{}\" {}"), mount_option, device, subvolume_mountpoint);
+
+    spdlog::debug("mounting..: {}", mount_cmd);
+    if (!gucc::utils::exec_checked(mount_cmd)) {
+        return gucc::make_error(gucc::ErrorCode::SubprocessFailed, fmt::format("Failed to mount subvolume {} mountpoint {} with: {}", subvol.subvolume, subvolume_mountpoint, mount_cmd));
+    }
+    return {};
+}
+
+auto subvolume_errors_to_result(const std::vector<gucc::fs::BtrfsSubvolumeError>& errors) noexcept -> gucc::Result<void> {
+    if (errors.empty()) {
+        return {};
+    }
+    std::string context{};
+    for (const auto& [subvolume, error] : errors) {
+        if (!context.empty()) {
+            context += "; "sv;
+        }
+        context += fmt::format(FMT_COMPILE("{}: {}"), subvolume.empty() ? "<top level>"sv : std::string_view{subvolume}, error.context);
+    }
+    return gucc::make_error(errors.front().error.code, std::move(context));
+}
+
 constexpr auto find_partition(const gucc::fs::Partition& part, const gucc::fs::BtrfsSubvolume& subvol) noexcept -> bool {
     return (part.mountpoint == subvol.mountpoint) || (part.subvolume && *part.subvolume == subvol.subvolume);
 }
@@ -51,65 +279,228 @@ constexpr auto find_root_btrfs_part(auto&& parts) noexcept {
 namespace gucc::fs {
 
 auto btrfs_create_subvol(std::string_view subvolume, std::string_view root_mountpoint) noexcept -> Result<void> {
-    const auto& subvol_dirs_path = fmt::format(FMT_COMPILE("{}{}"), root_mountpoint, get_dirname(subvolume));
+    // the ioctl replaced `btrfs subvolume create`, a Mutate process, skip it the same way
+    if (utils::default_runner().dry_run()) {
+        spdlog::info("[dry-run] would create btrfs subvolume {}{}", root_mountpoint, subvolume);
+        return {};
+    }
+    const auto& subvol_dirs_path = detail::btrfs_subvolume_path(root_mountpoint, get_dirname(subvolume));
     std::error_code err{};
     ::fs::create_directories(subvol_dirs_path, err);
     if (err) {
         return make_error(ErrorCode::FileIo, fmt::format("Failed to create directories for btrfs subvolume {}: {}", subvol_dirs_path, err.message()));
     }
-    auto cmd = fmt::format(FMT_COMPILE("btrfs subvolume create {}{}"), root_mountpoint, subvolume);
-    if (!utils::exec_checked(cmd)) {
-        return make_error(ErrorCode::SubprocessFailed, fmt::format("Failed to create btrfs subvolume {}{}", root_mountpoint, subvolume));
+
+    const auto subvol_name = get_basename(subvolume);
+    btrfs_ioctl_vol_args args{};
+    if (subvol_name.empty() || subvol_name.size() >= sizeof(args.name)) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format("Invalid btrfs subvolume name '{}'", subvolume));
+    }
+    std::ranges::copy(subvol_name, args.name);
+
+    const ScopedFd parent_fd{::open(subvol_dirs_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+    if (!parent_fd.valid()) {
+        return make_error(errno_to_code(errno), fmt::format(FMT_COMPILE("Failed to open {}: {}"), subvol_dirs_path, std::strerror(errno)));
+    }
+    if (::ioctl(parent_fd.get(), BTRFS_IOC_SUBVOL_CREATE, &args) != 0) {
+        return make_error(errno_to_code(errno), fmt::format(FMT_COMPILE("Failed to create btrfs subvolume {}{}: {}"), root_mountpoint, subvolume, std::strerror(errno)));
     }
     return {};
 }
 
-auto btrfs_create_subvols(const std::vector<BtrfsSubvolume>& subvols, std::string_view device, std::string_view root_mountpoint, std::string_view mount_opts) noexcept -> Result<void> {
-    // Create subvolumes
-    for (const auto& subvol : subvols) {
-        if (subvol.subvolume.empty()) {
-            continue;
-        }
-        if (auto res = fs::btrfs_create_subvol(subvol.subvolume, root_mountpoint); !res) {
-            return res;
-        }
+auto btrfs_role_subvolume(std::string subvolume, std::string mountpoint, BtrfsSubvolumeRole role) noexcept -> BtrfsSubvolume {
+    BtrfsSubvolume subvol{.subvolume = std::move(subvolume), .mountpoint = std::move(mountpoint)};
+    switch (role) {
+    case BtrfsSubvolumeRole::Database:
+    case BtrfsSubvolumeRole::VmImages:
+        // NOCOW files are neither compressed nor checksummed
+        subvol.nocow = true;
+        break;
+    case BtrfsSubvolumeRole::Containers:
+        subvol.compression = "zstd";
+        break;
+    case BtrfsSubvolumeRole::Swap:
+        subvol.nocow       = true;
+        subvol.compression = "none";
+        break;
+    case BtrfsSubvolumeRole::General:
+        break;
     }
-    // TODO(vnepogodin): handle exit code
-    utils::exec_checked(fmt::format(FMT_COMPILE("umount -v {}"), root_mountpoint));
+    return subvol;
+}
 
-    // Mount subvolumes
-    if (auto res = fs::btrfs_mount_subvols(subvols, device, root_mountpoint, mount_opts); !res) {
+auto validate_btrfs_subvolume(const BtrfsSubvolume& subvol) noexcept -> Result<void> {
+    if (!subvol.compression.empty() && !std::ranges::contains(kBtrfsCompressions, std::string_view{subvol.compression})) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("Unknown compression '{}' for btrfs subvolume {}, expected one of {}"),
+            subvol.compression, subvol.subvolume, fmt::join(kBtrfsCompressions, ", ")));
+    }
+    if (subvol.nocow && !subvol.compression.empty() && subvol.compression != "none"sv) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("btrfs subvolume {} can't be nocow and compressed with {}"), subvol.subvolume, subvol.compression));
+    }
+    return {};
+}
+
+auto apply_btrfs_subvolume_policy(const BtrfsSubvolume& subvol, std::string_view root_mountpoint) noexcept -> Result<void> {
+    if (!subvol.nocow && subvol.compression.empty()) {
+        return {};
+    }
+    if (auto res = fs::validate_btrfs_subvolume(subvol); !res) {
         return res;
     }
+    if (utils::default_runner().dry_run()) {
+        spdlog::info("[dry-run] would set nocow={} compression='{}' on btrfs subvolume {}{}", subvol.nocow, subvol.compression, root_mountpoint, subvol.subvolume);
+        return {};
+    }
+
+    const auto& subvol_path = detail::btrfs_subvolume_path(root_mountpoint, subvol.subvolume);
+    const ScopedFd subvol_fd{::open(subvol_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)};
+    if (!subvol_fd.valid()) {
+        return make_error(errno_to_code(errno), fmt::format(FMT_COMPILE("Failed to open {}: {}"), subvol_path, std::strerror(errno)));
+    }
+
+    // the flag is inherited by new files only, existing data keeps COW
+    if (subvol.nocow) {
+        int flags{};
+        if (::ioctl(subvol_fd.get(), FS_IOC_GETFLAGS, &flags) != 0) {
+            return make_error(errno_to_code(errno), fmt::format(FMT_COMPILE("Failed to read attributes of {}: {}"), subvol_path, std::strerror(errno)));
+        }
+        flags |= FS_NOCOW_FL;
+        if (::ioctl(subvol_fd.get(), FS_IOC_SETFLAGS, &flags) != 0) {
+            return make_error(errno_to_code(errno), fmt::format(FMT_COMPILE("Failed to disable copy-on-write on {}: {}"), subvol_path, std::strerror(errno)));
+        }
+    }
+    if (!subvol.compression.empty()) {
+        if (::fsetxattr(subvol_fd.get(), "btrfs.compression", subvol.compression.data(), subvol.compression.size(), 0) != 0) {
+            return make_error(errno_to_code(errno), fmt::format(FMT_COMPILE("Failed to set compression {} on {}: {}"), subvol.compression, subvol_path, std::strerror(errno)));
+        }
+    }
     return {};
 }
 
-auto btrfs_mount_subvols(const std::vector<BtrfsSubvolume>& subvols, std::string_view device, std::string_view root_mountpoint, std::string_view mount_opts) noexcept -> Result<void> {
+auto create_btrfs_subvolumes(const std::vector<BtrfsSubvolume>& subvols, std::string_view root_mountpoint) noexcept -> std::vector<BtrfsSubvolumeError> {
+    std::vector<BtrfsSubvolumeError> errors{};
     for (const auto& subvol : subvols) {
-        auto mount_option = fmt::format(FMT_COMPILE("subvol={},{}"), subvol.subvolume, mount_opts);
         if (subvol.subvolume.empty()) {
-            mount_option = mount_opts;
+            continue;
         }
+        auto res = fs::btrfs_create_subvol(subvol.subvolume, root_mountpoint);
+        if (res) {
+            res = fs::apply_btrfs_subvolume_policy(subvol, root_mountpoint);
+        }
+        if (!res) {
+            errors.emplace_back(BtrfsSubvolumeError{.subvolume = subvol.subvolume, .error = std::move(res.error())});
+        }
+    }
+    return errors;
+}
 
-        // mount at the actual mountpoint where subvolume is going to be mounted after install
-        const auto& subvolume_mountpoint = fmt::format(FMT_COMPILE("{}{}"), root_mountpoint, subvol.mountpoint);
+auto mount_btrfs_subvolumes(const std::vector<BtrfsSubvolume>& subvols, std::string_view device, std::string_view root_mountpoint, std::string_view mount_opts) noexcept -> std::vector<BtrfsSubvolumeError> {
+    std::vector<BtrfsSubvolumeError> errors{};
+    if (subvols.empty()) {
+        return errors;
+    }
+    const auto& ordered_subvols = detail::btrfs_mount_order(subvols);
+    if (utils::default_runner().dry_run()) {
+        for (const auto& subvol : ordered_subvols) {
+            spdlog::info("[dry-run] would mount btrfs subvolume {} of '{}' on {}{}", subvol.subvolume, device, root_mountpoint, subvol.mountpoint);
+        }
+        return errors;
+    }
 
-        // TODO(vnepogodin): refactor create dir and mount into own function
-        std::error_code err{};
-        ::fs::create_directories(subvolume_mountpoint, err);
-        if (err) {
-            return make_error(ErrorCode::FileIo, fmt::format("Failed to create directories for btrfs subvols mountpoint {}: {}", subvolume_mountpoint, err.message()));
+    const ScopedFd fs_fd{::fsopen("btrfs", FSOPEN_CLOEXEC)};
+    if (!fs_fd.valid() && errno == ENOSYS) {
+        spdlog::debug("fsopen is not available, mounting btrfs subvolumes with mount");
+        for (const auto& subvol : ordered_subvols) {
+            if (auto res = mount_subvolume_exec(subvol, device, root_mountpoint, mount_opts); !res) {
+                errors.emplace_back(BtrfsSubvolumeError{.subvolume = subvol.subvolume, .error = std::move(res.error())});
+            }
+        }
+        return errors;
+    }
+
+    const auto fail_all = [&](const Error& error) {
+        for (const auto& subvol : ordered_subvols) {
+            errors.emplace_back(BtrfsSubvolumeError{.subvolume = subvol.subvolume, .error = error});
         }
+        return errors;
+    };
+    if (!fs_fd.valid()) {
+        return fail_all(Error{.code = errno_to_code(errno), .context = fmt::format(FMT_COMPILE("Failed to open btrfs context: {}"), std::strerror(errno))});
+    }
 
-        // now mount subvolume
-        const auto& mount_cmd = fmt::format(FMT_COMPILE("mount -o {} \"{}\" {}"), mount_option, device, subvolume_mountpoint);
+    const auto& shared_params = detail::split_mount_options(mount_opts);
+    auto top_level_fd         = open_btrfs_top_level(fs_fd.get(), device, shared_params);
+    if (!top_level_fd) {
+        return fail_all(top_level_fd.error());
+    }
+    const ScopedFd top_level{*top_level_fd};
 
-        spdlog::debug("mounting..: {}", mount_cmd);
-        if (!utils::exec_checked(mount_cmd)) {
-            return make_error(ErrorCode::SubprocessFailed, fmt::format("Failed to mount subvolume {} mountpoint {} with: {}", subvol.subvolume, subvolume_mountpoint, mount_cmd));
+    // a detached mount can't be cloned on older kernels, so park it on a private directory
+    StagingDir staging_dir{};
+    if (!staging_dir.valid()) {
+        return fail_all(Error{.code = ErrorCode::FileIo, .context = fmt::format(FMT_COMPILE("Failed to create staging directory: {}"), std::strerror(errno))});
+    }
+    const auto& staging = staging_dir.path();
+    if (::move_mount(top_level.get(), "", AT_FDCWD, staging.c_str(), MOVE_MOUNT_F_EMPTY_PATH) != 0) {
+        return fail_all(Error{.code = errno_to_code(errno), .context = fmt::format(FMT_COMPILE("Failed to attach btrfs top level on {}: {}"), staging, std::strerror(errno))});
+    }
+    staging_dir.set_mounted();
+    // keep the clones out of the peer group of the host
+    if (::mount(nullptr, staging.c_str(), nullptr, MS_PRIVATE, nullptr) != 0) {
+        return fail_all(Error{.code = errno_to_code(errno), .context = fmt::format(FMT_COMPILE("Failed to make {} private: {}"), staging, std::strerror(errno))});
+    }
+
+    std::vector<std::string_view> failed_mountpoints{};
+    for (const auto& subvol : ordered_subvols) {
+        const auto parent_it = std::ranges::find_if(failed_mountpoints,
+            [&subvol](std::string_view failed) { return is_nested_in(subvol.mountpoint, failed); });
+        if (parent_it != std::ranges::end(failed_mountpoints)) {
+            // would land on the live system instead of the target
+            failed_mountpoints.emplace_back(subvol.mountpoint);
+            errors.emplace_back(BtrfsSubvolumeError{.subvolume = subvol.subvolume,
+                .error = Error{.code = ErrorCode::NotFound, .context = fmt::format(FMT_COMPILE("{} is not mounted"), *parent_it)}});
+            continue;
+        }
+
+        const auto& source = detail::btrfs_subvolume_path(staging, subvol.subvolume);
+        const auto& target = fmt::format(FMT_COMPILE("{}{}"), root_mountpoint, subvol.mountpoint);
+        std::optional<std::uint64_t> attr_flags{};
+        if (subvol.mount_opts) {
+            const auto& params = detail::split_mount_options(*subvol.mount_opts);
+            if (params.fs_params != shared_params.fs_params) {
+                spdlog::warn("btrfs options of subvolume {} differ from the filesystem ones, only mount flags are applied: {}", subvol.subvolume, *subvol.mount_opts);
+            }
+            attr_flags = params.attr_flags;
+        }
+
+        spdlog::debug("mounting..: {} on {}", source, target);
+        if (auto res = attach_subvolume(source, target, attr_flags); !res) {
+            failed_mountpoints.emplace_back(subvol.mountpoint);
+            errors.emplace_back(BtrfsSubvolumeError{.subvolume = subvol.subvolume, .error = std::move(res.error())});
         }
     }
-    return {};
+
+    return errors;
+}
+
+auto btrfs_create_subvols(const std::vector<BtrfsSubvolume>& subvols, std::string_view device, std::string_view root_mountpoint, std::string_view mount_opts) noexcept -> Result<void> {
+    // Create subvolumes
+    if (auto res = subvolume_errors_to_result(fs::create_btrfs_subvolumes(subvols, root_mountpoint)); !res) {
+        return res;
+    }
+    const std::string root_mountpoint_str{root_mountpoint};
+    if (utils::default_runner().dry_run()) {
+        spdlog::info("[dry-run] would unmount {}", root_mountpoint);
+    } else if (::umount2(root_mountpoint_str.c_str(), 0) != 0) {
+        return make_error(errno_to_code(errno), fmt::format(FMT_COMPILE("Failed to unmount {}: {}"), root_mountpoint, std::strerror(errno)));
+    }
+
+    // Mount subvolumes
+    return subvolume_errors_to_result(fs::mount_btrfs_subvolumes(subvols, device, root_mountpoint, mount_opts));
+}
+
+auto btrfs_mount_subvols(const std::vector<BtrfsSubvolume>& subvols, std::string_view device, std::string_view root_mountpoint, std::string_view mount_opts) noexcept -> Result<void> {
+    return subvolume_errors_to_result(fs::mount_btrfs_subvolumes(subvols, device, root_mountpoint, mount_opts));
 }
 
 auto btrfs_append_subvolumes(std::vector<Partition>& partitions, const std::vector<BtrfsSubvolume>& subvols) noexcept -> Result<void> {
@@ -122,6 +513,8 @@ auto btrfs_append_subvolumes(std::vector<Partition>& partitions, const std::vect
     if (root_part_it == std::ranges::end(partitions)) {
         return make_error(ErrorCode::NotFound, fmt::format("Unable to find root btrfs partition!"));
     }
+    // the root subvolume may override its options below, the others inherit the original ones
+    const auto shared_mount_opts = root_part_it->mount_opts;
 
     for (auto&& subvol : subvols) {
         // check if we already have a partition with such subvolume
@@ -132,6 +525,9 @@ auto btrfs_append_subvolumes(std::vector<Partition>& partitions, const std::vect
         if (part_it != std::ranges::end(partitions)) {
             part_it->mountpoint = subvol.mountpoint;
             part_it->subvolume  = std::make_optional<std::string>(subvol.subvolume);
+            if (subvol.mount_opts) {
+                part_it->mount_opts = *subvol.mount_opts;
+            }
             continue;
         }
         // overwise, let's insert the partition based on the root partition
@@ -145,7 +541,7 @@ auto btrfs_append_subvolumes(std::vector<Partition>& partitions, const std::vect
         part.mountpoint       = subvol.mountpoint;
         part.uuid_str         = root_part_it->uuid_str;
         part.device           = root_part_it->device;
-        part.mount_opts       = root_part_it->mount_opts;
+        part.mount_opts       = subvol.mount_opts.value_or(shared_mount_opts);
         part.subvolume        = std::make_optional<std::string>(subvol.subvolume);
         part.luks_mapper_name = root_part_it->luks_mapper_name;
         part.luks_uuid        = root_part_it->luks_uuid;
@@ -159,7 +555,7 @@ auto btrfs_append_subvolumes(std::vector<Partition>& partitions, const std::vect
 }
 
 auto create_btrfs_installation_snapshot(std::string_view root_mountpoint) noexcept -> Result<void> {
-    if (!utils::arch_chroot_checked("pacman -Qs cachyos-snapper-support"sv, root_mountpoint)) {
+    if (!localdb::is_installed("cachyos-snapper-support"sv, root_mountpoint)) {
         spdlog::info("cachyos-snapper-support not installed, skipping");
         return {};
     }
@@ -191,3 +587,110 @@ auto create_btrfs_installation_snapshot(std::string_view root_mountpoint) noexce
 }
 
 }  // namespace gucc::fs
+
+namespace gucc::fs::detail {
+
+auto split_mount_options(std::string_view mount_opts) noexcept -> BtrfsMountParams {
+    BtrfsMountParams params{};
+    const auto set_atime = [&params](std::uint64_t atime) {
+        params.attr_flags = (params.attr_flags & ~static_cast<std::uint64_t>(MOUNT_ATTR__ATIME)) | atime;
+    };
+
+    for (auto&& option : utils::make_split_view(mount_opts, ',')) {
+        const auto eq_pos = option.find('=');
+        const auto key    = option.substr(0, eq_pos);
+        const auto value  = (eq_pos == std::string_view::npos) ? std::string_view{} : option.substr(eq_pos + 1);
+
+        // fstab/userspace only, or picked per subvolume
+        if (key.empty() || key == "defaults"sv || key == "auto"sv || key == "noauto"sv || key == "nofail"sv
+            || key == "user"sv || key == "nouser"sv || key == "users"sv || key == "owner"sv || key == "group"sv
+            || key == "_netdev"sv || key == "comment"sv || key.starts_with("x-"sv) || key == "subvol"sv || key == "subvolid"sv) {
+            continue;
+        }
+
+        if (key == "ro"sv) {
+            params.attr_flags |= MOUNT_ATTR_RDONLY;
+        } else if (key == "rw"sv) {
+            params.attr_flags &= ~static_cast<std::uint64_t>(MOUNT_ATTR_RDONLY);
+        } else if (key == "nosuid"sv) {
+            params.attr_flags |= MOUNT_ATTR_NOSUID;
+        } else if (key == "suid"sv) {
+            params.attr_flags &= ~static_cast<std::uint64_t>(MOUNT_ATTR_NOSUID);
+        } else if (key == "nodev"sv) {
+            params.attr_flags |= MOUNT_ATTR_NODEV;
+        } else if (key == "dev"sv) {
+            params.attr_flags &= ~static_cast<std::uint64_t>(MOUNT_ATTR_NODEV);
+        } else if (key == "noexec"sv) {
+            params.attr_flags |= MOUNT_ATTR_NOEXEC;
+        } else if (key == "exec"sv) {
+            params.attr_flags &= ~static_cast<std::uint64_t>(MOUNT_ATTR_NOEXEC);
+        } else if (key == "nodiratime"sv) {
+            params.attr_flags |= MOUNT_ATTR_NODIRATIME;
+        } else if (key == "diratime"sv) {
+            params.attr_flags &= ~static_cast<std::uint64_t>(MOUNT_ATTR_NODIRATIME);
+        } else if (key == "nosymfollow"sv) {
+            params.attr_flags |= MOUNT_ATTR_NOSYMFOLLOW;
+        } else if (key == "noatime"sv) {
+            set_atime(MOUNT_ATTR_NOATIME);
+        } else if (key == "relatime"sv) {
+            set_atime(MOUNT_ATTR_RELATIME);
+        } else if (key == "strictatime"sv) {
+            set_atime(MOUNT_ATTR_STRICTATIME);
+        } else {
+            params.fs_params.emplace_back(std::string{key}, std::string{value});
+        }
+    }
+    return params;
+}
+
+auto btrfs_subvolume_path(std::string_view top_level, std::string_view subvolume) noexcept -> std::string {
+    while (subvolume.starts_with('/')) {
+        subvolume.remove_prefix(1);
+    }
+    while (top_level.ends_with('/')) {
+        top_level.remove_suffix(1);
+    }
+    return fmt::format(FMT_COMPILE("{}/{}"), top_level, subvolume);
+}
+
+auto btrfs_mount_order(const std::vector<BtrfsSubvolume>& subvols) noexcept -> std::vector<BtrfsSubvolume> {
+    auto ordered = subvols;
+    std::ranges::stable_sort(ordered, {}, [](const BtrfsSubvolume& subvol) { return mountpoint_depth(subvol.mountpoint); });
+    return ordered;
+}
+
+auto btrfs_create_subvols_exec(const std::vector<BtrfsSubvolume>& subvols, std::string_view device, std::string_view root_mountpoint, std::string_view mount_opts) noexcept -> Result<void> {
+    for (const auto& subvol : subvols) {
+        if (subvol.subvolume.empty()) {
+            continue;
+        }
+        const auto& subvol_dirs_path = fmt::format(FMT_COMPILE("{}{}"), root_mountpoint, get_dirname(subvol.subvolume));
+        std::error_code err{};
+        ::fs::create_directories(subvol_dirs_path, err);
+        if (err) {
+            return make_error(ErrorCode::FileIo, fmt::format("Failed to create directories for btrfs subvolume {}: {}", subvol_dirs_path, err.message()));
+        }
+        auto cmd = fmt::format(FMT_COMPILE("btrfs subvolume create {}{}"), root_mountpoint, subvol.subvolume);
+        if (!utils::exec_checked(cmd)) {
+            return make_error(ErrorCode::SubprocessFailed, fmt::format("Failed to create btrfs subvolume {}{}", root_mountpoint, subvol.subvolume));
+        }
+        if (auto res = fs::apply_btrfs_subvolume_policy(subvol, root_mountpoint); !res) {
+            return res;
+        }
+    }
+    if (!utils::exec_checked(fmt::format(FMT_COMPILE("umount -v {}"), root_mountpoint))) {
+        return make_error(ErrorCode::SubprocessFailed, fmt::format("Failed to unmount {}", root_mountpoint));
+    }
+    return detail::btrfs_mount_subvols_exec(subvols, device, root_mountpoint, mount_opts);
+}
+
+auto btrfs_mount_subvols_exec(const std::vector<BtrfsSubvolume>& subvols, std::string_view device, std::string_view root_mountpoint, std::string_view mount_opts) noexcept -> Result<void> {
+    for (const auto& subvol : subvols) {
+        if (auto res = mount_subvolume_exec(subvol, device, root_mountpoint, mount_opts); !res) {
+            return res;
+        }
+    }
+    return {};
+}
+
+}  // namespace gucc::fs::detail
@@ -1,10 +1,28 @@
 #include "gucc/btrfs_query.hpp"
-#include "gucc/io_utils.hpp"
+#include "gucc/mount_table.hpp"
 #include "gucc/string_utils.hpp"
 
-#include <algorithm>  // for for_each, transform
+#include <endian.h>        // for le16toh, le64toh
+#include <fcntl.h>         // for open, O_*
+#include <linux/btrfs.h>   // for BTRFS_IOC_*, btrfs_ioctl_*
+#include <linux/fs.h>      // for FS_IOC_GETFSLABEL, FSLABEL_MAX
+#include <linux/magic.h>   // for BTRFS_SUPER_MAGIC
+#include <sys/ioctl.h>     // for ioctl
+#include <sys/statfs.h>    // for statfs
+#include <unistd.h>        // for close
+
+#include <linux/btrfs_tree.h>  // for btrfs_root_item, btrfs_root_ref, BTRFS_*_KEY
+
+#include <algorithm>  // for for_each, transform, find_if
+#include <array>      // for array
+#include <cerrno>     // for errno
+#include <cstring>    // for memcpy, strerror, strnlen
+#include <ctime>      // for localtime_r
+#include <limits>     // for numeric_limits
 #include <ranges>     // for ranges::*
+#include <utility>    // for move
 
+#include <fmt/chrono.h>
 #include <fmt/compile.h>
 #include <fmt/format.h>
 
@@ -12,6 +30,75 @@
 
 using namespace std::string_view_literals;
 
+namespace {
+
+// raw bytes per logical byte, parity profiles are close enough to one copy
+constexpr auto profile_copies(std::uint64_t flags) noexcept -> std::uint64_t {
+    if ((flags & BTRFS_BLOCK_GROUP_RAID1C4) != 0) {
+        return 4;
+    }
+    if ((flags & BTRFS_BLOCK_GROUP_RAID1C3) != 0) {
+        return 3;
+    }
+    if ((flags & (BTRFS_BLOCK_GROUP_RAID1 | BTRFS_BLOCK_GROUP_DUP | BTRFS_BLOCK_GROUP_RAID10)) != 0) {
+        return 2;
+    }
+    return 1;
+}
+
+// "-" in `btrfs subvolume list` when unset
+auto format_uuid(const std::uint8_t (&uuid)[BTRFS_UUID_SIZE]) noexcept -> std::optional<std::string> {
+    if (std::ranges::all_of(uuid, [](std::uint8_t byte) { return byte == 0; })) {
+        return std::nullopt;
+    }
+    return fmt::format(FMT_COMPILE("{:02x}{:02x}{:02x}{:02x}-{:02x}{:02x}-{:02x}{:02x}-{:02x}{:02x}-{:02x}{:02x}{:02x}{:02x}{:02x}{:02x}"),
+        uuid[0], uuid[1], uuid[2], uuid[3], uuid[4], uuid[5], uuid[6], uuid[7],
+        uuid[8], uuid[9], uuid[10], uuid[11], uuid[12], uuid[13], uuid[14], uuid[15]);
+}
+
+auto format_time(std::uint64_t seconds) noexcept -> std::optional<std::string> {
+    if (seconds == 0) {
+        return std::nullopt;
+    }
+    const auto time = static_cast<std::time_t>(seconds);
+    std::tm local_time{};
+    if (::localtime_r(&time, &local_time) == nullptr) {
+        return std::nullopt;
+    }
+    return fmt::format("{:%Y-%m-%d %H:%M:%S}", local_time);
+}
+
+using RootRecords = std::map<std::uint64_t, gucc::fs::btrfs_query::detail::BtrfsRootRecord>;
+
+auto resolve_record_path(const RootRecords& records, std::map<std::uint64_t, std::optional<std::string>>& resolved,
+    std::uint64_t id, std::size_t depth) noexcept -> std::optional<std::string> {
+    if (id == BTRFS_FS_TREE_OBJECTID) {
+        return std::string{};
+    }
+    if (const auto it = resolved.find(id); it != resolved.end()) {
+        return it->second;
+    }
+    const auto record_it = records.find(id);
+    // nesting can't be deeper than the number of subvolumes
+    if (record_it == records.end() || !record_it->second.has_backref || depth > records.size()) {
+        return std::nullopt;
+    }
+    const auto& record = record_it->second;
+
+    auto parent_path = resolve_record_path(records, resolved, record.info.parent_id, depth + 1);
+    std::optional<std::string> path{};
+    if (parent_path) {
+        if (!parent_path->empty()) {
+            parent_path->push_back('/');
+        }
+        path = fmt::format(FMT_COMPILE("{}{}{}"), *parent_path, record.dir_path, record.info.path);
+    }
+    resolved.emplace(id, path);
+    return path;
+}
+
+}  // namespace
+
 namespace gucc::fs::btrfs_query::detail {
 
 auto parse_subvolume_list(std::string_view output, std::string_view filter_prefix) noexcept
@@ -69,89 +156,313 @@ auto parse_subvolume_list(std::string_view output, std::string_view filter_prefi
         | std::ranges::to<std::vector<BtrfsSubvolumeInfo>>();
 }
 
+
+auto decode_root_tree_items(std::span<const std::uint8_t> buffer, std::uint32_t nr_items,
+    std::map<std::uint64_t, BtrfsRootRecord>& records) noexcept -> std::optional<BtrfsKey> {
+    std::optional<BtrfsKey> last_key{};
+    std::size_t pos{};
+    for (std::uint32_t i = 0; i < nr_items; ++i) {
+        btrfs_ioctl_search_header header{};
+        if (buffer.size() - pos < sizeof(header)) {
+            break;
+        }
+        // native endian, filled in by the kernel
+        std::memcpy(&header, buffer.data() + pos, sizeof(header));
+        pos += sizeof(header);
+        if (buffer.size() - pos < header.len) {
+            break;
+        }
+        const auto item = buffer.subspan(pos, header.len);
+        pos += header.len;
+        last_key = BtrfsKey{.objectid = header.objectid, .type = static_cast<std::uint8_t>(header.type), .offset = header.offset};
+
+        if (header.type == BTRFS_ROOT_ITEM_KEY) {
+            // items written by very old kernels end before the uuids
+            btrfs_root_item root_item{};
+            std::memcpy(&root_item, item.data(), std::min(item.size(), sizeof(root_item)));
+
+            auto& record            = records[header.objectid];
+            record.info.id          = header.objectid;
+            record.info.gen         = le64toh(root_item.generation);
+            record.info.is_readonly = (le64toh(root_item.flags) & BTRFS_ROOT_SUBVOL_RDONLY) != 0;
+            if (item.size() >= sizeof(root_item)) {
+                record.info.uuid          = format_uuid(root_item.uuid);
+                record.info.parent_uuid   = format_uuid(root_item.parent_uuid);
+                record.info.creation_time = format_time(le64toh(root_item.otime.sec));
+            }
+        } else if (header.type == BTRFS_ROOT_BACKREF_KEY) {
+            btrfs_root_ref root_ref{};
+            if (item.size() < sizeof(root_ref)) {
+                continue;
+            }
+            std::memcpy(&root_ref, item.data(), sizeof(root_ref));
+            const auto name_len = std::min<std::size_t>(le16toh(root_ref.name_len), item.size() - sizeof(root_ref));
+
+            auto& record          = records[header.objectid];
+            record.info.id        = header.objectid;
+            record.info.parent_id = header.offset;
+            record.info.top_level = header.offset;
+            record.info.path.assign(reinterpret_cast<const char*>(item.data() + sizeof(root_ref)), name_len);
+            record.dir_id      = le64toh(root_ref.dirid);
+            record.has_backref = true;
+        }
+    }
+    return last_key;
+}
+
+auto resolve_subvolume_paths(const std::map<std::uint64_t, BtrfsRootRecord>& records, std::string_view filter_prefix) noexcept
+    -> std::vector<BtrfsSubvolumeInfo> {
+    // parents always have a lower ID than their children, but snapshots can be
+    // moved into newer subvolumes, so don't rely on the order
+    std::map<std::uint64_t, std::optional<std::string>> resolved{};
+
+    std::vector<BtrfsSubvolumeInfo> result{};
+    for (const auto& [id, record] : records) {
+        auto path = resolve_record_path(records, resolved, id, 0);
+        if (!path || path->empty()) {
+            continue;
+        }
+        if (!filter_prefix.empty() && !path->starts_with(filter_prefix)) {
+            continue;
+        }
+        auto& info = result.emplace_back(record.info);
+        info.path  = std::move(*path);
+    }
+    return result;
+}
+
+auto btrfs_profile_name(std::uint64_t flags) noexcept -> std::string_view {
+    constexpr std::array profile_names{
+        std::pair{BTRFS_BLOCK_GROUP_RAID0, "RAID0"sv},
+        std::pair{BTRFS_BLOCK_GROUP_RAID1, "RAID1"sv},
+        std::pair{BTRFS_BLOCK_GROUP_DUP, "DUP"sv},
+        std::pair{BTRFS_BLOCK_GROUP_RAID10, "RAID10"sv},
+        std::pair{BTRFS_BLOCK_GROUP_RAID5, "RAID5"sv},
+        std::pair{BTRFS_BLOCK_GROUP_RAID6, "RAID6"sv},
+        std::pair{BTRFS_BLOCK_GROUP_RAID1C3, "RAID1C3"sv},
+        std::pair{BTRFS_BLOCK_GROUP_RAID1C4, "RAID1C4"sv},
+    };
+    const auto profile = flags & BTRFS_BLOCK_GROUP_PROFILE_MASK;
+    const auto it      = std::ranges::find(profile_names, profile, [](const auto& entry) { return entry.first; });
+    return (it != std::ranges::end(profile_names)) ? it->second : "single"sv;
+}
+
+void apply_space_usage(BtrfsFilesystemInfo& info, const std::vector<BtrfsSpaceUsage>& spaces, std::uint64_t device_size) noexcept {
+    std::uint64_t allocated{};
+    std::uint64_t used{};
+    std::uint64_t data_total{};
+    std::uint64_t data_used{};
+    std::uint64_t data_ratio{1};
+    for (const auto& space : spaces) {
+        // reserved from metadata, already part of it
+        if ((space.flags & BTRFS_SPACE_INFO_GLOBAL_RSV) != 0) {
+            continue;
+        }
+        const auto ratio = profile_copies(space.flags);
+        allocated += space.total_bytes * ratio;
+        used += space.used_bytes * ratio;
+
+        if ((space.flags & BTRFS_BLOCK_GROUP_DATA) != 0) {
+            info.data_profile = std::string{btrfs_profile_name(space.flags)};
+            data_total += space.total_bytes;
+            data_used += space.used_bytes;
+            data_ratio = ratio;
+        } else if ((space.flags & BTRFS_BLOCK_GROUP_METADATA) != 0) {
+            info.metadata_profile = std::string{btrfs_profile_name(space.flags)};
+        }
+    }
+
+    // same estimate as `btrfs filesystem usage`: room left in data chunks plus
+    // what new data chunks could still take from the unallocated space
+    const auto unallocated = (device_size > allocated) ? device_size - allocated : 0;
+    info.total_size        = device_size;
+    info.used              = used;
+    info.free              = (data_total - std::min(data_used, data_total)) + unallocated / data_ratio;
+}
+
 }  // namespace gucc::fs::btrfs_query::detail
 
 namespace {
 
-using Info = gucc::fs::BtrfsFilesystemInfo;
+namespace detail = gucc::fs::btrfs_query::detail;
+
+inline constexpr std::size_t TREE_SEARCH_BUFFER_SIZE = 64 * 1024;
 
-void assign_data_profile(Info& info, std::string_view val) { info.data_profile = std::string{val}; }
-void assign_metadata_profile(Info& info, std::string_view val) { info.metadata_profile = std::string{val}; }
+class ScopedFd final {
+ public:
+    explicit ScopedFd(int fd) noexcept : m_fd(fd) { }
+    ~ScopedFd() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
 
-using StringSetter = void (*)(Info&, std::string_view);
+    ScopedFd(const ScopedFd&)                    = delete;
+    auto operator=(const ScopedFd&) -> ScopedFd& = delete;
+    ScopedFd(ScopedFd&&)                         = delete;
+    auto operator=(ScopedFd&&) -> ScopedFd&      = delete;
 
-struct DFProfileField {
-    std::string_view marker;
-    StringSetter assign;
-};
+    [[nodiscard]] auto get() const noexcept -> int { return m_fd; }
+    [[nodiscard]] auto valid() const noexcept -> bool { return m_fd >= 0; }
 
-constexpr DFProfileField df_profile_fields[] = {
-    {"Data,"sv, assign_data_profile},
-    {"Metadata,"sv, assign_metadata_profile},
+ private:
+    int m_fd{-1};
 };
 
-auto parse_btrfs_df_output(std::string_view output, Info& info) -> bool {
-    std::ranges::for_each(gucc::utils::make_split_view(output), [&](std::string_view line) {
-        const auto it = std::ranges::find_if(df_profile_fields,
-            [&line](const auto& desc) { return line.contains(desc.marker); });
-        if (it != std::ranges::end(df_profile_fields)) {
-            const auto start = it->marker.size();
-            if (const auto colon = line.find(':', start); colon != std::string_view::npos) {
-                it->assign(info, gucc::utils::trim(line.substr(start, colon - start)));
-            }
-        }
-    });
-    return true;
+auto open_btrfs_dir(std::string_view path) noexcept -> int {
+    return ::open(std::string{path}.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
 }
 
-void assign_total_size(Info& info, std::uint64_t val) { info.total_size = val; }
-void assign_used(Info& info, std::uint64_t val) { info.used = val; }
-void assign_free(Info& info, std::uint64_t val) { info.free = val; }
+// Path of @p dir_id inside subvolume @p tree_id, "" for its top directory.
+auto lookup_dir_path(int fd, std::uint64_t tree_id, std::uint64_t dir_id) noexcept -> std::optional<std::string> {
+    if (dir_id == BTRFS_FIRST_FREE_OBJECTID) {
+        return std::string{};
+    }
+    btrfs_ioctl_ino_lookup_args args{};
+    args.treeid   = tree_id;
+    args.objectid = dir_id;
+    if (::ioctl(fd, BTRFS_IOC_INO_LOOKUP, &args) != 0) {
+        return std::nullopt;
+    }
+    return std::string{args.name, ::strnlen(args.name, sizeof(args.name))};
+}
 
-using U64Setter = void (*)(Info&, std::uint64_t);
+// Subvolume ID the file descriptor belongs to.
+auto subvolume_id_of(int fd) noexcept -> std::optional<std::uint64_t> {
+    btrfs_ioctl_ino_lookup_args args{};
+    args.objectid = BTRFS_FIRST_FREE_OBJECTID;
+    if (::ioctl(fd, BTRFS_IOC_INO_LOOKUP, &args) != 0) {
+        return std::nullopt;
+    }
+    return args.treeid;
+}
 
-struct UsageField {
-    std::string_view prefix;
-    U64Setter assign;
-};
+auto next_key(const detail::BtrfsKey& key) noexcept -> std::optional<detail::BtrfsKey> {
+    constexpr auto u64_max = std::numeric_limits<std::uint64_t>::max();
+    if (key.offset < u64_max) {
+        return detail::BtrfsKey{.objectid = key.objectid, .type = key.type, .offset = key.offset + 1};
+    }
+    if (key.type < std::numeric_limits<std::uint8_t>::max()) {
+        return detail::BtrfsKey{.objectid = key.objectid, .type = static_cast<std::uint8_t>(key.type + 1), .offset = 0};
+    }
+    if (key.objectid < u64_max) {
+        return detail::BtrfsKey{.objectid = key.objectid + 1, .type = 0, .offset = 0};
+    }
+    return std::nullopt;
+}
 
-constexpr UsageField usage_fields[] = {
-    {"Device size:"sv, assign_total_size},
-    {"    Used:"sv, assign_used},
-    {"Free (estimated):"sv, assign_free},
-};
+// Walks the subvolume items of the root tree. Needs CAP_SYS_ADMIN, same as `btrfs subvolume list`.
+auto read_root_records(int fd) noexcept -> std::optional<std::map<std::uint64_t, detail::BtrfsRootRecord>> {
+    // u64 storage keeps the search buffer aligned for the kernel structs
+    std::vector<std::uint64_t> storage((sizeof(btrfs_ioctl_search_args_v2) + TREE_SEARCH_BUFFER_SIZE) / sizeof(std::uint64_t));
+    auto* args = reinterpret_cast<btrfs_ioctl_search_args_v2*>(storage.data());
+
+    std::map<std::uint64_t, detail::BtrfsRootRecord> records{};
+    detail::BtrfsKey min_key{.objectid = BTRFS_FIRST_FREE_OBJECTID, .type = BTRFS_ROOT_ITEM_KEY, .offset = 0};
+    while (true) {
+        args->key              = btrfs_ioctl_search_key{};
+        args->key.tree_id      = BTRFS_ROOT_TREE_OBJECTID;
+        args->key.min_objectid = min_key.objectid;
+        args->key.min_type     = min_key.type;
+        args->key.min_offset   = min_key.offset;
+        args->key.max_objectid = BTRFS_LAST_FREE_OBJECTID;
+        args->key.max_type     = BTRFS_ROOT_BACKREF_KEY;
+        args->key.max_offset   = std::numeric_limits<std::uint64_t>::max();
+        args->key.max_transid  = std::numeric_limits<std::uint64_t>::max();
+        args->key.nr_items     = std::numeric_limits<std::uint32_t>::max();
+        args->buf_size         = TREE_SEARCH_BUFFER_SIZE;
+
+        if (::ioctl(fd, BTRFS_IOC_TREE_SEARCH_V2, args) != 0) {
+            spdlog::debug("btrfs tree search failed: {}", std::strerror(errno));
+            return std::nullopt;
+        }
+        if (args->key.nr_items == 0) {
+            break;
+        }
 
-void assign_label(Info& info, std::string_view line) {
-    const auto start = line.find('\'');
-    if (start == std::string_view::npos) {
-        return;
+        const std::span<const std::uint8_t> buffer{reinterpret_cast<const std::uint8_t*>(args->buf), TREE_SEARCH_BUFFER_SIZE};
+        const auto last_key = detail::decode_root_tree_items(buffer, args->key.nr_items, records);
+        if (!last_key) {
+            break;
+        }
+        const auto following = next_key(*last_key);
+        if (!following || following->objectid > BTRFS_LAST_FREE_OBJECTID) {
+            break;
+        }
+        min_key = *following;
     }
-    const auto end = line.find('\'', start + 1);
-    if (end == std::string_view::npos) {
-        return;
+
+    for (auto& [id, record] : records) {
+        if (!record.has_backref) {
+            continue;
+        }
+        auto dir_path = lookup_dir_path(fd, record.info.parent_id, record.dir_id);
+        if (!dir_path) {
+            // can't be placed, same as btrfs-progs leave it out
+            record.has_backref = false;
+            continue;
+        }
+        record.dir_path = std::move(*dir_path);
     }
-    info.label = std::string{line.substr(start + 1, end - start - 1)};
+    return records;
 }
 
-void assign_uuid(Info& info, std::string_view line) {
-    using gucc::utils::extract_after;
-    using gucc::utils::rtrim;
-    if (auto val = extract_after(line, "uuid: "sv)) {
-        info.uuid = std::string{rtrim(*val)};
+// Mountpoint of a mounted btrfs device, the path itself otherwise.
+auto resolve_btrfs_path(std::string_view mountpoint_or_device) noexcept -> std::optional<std::string> {
+    if (!mountpoint_or_device.starts_with("/dev/"sv)) {
+        return std::string{mountpoint_or_device};
     }
+    const auto& mount_table = gucc::mtab::MountTable::read();
+    if (!mount_table) {
+        return std::nullopt;
+    }
+    const auto entries = mount_table->entries();
+    const auto it      = std::ranges::find_if(entries, [mountpoint_or_device](const auto& entry) {
+        return entry.fstype == "btrfs"sv && entry.source == mountpoint_or_device;
+    });
+    if (it == std::ranges::end(entries)) {
+        return std::nullopt;
+    }
+    return std::string{it->mountpoint};
 }
 
-using ShowSetter = void (*)(Info&, std::string_view);
+auto read_space_usage(int fd) noexcept -> std::optional<std::vector<detail::BtrfsSpaceUsage>> {
+    // first call only counts the slots
+    btrfs_ioctl_space_args count_args{};
+    if (::ioctl(fd, BTRFS_IOC_SPACE_INFO, &count_args) != 0) {
+        return std::nullopt;
+    }
+    const auto slots = count_args.total_spaces;
 
-struct ShowField {
-    std::string_view marker;
-    ShowSetter assign;
-};
+    std::vector<std::uint64_t> storage((sizeof(btrfs_ioctl_space_args) + slots * sizeof(btrfs_ioctl_space_info)) / sizeof(std::uint64_t) + 1);
+    auto* args        = reinterpret_cast<btrfs_ioctl_space_args*>(storage.data());
+    args->space_slots = slots;
+    if (::ioctl(fd, BTRFS_IOC_SPACE_INFO, args) != 0) {
+        return std::nullopt;
+    }
 
-constexpr ShowField show_fields[] = {
-    {"Label:"sv, assign_label},
-    {"uuid: "sv, assign_uuid},
-};
+    std::vector<detail::BtrfsSpaceUsage> spaces{};
+    spaces.reserve(args->total_spaces);
+    for (std::uint64_t i = 0; i < std::min(args->total_spaces, slots); ++i) {
+        const auto& space = args->spaces[i];
+        spaces.emplace_back(detail::BtrfsSpaceUsage{.flags = space.flags, .total_bytes = space.total_bytes, .used_bytes = space.used_bytes});
+    }
+    return spaces;
+}
+
+auto read_device_size(int fd, std::uint64_t max_devid) noexcept -> std::uint64_t {
+    std::uint64_t device_size{};
+    for (std::uint64_t devid = 1; devid <= max_devid; ++devid) {
+        btrfs_ioctl_dev_info_args dev_args{};
+        dev_args.devid = devid;
+        // removed devices leave holes in the IDs
+        if (::ioctl(fd, BTRFS_IOC_DEV_INFO, &dev_args) != 0) {
+            continue;
+        }
+        device_size += dev_args.total_bytes;
+    }
+    return device_size;
+}
 
 }  // namespace
 
@@ -164,41 +475,28 @@ auto list_btrfs_subvolumes(std::string_view mountpoint, std::string_view filter_
         return {};
     }
 
-    const auto& output = utils::exec(fmt::format(FMT_COMPILE("btrfs subvolume list -o '{}' 2>/dev/null"), mountpoint));
-    if (output.empty()) {
+    const ScopedFd fd{open_btrfs_dir(mountpoint)};
+    if (!fd.valid()) {
+        return {};
+    }
+    const auto subvolume_id = subvolume_id_of(fd.get());
+    const auto records      = read_root_records(fd.get());
+    if (!subvolume_id || !records) {
         return {};
     }
 
-    constexpr auto extract_path = [](std::string_view line) -> std::optional<std::string_view> {
-        auto pos = line.find("path "sv);
-        if (pos == std::string_view::npos) {
-            return std::nullopt;
-        }
-        auto subvol_path = line.substr(pos + 5);
-        if (subvol_path.empty()) {
-            return std::nullopt;
+    // only the direct children of the mounted subvolume, like `btrfs subvolume list -o`
+    std::vector<BtrfsSubvolume> result{};
+    for (auto& info : btrfs_query_detail::resolve_subvolume_paths(*records, filter_prefix)) {
+        if (info.parent_id != *subvolume_id) {
+            continue;
         }
-        return subvol_path;
-    };
-
-    const auto matches_prefix = [filter_prefix](std::string_view path) {
-        return filter_prefix.empty() || path.starts_with(filter_prefix);
-    };
-
-    constexpr auto to_subvolume = [](std::string_view path) -> BtrfsSubvolume {
         BtrfsSubvolume subvol{};
-        subvol.subvolume  = std::string{path};
+        subvol.subvolume  = std::move(info.path);
         subvol.mountpoint = fmt::format(FMT_COMPILE("/{0}"), subvol.subvolume);
-        return subvol;
-    };
-
-    return utils::make_split_view(output)
-        | std::ranges::views::transform(extract_path)
-        | std::ranges::views::filter(&std::optional<std::string_view>::has_value)
-        | std::ranges::views::transform([](auto&& opt) { return *opt; })
-        | std::ranges::views::filter(matches_prefix)
-        | std::ranges::views::transform(to_subvolume)
-        | std::ranges::to<std::vector<BtrfsSubvolume>>();
+        result.emplace_back(std::move(subvol));
+    }
+    return result;
 }
 
 auto list_btrfs_snapshots(std::string_view mountpoint, std::string_view filter_prefix) noexcept -> std::vector<BtrfsSubvolumeInfo> {
@@ -218,55 +516,52 @@ auto list_btrfs_subvolumes_detailed(std::string_view mountpoint, std::string_vie
         return {};
     }
 
-    const auto& output = utils::exec(fmt::format(FMT_COMPILE("btrfs subvolume list -puq '{}' 2>/dev/null"), mountpoint));
-    if (output.empty()) {
+    const ScopedFd fd{open_btrfs_dir(mountpoint)};
+    if (!fd.valid()) {
         return {};
     }
-
-    return btrfs_query_detail::parse_subvolume_list(output, filter_prefix);
+    const auto records = read_root_records(fd.get());
+    if (!records) {
+        return {};
+    }
+    return btrfs_query_detail::resolve_subvolume_paths(*records, filter_prefix);
 }
 
 auto get_btrfs_info(std::string_view mountpoint_or_device) noexcept -> std::optional<BtrfsFilesystemInfo> {
-    using utils::extract_after;
-    using utils::ltrim;
-    using utils::parse_uint;
-
     if (mountpoint_or_device.empty()) {
         return std::nullopt;
     }
 
-    BtrfsFilesystemInfo info{};
-    info.device = std::string{mountpoint_or_device};
-
-    const auto& usage_output = utils::exec(fmt::format(FMT_COMPILE("btrfs filesystem usage -b '{}' 2>/dev/null"), mountpoint_or_device));
-    if (!usage_output.empty()) {
-        std::ranges::for_each(utils::make_split_view(usage_output), [&](std::string_view line) {
-            for (const auto& field : usage_fields) {
-                if (auto val = extract_after(line, field.prefix, '\n')) {
-                    field.assign(info, parse_uint<std::uint64_t>(ltrim(*val)).value_or(0));
-                    break;
-                }
-            }
-        });
+    // the ioctls need the mounted filesystem
+    const auto path = resolve_btrfs_path(mountpoint_or_device);
+    if (!path) {
+        spdlog::debug("{} is not a mounted btrfs", mountpoint_or_device);
+        return std::nullopt;
+    }
+    const ScopedFd fd{open_btrfs_dir(*path)};
+    if (!fd.valid()) {
+        return std::nullopt;
     }
 
-    const auto& df_output = utils::exec(fmt::format(FMT_COMPILE("btrfs filesystem df '{}' 2>/dev/null"), mountpoint_or_device));
-    if (!df_output.empty()) {
-        parse_btrfs_df_output(df_output, info);
+    btrfs_ioctl_fs_info_args fs_info{};
+    if (::ioctl(fd.get(), BTRFS_IOC_FS_INFO, &fs_info) != 0) {
+        spdlog::debug("btrfs fs info of {} failed: {}", *path, std::strerror(errno));
+        return std::nullopt;
     }
 
-    const auto& show_output = utils::exec(fmt::format(FMT_COMPILE("btrfs filesystem show '{}' 2>/dev/null"), mountpoint_or_device));
-    if (!show_output.empty()) {
-        std::ranges::for_each(utils::make_split_view(show_output), [&](std::string_view line) {
-            for (const auto& field : show_fields) {
-                if (line.contains(field.marker)) {
-                    field.assign(info, line);
-                    break;
-                }
-            }
-        });
+    BtrfsFilesystemInfo info{};
+    info.device = std::string{mountpoint_or_device};
+    info.uuid   = format_uuid(fs_info.fsid);
+
+    // the generic VFS ioctl, BTRFS_IOC_GET_FSLABEL is only an alias of it
+    std::array<char, FSLABEL_MAX> label{};
+    if (::ioctl(fd.get(), FS_IOC_GETFSLABEL, label.data()) == 0 && label[0] != '\0') {
+        info.label = std::string{label.data(), ::strnlen(label.data(), label.size())};
     }
 
+    if (const auto spaces = read_space_usage(fd.get())) {
+        btrfs_query_detail::apply_space_usage(info, *spaces, read_device_size(fd.get(), fs_info.max_id));
+    }
     return std::make_optional(std::move(info));
 }
 
@@ -275,8 +570,11 @@ auto is_btrfs(std::string_view path) noexcept -> bool {
         return false;
     }
 
-    const auto& output = utils::exec(fmt::format(FMT_COMPILE("stat -f -c %T '{}' 2>/dev/null"), path));
-    return output.contains("btrfs");
+    struct statfs fs_stat{};
+    if (::statfs(std::string{path}.c_str(), &fs_stat) != 0) {
+        return false;
+    }
+    return static_cast<std::uint64_t>(fs_stat.f_type) == BTRFS_SUPER_MAGIC;
 }
 
 }  // namespace gucc::fs
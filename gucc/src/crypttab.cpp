@@ -46,6 +46,12 @@ auto gen_crypttab_entry(const Partition& partition, std::string_view crypttab_op
         crypt_password = "none"s;
         crypt_options  = ""s;
     }
+    // dm-crypt flags of the volume itself are kept either way
+    if (partition.luks_crypttab_opts && !partition.luks_crypttab_opts->empty()) {
+        crypt_options = crypt_options.empty()
+            ? fmt::format(FMT_COMPILE(" {}"), *partition.luks_crypttab_opts)
+            : fmt::format(FMT_COMPILE("{},{}"), crypt_options, *partition.luks_crypttab_opts);
+    }
 
     const auto& device_str = fmt::format(FMT_COMPILE("UUID={}"), *partition.luks_uuid);
     return std::make_optional<std::string>(fmt::format(FMT_COMPILE("{:21} {:<45} {}{}\n"), *partition.luks_mapper_name, device_str, crypt_password, crypt_options));
@@ -0,0 +1,196 @@
+#include "gucc/disk_topology.hpp"
+#include "gucc/system_query.hpp"
+
+#include <fcntl.h>             // for open, O_RDONLY
+#include <linux/nvme_ioctl.h>  // for nvme_admin_cmd, NVME_IOCTL_ID
+#include <sys/ioctl.h>         // for ioctl
+#include <unistd.h>            // for close
+
+#include <algorithm>  // for any_of, min
+#include <array>      // for array
+#include <fstream>    // for ifstream
+#include <numeric>    // for lcm
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include <spdlog/spdlog.h>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+inline constexpr std::uint64_t DEFAULT_ALIGNMENT = 1024 * 1024;
+// some USB bridges report nonsense like 33553920 for optimal_io_size
+inline constexpr std::uint64_t MAX_ALIGNMENT = 64 * 1024 * 1024;
+
+inline constexpr std::uint8_t NVME_ADMIN_IDENTIFY = 0x06;
+inline constexpr std::uint32_t NVME_ID_NS_SIZE    = 4096;
+inline constexpr std::size_t NVME_ID_NS_NLBAF     = 25;
+inline constexpr std::size_t NVME_ID_NS_FLBAS     = 26;
+inline constexpr std::size_t NVME_ID_NS_LBAF      = 128;
+inline constexpr std::size_t NVME_MAX_LBAF        = 64;
+
+// Note: can't use file_utils::read_whole_file because sysfs files report size 0
+auto read_sysfs_uint(std::string_view path) noexcept -> std::optional<std::uint32_t> {
+    std::ifstream file{std::string{path}};
+    std::uint64_t value{};
+    if (!(file >> value)) {
+        return std::nullopt;
+    }
+    return static_cast<std::uint32_t>(value);
+}
+
+auto query_nvme_lba_formats(std::string_view device) noexcept -> std::vector<gucc::disk::NvmeLbaFormat> {
+    const int fd = ::open(std::string{device}.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return {};
+    }
+
+    std::vector<gucc::disk::NvmeLbaFormat> formats{};
+    const int nsid = ::ioctl(fd, NVME_IOCTL_ID);
+    if (nsid > 0) {
+        std::array<std::uint8_t, NVME_ID_NS_SIZE> id_ns{};
+
+        nvme_admin_cmd cmd{};
+        cmd.opcode   = NVME_ADMIN_IDENTIFY;
+        cmd.nsid     = static_cast<std::uint32_t>(nsid);
+        cmd.addr     = reinterpret_cast<std::uintptr_t>(id_ns.data());
+        cmd.data_len = NVME_ID_NS_SIZE;
+        // CNS 0: identify namespace
+        cmd.cdw10 = 0;
+        if (::ioctl(fd, NVME_IOCTL_ADMIN_CMD, &cmd) == 0) {
+            formats = gucc::disk::detail::parse_nvme_id_ns_lba_formats(id_ns);
+        } else {
+            spdlog::debug("NVMe identify namespace failed on '{}'", device);
+        }
+    }
+    ::close(fd);
+    return formats;
+}
+
+}  // namespace
+
+namespace gucc::disk {
+
+auto query_disk_topology(std::string_view device) noexcept -> std::optional<DiskTopology> {
+    const auto disk_name  = get_disk_name_from_device(device);
+    const auto sysfs_root = fmt::format(FMT_COMPILE("/sys/class/block/{}"), disk_name);
+
+    const auto logical_block_size = read_sysfs_uint(fmt::format(FMT_COMPILE("{}/queue/logical_block_size"), sysfs_root));
+    if (!logical_block_size || *logical_block_size == 0) {
+        return std::nullopt;
+    }
+
+    DiskTopology topology{};
+    topology.logical_block_size  = *logical_block_size;
+    topology.physical_block_size = read_sysfs_uint(fmt::format(FMT_COMPILE("{}/queue/physical_block_size"), sysfs_root)).value_or(*logical_block_size);
+    topology.minimum_io_size     = read_sysfs_uint(fmt::format(FMT_COMPILE("{}/queue/minimum_io_size"), sysfs_root)).value_or(0);
+    topology.optimal_io_size     = read_sysfs_uint(fmt::format(FMT_COMPILE("{}/queue/optimal_io_size"), sysfs_root)).value_or(0);
+    topology.alignment_offset    = read_sysfs_uint(fmt::format(FMT_COMPILE("{}/alignment_offset"), sysfs_root)).value_or(0);
+    topology.raid_chunk_size     = read_sysfs_uint(fmt::format(FMT_COMPILE("{}/md/chunk_size"), sysfs_root)).value_or(0);
+
+    if (disk_name.starts_with("nvme"sv)) {
+        topology.nvme_lba_formats = query_nvme_lba_formats(fmt::format(FMT_COMPILE("/dev/{}"), disk_name));
+    }
+    return topology;
+}
+
+auto compute_partition_alignment(const DiskTopology& topology) noexcept -> std::uint64_t {
+    std::uint64_t alignment = DEFAULT_ALIGNMENT;
+    if (topology.logical_block_size == 0) {
+        return alignment;
+    }
+
+    const std::array<std::uint64_t, 4> io_hints{
+        topology.physical_block_size,
+        topology.minimum_io_size,
+        topology.optimal_io_size,
+        topology.raid_chunk_size,
+    };
+    for (const auto hint : io_hints) {
+        if (hint == 0 || (hint % topology.logical_block_size) != 0) {
+            continue;
+        }
+        const auto candidate = std::lcm(alignment, hint);
+        if (candidate > MAX_ALIGNMENT) {
+            spdlog::debug("ignoring I/O hint of {} bytes, alignment would grow to {} bytes", hint, candidate);
+            continue;
+        }
+        alignment = candidate;
+    }
+    return alignment;
+}
+
+auto is_512e(const DiskTopology& topology) noexcept -> bool {
+    return topology.logical_block_size == 512 && topology.physical_block_size >= 4096;
+}
+
+auto find_native_4k_lba_format(const DiskTopology& topology) noexcept -> std::optional<NvmeLbaFormat> {
+    std::optional<NvmeLbaFormat> best{};
+    for (const auto& format : topology.nvme_lba_formats) {
+        if (format.data_size != 4096 || format.metadata_size != 0) {
+            continue;
+        }
+        if (!best || format.relative_performance < best->relative_performance) {
+            best = format;
+        }
+    }
+    return best;
+}
+
+auto get_topology_warnings(std::string_view device, const DiskTopology& topology) noexcept -> std::vector<std::string> {
+    std::vector<std::string> warnings{};
+
+    const auto native_4k = find_native_4k_lba_format(topology);
+    const bool in_512    = std::ranges::any_of(topology.nvme_lba_formats, [](const auto& format) { return format.in_use && format.data_size == 512; });
+    if (native_4k && in_512) {
+        warnings.emplace_back(fmt::format(FMT_COMPILE("'{}' is formatted with 512 byte LBAs, 4Kn is available (nvme format --lbaf={}); reformatting erases the namespace"), device, native_4k->index));
+    } else if (is_512e(topology)) {
+        warnings.emplace_back(fmt::format(FMT_COMPILE("'{}' emulates 512 byte sectors on {} byte physical sectors (512e)"), device, topology.physical_block_size));
+    }
+    if (topology.alignment_offset != 0) {
+        warnings.emplace_back(fmt::format(FMT_COMPILE("'{}' reports a non-zero alignment offset of {} bytes"), device, topology.alignment_offset));
+    }
+    return warnings;
+}
+
+}  // namespace gucc::disk
+
+namespace gucc::disk::detail {
+
+auto parse_nvme_id_ns_lba_formats(std::span<const std::uint8_t> id_ns) noexcept -> std::vector<NvmeLbaFormat> {
+    std::vector<NvmeLbaFormat> formats{};
+    if (id_ns.size() < NVME_ID_NS_LBAF) {
+        return formats;
+    }
+
+    // NLBAF is zero-based
+    const auto count = std::min<std::size_t>(static_cast<std::size_t>(id_ns[NVME_ID_NS_NLBAF]) + 1, NVME_MAX_LBAF);
+    // FLBAS bits 3:0 are the low index, bits 6:5 the high one (> 16 formats)
+    const auto flbas  = id_ns[NVME_ID_NS_FLBAS];
+    const auto in_use = static_cast<std::uint32_t>((flbas & 0x0FU) | ((flbas & 0x60U) >> 1U));
+
+    for (std::size_t index = 0; index < count; ++index) {
+        const auto offset = NVME_ID_NS_LBAF + (index * 4);
+        if (offset + 4 > id_ns.size()) {
+            break;
+        }
+        const auto metadata_size = static_cast<std::uint16_t>(id_ns[offset] | (id_ns[offset + 1] << 8U));
+        const auto lbads         = id_ns[offset + 2];
+        // unused entries report LBADS 0, the minimum valid one is 9 (512 bytes)
+        if (lbads < 9 || lbads > 31) {
+            continue;
+        }
+        formats.emplace_back(NvmeLbaFormat{
+            .index                = static_cast<std::uint32_t>(index),
+            .data_size            = 1U << lbads,
+            .metadata_size        = metadata_size,
+            .relative_performance = static_cast<std::uint8_t>(id_ns[offset + 3] & 0x03U),
+            .in_use               = index == in_use,
+        });
+    }
+    return formats;
+}
+
+}  // namespace gucc::disk::detail
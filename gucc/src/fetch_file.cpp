@@ -1,16 +1,195 @@
 #include "gucc/fetch_file.hpp"
+#include "gucc/file_utils.hpp"
+#include "gucc/sha256.hpp"
+#include "gucc/string_utils.hpp"
 
-#include <chrono>  // for chrono_literals
+#include <algorithm>           // for max
+#include <atomic>              // for atomic_bool
+#include <condition_variable>  // for condition_variable
+#include <filesystem>          // for path, exists, last_write_time, create_directories
+#include <mutex>               // for mutex, lock_guard, unique_lock
+#include <thread>              // for jthread
+#include <utility>             // for move, pair
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include <spdlog/spdlog.h>
 
 #include <cpr/api.h>
+#include <cpr/callback.h>
+#include <cpr/cprtypes.h>
 #include <cpr/response.h>
+#include <cpr/session.h>
 #include <cpr/status_codes.h>
 #include <cpr/timeout.h>
 
 using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+inline constexpr auto FILE_URL_PREFIX = "file://"sv;
+
+using gucc::fetch::FetchedFile;
+using gucc::fetch::FetchOptions;
+using gucc::fetch::FetchSource;
+using gucc::fetch::detail::CacheMeta;
+
+auto unix_now() noexcept -> std::int64_t {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+auto is_remote(std::string_view url) noexcept -> bool {
+    return url.starts_with("http://"sv) || url.starts_with("https://"sv);
+}
+
+// {body, meta}
+auto cache_paths(const FetchOptions& options, std::string_view url) noexcept -> std::pair<fs::path, fs::path> {
+    const auto& key = gucc::fetch::detail::cache_key(url);
+    const fs::path cache_dir{options.cache_dir};
+    return {cache_dir / fmt::format(FMT_COMPILE("{}.body"), key), cache_dir / fmt::format(FMT_COMPILE("{}.meta"), key)};
+}
+
+auto load_cache_meta(const FetchOptions& options, std::string_view url) noexcept -> std::optional<CacheMeta> {
+    if (options.cache_dir.empty()) {
+        return std::nullopt;
+    }
+    const auto& [body_path, meta_path] = cache_paths(options, url);
+    std::error_code ec;
+    if (!fs::exists(body_path, ec) || !fs::exists(meta_path, ec)) {
+        return std::nullopt;
+    }
+    auto meta = gucc::fetch::detail::parse_cache_meta(gucc::file_utils::read_whole_file(meta_path.string()));
+    if (!meta || meta->url != url) {
+        return std::nullopt;
+    }
+    return meta;
+}
+
+auto load_cache_body(const FetchOptions& options, std::string_view url) noexcept -> std::optional<std::string> {
+    auto body = gucc::file_utils::read_whole_file(cache_paths(options, url).first.string());
+    if (body.empty()) {
+        return std::nullopt;
+    }
+    return body;
+}
+
+// a failure here only costs a full download next time
+void store_cache(const FetchOptions& options, const CacheMeta& meta, std::optional<std::string_view> body) noexcept {
+    if (options.cache_dir.empty()) {
+        return;
+    }
+    std::error_code ec;
+    fs::create_directories(options.cache_dir, ec);
+    const auto& [body_path, meta_path] = cache_paths(options, meta.url);
+    // the meta goes last, a body without it is never used
+    if (ec || (body && !gucc::file_utils::create_file_for_overwrite(body_path.string(), *body))
+        || !gucc::file_utils::create_file_for_overwrite(meta_path.string(), gucc::fetch::detail::render_cache_meta(meta))) {
+        spdlog::debug("Failed to cache '{}' in '{}'", meta.url, options.cache_dir);
+    }
+}
+
+auto header_value(const cpr::Response& response, const std::string& name) noexcept -> std::string {
+    const auto it = response.header.find(name);
+    return (it != response.header.end()) ? it->second : std::string{};
+}
+
+auto fetch_local(std::string_view url) noexcept -> std::optional<FetchedFile> {
+    const std::string file_path{url.substr(FILE_URL_PREFIX.size())};
+    std::error_code ec;
+    if (!fs::exists(file_path, ec)) {
+        return std::nullopt;
+    }
+    auto content = gucc::file_utils::read_whole_file(file_path);
+    if (content.empty()) {
+        return std::nullopt;
+    }
+
+    const auto modified = fs::last_write_time(file_path, ec);
+    const auto age      = ec ? std::chrono::seconds{} : std::chrono::duration_cast<std::chrono::seconds>(fs::file_time_type::clock::now() - modified);
+    return FetchedFile{.content = std::move(content), .url = std::string{url}, .source = FetchSource::Fallback, .age = std::max(age, std::chrono::seconds{})};
+}
+
+auto fetch_remote(std::string_view url, FetchSource source, const FetchOptions& options, const std::atomic_bool& abort) noexcept -> std::optional<FetchedFile> {
+    const auto& cached = load_cache_meta(options, url);
+
+    cpr::Header header{};
+    if (cached && !cached->etag.empty()) {
+        header.emplace("If-None-Match", cached->etag);
+    }
+    if (cached && !cached->last_modified.empty()) {
+        header.emplace("If-Modified-Since", cached->last_modified);
+    }
+
+    cpr::Session session{};
+    session.SetUrl(cpr::Url{url});
+    session.SetTimeout(cpr::Timeout{options.timeout});
+    session.SetHeader(header);
+    // the other url won the race
+    session.SetProgressCallback(cpr::ProgressCallback{[&abort](cpr::cpr_off_t, cpr::cpr_off_t, cpr::cpr_off_t, cpr::cpr_off_t, intptr_t) {
+        return !abort.load();
+    }});
+
+    auto response = session.Get();
+    if (response.error.code != cpr::ErrorCode::OK) {
+        return std::nullopt;
+    }
+    if (response.status_code == 304 && cached) {
+        auto body = load_cache_body(options, url);
+        if (!body) {
+            return std::nullopt;
+        }
+        auto meta         = *cached;
+        meta.validated_at = unix_now();
+        store_cache(options, meta, std::nullopt);
+        return FetchedFile{.content = std::move(*body), .url = std::string{url}, .source = FetchSource::Revalidated};
+    }
+    if (!cpr::status::is_success(static_cast<std::int32_t>(response.status_code)) || response.text.empty()) {
+        return std::nullopt;
+    }
+
+    const CacheMeta meta{
+        .url           = std::string{url},
+        .etag          = header_value(response, "ETag"),
+        .last_modified = header_value(response, "Last-Modified"),
+        .validated_at  = unix_now(),
+    };
+    store_cache(options, meta, response.text);
+    return FetchedFile{.content = std::move(response.text), .url = std::string{url}, .source = source};
+}
+
+auto fetch_stale(std::string_view url, const FetchOptions& options) noexcept -> std::optional<FetchedFile> {
+    const auto& cached = load_cache_meta(options, url);
+    if (!cached) {
+        return std::nullopt;
+    }
+    auto body = load_cache_body(options, url);
+    if (!body) {
+        return std::nullopt;
+    }
+    const std::chrono::seconds age{std::max(unix_now() - cached->validated_at, std::int64_t{0})};
+    return FetchedFile{.content = std::move(*body), .url = std::string{url}, .source = FetchSource::Stale, .age = age};
+}
+
+}  // namespace
 
 namespace gucc::fetch {
 
+auto fetch_source_to_string(FetchSource source) noexcept -> std::string_view {
+    switch (source) {
+    case FetchSource::Primary:
+        return "primary"sv;
+    case FetchSource::Revalidated:
+        return "revalidated"sv;
+    case FetchSource::Fallback:
+        return "fallback"sv;
+    case FetchSource::Stale:
+        return "stale"sv;
+    }
+    return {};
+}
+
 auto fetch_file(std::string_view url) noexcept -> std::optional<std::string> {
     using namespace std::chrono_literals;
 
@@ -18,24 +197,130 @@ auto fetch_file(std::string_view url) noexcept -> std::optional<std::string> {
     auto response    = cpr::Get(cpr::Url{url}, timeout);
     auto status_code = static_cast<std::int32_t>(response.status_code);
 
-    static constexpr auto FILE_URL_PREFIX = "file://"sv;
     if (cpr::status::is_success(status_code) || (url.starts_with(FILE_URL_PREFIX) && status_code == 0 && !response.text.empty())) {
         return std::make_optional<std::string>(std::move(response.text));
     }
     return std::nullopt;
 }
 
-auto fetch_file_from_url(std::string_view url, std::string_view fallback_url) noexcept -> std::optional<std::string> {
-    auto fetch_content = fetch_file(url);
-    if (fetch_content) {
-        return std::make_optional<std::string>(std::move(*fetch_content));
+auto fetch_file_hedged(std::string_view url, std::string_view fallback_url, const FetchOptions& options) noexcept -> std::optional<FetchedFile> {
+    struct Race final {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::optional<FetchedFile> winner;
+        std::size_t started{};
+        std::size_t finished{};
+    };
+    Race race{};
+    std::atomic_bool abort{false};
+
+    const auto attempt = [&](std::string_view attempt_url, FetchSource source) {
+        std::optional<FetchedFile> fetched{};
+        if (is_remote(attempt_url)) {
+            fetched = fetch_remote(attempt_url, source, options, abort);
+        } else if (attempt_url.starts_with(FILE_URL_PREFIX)) {
+            fetched = fetch_local(attempt_url);
+        }
+        {
+            const std::lock_guard lock{race.mutex};
+            ++race.finished;
+            if (fetched && !race.winner) {
+                race.winner = std::move(fetched);
+                abort       = true;
+            }
+        }
+        race.cv.notify_all();
+    };
+    const auto settled = [&race] { return race.winner.has_value() || race.finished == race.started; };
+
+    // declared after the race, they are joined before it goes away
+    std::jthread primary{};
+    std::jthread fallback{};
+    {
+        std::unique_lock lock{race.mutex};
+        if (!url.empty()) {
+            ++race.started;
+            primary = std::jthread(attempt, url, FetchSource::Primary);
+        }
+        // a primary failing early doesn't wait for the delay
+        race.cv.wait_for(lock, options.hedge_delay, settled);
+        if (!race.winner && !fallback_url.empty() && fallback_url != url) {
+            ++race.started;
+            fallback = std::jthread(attempt, fallback_url, FetchSource::Fallback);
+        }
+        race.cv.wait(lock, settled);
+    }
+    abort = true;
+    if (primary.joinable()) {
+        primary.join();
+    }
+    if (fallback.joinable()) {
+        fallback.join();
     }
 
-    fetch_content = fetch_file(fallback_url);
-    if (fetch_content) {
-        return std::make_optional<std::string>(std::move(*fetch_content));
+    if (race.winner) {
+        spdlog::debug("Fetched '{}' ({}, {}s old)", race.winner->url, fetch_source_to_string(race.winner->source), race.winner->age.count());
+        return std::move(race.winner);
+    }
+    for (const auto& candidate : {url, fallback_url}) {
+        if (!is_remote(candidate)) {
+            continue;
+        }
+        if (auto stale = fetch_stale(candidate, options)) {
+            spdlog::warn("'{}' is unreachable, using the copy from {}s ago", candidate, stale->age.count());
+            return stale;
+        }
     }
     return std::nullopt;
 }
 
+auto fetch_file_from_url(std::string_view url, std::string_view fallback_url) noexcept -> std::optional<std::string> {
+    auto fetched = fetch_file_hedged(url, fallback_url);
+    if (!fetched) {
+        return std::nullopt;
+    }
+    return std::make_optional<std::string>(std::move(fetched->content));
+}
+
 }  // namespace gucc::fetch
+
+namespace gucc::fetch::detail {
+
+auto cache_key(std::string_view url) noexcept -> std::string {
+    return hash::sha256_hex(url).substr(0, 32);
+}
+
+auto render_cache_meta(const CacheMeta& meta) noexcept -> std::string {
+    return fmt::format(FMT_COMPILE("url = {}\netag = {}\nlast_modified = {}\nvalidated_at = {}\n"),
+        meta.url, meta.etag, meta.last_modified, meta.validated_at);
+}
+
+auto parse_cache_meta(std::string_view content) noexcept -> std::optional<CacheMeta> {
+    CacheMeta meta{};
+    bool has_validated_at{false};
+    for (auto&& line : utils::make_split_view(content)) {
+        const auto eq_pos = line.find(" = "sv);
+        if (eq_pos == std::string_view::npos) {
+            continue;
+        }
+        const auto& key   = line.substr(0, eq_pos);
+        const auto& value = line.substr(eq_pos + 3);
+        if (key == "url"sv) {
+            meta.url = std::string{value};
+        } else if (key == "etag"sv) {
+            meta.etag = std::string{value};
+        } else if (key == "last_modified"sv) {
+            meta.last_modified = std::string{value};
+        } else if (key == "validated_at"sv) {
+            const auto validated_at = utils::parse_uint<std::uint64_t>(value);
+            has_validated_at        = validated_at.has_value();
+            meta.validated_at       = static_cast<std::int64_t>(validated_at.value_or(0));
+        }
+    }
+    if (meta.url.empty() || !has_validated_at) {
+        return std::nullopt;
+    }
+    return meta;
+}
+
+}  // namespace gucc::fetch::detail
@@ -0,0 +1,227 @@
+#include "gucc/fs_tuning.hpp"
+
+#include <string>  // for string
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+using namespace std::string_view_literals;
+using namespace std::string_literals;
+
+namespace {
+
+inline constexpr std::uint64_t FS_BLOCK_SIZE = 4096;
+// same cap compute_partition_alignment uses against bogus hints
+inline constexpr std::uint64_t MAX_STRIPE_CHUNK = 64 * 1024 * 1024;
+// above that, zeroing the ext4 inode tables (1/64 of the device) at mkfs time takes too long
+inline constexpr std::uint64_t EAGER_ITABLE_INIT_MAX_SIZE = 256ULL * 1024 * 1024 * 1024;
+
+struct StripeGeometry final {
+    std::uint64_t chunk_bytes{};
+    std::uint64_t data_disks{1};
+};
+
+auto get_stripe_geometry(const gucc::disk::DiskTopology& topology) noexcept -> std::optional<StripeGeometry> {
+    const std::uint64_t chunk = (topology.raid_chunk_size != 0) ? topology.raid_chunk_size : topology.minimum_io_size;
+    // a minimum I/O size of one physical block is not a stripe
+    if (chunk <= topology.physical_block_size || chunk > MAX_STRIPE_CHUNK || (chunk % FS_BLOCK_SIZE) != 0) {
+        return std::nullopt;
+    }
+
+    StripeGeometry geometry{.chunk_bytes = chunk};
+    if (topology.optimal_io_size > chunk && (topology.optimal_io_size % chunk) == 0) {
+        geometry.data_disks = topology.optimal_io_size / chunk;
+    }
+    return geometry;
+}
+
+constexpr auto is_flash(gucc::fs::DeviceClass device_class) noexcept -> bool {
+    using gucc::fs::DeviceClass;
+    return device_class == DeviceClass::Nvme || device_class == DeviceClass::Ssd;
+}
+
+auto get_ext4_tuning(gucc::fs::DeviceClass device_class, const gucc::fs::DeviceProfile& profile) noexcept -> gucc::fs::FsTuning {
+    using gucc::fs::DeviceClass;
+
+    std::string extended_opts{};
+    if (const auto stripe = get_stripe_geometry(profile.topology)) {
+        const auto stride = stripe->chunk_bytes / FS_BLOCK_SIZE;
+        extended_opts     = fmt::format(FMT_COMPILE("stride={},stripe_width={}"), stride, stride * stripe->data_disks);
+    }
+    // flash finishes the inode tables in seconds, instead of ext4lazyinit
+    // competing with package installation after the first mount
+    if (is_flash(device_class) && profile.size_bytes != 0 && profile.size_bytes <= EAGER_ITABLE_INIT_MAX_SIZE) {
+        extended_opts += extended_opts.empty() ? ""sv : ","sv;
+        extended_opts += "lazy_itable_init=0,lazy_journal_init=0"sv;
+    }
+
+    gucc::fs::FsTuning tuning{.mkfs_command = "mkfs.ext4 -q"s, .mount_opts = "defaults,noatime,lazytime"s};
+    if (!extended_opts.empty()) {
+        tuning.mkfs_command += fmt::format(FMT_COMPILE(" -E {}"), extended_opts);
+    }
+    if (device_class == DeviceClass::Removable) {
+        tuning.mount_opts += ",commit=60"sv;
+    }
+    return tuning;
+}
+
+auto get_xfs_tuning(const gucc::fs::DeviceProfile& profile) noexcept -> gucc::fs::FsTuning {
+    gucc::fs::FsTuning tuning{
+        .mkfs_command = "mkfs.xfs -f"s,
+        .mount_opts   = gucc::fs::get_default_mount_opts(gucc::fs::FilesystemType::Xfs, !profile.is_rotational),
+    };
+    if (const auto stripe = get_stripe_geometry(profile.topology)) {
+        tuning.mkfs_command += fmt::format(FMT_COMPILE(" -d su={}k,sw={}"), stripe->chunk_bytes / 1024, stripe->data_disks);
+    }
+    return tuning;
+}
+
+auto get_btrfs_tuning(gucc::fs::DeviceClass device_class, bool read_by_bootloader) noexcept -> gucc::fs::FsTuning {
+    using gucc::fs::DeviceClass;
+
+    gucc::fs::FsTuning tuning{.mkfs_command = "mkfs.btrfs -f"s, .mount_opts = "defaults,noatime"s};
+    switch (device_class) {
+    case DeviceClass::Nvme:
+    case DeviceClass::Ssd:
+    case DeviceClass::Virtual:
+        // GRUB only verifies crc32c
+        if (!read_by_bootloader) {
+            tuning.mkfs_command += " --csum xxhash"sv;
+        }
+        // NOTE: virtual disks are usually thin-provisioned, discard gives the space back to the host
+        tuning.mount_opts += ",compress=zstd:1,discard=async"sv;
+        break;
+    case DeviceClass::Hdd:
+        // bigger metadata nodes, fewer seeks per tree walk
+        tuning.mkfs_command += " --nodesize 32k"sv;
+        tuning.mount_opts += ",compress=zstd:3"sv;
+        break;
+    case DeviceClass::Removable:
+        tuning.mount_opts += ",lazytime,compress=zstd:3,commit=60"sv;
+        break;
+    case DeviceClass::Generic:
+    default:
+        break;
+    }
+    return tuning;
+}
+
+auto get_f2fs_tuning(gucc::fs::DeviceClass device_class, bool read_by_bootloader) noexcept -> gucc::fs::FsTuning {
+    using gucc::fs::DeviceClass;
+
+    gucc::fs::FsTuning tuning{
+        .mkfs_command = "mkfs.f2fs -q -O extra_attr,inode_checksum,sb_checksum"s,
+        .mount_opts   = "defaults,lazytime,gc_merge"s,
+    };
+    // GRUB can't read compressed f2fs files
+    if (!read_by_bootloader) {
+        tuning.mkfs_command += ",compression"sv;
+        tuning.mount_opts += ",compress_algorithm=lz4,compress_chksum"sv;
+    }
+    if (device_class == DeviceClass::Removable) {
+        tuning.mount_opts += ",flush_merge"sv;
+    }
+    return tuning;
+}
+
+}  // namespace
+
+namespace gucc::fs {
+
+auto device_class_to_string(DeviceClass device_class) noexcept -> std::string_view {
+    switch (device_class) {
+    case DeviceClass::Nvme:
+        return "nvme"sv;
+    case DeviceClass::Ssd:
+        return "ssd"sv;
+    case DeviceClass::Hdd:
+        return "hdd"sv;
+    case DeviceClass::Removable:
+        return "removable"sv;
+    case DeviceClass::Virtual:
+        return "virtual"sv;
+    case DeviceClass::Generic:
+    default:
+        return "generic"sv;
+    }
+}
+
+auto string_to_device_class(std::string_view class_name) noexcept -> std::optional<DeviceClass> {
+    if (class_name == "nvme"sv) {
+        return DeviceClass::Nvme;
+    } else if (class_name == "ssd"sv) {
+        return DeviceClass::Ssd;
+    } else if (class_name == "hdd"sv) {
+        return DeviceClass::Hdd;
+    } else if (class_name == "removable"sv) {
+        return DeviceClass::Removable;
+    } else if (class_name == "virtual"sv) {
+        return DeviceClass::Virtual;
+    } else if (class_name == "generic"sv) {
+        return DeviceClass::Generic;
+    }
+    return std::nullopt;
+}
+
+auto query_device_profile(std::string_view device) noexcept -> std::optional<DeviceProfile> {
+    const auto& disk_info = disk::get_disk_info(device);
+    if (!disk_info) {
+        return std::nullopt;
+    }
+
+    return DeviceProfile{
+        .transport     = disk_info->transport,
+        .is_rotational = !disk_info->is_ssd,
+        .is_removable  = disk_info->is_removable,
+        .size_bytes    = disk_info->size,
+        .topology      = disk::query_disk_topology(device).value_or(disk::DiskTopology{}),
+    };
+}
+
+auto classify_device(const DeviceProfile& profile) noexcept -> DeviceClass {
+    using disk::DiskTransport;
+
+    if (profile.is_removable || profile.transport == DiskTransport::Usb) {
+        return DeviceClass::Removable;
+    }
+    switch (profile.transport) {
+    case DiskTransport::Nvme:
+        return DeviceClass::Nvme;
+    case DiskTransport::Virtio:
+        return DeviceClass::Virtual;
+    case DiskTransport::Sata:
+    case DiskTransport::Scsi:
+        return profile.is_rotational ? DeviceClass::Hdd : DeviceClass::Ssd;
+    case DiskTransport::Usb:
+    case DiskTransport::Unknown:
+    default:
+        return DeviceClass::Generic;
+    }
+}
+
+auto get_fs_tuning(FilesystemType fs_type, DeviceClass device_class, const DeviceProfile& profile, bool read_by_bootloader) noexcept -> FsTuning {
+    if (device_class != DeviceClass::Generic) {
+        switch (fs_type) {
+        case FilesystemType::Btrfs:
+            return get_btrfs_tuning(device_class, read_by_bootloader);
+        case FilesystemType::Ext4:
+            return get_ext4_tuning(device_class, profile);
+        case FilesystemType::F2fs:
+            return get_f2fs_tuning(device_class, read_by_bootloader);
+        case FilesystemType::Xfs:
+            return get_xfs_tuning(profile);
+        case FilesystemType::Vfat:
+        case FilesystemType::LinuxSwap:
+        case FilesystemType::Zfs:
+        case FilesystemType::Unknown:
+        default:
+            break;
+        }
+    }
+    return FsTuning{
+        .mkfs_command = std::string{get_mkfs_command(fs_type)},
+        .mount_opts   = get_default_mount_opts(fs_type, !profile.is_rotational),
+    };
+}
+
+}  // namespace gucc::fs
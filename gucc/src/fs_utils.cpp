@@ -1,5 +1,6 @@
 #include "gucc/fs_utils.hpp"
 #include "gucc/io_utils.hpp"
+#include "gucc/mount_table.hpp"
 #include "gucc/string_utils.hpp"
 
 #include <fmt/compile.h>
@@ -7,14 +8,35 @@
 
 #include <spdlog/spdlog.h>
 
+using namespace std::string_view_literals;
+
 namespace gucc::fs::utils {
 
 auto get_mountpoint_fs(std::string_view mountpoint) noexcept -> std::string {
-    return gucc::utils::exec(fmt::format(FMT_COMPILE("findmnt -ln -o FSTYPE \"{}\""), mountpoint));
+    const auto& mount_table = mtab::MountTable::read();
+    if (!mount_table) {
+        spdlog::error("Failed to get FSTYPE of {}: {}", mountpoint, gucc::to_string(mount_table.error()));
+        return {};
+    }
+    const auto* entry = mount_table->find_by_mountpoint(mountpoint);
+    return (entry != nullptr) ? std::string{entry->fstype} : std::string{};
 }
 
 auto get_mountpoint_source(std::string_view mountpoint) noexcept -> std::string {
-    return gucc::utils::exec(fmt::format(FMT_COMPILE("findmnt -ln -o SOURCE \"{}\""), mountpoint));
+    const auto& mount_table = mtab::MountTable::read();
+    if (!mount_table) {
+        spdlog::error("Failed to get SOURCE of {}: {}", mountpoint, gucc::to_string(mount_table.error()));
+        return {};
+    }
+    const auto* entry = mount_table->find_by_mountpoint(mountpoint);
+    if (entry == nullptr) {
+        return {};
+    }
+    // same as findmnt, e.g /dev/sda2[/@home] for a btrfs subvolume or a bind mount
+    if (entry->root != "/"sv) {
+        return fmt::format(FMT_COMPILE("{}[{}]"), entry->source, entry->root);
+    }
+    return std::string{entry->source};
 }
 
 auto get_device_uuid(std::string_view device) noexcept -> std::string {
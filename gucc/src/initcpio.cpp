@@ -144,6 +144,11 @@ auto setup_initcpio_config(std::string_view initcpio_path,
         hooks.emplace_back("plymouth");
     }
 
+    // md arrays are assembled before anything stacked on top of them
+    if (config.is_mdadm) {
+        hooks.emplace_back("mdadm_udev");
+    }
+
     // encryption related
     if (config.is_luks) {
         if (systemd_allowed) {
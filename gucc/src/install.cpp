@@ -1,18 +1,28 @@
 #include "gucc/install.hpp"
+#include "gucc/alpm_transaction.hpp"
 #include "gucc/chwd.hpp"
 #include "gucc/error.hpp"
 #include "gucc/fs_utils.hpp"
 #include "gucc/fstab.hpp"
 #include "gucc/initcpio.hpp"
 #include "gucc/io_utils.hpp"
+#include "gucc/keyring.hpp"
 #include "gucc/locale.hpp"
 #include "gucc/mirrors.hpp"
+#include "gucc/offline_bundle.hpp"
+#include "gucc/package_cache.hpp"
+#include "gucc/package_download.hpp"
+#include "gucc/process.hpp"
+#include "gucc/raid.hpp"
 #include "gucc/repos.hpp"
+#include "gucc/string_utils.hpp"
 #include "gucc/systemd_services.hpp"
 #include "gucc/zfs.hpp"
 
-#include <filesystem>  // for copy_file, copy_options, create_directories
+#include <filesystem>  // for copy_file, copy_options, create_directories, directory_iterator, exists
 #include <string>      // for string
+#include <utility>     // for move
+#include <vector>      // for vector
 
 #include <fmt/compile.h>
 #include <spdlog/spdlog.h>
@@ -61,10 +71,59 @@ auto copy_zfs_cachefile(std::string_view mountpoint) noexcept -> bool {
     return true;
 }
 
+/// What pacstrap copies from the host besides the keyring, unless told otherwise (-M).
+auto copy_host_mirrorlist(std::string_view mountpoint) noexcept -> gucc::Result<void> {
+    std::error_code ec;
+    const auto mirrorlist = "/etc/pacman.d/mirrorlist"sv;
+    ::fs::copy_file(mirrorlist, fmt::format(FMT_COMPILE("{}{}"), mountpoint, mirrorlist), ::fs::copy_options::overwrite_existing, ec);
+    if (ec) {
+        return gucc::make_error(gucc::ErrorCode::FileIo, fmt::format("Failed to copy '{}': {}", mirrorlist, ec.message()));
+    }
+    return {};
+}
+
 }  // namespace
 
 namespace gucc::install {
 
+auto install_packages(std::string_view mountpoint, std::string_view packages, std::string_view pacman_config, bool hostcache, PackageBackend backend) noexcept -> Result<void> {
+    if (backend == PackageBackend::Alpm && !alpm::available()) {
+        spdlog::warn("gucc was built without libalpm, installing through pacstrap");
+        backend = PackageBackend::Pacstrap;
+    }
+    if (backend == PackageBackend::Pacstrap) {
+        if (!gucc::utils::run_pacstrap(mountpoint, packages, pacman_config, hostcache)) {
+            return make_error(ErrorCode::SubprocessFailed, fmt::format("pacstrap failed"));
+        }
+        return {};
+    }
+
+    spdlog::info("Installing through libalpm: '{}'", packages);
+    alpm::TransactionConfig transaction{
+        .mountpoint    = mountpoint,
+        .pacman_config = pacman_config,
+    };
+    // -c leaves the cache to the pacman.conf, pacstrap's own --cachedir otherwise
+    if (!hostcache) {
+        transaction.cache_dirs.emplace_back(gucc::pkgcache::target_cache_dir(mountpoint));
+    }
+    for (auto&& pkg : gucc::utils::make_split_view(packages, ' ')) {
+        transaction.packages.emplace_back(pkg);
+    }
+    // the packages are checked against the target keyring, seeded from the host before anything lands.
+    // Only this backend needs it, pacstrap copies the host keyring itself unless given -G
+    transaction.gpg_dir = fmt::format(FMT_COMPILE("{}{}"), mountpoint, keyring::kHostKeyringDir);
+    if (std::error_code ec; !::fs::exists(fmt::format(FMT_COMPILE("{}/pubring.gpg"), transaction.gpg_dir), ec)) {
+        if (auto seeded = keyring::seed_target(mountpoint); !seeded) {
+            return std::unexpected(seeded.error());
+        }
+    }
+    if (auto res = alpm::install_packages(transaction); !res) {
+        return res;
+    }
+    return copy_host_mirrorlist(mountpoint);
+}
+
 auto install_base(const InstallConfig& config) noexcept -> Result<void> {
     const auto& mountpoint = config.mountpoint;
 
@@ -91,17 +150,76 @@ auto install_base(const InstallConfig& config) noexcept -> Result<void> {
         return res;
     }
 
-    // 3. Rate mirrors before install
-    if (auto res = gucc::mirrors::rank_mirrors(); !res) {
+    // 3. Create pacman.conf for target pacstrap
+    if (auto res = gucc::repos::create_target_pacman_config(kHostPacmanConf, kTargetPacmanConf); !res) {
         return res;
     }
+    const bool from_bundle = !config.bundle_dir.empty();
+    std::size_t parallel_downloads{};
+    if (from_bundle) {
+        // nothing to rank or prefetch, the bundle is a local disk
+        if (auto res = gucc::bundle::use_bundle(kTargetPacmanConf, config.bundle_dir); !res) {
+            return res;
+        }
+    } else {
+        // 4. Rate mirrors before install, with as many downloads as the link carries
+        const auto ranked = gucc::mirrors::rank_mirrors();
+        if (!ranked) {
+            return std::unexpected(ranked.error());
+        }
+        if (auto res = gucc::mirrors::set_parallel_downloads(kTargetPacmanConf, ranked->parallel_downloads); !res) {
+            return res;
+        }
+        parallel_downloads = ranked->parallel_downloads;
+    }
+    std::string cache_dir{gucc::pkgcache::kHostCacheDir};
+    if (config.hostcache && config.target_cache) {
+        auto target_dir = gucc::pkgcache::use_target_cache(kTargetPacmanConf, mountpoint);
+        if (!target_dir) {
+            return std::unexpected(target_dir.error());
+        }
+        cache_dir = std::move(*target_dir);
+    }
 
-    // 4. Create pacman.conf for target pacstrap
-    if (auto res = gucc::repos::create_target_pacman_config(kHostPacmanConf, kTargetPacmanConf); !res) {
-        return res;
+    if (config.hostcache && !from_bundle && !config.prefetch.empty()) {
+        if (gucc::utils::default_runner().dry_run()) {
+            // the downloads land in the host cache, left alone like any Mutate process
+            spdlog::info("[dry-run] would prefetch {} packages into '{}'", config.prefetch.size(), cache_dir);
+        } else {
+            // spread over several mirrors, pacman fetches whatever is still missing itself
+            const auto& servers = gucc::download::repo_servers(kTargetPacmanConf);
+            const auto& fetched = gucc::download::download_packages(config.prefetch, servers, {.cache_dir = cache_dir, .max_connections = parallel_downloads});
+            if (!fetched) {
+                spdlog::warn("Failed to prefetch packages: {}", gucc::to_string(fetched.error()));
+            }
+        }
+    }
+    // a signer missing from the keyring fails the transaction later on, say which one now.
+    // Only the presence of the signing key, pacman verifies the signatures. Just the files this
+    // install brought along, whatever else sits in the cache is up to pacman
+    std::vector<std::string> sig_files{};
+    if (from_bundle) {
+        // the bundle holds exactly what it was built for
+        std::error_code ec;
+        for (const auto& repo : ::fs::directory_iterator{fmt::format(FMT_COMPILE("{}/{}"), config.bundle_dir, gucc::bundle::kReposDir), ec}) {
+            std::error_code repo_ec;
+            for (const auto& entry : ::fs::directory_iterator{repo.path(), repo_ec}) {
+                if (entry.path().extension() == ".sig"sv) {
+                    sig_files.emplace_back(entry.path().string());
+                }
+            }
+        }
+    } else if (config.hostcache) {
+        for (const auto& file : config.prefetch) {
+            sig_files.emplace_back(fmt::format(FMT_COMPILE("{}/{}.sig"), cache_dir, file.filename));
+        }
     }
-    if (!gucc::utils::run_pacstrap(mountpoint, config.packages, kTargetPacmanConf, config.hostcache)) {
-        return make_error(ErrorCode::SubprocessFailed, fmt::format("pacstrap failed"));
+    // the keyring pacstrap copies into the target and libalpm gets seeded with
+    if (const auto& checked = gucc::keyring::check_signers(gucc::keyring::kHostKeyringDir, sig_files); !checked) {
+        spdlog::warn("Package signers: {}", gucc::to_string(checked.error()));
+    }
+    if (auto res = install_packages(mountpoint, config.packages, kTargetPacmanConf, config.hostcache, config.backend); !res) {
+        return res;
     }
 
     // 5. Copy host files into target
@@ -113,6 +231,16 @@ auto install_base(const InstallConfig& config) noexcept -> Result<void> {
             return make_error(ErrorCode::FileIo, fmt::format("Failed to copy '{}' -> '{}': {}", src, dst, ec.message()));
         }
     }
+    // whatever gets installed into the target later on comes from the bundle as well,
+    // pacman in a chroot of it included
+    if (from_bundle) {
+        if (auto res = gucc::bundle::use_bundle(fmt::format(FMT_COMPILE("{}/etc/pacman.conf"), mountpoint), config.bundle_dir); !res) {
+            return res;
+        }
+        if (auto res = gucc::bundle::attach(config.bundle_dir, mountpoint); !res) {
+            return res;
+        }
+    }
 
     // For a ZFS root, copy host id to bundle with initramfs
     if (config.is_zfs) {
@@ -121,6 +249,13 @@ auto install_base(const InstallConfig& config) noexcept -> Result<void> {
         }
     }
 
+    // mdadm_udev assembles the arrays listed in mdadm.conf
+    if (config.is_mdadm) {
+        if (auto res = gucc::raid::write_mdadm_conf(mountpoint); !res) {
+            return res;
+        }
+    }
+
     // 6. Configure mkinitcpio
     const auto initcpio_path = fmt::format(FMT_COMPILE("{}/etc/mkinitcpio.conf"), mountpoint);
     if (auto res = gucc::initcpio::setup_initcpio_config(initcpio_path, config.initcpio_config); !res) {
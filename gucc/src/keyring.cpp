@@ -0,0 +1,396 @@
+#include "gucc/keyring.hpp"
+#include "gucc/file_utils.hpp"
+#include "gucc/string_utils.hpp"
+
+#include <algorithm>   // for ranges::any_of
+#include <array>       // for array
+#include <bit>         // for rotl
+#include <cstdint>     // for uint8_t, uint32_t, uint64_t
+#include <filesystem>  // for directory_iterator, recursive_directory_iterator, copy_file, exists
+#include <utility>     // for move
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include <spdlog/spdlog.h>
+
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+// OpenPGP packet tags, RFC 4880 4.3
+inline constexpr std::uint8_t kTagSignature = 2;
+inline constexpr std::uint8_t kTagPublicKey = 6;
+inline constexpr std::uint8_t kTagSubkey    = 14;
+
+// signature subpackets, RFC 4880 5.2.3.1 and 9580 5.2.3.35
+inline constexpr std::uint8_t kSubpacketIssuer            = 16;
+inline constexpr std::uint8_t kSubpacketIssuerFingerprint = 33;
+
+struct Packet final {
+    std::uint8_t tag{};
+    std::string_view body{};
+};
+
+auto byte_at(std::string_view data, std::size_t pos) noexcept -> std::uint32_t {
+    return static_cast<std::uint8_t>(data[pos]);
+}
+
+auto be32(std::string_view data, std::size_t pos) noexcept -> std::uint32_t {
+    return (byte_at(data, pos) << 24) | (byte_at(data, pos + 1) << 16) | (byte_at(data, pos + 2) << 8) | byte_at(data, pos + 3);
+}
+
+auto to_hex(std::string_view bytes) noexcept -> std::string {
+    std::string hex{};
+    hex.reserve(bytes.size() * 2);
+    for (const char byte : bytes) {
+        hex += fmt::format(FMT_COMPILE("{:02X}"), static_cast<std::uint8_t>(byte));
+    }
+    return hex;
+}
+
+/// Takes the next packet off @p rest, nullopt when it is malformed or uses partial lengths.
+auto next_packet(std::string_view& rest) noexcept -> std::optional<Packet> {
+    if (rest.empty() || (byte_at(rest, 0) & 0x80U) == 0) {
+        return std::nullopt;
+    }
+    const auto header = byte_at(rest, 0);
+    Packet packet{};
+    std::size_t header_len{1};
+    std::size_t body_len{};
+    if ((header & 0x40U) != 0) {
+        // new format
+        packet.tag = static_cast<std::uint8_t>(header & 0x3fU);
+        if (rest.size() < 2) {
+            return std::nullopt;
+        }
+        const auto first = byte_at(rest, 1);
+        if (first < 192) {
+            header_len = 2;
+            body_len   = first;
+        } else if (first < 224 && rest.size() >= 3) {
+            header_len = 3;
+            body_len   = ((first - 192) << 8) + byte_at(rest, 2) + 192;
+        } else if (first == 255 && rest.size() >= 6) {
+            header_len = 6;
+            body_len   = be32(rest, 2);
+        } else {
+            return std::nullopt;
+        }
+    } else {
+        // old format
+        packet.tag             = static_cast<std::uint8_t>((header >> 2) & 0x0fU);
+        const auto length_type = header & 0x03U;
+        if (length_type == 3) {
+            body_len = rest.size() - 1;
+        } else {
+            header_len = 1 + (std::size_t{1} << length_type);
+            if (rest.size() < header_len) {
+                return std::nullopt;
+            }
+            for (std::size_t i = 1; i < header_len; ++i) {
+                body_len = (body_len << 8) | byte_at(rest, i);
+            }
+        }
+    }
+    if (rest.size() - header_len < body_len) {
+        return std::nullopt;
+    }
+    packet.body = rest.substr(header_len, body_len);
+    rest.remove_prefix(header_len + body_len);
+    return packet;
+}
+
+/// What v4 fingerprints are computed with, nothing else here needs SHA-1.
+auto sha1_hex(std::string_view data) noexcept -> std::string {
+    std::array<std::uint32_t, 5> state{0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+    std::string message{data};
+    message += '\x80';
+    while (message.size() % 64 != 56) {
+        message += '\0';
+    }
+    const std::uint64_t total_bits = static_cast<std::uint64_t>(data.size()) * 8;
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        message += static_cast<char>((total_bits >> shift) & 0xffU);
+    }
+
+    for (std::size_t block = 0; block < message.size(); block += 64) {
+        std::array<std::uint32_t, 80> w{};
+        for (std::size_t i = 0; i < 16; ++i) {
+            w[i] = be32(message, block + (i * 4));
+        }
+        for (std::size_t i = 16; i < 80; ++i) {
+            w[i] = std::rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        auto [a, b, c, d, e] = state;
+        for (std::size_t i = 0; i < 80; ++i) {
+            std::uint32_t f{};
+            std::uint32_t k{};
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5a827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+            const auto temp = std::rotl(a, 5) + f + e + k + w[i];
+            e               = d;
+            d               = c;
+            c               = std::rotl(b, 30);
+            b               = a;
+            a               = temp;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+
+    std::string digest{};
+    digest.reserve(40);
+    for (const auto word : state) {
+        digest += fmt::format(FMT_COMPILE("{:08X}"), word);
+    }
+    return digest;
+}
+
+/// Issuer subpackets of one subpacket area, the fingerprint wins over the key id.
+void scan_subpackets(std::string_view area, std::optional<std::string>& fingerprint, std::optional<std::string>& key_id) noexcept {
+    while (!area.empty()) {
+        const auto first = byte_at(area, 0);
+        std::size_t header_len{1};
+        std::size_t len{first};
+        if (first >= 192 && first < 255 && area.size() >= 2) {
+            header_len = 2;
+            len        = ((first - 192) << 8) + byte_at(area, 1) + 192;
+        } else if (first == 255 && area.size() >= 5) {
+            header_len = 5;
+            len        = be32(area, 1);
+        } else if (first >= 192) {
+            return;
+        }
+        if (len == 0 || area.size() - header_len < len) {
+            return;
+        }
+        const auto subpacket = area.substr(header_len, len);
+        area.remove_prefix(header_len + len);
+
+        const auto type = static_cast<std::uint8_t>(byte_at(subpacket, 0) & 0x7fU);
+        const auto data = subpacket.substr(1);
+        if (type == kSubpacketIssuerFingerprint && data.size() == 21 && byte_at(data, 0) == 4) {
+            fingerprint = to_hex(data.substr(1));
+        } else if (type == kSubpacketIssuer && data.size() == 8) {
+            key_id = to_hex(data);
+        }
+    }
+}
+
+/// cp -a of a gnupg homedir, without the agent sockets and lock files.
+auto copy_keyring_dir(const fs::path& source, const fs::path& destination) noexcept -> gucc::Result<void> {
+    std::error_code ec;
+    fs::create_directories(destination, ec);
+    if (!ec) {
+        fs::permissions(destination, fs::status(source, ec).permissions(), ec);
+    }
+    if (ec) {
+        return gucc::make_error(gucc::ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to create '{}': {}"), destination.string(), ec.message()));
+    }
+    for (auto it = fs::recursive_directory_iterator{source, ec}; !ec && it != fs::recursive_directory_iterator{}; it.increment(ec)) {
+        const auto& filename = it->path().filename().string();
+        if (filename.ends_with(".lock"sv) || filename.starts_with(".#lk"sv)) {
+            continue;
+        }
+        const auto dst = destination / fs::relative(it->path(), source);
+        std::error_code copy_ec;
+        if (it->is_symlink(copy_ec)) {
+            fs::remove(dst, copy_ec);
+            fs::copy_symlink(it->path(), dst, copy_ec);
+        } else if (it->is_directory(copy_ec)) {
+            fs::create_directories(dst, copy_ec);
+            fs::permissions(dst, it->status().permissions(), copy_ec);
+        } else if (it->is_regular_file(copy_ec)) {
+            fs::copy_file(it->path(), dst, fs::copy_options::overwrite_existing, copy_ec);
+        }
+        if (copy_ec) {
+            return gucc::make_error(gucc::ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to copy '{}': {}"), it->path().string(), copy_ec.message()));
+        }
+    }
+    if (ec) {
+        return gucc::make_error(gucc::ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to copy '{}': {}"), source.string(), ec.message()));
+    }
+    return {};
+}
+
+}  // namespace
+
+namespace gucc::keyring {
+
+auto read_fingerprints(std::string_view keyring_dir) noexcept -> Result<std::vector<std::string>> {
+    // pacman-key creates pubring.gpg up front, gpg never switches it to a keybox
+    const auto& pubring = fmt::format(FMT_COMPILE("{}/pubring.gpg"), keyring_dir);
+    std::error_code ec;
+    if (!fs::exists(pubring, ec)) {
+        return make_error(ErrorCode::NotFound, fmt::format(FMT_COMPILE("'{}' doesn't exist"), pubring));
+    }
+    return detail::keyring_fingerprints(file_utils::read_whole_file(pubring));
+}
+
+auto trusted_fingerprints(std::string_view keyrings_dir) noexcept -> std::vector<std::string> {
+    std::vector<std::string> fingerprints{};
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator{keyrings_dir, ec}) {
+        if (!entry.path().filename().string().ends_with("-trusted"sv)) {
+            continue;
+        }
+        // FINGERPRINT:TRUSTLEVEL:
+        const auto& content = file_utils::read_whole_file(entry.path().string());
+        for (auto&& line : utils::make_split_view(content)) {
+            const auto& trimmed = utils::trim(line);
+            if (trimmed.empty() || trimmed.starts_with('#')) {
+                continue;
+            }
+            fingerprints.emplace_back(trimmed.substr(0, trimmed.find(':')));
+        }
+    }
+    return fingerprints;
+}
+
+auto has_key(std::span<const std::string> fingerprints, std::string_view key) noexcept -> bool {
+    if (key.empty()) {
+        return false;
+    }
+    // a key id is the tail of the fingerprint
+    return std::ranges::any_of(fingerprints, [key](std::string_view fingerprint) { return fingerprint.ends_with(key); });
+}
+
+auto seed_target(std::string_view mountpoint, const SeedOptions& options) noexcept -> Result<SeedResult> {
+    const fs::path target_dir{fmt::format(FMT_COMPILE("{}{}"), mountpoint, kHostKeyringDir)};
+    SeedResult result{};
+
+    std::error_code ec;
+    if (!fs::exists(target_dir / "pubring.gpg", ec)) {
+        if (auto res = copy_keyring_dir(options.host_dir, target_dir); !res) {
+            return std::unexpected(res.error());
+        }
+        result.copied = true;
+    }
+
+    const auto& fingerprints = read_fingerprints(target_dir.string());
+    if (!fingerprints) {
+        return std::unexpected(fingerprints.error());
+    }
+    result.keys = fingerprints->size();
+    for (const auto& trusted : trusted_fingerprints(options.keyrings_dir)) {
+        if (!has_key(*fingerprints, trusted)) {
+            spdlog::warn("The keyring of '{}' lacks the trusted key {}, leaving it to the keyring packages", mountpoint, trusted);
+            ++result.missing_trusted;
+        }
+    }
+    spdlog::info("Keyring of '{}' {} with {} keys", mountpoint, result.copied ? "seeded from the host"sv : "kept"sv, result.keys);
+    return result;
+}
+
+auto check_signers(std::string_view keyring_dir, std::span<const std::string> sig_files) noexcept -> Result<std::size_t> {
+    if (sig_files.empty()) {
+        return 0;
+    }
+    const auto& fingerprints = read_fingerprints(keyring_dir);
+    if (!fingerprints) {
+        return std::unexpected(fingerprints.error());
+    }
+
+    std::size_t checked{};
+    for (const auto& sig_file : sig_files) {
+        std::error_code ec;
+        if (!fs::exists(sig_file, ec)) {
+            continue;
+        }
+        const auto& issuer = detail::signature_issuer(file_utils::read_whole_file(sig_file));
+        if (!issuer) {
+            // armored or something newer than v4, pacman has the last word on those
+            spdlog::debug("[keyring] no issuer in '{}'", sig_file);
+            continue;
+        }
+        if (!has_key(*fingerprints, *issuer)) {
+            return make_error(ErrorCode::NotFound, fmt::format(FMT_COMPILE("'{}' is signed by {}, which '{}' doesn't hold"), fs::path{sig_file}.filename().string(), *issuer, keyring_dir));
+        }
+        ++checked;
+    }
+    return checked;
+}
+
+}  // namespace gucc::keyring
+
+namespace gucc::keyring::detail {
+
+auto v4_fingerprint(std::string_view key_body) noexcept -> std::optional<std::string> {
+    if (key_body.empty() || byte_at(key_body, 0) != 4 || key_body.size() > 0xffff) {
+        return std::nullopt;
+    }
+    // 0x99, two octet length, then the body
+    std::string hashed{};
+    hashed.reserve(key_body.size() + 3);
+    hashed += '\x99';
+    hashed += static_cast<char>((key_body.size() >> 8) & 0xffU);
+    hashed += static_cast<char>(key_body.size() & 0xffU);
+    hashed += key_body;
+    return sha1_hex(hashed);
+}
+
+auto keyring_fingerprints(std::string_view keyring) noexcept -> Result<std::vector<std::string>> {
+    std::vector<std::string> fingerprints{};
+    std::string_view rest{keyring};
+    while (!rest.empty()) {
+        const auto offset = keyring.size() - rest.size();
+        const auto packet = next_packet(rest);
+        if (!packet) {
+            return make_error(ErrorCode::ParseError, fmt::format(FMT_COMPILE("malformed OpenPGP packet at offset {}"), offset));
+        }
+        if (packet->tag != kTagPublicKey && packet->tag != kTagSubkey) {
+            continue;
+        }
+        if (auto fingerprint = v4_fingerprint(packet->body)) {
+            fingerprints.emplace_back(std::move(*fingerprint));
+        }
+    }
+    return fingerprints;
+}
+
+auto signature_issuer(std::string_view signature) noexcept -> std::optional<std::string> {
+    std::string_view rest{signature};
+    const auto packet = next_packet(rest);
+    if (!packet || packet->tag != kTagSignature || packet->body.empty()) {
+        return std::nullopt;
+    }
+    const auto body    = packet->body;
+    const auto version = byte_at(body, 0);
+    if (version == 3) {
+        // version, 5, type, creation time, then the key id
+        return (body.size() >= 15) ? std::optional{to_hex(body.substr(7, 8))} : std::nullopt;
+    }
+    if (version != 4 || body.size() < 6) {
+        return std::nullopt;
+    }
+
+    std::optional<std::string> fingerprint{};
+    std::optional<std::string> key_id{};
+    const std::size_t hashed_len = (byte_at(body, 4) << 8) | byte_at(body, 5);
+    if (body.size() < 6 + hashed_len + 2) {
+        return std::nullopt;
+    }
+    scan_subpackets(body.substr(6, hashed_len), fingerprint, key_id);
+    const std::size_t unhashed_len = (byte_at(body, 6 + hashed_len) << 8) | byte_at(body, 7 + hashed_len);
+    scan_subpackets(body.substr(8 + hashed_len, unhashed_len), fingerprint, key_id);
+    return fingerprint ? fingerprint : key_id;
+}
+
+}  // namespace gucc::keyring::detail
@@ -0,0 +1,127 @@
+#include "gucc/local_db.hpp"
+#include "gucc/file_utils.hpp"
+
+#include <algorithm>     // for sort
+#include <filesystem>    // for directory_iterator, exists
+#include <optional>      // for optional
+#include <system_error>  // for error_code
+#include <utility>       // for move, pair
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include <spdlog/spdlog.h>
+
+namespace fs = std::filesystem;
+
+using namespace std::string_view_literals;
+
+namespace {
+
+/// Splits `<name>-<pkgver>-<pkgrel>`, neither pkgver nor pkgrel may contain a dash.
+auto split_dir_name(std::string_view dir_name) noexcept -> std::optional<std::pair<std::string_view, std::string_view>> {
+    const auto rel_dash = dir_name.rfind('-');
+    if (rel_dash == std::string_view::npos || rel_dash == 0) {
+        return std::nullopt;
+    }
+    const auto ver_dash = dir_name.rfind('-', rel_dash - 1);
+    if (ver_dash == std::string_view::npos || ver_dash == 0) {
+        return std::nullopt;
+    }
+    return std::make_pair(dir_name.substr(0, ver_dash), dir_name.substr(ver_dash + 1));
+}
+
+}  // namespace
+
+namespace gucc::localdb {
+
+auto LocalDatabase::open(std::string_view root_mountpoint) noexcept -> Result<LocalDatabase> {
+    LocalDatabase db{};
+    db.m_local_dir = (fs::path{root_mountpoint} / "var/lib/pacman/local"sv).string();
+
+    std::error_code ec{};
+    for (const auto& entry : fs::directory_iterator{db.m_local_dir, ec}) {
+        std::error_code entry_ec{};
+        if (!entry.is_directory(entry_ec)) {
+            continue;
+        }
+        auto dir_name = entry.path().filename().string();
+        if (split_dir_name(dir_name)) {
+            db.m_dirs.emplace_back(std::move(dir_name));
+        }
+    }
+    if (ec) {
+        return make_error((ec == std::errc::no_such_file_or_directory) ? ErrorCode::NotFound : ErrorCode::FileIo,
+            fmt::format(FMT_COMPILE("failed to list '{}': {}"), db.m_local_dir, ec.message()));
+    }
+
+    // the views below point into m_dirs, it must not grow after this
+    db.m_by_name.reserve(db.m_dirs.size());
+    for (std::uint32_t i = 0; i < db.m_dirs.size(); ++i) {
+        db.m_by_name.try_emplace(split_dir_name(db.m_dirs[i])->first, i);
+    }
+    spdlog::debug("[localdb] {} packages installed under '{}'", db.m_dirs.size(), root_mountpoint);
+    return db;
+}
+
+auto LocalDatabase::is_installed(std::string_view name) const noexcept -> bool {
+    return m_by_name.contains(name);
+}
+
+auto LocalDatabase::version(std::string_view name) const noexcept -> std::optional<std::string_view> {
+    const auto it = m_by_name.find(name);
+    if (it == m_by_name.end()) {
+        return std::nullopt;
+    }
+    return split_dir_name(m_dirs[it->second])->second;
+}
+
+auto LocalDatabase::files(std::string_view name) const noexcept -> Result<std::vector<std::string>> {
+    const auto it = m_by_name.find(name);
+    if (it == m_by_name.end()) {
+        return make_error(ErrorCode::NotFound, fmt::format(FMT_COMPILE("package '{}' is not installed"), name));
+    }
+    const auto& files_path = fmt::format(FMT_COMPILE("{}/{}/files"), m_local_dir, m_dirs[it->second]);
+    // meta packages own nothing, an empty file is fine
+    std::error_code ec{};
+    if (!fs::exists(files_path, ec)) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("'{}' is missing"), files_path));
+    }
+    const auto& content = file_utils::read_whole_file(files_path);
+
+    // %FILES%\npath\npath\n\n%BACKUP%\n...
+    std::vector<std::string> files{};
+    bool in_files{false};
+    std::string_view rest{content};
+    while (!rest.empty()) {
+        const auto eol  = rest.find('\n');
+        const auto line = rest.substr(0, eol);
+        rest.remove_prefix((eol == std::string_view::npos) ? rest.size() : eol + 1);
+
+        if (line.empty()) {
+            in_files = false;
+        } else if (line.front() == '%' && line.back() == '%') {
+            in_files = (line == "%FILES%"sv);
+        } else if (in_files) {
+            files.emplace_back(line);
+        }
+    }
+    return files;
+}
+
+auto LocalDatabase::package_names() const noexcept -> std::vector<std::string_view> {
+    std::vector<std::string_view> names{};
+    names.reserve(m_by_name.size());
+    for (const auto& [name, _] : m_by_name) {
+        names.push_back(name);
+    }
+    std::ranges::sort(names);
+    return names;
+}
+
+auto is_installed(std::string_view name, std::string_view root_mountpoint) noexcept -> bool {
+    const auto& db = LocalDatabase::open(root_mountpoint);
+    return db && db->is_installed(name);
+}
+
+}  // namespace gucc::localdb
@@ -1,20 +1,28 @@
 #include "gucc/luks.hpp"
 #include "gucc/error.hpp"
+#include "gucc/fs_tuning.hpp"
 #include "gucc/io_utils.hpp"
+#include "gucc/string_utils.hpp"
 
 #include <filesystem>
 #include <string>
+#include <vector>
 
 #include <fmt/compile.h>
 #include <fmt/format.h>
 
 #include <spdlog/spdlog.h>
 
+using namespace std::string_view_literals;
+
 namespace {
 
 // NOLINTNEXTLINE
 using namespace gucc;
 
+// dm-crypt doesn't go beyond a page
+inline constexpr std::uint32_t MAX_CRYPT_SECTOR_SIZE = 4096;
+
 auto run_checked(const std::string& cmd, std::string context) noexcept -> Result<void> {
     if (!utils::exec_checked(cmd)) {
         return make_error(ErrorCode::SubprocessFailed, std::move(context));
@@ -70,8 +78,8 @@ auto setup_keyfile_impl(std::string_view dest_file, std::string_view mountpoint,
 namespace gucc::crypto {
 
 // TODO(vnepogodin): they are mostly equal. refactor this shit
-auto luks1_open(std::string_view luks_pass, std::string_view partition, std::string_view luks_name) noexcept -> Result<void> {
-    auto cmd = fmt::format(FMT_COMPILE("echo '{}' | cryptsetup open --type luks1 {} {}"), luks_pass, partition, luks_name);
+auto luks1_open(std::string_view luks_pass, std::string_view partition, std::string_view luks_name, std::string_view additional_flags) noexcept -> Result<void> {
+    auto cmd = fmt::format(FMT_COMPILE("echo '{}' | cryptsetup open --type luks1 {} {} {}"), luks_pass, additional_flags, partition, luks_name);
     return run_checked(cmd, fmt::format("failed to open luks1 partition {}", partition));
 }
 
@@ -80,13 +88,14 @@ auto luks1_format(std::string_view luks_pass, std::string_view partition, std::s
     return run_checked(cmd, fmt::format("failed to format luks1 partition {}", partition));
 }
 
-auto luks2_open(std::string_view luks_pass, std::string_view partition, std::string_view luks_name) noexcept -> Result<void> {
-    auto cmd = fmt::format(FMT_COMPILE("echo '{}' | cryptsetup open --type luks2 {} {}"), luks_pass, partition, luks_name);
+auto luks2_open(std::string_view luks_pass, std::string_view partition, std::string_view luks_name, std::string_view additional_flags) noexcept -> Result<void> {
+    auto cmd = fmt::format(FMT_COMPILE("echo '{}' | cryptsetup open --type luks2 {} {} {}"), luks_pass, additional_flags, partition, luks_name);
     return run_checked(cmd, fmt::format("failed to open luks2 partition {}", partition));
 }
 
 auto luks2_format(std::string_view luks_pass, std::string_view partition, std::string_view additional_flags) noexcept -> Result<void> {
-    auto cmd = fmt::format(FMT_COMPILE("echo '{}' | cryptsetup -q {} --type luks2 luksFormat {}"), luks_pass, additional_flags, partition);
+    const auto& flags = detail::with_pbkdf_flags(additional_flags, luks2_pbkdf_params());
+    auto cmd          = fmt::format(FMT_COMPILE("echo '{}' | cryptsetup -q {} --type luks2 luksFormat {}"), luks_pass, flags, partition);
     return run_checked(cmd, fmt::format("failed to format luks2 partition {}", partition));
 }
 
@@ -96,7 +105,8 @@ auto luks1_add_key(std::string_view dest_file, std::string_view partition, std::
 }
 
 auto luks2_add_key(std::string_view dest_file, std::string_view partition, std::string_view additional_flags) noexcept -> Result<void> {
-    auto cmd = fmt::format(FMT_COMPILE("cryptsetup -q {} luksAddKey {} {}"), additional_flags, partition, dest_file);
+    const auto& flags = detail::with_pbkdf_flags(additional_flags, luks2_pbkdf_params());
+    auto cmd          = fmt::format(FMT_COMPILE("cryptsetup -q {} luksAddKey {} {}"), flags, partition, dest_file);
     return run_checked(cmd, fmt::format("failed to add luks key to {}", partition));
 }
 
@@ -108,4 +118,129 @@ auto luks2_setup_keyfile(std::string_view dest_file, std::string_view mountpoint
     return setup_keyfile_impl(dest_file, mountpoint, partition, additional_flags, true);
 }
 
+auto luks2_pbkdf_params() noexcept -> std::optional<LuksPbkdfParams> {
+    // the benchmark takes a couple of seconds, measure once per install
+    static const auto params = []() -> std::optional<LuksPbkdfParams> {
+        auto parsed = detail::parse_pbkdf_benchmark(utils::exec("cryptsetup benchmark --pbkdf argon2id"sv));
+        if (!parsed) {
+            spdlog::warn("Failed to calibrate argon2id, cryptsetup benchmarks every keyslot on its own");
+            return std::nullopt;
+        }
+        spdlog::info("Calibrated argon2id: {} iterations, {} KiB memory, {} threads", parsed->iterations, parsed->memory_kib, parsed->parallel);
+        return parsed;
+    }();
+    return params;
+}
+
+auto luks2_pbkdf_flags(const LuksPbkdfParams& params) noexcept -> std::string {
+    return fmt::format(FMT_COMPILE("--pbkdf argon2id --pbkdf-force-iterations {} --pbkdf-memory {} --pbkdf-parallel {}"), params.iterations, params.memory_kib, params.parallel);
+}
+
+auto query_luks_perf_options(std::string_view device, bool bypass_workqueues) noexcept -> LuksPerfOptions {
+    const auto& profile = fs::query_device_profile(device);
+    if (!profile) {
+        return {};
+    }
+
+    LuksPerfOptions options{};
+    const auto& topology = profile->topology;
+    if (topology.physical_block_size >= MAX_CRYPT_SECTOR_SIZE && topology.logical_block_size <= MAX_CRYPT_SECTOR_SIZE) {
+        options.sector_size = MAX_CRYPT_SECTOR_SIZE;
+    }
+    // the workqueues smooth out slow devices, NVMe is faster without the extra hop
+    if (bypass_workqueues && fs::classify_device(*profile) == fs::DeviceClass::Nvme) {
+        options.no_read_workqueue  = true;
+        options.no_write_workqueue = true;
+    }
+    return options;
+}
+
+auto luks2_format_perf_flags(const LuksPerfOptions& options) noexcept -> std::string {
+    if (options.sector_size == 0) {
+        return {};
+    }
+    return fmt::format(FMT_COMPILE("--sector-size {}"), options.sector_size);
+}
+
+auto luks2_open_perf_flags(const LuksPerfOptions& options) noexcept -> std::string {
+    const auto& flags = luks1_open_perf_flags(options);
+    if (flags.empty()) {
+        return {};
+    }
+    return fmt::format(FMT_COMPILE("{} --persistent"), flags);
+}
+
+auto luks1_open_perf_flags(const LuksPerfOptions& options) noexcept -> std::string {
+    std::vector<std::string> flags{};
+    if (options.no_read_workqueue) {
+        flags.emplace_back("--perf-no_read_workqueue");
+    }
+    if (options.no_write_workqueue) {
+        flags.emplace_back("--perf-no_write_workqueue");
+    }
+    return utils::join(flags, ' ');
+}
+
+auto luks_crypttab_perf_options(const LuksPerfOptions& options) noexcept -> std::string {
+    std::vector<std::string> crypttab_opts{};
+    if (options.no_read_workqueue) {
+        crypttab_opts.emplace_back("no-read-workqueue");
+    }
+    if (options.no_write_workqueue) {
+        crypttab_opts.emplace_back("no-write-workqueue");
+    }
+    return utils::join(crypttab_opts, ',');
+}
+
 }  // namespace gucc::crypto
+
+namespace gucc::crypto::detail {
+
+auto parse_pbkdf_benchmark(std::string_view output) noexcept -> std::optional<LuksPbkdfParams> {
+    // "argon2id      4 iterations, 1048576 memory, 4 parallel threads (CPUs) for 256-bit key (requested 2000 ms time)"
+    for (auto&& line : utils::make_split_view(output)) {
+        const auto& trimmed = utils::trim(line);
+        if (!trimmed.starts_with("argon2id "sv)) {
+            continue;
+        }
+
+        LuksPbkdfParams params{};
+        for (auto&& field : utils::make_split_view(trimmed.substr("argon2id"sv.size()), ',')) {
+            const auto& value_and_name = utils::trim(field);
+            const auto space_pos       = value_and_name.find(' ');
+            if (space_pos == std::string_view::npos) {
+                continue;
+            }
+            const auto& value = utils::parse_uint<std::uint32_t>(value_and_name.substr(0, space_pos));
+            const auto& name  = value_and_name.substr(space_pos + 1);
+            if (!value) {
+                continue;
+            }
+            if (name.starts_with("iterations"sv)) {
+                params.iterations = *value;
+            } else if (name.starts_with("memory"sv)) {
+                params.memory_kib = *value;
+            } else if (name.starts_with("parallel"sv)) {
+                params.parallel = *value;
+            }
+        }
+        if (params.iterations == 0 || params.memory_kib == 0 || params.parallel == 0) {
+            return std::nullopt;
+        }
+        return params;
+    }
+    return std::nullopt;
+}
+
+auto with_pbkdf_flags(std::string_view additional_flags, const std::optional<LuksPbkdfParams>& params) noexcept -> std::string {
+    // the caller knows better, e.g pbkdf2 for a LUKS1 compatible keyslot
+    if (!params || additional_flags.contains("--pbkdf"sv) || additional_flags.contains("--iter-time"sv)) {
+        return std::string{additional_flags};
+    }
+    if (additional_flags.empty()) {
+        return luks2_pbkdf_flags(*params);
+    }
+    return fmt::format(FMT_COMPILE("{} {}"), luks2_pbkdf_flags(*params), additional_flags);
+}
+
+}  // namespace gucc::crypto::detail
@@ -2,78 +2,209 @@
 #include "gucc/io_utils.hpp"
 #include "gucc/string_utils.hpp"
 
-#include <algorithm>  // for transform, filter
-#include <ranges>     // for ranges::*
-#include <utility>    // for make_pair
+#include <algorithm>  // for find
+#include <ranges>     // for ranges::subrange
+#include <utility>    // for move
 
 #include <fmt/compile.h>
 #include <fmt/format.h>
 
+#include <rapidjson/document.h>
+#include <rapidjson/error/en.h>
+
 #include <spdlog/spdlog.h>
 
 using namespace std::string_view_literals;
 
 namespace {
-auto parse_simple_lvm_output(std::string_view output) noexcept -> std::vector<std::string> {
-    return gucc::utils::make_multiline_view(output)
-        | std::ranges::views::transform([](std::string_view sv) { return gucc::utils::trim(sv); })
-        | std::ranges::views::filter([](std::string_view sv) { return !sv.empty(); })
-        | std::ranges::views::transform([](std::string_view sv) { return std::string{sv}; })
-        | std::ranges::to<std::vector<std::string>>();
+
+// one process for all of PVs, VGs, LVs and segments, sizes in plain bytes
+inline constexpr auto LVM_FULLREPORT_CMD = "lvm fullreport --reportformat json --units b --nosuffix"
+                                           " --configreport vg -o vg_name,vg_uuid,vg_size,vg_free,vg_extent_size"
+                                           " --configreport pv -o pv_name,pv_uuid,vg_name,pv_size,pv_free"
+                                           " --configreport lv -o lv_name,lv_uuid,vg_name,lv_path,lv_size,lv_attr,pool_lv,origin"
+                                           " --configreport pvseg -o pvseg_start"
+                                           " --configreport seg -o lv_uuid,seg_start,seg_size,segtype,stripes,devices"
+                                           " 2>/dev/null"sv;
+
+auto json_string(const rapidjson::Value& obj, const char* key) -> std::string {
+    if (obj.HasMember(key) && obj[key].IsString()) {
+        return obj[key].GetString();
+    }
+    return {};
 }
-}  // namespace
 
-namespace gucc::lvm {
+// `json` prints every field as a string, `json_std` prints numbers
+auto json_uint64(const rapidjson::Value& obj, const char* key, std::uint64_t fallback = 0) -> std::uint64_t {
+    if (!obj.HasMember(key)) {
+        return fallback;
+    }
+    const auto& value = obj[key];
+    if (value.IsUint64()) {
+        return value.GetUint64();
+    }
+    if (value.IsString()) {
+        return gucc::utils::parse_uint<std::uint64_t>(value.GetString()).value_or(fallback);
+    }
+    return fallback;
+}
 
-auto parse_vgs_output(std::string_view output) noexcept -> std::vector<std::pair<std::string, std::string>> {
-    if (output.empty()) {
-        return {};
+auto json_array(const rapidjson::Value& obj, const char* key) -> const rapidjson::Value* {
+    if (obj.HasMember(key) && obj[key].IsArray()) {
+        return &obj[key];
     }
+    return nullptr;
+}
 
-    return utils::make_multiline_view(output)
-        | std::ranges::views::transform([](std::string_view line) {
-              auto trimmed = utils::trim(line);
-              auto split   = utils::make_split_view(trimmed, '\t');
-              auto it      = std::ranges::begin(split);
+void parse_vg_report(const rapidjson::Value& report, gucc::lvm::LvmReport& result) {
+    const auto* vgs = json_array(report, "vg");
+    if (vgs == nullptr) {
+        return;
+    }
+    for (const auto& vg : vgs->GetArray()) {
+        result.volume_groups.emplace_back(gucc::lvm::LvmVolumeGroup{
+            .name        = json_string(vg, "vg_name"),
+            .uuid        = json_string(vg, "vg_uuid"),
+            .size        = json_uint64(vg, "vg_size"),
+            .free        = json_uint64(vg, "vg_free"),
+            .extent_size = json_uint64(vg, "vg_extent_size"),
+        });
+    }
+}
 
-              if (it == std::ranges::end(split)) {
-                  return std::pair<std::string, std::string>{};
-              }
-              auto vg_name = std::string{utils::trim(*it)};
-              ++it;
+void parse_pv_report(const rapidjson::Value& report, gucc::lvm::LvmReport& result) {
+    const auto* pvs = json_array(report, "pv");
+    if (pvs == nullptr) {
+        return;
+    }
+    for (const auto& pv : pvs->GetArray()) {
+        result.physical_volumes.emplace_back(gucc::lvm::LvmPhysicalVolume{
+            .name    = json_string(pv, "pv_name"),
+            .uuid    = json_string(pv, "pv_uuid"),
+            .vg_name = json_string(pv, "vg_name"),
+            .size    = json_uint64(pv, "pv_size"),
+            .free    = json_uint64(pv, "pv_free"),
+        });
+    }
+}
 
-              if (it == split.end()) {
-                  return std::make_pair(std::move(vg_name), std::string{});
-              }
-              auto vg_size = std::string{utils::trim(*it)};
+void parse_lv_report(const rapidjson::Value& report, gucc::lvm::LvmReport& result) {
+    const auto lvs_begin = result.logical_volumes.size();
+    if (const auto* lvs = json_array(report, "lv"); lvs != nullptr) {
+        for (const auto& lv : lvs->GetArray()) {
+            result.logical_volumes.emplace_back(gucc::lvm::LvmLogicalVolume{
+                .name    = json_string(lv, "lv_name"),
+                .uuid    = json_string(lv, "lv_uuid"),
+                .vg_name = json_string(lv, "vg_name"),
+                .path    = json_string(lv, "lv_path"),
+                .size    = json_uint64(lv, "lv_size"),
+                .attr    = json_string(lv, "lv_attr"),
+                .pool_lv = json_string(lv, "pool_lv"),
+                .origin  = json_string(lv, "origin"),
+            });
+        }
+    }
 
-              return std::make_pair(std::move(vg_name), std::move(vg_size));
-          })
-        | std::ranges::views::filter([](auto&& pair) { return !pair.first.empty(); })
-        | std::ranges::to<std::vector<std::pair<std::string, std::string>>>();
+    // segments are reported per VG, so only the LVs of this report can own them
+    const auto* segs = json_array(report, "seg");
+    if (segs == nullptr) {
+        return;
+    }
+    const auto report_lvs = std::ranges::subrange(result.logical_volumes.begin() + static_cast<std::ptrdiff_t>(lvs_begin), result.logical_volumes.end());
+    for (const auto& seg : segs->GetArray()) {
+        const auto& lv_uuid = json_string(seg, "lv_uuid");
+        auto lv_it          = std::ranges::find(report_lvs, lv_uuid, &gucc::lvm::LvmLogicalVolume::uuid);
+        if (lv_it == report_lvs.end()) {
+            continue;
+        }
+        lv_it->segments.emplace_back(gucc::lvm::LvmSegment{
+            .start   = json_uint64(seg, "seg_start"),
+            .size    = json_uint64(seg, "seg_size"),
+            .type    = json_string(seg, "segtype"),
+            // every segment has at least one stripe, also when lvm leaves the field out
+            .stripes = static_cast<std::uint32_t>(json_uint64(seg, "stripes", 1)),
+            .devices = gucc::lvm::detail::parse_segment_devices(json_string(seg, "devices")),
+        });
+    }
 }
 
-auto detect_lvm() noexcept -> LvmInfo {
-    LvmInfo info{};
+}  // namespace
 
-    // Get physical volumes using --noheading for clean output
-    const auto& pv_output = utils::exec("pvs -o pv_name --noheading 2>/dev/null");
-    if (!pv_output.empty()) {
-        info.physical_volumes = parse_simple_lvm_output(pv_output);
+namespace gucc::lvm::detail {
+
+auto parse_segment_devices(std::string_view devices) noexcept -> std::vector<std::string> {
+    std::vector<std::string> result{};
+    for (auto&& device : utils::make_split_view(devices, ',')) {
+        // strip the starting extent, e.g "/dev/sda2(0)"
+        const auto paren_pos = device.rfind('(');
+        const auto name      = utils::trim(device.substr(0, paren_pos));
+        if (!name.empty()) {
+            result.emplace_back(name);
+        }
     }
+    return result;
+}
 
-    // Get volume groups
-    const auto& vg_output = utils::exec("vgs -o vg_name --noheading 2>/dev/null");
-    if (!vg_output.empty()) {
-        info.volume_groups = parse_simple_lvm_output(vg_output);
+auto parse_lvm_fullreport(std::string_view json_output) noexcept -> Result<LvmReport> {
+    rapidjson::Document document;
+    document.Parse(json_output.data(), json_output.size());
+    if (document.HasParseError()) {
+        return make_error(ErrorCode::ParseError, fmt::format(FMT_COMPILE("Failed to parse lvm fullreport output: {}"), rapidjson::GetParseError_En(document.GetParseError())));
+    }
+    if (!document.IsObject()) {
+        return make_error(ErrorCode::ParseError, fmt::format(FMT_COMPILE("Unexpected lvm fullreport output")));
     }
 
-    // Get logical volumes as vg-lv pairs
-    const auto& lv_output = utils::exec("lvs -o vg_name,lv_name --noheading --separator='-' 2>/dev/null");
-    if (!lv_output.empty()) {
-        info.logical_volumes = parse_simple_lvm_output(lv_output);
+    LvmReport result{};
+    // one report per VG, orphan PVs come in a report without VG
+    const auto* reports = json_array(document, "report");
+    if (reports == nullptr) {
+        return result;
+    }
+    for (const auto& report : reports->GetArray()) {
+        if (!report.IsObject()) {
+            continue;
+        }
+        parse_vg_report(report, result);
+        parse_pv_report(report, result);
+        parse_lv_report(report, result);
     }
+    return result;
+}
 
+}  // namespace gucc::lvm::detail
+
+namespace gucc::lvm {
+
+auto read_lvm_report() noexcept -> Result<LvmReport> {
+    const auto& output = utils::exec(LVM_FULLREPORT_CMD);
+    if (output.empty()) {
+        return LvmReport{};
+    }
+    return detail::parse_lvm_fullreport(output);
+}
+
+auto detect_lvm() noexcept -> LvmInfo {
+    auto report = read_lvm_report();
+    if (!report) {
+        spdlog::error("Failed to query LVM: {}", report.error().context);
+        return {};
+    }
+
+    LvmInfo info{};
+    for (auto&& pv : report->physical_volumes) {
+        info.physical_volumes.emplace_back(std::move(pv.name));
+    }
+    for (auto&& vg : report->volume_groups) {
+        info.volume_groups.emplace_back(std::move(vg.name));
+    }
+    for (const auto& lv : report->logical_volumes) {
+        // hidden LVs (raid images, pool metadata) are printed as "[name]"
+        if (lv.name.starts_with('[')) {
+            continue;
+        }
+        info.logical_volumes.emplace_back(fmt::format(FMT_COMPILE("{}-{}"), lv.vg_name, lv.name));
+    }
     return info;
 }
 
@@ -97,9 +228,4 @@ auto activate_lvm() noexcept -> Result<void> {
     return {};
 }
 
-auto show_volume_groups() noexcept -> std::vector<std::pair<std::string, std::string>> {
-    const auto& output = utils::exec("vgs -o vg_name,vg_size --noheading --separator='\t' --units=g 2>/dev/null");
-    return parse_vgs_output(output);
-}
-
 }  // namespace gucc::lvm
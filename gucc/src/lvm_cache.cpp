@@ -0,0 +1,208 @@
+#include "gucc/lvm_cache.hpp"
+#include "gucc/io_utils.hpp"
+#include "gucc/lvm.hpp"
+#include "gucc/process.hpp"
+
+#include <algorithm>   // for find, find_if, any_of
+#include <expected>    // for unexpected
+#include <filesystem>  // for weakly_canonical
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <spdlog/spdlog.h>
+
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+// below that the cache holds too little of the working set to be worth it
+inline constexpr std::uint64_t MIN_CACHE_SIZE = 1024ULL * 1024 * 1024;
+// smallest dm-cache chunk lvm allows by default
+inline constexpr std::uint64_t MIN_CHUNK_SIZE = 64ULL * 1024;
+// lvm warns past that many chunks, the in-kernel mapping gets slow
+inline constexpr std::uint64_t MAX_CACHE_CHUNKS = 1'000'000;
+// a cache under 1% of the origin misses most of the time
+inline constexpr std::uint64_t MIN_CACHE_PERCENT = 1;
+
+auto canonical_device(std::string_view device) noexcept -> std::string {
+    std::error_code ec;
+    auto path = fs::weakly_canonical(fs::path{device}, ec);
+    return ec ? std::string{device} : path.string();
+}
+
+auto cachevol_name(const gucc::lvm::LvmCacheConfig& config) noexcept -> std::string {
+    return fmt::format(FMT_COMPILE("{}_cache"), config.lv_name);
+}
+
+// lvm reports the canonical device names
+auto pv_free(const gucc::lvm::LvmReport& report, std::string_view device) noexcept -> std::optional<std::uint64_t> {
+    const auto& device_path = canonical_device(device);
+    const auto pv_it        = std::ranges::find_if(report.physical_volumes, [&device_path](auto&& pv) { return canonical_device(pv.name) == device_path; });
+    if (pv_it == report.physical_volumes.end()) {
+        return std::nullopt;
+    }
+    return pv_it->free;
+}
+
+}  // namespace
+
+namespace gucc::lvm {
+
+auto string_to_lvm_cache_mode(std::string_view mode) noexcept -> std::optional<LvmCacheMode> {
+    if (mode == "writethrough"sv) {
+        return LvmCacheMode::Writethrough;
+    } else if (mode == "writeback"sv) {
+        return LvmCacheMode::Writeback;
+    } else if (mode == "writecache"sv) {
+        return LvmCacheMode::Writecache;
+    }
+    return std::nullopt;
+}
+
+auto lvm_cache_mode_to_string(LvmCacheMode mode) noexcept -> std::string_view {
+    switch (mode) {
+    case LvmCacheMode::Writethrough:
+        return "writethrough"sv;
+    case LvmCacheMode::Writeback:
+        return "writeback"sv;
+    case LvmCacheMode::Writecache:
+        return "writecache"sv;
+    }
+    return {};
+}
+
+auto plan_lvm_cache(const LvmCacheConfig& config, std::uint64_t origin_free, std::uint64_t cache_free, std::uint64_t extent_size) noexcept -> Result<LvmCachePlan> {
+    if (extent_size == 0) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("volume group '{}' has no extent size"), config.vg_name));
+    }
+
+    LvmCachePlan plan{
+        .origin_size = origin_free / extent_size * extent_size,
+        .cache_size  = cache_free / extent_size * extent_size,
+    };
+    if (plan.cache_size < MIN_CACHE_SIZE) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("cache device '{}' has {} bytes free, the cache needs at least {}"), config.cache_device, plan.cache_size, MIN_CACHE_SIZE));
+    }
+    if (plan.cache_size >= plan.origin_size) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("cache of {} bytes isn't smaller than the origin of {} bytes"), plan.cache_size, plan.origin_size));
+    }
+
+    if (config.mode != LvmCacheMode::Writecache) {
+        plan.chunk_size = MIN_CHUNK_SIZE;
+        while (plan.cache_size / plan.chunk_size > MAX_CACHE_CHUNKS) {
+            plan.chunk_size *= 2;
+        }
+    }
+
+    if (plan.cache_size * 100 < plan.origin_size * MIN_CACHE_PERCENT) {
+        plan.warnings.emplace_back(fmt::format(FMT_COMPILE("cache of {} bytes is under {}% of the origin of {} bytes"), plan.cache_size, MIN_CACHE_PERCENT, plan.origin_size));
+    }
+    if (config.mode != LvmCacheMode::Writethrough) {
+        plan.warnings.emplace_back(fmt::format(FMT_COMPILE("{} keeps unflushed writes only on '{}', losing it loses data of '{}'"), lvm_cache_mode_to_string(config.mode), config.cache_device, config.lv_name));
+    }
+    return plan;
+}
+
+auto create_cached_lv(const LvmCacheConfig& config) noexcept -> Result<std::string> {
+    if (config.origin_devices.empty()) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("no origin devices for '{}'"), config.lv_name));
+    }
+    const auto& cache_path = canonical_device(config.cache_device);
+    if (std::ranges::any_of(config.origin_devices, [&cache_path](auto&& device) { return canonical_device(device) == cache_path; })) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("cache device '{}' is also an origin device"), config.cache_device));
+    }
+
+    // the sizes come from the VG, which a dry run never creates
+    if (utils::default_runner().dry_run()) {
+        spdlog::info("[dry-run] would create '{}/{}' over '{}' with a {} on '{}'", config.vg_name, config.lv_name,
+            fmt::join(config.origin_devices, "', '"), lvm_cache_mode_to_string(config.mode), config.cache_device);
+        return fmt::format(FMT_COMPILE("/dev/{}/{}"), config.vg_name, config.lv_name);
+    }
+
+    // stale signatures make pvcreate refuse the device
+    auto devices = config.origin_devices;
+    devices.emplace_back(config.cache_device);
+    for (const auto& device : devices) {
+        if (!utils::exec_checked(fmt::format(FMT_COMPILE("wipefs -a '{}'"), device))) {
+            return make_error(ErrorCode::SubprocessFailed, fmt::format(FMT_COMPILE("failed to wipe '{}'"), device));
+        }
+    }
+    if (!utils::exec_checked(detail::vgcreate_cmd(config))) {
+        return make_error(ErrorCode::SubprocessFailed, fmt::format(FMT_COMPILE("failed to create volume group '{}'"), config.vg_name));
+    }
+
+    const auto& report = read_lvm_report();
+    if (!report) {
+        return std::unexpected(report.error());
+    }
+    const auto vg_it = std::ranges::find(report->volume_groups, config.vg_name, &LvmVolumeGroup::name);
+    if (vg_it == report->volume_groups.end()) {
+        return make_error(ErrorCode::NotFound, fmt::format(FMT_COMPILE("volume group '{}' is missing after vgcreate"), config.vg_name));
+    }
+    std::uint64_t origin_free{};
+    for (const auto& device : config.origin_devices) {
+        origin_free += pv_free(*report, device).value_or(0);
+    }
+    const auto cache_free = pv_free(*report, config.cache_device).value_or(0);
+
+    const auto& plan = plan_lvm_cache(config, origin_free, cache_free, vg_it->extent_size);
+    if (!plan) {
+        return std::unexpected(plan.error());
+    }
+    for (const auto& warning : plan->warnings) {
+        spdlog::warn("lvm cache: {}", warning);
+    }
+
+    if (!utils::exec_checked(detail::lvcreate_origin_cmd(config))) {
+        return make_error(ErrorCode::SubprocessFailed, fmt::format(FMT_COMPILE("failed to create logical volume '{}'"), config.lv_name));
+    }
+    if (!utils::exec_checked(detail::lvcreate_cachevol_cmd(config, *plan))) {
+        return make_error(ErrorCode::SubprocessFailed, fmt::format(FMT_COMPILE("failed to create cache volume on '{}'"), config.cache_device));
+    }
+    if (!utils::exec_checked(detail::lvconvert_cache_cmd(config, *plan))) {
+        return make_error(ErrorCode::SubprocessFailed, fmt::format(FMT_COMPILE("failed to attach {} to '{}'"), lvm_cache_mode_to_string(config.mode), config.lv_name));
+    }
+
+    spdlog::info("Created '{}/{}' with a {} byte {} on '{}'", config.vg_name, config.lv_name, plan->cache_size, lvm_cache_mode_to_string(config.mode), config.cache_device);
+    return fmt::format(FMT_COMPILE("/dev/{}/{}"), config.vg_name, config.lv_name);
+}
+
+}  // namespace gucc::lvm
+
+namespace gucc::lvm::detail {
+
+auto vgcreate_cmd(const LvmCacheConfig& config) noexcept -> std::string {
+    auto cmd = fmt::format(FMT_COMPILE("vgcreate -y '{}'"), config.vg_name);
+    for (const auto& device : config.origin_devices) {
+        cmd += fmt::format(FMT_COMPILE(" '{}'"), device);
+    }
+    cmd += fmt::format(FMT_COMPILE(" '{}'"), config.cache_device);
+    return cmd;
+}
+
+auto lvcreate_origin_cmd(const LvmCacheConfig& config) noexcept -> std::string {
+    // the PV list keeps the origin off the cache device
+    auto cmd = fmt::format(FMT_COMPILE("lvcreate -y --wipesignatures y -n '{}' -l 100%PVS '{}'"), config.lv_name, config.vg_name);
+    for (const auto& device : config.origin_devices) {
+        cmd += fmt::format(FMT_COMPILE(" '{}'"), device);
+    }
+    return cmd;
+}
+
+auto lvcreate_cachevol_cmd(const LvmCacheConfig& config, const LvmCachePlan& plan) noexcept -> std::string {
+    return fmt::format(FMT_COMPILE("lvcreate -y --wipesignatures y -n '{}' -L {}b '{}' '{}'"), cachevol_name(config), plan.cache_size, config.vg_name, config.cache_device);
+}
+
+auto lvconvert_cache_cmd(const LvmCacheConfig& config, const LvmCachePlan& plan) noexcept -> std::string {
+    // a cachevol keeps the dm-cache metadata next to the data, no separate pool needed
+    if (config.mode == LvmCacheMode::Writecache) {
+        return fmt::format(FMT_COMPILE("lvconvert -y --type writecache --cachevol '{}' '{}/{}'"), cachevol_name(config), config.vg_name, config.lv_name);
+    }
+    return fmt::format(FMT_COMPILE("lvconvert -y --type cache --cachevol '{}' --cachemode {} --chunksize {}k '{}/{}'"),
+        cachevol_name(config), lvm_cache_mode_to_string(config.mode), plan.chunk_size / 1024, config.vg_name, config.lv_name);
+}
+
+}  // namespace gucc::lvm::detail
@@ -1,25 +1,388 @@
 #include "gucc/mirrors.hpp"
+#include "gucc/file_utils.hpp"
+#include "gucc/pacmanconf_repo.hpp"
 #include "gucc/process.hpp"
+#include "gucc/string_utils.hpp"
+
+#include <algorithm>      // for clamp, max, min, ranges::sort, ranges::stable_sort, ranges::unique
+#include <chrono>         // for steady_clock, system_clock
+#include <cmath>          // for ceil
+#include <filesystem>     // for path, create_directories
+#include <memory>         // for shared_ptr, make_shared
+#include <numeric>        // for iota
+#include <ranges>         // for ranges::*
+#include <unordered_map>  // for unordered_map
+#include <utility>        // for pair
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
 
 #include <spdlog/spdlog.h>
 
+#include <cpr/cpr.h>
+
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+inline constexpr auto RANK_HEADER_TITLE = "# Ranked by cachyos-installer"sv;
+inline constexpr auto FILE_URL_PREFIX   = "file://"sv;
+
+// what a mirror is scored on, a typical package
+inline constexpr double REFERENCE_PACKAGE_BYTES = 1024.0 * 1024.0;
+inline constexpr double BYTES_PER_STREAM        = 2.0 * 1024.0 * 1024.0;
+inline constexpr std::uint32_t MIN_PARALLEL     = 2;
+inline constexpr std::uint32_t MAX_PARALLEL     = 16;
+
+auto is_ok(const cpr::Response& response, std::string_view url) noexcept -> bool {
+    if (response.error.code != cpr::ErrorCode::OK) {
+        return false;
+    }
+    // curl reports no status for file://
+    return cpr::status::is_success(static_cast<std::int32_t>(response.status_code))
+        || (url.starts_with(FILE_URL_PREFIX) && response.status_code == 0);
+}
+
+auto make_session(const std::string& url, const gucc::mirrors::ProbeOptions& options) noexcept -> std::shared_ptr<cpr::Session> {
+    auto session = std::make_shared<cpr::Session>();
+    session->SetUrl(cpr::Url{url});
+    session->SetTimeout(cpr::Timeout{options.timeout});
+    return session;
+}
+
+auto unix_now() noexcept -> std::int64_t {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
 namespace gucc::mirrors {
 
-auto rank_mirrors() noexcept -> Result<void> {
-    using utils::default_runner;
-    using utils::ProcessKind;
-    using utils::RunOptions;
+auto default_mirrorlists() noexcept -> std::vector<MirrorList> {
+    // $arch_v3/$arch_v4 expand to x86_64_v3/x86_64_v4 through $arch
+    return {
+        MirrorList{.path = "/etc/pacman.d/mirrorlist", .probe_repo = "core"},
+        MirrorList{.path = "/etc/pacman.d/cachyos-mirrorlist", .probe_repo = "cachyos"},
+        MirrorList{.path = "/etc/pacman.d/cachyos-v3-mirrorlist", .probe_repo = "cachyos-v3"},
+        MirrorList{.path = "/etc/pacman.d/cachyos-v4-mirrorlist", .probe_repo = "cachyos-v4"},
+    };
+}
+
+auto parse_mirrorlist(std::string_view content) noexcept -> std::vector<std::string> {
+    std::vector<std::string> servers{};
+    for (auto&& line : utils::make_split_view(content)) {
+        const auto& trimmed = utils::trim(line);
+        if (!trimmed.starts_with("Server"sv)) {
+            continue;
+        }
+        const auto eq_pos = trimmed.find('=');
+        if (eq_pos == std::string_view::npos || utils::trim(trimmed.substr(0, eq_pos)) != "Server"sv) {
+            continue;
+        }
+        const auto& server = utils::trim(trimmed.substr(eq_pos + 1));
+        if (!server.empty()) {
+            servers.emplace_back(server);
+        }
+    }
+    return servers;
+}
+
+auto server_url(std::string_view server, std::string_view repo, std::string_view arch) noexcept -> std::string {
+    // $arch_v3 turns into x86_64_v3 on the way
+    std::string url{server};
+    for (const auto& [variable, value] : {std::pair{"$repo"sv, repo}, std::pair{"$arch"sv, arch}}) {
+        for (auto pos = url.find(variable); pos != std::string::npos; pos = url.find(variable, pos + value.size())) {
+            url.replace(pos, variable.size(), value);
+        }
+    }
+    while (url.ends_with('/')) {
+        url.pop_back();
+    }
+    return url;
+}
+
+auto probe_mirrors(std::span<const std::string> urls, const ProbeOptions& options) noexcept -> ProbeReport {
+    ProbeReport report{};
+    report.probes.reserve(urls.size());
+    for (const auto& url : urls) {
+        report.probes.emplace_back(MirrorProbe{.url = url});
+    }
+    if (urls.empty()) {
+        return report;
+    }
+
+    // 1. latency of every mirror, a batch at a time
+    const auto batch_size = std::max<std::size_t>(options.latency_batch, 1);
+    for (std::size_t first = 0; first < urls.size(); first += batch_size) {
+        const auto last = std::min(first + batch_size, urls.size());
+        cpr::MultiPerform latency_wave{};
+        std::vector<std::shared_ptr<cpr::Session>> sessions{};
+        for (std::size_t i = first; i < last; ++i) {
+            auto& session = sessions.emplace_back(make_session(urls[i], options));
+            latency_wave.AddSession(session, cpr::MultiPerform::HttpMethod::HEAD_REQUEST);
+        }
+        const auto& responses = latency_wave.Perform();
+        for (std::size_t i = 0; i < std::min(responses.size(), last - first); ++i) {
+            auto& probe      = report.probes[first + i];
+            probe.reachable  = is_ok(responses[i], urls[first + i]);
+            probe.latency_ms = responses[i].elapsed * 1000.0;
+        }
+    }
+
+    // 2. a short transfer from the closest ones, they share the link
+    std::vector<std::size_t> candidates{};
+    for (std::size_t i = 0; i < report.probes.size(); ++i) {
+        if (report.probes[i].reachable) {
+            candidates.push_back(i);
+        }
+    }
+    std::ranges::sort(candidates, {}, [&report](std::size_t i) { return report.probes[i].latency_ms; });
+    candidates.resize(std::min(candidates.size(), options.transfer_candidates));
+    if (candidates.empty()) {
+        return report;
+    }
+
+    cpr::MultiPerform transfer_wave{};
+    std::vector<std::shared_ptr<cpr::Session>> sessions{};
+    const auto& range = fmt::format(FMT_COMPILE("bytes=0-{}"), options.probe_bytes - 1);
+    for (const auto index : candidates) {
+        auto& session = sessions.emplace_back(make_session(urls[index], options));
+        session->SetHeader(cpr::Header{{"Range", range}});
+        transfer_wave.AddSession(session, cpr::MultiPerform::HttpMethod::GET_REQUEST);
+    }
+
+    const auto wave_start = std::chrono::steady_clock::now();
+    const auto& responses = transfer_wave.Perform();
+    const auto wave_secs  = std::chrono::duration<double>(std::chrono::steady_clock::now() - wave_start).count();
+
+    double wave_bytes{};
+    for (std::size_t i = 0; i < std::min(responses.size(), candidates.size()); ++i) {
+        auto& probe = report.probes[candidates[i]];
+        if (!is_ok(responses[i], probe.url) || responses[i].text.empty() || responses[i].elapsed <= 0.0) {
+            probe.reachable = false;
+            continue;
+        }
+        const auto bytes    = static_cast<double>(responses[i].text.size());
+        probe.bytes_per_sec = bytes / responses[i].elapsed;
+        wave_bytes += bytes;
+    }
+    if (wave_secs > 0.0) {
+        report.bandwidth = wave_bytes / wave_secs;
+    }
+    return report;
+}
 
-    spdlog::info("Running rate-mirrors...");
-    if (!default_runner().run({"/usr/bin/pacman", "-Sy", "--noconfirm", "--needed", "cachyos-rate-mirrors", "rate-mirrors"}, RunOptions{.kind = ProcessKind::Mutate}).ok()) {
-        spdlog::warn("Failed to fetch latest cachyos-rate-mirrors. Continuing..");
+auto parallel_downloads_for(double bandwidth) noexcept -> std::uint32_t {
+    if (bandwidth <= 0.0) {
+        return MIN_PARALLEL;
     }
+    const auto streams = static_cast<std::uint32_t>(std::min(std::ceil(bandwidth / BYTES_PER_STREAM), static_cast<double>(MAX_PARALLEL)));
+    return std::clamp(streams, MIN_PARALLEL, MAX_PARALLEL);
+}
 
-    if (!default_runner().run({"/usr/bin/cachyos-rate-mirrors"}, RunOptions{.kind = ProcessKind::Mutate}).ok()) {
-        return make_error(ErrorCode::SubprocessFailed, "Failed to rank mirrors");
+auto set_parallel_downloads(std::string_view conf_path, std::uint32_t parallel_downloads) noexcept -> Result<void> {
+    const auto& conf = file_utils::read_whole_file(conf_path);
+    if (conf.empty()) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to read '{}'"), conf_path));
+    }
+    if (!file_utils::create_file_for_overwrite(conf_path, detail::with_parallel_downloads(conf, parallel_downloads))) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to write '{}'"), conf_path));
     }
-    spdlog::info("Ranked CachyOS mirrors");
+    spdlog::info("ParallelDownloads = {} in '{}'", parallel_downloads, conf_path);
     return {};
 }
 
+auto rank_mirrors(const RankOptions& options) noexcept -> Result<RankResult> {
+    struct PendingList final {
+        const MirrorList* list;
+        std::vector<std::string> servers;
+        std::string source;
+        fs::path cache_path;
+    };
+
+    RankResult result{};
+    // the mirrorlists are host files, left alone like any Mutate process
+    if (utils::default_runner().dry_run()) {
+        spdlog::info("[dry-run] would rank {} mirrorlists", options.mirrorlists.size());
+        result.parallel_downloads = parallel_downloads_for(0.0);
+        return result;
+    }
+    const auto now = unix_now();
+    std::vector<PendingList> pending{};
+    std::error_code ec;
+    for (const auto& list : options.mirrorlists) {
+        // the ISA specific lists only exist where the CPU supports them
+        if (!fs::exists(list.path, ec)) {
+            continue;
+        }
+        auto servers = parse_mirrorlist(file_utils::read_whole_file(list.path));
+        if (servers.empty()) {
+            spdlog::debug("No servers in '{}', skipping", list.path);
+            continue;
+        }
+        auto source     = detail::mirror_set_hash(servers);
+        auto cache_path = fs::path{options.cache_dir} / fs::path{list.path}.filename();
+
+        // back-to-back installs arrive at the same answer
+        const auto& cached = fs::exists(cache_path, ec) ? file_utils::read_whole_file(cache_path.string()) : std::string{};
+        if (const auto header = detail::parse_rank_header(cached);
+            header && header->source == source && now >= header->ranked_at && (now - header->ranked_at) < options.cache_ttl.count()) {
+            if (!file_utils::create_file_for_overwrite(list.path, cached)) {
+                return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to write '{}'"), list.path));
+            }
+            spdlog::info("Using mirror ranking of '{}' from {}s ago", list.path, now - header->ranked_at);
+            result.bandwidth = std::max(result.bandwidth, header->bandwidth);
+            ++result.cached_lists;
+            continue;
+        }
+        pending.emplace_back(PendingList{.list = &list, .servers = std::move(servers), .source = std::move(source), .cache_path = std::move(cache_path)});
+    }
+
+    // one batch for every list, the CachyOS lists share most hosts
+    std::vector<std::string> urls{};
+    std::unordered_map<std::string, std::size_t> url_index{};
+    for (const auto& entry : pending) {
+        for (const auto& server : entry.servers) {
+            auto url = detail::probe_url(server, entry.list->probe_repo);
+            if (!url_index.contains(url)) {
+                url_index.emplace(url, urls.size());
+                urls.emplace_back(std::move(url));
+            }
+        }
+    }
+    if (!urls.empty()) {
+        spdlog::info("Probing {} mirrors...", urls.size());
+    }
+    const auto& report = probe_mirrors(urls, options.probe);
+    result.bandwidth   = std::max(result.bandwidth, report.bandwidth);
+
+    fs::create_directories(options.cache_dir, ec);
+    for (const auto& entry : pending) {
+        std::vector<MirrorProbe> probes{};
+        for (const auto& server : entry.servers) {
+            probes.push_back(report.probes[url_index.at(detail::probe_url(server, entry.list->probe_repo))]);
+        }
+        if (std::ranges::none_of(probes, &MirrorProbe::reachable)) {
+            spdlog::warn("No mirror of '{}' answered, leaving it as is", entry.list->path);
+            continue;
+        }
+
+        std::vector<std::string> ranked{};
+        for (const auto index : detail::rank_order(probes)) {
+            ranked.push_back(entry.servers[index]);
+        }
+        const auto& content = detail::render_mirrorlist(ranked, {.ranked_at = now, .source = entry.source, .bandwidth = report.bandwidth});
+        if (!file_utils::create_file_for_overwrite(entry.list->path, content)) {
+            return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to write '{}'"), entry.list->path));
+        }
+        // a missing cache only costs the next install a probe
+        if (ec || !file_utils::create_file_for_overwrite(entry.cache_path.string(), content)) {
+            spdlog::warn("Failed to cache the ranking of '{}'", entry.list->path);
+        }
+        spdlog::info("Ranked '{}', fastest is {}", entry.list->path, ranked.front());
+        ++result.probed_lists;
+    }
+
+    if (result.cached_lists == 0 && result.probed_lists == 0) {
+        return make_error(ErrorCode::NotFound, "no mirror answered");
+    }
+    result.parallel_downloads = parallel_downloads_for(result.bandwidth);
+    return result;
+}
+
 }  // namespace gucc::mirrors
+
+namespace gucc::mirrors::detail {
+
+auto probe_url(std::string_view server, std::string_view repo) noexcept -> std::string {
+    return fmt::format(FMT_COMPILE("{}/{}.db"), server_url(server, repo), repo);
+}
+
+auto mirror_set_hash(std::vector<std::string> servers) noexcept -> std::string {
+    std::ranges::sort(servers);
+    const auto [first, last] = std::ranges::unique(servers);
+    servers.erase(first, last);
+
+    // FNV-1a
+    std::uint64_t hash{0xcbf29ce484222325ULL};
+    for (const auto& server : servers) {
+        for (const auto ch : server) {
+            hash = (hash ^ static_cast<std::uint8_t>(ch)) * 0x100000001b3ULL;
+        }
+        hash = (hash ^ static_cast<std::uint8_t>('\n')) * 0x100000001b3ULL;
+    }
+    return fmt::format(FMT_COMPILE("{:016x}"), hash);
+}
+
+auto rank_order(std::span<const MirrorProbe> probes) noexcept -> std::vector<std::size_t> {
+    // 0: transfer probed, 1: latency only, 2: unreachable
+    const auto tier = [&probes](std::size_t i) {
+        const auto& probe = probes[i];
+        if (!probe.reachable) {
+            return 2;
+        }
+        return (probe.bytes_per_sec > 0.0) ? 0 : 1;
+    };
+    const auto score = [&probes](std::size_t i) {
+        const auto& probe = probes[i];
+        if (!probe.reachable) {
+            return 0.0;
+        }
+        const auto latency_secs = probe.latency_ms / 1000.0;
+        return (probe.bytes_per_sec > 0.0) ? latency_secs + (REFERENCE_PACKAGE_BYTES / probe.bytes_per_sec) : latency_secs;
+    };
+
+    std::vector<std::size_t> order(probes.size());
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    std::ranges::stable_sort(order, {}, [&](std::size_t i) { return std::pair{tier(i), score(i)}; });
+    return order;
+}
+
+auto render_mirrorlist(std::span<const std::string> servers, const RankHeader& header) noexcept -> std::string {
+    auto content = fmt::format(FMT_COMPILE("{}\n## ranked_at = {}\n## source = {}\n## bandwidth = {:.0f}\n\n"),
+        RANK_HEADER_TITLE, header.ranked_at, header.source, header.bandwidth);
+    for (const auto& server : servers) {
+        content += fmt::format(FMT_COMPILE("Server = {}\n"), server);
+    }
+    return content;
+}
+
+auto parse_rank_header(std::string_view content) noexcept -> std::optional<RankHeader> {
+    if (!content.starts_with(RANK_HEADER_TITLE)) {
+        return std::nullopt;
+    }
+
+    RankHeader header{};
+    bool has_ranked_at{false};
+    for (auto&& line : utils::make_split_view(content)) {
+        if (!line.starts_with("## "sv)) {
+            continue;
+        }
+        const auto eq_pos = line.find(" = "sv);
+        if (eq_pos == std::string_view::npos) {
+            continue;
+        }
+        const auto& key   = line.substr(3, eq_pos - 3);
+        const auto& value = line.substr(eq_pos + 3);
+        if (key == "ranked_at"sv) {
+            const auto ranked_at = utils::parse_uint<std::uint64_t>(value);
+            has_ranked_at        = ranked_at.has_value();
+            header.ranked_at     = static_cast<std::int64_t>(ranked_at.value_or(0));
+        } else if (key == "source"sv) {
+            header.source = std::string{value};
+        } else if (key == "bandwidth"sv) {
+            header.bandwidth = static_cast<double>(utils::parse_uint<std::uint64_t>(value).value_or(0));
+        }
+    }
+    if (!has_ranked_at || header.source.empty()) {
+        return std::nullopt;
+    }
+    return header;
+}
+
+auto with_parallel_downloads(std::string_view conf, std::uint32_t parallel_downloads) noexcept -> std::string {
+    return gucc::detail::pacmanconf::with_options_key(conf, "ParallelDownloads"sv, fmt::format(FMT_COMPILE("ParallelDownloads = {}\n"), parallel_downloads));
+}
+
+}  // namespace gucc::mirrors::detail
@@ -0,0 +1,297 @@
+#include "gucc/mount_table.hpp"
+
+#include <cerrno>   // for errno
+#include <cstdio>   // for fopen, fread, fclose
+#include <cstring>  // for strerror
+
+#include <algorithm>  // for stable_sort, lower_bound, equal_range, reverse
+#include <charconv>   // for from_chars
+#include <numeric>    // for iota
+#include <optional>   // for optional
+#include <string>     // for string
+#include <utility>    // for move
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+// mountinfo reports zero size, so the file is read until EOF
+inline constexpr std::size_t READ_CHUNK_SIZE = 16 * 1024;
+
+constexpr auto is_octal_digit(char c) noexcept -> bool {
+    return c >= '0' && c <= '7';
+}
+
+// Escapes only ever shrink the text, so decoding happens in place.
+// Returns the new end of the field.
+auto decode_escapes_in_place(char* first, char* last) noexcept -> char* {
+    char* out = first;
+    for (char* it = first; it != last; ++it) {
+        if (*it == '\\' && (last - it) >= 4 && is_octal_digit(it[1]) && is_octal_digit(it[2]) && is_octal_digit(it[3])) {
+            *out++ = static_cast<char>(((it[1] - '0') << 6) | ((it[2] - '0') << 3) | (it[3] - '0'));
+            it += 3;
+            continue;
+        }
+        *out++ = *it;
+    }
+    return out;
+}
+
+auto parse_uint32(std::string_view value, std::uint32_t& result) noexcept -> bool {
+    const auto* end      = value.data() + value.size();
+    const auto [ptr, ec] = std::from_chars(value.data(), end, result);
+    return ec == std::errc{} && ptr == end && !value.empty();
+}
+
+// Splits [first, last) at single spaces, without copying.
+class FieldReader final {
+ public:
+    FieldReader(char* first, char* last) noexcept : m_pos(first), m_last(last) { }
+
+    [[nodiscard]] auto next(char*& field_first, char*& field_last) noexcept -> bool {
+        if (m_pos == nullptr) {
+            return false;
+        }
+        field_first = m_pos;
+        field_last  = std::find(m_pos, m_last, ' ');
+        m_pos       = (field_last == m_last) ? nullptr : field_last + 1;
+        return true;
+    }
+
+    [[nodiscard]] auto next_view(std::string_view& field) noexcept -> bool {
+        char* field_first{};
+        char* field_last{};
+        if (!next(field_first, field_last)) {
+            return false;
+        }
+        field = std::string_view{field_first, field_last};
+        return true;
+    }
+
+ private:
+    char* m_pos;
+    char* m_last;
+};
+
+// e.g format: <mount id> <parent id> <major:minor> <root> <mountpoint> <opts> [optional fields...] - <fstype> <source> <super opts>
+auto parse_mountinfo_line(char* first, char* last) noexcept -> std::optional<gucc::mtab::MountInfoEntry> {
+    gucc::mtab::MountInfoEntry entry{};
+    FieldReader reader{first, last};
+
+    std::string_view mount_id{};
+    std::string_view parent_id{};
+    std::string_view dev{};
+    if (!reader.next_view(mount_id) || !reader.next_view(parent_id) || !reader.next_view(dev)) {
+        return std::nullopt;
+    }
+    const auto colon_pos = dev.find(':');
+    if (colon_pos == std::string_view::npos || !parse_uint32(mount_id, entry.mount_id)
+        || !parse_uint32(parent_id, entry.parent_id) || !parse_uint32(dev.substr(0, colon_pos), entry.major)
+        || !parse_uint32(dev.substr(colon_pos + 1), entry.minor)) {
+        return std::nullopt;
+    }
+
+    char* root_first{};
+    char* root_last{};
+    char* mountpoint_first{};
+    char* mountpoint_last{};
+    if (!reader.next(root_first, root_last) || !reader.next(mountpoint_first, mountpoint_last) || !reader.next_view(entry.mount_opts)) {
+        return std::nullopt;
+    }
+
+    // skip the optional fields (shared:N, master:N, ...) up to the separator
+    std::string_view field{};
+    do {
+        if (!reader.next_view(field)) {
+            return std::nullopt;
+        }
+    } while (field != "-"sv);
+
+    char* source_first{};
+    char* source_last{};
+    if (!reader.next_view(entry.fstype) || !reader.next(source_first, source_last)) {
+        return std::nullopt;
+    }
+    // super options are always there, but be lenient
+    if (!reader.next_view(entry.super_opts)) {
+        entry.super_opts = {};
+    }
+
+    entry.root       = std::string_view{root_first, decode_escapes_in_place(root_first, root_last)};
+    entry.mountpoint = std::string_view{mountpoint_first, decode_escapes_in_place(mountpoint_first, mountpoint_last)};
+    entry.source     = std::string_view{source_first, decode_escapes_in_place(source_first, source_last)};
+    return entry;
+}
+
+constexpr auto strip_trailing_slashes(std::string_view path) noexcept -> std::string_view {
+    while (path.size() > 1 && path.ends_with('/')) {
+        path.remove_suffix(1);
+    }
+    return path;
+}
+
+// "/mnt/boot" is under "/mnt", "/mnt2" is not
+constexpr auto is_under(std::string_view mountpoint, std::string_view prefix) noexcept -> bool {
+    if (!mountpoint.starts_with(prefix)) {
+        return false;
+    }
+    return mountpoint.size() == prefix.size() || prefix == "/"sv || mountpoint[prefix.size()] == '/';
+}
+
+}  // namespace
+
+namespace gucc::mtab {
+
+auto MountTable::read(std::string_view mountinfo_path) noexcept -> Result<MountTable> {
+    const std::string path{mountinfo_path};
+    auto* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("Failed to open '{}': {}"), mountinfo_path, std::strerror(errno)));
+    }
+
+    MountTable table{};
+    std::size_t size{};
+    while (true) {
+        table.m_buffer.resize(size + READ_CHUNK_SIZE);
+        const auto read = std::fread(table.m_buffer.data() + size, sizeof(char), READ_CHUNK_SIZE, file);
+        size += read;
+        if (read < READ_CHUNK_SIZE) {
+            break;
+        }
+    }
+    const bool has_error = std::ferror(file) != 0;
+    std::fclose(file);
+    if (has_error) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("Failed to read '{}'"), mountinfo_path));
+    }
+    table.m_buffer.resize(size);
+
+    if (auto res = table.parse_buffer(); !res) {
+        return std::unexpected(std::move(res.error()));
+    }
+    return table;
+}
+
+auto MountTable::parse(std::string_view mountinfo_content) noexcept -> Result<MountTable> {
+    MountTable table{};
+    table.m_buffer.assign(mountinfo_content.begin(), mountinfo_content.end());
+    if (auto res = table.parse_buffer(); !res) {
+        return std::unexpected(std::move(res.error()));
+    }
+    return table;
+}
+
+auto MountTable::parse_buffer() noexcept -> Result<void> {
+    char* pos        = m_buffer.data();
+    char* buffer_end = m_buffer.data() + m_buffer.size();
+
+    std::size_t line_number{};
+    while (pos < buffer_end) {
+        char* line_end = std::find(pos, buffer_end, '\n');
+        ++line_number;
+        if (line_end != pos) {
+            auto entry = parse_mountinfo_line(pos, line_end);
+            if (!entry) {
+                return make_error(ErrorCode::ParseError, fmt::format(FMT_COMPILE("Malformed mountinfo line {}: '{}'"), line_number, std::string_view{pos, line_end}));
+            }
+            m_entries.emplace_back(*entry);
+        }
+        pos = line_end + 1;
+    }
+
+    build_index();
+    return {};
+}
+
+void MountTable::build_index() noexcept {
+    const auto entries_count = static_cast<std::uint32_t>(m_entries.size());
+
+    m_by_id.reserve(entries_count);
+    for (std::uint32_t i = 0; i < entries_count; ++i) {
+        m_by_id.emplace(m_entries[i].mount_id, i);
+    }
+
+    m_by_mountpoint.resize(entries_count);
+    std::iota(m_by_mountpoint.begin(), m_by_mountpoint.end(), 0U);
+    // stable, so stacked mounts on the same path keep the mount order
+    std::ranges::stable_sort(m_by_mountpoint, {}, [this](std::uint32_t index) { return m_entries[index].mountpoint; });
+
+    m_children.resize(entries_count);
+    for (std::uint32_t i = 0; i < entries_count; ++i) {
+        const auto parent_it = m_by_id.find(m_entries[i].parent_id);
+        // the root mount is its own parent, or the parent is outside of our namespace
+        if (parent_it != m_by_id.end() && parent_it->second != i) {
+            m_children[parent_it->second].push_back(i);
+        }
+    }
+}
+
+auto MountTable::find_by_id(std::uint32_t mount_id) const noexcept -> const MountInfoEntry* {
+    const auto it = m_by_id.find(mount_id);
+    return (it != m_by_id.end()) ? &m_entries[it->second] : nullptr;
+}
+
+auto MountTable::find_by_mountpoint(std::string_view mountpoint) const noexcept -> const MountInfoEntry* {
+    const auto path  = strip_trailing_slashes(mountpoint);
+    const auto range = std::ranges::equal_range(m_by_mountpoint, path, {}, [this](std::uint32_t index) { return m_entries[index].mountpoint; });
+    if (range.empty()) {
+        return nullptr;
+    }
+    // the last mounted one covers the others
+    return &m_entries[range.back()];
+}
+
+auto MountTable::mounts_under(std::string_view root_mountpoint) const noexcept -> std::vector<const MountInfoEntry*> {
+    const auto prefix = strip_trailing_slashes(root_mountpoint);
+    if (prefix.empty()) {
+        return {};
+    }
+
+    std::vector<const MountInfoEntry*> result{};
+    std::vector<std::uint32_t> pending{};
+
+    const auto by_mountpoint = [this](std::uint32_t index) { return m_entries[index].mountpoint; };
+    for (auto it = std::ranges::lower_bound(m_by_mountpoint, prefix, {}, by_mountpoint); it != m_by_mountpoint.end(); ++it) {
+        const auto& entry = m_entries[*it];
+        if (!entry.mountpoint.starts_with(prefix)) {
+            break;
+        }
+        // e.g "/mnt-old" sorts between "/mnt" and "/mnt/boot"
+        if (!is_under(entry.mountpoint, prefix)) {
+            continue;
+        }
+        // only start at the top of each subtree, the rest is reached through the children
+        const auto* parent = find_by_id(entry.parent_id);
+        if (parent != nullptr && parent != &entry && is_under(parent->mountpoint, prefix)) {
+            continue;
+        }
+
+        // pre-order walk, every parent lands before its children
+        pending.push_back(*it);
+        while (!pending.empty()) {
+            const auto index = pending.back();
+            pending.pop_back();
+            result.push_back(&m_entries[index]);
+            for (const auto child : m_children[index]) {
+                if (is_under(m_entries[child].mountpoint, prefix)) {
+                    pending.push_back(child);
+                }
+            }
+        }
+    }
+
+    std::ranges::reverse(result);
+    return result;
+}
+
+auto decode_mount_escapes(std::string_view escaped) noexcept -> std::string {
+    std::string result{escaped};
+    auto* new_end = decode_escapes_in_place(result.data(), result.data() + result.size());
+    result.resize(static_cast<std::size_t>(new_end - result.data()));
+    return result;
+}
+
+}  // namespace gucc::mtab
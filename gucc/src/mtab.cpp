@@ -1,9 +1,10 @@
 #include "gucc/mtab.hpp"
-#include "gucc/file_utils.hpp"
+#include "gucc/mount_table.hpp"
 #include "gucc/string_utils.hpp"
 
 #include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -16,21 +17,12 @@ namespace {
 
 auto read_mtab(std::string_view mtab_path) noexcept -> std::optional<std::string> {
     // mtab file size is reported as zero bytes
-    // so just read line by line until EOF
+    // so just read until EOF
     std::ifstream file(fs::path{mtab_path}, std::ios::binary);
     if (!file.is_open()) {
         return std::nullopt;
     }
-
-    std::vector<std::string> lines{};
-    while (file) {
-        std::string line{};
-        std::getline(file, line);
-        lines.push_back(std::move(line));
-    }
-
-    auto&& mtab_content = gucc::utils::join(lines);
-    return std::make_optional<std::string>(std::move(mtab_content));
+    return std::make_optional<std::string>(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
 }
 
 }  // namespace
@@ -50,9 +42,10 @@ auto parse_mtab_content(std::string_view mtab_content, std::string_view root_mou
         auto&& device     = *utils::index_viewable_range(line_split, 0);
         if (utils::size_viewable_range(line_split) >= 3 && !device.starts_with('#')) {
             // e.g format: <device> <mountpoint> <fstype> <options>
-            auto&& mountpoint = *utils::index_viewable_range(line_split, 1);
+            // spaces and such in paths are octal-escaped, e.g \040
+            auto&& mountpoint = mtab::decode_mount_escapes(*utils::index_viewable_range(line_split, 1));
             if (mountpoint.starts_with(root_mountpoint)) {
-                entries.emplace_back(MTabEntry{.device = std::string{device}, .mountpoint = std::string{mountpoint}});
+                entries.emplace_back(MTabEntry{.device = mtab::decode_mount_escapes(device), .mountpoint = std::move(mountpoint)});
             }
         }
     }
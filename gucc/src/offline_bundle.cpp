@@ -0,0 +1,284 @@
+#include "gucc/offline_bundle.hpp"
+#include "gucc/file_utils.hpp"
+#include "gucc/mount_table.hpp"
+#include "gucc/package_cache.hpp"
+#include "gucc/package_download.hpp"
+#include "gucc/process.hpp"
+#include "gucc/string_utils.hpp"
+#include "gucc/sync_db.hpp"
+
+#include <algorithm>      // for ranges::contains
+#include <filesystem>     // for copy_file, create_directories, directory_iterator, exists
+#include <ranges>         // for views::split
+#include <span>           // for span
+#include <unordered_set>  // for unordered_set
+#include <utility>        // for move
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include <spdlog/spdlog.h>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+auto db_path_of(std::string_view dir, std::string_view repo) noexcept -> std::string {
+    return fmt::format(FMT_COMPILE("{}/{}.db"), dir, repo);
+}
+
+// older versions left from a previous build, pacman would never ask for them
+void remove_stale_files(std::string_view dir, const std::unordered_set<std::string>& wanted) noexcept {
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator{dir, ec}) {
+        const auto& filename = entry.path().filename().string();
+        if (!gucc::pkgcache::detail::is_cache_file(filename) || wanted.contains(filename)) {
+            continue;
+        }
+        std::error_code remove_ec;
+        fs::remove(entry.path(), remove_ec);
+    }
+}
+
+auto target_path_of(std::string_view bundle_dir, std::string_view mountpoint) noexcept -> std::string {
+    // normal form, the way the mount table lists it
+    return (fs::path{mountpoint} / fs::path{bundle_dir}.relative_path()).lexically_normal().string();
+}
+
+// Fetches the current `<repo>.db` of every repo into @p sync_dir, like pacman -Sy into a private dbpath.
+auto refresh_sync_dbs(std::string_view sync_dir, std::span<const std::string> repos, const gucc::download::RepoServers& servers, std::size_t max_connections) noexcept -> gucc::Result<void> {
+    std::error_code ec;
+    fs::create_directories(sync_dir, ec);
+    if (ec) {
+        return gucc::make_error(gucc::ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to create '{}': {}"), sync_dir, ec.message()));
+    }
+
+    std::vector<gucc::download::PackageFile> dbs{};
+    for (const auto& repo : repos) {
+        // no size nor checksum to go by, a db left from the last build would count as complete
+        const auto& db_path = db_path_of(sync_dir, repo);
+        fs::remove(db_path, ec);
+        fs::remove(fmt::format(FMT_COMPILE("{}.part"), db_path), ec);
+        dbs.emplace_back(gucc::download::PackageFile{.repo = repo, .filename = fmt::format(FMT_COMPILE("{}.db"), repo)});
+    }
+    const auto& fetched = gucc::download::download_packages(dbs, servers, {.cache_dir = std::string{sync_dir}, .max_connections = max_connections, .signatures = false});
+    if (!fetched) {
+        return std::unexpected(fetched.error());
+    }
+    if (!fetched->failed.empty()) {
+        return gucc::make_error(gucc::ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to sync {}"), gucc::utils::join(fetched->failed, ' ')));
+    }
+    return {};
+}
+
+}  // namespace
+
+namespace gucc::bundle {
+
+auto repo_dir(std::string_view bundle_dir, std::string_view repo) noexcept -> std::string {
+    return fmt::format(FMT_COMPILE("{}/{}/{}"), bundle_dir, kReposDir, repo);
+}
+
+auto build(std::string_view bundle_dir, std::span<const std::string> targets, const BuildOptions& options) noexcept -> Result<BuildResult> {
+    const auto& repos = syncdb::repos_of_pacman_conf(options.pacman_config);
+    if (repos.empty()) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("no repos in '{}'"), options.pacman_config));
+    }
+    const auto& servers = download::repo_servers(options.pacman_config);
+    auto sync_dir       = options.sync_dir;
+    if (sync_dir.empty()) {
+        sync_dir = fmt::format(FMT_COMPILE("{}/{}"), bundle_dir, kSyncDir);
+        if (auto res = refresh_sync_dbs(sync_dir, repos, servers, options.max_connections); !res) {
+            return std::unexpected(std::move(res.error()));
+        }
+    }
+    auto db = syncdb::SyncDatabase::load(sync_dir, repos);
+    if (!db) {
+        return std::unexpected(std::move(db.error()));
+    }
+
+    const auto& resolution = db->resolve(targets);
+    for (const auto& missing : resolution.missing) {
+        if (missing.required_by.empty()) {
+            spdlog::error("bundle: target not found: {}", missing.dependency);
+        } else {
+            spdlog::error("bundle: unable to satisfy '{}' required by {}", missing.dependency, missing.required_by);
+        }
+    }
+    for (const auto& conflict : resolution.conflicts) {
+        spdlog::error("bundle: {} and {} are in conflict ({})", conflict.package, conflict.conflicts_with, conflict.rule);
+    }
+    if (!resolution.ok()) {
+        return make_error(ErrorCode::NotFound, fmt::format(FMT_COMPILE("{} unresolved dependencies, {} conflicts"), resolution.missing.size(), resolution.conflicts.size()));
+    }
+
+    for (const auto& repo : repos) {
+        const auto& dir = repo_dir(bundle_dir, repo);
+        std::error_code ec;
+        fs::create_directories(dir, ec);
+        if (ec) {
+            return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to create '{}': {}"), dir, ec.message()));
+        }
+
+        std::vector<download::PackageFile> files{};
+        std::unordered_set<std::string> package_dirs{};
+        std::unordered_set<std::string> wanted{};
+        for (const auto& pkg : resolution.packages) {
+            if (pkg.repo != repo) {
+                continue;
+            }
+            files.emplace_back(download::PackageFile{.repo = repo, .filename = std::string{pkg.filename}, .size = pkg.download_size, .sha256sum = std::string{pkg.sha256sum}});
+            package_dirs.insert(fmt::format(FMT_COMPILE("{}-{}"), pkg.name, pkg.version));
+            wanted.insert(std::string{pkg.filename});
+            wanted.insert(fmt::format(FMT_COMPILE("{}.sig"), pkg.filename));
+        }
+        if (!files.empty()) {
+            const auto& fetched = download::download_packages(files, servers, {.cache_dir = dir, .max_connections = options.max_connections});
+            if (!fetched) {
+                return std::unexpected(fetched.error());
+            }
+            if (!fetched->failed.empty()) {
+                return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to fetch {}"), utils::join(fetched->failed, ' ')));
+            }
+        }
+        remove_stale_files(dir, wanted);
+
+        // the sync db entries are what repo-add would write for the very same files
+        auto entries = syncdb::read_db_entries(db_path_of(sync_dir, repo));
+        if (!entries) {
+            return std::unexpected(std::move(entries.error()));
+        }
+        std::erase_if(*entries, [&package_dirs](const auto& entry) { return !package_dirs.contains(entry.dir); });
+        if (!file_utils::create_file_for_overwrite(db_path_of(dir, repo), syncdb::write_db_tar(*entries))) {
+            return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to write '{}'"), db_path_of(dir, repo)));
+        }
+        spdlog::debug("bundle: '{}' carries {} packages", repo, entries->size());
+    }
+
+    spdlog::info("bundle '{}': {} packages, {:.1f}MiB", bundle_dir, resolution.packages.size(), static_cast<double>(resolution.download_size) / (1024.0 * 1024.0));
+    return BuildResult{
+        .packages      = resolution.packages.size(),
+        .download_size = resolution.download_size,
+        .install_size  = resolution.install_size,
+    };
+}
+
+auto use_bundle(std::string_view conf_path, std::string_view bundle_dir) noexcept -> Result<void> {
+    std::vector<std::string> repos{};
+    for (auto&& repo : syncdb::repos_of_pacman_conf(conf_path)) {
+        if (std::error_code ec; fs::exists(db_path_of(repo_dir(bundle_dir, repo), repo), ec)) {
+            repos.emplace_back(std::move(repo));
+        }
+    }
+    if (repos.empty()) {
+        return make_error(ErrorCode::NotFound, fmt::format(FMT_COMPILE("'{}' carries none of the repos of '{}'"), bundle_dir, conf_path));
+    }
+
+    const auto& conf = file_utils::read_whole_file(conf_path);
+    if (conf.empty()) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to read '{}'"), conf_path));
+    }
+    if (!file_utils::create_file_for_overwrite(conf_path, detail::with_bundle_servers(conf, bundle_dir, repos))) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to write '{}'"), conf_path));
+    }
+    spdlog::info("Installing from the bundle at '{}': {}", bundle_dir, utils::join(repos, ' '));
+    return {};
+}
+
+auto attach(std::string_view bundle_dir, std::string_view mountpoint) noexcept -> Result<void> {
+    const auto& target_dir = target_path_of(bundle_dir, mountpoint);
+    if (utils::default_runner().dry_run()) {
+        spdlog::info("[dry-run] would bind mount '{}' at '{}'", bundle_dir, target_dir);
+        return {};
+    }
+    std::error_code ec;
+    fs::create_directories(target_dir, ec);
+    if (ec) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to create '{}': {}"), target_dir, ec.message()));
+    }
+    // argv, the bundle may live on a path with spaces
+    if (!utils::default_runner().run({"mount"s, "--bind"s, std::string{bundle_dir}, target_dir}).ok()) {
+        return make_error(ErrorCode::SubprocessFailed, fmt::format(FMT_COMPILE("failed to bind mount '{}' at '{}'"), bundle_dir, target_dir));
+    }
+    return {};
+}
+
+auto detach(std::string_view bundle_dir, std::string_view mountpoint, std::string_view host_conf) noexcept -> Result<void> {
+    const auto& target_dir = target_path_of(bundle_dir, mountpoint);
+    // the mount table, not a process, dry-run reports every process as successful
+    const auto& mount_table = mtab::MountTable::read();
+    if (!mount_table) {
+        return std::unexpected(mount_table.error());
+    }
+    if (mount_table->find_by_mountpoint(target_dir) != nullptr) {
+        if (!utils::default_runner().run({"umount"s, target_dir}).ok()) {
+            return make_error(ErrorCode::SubprocessFailed, fmt::format(FMT_COMPILE("failed to umount '{}'"), target_dir));
+        }
+        // the empty dirs attach created on the way, up to the first one the target had already
+        const fs::path root{mountpoint};
+        for (fs::path dir{target_dir}; dir != root && dir.has_relative_path(); dir = dir.parent_path()) {
+            std::error_code remove_ec;
+            if (!fs::is_empty(dir, remove_ec) || !fs::remove(dir, remove_ec)) {
+                break;
+            }
+        }
+    }
+
+    const auto& target_conf = fmt::format(FMT_COMPILE("{}/etc/pacman.conf"), mountpoint);
+    std::error_code ec;
+    fs::copy_file(host_conf, target_conf, fs::copy_options::overwrite_existing, ec);
+    if (ec) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to copy '{}' -> '{}': {}"), host_conf, target_conf, ec.message()));
+    }
+    return {};
+}
+
+}  // namespace gucc::bundle
+
+namespace gucc::bundle::detail {
+
+auto with_bundle_servers(std::string_view conf, std::string_view bundle_dir, std::span<const std::string> repos) noexcept -> std::string {
+    const bool trailing_newline = conf.ends_with('\n');
+    if (trailing_newline) {
+        conf.remove_suffix(1);
+    }
+
+    std::string result{};
+    // true in [options] and the bundled repos
+    bool keep{true};
+    bool in_repo{false};
+    for (auto&& line_rng : conf | std::views::split('\n')) {
+        const std::string_view line{line_rng.begin(), line_rng.end()};
+        const auto& trimmed = utils::trim(line);
+        if (trimmed.size() > 2 && trimmed.front() == '[' && trimmed.back() == ']') {
+            const auto section = trimmed.substr(1, trimmed.size() - 2);
+            in_repo            = (section != "options"sv);
+            keep               = !in_repo || std::ranges::contains(repos, section);
+            if (keep) {
+                result += line;
+                result += '\n';
+                if (in_repo) {
+                    result += fmt::format(FMT_COMPILE("Server = file://{}/{}/$repo\n"), bundle_dir, kReposDir);
+                }
+            }
+            continue;
+        }
+        if (!keep) {
+            continue;
+        }
+        // the mirrors of a bundled repo are the bundle
+        if (in_repo && (trimmed.starts_with("Server"sv) || trimmed.starts_with("Include"sv))) {
+            continue;
+        }
+        result += line;
+        result += '\n';
+    }
+    if (!trailing_newline && result.ends_with('\n')) {
+        result.pop_back();
+    }
+    return result;
+}
+
+}  // namespace gucc::bundle::detail
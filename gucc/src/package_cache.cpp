@@ -0,0 +1,86 @@
+#include "gucc/package_cache.hpp"
+#include "gucc/file_utils.hpp"
+#include "gucc/pacmanconf_repo.hpp"
+
+#include <array>       // for array
+#include <filesystem>  // for directory_iterator, remove_all, create_directories
+#include <vector>      // for vector
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include <spdlog/spdlog.h>
+
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+namespace gucc::pkgcache {
+
+auto target_cache_dir(std::string_view mountpoint) noexcept -> std::string {
+    return fmt::format(FMT_COMPILE("{}{}"), mountpoint, kHostCacheDir);
+}
+
+auto use_target_cache(std::string_view conf_path, std::string_view mountpoint) noexcept -> Result<std::string> {
+    auto target_dir = target_cache_dir(mountpoint);
+    std::error_code ec;
+    fs::create_directories(target_dir, ec);
+    if (ec) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to create '{}': {}"), target_dir, ec.message()));
+    }
+
+    const auto& conf = file_utils::read_whole_file(conf_path);
+    if (conf.empty()) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to read '{}'"), conf_path));
+    }
+    const std::array cache_dirs{target_dir, std::string{kHostCacheDir}};
+    if (!file_utils::create_file_for_overwrite(conf_path, detail::with_cache_dirs(conf, cache_dirs))) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to write '{}'"), conf_path));
+    }
+    spdlog::info("Packages are cached in '{}'", target_dir);
+    return target_dir;
+}
+
+auto prune(std::string_view cache_dir) noexcept -> Result<PruneResult> {
+    PruneResult result{};
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator{cache_dir, ec}) {
+        const auto& filename = entry.path().filename().string();
+        std::error_code entry_ec;
+        // leftovers of an interrupted pacman 7 download
+        if (filename.starts_with("download-"sv) && entry.is_directory(entry_ec)) {
+            fs::remove_all(entry.path(), entry_ec);
+            continue;
+        }
+        if (!entry.is_regular_file(entry_ec) || !detail::is_cache_file(filename)) {
+            continue;
+        }
+        const auto size = entry.file_size(entry_ec);
+        if (fs::remove(entry.path(), entry_ec)) {
+            ++result.files;
+            result.bytes += entry_ec ? 0 : size;
+        }
+    }
+    if (ec) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to list '{}': {}"), cache_dir, ec.message()));
+    }
+    spdlog::info("Pruned {} files ({:.1f}MiB) from '{}'", result.files, static_cast<double>(result.bytes) / (1024.0 * 1024.0), cache_dir);
+    return result;
+}
+
+}  // namespace gucc::pkgcache
+
+namespace gucc::pkgcache::detail {
+
+auto with_cache_dirs(std::string_view conf, std::span<const std::string> cache_dirs) noexcept -> std::string {
+    std::string lines{};
+    for (const auto& dir : cache_dirs) {
+        lines += fmt::format(FMT_COMPILE("CacheDir = {}\n"), dir);
+    }
+    return gucc::detail::pacmanconf::with_options_key(conf, "CacheDir"sv, lines);
+}
+
+auto is_cache_file(std::string_view filename) noexcept -> bool {
+    return filename.contains(".pkg.tar"sv) || filename.ends_with(".part"sv);
+}
+
+}  // namespace gucc::pkgcache::detail
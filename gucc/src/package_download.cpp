@@ -0,0 +1,492 @@
+#include "gucc/package_download.hpp"
+#include "gucc/file_utils.hpp"
+#include "gucc/mirrors.hpp"
+#include "gucc/sha256.hpp"
+#include "gucc/string_utils.hpp"
+
+#include <fcntl.h>   // for open, O_WRONLY, O_CREAT, O_CLOEXEC
+#include <unistd.h>  // for write, close, lseek, ftruncate
+
+#include <algorithm>           // for ranges::find, ranges::sort, min, max
+#include <atomic>              // for atomic
+#include <condition_variable>  // for condition_variable
+#include <deque>               // for deque
+#include <filesystem>          // for path, exists, file_size, rename, remove
+#include <mutex>               // for mutex, lock_guard, unique_lock
+#include <thread>              // for jthread, hardware_concurrency
+#include <utility>             // for move
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include <spdlog/spdlog.h>
+
+#include <cpr/cpr.h>
+
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+inline constexpr auto PART_SUFFIX     = ".part"sv;
+inline constexpr auto SIG_SUFFIX      = ".sig"sv;
+inline constexpr auto FILE_URL_PREFIX = "file://"sv;
+
+// a server failing that many transfers in a row is left alone
+inline constexpr std::size_t MAX_SERVER_FAILURES = 3;
+// bytes per second, below it for stall_timeout the transfer is dropped
+inline constexpr std::int32_t LOW_SPEED_LIMIT = 1024;
+
+using gucc::download::DownloadOptions;
+using gucc::download::PackageFile;
+
+template <typename T>
+class WorkQueue final {
+ public:
+    void push(T item) noexcept {
+        {
+            const std::lock_guard lock{m_mutex};
+            m_items.push_back(std::move(item));
+        }
+        m_cv.notify_one();
+    }
+
+    // blocks until there is an item, nullopt once closed
+    auto pop() noexcept -> std::optional<T> {
+        std::unique_lock lock{m_mutex};
+        m_cv.wait(lock, [this] { return m_closed || !m_items.empty(); });
+        if (m_items.empty()) {
+            return std::nullopt;
+        }
+        auto item = std::move(m_items.front());
+        m_items.pop_front();
+        return item;
+    }
+
+    void close() noexcept {
+        {
+            const std::lock_guard lock{m_mutex};
+            m_closed = true;
+        }
+        m_cv.notify_all();
+    }
+
+ private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<T> m_items;
+    bool m_closed{false};
+};
+
+// every server is counted once, the CachyOS repos share their mirrors
+class ServerPool final {
+ public:
+    explicit ServerPool(std::size_t per_server_limit) noexcept
+      : m_limit(std::max<std::size_t>(per_server_limit, 1)) { }
+
+    auto add(std::string_view server) noexcept -> std::size_t {
+        for (std::size_t i = 0; i < m_servers.size(); ++i) {
+            if (m_servers[i].server == server) {
+                return i;
+            }
+        }
+        m_servers.emplace_back(Server{.server = std::string{server}});
+        return m_servers.size() - 1;
+    }
+
+    auto server(std::size_t index) const noexcept -> const std::string& {
+        return m_servers[index].server;
+    }
+
+    // best ranked candidate with a free slot, waits while they are all busy.
+    // nullopt once every candidate was tried or keeps failing
+    auto acquire(std::span<const std::size_t> candidates, std::span<const std::size_t> tried) noexcept -> std::optional<std::size_t> {
+        std::unique_lock lock{m_mutex};
+        while (true) {
+            bool any_left{false};
+            for (const auto index : candidates) {
+                auto& entry = m_servers[index];
+                if (std::ranges::find(tried, index) != tried.end() || entry.failures >= MAX_SERVER_FAILURES) {
+                    continue;
+                }
+                any_left = true;
+                if (entry.active < m_limit) {
+                    ++entry.active;
+                    return index;
+                }
+            }
+            if (!any_left) {
+                return std::nullopt;
+            }
+            m_cv.wait(lock);
+        }
+    }
+
+    void release(std::size_t index, bool succeeded) noexcept {
+        {
+            const std::lock_guard lock{m_mutex};
+            auto& entry = m_servers[index];
+            --entry.active;
+            entry.failures = succeeded ? 0 : entry.failures + 1;
+        }
+        m_cv.notify_all();
+    }
+
+ private:
+    struct Server final {
+        std::string server;
+        std::size_t active{};
+        std::size_t failures{};
+    };
+
+    std::size_t m_limit;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<Server> m_servers;
+};
+
+auto part_path_of(const fs::path& target) noexcept -> fs::path {
+    auto part_path = target;
+    part_path += PART_SUFFIX;
+    return part_path;
+}
+
+struct Job final {
+    const PackageFile* package{};
+    bool signature{false};
+    // servers this file was already fetched from
+    std::vector<std::size_t> tried{};
+
+    auto filename() const noexcept -> std::string {
+        return signature ? fmt::format(FMT_COMPILE("{}{}"), package->filename, SIG_SUFFIX) : package->filename;
+    }
+};
+
+struct TransferOutcome final {
+    bool ok{false};
+    bool resumed{false};
+    std::uint64_t bytes{};
+};
+
+// streams @p url into @p part_path, continuing what is already there
+auto transfer(cpr::Session& session, const std::string& url, const fs::path& part_path, const DownloadOptions& options) noexcept -> TransferOutcome {
+    const bool is_file_url = url.starts_with(FILE_URL_PREFIX);
+
+    std::error_code ec;
+    const auto offset = fs::exists(part_path, ec) ? fs::file_size(part_path, ec) : std::uint64_t{0};
+
+    const int fd = ::open(part_path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        spdlog::error("Failed to open '{}'", part_path.string());
+        return {};
+    }
+
+    std::int32_t status{};
+    bool positioned{false};
+    bool write_failed{false};
+    TransferOutcome outcome{};
+    const auto is_wanted_status = [&] {
+        return cpr::status::is_success(status) || (is_file_url && status == 0);
+    };
+    // a server ignoring the range starts over with 200
+    const auto position = [&] {
+        positioned = true;
+        if (status == 206 && offset != 0) {
+            outcome.resumed = true;
+            return ::lseek(fd, static_cast<off_t>(offset), SEEK_SET) >= 0;
+        }
+        return ::ftruncate(fd, 0) == 0 && ::lseek(fd, 0, SEEK_SET) == 0;
+    };
+
+    session.SetUrl(cpr::Url{url});
+    session.SetConnectTimeout(cpr::ConnectTimeout{options.connect_timeout});
+    session.SetLowSpeed(cpr::LowSpeed{LOW_SPEED_LIMIT, options.stall_timeout});
+    session.SetHeader((offset != 0 && !is_file_url) ? cpr::Header{{"Range", fmt::format(FMT_COMPILE("bytes={}-"), offset)}} : cpr::Header{});
+    session.SetHeaderCallback(cpr::HeaderCallback{[&](const std::string_view& header, intptr_t) {
+        // one status line per response, redirects included
+        if (const auto parsed = gucc::download::detail::parse_status_line(header)) {
+            status = *parsed;
+        }
+        return true;
+    }});
+    session.SetWriteCallback(cpr::WriteCallback{[&](const std::string_view& data, intptr_t) {
+        if (!is_wanted_status()) {
+            return false;
+        }
+        if (!positioned && !position()) {
+            write_failed = true;
+            return false;
+        }
+        for (auto rest = data; !rest.empty();) {
+            const auto written = ::write(fd, rest.data(), rest.size());
+            if (written <= 0) {
+                write_failed = true;
+                return false;
+            }
+            rest.remove_prefix(static_cast<std::size_t>(written));
+        }
+        outcome.bytes += data.size();
+        return true;
+    }});
+
+    const auto& response = session.Get();
+    if (!positioned && is_wanted_status() && !position()) {
+        write_failed = true;
+    }
+    ::close(fd);
+
+    // 416: the .part was already complete, the checksum tells
+    const bool range_done = (status == 416 && offset != 0);
+    outcome.ok            = !write_failed && response.error.code == cpr::ErrorCode::OK && (is_wanted_status() || range_done);
+    return outcome;
+}
+
+}  // namespace
+
+namespace gucc::download {
+
+auto repo_servers(std::string_view conf_path) noexcept -> RepoServers {
+    RepoServers servers{};
+    std::string repo{};
+    for (auto&& line : utils::make_split_view(file_utils::read_whole_file(conf_path))) {
+        const auto& trimmed = utils::trim(line);
+        if (trimmed.empty() || trimmed.starts_with('#')) {
+            continue;
+        }
+        if (trimmed.starts_with('[') && trimmed.ends_with(']')) {
+            repo = std::string{trimmed.substr(1, trimmed.size() - 2)};
+            if (repo == "options"sv) {
+                repo.clear();
+            }
+            continue;
+        }
+        const auto eq_pos = trimmed.find('=');
+        if (repo.empty() || eq_pos == std::string_view::npos) {
+            continue;
+        }
+        const auto& key   = utils::trim(trimmed.substr(0, eq_pos));
+        const auto& value = utils::trim(trimmed.substr(eq_pos + 1));
+        if (key == "Server"sv) {
+            servers[repo].emplace_back(value);
+        } else if (key == "Include"sv) {
+            const std::string include_path{value};
+            std::error_code ec;
+            if (!fs::exists(include_path, ec)) {
+                spdlog::warn("'{}' included by [{}] doesn't exist", include_path, repo);
+                continue;
+            }
+            auto& repo_list = servers[repo];
+            for (auto&& server : mirrors::parse_mirrorlist(file_utils::read_whole_file(include_path))) {
+                repo_list.emplace_back(std::move(server));
+            }
+        }
+    }
+    return servers;
+}
+
+auto download_packages(std::span<const PackageFile> packages, const RepoServers& servers, const DownloadOptions& options) noexcept -> Result<DownloadResult> {
+    std::error_code ec;
+    fs::create_directories(options.cache_dir, ec);
+    if (ec) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to create '{}': {}"), options.cache_dir, ec.message()));
+    }
+    const fs::path cache_dir{options.cache_dir};
+
+    ServerPool pool{options.connections_per_mirror};
+    std::map<std::string_view, std::vector<std::size_t>, std::less<>> candidates{};
+    for (const auto& [repo, repo_list] : servers) {
+        auto& indices = candidates[repo];
+        for (const auto& server : repo_list) {
+            indices.push_back(pool.add(server));
+        }
+    }
+
+    DownloadResult result{};
+    std::mutex result_mutex;
+    std::atomic<std::size_t> cached{0};
+    std::atomic<std::size_t> downloaded{0};
+    std::atomic<std::size_t> resumed{0};
+    std::atomic<std::uint64_t> bytes{0};
+
+    // the long transfers go first, they would make the tail otherwise
+    std::vector<const PackageFile*> ordered{};
+    for (const auto& package : packages) {
+        if (package.filename.empty() || package.filename.contains('/')) {
+            spdlog::error("Refusing to download '{}' into the cache", package.filename);
+            result.failed.emplace_back(package.filename);
+            continue;
+        }
+        ordered.push_back(&package);
+    }
+    std::ranges::stable_sort(ordered, std::ranges::greater{}, &PackageFile::size);
+
+    WorkQueue<Job> download_queue{};
+    WorkQueue<Job> verify_queue{};
+    // jobs not yet committed or failed, the queues close when it drops to zero
+    std::atomic<std::size_t> outstanding{0};
+    const auto finish_job = [&] {
+        if (--outstanding == 0) {
+            download_queue.close();
+            verify_queue.close();
+        }
+    };
+    const auto fail_job = [&](const Job& job) {
+        spdlog::error("No mirror delivered '{}'", job.filename());
+        {
+            const std::lock_guard lock{result_mutex};
+            result.failed.emplace_back(job.filename());
+        }
+        finish_job();
+    };
+    const auto commit_job = [&](const Job& job) {
+        const auto& target = cache_dir / job.filename();
+        std::error_code rename_ec;
+        fs::rename(part_path_of(target), target, rename_ec);
+        if (rename_ec) {
+            spdlog::error("Failed to move '{}' into place: {}", target.string(), rename_ec.message());
+            fail_job(job);
+            return;
+        }
+        ++downloaded;
+        finish_job();
+    };
+
+    std::vector<Job> jobs{};
+    for (const auto* package : ordered) {
+        jobs.emplace_back(Job{.package = package});
+        if (options.signatures) {
+            jobs.emplace_back(Job{.package = package, .signature = true});
+        }
+    }
+    if (jobs.empty()) {
+        return result;
+    }
+    outstanding = jobs.size();
+
+    // existing packages are checked by the verify workers, signatures have nothing to check
+    for (auto& job : jobs) {
+        if (!job.signature) {
+            verify_queue.push(std::move(job));
+        } else if (fs::exists(cache_dir / job.filename(), ec)) {
+            ++cached;
+            finish_job();
+        } else {
+            download_queue.push(std::move(job));
+        }
+    }
+
+    const auto download_worker = [&] {
+        cpr::Session session{};
+        while (auto job = download_queue.pop()) {
+            const auto repo_it = candidates.find(job->package->repo);
+            if (repo_it == candidates.end()) {
+                fail_job(*job);
+                continue;
+            }
+            const auto server = pool.acquire(repo_it->second, job->tried);
+            if (!server) {
+                fail_job(*job);
+                continue;
+            }
+            job->tried.push_back(*server);
+
+            const auto& filename = job->filename();
+            const auto& url      = fmt::format(FMT_COMPILE("{}/{}"), mirrors::server_url(pool.server(*server), job->package->repo, options.arch), filename);
+            const auto& outcome  = transfer(session, url, part_path_of(cache_dir / filename), options);
+            pool.release(*server, outcome.ok);
+            bytes += outcome.bytes;
+            if (!outcome.ok) {
+                spdlog::debug("Fetching '{}' failed, trying the next mirror", url);
+                download_queue.push(std::move(*job));
+                continue;
+            }
+            if (outcome.resumed) {
+                ++resumed;
+            }
+
+            if (job->signature || job->package->sha256sum.empty()) {
+                commit_job(*job);
+            } else {
+                verify_queue.push(std::move(*job));
+            }
+        }
+    };
+
+    const auto verify_worker = [&] {
+        while (auto job = verify_queue.pop()) {
+            const auto& target = cache_dir / job->package->filename;
+            // not fetched yet, it might be there from an earlier install
+            if (job->tried.empty()) {
+                if (detail::matches_package(*job->package, target.string())) {
+                    ++cached;
+                    finish_job();
+                } else {
+                    download_queue.push(std::move(*job));
+                }
+                continue;
+            }
+
+            const auto& part_path = part_path_of(target);
+            if (detail::matches_package(*job->package, part_path.string())) {
+                commit_job(*job);
+                continue;
+            }
+            spdlog::warn("Checksum mismatch for '{}', fetching it again", job->package->filename);
+            std::error_code remove_ec;
+            fs::remove(part_path, remove_ec);
+            download_queue.push(std::move(*job));
+        }
+    };
+
+    const auto download_workers = std::min(std::max<std::size_t>(options.max_connections, 1), jobs.size());
+    const auto verify_workers   = (options.verify_workers != 0) ? options.verify_workers : std::max(std::thread::hardware_concurrency(), 1U);
+    {
+        std::vector<std::jthread> workers{};
+        for (std::size_t i = 0; i < download_workers; ++i) {
+            workers.emplace_back(download_worker);
+        }
+        for (std::size_t i = 0; i < verify_workers; ++i) {
+            workers.emplace_back(verify_worker);
+        }
+    }
+
+    result.cached     = cached;
+    result.downloaded = downloaded;
+    result.resumed    = resumed;
+    result.bytes      = bytes;
+    spdlog::info("Package cache: {} downloaded ({} resumed, {} MiB), {} cached, {} failed",
+        result.downloaded, result.resumed, result.bytes / (1024 * 1024), result.cached, result.failed.size());
+    return result;
+}
+
+}  // namespace gucc::download
+
+namespace gucc::download::detail {
+
+auto parse_status_line(std::string_view line) noexcept -> std::optional<std::int32_t> {
+    if (!line.starts_with("HTTP/"sv)) {
+        return std::nullopt;
+    }
+    const auto space_pos = line.find(' ');
+    if (space_pos == std::string_view::npos || line.size() < space_pos + 4) {
+        return std::nullopt;
+    }
+    const auto code = utils::parse_uint<std::uint32_t>(line.substr(space_pos + 1, 3));
+    if (!code) {
+        return std::nullopt;
+    }
+    return static_cast<std::int32_t>(*code);
+}
+
+auto matches_package(const PackageFile& package, std::string_view file_path) noexcept -> bool {
+    std::error_code ec;
+    if (!fs::exists(file_path, ec)) {
+        return false;
+    }
+    if (package.size != 0 && fs::file_size(file_path, ec) != package.size) {
+        return false;
+    }
+    return package.sha256sum.empty() || hash::sha256_file(file_path) == package.sha256sum;
+}
+
+}  // namespace gucc::download::detail
@@ -1,15 +1,18 @@
 #include "gucc/package_list.hpp"
 #include "gucc/cpu.hpp"
 #include "gucc/fetch_file.hpp"
+#include "gucc/file_utils.hpp"
 #include "gucc/fs_utils.hpp"
-#include "gucc/package_profiles.hpp"
 #include "gucc/string_utils.hpp"
 
-#include <algorithm>  // for find, search
-#include <array>      // for array
-#include <ranges>     // for ranges::*
-#include <string>     // for string
-#include <vector>     // for erase_if
+#include <algorithm>   // for search
+#include <array>       // for array
+#include <filesystem>  // for exists, create_directories
+#include <memory>      // for shared_ptr, make_shared
+#include <ranges>      // for ranges::*
+#include <string>      // for string
+#include <utility>     // for move
+#include <vector>      // for erase_if
 
 #include <fmt/compile.h>
 #include <fmt/format.h>
@@ -45,28 +48,70 @@ static constexpr std::array kDesktopMatches{
     DesktopMatch{.keyword = "budgie"sv, .needs_xorg = true},
 };
 
-constinit std::optional<std::string> cached_content;  // NOLINT
-constinit std::string cached_url;                     // NOLINT
-constinit std::string cached_fallback_url;            // NOLINT
-constinit std::string cached_user_path;               // NOLINT
+constinit std::shared_ptr<const gucc::profile::ProfileIndex> cached_index;  // NOLINT
+constinit std::string cached_url;                                           // NOLINT
+constinit std::string cached_fallback_url;                                  // NOLINT
+constinit std::string cached_user_path;                                     // NOLINT
 
-// build the merged net-profiles doc from two layers:
+auto snapshot_path_of(const gucc::package::NetProfileInfo& info, std::string_view revision) noexcept -> std::string {
+    return fmt::format(FMT_COMPILE("{}/profile-index-{}.bin"), info.index_snapshot_dir, revision.substr(0, 32));
+}
+
+// compiled once per revision of the layers, a warm start skips the TOML entirely
+auto compile_net_profiles(const gucc::package::NetProfileInfo& info, const std::vector<std::string_view>& layers) noexcept -> std::optional<gucc::profile::ProfileIndex> {
+    auto revision = gucc::profile::layers_revision(layers);
+    if (!info.index_snapshot_dir.empty()) {
+        const auto& snapshot_path = snapshot_path_of(info, revision);
+        if (std::error_code ec; std::filesystem::exists(snapshot_path, ec)) {
+            auto index = gucc::profile::ProfileIndex::deserialize(gucc::file_utils::read_whole_file(snapshot_path), revision);
+            if (index) {
+                spdlog::debug("net profiles: using compiled index '{}'", snapshot_path);
+                return std::make_optional(std::move(*index));
+            }
+            spdlog::debug("net profiles: ignoring snapshot '{}': {}", snapshot_path, gucc::to_string(index.error()));
+        }
+    }
+
+    auto merged = gucc::profile::load_layered_net_profiles(layers);
+    if (!merged) {
+        spdlog::error("net profiles: failed to merge layered net profiles");
+        return std::nullopt;
+    }
+    auto index = gucc::profile::ProfileIndex::build(*merged, std::move(revision));
+    if (!index) {
+        spdlog::error("net profiles: {}", gucc::to_string(index.error()));
+        return std::nullopt;
+    }
+
+    // a failure here only costs a parse next time
+    if (!info.index_snapshot_dir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(info.index_snapshot_dir, ec);
+        if (ec || !gucc::file_utils::create_file_for_overwrite(snapshot_path_of(info, index->revision()), index->serialize())) {
+            spdlog::debug("net profiles: failed to store compiled index in '{}'", info.index_snapshot_dir);
+        }
+    }
+    return std::make_optional(std::move(*index));
+}
+
+// build the net-profiles index from two layers:
 //  - base: the regular installer net-profiles.toml
 //  - user: an optional user-supplied one on top
-auto fetch_net_profiles_cached(const gucc::package::NetProfileInfo& info) noexcept -> std::optional<std::string> {
-    if (cached_content
+auto fetch_net_profiles_cached(const gucc::package::NetProfileInfo& info) noexcept -> std::shared_ptr<const gucc::profile::ProfileIndex> {
+    if (cached_index
         && cached_url == info.net_profs_url
         && cached_fallback_url == info.net_profs_fallback_url
         && cached_user_path == info.net_profs_user_path) {
-        spdlog::debug("net profiles: using cached content");
-        return cached_content;
+        spdlog::debug("net profiles: using cached index");
+        return cached_index;
     }
 
-    auto base_content = gucc::fetch::fetch_file_from_url(info.net_profs_url, info.net_profs_fallback_url);
+    auto base_content = gucc::fetch::fetch_file_hedged(info.net_profs_url, info.net_profs_fallback_url, info.fetch_options);
     if (!base_content) {
         spdlog::error("net profiles: failed to load base layer (url '{}', fallback '{}')", info.net_profs_url, info.net_profs_fallback_url);
-        return std::nullopt;
+        return nullptr;
     }
+    spdlog::info("net profiles: base layer from '{}' ({}, {}s old)", base_content->url, gucc::fetch::fetch_source_to_string(base_content->source), base_content->age.count());
 
     // user profile
     std::optional<std::string> user_content;
@@ -77,42 +122,40 @@ auto fetch_net_profiles_cached(const gucc::package::NetProfileInfo& info) noexce
         }
     }
 
-    std::vector<std::string_view> layers{*base_content};
+    std::vector<std::string_view> layers{base_content->content};
     if (user_content) {
         layers.emplace_back(*user_content);
     }
 
-    auto merged = gucc::profile::load_layered_net_profiles(layers);
-    if (!merged) {
-        spdlog::error("net profiles: failed to merge layered net profiles");
-        return std::nullopt;
+    auto index = compile_net_profiles(info, layers);
+    if (!index) {
+        return nullptr;
     }
 
     cached_url          = info.net_profs_url;
     cached_fallback_url = info.net_profs_fallback_url;
     cached_user_path    = info.net_profs_user_path;
-    cached_content      = std::move(merged);
-    return cached_content;
+    cached_index        = std::make_shared<const gucc::profile::ProfileIndex>(std::move(*index));
+    return cached_index;
 }
 
-auto load_net_profs_content(const gucc::package::NetProfileInfo& info) noexcept -> std::optional<std::string> {
+}  // namespace
+
+namespace gucc::package {
+
+auto get_profile_index(NetProfileInfo net_profile_info) noexcept -> std::shared_ptr<const profile::ProfileIndex> {
     // must have at least single valid net profile url
-    if (info.net_profs_url.empty() && info.net_profs_fallback_url.empty()) {
+    if (net_profile_info.net_profs_url.empty() && net_profile_info.net_profs_fallback_url.empty()) {
         spdlog::error("Invalid netprofiles info: cannot be empty");
-        return std::nullopt;
+        return nullptr;
     }
-    auto content = fetch_net_profiles_cached(info);
-    if (!content) {
-        spdlog::error("Failed to get net profiles content");
-        return std::nullopt;
+    auto index = fetch_net_profiles_cached(net_profile_info);
+    if (!index) {
+        spdlog::error("Failed to get net profiles");
     }
-    return content;
+    return index;
 }
 
-}  // namespace
-
-namespace gucc::package {
-
 auto get_pkglist_base(std::string_view packages, std::string_view root_filesystem, bool server_mode, NetProfileInfo net_profile_info) noexcept -> std::optional<std::vector<std::string>> {
     const auto& is_root_on_zfs      = (root_filesystem == "zfs"sv);
     const auto& is_root_on_btrfs    = (root_filesystem == "btrfs"sv);
@@ -136,27 +179,23 @@ auto get_pkglist_base(std::string_view packages, std::string_view root_filesyste
         pkg_list.insert(pkg_list.cend(), {"bcachefs-tools"});
     }
 
-    auto net_profs_content = load_net_profs_content(net_profile_info);
-    if (!net_profs_content) {
-        return std::nullopt;
-    }
-    auto base_net_profs = profile::parse_base_profiles(*net_profs_content);
-    if (!base_net_profs.has_value()) {
-        spdlog::error("Failed to parse net profiles");
+    const auto index = get_profile_index(std::move(net_profile_info));
+    if (!index) {
         return std::nullopt;
     }
+    const auto& base_net_profs = index->base();
 
     if (server_mode == 0) {
         if (is_root_on_btrfs) {
             pkg_list.insert(pkg_list.cend(), {"snapper", "btrfs-assistant-git"});
         }
         pkg_list.insert(pkg_list.cend(),
-            base_net_profs->base_desktop_packages.begin(),
-            base_net_profs->base_desktop_packages.end());
+            base_net_profs.base_desktop_packages.begin(),
+            base_net_profs.base_desktop_packages.end());
     }
     pkg_list.insert(pkg_list.cend(),
-        base_net_profs->base_packages.begin(),
-        base_net_profs->base_packages.end());
+        base_net_profs.base_packages.begin(),
+        base_net_profs.base_packages.end());
 
     // Dynamically add CPU-specific microcode package
     const auto cpu_vendor = cpu::get_cpu_vendor();
@@ -170,21 +209,16 @@ auto get_pkglist_base(std::string_view packages, std::string_view root_filesyste
 }
 
 auto get_pkglist_desktop(std::string_view desktop_env, NetProfileInfo net_profile_info) noexcept -> std::optional<std::vector<std::string>> {
-    auto net_profs_content = load_net_profs_content(net_profile_info);
-    if (!net_profs_content) {
-        return std::nullopt;
-    }
-    auto desktop_net_profs = profile::parse_desktop_profiles(*net_profs_content);
-    if (!desktop_net_profs.has_value()) {
-        spdlog::error("Failed to parse net profiles");
+    const auto index = get_profile_index(std::move(net_profile_info));
+    if (!index) {
         return std::nullopt;
     }
 
     std::vector<std::string> pkg_list{};
 
     const auto append_profile_packages = [&](std::string_view name) noexcept {
-        auto profile = std::ranges::find(*desktop_net_profs, name, &profile::DesktopProfile::profile_name);
-        if (profile == desktop_net_profs->end()) {
+        const auto* profile = index->find_desktop(name);
+        if (profile == nullptr) {
             spdlog::warn("net profiles: desktop.{} profile not found. skipping..", name);
             return;
         }
@@ -208,26 +242,22 @@ auto get_pkglist_desktop(std::string_view desktop_env, NetProfileInfo net_profil
 }
 
 auto get_netinstall_groups(NetProfileInfo net_profile_info) noexcept -> std::optional<std::vector<profile::NetinstallGroup>> {
-    auto net_profs_content = load_net_profs_content(net_profile_info);
-    if (!net_profs_content) {
+    const auto index = get_profile_index(std::move(net_profile_info));
+    if (!index) {
         return std::nullopt;
     }
-    return profile::parse_netinstall_groups(*net_profs_content);
+    const auto& groups = index->groups();
+    return std::make_optional<std::vector<profile::NetinstallGroup>>(groups.begin(), groups.end());
 }
 
 auto get_servicelist_base(bool server_mode, NetProfileInfo net_profile_info) noexcept -> std::optional<std::vector<profile::ServiceEntry>> {
-    auto net_profs_content = load_net_profs_content(net_profile_info);
-    if (!net_profs_content) {
-        return std::nullopt;
-    }
-    auto base_profs = profile::parse_base_profiles(*net_profs_content);
-    if (!base_profs) {
-        spdlog::error("Failed to parse net profiles");
+    const auto index = get_profile_index(std::move(net_profile_info));
+    if (!index) {
         return std::nullopt;
     }
 
     // Skip sshd for desktop mode
-    auto services = std::move(base_profs->base_services);
+    auto services = index->base().base_services;
     if (!server_mode) {
         std::erase_if(services, [](const profile::ServiceEntry& entry) {
             return entry.name == "sshd";
@@ -237,17 +267,11 @@ auto get_servicelist_base(bool server_mode, NetProfileInfo net_profile_info) noe
 }
 
 auto get_servicelist_desktop(NetProfileInfo net_profile_info) noexcept -> std::optional<std::vector<profile::ServiceEntry>> {
-    auto net_profs_content = load_net_profs_content(net_profile_info);
-    if (!net_profs_content) {
+    const auto index = get_profile_index(std::move(net_profile_info));
+    if (!index) {
         return std::nullopt;
     }
-    auto base_profs = profile::parse_base_profiles(*net_profs_content);
-    if (!base_profs) {
-        spdlog::error("Failed to parse net profiles");
-        return std::nullopt;
-    }
-
-    return std::make_optional(std::move(base_profs->base_desktop_services));
+    return std::make_optional(index->base().base_desktop_services);
 }
 
 }  // namespace gucc::package
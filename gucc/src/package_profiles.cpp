@@ -1,8 +1,8 @@
 #include "gucc/package_profiles.hpp"
 
-#include <algorithm>  // for contains
-#include <ranges>     // for ranges::*
-#include <sstream>    // for ostringstream
+#include <sstream>        // for ostringstream
+#include <unordered_map>  // for unordered_map
+#include <unordered_set>  // for unordered_set
 
 #include <spdlog/spdlog.h>
 
@@ -21,8 +21,22 @@ toml::array merge_array_of_tables(const toml::array& lower, const toml::array& h
         return tbl[GROUP_ID_KEY].value_or(""sv);
     };
 
+    // first entry of hi per id, so every lo entry finds its replacement in one lookup
+    std::unordered_map<std::string_view, const toml::table*> higher_by_id{};
+    higher_by_id.reserve(higher.size());
+    for (const auto& higher_el : higher) {
+        const auto* higher_tbl = higher_el.as_table();
+        if (higher_tbl == nullptr) {
+            continue;
+        }
+        if (const auto id = id_of(*higher_tbl); !id.empty()) {
+            higher_by_id.try_emplace(id, higher_tbl);
+        }
+    }
+
     toml::array merged;
-    std::vector<std::string_view> seen_ids{};
+    std::unordered_set<std::string_view> seen_ids{};
+    seen_ids.reserve(lower.size());
 
     for (const auto& node_el : lower) {
         const auto* lower_tbl = node_el.as_table();
@@ -31,19 +45,13 @@ toml::array merge_array_of_tables(const toml::array& lower, const toml::array& h
             continue;
         }
         const auto id = id_of(*lower_tbl);
-        // search for the same id in the hi
-        const toml::table* replacement = nullptr;
-        for (const auto& higher_el : higher) {
-            const auto* higher_tbl = higher_el.as_table();
-            if (higher_tbl != nullptr && !id.empty() && id_of(*higher_tbl) == id) {
-                replacement = higher_tbl;
-                break;
-            }
-        }
-        merged.push_back(replacement != nullptr ? *replacement : *lower_tbl);
-        if (!id.empty()) {
-            seen_ids.push_back(id);
+        if (id.empty()) {
+            merged.push_back(*lower_tbl);
+            continue;
         }
+        const auto replacement = higher_by_id.find(id);
+        merged.push_back(replacement != higher_by_id.end() ? *replacement->second : *lower_tbl);
+        seen_ids.insert(id);
     }
 
     // append from hi if id wasn't already present in lo
@@ -54,7 +62,7 @@ toml::array merge_array_of_tables(const toml::array& lower, const toml::array& h
             continue;
         }
         const auto id = id_of(*higher_tbl);
-        if (id.empty() || !std::ranges::contains(seen_ids, id)) {
+        if (id.empty() || !seen_ids.contains(id)) {
             merged.push_back(*higher_tbl);
         }
     }
@@ -135,6 +143,18 @@ gucc::profile::NetinstallGroup parse_netinstall_group(const toml::table& tbl) no
     return group;
 }
 
+void parse_netinstall_array(const toml::array* group_arr, std::vector<gucc::profile::NetinstallGroup>& out) noexcept {
+    // simply no optional groups offered.
+    if (group_arr == nullptr) {
+        return;
+    }
+    for (const auto& node_el : *group_arr) {
+        if (const auto* tbl = node_el.as_table(); tbl != nullptr) {
+            out.emplace_back(parse_netinstall_group(*tbl));
+        }
+    }
+}
+
 inline void parse_toml_service_array(const toml::array* arr, std::vector<gucc::profile::ServiceEntry>& vec) noexcept {
     if (arr == nullptr) {
         return;
@@ -214,6 +234,9 @@ auto parse_net_profiles(std::string_view config_content) noexcept -> std::option
 
     // parse desktop
     parse_desktop_table(netprof_table["desktop"].as_table(), net_profiles.desktop_profiles);
+
+    // parse netinstall groups
+    parse_netinstall_array(netprof_table["netinstall"]["group"].as_array(), net_profiles.netinstall_groups);
     return std::make_optional<NetProfiles>(std::move(net_profiles));
 }
 
@@ -226,17 +249,7 @@ auto parse_netinstall_groups(std::string_view config_content) noexcept -> std::o
     const auto& netprof_table = std::move(netprof).table();
 
     std::vector<NetinstallGroup> groups{};
-
-    // simply no optional groups offered.
-    const auto* group_arr = netprof_table["netinstall"]["group"].as_array();
-    if (group_arr == nullptr) {
-        return std::make_optional<std::vector<NetinstallGroup>>(std::move(groups));
-    }
-    for (const auto& node_el : *group_arr) {
-        if (const auto* tbl = node_el.as_table(); tbl != nullptr) {
-            groups.emplace_back(parse_netinstall_group(*tbl));
-        }
-    }
+    parse_netinstall_array(netprof_table["netinstall"]["group"].as_array(), groups);
     return std::make_optional<std::vector<NetinstallGroup>>(std::move(groups));
 }
 
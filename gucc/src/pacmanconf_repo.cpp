@@ -7,8 +7,25 @@
 #include <string>   // for string
 #include <vector>   // for vector
 
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
 #include <spdlog/spdlog.h>
 
+using namespace std::string_view_literals;
+
+namespace {
+
+auto is_key_line(std::string_view line, std::string_view key) noexcept -> bool {
+    auto trimmed = gucc::utils::trim(line);
+    if (trimmed.starts_with('#')) {
+        trimmed = gucc::utils::ltrim(trimmed.substr(1));
+    }
+    return trimmed.starts_with(key);
+}
+
+}  // namespace
+
 namespace gucc::detail::pacmanconf {
 
 bool push_repos_front(std::string_view file_path, std::string_view value) noexcept {
@@ -61,4 +78,47 @@ auto get_repo_list(std::string_view file_path) noexcept -> std::vector<std::stri
         | std::ranges::to<std::vector<std::string>>();
 }
 
+auto with_options_key(std::string_view conf, std::string_view key, std::string_view lines) noexcept -> std::string {
+    std::string result{};
+    bool in_options{false};
+    bool replaced{false};
+    std::size_t options_end{std::string::npos};
+    for (auto&& line_rng : conf | std::views::split('\n')) {
+        const std::string_view line{line_rng.begin(), line_rng.end()};
+        const auto& trimmed = utils::trim(line);
+        if (trimmed.starts_with('[')) {
+            in_options = (trimmed == "[options]"sv);
+            if (in_options) {
+                result += line;
+                result += '\n';
+                options_end = result.size();
+                continue;
+            }
+        }
+        if (in_options && is_key_line(line, key)) {
+            // the first one turns into ours, the others go
+            if (!replaced) {
+                result += lines;
+                replaced = true;
+            }
+            continue;
+        }
+        result += line;
+        result += '\n';
+    }
+    // every line got a newline, the last one didn't have it
+    if (!result.empty()) {
+        result.pop_back();
+    }
+
+    if (!replaced) {
+        if (options_end == std::string::npos) {
+            result += fmt::format(FMT_COMPILE("\n[options]\n{}"), lines);
+        } else {
+            result.insert(options_end, lines);
+        }
+    }
+    return result;
+}
+
 }  // namespace gucc::detail::pacmanconf
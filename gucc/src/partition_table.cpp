@@ -0,0 +1,619 @@
+#include "gucc/partition_table.hpp"
+#include "gucc/disk_topology.hpp"
+#include "gucc/partition_config.hpp"
+#include "gucc/partitioning.hpp"
+#include "gucc/process.hpp"
+#include "gucc/string_utils.hpp"
+#include "gucc/system_query.hpp"
+
+#include <cerrno>   // for errno
+#include <cstring>  // for strerror
+
+#include <fcntl.h>         // for open, O_RDWR
+#include <linux/blkpg.h>   // for blkpg_ioctl_arg, blkpg_partition
+#include <linux/fs.h>      // for BLKGETSIZE64, BLKSSZGET, BLKPG
+#include <sys/ioctl.h>     // for ioctl
+#include <unistd.h>        // for pwrite, fsync, close
+
+#include <algorithm>   // for copy, fill
+#include <chrono>      // for steady_clock, milliseconds
+#include <filesystem>  // for exists, directory_iterator
+#include <fstream>     // for ifstream
+#include <random>      // for random_device, mt19937_64
+#include <ranges>      // for ranges::*
+#include <thread>      // for sleep_for
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include <spdlog/spdlog.h>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+using gucc::ErrorCode;
+using gucc::make_error;
+using gucc::disk::Guid;
+using gucc::disk::PartitionTableLayout;
+using gucc::disk::PartitionTableType;
+
+// UEFI spec defaults, same as what sfdisk writes
+inline constexpr std::uint32_t GPT_ENTRY_COUNT      = 128;
+inline constexpr std::uint32_t GPT_ENTRY_SIZE       = 128;
+inline constexpr std::uint32_t GPT_HEADER_SIZE      = 92;
+inline constexpr std::uint32_t GPT_REVISION         = 0x00010000;
+inline constexpr std::uint64_t GPT_ATTR_LEGACY_BOOT = 1ULL << 2;
+
+inline constexpr auto GPT_TYPE_EFI   = "C12A7328-F81F-11D2-BA4B-00A0C93EC93B"sv;
+inline constexpr auto GPT_TYPE_SWAP  = "0657FD6D-A4AB-43C4-84E5-0933C84B4F4F"sv;
+inline constexpr auto GPT_TYPE_LINUX = "0FC63DAF-8483-4772-8E79-3D69D8477DE4"sv;
+
+inline constexpr std::uint8_t MBR_TYPE_EFI        = 0xEF;
+inline constexpr std::uint8_t MBR_TYPE_SWAP       = 0x82;
+inline constexpr std::uint8_t MBR_TYPE_LINUX      = 0x83;
+inline constexpr std::uint8_t MBR_TYPE_PROTECTIVE = 0xEE;
+inline constexpr std::size_t MBR_MAX_PARTITIONS   = 4;
+
+// how long we are willing to wait for devtmpfs to create the nodes
+inline constexpr auto NODE_WAIT_TIMEOUT  = std::chrono::seconds{10};
+inline constexpr auto NODE_POLL_INTERVAL = std::chrono::milliseconds{5};
+
+constexpr auto gpt_entries_sectors(std::uint32_t sector_size) noexcept -> std::uint64_t {
+    return ((GPT_ENTRY_COUNT * GPT_ENTRY_SIZE) + sector_size - 1) / sector_size;
+}
+
+constexpr auto align_up(std::uint64_t value, std::uint64_t grain) noexcept -> std::uint64_t {
+    return ((value + grain - 1) / grain) * grain;
+}
+
+constexpr auto align_down(std::uint64_t value, std::uint64_t grain) noexcept -> std::uint64_t {
+    return (value / grain) * grain;
+}
+
+template <class T>
+constexpr void put_le(std::span<std::uint8_t> buf, std::size_t offset, T value) noexcept {
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+        buf[offset + i] = static_cast<std::uint8_t>((static_cast<std::uint64_t>(value) >> (i * 8)) & 0xFF);
+    }
+}
+
+constexpr void put_guid(std::span<std::uint8_t> buf, std::size_t offset, const Guid& guid) noexcept {
+    std::ranges::copy(guid, buf.begin() + static_cast<std::ptrdiff_t>(offset));
+}
+
+// classic 255 heads, 63 sectors per track translation. beyond 8GiB it saturates
+constexpr void put_chs(std::span<std::uint8_t> buf, std::size_t offset, std::uint64_t lba) noexcept {
+    constexpr std::uint64_t heads   = 255;
+    constexpr std::uint64_t sectors = 63;
+
+    const auto cylinder = lba / (heads * sectors);
+    if (cylinder > 1023) {
+        buf[offset]     = 0xFE;
+        buf[offset + 1] = 0xFF;
+        buf[offset + 2] = 0xFF;
+        return;
+    }
+    const auto head   = (lba / sectors) % heads;
+    const auto sector = (lba % sectors) + 1;
+    buf[offset]       = static_cast<std::uint8_t>(head);
+    buf[offset + 1]   = static_cast<std::uint8_t>(sector | ((cylinder >> 2) & 0xC0));
+    buf[offset + 2]   = static_cast<std::uint8_t>(cylinder & 0xFF);
+}
+
+auto make_random_guid(std::mt19937_64& rng) noexcept -> Guid {
+    Guid guid{};
+    const auto hi = rng();
+    const auto lo = rng();
+    for (std::size_t i = 0; i < 8; ++i) {
+        guid[i]     = static_cast<std::uint8_t>((hi >> (i * 8)) & 0xFF);
+        guid[i + 8] = static_cast<std::uint8_t>((lo >> (i * 8)) & 0xFF);
+    }
+    // version 4 lives in the high nibble of time_hi, which is stored little-endian
+    guid[7] = static_cast<std::uint8_t>((guid[7] & 0x0F) | 0x40);
+    // RFC 4122 variant
+    guid[8] = static_cast<std::uint8_t>((guid[8] & 0x3F) | 0x80);
+    return guid;
+}
+
+auto parse_hex_digits(std::string_view digits) noexcept -> std::optional<std::uint64_t> {
+    std::uint64_t value{};
+    for (const char ch : digits) {
+        value <<= 4;
+        if (ch >= '0' && ch <= '9') {
+            value |= static_cast<std::uint64_t>(ch - '0');
+        } else if (ch >= 'a' && ch <= 'f') {
+            value |= static_cast<std::uint64_t>(ch - 'a' + 10);
+        } else if (ch >= 'A' && ch <= 'F') {
+            value |= static_cast<std::uint64_t>(ch - 'A' + 10);
+        } else {
+            return std::nullopt;
+        }
+    }
+    return value;
+}
+
+// RAII for raw block device fd
+class DeviceFd final {
+ public:
+    explicit DeviceFd(int fd) noexcept : m_fd(fd) { }
+    ~DeviceFd() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+    }
+
+    DeviceFd(const DeviceFd&)                    = delete;
+    auto operator=(const DeviceFd&) -> DeviceFd& = delete;
+    DeviceFd(DeviceFd&&)                         = delete;
+    auto operator=(DeviceFd&&) -> DeviceFd&      = delete;
+
+    [[nodiscard]] auto get() const noexcept -> int { return m_fd; }
+    [[nodiscard]] auto valid() const noexcept -> bool { return m_fd >= 0; }
+
+ private:
+    int m_fd{-1};
+};
+
+auto write_at(int fd, std::span<const std::uint8_t> data, std::uint64_t offset) noexcept -> bool {
+    std::size_t written{};
+    while (written < data.size()) {
+        const auto res = ::pwrite(fd, data.data() + written, data.size() - written, static_cast<off_t>(offset + written));
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<std::size_t>(res);
+    }
+    return true;
+}
+
+auto blkpg_call(int fd, int op, std::uint32_t pno, std::uint64_t start_bytes, std::uint64_t length_bytes) noexcept -> int {
+    blkpg_partition part{};
+    part.start  = static_cast<long long>(start_bytes);
+    part.length = static_cast<long long>(length_bytes);
+    part.pno    = static_cast<int>(pno);
+
+    blkpg_ioctl_arg arg{};
+    arg.op      = op;
+    arg.datalen = sizeof(part);
+    arg.data    = &part;
+    return ::ioctl(fd, BLKPG, &arg);
+}
+
+// kernel partitions currently registered for the disk, taken from sysfs
+auto list_kernel_partitions(std::string_view device) noexcept -> std::vector<std::uint32_t> {
+    namespace fs = std::filesystem;
+
+    std::vector<std::uint32_t> numbers{};
+    const auto& disk_name = gucc::disk::get_disk_name_from_device(device);
+    const auto sysfs_path = fmt::format(FMT_COMPILE("/sys/class/block/{}"), disk_name);
+
+    std::error_code err{};
+    for (const auto& dir_entry : fs::directory_iterator{sysfs_path, err}) {
+        std::ifstream partition_file{dir_entry.path() / "partition"};
+        std::uint32_t number{};
+        if (partition_file >> number) {
+            numbers.emplace_back(number);
+        }
+    }
+    return numbers;
+}
+
+auto wait_for_partition_nodes(const PartitionTableLayout& layout) noexcept -> gucc::Result<void> {
+    const auto deadline = std::chrono::steady_clock::now() + NODE_WAIT_TIMEOUT;
+    for (const auto& entry : layout.entries) {
+        std::error_code err{};
+        while (!std::filesystem::exists(entry.device, err)) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return make_error(ErrorCode::NotFound, fmt::format(FMT_COMPILE("partition node '{}' did not appear"), entry.device));
+            }
+            std::this_thread::sleep_for(NODE_POLL_INTERVAL);
+        }
+    }
+    return {};
+}
+
+auto register_kernel_partitions(int fd, std::string_view device, const PartitionTableLayout& layout) noexcept -> gucc::Result<void> {
+    const auto sector_size = static_cast<std::uint64_t>(layout.geometry.logical_sector_size);
+
+    // drop whatever the kernel still remembers about the old table
+    for (const auto number : list_kernel_partitions(device)) {
+        if (blkpg_call(fd, BLKPG_DEL_PARTITION, number, 0, 0) != 0 && errno != ENXIO) {
+            return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to remove partition {} of '{}' from kernel: {}"), number, device, std::strerror(errno)));
+        }
+    }
+
+    for (const auto& entry : layout.entries) {
+        const auto start  = entry.start_lba * sector_size;
+        const auto length = (entry.end_lba - entry.start_lba + 1) * sector_size;
+        if (blkpg_call(fd, BLKPG_ADD_PARTITION, entry.number, start, length) != 0) {
+            return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to add partition {} of '{}' to kernel: {}"), entry.number, device, std::strerror(errno)));
+        }
+    }
+    return {};
+}
+
+}  // namespace
+
+namespace gucc::disk {
+
+auto parse_partition_size(std::string_view size, std::uint32_t sector_size, std::uint64_t usable_bytes) noexcept -> std::optional<std::uint64_t> {
+    const auto trimmed = utils::trim(size);
+    if (trimmed.empty()) {
+        return std::nullopt;
+    }
+
+    const auto suffix_pos = trimmed.find_first_not_of("0123456789"sv);
+    const auto number     = utils::parse_uint<std::uint64_t>(trimmed.substr(0, suffix_pos));
+    if (!number) {
+        return std::nullopt;
+    }
+    if (suffix_pos == std::string_view::npos) {
+        // plain number means sectors
+        return *number * sector_size;
+    }
+
+    const auto suffix = trimmed.substr(suffix_pos);
+    if (suffix == "%"sv) {
+        if (*number > 100) {
+            return std::nullopt;
+        }
+        return usable_bytes / 100 * *number;
+    }
+
+    // KiB/K are binary, KB is decimal. same as util-linux strtosize
+    static constexpr auto UNITS = "KMGTPE"sv;
+    const auto unit_pos         = UNITS.find(static_cast<char>(suffix[0] & ~0x20));
+    if (unit_pos == std::string_view::npos) {
+        return std::nullopt;
+    }
+    const auto rest = suffix.substr(1);
+    std::uint64_t base{};
+    if (rest.empty() || rest == "iB"sv || rest == "ib"sv) {
+        base = 1024;
+    } else if (rest == "B"sv || rest == "b"sv) {
+        base = 1000;
+    } else {
+        return std::nullopt;
+    }
+
+    auto bytes = *number;
+    for (std::size_t i = 0; i <= unit_pos; ++i) {
+        if (bytes > UINT64_MAX / base) {
+            return std::nullopt;
+        }
+        bytes *= base;
+    }
+    return bytes;
+}
+
+auto query_disk_geometry(std::string_view device) noexcept -> Result<DiskGeometry> {
+    const DeviceFd fd{::open(std::string{device}.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (!fd.valid()) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("cannot open '{}': {}"), device, std::strerror(errno)));
+    }
+
+    DiskGeometry geometry{};
+    int sector_size{};
+    if (::ioctl(fd.get(), BLKSSZGET, &sector_size) != 0 || sector_size <= 0) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("cannot query sector size of '{}': {}"), device, std::strerror(errno)));
+    }
+    geometry.logical_sector_size = static_cast<std::uint32_t>(sector_size);
+
+    std::uint64_t size_bytes{};
+    if (::ioctl(fd.get(), BLKGETSIZE64, &size_bytes) != 0) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("cannot query size of '{}': {}"), device, std::strerror(errno)));
+    }
+    geometry.size_bytes = size_bytes;
+
+    // grow alignment past 1MiB when the device asks for it (RAID stripes, large IUs)
+    if (const auto& topology = query_disk_topology(device)) {
+        geometry.alignment_bytes = compute_partition_alignment(*topology);
+        for (const auto& warning : get_topology_warnings(device, *topology)) {
+            spdlog::warn("{}", warning);
+        }
+    }
+    return geometry;
+}
+
+auto plan_partition_table(std::string_view device, const std::vector<fs::Partition>& partitions, const DiskGeometry& geometry, bool is_efi) noexcept -> Result<PartitionTableLayout> {
+    const auto ordered = get_partition_table_order(partitions);
+    if (ordered.empty()) {
+        return make_error(ErrorCode::InvalidArgument, "partition schema is empty");
+    }
+    if (!is_efi && ordered.size() > MBR_MAX_PARTITIONS) {
+        return make_error(ErrorCode::Unsupported, fmt::format(FMT_COMPILE("DOS label supports at most {} primary partitions, got {}"), MBR_MAX_PARTITIONS, ordered.size()));
+    }
+    const auto sector_size = static_cast<std::uint64_t>(geometry.logical_sector_size);
+    if (sector_size == 0 || geometry.size_bytes == 0) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("invalid geometry for '{}'"), device));
+    }
+
+    PartitionTableLayout layout{};
+    layout.type     = is_efi ? PartitionTableType::Gpt : PartitionTableType::Dos;
+    layout.geometry = geometry;
+
+    const auto total_sectors = geometry.size_bytes / sector_size;
+    const auto grain         = std::max<std::uint64_t>(geometry.alignment_bytes / sector_size, 1);
+    if (is_efi) {
+        const auto entries_sectors = gpt_entries_sectors(geometry.logical_sector_size);
+        if (total_sectors < (2 * entries_sectors) + 3) {
+            return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("'{}' is too small for GPT"), device));
+        }
+        layout.first_usable_lba = 2 + entries_sectors;
+        layout.last_usable_lba  = total_sectors - 2 - entries_sectors;
+    } else {
+        if (total_sectors < 2) {
+            return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("'{}' is too small for DOS label"), device));
+        }
+        // 32-bit LBA fields, the rest of the disk is simply unreachable
+        layout.first_usable_lba = 1;
+        layout.last_usable_lba  = std::min<std::uint64_t>(total_sectors - 1, UINT32_MAX);
+    }
+
+    auto next_start         = align_up(layout.first_usable_lba, grain);
+    const auto usable_end   = align_down(layout.last_usable_lba + 1, grain);
+    const auto usable_bytes = usable_end > next_start ? (usable_end - next_start) * sector_size : 0;
+
+    std::random_device rand_dev{};
+    std::mt19937_64 rng{(static_cast<std::uint64_t>(rand_dev()) << 32) | rand_dev()};
+    layout.disk_guid = make_random_guid(rng);
+
+    for (std::size_t index = 0; index < ordered.size(); ++index) {
+        const auto& part = ordered[index];
+        if (next_start >= usable_end) {
+            return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("no space left on '{}' for partition {}"), device, index + 1));
+        }
+
+        std::uint64_t end_excl = usable_end;
+        if (!part.size.empty()) {
+            const auto bytes = parse_partition_size(part.size, geometry.logical_sector_size, usable_bytes);
+            if (!bytes || *bytes == 0) {
+                return make_error(ErrorCode::ParseError, fmt::format(FMT_COMPILE("invalid partition size '{}'"), part.size));
+            }
+            const auto sectors = align_up((*bytes + sector_size - 1) / sector_size, grain);
+            end_excl           = next_start + sectors;
+            if (end_excl > usable_end) {
+                return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("partition {} ({}) does not fit on '{}'"), index + 1, part.size, device));
+            }
+        }
+
+        PartitionTableEntry entry{};
+        entry.number      = static_cast<std::uint32_t>(index + 1);
+        entry.start_lba   = next_start;
+        entry.end_lba     = end_excl - 1;
+        entry.unique_guid = make_random_guid(rng);
+        entry.device      = insert_partition_number(device, entry.number);
+
+        switch (fs::string_to_filesystem_type(part.fstype)) {
+        case fs::FilesystemType::Vfat:
+            entry.type_guid = *detail::parse_guid(GPT_TYPE_EFI);
+            entry.mbr_type  = MBR_TYPE_EFI;
+            // keep parity with sfdisk ',bootable'
+            entry.bootable = true;
+            break;
+        case fs::FilesystemType::LinuxSwap:
+            entry.type_guid = *detail::parse_guid(GPT_TYPE_SWAP);
+            entry.mbr_type  = MBR_TYPE_SWAP;
+            break;
+        default:
+            entry.type_guid = *detail::parse_guid(GPT_TYPE_LINUX);
+            entry.mbr_type  = MBR_TYPE_LINUX;
+            break;
+        }
+        layout.entries.emplace_back(std::move(entry));
+        next_start = end_excl;
+    }
+    return layout;
+}
+
+auto write_partition_table(std::string_view device, const PartitionTableLayout& layout) noexcept -> Result<void> {
+    if (utils::default_runner().dry_run()) {
+        spdlog::info("[dry-run] would write {} partition(s) to '{}'", layout.entries.size(), device);
+        return {};
+    }
+
+    const DeviceFd fd{::open(std::string{device}.c_str(), O_RDWR | O_CLOEXEC)};
+    if (!fd.valid()) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("cannot open '{}' for writing: {}"), device, std::strerror(errno)));
+    }
+
+    const auto sector_size     = static_cast<std::uint64_t>(layout.geometry.logical_sector_size);
+    const auto total_sectors   = layout.geometry.size_bytes / sector_size;
+    const auto entries_sectors = gpt_entries_sectors(layout.geometry.logical_sector_size);
+
+    const auto& mbr = detail::serialize_mbr(layout);
+    if (layout.type == PartitionTableType::Gpt) {
+        const auto& entries       = detail::serialize_gpt_entries(layout);
+        const auto entries_crc    = detail::crc32(std::span{entries}.first(GPT_ENTRY_COUNT * GPT_ENTRY_SIZE));
+        const auto& primary       = detail::serialize_gpt_header(layout, entries_crc, true);
+        const auto& backup        = detail::serialize_gpt_header(layout, entries_crc, false);
+        const auto backup_entries = layout.last_usable_lba + 1;
+
+        const bool written = write_at(fd.get(), primary, sector_size)
+            && write_at(fd.get(), entries, 2 * sector_size)
+            && write_at(fd.get(), entries, backup_entries * sector_size)
+            && write_at(fd.get(), backup, (total_sectors - 1) * sector_size)
+            && write_at(fd.get(), mbr, 0);
+        if (!written) {
+            return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to write GPT to '{}': {}"), device, std::strerror(errno)));
+        }
+    } else {
+        // stale GPT structures would take precedence over the DOS label
+        const std::vector<std::uint8_t> zeros((entries_sectors + 1) * sector_size, 0);
+        const bool has_gpt_room = total_sectors > 2 * (entries_sectors + 1);
+        const auto tail_offset  = has_gpt_room ? (total_sectors - entries_sectors - 1) * sector_size : 0;
+
+        const bool written = (!has_gpt_room || (write_at(fd.get(), zeros, sector_size) && write_at(fd.get(), zeros, tail_offset)))
+            && write_at(fd.get(), mbr, 0);
+        if (!written) {
+            return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to write DOS label to '{}': {}"), device, std::strerror(errno)));
+        }
+    }
+    if (::fsync(fd.get()) != 0) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to flush '{}': {}"), device, std::strerror(errno)));
+    }
+
+    if (auto res = register_kernel_partitions(fd.get(), device, layout); !res) {
+        return res;
+    }
+    return wait_for_partition_nodes(layout);
+}
+
+auto make_partition_table(std::string_view device, const std::vector<fs::Partition>& partitions, bool is_efi) noexcept -> Result<void> {
+    const auto started_at = std::chrono::steady_clock::now();
+
+    auto geometry = query_disk_geometry(device);
+    if (!geometry) {
+        return std::unexpected(std::move(geometry.error()));
+    }
+    auto layout = plan_partition_table(device, partitions, *geometry, is_efi);
+    if (!layout) {
+        return std::unexpected(std::move(layout.error()));
+    }
+    if (auto res = write_partition_table(device, *layout); !res) {
+        return res;
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started_at);
+    spdlog::info("Partitioned '{}' ({} partitions) in {}ms", device, layout->entries.size(), elapsed.count());
+    return {};
+}
+
+}  // namespace gucc::disk
+
+namespace gucc::disk::detail {
+
+auto crc32(std::span<const std::uint8_t> data) noexcept -> std::uint32_t {
+    static constexpr auto CRC_TABLE = [] {
+        std::array<std::uint32_t, 256> table{};
+        for (std::uint32_t i = 0; i < table.size(); ++i) {
+            auto crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1U) != 0 ? (crc >> 1U) ^ 0xEDB88320U : crc >> 1U;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }();
+
+    std::uint32_t crc = 0xFFFFFFFFU;
+    for (const auto byte : data) {
+        crc = CRC_TABLE[(crc ^ byte) & 0xFFU] ^ (crc >> 8U);
+    }
+    return crc ^ 0xFFFFFFFFU;
+}
+
+auto parse_guid(std::string_view guid_str) noexcept -> std::optional<Guid> {
+    // 8-4-4-4-12
+    if (guid_str.size() != 36 || guid_str[8] != '-' || guid_str[13] != '-' || guid_str[18] != '-' || guid_str[23] != '-') {
+        return std::nullopt;
+    }
+    const auto time_low = parse_hex_digits(guid_str.substr(0, 8));
+    const auto time_mid = parse_hex_digits(guid_str.substr(9, 4));
+    const auto time_hi  = parse_hex_digits(guid_str.substr(14, 4));
+    const auto clock    = parse_hex_digits(guid_str.substr(19, 4));
+    const auto node     = parse_hex_digits(guid_str.substr(24, 12));
+    if (!time_low || !time_mid || !time_hi || !clock || !node) {
+        return std::nullopt;
+    }
+
+    Guid guid{};
+    // first three fields are little-endian, the rest is stored as is
+    put_le(guid, 0, static_cast<std::uint32_t>(*time_low));
+    put_le(guid, 4, static_cast<std::uint16_t>(*time_mid));
+    put_le(guid, 6, static_cast<std::uint16_t>(*time_hi));
+    guid[8] = static_cast<std::uint8_t>(*clock >> 8U);
+    guid[9] = static_cast<std::uint8_t>(*clock & 0xFFU);
+    for (std::size_t i = 0; i < 6; ++i) {
+        guid[10 + i] = static_cast<std::uint8_t>((*node >> ((5 - i) * 8)) & 0xFFU);
+    }
+    return guid;
+}
+
+auto format_guid(const Guid& guid) noexcept -> std::string {
+    return fmt::format(FMT_COMPILE("{:02X}{:02X}{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}{:02X}{:02X}{:02X}{:02X}"),
+        guid[3], guid[2], guid[1], guid[0], guid[5], guid[4], guid[7], guid[6],
+        guid[8], guid[9], guid[10], guid[11], guid[12], guid[13], guid[14], guid[15]);
+}
+
+auto serialize_mbr(const PartitionTableLayout& layout) noexcept -> std::vector<std::uint8_t> {
+    static constexpr std::size_t PART_TABLE_OFFSET = 446;
+    static constexpr std::size_t PART_ENTRY_SIZE   = 16;
+
+    std::vector<std::uint8_t> sector(layout.geometry.logical_sector_size, 0);
+    const auto total_sectors = layout.geometry.size_bytes / layout.geometry.logical_sector_size;
+
+    const auto put_entry = [&sector](std::size_t slot, bool bootable, std::uint8_t type, std::uint64_t start, std::uint64_t count) {
+        const auto offset = PART_TABLE_OFFSET + (slot * PART_ENTRY_SIZE);
+        sector[offset]    = bootable ? 0x80 : 0x00;
+        put_chs(sector, offset + 1, start);
+        sector[offset + 4] = type;
+        put_chs(sector, offset + 5, start + count - 1);
+        put_le(sector, offset + 8, static_cast<std::uint32_t>(start));
+        put_le(sector, offset + 12, static_cast<std::uint32_t>(count));
+    };
+
+    if (layout.type == PartitionTableType::Gpt) {
+        // single 0xEE entry spanning the whole disk, or as much as 32 bits allow
+        put_entry(0, false, MBR_TYPE_PROTECTIVE, 1, std::min<std::uint64_t>(total_sectors - 1, UINT32_MAX));
+        // CHS start of the protective entry is fixed to 0/0/2
+        sector[PART_TABLE_OFFSET + 1] = 0x00;
+        sector[PART_TABLE_OFFSET + 2] = 0x02;
+        sector[PART_TABLE_OFFSET + 3] = 0x00;
+    } else {
+        // disk identifier
+        std::ranges::copy(std::span{layout.disk_guid}.first(4), sector.begin() + 440);
+        for (const auto& [slot, entry] : layout.entries | std::ranges::views::enumerate) {
+            put_entry(static_cast<std::size_t>(slot), entry.bootable, entry.mbr_type, entry.start_lba, entry.end_lba - entry.start_lba + 1);
+        }
+    }
+    sector[510] = 0x55;
+    sector[511] = 0xAA;
+    return sector;
+}
+
+auto serialize_gpt_entries(const PartitionTableLayout& layout) noexcept -> std::vector<std::uint8_t> {
+    const auto sector_size = layout.geometry.logical_sector_size;
+    std::vector<std::uint8_t> entries(gpt_entries_sectors(sector_size) * sector_size, 0);
+
+    for (const auto& entry : layout.entries) {
+        const auto offset = (entry.number - 1) * std::size_t{GPT_ENTRY_SIZE};
+        put_guid(entries, offset, entry.type_guid);
+        put_guid(entries, offset + 16, entry.unique_guid);
+        put_le(entries, offset + 32, entry.start_lba);
+        put_le(entries, offset + 40, entry.end_lba);
+        put_le(entries, offset + 48, entry.bootable ? GPT_ATTR_LEGACY_BOOT : std::uint64_t{0});
+        // name stays empty, same as sfdisk without name=
+    }
+    return entries;
+}
+
+auto serialize_gpt_header(const PartitionTableLayout& layout, std::uint32_t entries_crc, bool is_primary) noexcept -> std::vector<std::uint8_t> {
+    const auto sector_size   = layout.geometry.logical_sector_size;
+    const auto total_sectors = layout.geometry.size_bytes / sector_size;
+    const auto backup_lba    = total_sectors - 1;
+
+    std::vector<std::uint8_t> sector(sector_size, 0);
+    static constexpr auto SIGNATURE = "EFI PART"sv;
+    std::ranges::copy(SIGNATURE, sector.begin());
+    put_le(sector, 8, GPT_REVISION);
+    put_le(sector, 12, GPT_HEADER_SIZE);
+    // 16: header crc, filled last
+    put_le(sector, 24, is_primary ? std::uint64_t{1} : backup_lba);
+    put_le(sector, 32, is_primary ? backup_lba : std::uint64_t{1});
+    put_le(sector, 40, layout.first_usable_lba);
+    put_le(sector, 48, layout.last_usable_lba);
+    put_guid(sector, 56, layout.disk_guid);
+    put_le(sector, 72, is_primary ? std::uint64_t{2} : layout.last_usable_lba + 1);
+    put_le(sector, 80, GPT_ENTRY_COUNT);
+    put_le(sector, 84, GPT_ENTRY_SIZE);
+    put_le(sector, 88, entries_crc);
+    put_le(sector, 16, crc32(std::span{sector}.first(GPT_HEADER_SIZE)));
+    return sector;
+}
+
+}  // namespace gucc::disk::detail
@@ -1,6 +1,9 @@
 #include "gucc/partitioning.hpp"
+#include "gucc/disk_topology.hpp"
+#include "gucc/fs_tuning.hpp"
 #include "gucc/io_utils.hpp"
 #include "gucc/partition_config.hpp"
+#include "gucc/partition_table.hpp"
 #include "gucc/string_utils.hpp"
 #include "gucc/system_query.hpp"
 
@@ -10,7 +13,7 @@
 #include <optional>     // for optional
 #include <ranges>       // for ranges::*
 #include <string_view>  // for string_view
-#include <utility>      // for pair
+#include <utility>      // for pair, move
 
 #include <fmt/compile.h>
 #include <fmt/format.h>
@@ -65,6 +68,25 @@ constexpr auto is_fill_size(std::string_view size) noexcept -> bool {
     return trimmed.empty() || trimmed == "100%"sv;
 }
 
+// round a size up to the alignment, already aligned ones are kept as written
+auto align_size_string(std::string_view size, std::uint64_t alignment) noexcept -> std::string {
+    // percentages and plain sector counts depend on the device, leave them be
+    if (alignment == 0 || is_fill_size(size) || size.ends_with('%') || size.find_first_not_of("0123456789"sv) == std::string_view::npos) {
+        return std::string{size};
+    }
+    const auto bytes = gucc::disk::parse_partition_size(size, 512, 0);
+    if (!bytes || (*bytes % alignment) == 0) {
+        return std::string{size};
+    }
+
+    static constexpr std::uint64_t MiB = 1024 * 1024;
+    const auto aligned = ((*bytes + alignment - 1) / alignment) * alignment;
+    if ((aligned % MiB) == 0) {
+        return fmt::format(FMT_COMPILE("{}MiB"), aligned / MiB);
+    }
+    return fmt::format(FMT_COMPILE("{}KiB"), aligned / 1024);
+}
+
 // single sfdisk command line
 constexpr auto to_sfdisk_line(const gucc::fs::Partition& part) noexcept -> std::string {
     const auto& fsname   = convert_fsname(part.fstype);
@@ -105,9 +127,9 @@ constexpr auto to_sfdisk_line(const gucc::fs::Partition& part) noexcept -> std::
 
 namespace gucc::disk {
 
-auto gen_sfdisk_command(const std::vector<fs::Partition>& partitions, bool is_efi) noexcept -> std::string {
-    // NOTE: sfdisk allocates partitions in the order it reads them, so emission
-    // order decides the resulting partition numbers. Callers assign the device
+auto get_partition_table_order(const std::vector<fs::Partition>& partitions) noexcept -> std::vector<fs::Partition> {
+    // NOTE: partitions are allocated in the order returned here (both by sfdisk
+    // and by the in-process writer), so it decides the resulting partition numbers. Callers assign the device
     // paths in declaration order (see generate_partition_schema_from_config),
     // so declaration order must be preserved here, otherwise the schema's
     // device paths stop matching the partitions actually created.
@@ -135,6 +157,11 @@ auto gen_sfdisk_command(const std::vector<fs::Partition>& partitions, bool is_ef
     // empty sized parts must be at the end, they take whatever space is left.
     // stable, to leave declaration order otherwise untouched
     std::ranges::stable_partition(partitions_filtered, std::not_fn(&std::string::empty), &fs::Partition::size);
+    return partitions_filtered;
+}
+
+auto gen_sfdisk_command(const std::vector<fs::Partition>& partitions, bool is_efi) noexcept -> std::string {
+    const auto& partitions_filtered = get_partition_table_order(partitions);
 
     // sfdisk does not create partition table without partitions by default. The lines with partitions are expected in the script by default.
     auto sfdisk_commands = fmt::format(FMT_COMPILE("label: {}\n"), is_efi ? "gpt"sv : "dos"sv);
@@ -186,6 +213,17 @@ auto generate_default_partition_schema(std::string_view device, std::string_view
         .is_ssd             = gucc::disk::is_device_ssd(device),
         .boot_mountpoint    = std::string{boot_mountpoint},
     };
+    if (const auto& topology = query_disk_topology(device)) {
+        config.alignment_bytes = compute_partition_alignment(*topology);
+    }
+    if (const auto& device_profile = fs::query_device_profile(device)) {
+        // without a separate boot partition the bootloader reads kernels from root
+        const bool read_by_bootloader = !is_efi || boot_mountpoint != "/boot"sv;
+
+        auto tuning              = fs::get_fs_tuning(config.root_fs_type, fs::classify_device(*device_profile), *device_profile, read_by_bootloader);
+        config.root_mount_opts   = std::move(tuning.mount_opts);
+        config.root_mkfs_command = std::move(tuning.mkfs_command);
+    }
     return generate_partition_schema_from_config(device, config, is_efi);
 }
 
@@ -194,9 +232,8 @@ auto make_clean_partschema(std::string_view device, const std::vector<fs::Partit
     if (auto res = erase_disk(device); !res) {
         return res;
     }
-    // apply schema
-    const auto& sfdisk_commands = gucc::disk::gen_sfdisk_command(partitions, is_efi);
-    if (auto res = run_sfdisk_part(sfdisk_commands, device); !res) {
+    // apply schema. written in-process, so no need to wait on udev for the whole disk
+    if (auto res = make_partition_table(device, partitions, is_efi); !res) {
         return res;
     }
     return {};
@@ -219,7 +256,7 @@ auto generate_partition_schema_from_config(std::string_view device, const fs::De
             .mountpoint = config.boot_mountpoint,
             .uuid_str   = {},
             .device     = insert_partition_number(device, static_cast<std::uint32_t>(partitions.size() + 1)),
-            .size       = config.efi_partition_size,
+            .size       = align_size_string(config.efi_partition_size, config.alignment_bytes),
             .mount_opts = fs::get_default_mount_opts(fs::FilesystemType::Vfat, config.is_ssd)};
         partitions.emplace_back(std::move(efi_partition));
     } else if (config.boot_partition_size) {
@@ -229,7 +266,7 @@ auto generate_partition_schema_from_config(std::string_view device, const fs::De
             .mountpoint = config.boot_mountpoint,
             .uuid_str   = {},
             .device     = insert_partition_number(device, static_cast<std::uint32_t>(partitions.size() + 1)),
-            .size       = *config.boot_partition_size,
+            .size       = align_size_string(*config.boot_partition_size, config.alignment_bytes),
             .mount_opts = fs::get_default_mount_opts(fs::FilesystemType::Ext4, config.is_ssd)};
         partitions.emplace_back(std::move(boot_partition));
     }
@@ -241,19 +278,20 @@ auto generate_partition_schema_from_config(std::string_view device, const fs::De
             .mountpoint = ""s,
             .uuid_str   = {},
             .device     = insert_partition_number(device, static_cast<std::uint32_t>(partitions.size() + 1)),
-            .size       = *config.swap_partition_size,
+            .size       = align_size_string(*config.swap_partition_size, config.alignment_bytes),
             .mount_opts = "defaults"s};
         partitions.emplace_back(std::move(swap_partition));
     }
 
     // Create root partition (uses remaining space)
     fs::Partition root_partition{
-        .fstype     = std::string{fs::filesystem_type_to_string(config.root_fs_type)},
-        .mountpoint = "/"s,
-        .uuid_str   = {},
-        .device     = insert_partition_number(device, static_cast<std::uint32_t>(partitions.size() + 1)),
-        .size       = {},
-        .mount_opts = root_mount_opts};
+        .fstype       = std::string{fs::filesystem_type_to_string(config.root_fs_type)},
+        .mountpoint   = "/"s,
+        .uuid_str     = {},
+        .device       = insert_partition_number(device, static_cast<std::uint32_t>(partitions.size() + 1)),
+        .size         = {},
+        .mount_opts   = root_mount_opts,
+        .mkfs_command = config.root_mkfs_command.value_or(""s)};
     partitions.emplace_back(std::move(root_partition));
 
     return partitions;
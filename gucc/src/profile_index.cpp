@@ -0,0 +1,279 @@
+#include "gucc/profile_index.hpp"
+#include "gucc/sha256.hpp"
+
+#include <cstddef>  // for size_t
+#include <cstdint>  // for uint8_t, uint32_t
+
+#include <limits>   // for numeric_limits
+#include <utility>  // for move
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+using gucc::ErrorCode;
+using gucc::make_error;
+using gucc::profile::DesktopProfile;
+using gucc::profile::NetinstallGroup;
+using gucc::profile::ServiceEntry;
+
+// bumped with any change to the layout below
+inline constexpr auto SNAPSHOT_MAGIC = "GUCCPIX1"sv;
+// deeper nesting than any real doc, keeps a corrupt snapshot from blowing the stack
+inline constexpr std::size_t MAX_GROUP_DEPTH = 32;
+
+void collect_group_packages(const NetinstallGroup& group, std::vector<std::string>& out) noexcept {
+    out.insert(out.cend(), group.packages.cbegin(), group.packages.cend());
+    for (const auto& sub : group.subgroups) {
+        collect_group_packages(sub, out);
+    }
+}
+
+// Little-endian u32 lengths and counts, strings as raw bytes.
+class SnapshotWriter final {
+ public:
+    void put_u32(std::uint32_t value) noexcept {
+        for (std::size_t shift = 0; shift < 32; shift += 8) {
+            m_out.push_back(static_cast<char>((value >> shift) & 0xFFU));
+        }
+    }
+    void put_string(std::string_view value) noexcept {
+        put_u32(static_cast<std::uint32_t>(value.size()));
+        m_out.append(value);
+    }
+    void put_strings(const std::vector<std::string>& values) noexcept {
+        put_u32(static_cast<std::uint32_t>(values.size()));
+        for (const auto& value : values) {
+            put_string(value);
+        }
+    }
+    void put_services(const std::vector<ServiceEntry>& services) noexcept {
+        put_u32(static_cast<std::uint32_t>(services.size()));
+        for (const auto& service : services) {
+            put_u32(static_cast<std::uint32_t>(service.is_user_service) | (static_cast<std::uint32_t>(service.is_urgent) << 1U) | (static_cast<std::uint32_t>(service.action) << 2U));
+            put_string(service.name);
+        }
+    }
+    void put_group(const NetinstallGroup& group) noexcept {
+        put_string(group.name);
+        put_string(group.description);
+        put_string(group.icon);
+        put_u32(static_cast<std::uint32_t>(group.selected) | (static_cast<std::uint32_t>(group.hidden) << 1U) | (static_cast<std::uint32_t>(group.critical) << 2U) | (static_cast<std::uint32_t>(group.is_bundle) << 3U));
+        put_strings(group.packages);
+        put_u32(static_cast<std::uint32_t>(group.subgroups.size()));
+        for (const auto& sub : group.subgroups) {
+            put_group(sub);
+        }
+    }
+
+    auto take() noexcept -> std::string { return std::move(m_out); }
+
+ private:
+    std::string m_out{};
+};
+
+// Every getter fails once the input is short, the caller checks at the end.
+class SnapshotReader final {
+ public:
+    explicit SnapshotReader(std::string_view in) noexcept : m_in(in) { }
+
+    [[nodiscard]] auto ok() const noexcept -> bool { return m_ok; }
+    [[nodiscard]] auto at_end() const noexcept -> bool { return m_in.empty(); }
+
+    auto get_u32() noexcept -> std::uint32_t {
+        if (m_in.size() < 4) {
+            m_ok = false;
+            return 0;
+        }
+        std::uint32_t value{};
+        for (std::size_t i = 0; i < 4; ++i) {
+            value |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(m_in[i])) << (i * 8);
+        }
+        m_in.remove_prefix(4);
+        return value;
+    }
+    auto get_string() noexcept -> std::string {
+        const auto size = get_u32();
+        if (!m_ok || size > m_in.size()) {
+            m_ok = false;
+            return {};
+        }
+        std::string value{m_in.substr(0, size)};
+        m_in.remove_prefix(size);
+        return value;
+    }
+    // every element takes at least 4 bytes, a larger count is corrupt
+    auto get_count() noexcept -> std::uint32_t {
+        const auto count = get_u32();
+        if (!m_ok || count > m_in.size() / 4) {
+            m_ok = false;
+            return 0;
+        }
+        return count;
+    }
+    auto get_strings() noexcept -> std::vector<std::string> {
+        std::vector<std::string> values(get_count());
+        for (auto& value : values) {
+            value = get_string();
+        }
+        return values;
+    }
+    auto get_services() noexcept -> std::vector<ServiceEntry> {
+        std::vector<ServiceEntry> services(get_count());
+        for (auto& service : services) {
+            const auto flags        = get_u32();
+            service.is_user_service = (flags & 1U) != 0;
+            service.is_urgent       = (flags & 2U) != 0;
+            service.action          = ((flags >> 2U) & 1U) != 0 ? gucc::profile::ServiceAction::Disable : gucc::profile::ServiceAction::Enable;
+            service.name            = get_string();
+        }
+        return services;
+    }
+    auto get_group(std::size_t depth = 0) noexcept -> NetinstallGroup {
+        NetinstallGroup group{};
+        if (depth > MAX_GROUP_DEPTH) {
+            m_ok = false;
+            return group;
+        }
+        group.name        = get_string();
+        group.description = get_string();
+        group.icon        = get_string();
+        const auto flags  = get_u32();
+        group.selected    = (flags & 1U) != 0;
+        group.hidden      = (flags & 2U) != 0;
+        group.critical    = (flags & 4U) != 0;
+        group.is_bundle   = (flags & 8U) != 0;
+        group.packages    = get_strings();
+
+        const auto sub_count = get_count();
+        for (std::uint32_t i = 0; i < sub_count && m_ok; ++i) {
+            group.subgroups.emplace_back(get_group(depth + 1));
+        }
+        return group;
+    }
+
+ private:
+    std::string_view m_in;
+    bool m_ok{true};
+};
+
+}  // namespace
+
+namespace gucc::profile {
+
+auto ProfileIndex::build(std::string_view net_profiles_content, std::string revision) noexcept -> Result<ProfileIndex> {
+    auto net_profiles = parse_net_profiles(net_profiles_content);
+    if (!net_profiles) {
+        return make_error(ErrorCode::ParseError, "failed to parse net profiles");
+    }
+    if (net_profiles->desktop_profiles.size() > std::numeric_limits<std::uint32_t>::max()
+        || net_profiles->netinstall_groups.size() > std::numeric_limits<std::uint32_t>::max()) {
+        return make_error(ErrorCode::InvalidArgument, "net profiles doc is too large to index");
+    }
+
+    ProfileIndex index{};
+    index.m_revision = revision.empty() ? hash::sha256_hex(net_profiles_content) : std::move(revision);
+    index.m_base     = std::move(net_profiles->base_profiles);
+    index.m_desktops = std::move(net_profiles->desktop_profiles);
+    index.m_groups   = std::move(net_profiles->netinstall_groups);
+    index.build_lookup();
+    return index;
+}
+
+auto ProfileIndex::deserialize(std::string_view snapshot, std::string_view expected_revision) noexcept -> Result<ProfileIndex> {
+    if (!snapshot.starts_with(SNAPSHOT_MAGIC)) {
+        return make_error(ErrorCode::ParseError, "not a profile index snapshot, or from another format version");
+    }
+    SnapshotReader reader{snapshot.substr(SNAPSHOT_MAGIC.size())};
+
+    ProfileIndex index{};
+    index.m_revision = reader.get_string();
+    if (reader.ok() && index.m_revision != expected_revision) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("profile index snapshot is of revision '{}', expected '{}'"), index.m_revision, expected_revision));
+    }
+
+    index.m_base.base_packages         = reader.get_strings();
+    index.m_base.base_desktop_packages = reader.get_strings();
+    index.m_base.base_services         = reader.get_services();
+    index.m_base.base_desktop_services = reader.get_services();
+
+    const auto desktop_count = reader.get_count();
+    for (std::uint32_t i = 0; i < desktop_count && reader.ok(); ++i) {
+        auto profile_name = reader.get_string();
+        index.m_desktops.emplace_back(DesktopProfile{.profile_name = std::move(profile_name), .packages = reader.get_strings()});
+    }
+    const auto group_count = reader.get_count();
+    for (std::uint32_t i = 0; i < group_count && reader.ok(); ++i) {
+        index.m_groups.emplace_back(reader.get_group());
+    }
+
+    if (!reader.ok() || !reader.at_end()) {
+        return make_error(ErrorCode::ParseError, "profile index snapshot is truncated or corrupt");
+    }
+    index.build_lookup();
+    return index;
+}
+
+auto ProfileIndex::serialize() const noexcept -> std::string {
+    SnapshotWriter writer{};
+    writer.put_string(m_revision);
+    writer.put_strings(m_base.base_packages);
+    writer.put_strings(m_base.base_desktop_packages);
+    writer.put_services(m_base.base_services);
+    writer.put_services(m_base.base_desktop_services);
+
+    writer.put_u32(static_cast<std::uint32_t>(m_desktops.size()));
+    for (const auto& desktop : m_desktops) {
+        writer.put_string(desktop.profile_name);
+        writer.put_strings(desktop.packages);
+    }
+    writer.put_u32(static_cast<std::uint32_t>(m_groups.size()));
+    for (const auto& group : m_groups) {
+        writer.put_group(group);
+    }
+    return fmt::format(FMT_COMPILE("{}{}"), SNAPSHOT_MAGIC, writer.take());
+}
+
+auto ProfileIndex::find_desktop(std::string_view desktop_id) const noexcept -> const DesktopProfile* {
+    const auto it = m_desktop_by_id.find(desktop_id);
+    return (it != m_desktop_by_id.end()) ? &m_desktops[it->second] : nullptr;
+}
+
+auto ProfileIndex::find_group(std::string_view group_id) const noexcept -> const NetinstallGroup* {
+    const auto it = m_group_by_id.find(group_id);
+    return (it != m_group_by_id.end()) ? &m_groups[it->second] : nullptr;
+}
+
+auto ProfileIndex::group_packages(std::string_view group_id) const noexcept -> const std::vector<std::string>* {
+    const auto it = m_group_by_id.find(group_id);
+    return (it != m_group_by_id.end()) ? &m_group_packages[it->second] : nullptr;
+}
+
+void ProfileIndex::build_lookup() noexcept {
+    m_desktop_by_id.reserve(m_desktops.size());
+    for (std::uint32_t i = 0; i < m_desktops.size(); ++i) {
+        m_desktop_by_id.try_emplace(m_desktops[i].profile_name, i);
+    }
+
+    m_group_by_id.reserve(m_groups.size());
+    m_group_packages.resize(m_groups.size());
+    for (std::uint32_t i = 0; i < m_groups.size(); ++i) {
+        m_group_by_id.try_emplace(m_groups[i].name, i);
+        collect_group_packages(m_groups[i], m_group_packages[i]);
+    }
+}
+
+auto layers_revision(const std::vector<std::string_view>& layers) noexcept -> std::string {
+    hash::Sha256 hasher{};
+    for (const auto& layer : layers) {
+        // length-prefixed, moving bytes between layers changes the revision
+        hasher.update(fmt::format(FMT_COMPILE("{}:"), layer.size()));
+        hasher.update(layer);
+    }
+    return hasher.finish();
+}
+
+}  // namespace gucc::profile
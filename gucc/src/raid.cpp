@@ -0,0 +1,268 @@
+#include "gucc/raid.hpp"
+#include "gucc/file_utils.hpp"
+#include "gucc/io_utils.hpp"
+#include "gucc/process.hpp"
+#include "gucc/string_utils.hpp"
+
+#include <algorithm>   // for max, ranges::sort, ranges::adjacent_find
+#include <bit>         // for bit_ceil, has_single_bit
+#include <expected>    // for unexpected
+#include <filesystem>  // for exists, create_directories, weakly_canonical
+#include <ranges>      // for views::drop
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include <spdlog/spdlog.h>
+
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+// what mdadm picks without --chunk
+inline constexpr std::uint64_t DEFAULT_MD_CHUNK = 512 * 1024;
+// smallest chunk md accepts, one page
+inline constexpr std::uint64_t MIN_MD_CHUNK = 4096;
+// same cap compute_partition_alignment uses against bogus hints
+inline constexpr std::uint64_t MAX_MD_CHUNK = 64 * 1024 * 1024;
+
+auto canonical_device(std::string_view device) noexcept -> std::string {
+    std::error_code ec;
+    auto path = fs::weakly_canonical(fs::path{device}, ec);
+    return ec ? std::string{device} : path.string();
+}
+
+// devices holding distinct data, near-2 layout for raid10
+constexpr auto data_disks(gucc::raid::RaidLevel level, std::size_t device_count) noexcept -> std::uint64_t {
+    using gucc::raid::RaidLevel;
+    switch (level) {
+    case RaidLevel::Raid0:
+        return device_count;
+    case RaidLevel::Raid1:
+        return 1;
+    case RaidLevel::Raid10:
+        return device_count / 2;
+    }
+    return 1;
+}
+
+// "ARRAY /dev/md/cachyos metadata=1.2 UUID=... name=any:cachyos" -> "UUID=..."
+auto array_uuid(std::string_view line) noexcept -> std::string_view {
+    for (auto&& token : gucc::utils::make_split_view(line, ' ')) {
+        if (token.starts_with("UUID="sv)) {
+            return token;
+        }
+    }
+    return {};
+}
+
+}  // namespace
+
+namespace gucc::raid {
+
+auto string_to_raid_level(std::string_view level) noexcept -> std::optional<RaidLevel> {
+    if (level == "raid0"sv) {
+        return RaidLevel::Raid0;
+    } else if (level == "raid1"sv) {
+        return RaidLevel::Raid1;
+    } else if (level == "raid10"sv) {
+        return RaidLevel::Raid10;
+    }
+    return std::nullopt;
+}
+
+auto raid_level_to_string(RaidLevel level) noexcept -> std::string_view {
+    switch (level) {
+    case RaidLevel::Raid0:
+        return "raid0"sv;
+    case RaidLevel::Raid1:
+        return "raid1"sv;
+    case RaidLevel::Raid10:
+        return "raid10"sv;
+    }
+    return {};
+}
+
+auto raid_min_devices(RaidLevel level) noexcept -> std::size_t {
+    return (level == RaidLevel::Raid10) ? 4 : 2;
+}
+
+auto validate_raid_setup(const RaidSetup& setup) noexcept -> Result<void> {
+    if (setup.devices.size() < raid_min_devices(setup.level)) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("{} needs at least {} devices, got {}"), raid_level_to_string(setup.level), raid_min_devices(setup.level), setup.devices.size()));
+    }
+
+    std::vector<std::string> canonical_devices{};
+    for (const auto& device : setup.devices) {
+        canonical_devices.emplace_back(canonical_device(device));
+    }
+    std::ranges::sort(canonical_devices);
+    if (std::ranges::adjacent_find(canonical_devices) != canonical_devices.end()) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("a device is listed twice in '{}'"), utils::join(setup.devices, ' ')));
+    }
+
+    if (setup.backend == RaidBackend::Btrfs) {
+        if (setup.devices.size() < raid_min_devices(setup.metadata_level)) {
+            return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("{} metadata needs at least {} devices, got {}"), raid_level_to_string(setup.metadata_level), raid_min_devices(setup.metadata_level), setup.devices.size()));
+        }
+        return {};
+    }
+
+    if (setup.name.empty() || setup.name.contains('/')) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("invalid md array name '{}'"), setup.name));
+    }
+    // 0 leaves the chunk to mdadm
+    if (setup.chunk_size != 0 && (!std::has_single_bit(setup.chunk_size) || setup.chunk_size < MIN_MD_CHUNK)) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("md chunk size {} isn't a power of two of at least {}"), setup.chunk_size, MIN_MD_CHUNK));
+    }
+    return {};
+}
+
+auto md_chunk_size_for(RaidLevel level, std::span<const disk::DiskTopology> members) noexcept -> std::uint64_t {
+    if (level == RaidLevel::Raid1) {
+        return 0;
+    }
+
+    std::uint64_t chunk = DEFAULT_MD_CHUNK;
+    for (const auto& topology : members) {
+        for (const std::uint64_t hint : {topology.physical_block_size, topology.minimum_io_size, topology.optimal_io_size}) {
+            if (hint > chunk && hint <= MAX_MD_CHUNK) {
+                chunk = std::bit_ceil(hint);
+            }
+        }
+    }
+    return chunk;
+}
+
+auto md_array_topology(const RaidSetup& setup, std::span<const disk::DiskTopology> members) noexcept -> disk::DiskTopology {
+    disk::DiskTopology topology{};
+    for (const auto& member : members) {
+        topology.logical_block_size  = std::max(topology.logical_block_size, member.logical_block_size);
+        topology.physical_block_size = std::max(topology.physical_block_size, member.physical_block_size);
+    }
+    if (setup.level == RaidLevel::Raid1) {
+        return topology;
+    }
+
+    const auto chunk         = (setup.chunk_size != 0) ? setup.chunk_size : DEFAULT_MD_CHUNK;
+    topology.raid_chunk_size = static_cast<std::uint32_t>(chunk);
+    topology.minimum_io_size = static_cast<std::uint32_t>(chunk);
+    topology.optimal_io_size = static_cast<std::uint32_t>(chunk * data_disks(setup.level, setup.devices.size()));
+    return topology;
+}
+
+auto create_md_array(const RaidSetup& setup) noexcept -> Result<std::string> {
+    if (setup.backend != RaidBackend::Mdadm) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("'{}' isn't an md array"), setup.name));
+    }
+    if (auto res = validate_raid_setup(setup); !res) {
+        return std::unexpected(res.error());
+    }
+
+    // old superblocks make mdadm ask before reusing a device
+    for (const auto& device : setup.devices) {
+        if (!utils::exec_checked(fmt::format(FMT_COMPILE("wipefs -a '{}'"), device))) {
+            return make_error(ErrorCode::SubprocessFailed, fmt::format(FMT_COMPILE("failed to wipe '{}'"), device));
+        }
+    }
+    if (!utils::exec_checked(detail::mdadm_create_cmd(setup))) {
+        return make_error(ErrorCode::SubprocessFailed, fmt::format(FMT_COMPILE("failed to create md array '{}'"), setup.name));
+    }
+
+    spdlog::info("Created {} md array '{}' over {} devices", raid_level_to_string(setup.level), setup.name, setup.devices.size());
+    return fmt::format(FMT_COMPILE("/dev/md/{}"), setup.name);
+}
+
+auto assemble_md_array(const RaidSetup& setup) noexcept -> Result<std::string> {
+    auto cmd = fmt::format(FMT_COMPILE("mdadm --assemble '/dev/md/{}'"), setup.name);
+    for (const auto& device : setup.devices) {
+        cmd += fmt::format(FMT_COMPILE(" '{}'"), device);
+    }
+    if (!utils::exec_checked(cmd)) {
+        return make_error(ErrorCode::SubprocessFailed, fmt::format(FMT_COMPILE("failed to assemble md array '{}'"), setup.name));
+    }
+    return fmt::format(FMT_COMPILE("/dev/md/{}"), setup.name);
+}
+
+auto stop_md_array(std::string_view array_path) noexcept -> Result<void> {
+    if (!utils::exec_checked(fmt::format(FMT_COMPILE("mdadm --stop '{}'"), array_path))) {
+        return make_error(ErrorCode::SubprocessFailed, fmt::format(FMT_COMPILE("failed to stop md array '{}'"), array_path));
+    }
+    return {};
+}
+
+auto write_mdadm_conf(std::string_view mountpoint) noexcept -> Result<void> {
+    // no array was created, nothing to scan
+    if (utils::default_runner().dry_run()) {
+        spdlog::info("[dry-run] would write the running md arrays to '{}/etc/mdadm.conf'", mountpoint);
+        return {};
+    }
+    const auto& scan_output = utils::exec("mdadm --detail --scan"sv);
+    if (scan_output.empty()) {
+        return make_error(ErrorCode::NotFound, fmt::format(FMT_COMPILE("no md arrays are running")));
+    }
+
+    const auto& conf_dir  = fmt::format(FMT_COMPILE("{}/etc"), mountpoint);
+    const auto& conf_path = fmt::format(FMT_COMPILE("{}/mdadm.conf"), conf_dir);
+    std::error_code ec;
+    fs::create_directories(conf_dir, ec);
+    if (ec) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to create '{}': {}"), conf_dir, ec.message()));
+    }
+
+    // the mdadm package ships a commented out template
+    const auto& conf = fs::exists(conf_path, ec) ? file_utils::read_whole_file(conf_path) : std::string{};
+    if (!file_utils::create_file_for_overwrite(conf_path, detail::merge_mdadm_conf(conf, scan_output))) {
+        return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("failed to write '{}'"), conf_path));
+    }
+    return {};
+}
+
+auto btrfs_raid_mkfs_command(std::string_view mkfs_command, const RaidSetup& setup) noexcept -> std::string {
+    auto cmd = fmt::format(FMT_COMPILE("{} -d {} -m {}"), mkfs_command, raid_level_to_string(setup.level), raid_level_to_string(setup.metadata_level));
+    for (const auto& device : setup.devices | std::views::drop(1)) {
+        cmd += fmt::format(FMT_COMPILE(" '{}'"), device);
+    }
+    return cmd;
+}
+
+}  // namespace gucc::raid
+
+namespace gucc::raid::detail {
+
+auto mdadm_create_cmd(const RaidSetup& setup) noexcept -> std::string {
+    // homehost=any keeps the name from being tied to the live system's hostname,
+    // the installed system would assemble it as a foreign /dev/md127 otherwise
+    auto cmd = fmt::format(FMT_COMPILE("mdadm --create '/dev/md/{}' --run --metadata=1.2 --homehost=any --level={} --raid-devices={}"),
+        setup.name, raid_level_to_string(setup.level), setup.devices.size());
+    if (setup.level != RaidLevel::Raid1 && setup.chunk_size != 0) {
+        cmd += fmt::format(FMT_COMPILE(" --chunk={}K"), setup.chunk_size / 1024);
+    }
+    for (const auto& device : setup.devices) {
+        cmd += fmt::format(FMT_COMPILE(" '{}'"), device);
+    }
+    return cmd;
+}
+
+auto merge_mdadm_conf(std::string_view conf, std::string_view scan_output) noexcept -> std::string {
+    std::string result{conf};
+    if (!result.empty() && !result.ends_with('\n')) {
+        result += '\n';
+    }
+    for (auto&& line : utils::make_split_view(scan_output)) {
+        const auto& trimmed = utils::trim(line);
+        if (!trimmed.starts_with("ARRAY "sv)) {
+            continue;
+        }
+        const auto uuid = array_uuid(trimmed);
+        if (!uuid.empty() && conf.contains(uuid)) {
+            continue;
+        }
+        result += trimmed;
+        result += '\n';
+    }
+    return result;
+}
+
+}  // namespace gucc::raid::detail
@@ -1,10 +1,11 @@
 #include "gucc/repos.hpp"
 #include "gucc/cpu.hpp"
 #include "gucc/io_utils.hpp"
+#include "gucc/keyring.hpp"
 #include "gucc/pacmanconf_repo.hpp"
 
 #include <algorithm>    // for contains
-#include <filesystem>   // for rename,copy_file
+#include <filesystem>   // for rename,copy_file,exists
 #include <ranges>       // for ranges::*
 #include <string>       // for string
 #include <string_view>  // for string_view
@@ -106,11 +107,25 @@ auto apply_cachyos_repos(std::string_view config_path) noexcept -> gucc::Result<
 namespace gucc::repos {
 
 auto install_cachyos_keyring() noexcept -> Result<void> {
-    // fetch cachyos keyring, in some cases required on the ISO
-    if (!utils::exec_checked("pacman-key --recv-keys F3B607488DB35A47 --keyserver keyserver.ubuntu.com"sv)) {
-        return make_error(ErrorCode::SubprocessFailed, "pacman-key --recv-keys failed");
+    static constexpr auto kCachyosKey = "F3B607488DB35A47"sv;
+    // the ISO ships it already populated most of the time
+    const auto& fingerprints = keyring::read_fingerprints(keyring::kHostKeyringDir);
+    if (fingerprints && keyring::has_key(*fingerprints, kCachyosKey)) {
+        spdlog::info("cachyos keyring is already in the host keyring");
+    } else if (fs::exists(fmt::format(FMT_COMPILE("{}/cachyos.gpg"), keyring::kKeyringsDir))) {
+        // populate from cachyos-keyring when it is installed, it signs the trusted keys itself
+        if (!utils::exec_checked("pacman-key --populate cachyos"sv)) {
+            return make_error(ErrorCode::SubprocessFailed, "pacman-key --populate failed");
+        }
+        return {};
+    } else {
+        // the keyserver is the last resort
+        if (!utils::exec_checked(fmt::format(FMT_COMPILE("pacman-key --recv-keys {} --keyserver keyserver.ubuntu.com"), kCachyosKey))) {
+            return make_error(ErrorCode::SubprocessFailed, "pacman-key --recv-keys failed");
+        }
     }
-    if (!utils::exec_checked("pacman-key --lsign-key F3B607488DB35A47"sv)) {
+    // a key being present doesn't make it trusted, signing it again is a local no-op
+    if (!utils::exec_checked(fmt::format(FMT_COMPILE("pacman-key --lsign-key {}"), kCachyosKey))) {
         return make_error(ErrorCode::SubprocessFailed, "failed to locally sign pacman-key");
     }
     return {};
@@ -0,0 +1,144 @@
+#include "gucc/sha256.hpp"
+
+#include <algorithm>  // for min, copy_n
+#include <bit>        // for rotr
+#include <fstream>    // for ifstream
+#include <vector>     // for vector
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+namespace {
+
+inline constexpr std::array<std::uint32_t, 64> ROUND_CONSTANTS{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+inline constexpr std::size_t READ_CHUNK = 1024 * 1024;
+
+}  // namespace
+
+namespace gucc::hash {
+
+Sha256::Sha256() noexcept
+  : m_state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19} { }
+
+void Sha256::update(std::string_view data) noexcept {
+    m_total_bytes += data.size();
+    const auto* bytes = reinterpret_cast<const std::uint8_t*>(data.data());
+    auto remaining    = data.size();
+
+    if (m_buffered != 0) {
+        const auto take = std::min(remaining, m_buffer.size() - m_buffered);
+        std::copy_n(bytes, take, m_buffer.begin() + static_cast<std::ptrdiff_t>(m_buffered));
+        m_buffered += take;
+        bytes += take;
+        remaining -= take;
+        if (m_buffered < m_buffer.size()) {
+            return;
+        }
+        compress(m_buffer.data());
+        m_buffered = 0;
+    }
+    for (; remaining >= m_buffer.size(); bytes += m_buffer.size(), remaining -= m_buffer.size()) {
+        compress(bytes);
+    }
+    std::copy_n(bytes, remaining, m_buffer.begin());
+    m_buffered = remaining;
+}
+
+auto Sha256::finish() noexcept -> std::string {
+    const auto total_bits = m_total_bytes * 8;
+
+    // 0x80, zeros up to 56 mod 64, then the big endian bit length
+    std::array<std::uint8_t, 72> padding{0x80};
+    const auto pad_len = (m_buffered < 56) ? (56 - m_buffered) : (120 - m_buffered);
+    for (std::size_t i = 0; i < 8; ++i) {
+        padding[pad_len + i] = static_cast<std::uint8_t>(total_bits >> (56 - (i * 8)));
+    }
+    update(std::string_view{reinterpret_cast<const char*>(padding.data()), pad_len + 8});
+
+    std::string digest{};
+    digest.reserve(64);
+    for (const auto word : m_state) {
+        digest += fmt::format(FMT_COMPILE("{:08x}"), word);
+    }
+    return digest;
+}
+
+void Sha256::compress(const std::uint8_t* block) noexcept {
+    std::array<std::uint32_t, 64> w{};
+    for (std::size_t i = 0; i < 16; ++i) {
+        w[i] = (static_cast<std::uint32_t>(block[i * 4]) << 24) | (static_cast<std::uint32_t>(block[(i * 4) + 1]) << 16)
+            | (static_cast<std::uint32_t>(block[(i * 4) + 2]) << 8) | static_cast<std::uint32_t>(block[(i * 4) + 3]);
+    }
+    for (std::size_t i = 16; i < 64; ++i) {
+        const auto s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const auto s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i]          = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    auto [a, b, c, d, e, f, g, h] = m_state;
+    for (std::size_t i = 0; i < 64; ++i) {
+        const auto s1    = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+        const auto ch    = (e & f) ^ (~e & g);
+        const auto temp1 = h + s1 + ch + ROUND_CONSTANTS[i] + w[i];
+        const auto s0    = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+        const auto maj   = (a & b) ^ (a & c) ^ (b & c);
+        const auto temp2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    m_state[0] += a;
+    m_state[1] += b;
+    m_state[2] += c;
+    m_state[3] += d;
+    m_state[4] += e;
+    m_state[5] += f;
+    m_state[6] += g;
+    m_state[7] += h;
+}
+
+auto sha256_hex(std::string_view data) noexcept -> std::string {
+    Sha256 hasher{};
+    hasher.update(data);
+    return hasher.finish();
+}
+
+auto sha256_file(std::string_view file_path) noexcept -> std::optional<std::string> {
+    std::ifstream file{std::string{file_path}, std::ios::binary};
+    if (!file.is_open()) {
+        return std::nullopt;
+    }
+
+    Sha256 hasher{};
+    std::vector<char> buffer(READ_CHUNK);
+    while (file) {
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        const auto read_bytes = file.gcount();
+        if (read_bytes > 0) {
+            hasher.update(std::string_view{buffer.data(), static_cast<std::size_t>(read_bytes)});
+        }
+    }
+    if (file.bad()) {
+        return std::nullopt;
+    }
+    return hasher.finish();
+}
+
+}  // namespace gucc::hash
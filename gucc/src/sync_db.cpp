@@ -0,0 +1,936 @@
+#include "gucc/sync_db.hpp"
+#include "gucc/pacmanconf_repo.hpp"
+#include "gucc/string_utils.hpp"
+#include "third_party/subprocess.h"
+
+#include <fcntl.h>     // for open, O_RDONLY, O_CLOEXEC
+#include <sys/mman.h>  // for mmap, munmap, madvise
+#include <sys/stat.h>  // for fstat
+#include <unistd.h>    // for close
+
+#include <algorithm>      // for min, max
+#include <array>          // for array
+#include <cerrno>         // for errno
+#include <cstring>        // for memcpy, strerror
+#include <iterator>       // for prev
+#include <unordered_set>  // for unordered_set
+#include <utility>        // for move, exchange, pair
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include <spdlog/spdlog.h>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+using gucc::ErrorCode;
+using gucc::make_error;
+using gucc::syncdb::DepMod;
+
+inline constexpr std::size_t TAR_BLOCK_SIZE  = 512;
+inline constexpr std::size_t POOL_BLOCK_SIZE = 64 * 1024;
+
+/// @brief Read-only private mapping of a whole file.
+class MappedFile final {
+ public:
+    MappedFile() = default;
+    ~MappedFile() {
+        if (m_data != nullptr) {
+            ::munmap(m_data, m_size);
+        }
+    }
+
+    MappedFile(const MappedFile&)                    = delete;
+    auto operator=(const MappedFile&) -> MappedFile& = delete;
+    MappedFile(MappedFile&& other) noexcept
+      : m_data(std::exchange(other.m_data, nullptr)), m_size(std::exchange(other.m_size, 0)) { }
+    auto operator=(MappedFile&&) -> MappedFile& = delete;
+
+    static auto open(const std::string& file_path) noexcept -> gucc::Result<MappedFile> {
+        const int fd = ::open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return make_error((errno == ENOENT) ? ErrorCode::NotFound : ErrorCode::FileIo, fmt::format(FMT_COMPILE("open '{}': {}"), file_path, std::strerror(errno)));
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            const int err = errno;
+            ::close(fd);
+            return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("stat '{}': {}"), file_path, std::strerror(err)));
+        }
+
+        MappedFile mapped{};
+        mapped.m_size = static_cast<std::size_t>(st.st_size);
+        if (mapped.m_size != 0) {
+            void* data = ::mmap(nullptr, mapped.m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                const int err = errno;
+                ::close(fd);
+                return make_error(ErrorCode::FileIo, fmt::format(FMT_COMPILE("mmap '{}': {}"), file_path, std::strerror(err)));
+            }
+            ::madvise(data, mapped.m_size, MADV_SEQUENTIAL);
+            mapped.m_data = data;
+        }
+        ::close(fd);
+        return mapped;
+    }
+
+    [[nodiscard]] auto view() const noexcept -> std::string_view {
+        return {static_cast<const char*>(m_data), m_size};
+    }
+
+ private:
+    void* m_data{};
+    std::size_t m_size{};
+};
+
+// repo-add compresses with whatever the packager configured
+auto decompressor_for(std::string_view head) noexcept -> const char* {
+    if (head.starts_with("\x1f\x8b"sv)) {
+        return "/usr/bin/gzip";
+    }
+    if (head.starts_with("\x28\xb5\x2f\xfd"sv)) {
+        return "/usr/bin/zstd";
+    }
+    if (head.starts_with("\xfd\x37\x7a\x58\x5a\x00"sv)) {
+        return "/usr/bin/xz";
+    }
+    if (head.starts_with("BZh"sv)) {
+        return "/usr/bin/bzip2";
+    }
+    return nullptr;
+}
+
+// gucc links no compression library, the tools are on every Arch system anyway
+auto decompress_file(const char* tool, const std::string& file_path, std::size_t size_hint) noexcept -> gucc::Result<std::string> {
+    const std::array<const char*, 5> argv{tool, "-dcq", "--", file_path.c_str(), nullptr};
+    subprocess_s process{};
+    if (subprocess_create(argv.data(), subprocess_option_enable_async, &process) != 0) {
+        return make_error(ErrorCode::SubprocessFailed, fmt::format(FMT_COMPILE("failed to spawn {}"), tool));
+    }
+
+    std::string content{};
+    content.reserve(size_hint * 4);
+    std::array<char, 64 * 1024> buf{};
+    std::uint32_t bytes_read{};
+    do {
+        bytes_read = subprocess_read_stdout(&process, buf.data(), static_cast<std::uint32_t>(buf.size()));
+        content.append(buf.data(), bytes_read);
+    } while (bytes_read != 0);
+
+    // -q leaves only the error itself, far below a pipe buffer, read once stdout is done
+    std::string errors{};
+    do {
+        bytes_read = subprocess_read_stderr(&process, buf.data(), static_cast<std::uint32_t>(buf.size()));
+        errors.append(buf.data(), bytes_read);
+    } while (bytes_read != 0);
+
+    int ret{-1};
+    if (subprocess_join(&process, &ret) != 0) {
+        ret = -1;
+    }
+    subprocess_destroy(&process);
+    if (ret != 0) {
+        return make_error(ErrorCode::SubprocessFailed, fmt::format(FMT_COMPILE("{} -dc '{}' exited with {}: {}"), tool, file_path, ret, gucc::utils::trim(errors)));
+    }
+    return content;
+}
+
+// fixed-size header fields are NUL-padded
+auto tar_field(std::string_view header, std::size_t offset, std::size_t length) noexcept -> std::string_view {
+    auto field = header.substr(offset, length);
+    return field.substr(0, std::min(field.find('\0'), field.size()));
+}
+
+auto parse_octal(std::string_view field) noexcept -> std::optional<std::uint64_t> {
+    std::uint64_t value{};
+    bool any_digit{false};
+    for (const char ch : field) {
+        if (ch >= '0' && ch <= '7') {
+            value     = (value << 3U) | static_cast<std::uint64_t>(ch - '0');
+            any_digit = true;
+        } else if (ch != ' ' && ch != '\0') {
+            return std::nullopt;
+        }
+    }
+    return any_digit ? std::make_optional(value) : std::nullopt;
+}
+
+// "<len> path=<value>\n" records of a pax extended header
+auto pax_path(std::string_view records) noexcept -> std::string_view {
+    while (!records.empty()) {
+        const auto space = records.find(' ');
+        if (space == std::string_view::npos) {
+            break;
+        }
+        const auto length = gucc::utils::parse_uint<std::size_t>(records.substr(0, space));
+        if (!length || *length <= space || *length > records.size()) {
+            break;
+        }
+        const auto record = records.substr(space + 1, *length - space - 2);
+        if (record.starts_with("path="sv)) {
+            return record.substr(5);
+        }
+        records.remove_prefix(*length);
+    }
+    return {};
+}
+
+/// Calls @p on_file with (path, content) of every regular file in the tar.
+template <class F>
+auto for_each_tar_file(std::string_view tar, F&& on_file) noexcept -> gucc::Result<void> {
+    std::string_view long_name{};
+    while (tar.size() >= TAR_BLOCK_SIZE) {
+        const auto header = tar.substr(0, TAR_BLOCK_SIZE);
+        if (header[0] == '\0') {
+            // end of archive
+            return {};
+        }
+        const auto size = parse_octal(header.substr(124, 12));
+        if (!size) {
+            return make_error(ErrorCode::ParseError, "corrupt tar header in sync db");
+        }
+        const auto padded = (*size + TAR_BLOCK_SIZE - 1) / TAR_BLOCK_SIZE * TAR_BLOCK_SIZE;
+        if (padded > tar.size() - TAR_BLOCK_SIZE) {
+            return make_error(ErrorCode::ParseError, "truncated sync db");
+        }
+        const auto data = tar.substr(TAR_BLOCK_SIZE, *size);
+        tar.remove_prefix(TAR_BLOCK_SIZE + padded);
+
+        const char type = header[156];
+        if (type == 'x') {
+            long_name = pax_path(data);
+            continue;
+        }
+        if (type == 'L') {
+            long_name = data.substr(0, std::min(data.find('\0'), data.size()));
+            continue;
+        }
+        if (type != '0' && type != '\0' && type != '7') {
+            long_name = {};
+            continue;
+        }
+
+        std::string path{};
+        if (!long_name.empty()) {
+            path = std::string{std::exchange(long_name, {})};
+        } else if (const auto prefix = tar_field(header, 345, 155); header.substr(257, 5) == "ustar"sv && !prefix.empty()) {
+            path = fmt::format(FMT_COMPILE("{}/{}"), prefix, tar_field(header, 0, 100));
+        } else {
+            path = std::string{tar_field(header, 0, 100)};
+        }
+        on_file(std::string_view{path}, data);
+    }
+    return {};
+}
+
+/// Hands the uncompressed tar of the db at @p file_path to @p on_tar.
+template <class F>
+auto with_db_tar(const std::string& file_path, F&& on_tar) noexcept -> gucc::Result<void> {
+    auto mapped = MappedFile::open(file_path);
+    if (!mapped) {
+        return std::unexpected(std::move(mapped.error()));
+    }
+    const auto content = mapped->view();
+    const auto* tool   = decompressor_for(content.substr(0, 6));
+    if (tool == nullptr) {
+        return on_tar(content);
+    }
+    auto tar = decompress_file(tool, file_path, content.size());
+    if (!tar) {
+        return std::unexpected(std::move(tar.error()));
+    }
+    return on_tar(std::string_view{*tar});
+}
+
+// ustar entry owned by root with no mtime, the db comes out the same for the same packages
+void append_tar_entry(std::string& tar, std::string_view path, char type, std::string_view content) noexcept {
+    if (path.size() >= 100) {
+        // GNU long name, the reader above knows it too
+        std::string long_name{path};
+        long_name += '\0';
+        append_tar_entry(tar, "././@LongLink"sv, 'L', long_name);
+        path = path.substr(0, 99);
+    }
+    std::string header(TAR_BLOCK_SIZE, '\0');
+    header.replace(0, path.size(), path);
+    header.replace(100, 7, (type == '5') ? "0000755"sv : "0000644"sv);
+    header.replace(108, 7, "0000000"sv);
+    header.replace(116, 7, "0000000"sv);
+    header.replace(124, 11, fmt::format(FMT_COMPILE("{:011o}"), content.size()));
+    header.replace(136, 11, "00000000000"sv);
+    header[156] = type;
+    header.replace(257, 6, "ustar\0"sv);
+    header.replace(263, 2, "00"sv);
+
+    header.replace(148, 8, "        "sv);
+    std::uint32_t checksum{};
+    for (const char ch : header) {
+        checksum += static_cast<std::uint8_t>(ch);
+    }
+    header.replace(148, 6, fmt::format(FMT_COMPILE("{:06o}"), checksum));
+    header[154] = '\0';
+
+    tar += header;
+    tar += content;
+    tar.append((TAR_BLOCK_SIZE - (content.size() % TAR_BLOCK_SIZE)) % TAR_BLOCK_SIZE, '\0');
+}
+
+/// Fields of one package dir in the db, viewing the tar content.
+struct PendingPackage final {
+    std::string_view name{};
+    std::string_view version{};
+    std::string_view filename{};
+    std::string_view sha256sum{};
+    std::uint64_t download_size{};
+    std::uint64_t install_size{};
+    std::vector<std::string_view> depends{};
+    std::vector<std::string_view> provides{};
+    std::vector<std::string_view> conflicts{};
+    std::vector<std::string_view> groups{};
+};
+
+// %NAME%\nvalue\n\n%DEPENDS%\nvalue\nvalue\n\n...
+void parse_desc(std::string_view content, PendingPackage& pkg) noexcept {
+    std::vector<std::string_view>* list{};
+    std::string_view* scalar{};
+    std::uint64_t* number{};
+    bool at_section_start{true};
+
+    while (!content.empty()) {
+        const auto eol  = content.find('\n');
+        const auto line = content.substr(0, eol);
+        content.remove_prefix((eol == std::string_view::npos) ? content.size() : eol + 1);
+
+        if (line.empty()) {
+            at_section_start = true;
+            continue;
+        }
+        if (at_section_start && line.size() > 2 && line.front() == '%' && line.back() == '%') {
+            at_section_start = false;
+            list             = nullptr;
+            scalar           = nullptr;
+            number           = nullptr;
+            if (line == "%NAME%"sv) {
+                scalar = &pkg.name;
+            } else if (line == "%VERSION%"sv) {
+                scalar = &pkg.version;
+            } else if (line == "%FILENAME%"sv) {
+                scalar = &pkg.filename;
+            } else if (line == "%SHA256SUM%"sv) {
+                scalar = &pkg.sha256sum;
+            } else if (line == "%CSIZE%"sv) {
+                number = &pkg.download_size;
+            } else if (line == "%ISIZE%"sv) {
+                number = &pkg.install_size;
+            } else if (line == "%DEPENDS%"sv) {
+                list = &pkg.depends;
+            } else if (line == "%PROVIDES%"sv) {
+                list = &pkg.provides;
+            } else if (line == "%CONFLICTS%"sv) {
+                list = &pkg.conflicts;
+            } else if (line == "%GROUPS%"sv) {
+                list = &pkg.groups;
+            }
+            continue;
+        }
+        at_section_start = false;
+        if (list != nullptr) {
+            list->push_back(line);
+        } else if (scalar != nullptr) {
+            *scalar = line;
+        } else if (number != nullptr) {
+            *number = gucc::utils::parse_uint<std::uint64_t>(line).value_or(0);
+        }
+    }
+}
+
+auto is_digit(char ch) noexcept -> bool {
+    return ch >= '0' && ch <= '9';
+}
+
+auto is_alpha(char ch) noexcept -> bool {
+    return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+}
+
+// rpmvercmp as found in libalpm, segment by segment
+auto rpmvercmp(std::string_view lhs, std::string_view rhs) noexcept -> int {
+    if (lhs == rhs) {
+        return 0;
+    }
+    std::size_t one{};
+    std::size_t two{};
+    while (one < lhs.size() && two < rhs.size()) {
+        const auto sep_one = one;
+        const auto sep_two = two;
+        while (one < lhs.size() && !is_digit(lhs[one]) && !is_alpha(lhs[one])) {
+            ++one;
+        }
+        while (two < rhs.size() && !is_digit(rhs[two]) && !is_alpha(rhs[two])) {
+            ++two;
+        }
+        if (one == lhs.size() || two == rhs.size()) {
+            break;
+        }
+        // a longer separator run sorts higher
+        if ((one - sep_one) != (two - sep_two)) {
+            return ((one - sep_one) < (two - sep_two)) ? -1 : 1;
+        }
+
+        const bool is_num  = is_digit(lhs[one]);
+        const auto in_kind = [is_num](char ch) { return is_num ? is_digit(ch) : is_alpha(ch); };
+        auto end_one       = one;
+        auto end_two       = two;
+        while (end_one < lhs.size() && in_kind(lhs[end_one])) {
+            ++end_one;
+        }
+        while (end_two < rhs.size() && in_kind(rhs[end_two])) {
+            ++end_two;
+        }
+        auto seg_one = lhs.substr(one, end_one - one);
+        auto seg_two = rhs.substr(two, end_two - two);
+        // numeric segments are newer than alpha ones
+        if (seg_two.empty()) {
+            return is_num ? 1 : -1;
+        }
+        if (is_num) {
+            seg_one.remove_prefix(std::min(seg_one.find_first_not_of('0'), seg_one.size()));
+            seg_two.remove_prefix(std::min(seg_two.find_first_not_of('0'), seg_two.size()));
+            if (seg_one.size() != seg_two.size()) {
+                return (seg_one.size() > seg_two.size()) ? 1 : -1;
+            }
+        }
+        if (const auto rc = seg_one.compare(seg_two); rc != 0) {
+            return (rc < 0) ? -1 : 1;
+        }
+        one = end_one;
+        two = end_two;
+    }
+    if (one == lhs.size() && two == rhs.size()) {
+        return 0;
+    }
+    // 1.0 < 1.0.1, but 1.0alpha < 1.0
+    if ((one == lhs.size() && !is_alpha(rhs[two])) || (one < lhs.size() && is_alpha(lhs[one]))) {
+        return -1;
+    }
+    return 1;
+}
+
+struct Evr final {
+    std::string_view epoch{"0"};
+    std::string_view version{};
+    std::optional<std::string_view> release{};
+};
+
+auto parse_evr(std::string_view evr) noexcept -> Evr {
+    Evr result{};
+    std::size_t digits{};
+    while (digits < evr.size() && is_digit(evr[digits])) {
+        ++digits;
+    }
+    if (digits < evr.size() && evr[digits] == ':') {
+        if (digits != 0) {
+            result.epoch = evr.substr(0, digits);
+        }
+        evr.remove_prefix(digits + 1);
+    }
+    if (const auto dash = evr.rfind('-'); dash != std::string_view::npos) {
+        result.release = evr.substr(dash + 1);
+        evr            = evr.substr(0, dash);
+    }
+    result.version = evr;
+    return result;
+}
+
+auto version_matches(std::string_view version, DepMod mod, std::string_view wanted) noexcept -> bool {
+    if (mod == DepMod::Any) {
+        return true;
+    }
+    const auto cmp = gucc::syncdb::vercmp(version, wanted);
+    switch (mod) {
+    case DepMod::Eq:
+        return cmp == 0;
+    case DepMod::Ge:
+        return cmp >= 0;
+    case DepMod::Le:
+        return cmp <= 0;
+    case DepMod::Gt:
+        return cmp > 0;
+    case DepMod::Lt:
+        return cmp < 0;
+    case DepMod::Any:
+        break;
+    }
+    return true;
+}
+
+auto mod_to_string(DepMod mod) noexcept -> std::string_view {
+    switch (mod) {
+    case DepMod::Eq:
+        return "="sv;
+    case DepMod::Ge:
+        return ">="sv;
+    case DepMod::Le:
+        return "<="sv;
+    case DepMod::Gt:
+        return ">"sv;
+    case DepMod::Lt:
+        return "<"sv;
+    case DepMod::Any:
+        break;
+    }
+    return ""sv;
+}
+
+/// What the resolver looks for, the version isn't necessarily interned.
+struct Wanted final {
+    std::uint32_t name{};
+    DepMod mod{DepMod::Any};
+    std::string_view version{};
+};
+
+// shared so the "no such package" paths need no special casing
+const std::vector<std::uint32_t> kNoPackages{};
+
+}  // namespace
+
+namespace gucc::syncdb {
+
+auto parse_dependency(std::string_view depstring) noexcept -> Dependency {
+    const auto op_pos = depstring.find_first_of("<>="sv);
+    if (op_pos == std::string_view::npos) {
+        return Dependency{.name = depstring};
+    }
+
+    Dependency dep{.name = depstring.substr(0, op_pos)};
+    auto op = depstring.substr(op_pos);
+    if (op.starts_with(">="sv)) {
+        dep.mod = DepMod::Ge;
+        op.remove_prefix(2);
+    } else if (op.starts_with("<="sv)) {
+        dep.mod = DepMod::Le;
+        op.remove_prefix(2);
+    } else if (op.starts_with('=')) {
+        dep.mod = DepMod::Eq;
+        op.remove_prefix(1);
+    } else if (op.starts_with('>')) {
+        dep.mod = DepMod::Gt;
+        op.remove_prefix(1);
+    } else {
+        dep.mod = DepMod::Lt;
+        op.remove_prefix(1);
+    }
+    dep.version = op;
+    return dep;
+}
+
+auto vercmp(std::string_view lhs, std::string_view rhs) noexcept -> int {
+    if (lhs == rhs) {
+        return 0;
+    }
+    const auto& lhs_evr = parse_evr(lhs);
+    const auto& rhs_evr = parse_evr(rhs);
+
+    auto ret = rpmvercmp(lhs_evr.epoch, rhs_evr.epoch);
+    if (ret == 0) {
+        ret = rpmvercmp(lhs_evr.version, rhs_evr.version);
+        // "1.0" matches any release of 1.0
+        if (ret == 0 && lhs_evr.release && rhs_evr.release) {
+            ret = rpmvercmp(*lhs_evr.release, *rhs_evr.release);
+        }
+    }
+    return ret;
+}
+
+auto SyncDatabase::load(std::string_view sync_dir, std::span<const std::string> repos) noexcept -> Result<SyncDatabase> {
+    SyncDatabase db{};
+    for (const auto& repo : repos) {
+        auto added = db.add_file(repo, fmt::format(FMT_COMPILE("{}/{}.db"), sync_dir, repo));
+        if (!added) {
+            return std::unexpected(std::move(added.error()));
+        }
+    }
+    return db;
+}
+
+auto SyncDatabase::add_file(std::string_view repo, std::string_view db_path) noexcept -> Result<void> {
+    return with_db_tar(std::string{db_path}, [this, repo](std::string_view tar) { return add_tar(repo, tar); });
+}
+
+auto SyncDatabase::add_tar(std::string_view repo, std::string_view tar_content) noexcept -> Result<void> {
+    const auto repo_id = m_strings.intern(repo);
+    m_repos.emplace_back(repo);
+
+    const auto intern_entries = [this](const std::vector<std::string_view>& values) {
+        detail::EntryRange range{.first = static_cast<std::uint32_t>(m_entries.size()), .count = static_cast<std::uint32_t>(values.size())};
+        for (const auto& value : values) {
+            const auto& dep = parse_dependency(value);
+            m_entries.emplace_back(detail::DepEntry{.name = m_strings.intern(dep.name), .version = m_strings.intern(dep.version), .mod = dep.mod});
+        }
+        return range;
+    };
+    const auto commit = [&](PendingPackage& pkg) {
+        if (pkg.name.empty()) {
+            pkg = PendingPackage{};
+            return;
+        }
+        const auto package_id = static_cast<std::uint32_t>(m_packages.size());
+        detail::PackageRecord record{
+            .repo          = repo_id,
+            .name          = m_strings.intern(pkg.name),
+            .version       = m_strings.intern(pkg.version),
+            .filename      = m_strings.intern(pkg.filename),
+            .sha256sum     = m_strings.intern(pkg.sha256sum),
+            .download_size = pkg.download_size,
+            .install_size  = pkg.install_size,
+            .depends       = intern_entries(pkg.depends),
+            .provides      = intern_entries(pkg.provides),
+            .conflicts     = intern_entries(pkg.conflicts),
+            .groups        = {.first = static_cast<std::uint32_t>(m_group_entries.size()), .count = static_cast<std::uint32_t>(pkg.groups.size())},
+        };
+        for (const auto& group : pkg.groups) {
+            const auto group_id = m_strings.intern(group);
+            m_group_entries.push_back(group_id);
+            m_groups[group_id].push_back(package_id);
+        }
+        m_by_name[record.name].push_back(package_id);
+        for (const auto& provide : entries_of(record.provides)) {
+            m_providers[provide.name].push_back(package_id);
+        }
+        m_packages.push_back(record);
+        pkg = PendingPackage{};
+    };
+
+    PendingPackage pending{};
+    std::string pending_dir{};
+    auto parsed = for_each_tar_file(tar_content, [&](std::string_view path, std::string_view data) {
+        // <name>-<version>/desc, and <name>-<version>/depends in old dbs
+        const auto slash = path.rfind('/');
+        if (slash == std::string_view::npos) {
+            return;
+        }
+        const auto file = path.substr(slash + 1);
+        if (file != "desc"sv && file != "depends"sv) {
+            return;
+        }
+        if (const auto dir = path.substr(0, slash); dir != pending_dir) {
+            commit(pending);
+            pending_dir = dir;
+        }
+        parse_desc(data, pending);
+    });
+    commit(pending);
+    if (!parsed) {
+        return parsed;
+    }
+    spdlog::debug("[syncdb] '{}': {} packages in total, {} strings", repo, m_packages.size(), m_strings.size());
+    return {};
+}
+
+auto SyncDatabase::find(std::string_view name) const noexcept -> std::optional<PackageInfo> {
+    const auto name_id = m_strings.find(name);
+    if (!name_id) {
+        return std::nullopt;
+    }
+    const auto it = m_by_name.find(*name_id);
+    if (it == m_by_name.end() || it->second.empty()) {
+        return std::nullopt;
+    }
+    return info_of(it->second.front());
+}
+
+auto SyncDatabase::resolve(std::span<const std::string> targets) const noexcept -> Resolution {
+    const auto packages_of = [](const auto& index, std::uint32_t name) noexcept -> const std::vector<std::uint32_t>& {
+        const auto it = index.find(name);
+        return (it != index.end()) ? it->second : kNoPackages;
+    };
+    const auto package_satisfies = [this](std::uint32_t package, const Wanted& wanted) noexcept {
+        const auto& record = m_packages[package];
+        if (record.name == wanted.name && version_matches(m_strings.view(record.version), wanted.mod, wanted.version)) {
+            return true;
+        }
+        for (const auto& provide : entries_of(record.provides)) {
+            if (provide.name != wanted.name) {
+                continue;
+            }
+            // an unversioned provide satisfies only unversioned deps
+            if (wanted.mod == DepMod::Any || (provide.mod == DepMod::Eq && version_matches(m_strings.view(provide.version), wanted.mod, wanted.version))) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    Resolution result{};
+    std::vector<std::uint32_t> selected{};
+    // package -> index into selected
+    std::unordered_map<std::uint32_t, std::uint32_t> position{};
+    // dependencies picked for selected[i]
+    std::vector<std::vector<std::uint32_t>> edges{};
+    const auto select = [&](std::uint32_t package) -> std::uint32_t {
+        const auto [it, inserted] = position.try_emplace(package, static_cast<std::uint32_t>(selected.size()));
+        if (inserted) {
+            selected.push_back(package);
+            edges.emplace_back();
+        }
+        return it->second;
+    };
+
+    // like pacman: something already picked, then the package by that name, then any provider
+    const auto find_satisfier = [&](const Wanted& wanted, std::optional<std::uint32_t> repo) -> std::optional<std::uint32_t> {
+        const auto& named     = packages_of(m_by_name, wanted.name);
+        const auto& providers = packages_of(m_providers, wanted.name);
+        const auto usable     = [&](std::uint32_t package) {
+            return (!repo || m_packages[package].repo == *repo) && package_satisfies(package, wanted);
+        };
+        for (const auto* candidates : {&named, &providers}) {
+            for (const auto package : *candidates) {
+                if (position.contains(package) && usable(package)) {
+                    return package;
+                }
+            }
+        }
+        for (const auto* candidates : {&named, &providers}) {
+            for (const auto package : *candidates) {
+                if (usable(package)) {
+                    return package;
+                }
+            }
+        }
+        return std::nullopt;
+    };
+
+    for (const auto& target : targets) {
+        // repo/name pins the repo
+        std::optional<std::uint32_t> repo{};
+        std::string_view target_name{target};
+        if (const auto slash = target_name.find('/'); slash != std::string_view::npos) {
+            repo        = m_strings.find(target_name.substr(0, slash));
+            target_name = target_name.substr(slash + 1);
+            if (!repo) {
+                result.missing.emplace_back(MissingDependency{.dependency = target});
+                continue;
+            }
+        }
+        const auto& dep     = parse_dependency(target_name);
+        const auto& name_id = m_strings.find(dep.name);
+        if (!name_id) {
+            result.missing.emplace_back(MissingDependency{.dependency = target});
+            continue;
+        }
+        const Wanted wanted{.name = *name_id, .mod = dep.mod, .version = dep.version};
+
+        if (!packages_of(m_by_name, *name_id).empty() || dep.mod != DepMod::Any) {
+            if (const auto package = find_satisfier(wanted, repo)) {
+                select(*package);
+                continue;
+            }
+        }
+        // a group takes each member name from the first repo carrying it
+        if (const auto& members = packages_of(m_groups, *name_id); !members.empty() && dep.mod == DepMod::Any) {
+            std::unordered_set<std::uint32_t> member_names{};
+            for (const auto member : members) {
+                if ((!repo || m_packages[member].repo == *repo) && member_names.insert(m_packages[member].name).second) {
+                    select(member);
+                }
+            }
+            if (!member_names.empty()) {
+                continue;
+            }
+        }
+        if (const auto package = find_satisfier(wanted, repo)) {
+            select(*package);
+            continue;
+        }
+        result.missing.emplace_back(MissingDependency{.dependency = target});
+    }
+
+    // breadth-first over the depends, selected grows while we walk it
+    for (std::size_t i = 0; i < selected.size(); ++i) {
+        const auto package = selected[i];
+        for (const auto& dep : entries_of(m_packages[package].depends)) {
+            const Wanted wanted{.name = dep.name, .mod = dep.mod, .version = m_strings.view(dep.version)};
+            const auto satisfier = find_satisfier(wanted, std::nullopt);
+            if (!satisfier) {
+                result.missing.emplace_back(MissingDependency{.dependency = dep_to_string(dep), .required_by = std::string{m_strings.view(m_packages[package].name)}});
+                continue;
+            }
+            const auto dep_index = select(*satisfier);
+            edges[i].push_back(dep_index);
+        }
+    }
+
+    // every package after its dependencies, cycles broken where they're entered
+    std::vector<std::uint8_t> state(selected.size(), 0);
+    std::vector<std::pair<std::uint32_t, std::size_t>> stack{};
+    result.packages.reserve(selected.size());
+    for (std::uint32_t root = 0; root < selected.size(); ++root) {
+        if (state[root] != 0) {
+            continue;
+        }
+        state[root] = 1;
+        stack.emplace_back(root, 0);
+        while (!stack.empty()) {
+            auto& [node, next_edge] = stack.back();
+            if (next_edge < edges[node].size()) {
+                const auto child = edges[node][next_edge++];
+                if (state[child] == 0) {
+                    state[child] = 1;
+                    stack.emplace_back(child, 0);
+                }
+                continue;
+            }
+            state[node] = 2;
+            const auto& info = info_of(selected[node]);
+            result.download_size += info.download_size;
+            result.install_size += info.install_size;
+            result.packages.push_back(info);
+            stack.pop_back();
+        }
+    }
+
+    // conflicts among the selected packages, each pair once
+    std::unordered_set<std::uint64_t> seen_pairs{};
+    for (const auto package : selected) {
+        for (const auto& conflict : entries_of(m_packages[package].conflicts)) {
+            const Wanted wanted{.name = conflict.name, .mod = conflict.mod, .version = m_strings.view(conflict.version)};
+            for (const auto* candidates : {&packages_of(m_by_name, conflict.name), &packages_of(m_providers, conflict.name)}) {
+                for (const auto other : *candidates) {
+                    if (other == package || !position.contains(other) || !package_satisfies(other, wanted)) {
+                        continue;
+                    }
+                    const auto key = (static_cast<std::uint64_t>(std::min(package, other)) << 32U) | std::max(package, other);
+                    if (!seen_pairs.insert(key).second) {
+                        continue;
+                    }
+                    result.conflicts.emplace_back(PackageConflict{
+                        .package        = std::string{m_strings.view(m_packages[package].name)},
+                        .conflicts_with = std::string{m_strings.view(m_packages[other].name)},
+                        .rule           = dep_to_string(conflict),
+                    });
+                }
+            }
+        }
+    }
+    return result;
+}
+
+auto SyncDatabase::info_of(std::uint32_t package) const noexcept -> PackageInfo {
+    const auto& record = m_packages[package];
+    return PackageInfo{
+        .repo          = m_strings.view(record.repo),
+        .name          = m_strings.view(record.name),
+        .version       = m_strings.view(record.version),
+        .filename      = m_strings.view(record.filename),
+        .sha256sum     = m_strings.view(record.sha256sum),
+        .download_size = record.download_size,
+        .install_size  = record.install_size,
+    };
+}
+
+auto SyncDatabase::entries_of(detail::EntryRange range) const noexcept -> std::span<const detail::DepEntry> {
+    return std::span{m_entries}.subspan(range.first, range.count);
+}
+
+auto SyncDatabase::dep_to_string(const detail::DepEntry& dep) const noexcept -> std::string {
+    return fmt::format(FMT_COMPILE("{}{}{}"), m_strings.view(dep.name), mod_to_string(dep.mod), m_strings.view(dep.version));
+}
+
+auto read_db_entries(std::string_view db_path) noexcept -> Result<std::vector<DbEntry>> {
+    std::vector<DbEntry> entries{};
+    auto read = with_db_tar(std::string{db_path}, [&entries](std::string_view tar) {
+        return for_each_tar_file(tar, [&entries](std::string_view path, std::string_view data) {
+            const auto slash = path.rfind('/');
+            if (slash == std::string_view::npos) {
+                return;
+            }
+            const auto file = path.substr(slash + 1);
+            if (file != "desc"sv && file != "depends"sv) {
+                return;
+            }
+            const auto dir = path.substr(0, slash);
+            if (entries.empty() || entries.back().dir != dir) {
+                entries.emplace_back(DbEntry{.dir = std::string{dir}});
+            }
+            // sections are separated by an empty line
+            auto& desc = entries.back().desc;
+            while (!desc.empty() && !desc.ends_with("\n\n"sv)) {
+                desc += '\n';
+            }
+            desc += data;
+        });
+    });
+    if (!read) {
+        return std::unexpected(std::move(read.error()));
+    }
+    return entries;
+}
+
+auto write_db_tar(std::span<const DbEntry> entries) noexcept -> std::string {
+    std::string tar{};
+    for (const auto& entry : entries) {
+        append_tar_entry(tar, fmt::format(FMT_COMPILE("{}/"), entry.dir), '5', {});
+        append_tar_entry(tar, fmt::format(FMT_COMPILE("{}/desc"), entry.dir), '0', entry.desc);
+    }
+    // end of archive
+    tar.append(TAR_BLOCK_SIZE * 2, '\0');
+    return tar;
+}
+
+auto repos_of_pacman_conf(std::string_view conf_path) noexcept -> std::vector<std::string> {
+    std::vector<std::string> repos{};
+    for (const auto& section : gucc::detail::pacmanconf::get_repo_list(conf_path)) {
+        const auto& name = utils::trim(section);
+        if (name.size() > 2 && name.front() == '[' && name.back() == ']') {
+            repos.emplace_back(name.substr(1, name.size() - 2));
+        }
+    }
+    return repos;
+}
+
+}  // namespace gucc::syncdb
+
+namespace gucc::syncdb::detail {
+
+StringPool::StringPool() noexcept {
+    m_strings.emplace_back(""sv);
+    m_ids.emplace(""sv, 0);
+}
+
+auto StringPool::intern(std::string_view value) noexcept -> std::uint32_t {
+    if (const auto it = m_ids.find(value); it != m_ids.end()) {
+        return it->second;
+    }
+    // long strings get a block of their own, the current one stays in use
+    char* storage{};
+    if (value.size() > POOL_BLOCK_SIZE / 4) {
+        const auto pos = m_blocks.empty() ? m_blocks.end() : std::prev(m_blocks.end());
+        storage        = m_blocks.insert(pos, std::make_unique_for_overwrite<char[]>(value.size()))->get();
+        if (m_blocks.size() == 1) {
+            // nothing left in it for the next string
+            m_block_used = POOL_BLOCK_SIZE;
+        }
+    } else {
+        if (m_blocks.empty() || m_block_used + value.size() > POOL_BLOCK_SIZE) {
+            m_blocks.emplace_back(std::make_unique_for_overwrite<char[]>(POOL_BLOCK_SIZE));
+            m_block_used = 0;
+        }
+        storage = m_blocks.back().get() + m_block_used;
+        m_block_used += value.size();
+    }
+    std::memcpy(storage, value.data(), value.size());
+
+    const auto id = static_cast<std::uint32_t>(m_strings.size());
+    const std::string_view stored{storage, value.size()};
+    m_strings.push_back(stored);
+    m_ids.emplace(stored, id);
+    return id;
+}
+
+auto StringPool::find(std::string_view value) const noexcept -> std::optional<std::uint32_t> {
+    const auto it = m_ids.find(value);
+    return (it != m_ids.end()) ? std::make_optional(it->second) : std::nullopt;
+}
+
+}  // namespace gucc::syncdb::detail
@@ -5,6 +5,7 @@
 #include "gucc/string_utils.hpp"
 
 #include <algorithm>  // for find_if, transform
+#include <array>      // for array
 #include <fstream>    // for ifstream
 #include <ranges>     // for ranges::*
 
@@ -23,8 +24,21 @@ using namespace std::string_literals;
 static constexpr auto DEV_PATH_PREFIX  = "/dev/"sv;
 static constexpr auto TRAILING_NUMBERS = "0123456789"sv;
 
+// disks whose name ends with a digit, the kernel separates partition number with 'p'
+static constexpr auto P_INFIX_DISK_PREFIXES = std::array{"nvme"sv, "mmcblk"sv, "loop"sv, "nbd"sv, "md"sv};
+
 namespace {
 
+/// Position right after the disk prefix when the device uses a 'p' infix
+constexpr auto get_p_infix_prefix_size(std::string_view device) noexcept -> std::optional<std::size_t> {
+    for (const auto& prefix : P_INFIX_DISK_PREFIXES) {
+        if (device.starts_with(prefix)) {
+            return prefix.size();
+        }
+    }
+    return std::nullopt;
+}
+
 /// Determines transport type from device path and tran field
 auto determine_transport(std::string_view device, std::string_view tran) noexcept -> gucc::disk::DiskTransport {
     using gucc::disk::DiskTransport;
@@ -141,9 +155,9 @@ auto parse_partition_number(std::string_view device) noexcept -> std::uint32_t {
         device.remove_prefix(DEV_PATH_PREFIX.size());
     }
 
-    // nvme case with partition number always after 'p'
-    if (device.starts_with("nvme"sv)) {
-        if (auto pos = device.find_first_of('p'); pos != std::string_view::npos) {
+    // nvme/mmcblk/loop case with partition number always after 'p'
+    if (const auto prefix_size = get_p_infix_prefix_size(device)) {
+        if (auto pos = device.find('p', *prefix_size); pos != std::string_view::npos) {
             return utils::parse_uint<std::uint32_t>(device.substr(pos + 1)).value_or(0);
         }
         return 0;
@@ -164,8 +178,8 @@ auto insert_partition_number(std::string_view device, std::uint32_t part_number)
         auto disk_name     = get_disk_name_from_device(device);
         return use_full_path ? fmt::format(FMT_COMPILE("/dev/{}"), disk_name) : std::string{disk_name};
     }();
-    // nvme case with partition number always after 'p'
-    if (device.contains("nvme"sv)) {
+    // nvme/mmcblk/loop case with partition number always after 'p'
+    if (get_p_infix_prefix_size(get_disk_name_from_device(device))) {
         return fmt::format(FMT_COMPILE("{}p{}"), device_path, part_number);
     }
 
@@ -178,8 +192,8 @@ auto get_disk_name_from_device(std::string_view device) noexcept -> std::string_
         device.remove_prefix(DEV_PATH_PREFIX.size());
     }
 
-    if (device.starts_with("nvme"sv)) {
-        if (auto pos = device.find_first_of('p'); pos != std::string_view::npos) {
+    if (const auto prefix_size = get_p_infix_prefix_size(device)) {
+        if (auto pos = device.find('p', *prefix_size); pos != std::string_view::npos) {
             return device.substr(0, pos);
         }
         return device;
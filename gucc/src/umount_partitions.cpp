@@ -1,42 +1,44 @@
 #include "gucc/umount_partitions.hpp"
 #include "gucc/file_utils.hpp"
 #include "gucc/io_utils.hpp"
-#include "gucc/mtab.hpp"
+#include "gucc/mount_table.hpp"
+#include "gucc/process.hpp"
 
 #include <unistd.h>  // for sync
 
-#include <algorithm>  // for sort
-#include <ranges>     // for ranges::*
+#include <string>  // for string
 
 #include <fmt/compile.h>
 #include <fmt/format.h>
 
 #include <spdlog/spdlog.h>
 
+using namespace std::string_literals;
 using namespace std::string_view_literals;
 
 namespace gucc::umount {
 
 auto umount_partitions(std::string_view root_mountpoint, const std::vector<std::string>& zfs_poolnames) noexcept -> Result<void> {
-    auto mtab_entries = mtab::parse_mtab(root_mountpoint);
-    if (!mtab_entries) {
-        return make_error(ErrorCode::ParseError, fmt::format("Failed to umount partitions: failed to parse /etc/mtab"));
+    auto mount_table = mtab::MountTable::read();
+    if (!mount_table) {
+        return make_error(mount_table.error().code, fmt::format("Failed to umount partitions: {}", mount_table.error().context));
     }
 
-    // Sort in reverse (descending) order so deepest mountpoints are unmounted first.
-    std::ranges::sort(*mtab_entries, std::ranges::greater(), &mtab::MTabEntry::mountpoint);
+    // Children come before their parents, stacked mounts on the same path included
+    const auto& mounts = mount_table->mounts_under(root_mountpoint);
 
     // Flush filesystem buffers before unmounting
     ::sync();
 
-    spdlog::debug("Got {} entries from mountpoint {}", mtab_entries->size(), root_mountpoint);
-    for (auto&& mtab_entry : std::move(*mtab_entries)) {
-        const auto& umount_cmd = fmt::format(FMT_COMPILE("umount -v {}"), mtab_entry.mountpoint);
-        if (!utils::exec_checked(umount_cmd)) {
-            spdlog::warn("Direct umount failed for {} {}, trying lazy umount", mtab_entry.device, mtab_entry.mountpoint);
-            const auto& lazy_cmd = fmt::format(FMT_COMPILE("umount -lv {}"), mtab_entry.mountpoint);
-            if (!utils::exec_checked(lazy_cmd)) {
-                return make_error(ErrorCode::SubprocessFailed, fmt::format("Failed to umount partition: {} {}", mtab_entry.device, mtab_entry.mountpoint));
+    spdlog::debug("Got {} mounts under mountpoint {}", mounts.size(), root_mountpoint);
+    auto& runner = utils::default_runner();
+    for (const auto* mount : mounts) {
+        // argv, a mountpoint may hold any character a shell would trip over
+        const std::string mountpoint{mount->mountpoint};
+        if (!runner.run({"umount"s, "-v"s, mountpoint}).ok()) {
+            spdlog::warn("Direct umount failed for {} {}, trying lazy umount", mount->source, mount->mountpoint);
+            if (!runner.run({"umount"s, "-lv"s, mountpoint}).ok()) {
+                return make_error(ErrorCode::SubprocessFailed, fmt::format("Failed to umount partition: {} {}", mount->source, mount->mountpoint));
             }
         }
     }
@@ -1,19 +1,48 @@
 #include "gucc/zfs.hpp"
+#include "gucc/zfs_topology.hpp"
 #include "gucc/io_utils.hpp"
 #include "gucc/string_utils.hpp"
 
-#include <algorithm>   // for find
+#include <algorithm>   // for find, count, stable_sort
 #include <filesystem>  // for exists, copy_file, create_directories
 #include <ranges>      // for ranges::*
 
 #include <fmt/compile.h>
 #include <fmt/format.h>
+#include <fmt/ranges.h>
 
 #include <spdlog/spdlog.h>
 
+using namespace std::string_literals;
 using namespace std::string_view_literals;
 namespace fs = std::filesystem;
 
+namespace gucc::fs::detail {
+
+auto zfs_creation_order(const std::vector<ZfsDataset>& zdatasets) noexcept -> std::vector<const ZfsDataset*> {
+    std::vector<const ZfsDataset*> ordered{};
+    ordered.reserve(zdatasets.size());
+    for (const auto& zdataset : zdatasets) {
+        ordered.push_back(&zdataset);
+    }
+
+    // a parent always has fewer components than its children
+    std::ranges::stable_sort(ordered, {}, [](const ZfsDataset* zdataset) { return std::ranges::count(zdataset->zpath, '/'); });
+    return ordered;
+}
+
+auto zfs_create_cmd(const ZfsDataset& zdataset) noexcept -> std::string {
+    // -p, a parent missing from the list is created instead of failing the child
+    auto cmd = fmt::format(FMT_COMPILE("zfs create -p -o 'mountpoint={}'"), zdataset.mountpoint);
+    for (const auto& property : zdataset.properties) {
+        cmd += fmt::format(FMT_COMPILE(" -o '{}={}'"), property.name, property.value);
+    }
+    cmd += fmt::format(FMT_COMPILE(" '{}'"), zdataset.zpath);
+    return cmd;
+}
+
+}  // namespace gucc::fs::detail
+
 namespace gucc::fs {
 
 // Creates a zfs volume
@@ -33,15 +62,52 @@ auto zfs_create_dataset(std::string_view zpath, std::string_view zmount) noexcep
 }
 
 auto zfs_create_datasets(const std::vector<ZfsDataset>& zdatasets) noexcept -> Result<void> {
-    // Create datasets
-    for (const auto& zdataset : zdatasets) {
-        if (auto res = fs::zfs_create_dataset(zdataset.zpath, zdataset.mountpoint); !res) {
-            return res;
+    for (const auto* zdataset : detail::zfs_creation_order(zdatasets)) {
+        const auto& zfs_create_cmd = detail::zfs_create_cmd(*zdataset);
+        spdlog::debug("creating zfs dataset with: {}", zfs_create_cmd);
+        if (!utils::exec_checked(zfs_create_cmd)) {
+            return make_error(ErrorCode::SubprocessFailed, fmt::format("Failed to create zfs dataset {} at mountpoint {}", zdataset->zpath, zdataset->mountpoint));
         }
     }
     return {};
 }
 
+auto zfs_role_properties(ZfsDatasetRole role) noexcept -> std::vector<ZfsProperty> {
+    switch (role) {
+    case ZfsDatasetRole::Database:
+        // matches the InnoDB page and two PostgreSQL pages,
+        // the database does its own write-ahead logging
+        return {
+            {.name = "recordsize"s, .value = "16K"s},
+            {.name = "logbias"s, .value = "throughput"s},
+            {.name = "compression"s, .value = "lz4"s},
+        };
+    case ZfsDatasetRole::VmImages:
+        // matches the default qcow2 cluster size, the guest caches its own data
+        return {
+            {.name = "recordsize"s, .value = "64K"s},
+            {.name = "primarycache"s, .value = "metadata"s},
+            {.name = "compression"s, .value = "lz4"s},
+        };
+    case ZfsDatasetRole::Logs:
+        return {
+            {.name = "recordsize"s, .value = "128K"s},
+            {.name = "logbias"s, .value = "throughput"s},
+            {.name = "compression"s, .value = "zstd"s},
+        };
+    case ZfsDatasetRole::Cache:
+        // mostly packages, which are already compressed
+        return {
+            {.name = "recordsize"s, .value = "1M"s},
+            {.name = "logbias"s, .value = "throughput"s},
+            {.name = "compression"s, .value = "lz4"s},
+        };
+    case ZfsDatasetRole::General:
+        break;
+    }
+    return {};
+}
+
 auto zfs_destroy_dataset(std::string_view zdataset) noexcept -> Result<void> {
     if (!utils::exec_checked(fmt::format(FMT_COMPILE("zfs destroy -r {}"), zdataset))) {
         return make_error(ErrorCode::SubprocessFailed, fmt::format("Failed to destroy zfs dataset {}", zdataset));
@@ -96,6 +162,32 @@ auto zpool_set_property(std::string_view property, std::string_view pool_name) n
 }
 
 auto zfs_create_zpool(std::string_view device_path, std::string_view pool_name, std::string_view pool_options, std::optional<std::string_view> passphrase) noexcept -> Result<void> {
+    const std::vector<ZfsVdev> vdevs{
+        ZfsVdev{.vdev_class = ZfsVdevClass::Data, .type = ZfsVdevType::Stripe, .devices = {std::string{device_path}}},
+    };
+    return fs::zfs_create_zpool(vdevs, pool_name, pool_options, passphrase);
+}
+
+auto zfs_create_zpool(const std::vector<ZfsVdev>& vdevs, std::string_view pool_name, std::string_view pool_options, std::optional<std::string_view> passphrase) noexcept -> Result<void> {
+    std::vector<ZfsVdevMember> members{};
+    for (const auto& vdev : vdevs) {
+        for (const auto& device : vdev.devices) {
+            auto member = fs::query_zfs_vdev_member(device);
+            if (!member) {
+                return std::unexpected(std::move(member.error()));
+            }
+            members.emplace_back(std::move(*member));
+        }
+    }
+
+    const auto& plan = fs::plan_zpool(vdevs, members);
+    if (!plan) {
+        return make_error(plan.error().code, fmt::format("Invalid layout for zfs zpool '{}': {}", pool_name, plan.error().context));
+    }
+    for (const auto& warning : plan->warnings) {
+        spdlog::warn("zpool '{}': {}", pool_name, warning);
+    }
+
     // ensure hostid exists before pool creation
     {
         std::error_code ec;
@@ -104,28 +196,20 @@ auto zfs_create_zpool(std::string_view device_path, std::string_view pool_name,
         }
     }
 
-    const auto& zfs_zpool_cmd = [&]() {
-        auto cmd = fmt::format(FMT_COMPILE("zpool create {}"), pool_options);
-        if (passphrase.has_value()) {
-            cmd += " -O encryption=aes-256-gcm -O keyformat=passphrase"sv;
-        }
-        cmd += fmt::format(FMT_COMPILE(" '{}' '{}'"), pool_name, device_path);
+    const auto& zfs_zpool_cmd = detail::zpool_create_cmd(pool_name, pool_options, vdevs, plan->ashift, passphrase.has_value());
+    spdlog::debug("creating zfs zpool with: {}", zfs_zpool_cmd);
 
-        if (passphrase.has_value()) {
-            return fmt::format(FMT_COMPILE("echo '{}' | {}"), *passphrase, cmd);
-        }
-        return cmd;
-    }();
-
-    if (!utils::exec_checked(zfs_zpool_cmd)) {
-        return make_error(ErrorCode::SubprocessFailed, fmt::format("Failed to create zfs zpool '{}' on '{}'", pool_name, device_path));
+    const auto& exec_cmd = passphrase.has_value() ? fmt::format(FMT_COMPILE("echo '{}' | {}"), *passphrase, zfs_zpool_cmd) : zfs_zpool_cmd;
+    if (!utils::exec_checked(exec_cmd)) {
+        return make_error(ErrorCode::SubprocessFailed, fmt::format("Failed to create zfs zpool '{}' on {}", pool_name, detail::zpool_vdev_args(vdevs)));
     }
     return {};
 }
 
 auto zfs_create_with_config(std::string_view device_path, const fs::ZfsSetupConfig& zfs_config) noexcept -> Result<void> {
     // first we need to create a zpool to hold the datasets/zvols
-    if (auto res = fs::zfs_create_zpool(device_path, zfs_config.zpool_name, zfs_config.zpool_options, zfs_config.passphrase); !res) {
+    const auto& vdevs = fs::zfs_merge_root_device(device_path, zfs_config.vdevs);
+    if (auto res = fs::zfs_create_zpool(vdevs, zfs_config.zpool_name, zfs_config.zpool_options, zfs_config.passphrase); !res) {
         return res;
     }
 
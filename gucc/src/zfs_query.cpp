@@ -2,7 +2,11 @@
 #include "gucc/io_utils.hpp"
 #include "gucc/string_utils.hpp"
 
-#include <charconv>  // for from_chars
+#include <unistd.h>  // for access
+
+#include <algorithm>  // for ranges::find
+#include <charconv>   // for from_chars
+#include <cstdlib>    // for getenv
 
 #include <fmt/compile.h>
 #include <fmt/format.h>
@@ -12,6 +16,58 @@
 using namespace std::string_view_literals;
 using namespace std::string_literals;
 
+namespace {
+
+// leaf devices as absolute paths (-P), with symlinks resolved (-L)
+inline constexpr auto ZPOOL_LIST_CMD  = "zpool list -v -Hp -PL -o name,size,alloc,free,frag,cap,health,altroot"sv;
+inline constexpr auto ZPOOL_PROPS_CMD = "zpool get -Hp -o name,property,value bootfs,version"sv;
+
+/// Parse percentage string from `-Hp` output
+auto parse_percentage(std::string_view pct_str) noexcept -> std::uint32_t {
+    if (pct_str.empty() || pct_str == "-"sv) {
+        return 0;
+    }
+    return gucc::utils::parse_uint<std::uint32_t>(pct_str).value_or(0);
+}
+
+/// Searches PATH for an executable, like `command -v` does
+auto is_in_path(std::string_view executable) noexcept -> bool {
+    const auto* path_env = std::getenv("PATH");
+    if (path_env == nullptr) {
+        return false;
+    }
+    for (auto&& dir : gucc::utils::make_multiline_view(path_env, false, ':')) {
+        if (dir.empty()) {
+            continue;
+        }
+        const auto& candidate = fmt::format(FMT_COMPILE("{}/{}"), dir, executable);
+        if (::access(candidate.c_str(), X_OK) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Both zpool invocations run for all pools, or just for @p pool_name
+auto query_zfs_pools(std::string_view pool_name) noexcept -> std::vector<gucc::fs::ZfsPoolInfo> {
+    const auto& pool_arg = pool_name.empty() ? std::string{} : fmt::format(FMT_COMPILE(" '{}'"), pool_name);
+
+    const auto& list_output = gucc::utils::exec(fmt::format(FMT_COMPILE("{}{} 2>/dev/null"), ZPOOL_LIST_CMD, pool_arg));
+    if (list_output.empty()) {
+        return {};
+    }
+    auto pools = gucc::fs::zfs_query::detail::parse_zpool_list(list_output);
+    if (pools.empty()) {
+        return {};
+    }
+
+    const auto& props_output = gucc::utils::exec(fmt::format(FMT_COMPILE("{}{} 2>/dev/null"), ZPOOL_PROPS_CMD, pool_arg));
+    gucc::fs::zfs_query::detail::apply_zpool_properties(props_output, pools);
+    return pools;
+}
+
+}  // namespace
+
 namespace gucc::fs::zfs_query::detail {
 
 auto parse_zfs_size(std::string_view size_str) noexcept -> std::uint64_t {
@@ -98,19 +154,68 @@ auto parse_dataset_fields(std::vector<std::string> fields) noexcept
     return std::make_optional(std::move(ds));
 }
 
-}  // namespace gucc::fs::zfs_query::detail
+auto parse_zpool_list(std::string_view output) noexcept -> std::vector<ZfsPoolInfo> {
+    std::vector<ZfsPoolInfo> pools{};
+    for (auto&& line : gucc::utils::make_multiline_view(output)) {
+        if (line.empty()) {
+            continue;
+        }
 
-namespace {
+        // e.g "\tmirror-0\t...", "\t/dev/sda1\t...", "\tlogs\t..."
+        if (line.starts_with('\t')) {
+            line.remove_prefix(1);
+            const auto& vdev_name = line.substr(0, line.find('\t'));
+            if (!pools.empty() && vdev_name.starts_with('/')) {
+                pools.back().devices.emplace_back(vdev_name);
+            }
+            continue;
+        }
 
-/// Parse percentage string from `-Hp` output
-auto parse_percentage(std::string_view pct_str) noexcept -> std::uint32_t {
-    if (pct_str.empty() || pct_str == "-"sv) {
-        return 0;
+        auto fields = split_tsv(line);
+        if (fields.size() < 7) {
+            continue;
+        }
+
+        ZfsPoolInfo pool{};
+        pool.name          = std::move(fields[0]);
+        pool.size          = parse_zfs_size(fields[1]);
+        pool.allocated     = parse_zfs_size(fields[2]);
+        pool.free          = parse_zfs_size(fields[3]);
+        pool.fragmentation = parse_percentage(fields[4]);
+        pool.capacity      = parse_percentage(fields[5]);
+        pool.health        = string_to_zfs_pool_health(fields[6]);
+
+        if (fields.size() > 7 && fields[7] != "-"sv) {
+            pool.altroot = std::move(fields[7]);
+        }
+        pools.emplace_back(std::move(pool));
     }
-    return gucc::utils::parse_uint<std::uint32_t>(pct_str).value_or(0);
+    return pools;
 }
 
-}  // namespace
+void apply_zpool_properties(std::string_view output, std::vector<ZfsPoolInfo>& pools) noexcept {
+    for (auto&& line : gucc::utils::make_multiline_view(output)) {
+        const auto& fields = split_tsv(line);
+        if (fields.size() < 3) {
+            continue;
+        }
+
+        auto pool_it = std::ranges::find(pools, fields[0], &ZfsPoolInfo::name);
+        if (pool_it == pools.end()) {
+            continue;
+        }
+
+        const auto& value = fields[2];
+        if (fields[1] == "bootfs"sv) {
+            pool_it->bootfs_set = !value.empty() && value != "-"sv;
+        } else if (fields[1] == "version"sv) {
+            // "-" on pools with feature flags
+            pool_it->version = gucc::utils::parse_uint<std::uint32_t>(value);
+        }
+    }
+}
+
+}  // namespace gucc::fs::zfs_query::detail
 
 namespace gucc::fs {
 
@@ -158,56 +263,7 @@ auto list_zfs_pools() noexcept -> std::vector<ZfsPoolInfo> {
     if (!is_zfs_available()) {
         return {};
     }
-
-    const auto& output = utils::exec(
-        R"(zpool list -Hp -o name,size,alloc,free,frag,cap,health,altroot 2>/dev/null)"sv);
-
-    if (output.empty()) {
-        return {};
-    }
-
-    std::vector<ZfsPoolInfo> pools{};
-    auto lines = utils::make_multiline(output);
-
-    for (const auto& line : lines) {
-        if (line.empty()) {
-            continue;
-        }
-
-        auto fields = zfs_detail::split_tsv(line);
-        if (fields.size() < 7) {
-            continue;
-        }
-
-        ZfsPoolInfo pool{};
-        pool.name          = std::move(fields[0]);
-        pool.size          = zfs_detail::parse_zfs_size(fields[1]);
-        pool.allocated     = zfs_detail::parse_zfs_size(fields[2]);
-        pool.free          = zfs_detail::parse_zfs_size(fields[3]);
-        pool.fragmentation = parse_percentage(fields[4]);
-        pool.capacity      = parse_percentage(fields[5]);
-        pool.health        = string_to_zfs_pool_health(fields[6]);
-
-        if (fields.size() > 7 && fields[7] != "-"sv) {
-            pool.altroot = std::move(fields[7]);
-        }
-
-        // Get devices from zpool status
-        const auto& status_output = utils::exec(
-            fmt::format(FMT_COMPILE("zpool status -PL '{}' 2>/dev/null | awk '{{print $1}}' | grep '^/'"), pool.name));
-        if (!status_output.empty()) {
-            pool.devices = utils::make_multiline(status_output);
-        }
-
-        // Check if bootfs is set
-        const auto& bootfs = utils::exec(
-            fmt::format(FMT_COMPILE("zpool get -Hp bootfs '{}' 2>/dev/null | awk '{{print $3}}'"), pool.name));
-        pool.bootfs_set = !bootfs.empty() && bootfs.find('-') == std::string::npos;
-
-        pools.emplace_back(std::move(pool));
-    }
-
-    return pools;
+    return query_zfs_pools({});
 }
 
 auto get_zfs_pool_info(std::string_view pool_name) noexcept -> std::optional<ZfsPoolInfo> {
@@ -215,7 +271,7 @@ auto get_zfs_pool_info(std::string_view pool_name) noexcept -> std::optional<Zfs
         return std::nullopt;
     }
 
-    auto pools = list_zfs_pools();
+    auto pools = query_zfs_pools(pool_name);
     auto it    = std::ranges::find(pools, pool_name, &ZfsPoolInfo::name);
     if (it != pools.end()) {
         return std::make_optional(std::move(*it));
@@ -271,8 +327,9 @@ auto get_zfs_dataset_info(std::string_view dataset_path) noexcept -> std::option
 }
 
 auto is_zfs_available() noexcept -> bool {
-    // Check if zfs command exists
-    return utils::exec_checked("command -v zfs >/dev/null 2>&1 && command -v zpool >/dev/null 2>&1");
+    // Check if zfs commands exist, the tools don't come and go while we run
+    static const bool zfs_available = is_in_path("zfs"sv) && is_in_path("zpool"sv);
+    return zfs_available;
 }
 
 }  // namespace gucc::fs
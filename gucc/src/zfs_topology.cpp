@@ -0,0 +1,326 @@
+#include "gucc/zfs_topology.hpp"
+
+#include <fcntl.h>      // for open, O_RDONLY
+#include <linux/fs.h>   // for BLKGETSIZE64, BLKPBSZGET
+#include <sys/ioctl.h>  // for ioctl
+#include <unistd.h>     // for close
+
+#include <cerrno>   // for errno
+#include <cstring>  // for strerror
+
+#include <algorithm>   // for min, max, find, any_of
+#include <bit>         // for bit_width
+#include <filesystem>  // for weakly_canonical
+#include <limits>      // for numeric_limits
+#include <optional>    // for optional
+#include <ranges>      // for ranges::*
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+namespace {
+
+// 4K sectors, even when the device reports 512, so the pool can take 4Kn replacements
+inline constexpr std::uint32_t MIN_ASHIFT = 12;
+// largest ashift zfs supports
+inline constexpr std::uint32_t MAX_ASHIFT = 16;
+// SPA_MINDEVSIZE, zpool refuses anything smaller
+inline constexpr std::uint64_t MIN_VDEV_SIZE = 64ULL * 1024 * 1024;
+// members of one vdev which differ more than that waste space
+inline constexpr std::uint64_t MAX_MEMBER_SIZE_SPREAD_PERCENT = 10;
+// metadata needs roughly 0.3% of the data, below that the special vdev fills up
+// and metadata spills over to the data vdevs
+inline constexpr std::uint64_t MIN_SPECIAL_PER_MILLE = 3;
+
+constexpr auto vdev_parity(gucc::fs::ZfsVdevType type) noexcept -> std::size_t {
+    using gucc::fs::ZfsVdevType;
+    switch (type) {
+    case ZfsVdevType::Raidz1:
+        return 1;
+    case ZfsVdevType::Raidz2:
+        return 2;
+    case ZfsVdevType::Raidz3:
+        return 3;
+    case ZfsVdevType::Stripe:
+    case ZfsVdevType::Mirror:
+        break;
+    }
+    return 0;
+}
+
+constexpr auto vdev_min_devices(gucc::fs::ZfsVdevType type) noexcept -> std::size_t {
+    if (type == gucc::fs::ZfsVdevType::Mirror) {
+        return 2;
+    }
+    return vdev_parity(type) + 1;
+}
+
+// how many member failures the vdev survives
+constexpr auto vdev_redundancy(const gucc::fs::ZfsVdev& vdev) noexcept -> std::size_t {
+    if (vdev.type == gucc::fs::ZfsVdevType::Mirror) {
+        return vdev.devices.size() - 1;
+    }
+    return vdev_parity(vdev.type);
+}
+
+// usable bytes of the vdev, members are cut down to the smallest one
+constexpr auto vdev_capacity(const gucc::fs::ZfsVdev& vdev, std::uint64_t smallest, std::uint64_t total) noexcept -> std::uint64_t {
+    using gucc::fs::ZfsVdevType;
+    switch (vdev.type) {
+    case ZfsVdevType::Stripe:
+        return total;
+    case ZfsVdevType::Mirror:
+        return smallest;
+    case ZfsVdevType::Raidz1:
+    case ZfsVdevType::Raidz2:
+    case ZfsVdevType::Raidz3:
+        break;
+    }
+    return smallest * (vdev.devices.size() - vdev_parity(vdev.type));
+}
+
+auto canonical_device(std::string_view device) noexcept -> std::string {
+    std::error_code ec;
+    auto path = fs::weakly_canonical(fs::path{device}, ec);
+    return ec ? std::string{device} : path.string();
+}
+
+}  // namespace
+
+namespace gucc::fs {
+
+auto zfs_vdev_type_to_string(ZfsVdevType type) noexcept -> std::string_view {
+    switch (type) {
+    case ZfsVdevType::Mirror:
+        return "mirror"sv;
+    case ZfsVdevType::Raidz1:
+        return "raidz1"sv;
+    case ZfsVdevType::Raidz2:
+        return "raidz2"sv;
+    case ZfsVdevType::Raidz3:
+        return "raidz3"sv;
+    case ZfsVdevType::Stripe:
+    default:
+        return "stripe"sv;
+    }
+}
+
+auto string_to_zfs_vdev_type(std::string_view type_name) noexcept -> std::optional<ZfsVdevType> {
+    if (type_name == "stripe"sv) {
+        return ZfsVdevType::Stripe;
+    } else if (type_name == "mirror"sv) {
+        return ZfsVdevType::Mirror;
+    } else if (type_name == "raidz1"sv || type_name == "raidz"sv) {
+        return ZfsVdevType::Raidz1;
+    } else if (type_name == "raidz2"sv) {
+        return ZfsVdevType::Raidz2;
+    } else if (type_name == "raidz3"sv) {
+        return ZfsVdevType::Raidz3;
+    }
+    return std::nullopt;
+}
+
+auto zfs_vdev_class_to_string(ZfsVdevClass vdev_class) noexcept -> std::string_view {
+    switch (vdev_class) {
+    case ZfsVdevClass::Special:
+        return "special"sv;
+    case ZfsVdevClass::Log:
+        return "log"sv;
+    case ZfsVdevClass::Cache:
+        return "cache"sv;
+    case ZfsVdevClass::Data:
+    default:
+        return "data"sv;
+    }
+}
+
+auto string_to_zfs_vdev_class(std::string_view class_name) noexcept -> std::optional<ZfsVdevClass> {
+    if (class_name == "data"sv) {
+        return ZfsVdevClass::Data;
+    } else if (class_name == "special"sv) {
+        return ZfsVdevClass::Special;
+    } else if (class_name == "log"sv) {
+        return ZfsVdevClass::Log;
+    } else if (class_name == "cache"sv) {
+        return ZfsVdevClass::Cache;
+    }
+    return std::nullopt;
+}
+
+auto query_zfs_vdev_member(std::string_view device) noexcept -> Result<ZfsVdevMember> {
+    const std::string device_path{device};
+    const int fd = ::open(device_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return make_error(ErrorCode::NotFound, fmt::format(FMT_COMPILE("Failed to open vdev member '{}': {}"), device, std::strerror(errno)));
+    }
+
+    ZfsVdevMember member{.device = device_path};
+    std::uint64_t size_bytes{};
+    int physical_block_size{};
+    const bool has_size       = ::ioctl(fd, BLKGETSIZE64, &size_bytes) == 0;
+    const bool has_block_size = ::ioctl(fd, BLKPBSZGET, &physical_block_size) == 0;
+    ::close(fd);
+
+    if (!has_size) {
+        return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("vdev member '{}' is not a block device"), device));
+    }
+    member.size_bytes = size_bytes;
+    if (has_block_size && physical_block_size > 0) {
+        member.physical_block_size = static_cast<std::uint32_t>(physical_block_size);
+    }
+    return member;
+}
+
+auto zfs_ashift_for_block_size(std::uint32_t physical_block_size) noexcept -> std::uint32_t {
+    if (physical_block_size == 0) {
+        return MIN_ASHIFT;
+    }
+    // round odd sizes up to the next power of two
+    const auto ashift = static_cast<std::uint32_t>(std::bit_width(physical_block_size - 1));
+    return std::clamp(ashift, MIN_ASHIFT, MAX_ASHIFT);
+}
+
+auto plan_zpool(const std::vector<ZfsVdev>& vdevs, const std::vector<ZfsVdevMember>& members) noexcept -> Result<ZpoolPlan> {
+    if (!std::ranges::any_of(vdevs, [](const ZfsVdev& vdev) { return vdev.vdev_class == ZfsVdevClass::Data; })) {
+        return make_error(ErrorCode::InvalidArgument, "zpool needs at least one data vdev"s);
+    }
+
+    ZpoolPlan plan{};
+    std::vector<std::string_view> seen_devices{};
+    std::optional<ZfsVdevType> data_type{};
+    std::size_t data_redundancy{std::numeric_limits<std::size_t>::max()};
+    std::uint64_t special_capacity{};
+    std::uint32_t max_block_size{};
+
+    for (const auto& vdev : vdevs) {
+        const auto vdev_class = zfs_vdev_class_to_string(vdev.vdev_class);
+        const auto vdev_type  = zfs_vdev_type_to_string(vdev.type);
+
+        if (vdev.devices.size() < vdev_min_devices(vdev.type)) {
+            return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("{} {} vdev needs at least {} devices, got {}"), vdev_class, vdev_type, vdev_min_devices(vdev.type), vdev.devices.size()));
+        }
+        if (vdev.vdev_class == ZfsVdevClass::Cache && vdev.type != ZfsVdevType::Stripe) {
+            return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("cache devices can't be a {}"), vdev_type));
+        }
+        if ((vdev.vdev_class == ZfsVdevClass::Special || vdev.vdev_class == ZfsVdevClass::Log) && vdev_parity(vdev.type) > 0) {
+            return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("{} vdev can't be a {}, use a mirror"), vdev_class, vdev_type));
+        }
+        if (vdev.vdev_class == ZfsVdevClass::Data) {
+            if (data_type && *data_type != vdev.type) {
+                return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("data vdevs mix {} and {}"), zfs_vdev_type_to_string(*data_type), vdev_type));
+            }
+            data_type = vdev.type;
+        }
+
+        std::uint64_t smallest{std::numeric_limits<std::uint64_t>::max()};
+        std::uint64_t largest{};
+        std::uint64_t total{};
+        for (const auto& device : vdev.devices) {
+            if (std::ranges::find(seen_devices, std::string_view{device}) != seen_devices.end()) {
+                return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("'{}' is used in more than one vdev"), device));
+            }
+            seen_devices.emplace_back(device);
+
+            const auto member = std::ranges::find(members, device, &ZfsVdevMember::device);
+            if (member == members.end()) {
+                return make_error(ErrorCode::NotFound, fmt::format(FMT_COMPILE("no size information for vdev member '{}'"), device));
+            }
+            if (member->size_bytes < MIN_VDEV_SIZE) {
+                return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("vdev member '{}' is {} bytes, zpool needs at least {}"), device, member->size_bytes, MIN_VDEV_SIZE));
+            }
+            smallest = std::min(smallest, member->size_bytes);
+            largest  = std::max(largest, member->size_bytes);
+            total += member->size_bytes;
+            max_block_size = std::max(max_block_size, member->physical_block_size);
+        }
+
+        if (vdev.type != ZfsVdevType::Stripe && (largest - smallest) * 100 > smallest * MAX_MEMBER_SIZE_SPREAD_PERCENT) {
+            plan.warnings.emplace_back(fmt::format(FMT_COMPILE("{} {} vdev members differ in size, only {} bytes of each are used"), vdev_class, vdev_type, smallest));
+        }
+
+        const auto capacity = vdev_capacity(vdev, smallest, total);
+        if (vdev.vdev_class == ZfsVdevClass::Data) {
+            plan.data_capacity += capacity;
+            data_redundancy = std::min(data_redundancy, vdev_redundancy(vdev));
+        } else if (vdev.vdev_class == ZfsVdevClass::Special) {
+            special_capacity += capacity;
+        }
+    }
+
+    // losing the special vdev loses the pool
+    for (const auto& vdev : vdevs) {
+        if (vdev.vdev_class == ZfsVdevClass::Special && vdev_redundancy(vdev) < data_redundancy) {
+            return make_error(ErrorCode::InvalidArgument, fmt::format(FMT_COMPILE("special vdev survives {} device failures, the data vdevs {}"), vdev_redundancy(vdev), data_redundancy));
+        }
+    }
+    if (special_capacity > 0 && special_capacity * 1000 < plan.data_capacity * MIN_SPECIAL_PER_MILLE) {
+        plan.warnings.emplace_back(fmt::format(FMT_COMPILE("special vdev has {} bytes for {} bytes of data, metadata will spill over to the data vdevs"), special_capacity, plan.data_capacity));
+    }
+
+    plan.ashift = zfs_ashift_for_block_size(max_block_size);
+    return plan;
+}
+
+auto zfs_merge_root_device(std::string_view root_device, std::vector<ZfsVdev> vdevs) noexcept -> std::vector<ZfsVdev> {
+    const auto& root_path = canonical_device(root_device);
+    for (const auto& vdev : vdevs) {
+        for (const auto& device : vdev.devices) {
+            if (canonical_device(device) == root_path) {
+                return vdevs;
+            }
+        }
+    }
+
+    auto data_vdev = std::ranges::find(vdevs, ZfsVdevClass::Data, &ZfsVdev::vdev_class);
+    if (data_vdev == vdevs.end()) {
+        vdevs.insert(vdevs.begin(), ZfsVdev{.vdev_class = ZfsVdevClass::Data, .type = ZfsVdevType::Stripe, .devices = {std::string{root_device}}});
+        return vdevs;
+    }
+    data_vdev->devices.insert(data_vdev->devices.begin(), std::string{root_device});
+    return vdevs;
+}
+
+}  // namespace gucc::fs
+
+namespace gucc::fs::detail {
+
+auto zpool_vdev_args(const std::vector<ZfsVdev>& vdevs) noexcept -> std::string {
+    std::string args{};
+    for (const auto vdev_class : {ZfsVdevClass::Data, ZfsVdevClass::Special, ZfsVdevClass::Log, ZfsVdevClass::Cache}) {
+        // every class keyword may only appear once, the vdevs after it belong to it
+        bool class_seen{false};
+        for (const auto& vdev : vdevs | std::views::filter([vdev_class](const ZfsVdev& vdev) { return vdev.vdev_class == vdev_class; })) {
+            if (!class_seen && vdev_class != ZfsVdevClass::Data) {
+                args += fmt::format(FMT_COMPILE(" {}"), zfs_vdev_class_to_string(vdev_class));
+            }
+            class_seen = true;
+
+            if (vdev.type != ZfsVdevType::Stripe) {
+                args += fmt::format(FMT_COMPILE(" {}"), zfs_vdev_type_to_string(vdev.type));
+            }
+            for (const auto& device : vdev.devices) {
+                args += fmt::format(FMT_COMPILE(" '{}'"), device);
+            }
+        }
+    }
+    return args;
+}
+
+auto zpool_create_cmd(std::string_view pool_name, std::string_view pool_options, const std::vector<ZfsVdev>& vdevs, std::uint32_t ashift, bool encrypted) noexcept -> std::string {
+    auto cmd = fmt::format(FMT_COMPILE("zpool create {}"), pool_options);
+    if (!pool_options.contains("ashift="sv)) {
+        cmd += fmt::format(FMT_COMPILE(" -o ashift={}"), ashift);
+    }
+    if (encrypted) {
+        cmd += " -O encryption=aes-256-gcm -O keyformat=passphrase"sv;
+    }
+    cmd += fmt::format(FMT_COMPILE(" '{}'"), pool_name);
+    cmd += zpool_vdev_args(vdevs);
+    return cmd;
+}
+
+}  // namespace gucc::fs::detail
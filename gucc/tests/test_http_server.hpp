@@ -0,0 +1,198 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace gucc::tests {
+
+/// @brief Loopback HTTP/1.1 server for GET/HEAD, honouring "Range: bytes=N-" and If-None-Match.
+///
+/// Serves either the same body for every path, or a set of files with 404 for the rest.
+/// delay holds back the headers, simulating a far away mirror. chunk_delay is slept
+/// between 16KiB chunks of the body, simulating a slow link.
+class LocalHttpServer final {
+ public:
+    using Files = std::map<std::string, std::string, std::less<>>;
+
+    explicit LocalHttpServer(std::string body, std::chrono::milliseconds delay = {}, std::chrono::milliseconds chunk_delay = {})
+      : m_body(std::move(body)), m_delay(delay), m_chunk_delay(chunk_delay) {
+        start();
+    }
+    explicit LocalHttpServer(Files files, std::chrono::milliseconds delay = {}, std::chrono::milliseconds chunk_delay = {})
+      : m_files(std::move(files)), m_delay(delay), m_chunk_delay(chunk_delay) {
+        start();
+    }
+    ~LocalHttpServer() {
+        m_accept_thread.request_stop();
+        m_accept_thread.join();
+        {
+            std::lock_guard lock{m_mutex};
+            m_connections.clear();
+        }
+        ::close(m_listen_fd);
+    }
+
+    LocalHttpServer(const LocalHttpServer&)                    = delete;
+    auto operator=(const LocalHttpServer&) -> LocalHttpServer& = delete;
+    LocalHttpServer(LocalHttpServer&&)                         = delete;
+    auto operator=(LocalHttpServer&&) -> LocalHttpServer&      = delete;
+
+    [[nodiscard]] auto port() const noexcept -> std::uint16_t { return m_port; }
+    [[nodiscard]] auto url(std::string_view path = {}) const -> std::string {
+        return std::format("http://127.0.0.1:{}{}", m_port, path);
+    }
+    /// Requests answered so far
+    [[nodiscard]] auto requests() const noexcept -> std::size_t { return m_requests.load(); }
+    /// Most requests served at the same time
+    [[nodiscard]] auto max_concurrent() const noexcept -> std::size_t { return m_max_active.load(); }
+
+ private:
+    void start() {
+        m_listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const int enable{1};
+        ::setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+        sockaddr_in addr{};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port        = 0;
+        ::bind(m_listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        ::listen(m_listen_fd, 64);
+
+        socklen_t addr_len = sizeof(addr);
+        ::getsockname(m_listen_fd, reinterpret_cast<sockaddr*>(&addr), &addr_len);
+        m_port = ntohs(addr.sin_port);
+
+        m_accept_thread = std::jthread([this](std::stop_token stop) { accept_loop(stop); });
+    }
+
+    void accept_loop(const std::stop_token& stop) {
+        while (!stop.stop_requested()) {
+            pollfd pfd{.fd = m_listen_fd, .events = POLLIN, .revents = 0};
+            if (::poll(&pfd, 1, 50) <= 0) {
+                continue;
+            }
+            const int client_fd = ::accept4(m_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client_fd < 0) {
+                continue;
+            }
+            std::lock_guard lock{m_mutex};
+            m_connections.emplace_back([this, client_fd] { serve(client_fd); });
+        }
+    }
+
+    void serve(int client_fd) {
+        std::string request{};
+        char buffer[4096];
+        while (!request.contains("\r\n\r\n")) {
+            const auto n = ::recv(client_fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) {
+                ::close(client_fd);
+                return;
+            }
+            request.append(buffer, static_cast<std::size_t>(n));
+        }
+        ++m_requests;
+        const auto active = ++m_active;
+        for (auto seen = m_max_active.load(); active > seen && !m_max_active.compare_exchange_weak(seen, active);) { }
+
+        std::this_thread::sleep_for(m_delay);
+        respond(client_fd, request);
+        --m_active;
+        ::close(client_fd);
+    }
+
+    void respond(int client_fd, std::string_view request) {
+        // "GET /path HTTP/1.1"
+        const auto path_start = request.find(' ') + 1;
+        const auto path       = request.substr(path_start, request.find(' ', path_start) - path_start);
+        const auto* body      = &m_body;
+        if (!m_files.empty()) {
+            const auto it = m_files.find(path);
+            if (it == m_files.end()) {
+                send_all(client_fd, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+                return;
+            }
+            body = &it->second;
+        }
+
+        // revalidation of a cached copy
+        const auto& etag = std::format("\"{:x}\"", std::hash<std::string_view>{}(*body));
+        if (request.contains(std::format("\r\nIf-None-Match: {}\r\n", etag))) {
+            send_all(client_fd, std::format("HTTP/1.1 304 Not Modified\r\nETag: {}\r\nConnection: close\r\n\r\n", etag));
+            return;
+        }
+
+        static constexpr std::string_view RANGE = "\r\nRange: bytes=";
+        std::size_t offset{};
+        if (const auto range_pos = request.find(RANGE); range_pos != std::string_view::npos) {
+            const auto start = range_pos + RANGE.size();
+            offset           = std::stoul(std::string{request.substr(start, request.find('-', start) - start)});
+            if (offset >= body->size()) {
+                send_all(client_fd, std::format("HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */{}\r\nContent-Length: 0\r\nConnection: close\r\n\r\n", body->size()));
+                return;
+            }
+        }
+
+        const auto payload  = std::string_view{*body}.substr(offset);
+        const auto& headers = (offset != 0)
+            ? std::format("HTTP/1.1 206 Partial Content\r\nContent-Range: bytes {}-{}/{}\r\nContent-Length: {}\r\nETag: {}\r\nConnection: close\r\n\r\n", offset, body->size() - 1, body->size(), payload.size(), etag)
+            : std::format("HTTP/1.1 200 OK\r\nContent-Length: {}\r\nETag: {}\r\nConnection: close\r\n\r\n", payload.size(), etag);
+        send_all(client_fd, headers);
+        if (request.starts_with("HEAD ")) {
+            return;
+        }
+
+        static constexpr std::size_t CHUNK = 16 * 1024;
+        for (std::size_t chunk_offset = 0; chunk_offset < payload.size(); chunk_offset += CHUNK) {
+            if (chunk_offset != 0) {
+                std::this_thread::sleep_for(m_chunk_delay);
+            }
+            if (!send_all(client_fd, payload.substr(chunk_offset, CHUNK))) {
+                return;
+            }
+        }
+    }
+
+    static auto send_all(int fd, std::string_view data) -> bool {
+        while (!data.empty()) {
+            const auto n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            data.remove_prefix(static_cast<std::size_t>(n));
+        }
+        return true;
+    }
+
+    std::string m_body;
+    Files m_files;
+    std::chrono::milliseconds m_delay;
+    std::chrono::milliseconds m_chunk_delay;
+    int m_listen_fd{-1};
+    std::uint16_t m_port{};
+    std::atomic<std::size_t> m_requests{0};
+    std::atomic<std::size_t> m_active{0};
+    std::atomic<std::size_t> m_max_active{0};
+    std::mutex m_mutex;
+    std::vector<std::jthread> m_connections;
+    std::jthread m_accept_thread;
+};
+
+}  // namespace gucc::tests
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "gucc/io_utils.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace gucc::tests {
+
+/// @brief Whether the tests needing root and real block devices can run, with @p tools installed.
+inline auto can_use_loop_devices(std::initializer_list<std::string_view> tools) -> bool {
+    if (::geteuid() != 0 || !gucc::utils::exec_checked("command -v losetup >/dev/null")) {
+        return false;
+    }
+    return std::ranges::all_of(tools, [](std::string_view tool) {
+        return gucc::utils::exec_checked(std::format("command -v {} >/dev/null", tool));
+    });
+}
+
+/// @brief Sparse images in @p dir attached as loop devices, detached on scope exit.
+class LoopDevices final {
+ public:
+    LoopDevices(const std::filesystem::path& dir, std::size_t count, std::uint64_t size = 512ULL * 1024 * 1024) {
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto& image = dir / std::format("member{}.img", i);
+            std::ofstream{image};
+            std::filesystem::resize_file(image, size);
+            auto device = gucc::utils::exec(std::format("losetup --find --show '{}'", image.string()));
+            if (!device.starts_with("/dev/loop")) {
+                break;
+            }
+            m_devices.emplace_back(std::move(device));
+        }
+    }
+    ~LoopDevices() {
+        for (const auto& device : m_devices) {
+            gucc::utils::exec(std::format("losetup -d '{}'", device));
+        }
+    }
+
+    LoopDevices(const LoopDevices&)                    = delete;
+    auto operator=(const LoopDevices&) -> LoopDevices& = delete;
+    LoopDevices(LoopDevices&&)                         = delete;
+    auto operator=(LoopDevices&&) -> LoopDevices&      = delete;
+
+    [[nodiscard]] auto devices() const noexcept -> const std::vector<std::string>& { return m_devices; }
+
+ private:
+    std::vector<std::string> m_devices{};
+};
+
+/// @brief Recursively unmounts @p mountpoint on scope exit, whatever a failed check left there.
+class ScopedUnmount final {
+ public:
+    explicit ScopedUnmount(std::string mountpoint) : m_mountpoint(std::move(mountpoint)) { }
+    ~ScopedUnmount() {
+        gucc::utils::exec(std::format("umount -R '{}' 2>/dev/null", m_mountpoint));
+    }
+
+    ScopedUnmount(const ScopedUnmount&)                    = delete;
+    auto operator=(const ScopedUnmount&) -> ScopedUnmount& = delete;
+    ScopedUnmount(ScopedUnmount&&)                         = delete;
+    auto operator=(ScopedUnmount&&) -> ScopedUnmount&      = delete;
+
+ private:
+    std::string m_mountpoint;
+};
+
+}  // namespace gucc::tests
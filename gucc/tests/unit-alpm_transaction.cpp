@@ -0,0 +1,184 @@
+#include "doctest_compatibility.h"
+
+#include "test_temp_root.hpp"
+
+#include "gucc/alpm_transaction.hpp"
+#include "gucc/file_utils.hpp"
+#include "gucc/io_utils.hpp"
+#include "gucc/local_db.hpp"
+#include "gucc/logger.hpp"
+#include "gucc/process.hpp"
+#include "gucc/sha256.hpp"
+#include "gucc/sync_db.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <spdlog/sinks/callback_sink.h>
+#include <spdlog/spdlog.h>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+using gucc::alpm::detail::parse_pacman_conf;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+static constexpr auto PKGINFO_TEST = R"(pkgname = gucc-test
+pkgbase = gucc-test
+pkgver = 1.0-1
+pkgdesc = gucc test package
+builddate = 0
+packager = gucc
+size = 6
+arch = any
+)"sv;
+
+static constexpr auto PACMAN_CONF_TEST = R"(#
+# /etc/pacman.conf
+#
+[options]
+HoldPkg     = pacman glibc
+Architecture = x86_64 x86_64_v3
+ParallelDownloads = 8
+CacheDir = /mnt/var/cache/pacman/pkg
+CacheDir = /var/cache/pacman/pkg
+SigLevel    = Required DatabaseOptional
+LocalFileSigLevel = Optional
+
+[cachyos-v3]
+Include = {0}
+
+[core]
+SigLevel = PackageRequired
+Server = https://geo.mirror.pkgbuild.com/$repo/os/$arch/
+#Server = https://disabled.example.org/$repo/os/$arch
+
+[local]
+Server = file:///srv/repo
+)"sv;
+
+}  // namespace
+
+TEST_CASE("alpm transaction test")
+{
+    auto callback_sink = std::make_shared<spdlog::sinks::callback_sink_mt>([](const spdlog::details::log_msg&) {
+        // noop
+    });
+    auto logger = std::make_shared<spdlog::logger>("default", callback_sink);
+    spdlog::set_default_logger(logger);
+    gucc::logger::set_logger(logger);
+
+    const gucc::tests::TempRoot root{"gucc-alpm"};
+    const auto& mirrorlist_path = (root.path() / "cachyos-v3-mirrorlist").string();
+    REQUIRE(gucc::file_utils::create_file_for_overwrite(mirrorlist_path, "Server = https://mirror.cachyos.org/repo/$arch_v3/$repo\n# Server = https://off.example.org/$repo\n"sv));
+
+    SECTION("options and repos")
+    {
+        const auto& [options, repos] = parse_pacman_conf(fmt::format(fmt::runtime(PACMAN_CONF_TEST), mirrorlist_path), "aarch64"sv);
+
+        const std::vector archs{"x86_64"s, "x86_64_v3"s};
+        REQUIRE_EQ(options.architectures, archs);
+        REQUIRE_EQ(options.parallel_downloads, 8);
+        const std::vector cache_dirs{"/mnt/var/cache/pacman/pkg"s, "/var/cache/pacman/pkg"s};
+        REQUIRE_EQ(options.cache_dirs, cache_dirs);
+        const std::vector sig_level{"Required"s, "DatabaseOptional"s};
+        REQUIRE_EQ(options.sig_level, sig_level);
+        REQUIRE_EQ(options.local_file_sig_level, std::vector{"Optional"s});
+        REQUIRE(options.remote_file_sig_level.empty());
+
+        REQUIRE_EQ(repos.size(), 3);
+        REQUIRE_EQ(repos[0].name, "cachyos-v3"sv);
+        REQUIRE_EQ(repos[0].servers, std::vector{"https://mirror.cachyos.org/repo/x86_64_v3/cachyos-v3"s});
+        REQUIRE(repos[0].sig_level.empty());
+
+        REQUIRE_EQ(repos[1].name, "core"sv);
+        REQUIRE_EQ(repos[1].servers, std::vector{"https://geo.mirror.pkgbuild.com/core/os/x86_64"s});
+        REQUIRE_EQ(repos[1].sig_level, std::vector{"PackageRequired"s});
+
+        REQUIRE_EQ(repos[2].name, "local"sv);
+        REQUIRE_EQ(repos[2].servers, std::vector{"file:///srv/repo"s});
+    }
+    SECTION("auto architecture")
+    {
+        const auto& [options, repos] = parse_pacman_conf("[options]\nArchitecture = auto\n\n[core]\nServer = https://example.org/$repo/os/$arch\n"sv, "aarch64"sv);
+        REQUIRE_EQ(options.architectures, std::vector{"aarch64"s});
+        REQUIRE_EQ(options.parallel_downloads, 1);
+        REQUIRE(options.cache_dirs.empty());
+        REQUIRE_EQ(repos[0].servers, std::vector{"https://example.org/core/os/aarch64"s});
+
+        // no Architecture at all means auto too
+        const auto& [defaults, _] = parse_pacman_conf("[options]\nParallelDownloads = 0\n"sv, "x86_64"sv);
+        REQUIRE_EQ(defaults.architectures, std::vector{"x86_64"s});
+        REQUIRE_EQ(defaults.parallel_downloads, 1);
+    }
+    SECTION("missing include")
+    {
+        const auto& [options, repos] = parse_pacman_conf("[extra]\nInclude = /nonexistent/mirrorlist\n"sv, "x86_64"sv);
+        REQUIRE_EQ(repos.size(), 1);
+        REQUIRE(repos[0].servers.empty());
+    }
+    SECTION("file repo transaction")
+    {
+        if (!gucc::alpm::available() || !fs::exists("/usr/bin/bsdtar")) {
+            return;
+        }
+        // a one package repo, the way repo-add would lay it out
+        const auto& pkg_root  = root.path() / "pkg";
+        const auto& repo_dir  = root.path() / "repo";
+        const auto& target    = root.path() / "target";
+        const auto& conf_path = (root.path() / "pacman.conf").string();
+        fs::create_directories(pkg_root / "usr/share/gucc-test");
+        fs::create_directories(repo_dir);
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((pkg_root / ".PKGINFO").string(), PKGINFO_TEST));
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((pkg_root / "usr/share/gucc-test/hello").string(), "hello\n"sv));
+        const auto& pkg_path = (repo_dir / "gucc-test-1.0-1-any.pkg.tar").string();
+        REQUIRE(gucc::utils::exec_checked(fmt::format("/usr/bin/bsdtar -cf '{}' -C '{}' .PKGINFO usr", pkg_path, pkg_root.string())));
+
+        const auto& pkg_content = gucc::file_utils::read_whole_file(pkg_path);
+        const std::vector entries{gucc::syncdb::DbEntry{
+            .dir  = "gucc-test-1.0-1"s,
+            .desc = fmt::format("%FILENAME%\ngucc-test-1.0-1-any.pkg.tar\n\n%NAME%\ngucc-test\n\n%VERSION%\n1.0-1\n\n%CSIZE%\n{}\n\n%ISIZE%\n6\n\n%SHA256SUM%\n{}\n\n%ARCH%\nany\n\n",
+                pkg_content.size(), gucc::hash::sha256_hex(pkg_content)),
+        }};
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((repo_dir / "gucc-test.db").string(), gucc::syncdb::write_db_tar(entries)));
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(conf_path, fmt::format("[options]\nArchitecture = auto\nSigLevel = Never\n\n[gucc-test]\nServer = file://{}\n", repo_dir.string())));
+
+        const gucc::alpm::TransactionConfig config{
+            .mountpoint            = target.string(),
+            .pacman_config         = conf_path,
+            .packages              = {"gucc-test"s},
+            .cache_dirs            = {(root.path() / "cache").string()},
+            .gpg_dir               = (root.path() / "gnupg").string(),
+            .run_hooks             = false,
+            .mount_api_filesystems = false,
+        };
+
+        // dry-run leaves the target alone, as it does with pacstrap
+        auto& runner = gucc::utils::default_runner();
+        runner.set_dry_run(true);
+        REQUIRE(gucc::alpm::install_packages(config));
+        runner.set_dry_run(false);
+        REQUIRE_FALSE(fs::exists(target / "var/lib/pacman"));
+
+        REQUIRE(gucc::alpm::install_packages(config));
+        REQUIRE_EQ(gucc::file_utils::read_whole_file((target / "usr/share/gucc-test/hello").string()), "hello\n"s);
+        REQUIRE(gucc::localdb::is_installed("gucc-test"sv, target.string()));
+
+        const gucc::alpm::TransactionConfig missing{.mountpoint = config.mountpoint, .pacman_config = conf_path, .packages = {"nope"s}, .cache_dirs = config.cache_dirs, .gpg_dir = config.gpg_dir, .run_hooks = false, .mount_api_filesystems = false};
+        REQUIRE(gucc::alpm::install_packages(missing).error().code == gucc::ErrorCode::NotFound);
+    }
+    SECTION("without libalpm")
+    {
+        if (!gucc::alpm::available()) {
+            const auto& res = gucc::alpm::install_packages({.mountpoint = root.path().string(), .pacman_config = "/etc/pacman.conf"sv, .packages = {"base"s}});
+            REQUIRE(res.error().code == gucc::ErrorCode::Unsupported);
+        }
+    }
+}
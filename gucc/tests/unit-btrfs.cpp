@@ -1,10 +1,20 @@
 #include "doctest_compatibility.h"
+#include "test_loop_devices.hpp"
+#include "test_temp_root.hpp"
 
 #include "gucc/btrfs.hpp"
+#include "gucc/io_utils.hpp"
 #include "gucc/logger.hpp"
+#include "gucc/mount_table.hpp"
+#include "gucc/process.hpp"
 
+#include <sys/mount.h>
+
+#include <filesystem>
+#include <format>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include <spdlog/sinks/callback_sink.h>
@@ -139,4 +149,190 @@ TEST_CASE("BTRFS test")
         REQUIRE_EQ(partitions.size(), 4);
         REQUIRE_EQ(partitions, expected_partitions);
     }
+    SECTION("btrfs with per subvolume mount options")
+    {
+        const std::vector<gucc::fs::BtrfsSubvolume> db_subvolumes{
+            gucc::fs::BtrfsSubvolume{.subvolume = "/@"s, .mountpoint = "/"s, .mount_opts = "defaults,relatime,compress=zstd"s},
+            gucc::fs::BtrfsSubvolume{.subvolume = "/@postgres"s, .mountpoint = "/var/lib/postgres"s, .nocow = true, .mount_opts = "defaults,noatime,nodev,nosuid"s},
+            gucc::fs::BtrfsSubvolume{.subvolume = "/@home"s, .mountpoint = "/home"s},
+        };
+        std::vector<gucc::fs::Partition> partitions{
+            gucc::fs::Partition{.fstype = "btrfs"s, .mountpoint = "/"s, .uuid_str = "6bdb3301-8efb-4b84-b0b7-4caeef26fd6f"s, .device = "/dev/nvme0n1p1"s, .mount_opts = "defaults,noatime,compress=zstd"s},
+        };
+        REQUIRE(gucc::fs::btrfs_append_subvolumes(partitions, db_subvolumes));
+        REQUIRE_EQ(partitions.size(), 3);
+        REQUIRE_EQ(partitions[0].mount_opts, "defaults,relatime,compress=zstd"sv);
+        REQUIRE_EQ(partitions[1].mount_opts, "defaults,noatime,nodev,nosuid"sv);
+        // falls back to the options of the root partition
+        REQUIRE_EQ(partitions[2].mount_opts, "defaults,noatime,compress=zstd"sv);
+    }
+}
+
+TEST_CASE("btrfs mount options test")
+{
+    using gucc::fs::BtrfsSubvolume;
+
+    SECTION("split default options")
+    {
+        const auto& params = gucc::fs::detail::split_mount_options("defaults,noatime,compress=zstd,space_cache=v2,commit=120"sv);
+        REQUIRE_EQ(params.attr_flags, MOUNT_ATTR_NOATIME);
+
+        const std::vector<std::pair<std::string, std::string>> expected_params{{"compress"s, "zstd"s}, {"space_cache"s, "v2"s}, {"commit"s, "120"s}};
+        REQUIRE_EQ(params.fs_params, expected_params);
+    }
+    SECTION("split vfs flags")
+    {
+        const auto& params = gucc::fs::detail::split_mount_options("ro,nosuid,nodev,strictatime,ssd,discard=async,noatime,rw"sv);
+        // last atime mode wins, rw clears ro
+        REQUIRE_EQ(params.attr_flags, MOUNT_ATTR_NOSUID | MOUNT_ATTR_NODEV | MOUNT_ATTR_NOATIME);
+
+        const std::vector<std::pair<std::string, std::string>> expected_params{{"ssd"s, ""s}, {"discard"s, "async"s}};
+        REQUIRE_EQ(params.fs_params, expected_params);
+    }
+    SECTION("split drops userspace options")
+    {
+        const auto& params = gucc::fs::detail::split_mount_options("nofail,x-systemd.automount,_netdev,subvol=/@home,subvolid=257,,compress=zstd:1"sv);
+        REQUIRE_EQ(params.attr_flags, 0);
+        REQUIRE_EQ(params.fs_params.size(), 1);
+        REQUIRE_EQ(params.fs_params[0].second, "zstd:1"sv);
+
+        REQUIRE(gucc::fs::detail::split_mount_options(""sv).fs_params.empty());
+    }
+    SECTION("mount order")
+    {
+        const std::vector<BtrfsSubvolume> subvolumes{
+            BtrfsSubvolume{.subvolume = "/@cache"s, .mountpoint = "/var/cache"s},
+            BtrfsSubvolume{.subvolume = "/@home"s, .mountpoint = "/home"s},
+            BtrfsSubvolume{.subvolume = "/@"s, .mountpoint = "/"s},
+            BtrfsSubvolume{.subvolume = "/@log"s, .mountpoint = "/var/log"s},
+            BtrfsSubvolume{.subvolume = "/@var"s, .mountpoint = "/var"s},
+        };
+        const auto& ordered = gucc::fs::detail::btrfs_mount_order(subvolumes);
+        REQUIRE_EQ(ordered.size(), subvolumes.size());
+        REQUIRE_EQ(ordered[0].mountpoint, "/"sv);
+        REQUIRE_EQ(ordered[1].mountpoint, "/home"sv);
+        REQUIRE_EQ(ordered[2].mountpoint, "/var"sv);
+        // same depth keeps the given order
+        REQUIRE_EQ(ordered[3].mountpoint, "/var/cache"sv);
+        REQUIRE_EQ(ordered[4].mountpoint, "/var/log"sv);
+    }
+    SECTION("subvolume path")
+    {
+        using gucc::fs::detail::btrfs_subvolume_path;
+        // as listed by the filesystem and as in the default layouts
+        REQUIRE_EQ(btrfs_subvolume_path("/tmp/gucc-btrfs.abc"sv, "@home"sv), "/tmp/gucc-btrfs.abc/@home"s);
+        REQUIRE_EQ(btrfs_subvolume_path("/tmp/gucc-btrfs.abc"sv, "/@home"sv), "/tmp/gucc-btrfs.abc/@home"s);
+        REQUIRE_EQ(btrfs_subvolume_path("/mnt/"sv, "@data/@postgres"sv), "/mnt/@data/@postgres"s);
+        REQUIRE_EQ(btrfs_subvolume_path("/mnt"sv, ""sv), "/mnt/"s);
+    }
+}
+
+TEST_CASE("btrfs subvolume policy test")
+{
+    using gucc::fs::BtrfsSubvolume;
+    using gucc::fs::BtrfsSubvolumeRole;
+
+    SECTION("roles")
+    {
+        const auto& postgres = gucc::fs::btrfs_role_subvolume("/@postgres"s, "/var/lib/postgres"s, BtrfsSubvolumeRole::Database);
+        REQUIRE_EQ(postgres.subvolume, "/@postgres"sv);
+        REQUIRE_EQ(postgres.mountpoint, "/var/lib/postgres"sv);
+        REQUIRE(postgres.nocow);
+        REQUIRE(postgres.compression.empty());
+
+        const auto& images = gucc::fs::btrfs_role_subvolume("/@libvirt-images"s, "/var/lib/libvirt/images"s, BtrfsSubvolumeRole::VmImages);
+        REQUIRE(images.nocow);
+
+        const auto& containers = gucc::fs::btrfs_role_subvolume("/@containers"s, "/var/lib/containers"s, BtrfsSubvolumeRole::Containers);
+        REQUIRE_FALSE(containers.nocow);
+        REQUIRE_EQ(containers.compression, "zstd"sv);
+
+        const auto& swap = gucc::fs::btrfs_role_subvolume("/@swap"s, "/swap"s, BtrfsSubvolumeRole::Swap);
+        REQUIRE(swap.nocow);
+        REQUIRE_EQ(swap.compression, "none"sv);
+        REQUIRE(gucc::fs::validate_btrfs_subvolume(swap));
+
+        const auto& general = gucc::fs::btrfs_role_subvolume("/@home"s, "/home"s, BtrfsSubvolumeRole::General);
+        REQUIRE_FALSE(general.nocow);
+        REQUIRE(general.compression.empty());
+        REQUIRE_FALSE(general.mount_opts.has_value());
+    }
+    SECTION("validate")
+    {
+        REQUIRE(gucc::fs::validate_btrfs_subvolume(BtrfsSubvolume{.subvolume = "/@home"s, .mountpoint = "/home"s}));
+        REQUIRE(gucc::fs::validate_btrfs_subvolume(BtrfsSubvolume{.subvolume = "/@cache"s, .mountpoint = "/var/cache"s, .compression = "lzo"s}));
+        // nocow with compression turned off explicitly
+        REQUIRE(gucc::fs::validate_btrfs_subvolume(BtrfsSubvolume{.subvolume = "/@mysql"s, .mountpoint = "/var/lib/mysql"s, .nocow = true, .compression = "none"s}));
+
+        const auto& unknown = gucc::fs::validate_btrfs_subvolume(BtrfsSubvolume{.subvolume = "/@cache"s, .mountpoint = "/var/cache"s, .compression = "zstd:3"s});
+        REQUIRE_FALSE(unknown);
+        REQUIRE_EQ(unknown.error().code, gucc::ErrorCode::InvalidArgument);
+
+        const auto& nocow_compressed = gucc::fs::validate_btrfs_subvolume(BtrfsSubvolume{.subvolume = "/@mysql"s, .mountpoint = "/var/lib/mysql"s, .nocow = true, .compression = "zstd"s});
+        REQUIRE_FALSE(nocow_compressed);
+        REQUIRE_EQ(nocow_compressed.error().code, gucc::ErrorCode::InvalidArgument);
+    }
+    SECTION("dry run")
+    {
+        const gucc::tests::TempRoot root{"gucc-btrfs"};
+        const std::vector<BtrfsSubvolume> subvols{
+            BtrfsSubvolume{.subvolume = "/@"s, .mountpoint = "/"s},
+            gucc::fs::btrfs_role_subvolume("/@data/@postgres"s, "/var/lib/postgres"s, BtrfsSubvolumeRole::Database),
+        };
+
+        // no ioctl, no mount, not even the parent directories
+        auto& runner = gucc::utils::default_runner();
+        runner.set_dry_run(true);
+        const auto& created = gucc::fs::create_btrfs_subvolumes(subvols, root.path().string());
+        const auto& mounted = gucc::fs::mount_btrfs_subvolumes(subvols, "/dev/nonexistent"sv, root.path().string(), "noatime"sv);
+        runner.set_dry_run(false);
+        REQUIRE(created.empty());
+        REQUIRE(mounted.empty());
+        REQUIRE_FALSE(std::filesystem::exists(root.path() / "@data"));
+    }
+}
+
+TEST_CASE("btrfs subvolume mount test")
+{
+    if (!gucc::tests::can_use_loop_devices({"mkfs.btrfs"sv})) {
+        MESSAGE("needs root, loop devices and btrfs-progs, skipped");
+        return;
+    }
+    using gucc::fs::BtrfsSubvolume;
+
+    const gucc::tests::TempRoot tmp{"gucc-btrfs-mount"};
+    const gucc::tests::LoopDevices loops{tmp.path(), 1};
+    REQUIRE_EQ(loops.devices().size(), 1);
+    const auto& device = loops.devices().front();
+    REQUIRE(gucc::utils::exec_checked(std::format("mkfs.btrfs -f -q '{}'", device)));
+
+    const auto& top_level = (tmp.path() / "top").string();
+    {
+        std::filesystem::create_directory(top_level);
+        const gucc::tests::ScopedUnmount top_mount{top_level};
+        REQUIRE(gucc::utils::exec_checked(std::format("mount '{}' '{}'", device, top_level)));
+        // named the way list_btrfs_subvolumes reports existing ones
+        REQUIRE(gucc::fs::btrfs_create_subvol("@home"sv, top_level));
+        REQUIRE(gucc::fs::btrfs_create_subvol("@data"sv, top_level));
+        REQUIRE(gucc::fs::btrfs_create_subvol("@data/@postgres"sv, top_level));
+    }
+
+    const auto& root_mountpoint = (tmp.path() / "root").string();
+    std::filesystem::create_directory(root_mountpoint);
+    const gucc::tests::ScopedUnmount root_mounts{root_mountpoint};
+    const std::vector<BtrfsSubvolume> subvols{
+        BtrfsSubvolume{.subvolume = "@home"s, .mountpoint = "/home"s},
+        BtrfsSubvolume{.subvolume = "/@data/@postgres"s, .mountpoint = "/var/lib/postgres"s},
+    };
+    const auto& errors = gucc::fs::mount_btrfs_subvolumes(subvols, device, root_mountpoint, "noatime"sv);
+    REQUIRE(errors.empty());
+
+    const auto& mount_table = gucc::mtab::MountTable::read();
+    REQUIRE(mount_table);
+    const auto* home = mount_table->find_by_mountpoint(root_mountpoint + "/home");
+    REQUIRE(home != nullptr);
+    REQUIRE_EQ(home->root, "/@home"sv);
+    const auto* postgres = mount_table->find_by_mountpoint(root_mountpoint + "/var/lib/postgres");
+    REQUIRE(postgres != nullptr);
+    REQUIRE_EQ(postgres->root, "/@data/@postgres"sv);
 }
@@ -2,12 +2,122 @@
 
 #include "gucc/btrfs_query.hpp"
 
+#include <endian.h>
+#include <linux/btrfs.h>
+#include <linux/btrfs_tree.h>
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
 #include <string_view>
+#include <vector>
 
+using namespace std::string_literals;
 using namespace std::string_view_literals;
 
 namespace detail = gucc::fs::btrfs_query::detail;
 
+namespace {
+
+using RootRecords = std::map<std::uint64_t, detail::BtrfsRootRecord>;
+
+void append_item(std::vector<std::uint8_t>& buffer, std::uint64_t objectid, std::uint32_t type, std::uint64_t offset, const std::vector<std::uint8_t>& data) {
+    btrfs_ioctl_search_header header{};
+    header.objectid = objectid;
+    header.type     = type;
+    header.offset   = offset;
+    header.len      = static_cast<std::uint32_t>(data.size());
+
+    const auto pos = buffer.size();
+    buffer.resize(pos + sizeof(header));
+    std::memcpy(buffer.data() + pos, &header, sizeof(header));
+    buffer.insert(buffer.end(), data.begin(), data.end());
+}
+
+// uuids are filled with a single byte, e.g 0xaa
+auto root_item_data(std::uint64_t gen, std::uint8_t uuid_byte, std::uint8_t parent_uuid_byte, std::uint64_t flags = 0) -> std::vector<std::uint8_t> {
+    btrfs_root_item root_item{};
+    root_item.generation = htole64(gen);
+    root_item.flags      = htole64(flags);
+    std::memset(root_item.uuid, uuid_byte, sizeof(root_item.uuid));
+    std::memset(root_item.parent_uuid, parent_uuid_byte, sizeof(root_item.parent_uuid));
+
+    std::vector<std::uint8_t> data(sizeof(root_item));
+    std::memcpy(data.data(), &root_item, sizeof(root_item));
+    return data;
+}
+
+auto root_backref_data(std::uint64_t dir_id, std::string_view name) -> std::vector<std::uint8_t> {
+    btrfs_root_ref root_ref{};
+    root_ref.dirid    = htole64(dir_id);
+    root_ref.name_len = htole16(static_cast<std::uint16_t>(name.size()));
+
+    std::vector<std::uint8_t> data(sizeof(root_ref));
+    std::memcpy(data.data(), &root_ref, sizeof(root_ref));
+    data.insert(data.end(), name.begin(), name.end());
+    return data;
+}
+
+// the fields `btrfs subvolume list -puq` prints
+void require_same_subvolumes(const std::vector<gucc::fs::BtrfsSubvolumeInfo>& native, const std::vector<gucc::fs::BtrfsSubvolumeInfo>& parsed) {
+    REQUIRE_EQ(native.size(), parsed.size());
+    for (std::size_t i = 0; i < native.size(); ++i) {
+        REQUIRE_EQ(native[i].id, parsed[i].id);
+        REQUIRE_EQ(native[i].gen, parsed[i].gen);
+        REQUIRE_EQ(native[i].parent_id, parsed[i].parent_id);
+        REQUIRE_EQ(native[i].top_level, parsed[i].top_level);
+        REQUIRE_EQ(native[i].path, parsed[i].path);
+        REQUIRE_EQ(native[i].uuid, parsed[i].uuid);
+        REQUIRE_EQ(native[i].parent_uuid, parsed[i].parent_uuid);
+    }
+}
+
+// default layout with a snapper snapshot of @, and @var nested in @
+static constexpr auto SUBVOLUME_LIST_TEST =
+    "ID 256 gen 14 parent 5 top level 5 parent_uuid - uuid aaaaaaaa-aaaa-aaaa-aaaa-aaaaaaaaaaaa path @\n"
+    "ID 257 gen 15 parent 5 top level 5 parent_uuid - uuid bbbbbbbb-bbbb-bbbb-bbbb-bbbbbbbbbbbb path @home\n"
+    "ID 258 gen 20 parent 256 top level 256 parent_uuid - uuid cccccccc-cccc-cccc-cccc-cccccccccccc path @/.snapshots\n"
+    "ID 259 gen 21 parent 258 top level 258 parent_uuid aaaaaaaa-aaaa-aaaa-aaaa-aaaaaaaaaaaa uuid dddddddd-dddd-dddd-dddd-dddddddddddd path @/.snapshots/1/snapshot\n"
+    "ID 261 gen 30 parent 256 top level 256 parent_uuid - uuid eeeeeeee-eeee-eeee-eeee-eeeeeeeeeeee path @/var/lib/machines\n"sv;
+
+auto subvolume_list_records() -> RootRecords {
+    std::vector<std::uint8_t> first{};
+    append_item(first, 256, BTRFS_ROOT_ITEM_KEY, 0, root_item_data(14, 0xaa, 0));
+    append_item(first, 256, BTRFS_ROOT_BACKREF_KEY, 5, root_backref_data(256, "@"sv));
+    append_item(first, 257, BTRFS_ROOT_ITEM_KEY, 0, root_item_data(15, 0xbb, 0));
+
+    // the backref of 257 ends up in the next search
+    std::vector<std::uint8_t> second{};
+    append_item(second, 257, BTRFS_ROOT_BACKREF_KEY, 5, root_backref_data(256, "@home"sv));
+    append_item(second, 258, BTRFS_ROOT_ITEM_KEY, 0, root_item_data(20, 0xcc, 0));
+    append_item(second, 258, BTRFS_ROOT_BACKREF_KEY, 256, root_backref_data(256, ".snapshots"sv));
+    append_item(second, 259, BTRFS_ROOT_ITEM_KEY, 0, root_item_data(21, 0xdd, 0xaa, BTRFS_ROOT_SUBVOL_RDONLY));
+    append_item(second, 259, BTRFS_ROOT_BACKREF_KEY, 258, root_backref_data(300, "snapshot"sv));
+    // deleted, not cleaned up yet
+    append_item(second, 260, BTRFS_ROOT_ITEM_KEY, 0, root_item_data(25, 0xee, 0));
+    append_item(second, 261, BTRFS_ROOT_ITEM_KEY, 0, root_item_data(30, 0xee, 0));
+    append_item(second, 261, BTRFS_ROOT_BACKREF_KEY, 256, root_backref_data(301, "machines"sv));
+
+    RootRecords records{};
+    const auto first_last = detail::decode_root_tree_items(first, 3, records);
+    REQUIRE(first_last.has_value());
+    REQUIRE_EQ(first_last->objectid, 257);
+    REQUIRE_EQ(first_last->type, BTRFS_ROOT_ITEM_KEY);
+
+    const auto second_last = detail::decode_root_tree_items(second, 8, records);
+    REQUIRE(second_last.has_value());
+    REQUIRE_EQ(second_last->objectid, 261);
+    REQUIRE_EQ(second_last->offset, 256);
+
+    // INO_LOOKUP results
+    records[259].dir_path = "1/"s;
+    records[261].dir_path = "var/lib/"s;
+    return records;
+}
+
+}  // namespace
+
 TEST_CASE("parse_subvolume_list")
 {
     SECTION("empty input yields empty vector")
@@ -93,3 +203,65 @@ TEST_CASE("parse_subvolume_list")
         REQUIRE_FALSE(subvols.front().parent_uuid.has_value());
     }
 }
+
+TEST_CASE("btrfs root tree decoding")
+{
+    SECTION("matches the subvolume list parser")
+    {
+        const auto& records = subvolume_list_records();
+        REQUIRE_EQ(records.size(), 6);
+        REQUIRE_FALSE(records.at(260).has_backref);
+
+        const auto& native = detail::resolve_subvolume_paths(records, ""sv);
+        const auto& parsed = detail::parse_subvolume_list(SUBVOLUME_LIST_TEST, ""sv);
+        require_same_subvolumes(native, parsed);
+
+        REQUIRE(native[3].is_readonly);
+        REQUIRE_FALSE(native[0].is_readonly);
+    }
+    SECTION("filter prefix")
+    {
+        const auto& records = subvolume_list_records();
+        require_same_subvolumes(detail::resolve_subvolume_paths(records, "@/"sv), detail::parse_subvolume_list(SUBVOLUME_LIST_TEST, "@/"sv));
+        REQUIRE(detail::resolve_subvolume_paths(records, "var"sv).empty());
+    }
+    SECTION("orphaned and truncated items")
+    {
+        std::vector<std::uint8_t> buffer{};
+        // parent 270 isn't in the tree
+        append_item(buffer, 271, BTRFS_ROOT_ITEM_KEY, 0, root_item_data(1, 0x11, 0));
+        append_item(buffer, 271, BTRFS_ROOT_BACKREF_KEY, 270, root_backref_data(256, "lost"sv));
+        append_item(buffer, 272, BTRFS_ROOT_ITEM_KEY, 0, root_item_data(2, 0x22, 0));
+
+        RootRecords records{};
+        // the kernel claims more items than the buffer holds
+        const auto last = detail::decode_root_tree_items(std::span{buffer}.first(buffer.size() - 8), 3, records);
+        REQUIRE(last.has_value());
+        REQUIRE_EQ(last->objectid, 271);
+        REQUIRE(detail::resolve_subvolume_paths(records, ""sv).empty());
+
+        REQUIRE_FALSE(detail::decode_root_tree_items({}, 0, records).has_value());
+    }
+    SECTION("space usage")
+    {
+        REQUIRE_EQ(detail::btrfs_profile_name(BTRFS_BLOCK_GROUP_DATA), "single"sv);
+        REQUIRE_EQ(detail::btrfs_profile_name(BTRFS_BLOCK_GROUP_METADATA | BTRFS_BLOCK_GROUP_DUP), "DUP"sv);
+        REQUIRE_EQ(detail::btrfs_profile_name(BTRFS_BLOCK_GROUP_DATA | BTRFS_BLOCK_GROUP_RAID1C3), "RAID1C3"sv);
+
+        constexpr std::uint64_t GIB = 1024ULL * 1024 * 1024;
+        const std::vector<detail::BtrfsSpaceUsage> spaces{
+            {.flags = BTRFS_BLOCK_GROUP_DATA, .total_bytes = 10 * GIB, .used_bytes = 6 * GIB},
+            {.flags = BTRFS_BLOCK_GROUP_SYSTEM | BTRFS_BLOCK_GROUP_DUP, .total_bytes = GIB / 4, .used_bytes = 0},
+            {.flags = BTRFS_BLOCK_GROUP_METADATA | BTRFS_BLOCK_GROUP_DUP, .total_bytes = GIB, .used_bytes = GIB / 2},
+            {.flags = BTRFS_SPACE_INFO_GLOBAL_RSV, .total_bytes = GIB / 2, .used_bytes = 0},
+        };
+        gucc::fs::BtrfsFilesystemInfo info{};
+        detail::apply_space_usage(info, spaces, 100 * GIB);
+        REQUIRE_EQ(info.data_profile, "single"sv);
+        REQUIRE_EQ(info.metadata_profile, "DUP"sv);
+        REQUIRE_EQ(info.total_size, 100 * GIB);
+        REQUIRE_EQ(info.used, 7 * GIB);
+        // 4 GiB left in data chunks, 87.5 GiB unallocated
+        REQUIRE_EQ(info.free, 4 * GIB + 100 * GIB - 10 * GIB - GIB / 2 - 2 * GIB);
+    }
+}
@@ -32,6 +32,16 @@ static constexpr auto CRYPTTAB_UNENCR_BOOT_TEST = R"(# Configuration for encrypt
 luks-6bdb3301-8efb-4b84-b0b7-4caeef26fd6f UUID=6bdb3301-8efb-4b84-b0b7-4caeef26fd6f     none
 )"sv;
 
+static constexpr auto CRYPTTAB_PERF_OPTS_TEST = R"(# Configuration for encrypted block devices
+# See crypttab(5) for details.
+
+# NOTE: Do not list your root (/) partition here, it must be set up
+#       beforehand by the initramfs (/etc/mkinitcpio.conf).
+
+# <name>       <device>                                     <password>              <options>
+luks-6bdb3301-8efb-4b84-b0b7-4caeef26fd6f UUID=6bdb3301-8efb-4b84-b0b7-4caeef26fd6f     none no-read-workqueue,no-write-workqueue
+)"sv;
+
 TEST_CASE("crypttab gen test")
 {
     auto callback_sink = std::make_shared<spdlog::sinks::callback_sink_mt>([](const spdlog::details::log_msg&) {
@@ -82,6 +92,24 @@ TEST_CASE("crypttab gen test")
         const auto& crypttab_content = gucc::fs::generate_crypttab_content(partitions, "luks"sv);
         REQUIRE_EQ(crypttab_content, CRYPTTAB_UNENCR_BOOT_TEST);
     }
+    SECTION("luks xfs with dm-crypt options")
+    {
+        const std::vector<gucc::fs::Partition> partitions{
+            gucc::fs::Partition{
+                .fstype             = "xfs"s,
+                .mountpoint         = "/"s,
+                .uuid_str           = uuid_str,
+                .device             = "/dev/nvme0n1p1"s,
+                .mount_opts         = xfs_mountopts,
+                .luks_mapper_name   = "luks-6bdb3301-8efb-4b84-b0b7-4caeef26fd6f"s,
+                .luks_uuid          = uuid_str,
+                .luks_crypttab_opts = "no-read-workqueue,no-write-workqueue"s,
+            },
+            gucc::fs::Partition{.fstype = "vfat"s, .mountpoint = "/boot"s, .uuid_str = "8EFB-4B84"s, .device = "/dev/nvme0n1p2"s, .mount_opts = "defaults,noatime"s},
+        };
+        const auto& crypttab_content = gucc::fs::generate_crypttab_content(partitions, "luks"sv);
+        REQUIRE_EQ(crypttab_content, CRYPTTAB_PERF_OPTS_TEST);
+    }
     SECTION("zfs")
     {
         const std::vector<gucc::fs::Partition> partitions{
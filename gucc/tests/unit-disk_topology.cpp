@@ -0,0 +1,122 @@
+#include "doctest_compatibility.h"
+
+#include "gucc/disk_topology.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+constexpr std::uint64_t MiB = 1024ULL * 1024ULL;
+
+// minimal identify namespace data: NLBAF, FLBAS and the LBA format list
+auto make_id_ns(std::uint8_t nlbaf, std::uint8_t flbas) -> std::array<std::uint8_t, 4096> {
+    std::array<std::uint8_t, 4096> id_ns{};
+    id_ns[25] = nlbaf;
+    id_ns[26] = flbas;
+    return id_ns;
+}
+
+void set_lbaf(std::array<std::uint8_t, 4096>& id_ns, std::size_t index, std::uint16_t metadata, std::uint8_t lbads, std::uint8_t rp) {
+    const auto offset = 128 + (index * 4);
+    id_ns[offset]     = static_cast<std::uint8_t>(metadata & 0xFF);
+    id_ns[offset + 1] = static_cast<std::uint8_t>(metadata >> 8);
+    id_ns[offset + 2] = lbads;
+    id_ns[offset + 3] = rp;
+}
+
+}  // namespace
+
+TEST_CASE("disk topology test")
+{
+    using gucc::disk::DiskTopology;
+
+    SECTION("alignment defaults to 1MiB")
+    {
+        const DiskTopology topology{};
+        REQUIRE_EQ(gucc::disk::compute_partition_alignment(topology), MiB);
+
+        const DiskTopology ssd{.logical_block_size = 512, .physical_block_size = 4096, .minimum_io_size = 4096};
+        REQUIRE_EQ(gucc::disk::compute_partition_alignment(ssd), MiB);
+    }
+    SECTION("alignment follows raid stripes")
+    {
+        // 512KiB chunk over 3 data disks
+        const DiskTopology raid5{
+            .logical_block_size  = 512,
+            .physical_block_size = 4096,
+            .minimum_io_size     = 512 * 1024,
+            .optimal_io_size     = 3 * 512 * 1024,
+            .raid_chunk_size     = 512 * 1024,
+        };
+        REQUIRE_EQ(gucc::disk::compute_partition_alignment(raid5), 3 * MiB);
+
+        const DiskTopology big_chunk{.logical_block_size = 4096, .physical_block_size = 4096, .optimal_io_size = 4 * 1024 * 1024};
+        REQUIRE_EQ(gucc::disk::compute_partition_alignment(big_chunk), 4 * MiB);
+    }
+    SECTION("bogus hints are ignored")
+    {
+        // seen on some USB bridges
+        const DiskTopology usb{.logical_block_size = 512, .physical_block_size = 512, .optimal_io_size = 33553920};
+        REQUIRE_EQ(gucc::disk::compute_partition_alignment(usb), MiB);
+
+        const DiskTopology odd{.logical_block_size = 4096, .physical_block_size = 4096, .optimal_io_size = 1000};
+        REQUIRE_EQ(gucc::disk::compute_partition_alignment(odd), MiB);
+    }
+    SECTION("512e detection")
+    {
+        REQUIRE(gucc::disk::is_512e(DiskTopology{.logical_block_size = 512, .physical_block_size = 4096}));
+        REQUIRE(!gucc::disk::is_512e(DiskTopology{.logical_block_size = 4096, .physical_block_size = 4096}));
+        REQUIRE(!gucc::disk::is_512e(DiskTopology{.logical_block_size = 512, .physical_block_size = 512}));
+
+        const auto& warnings = gucc::disk::get_topology_warnings("/dev/sda"sv, DiskTopology{.logical_block_size = 512, .physical_block_size = 4096});
+        REQUIRE_EQ(warnings.size(), 1);
+        REQUIRE(warnings[0].contains("512e"sv));
+    }
+    SECTION("nvme lba formats")
+    {
+        // lbaf0: 512 in use, lbaf1: 4096 best perf, lbaf2: 4096+8 metadata
+        auto id_ns = make_id_ns(2, 0x00);
+        set_lbaf(id_ns, 0, 0, 9, 2);
+        set_lbaf(id_ns, 1, 0, 12, 0);
+        set_lbaf(id_ns, 2, 8, 12, 0);
+
+        const auto& formats = gucc::disk::detail::parse_nvme_id_ns_lba_formats(id_ns);
+        REQUIRE_EQ(formats.size(), 3);
+        REQUIRE_EQ(formats[0].data_size, 512);
+        REQUIRE(formats[0].in_use);
+        REQUIRE_EQ(formats[1].data_size, 4096);
+        REQUIRE(!formats[1].in_use);
+        REQUIRE_EQ(formats[2].metadata_size, 8);
+
+        const DiskTopology topology{.logical_block_size = 512, .physical_block_size = 512, .nvme_lba_formats = formats};
+        const auto& native = gucc::disk::find_native_4k_lba_format(topology);
+        REQUIRE(native);
+        REQUIRE_EQ(native->index, 1);
+
+        const auto& warnings = gucc::disk::get_topology_warnings("/dev/nvme0n1"sv, topology);
+        REQUIRE_EQ(warnings.size(), 1);
+        REQUIRE(warnings[0].contains("--lbaf=1"sv));
+    }
+    SECTION("nvme already on 4Kn")
+    {
+        auto id_ns = make_id_ns(1, 0x01);
+        set_lbaf(id_ns, 0, 0, 9, 2);
+        set_lbaf(id_ns, 1, 0, 12, 0);
+
+        const auto& formats = gucc::disk::detail::parse_nvme_id_ns_lba_formats(id_ns);
+        REQUIRE_EQ(formats.size(), 2);
+        REQUIRE(formats[1].in_use);
+
+        const DiskTopology topology{.logical_block_size = 4096, .physical_block_size = 4096, .nvme_lba_formats = formats};
+        REQUIRE(gucc::disk::get_topology_warnings("/dev/nvme0n1"sv, topology).empty());
+    }
+    SECTION("truncated identify data")
+    {
+        const std::array<std::uint8_t, 64> short_id_ns{};
+        REQUIRE(gucc::disk::detail::parse_nvme_id_ns_lba_formats(short_id_ns).empty());
+    }
+}
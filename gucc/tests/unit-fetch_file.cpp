@@ -1,16 +1,27 @@
 #include "doctest_compatibility.h"
 
+#include "test_http_server.hpp"
+#include "test_temp_root.hpp"
+
 #include "gucc/fetch_file.hpp"
 #include "gucc/file_utils.hpp"
 
+#include <chrono>
 #include <filesystem>
+#include <optional>
+#include <string>
 #include <string_view>
 
 #include <fmt/format.h>
 
 namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+using namespace std::string_literals;
 using namespace std::string_view_literals;
 
+using gucc::fetch::FetchSource;
+using gucc::tests::LocalHttpServer;
+
 TEST_CASE("fetch file test")
 {
     static constexpr std::string_view LICENSE_PATH = GUCC_TOP_DIR "/LICENSE";
@@ -44,4 +55,99 @@ TEST_CASE("fetch file test")
         const auto& file_content = gucc::fetch::fetch_file_from_url(remote_url, "file:///ter-testunit");
         REQUIRE(!file_content);
     }
+    SECTION("cache meta")
+    {
+        const gucc::fetch::detail::CacheMeta meta{
+            .url           = "https://example.org/net-profiles.toml"s,
+            .etag          = "\"5f2a-1c\""s,
+            .last_modified = "Wed, 21 Oct 2026 07:28:00 GMT"s,
+            .validated_at  = 1760000000,
+        };
+        const auto& parsed = gucc::fetch::detail::parse_cache_meta(gucc::fetch::detail::render_cache_meta(meta));
+        REQUIRE(parsed);
+        REQUIRE_EQ(parsed->url, meta.url);
+        REQUIRE_EQ(parsed->etag, meta.etag);
+        REQUIRE_EQ(parsed->last_modified, meta.last_modified);
+        REQUIRE_EQ(parsed->validated_at, meta.validated_at);
+        REQUIRE_FALSE(gucc::fetch::detail::parse_cache_meta("etag = x\n"sv));
+
+        REQUIRE_EQ(gucc::fetch::detail::cache_key(meta.url).size(), 32);
+        REQUIRE(gucc::fetch::detail::cache_key(meta.url) != gucc::fetch::detail::cache_key("https://example.org/server-profiles.toml"sv));
+    }
+    SECTION("hedged fetch, slow primary")
+    {
+        const gucc::tests::TempRoot root{"gucc-fetch-hedged"};
+        const auto& fallback_path = (root.path() / "net-profiles.toml").string();
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(fallback_path, "vendored"sv));
+        const LocalHttpServer slow{"upstream"s, 600ms};
+
+        const auto start    = std::chrono::steady_clock::now();
+        const auto& fetched = gucc::fetch::fetch_file_hedged(slow.url("/net-profiles.toml"), fmt::format("file://{}", fallback_path),
+            {.hedge_delay = 50ms, .cache_dir = (root.path() / "cache").string()});
+        REQUIRE(fetched);
+        REQUIRE_EQ(fetched->content, "vendored");
+        REQUIRE_EQ(fetched->source, FetchSource::Fallback);
+        REQUIRE(fetched->age < 60s);
+        // the fallback didn't wait on the primary
+        REQUIRE(std::chrono::steady_clock::now() - start < 3s);
+    }
+    SECTION("hedged fetch, fast primary")
+    {
+        const gucc::tests::TempRoot root{"gucc-fetch-fast"};
+        const LocalHttpServer primary{"upstream"s};
+        const LocalHttpServer fallback{"mirror"s};
+
+        const auto& fetched = gucc::fetch::fetch_file_hedged(primary.url("/net-profiles.toml"), fallback.url("/net-profiles.toml"),
+            {.hedge_delay = 2000ms, .cache_dir = (root.path() / "cache").string()});
+        REQUIRE(fetched);
+        REQUIRE_EQ(fetched->content, "upstream");
+        REQUIRE_EQ(fetched->source, FetchSource::Primary);
+        REQUIRE_EQ(fallback.requests(), 0);
+    }
+    SECTION("hedged fetch, failed primary")
+    {
+        const gucc::tests::TempRoot root{"gucc-fetch-failed"};
+        const LocalHttpServer fallback{"mirror"s};
+
+        // nothing listens on the discard port, the fallback starts right away
+        const auto start    = std::chrono::steady_clock::now();
+        const auto& fetched = gucc::fetch::fetch_file_hedged("http://127.0.0.1:9/net-profiles.toml"sv, fallback.url("/net-profiles.toml"),
+            {.hedge_delay = 10000ms, .cache_dir = (root.path() / "cache").string()});
+        REQUIRE(fetched);
+        REQUIRE_EQ(fetched->content, "mirror");
+        REQUIRE_EQ(fetched->source, FetchSource::Fallback);
+        REQUIRE(std::chrono::steady_clock::now() - start < 5s);
+    }
+    SECTION("revalidated and stale cache")
+    {
+        const gucc::tests::TempRoot root{"gucc-fetch-cache"};
+        const gucc::fetch::FetchOptions options{.hedge_delay = 50ms, .cache_dir = (root.path() / "cache").string()};
+
+        std::string url{};
+        {
+            const LocalHttpServer primary{"upstream"s};
+            url = primary.url("/server-profiles.toml");
+
+            const auto& first = gucc::fetch::fetch_file_hedged(url, {}, options);
+            REQUIRE(first);
+            REQUIRE_EQ(first->source, FetchSource::Primary);
+
+            // If-None-Match answered with 304
+            const auto& second = gucc::fetch::fetch_file_hedged(url, {}, options);
+            REQUIRE(second);
+            REQUIRE_EQ(second->source, FetchSource::Revalidated);
+            REQUIRE_EQ(second->content, "upstream");
+            REQUIRE_EQ(second->age, 0s);
+            REQUIRE_EQ(primary.requests(), 2);
+        }
+
+        // the server is gone, the last copy is still there
+        const auto& stale = gucc::fetch::fetch_file_hedged(url, "file:///ter-testunit"sv, options);
+        REQUIRE(stale);
+        REQUIRE_EQ(stale->source, FetchSource::Stale);
+        REQUIRE_EQ(stale->content, "upstream");
+
+        // without a cache there is nothing to fall back on
+        REQUIRE_FALSE(gucc::fetch::fetch_file_hedged(url, "file:///ter-testunit"sv, {.hedge_delay = 50ms, .cache_dir = {}}));
+    }
 }
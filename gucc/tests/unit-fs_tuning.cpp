@@ -0,0 +1,117 @@
+#include "doctest_compatibility.h"
+
+#include "gucc/fs_tuning.hpp"
+
+#include <cstdint>
+#include <string_view>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+constexpr std::uint64_t GiB = 1024ULL * 1024ULL * 1024ULL;
+
+}  // namespace
+
+TEST_CASE("fs tuning test")
+{
+    using gucc::disk::DiskTopology;
+    using gucc::disk::DiskTransport;
+    using gucc::fs::DeviceClass;
+    using gucc::fs::DeviceProfile;
+    using gucc::fs::FilesystemType;
+
+    SECTION("device classification")
+    {
+        REQUIRE_EQ(gucc::fs::classify_device(DeviceProfile{.transport = DiskTransport::Nvme, .is_rotational = false}), DeviceClass::Nvme);
+        REQUIRE_EQ(gucc::fs::classify_device(DeviceProfile{.transport = DiskTransport::Sata, .is_rotational = false}), DeviceClass::Ssd);
+        REQUIRE_EQ(gucc::fs::classify_device(DeviceProfile{.transport = DiskTransport::Sata, .is_rotational = true}), DeviceClass::Hdd);
+        REQUIRE_EQ(gucc::fs::classify_device(DeviceProfile{.transport = DiskTransport::Scsi, .is_rotational = true}), DeviceClass::Hdd);
+        REQUIRE_EQ(gucc::fs::classify_device(DeviceProfile{.transport = DiskTransport::Usb, .is_rotational = false}), DeviceClass::Removable);
+        REQUIRE_EQ(gucc::fs::classify_device(DeviceProfile{.transport = DiskTransport::Sata, .is_removable = true}), DeviceClass::Removable);
+        REQUIRE_EQ(gucc::fs::classify_device(DeviceProfile{.transport = DiskTransport::Virtio}), DeviceClass::Virtual);
+        REQUIRE_EQ(gucc::fs::classify_device(DeviceProfile{}), DeviceClass::Generic);
+    }
+    SECTION("device class names")
+    {
+        for (const auto device_class : {DeviceClass::Nvme, DeviceClass::Ssd, DeviceClass::Hdd, DeviceClass::Removable, DeviceClass::Virtual, DeviceClass::Generic}) {
+            REQUIRE_EQ(gucc::fs::string_to_device_class(gucc::fs::device_class_to_string(device_class)), device_class);
+        }
+        REQUIRE(!gucc::fs::string_to_device_class("floppy"sv));
+    }
+    SECTION("generic keeps the static defaults")
+    {
+        const DeviceProfile ssd{.is_rotational = false};
+        for (const auto fs_type : {FilesystemType::Btrfs, FilesystemType::Ext4, FilesystemType::F2fs, FilesystemType::Xfs, FilesystemType::Vfat}) {
+            const auto& tuning = gucc::fs::get_fs_tuning(fs_type, DeviceClass::Generic, ssd);
+            REQUIRE_EQ(tuning.mkfs_command, gucc::fs::get_mkfs_command(fs_type));
+            REQUIRE_EQ(tuning.mount_opts, gucc::fs::get_default_mount_opts(fs_type, true));
+        }
+    }
+    SECTION("btrfs")
+    {
+        const DeviceProfile nvme{.transport = DiskTransport::Nvme, .is_rotational = false, .size_bytes = 1024 * GiB};
+        const auto& nvme_tuning = gucc::fs::get_fs_tuning(FilesystemType::Btrfs, DeviceClass::Nvme, nvme);
+        REQUIRE_EQ(nvme_tuning.mkfs_command, "mkfs.btrfs -f --csum xxhash"sv);
+        REQUIRE_EQ(nvme_tuning.mount_opts, "defaults,noatime,compress=zstd:1,discard=async"sv);
+
+        // GRUB reads /boot from it
+        const auto& boot_tuning = gucc::fs::get_fs_tuning(FilesystemType::Btrfs, DeviceClass::Nvme, nvme, true);
+        REQUIRE_EQ(boot_tuning.mkfs_command, "mkfs.btrfs -f"sv);
+
+        const DeviceProfile hdd{.transport = DiskTransport::Sata, .size_bytes = 4096 * GiB};
+        const auto& hdd_tuning = gucc::fs::get_fs_tuning(FilesystemType::Btrfs, DeviceClass::Hdd, hdd);
+        REQUIRE_EQ(hdd_tuning.mkfs_command, "mkfs.btrfs -f --nodesize 32k"sv);
+        REQUIRE_EQ(hdd_tuning.mount_opts, "defaults,noatime,compress=zstd:3"sv);
+
+        const auto& usb_tuning = gucc::fs::get_fs_tuning(FilesystemType::Btrfs, DeviceClass::Removable, DeviceProfile{});
+        REQUIRE_EQ(usb_tuning.mount_opts, "defaults,noatime,lazytime,compress=zstd:3,commit=60"sv);
+    }
+    SECTION("ext4")
+    {
+        const DeviceProfile small_ssd{.transport = DiskTransport::Sata, .is_rotational = false, .size_bytes = 128 * GiB};
+        const auto& ssd_tuning = gucc::fs::get_fs_tuning(FilesystemType::Ext4, DeviceClass::Ssd, small_ssd);
+        REQUIRE_EQ(ssd_tuning.mkfs_command, "mkfs.ext4 -q -E lazy_itable_init=0,lazy_journal_init=0"sv);
+        REQUIRE_EQ(ssd_tuning.mount_opts, "defaults,noatime,lazytime"sv);
+
+        // zeroing the inode tables of a big disk is left to ext4lazyinit
+        const DeviceProfile big_ssd{.transport = DiskTransport::Sata, .is_rotational = false, .size_bytes = 4096 * GiB};
+        REQUIRE_EQ(gucc::fs::get_fs_tuning(FilesystemType::Ext4, DeviceClass::Ssd, big_ssd).mkfs_command, "mkfs.ext4 -q"sv);
+
+        const auto& usb_tuning = gucc::fs::get_fs_tuning(FilesystemType::Ext4, DeviceClass::Removable, DeviceProfile{});
+        REQUIRE_EQ(usb_tuning.mount_opts, "defaults,noatime,lazytime,commit=60"sv);
+    }
+    SECTION("stripe geometry from raid topology")
+    {
+        // 512KiB chunk over 3 data disks
+        const DeviceProfile raid5{
+            .transport     = DiskTransport::Sata,
+            .is_rotational = true,
+            .size_bytes    = 8192 * GiB,
+            .topology      = DiskTopology{
+                     .logical_block_size  = 512,
+                     .physical_block_size = 4096,
+                     .minimum_io_size     = 512 * 1024,
+                     .optimal_io_size     = 3 * 512 * 1024,
+                     .raid_chunk_size     = 512 * 1024,
+            },
+        };
+        REQUIRE_EQ(gucc::fs::get_fs_tuning(FilesystemType::Ext4, DeviceClass::Hdd, raid5).mkfs_command, "mkfs.ext4 -q -E stride=128,stripe_width=384"sv);
+        REQUIRE_EQ(gucc::fs::get_fs_tuning(FilesystemType::Xfs, DeviceClass::Hdd, raid5).mkfs_command, "mkfs.xfs -f -d su=512k,sw=3"sv);
+
+        // a plain 4Kn disk has no stripe
+        const DeviceProfile plain{.transport = DiskTransport::Sata, .topology = DiskTopology{.logical_block_size = 4096, .physical_block_size = 4096, .minimum_io_size = 4096}};
+        REQUIRE_EQ(gucc::fs::get_fs_tuning(FilesystemType::Xfs, DeviceClass::Hdd, plain).mkfs_command, "mkfs.xfs -f"sv);
+    }
+    SECTION("f2fs")
+    {
+        const DeviceProfile ssd{.transport = DiskTransport::Sata, .is_rotational = false};
+        const auto& tuning = gucc::fs::get_fs_tuning(FilesystemType::F2fs, DeviceClass::Ssd, ssd);
+        REQUIRE_EQ(tuning.mkfs_command, "mkfs.f2fs -q -O extra_attr,inode_checksum,sb_checksum,compression"sv);
+        REQUIRE_EQ(tuning.mount_opts, "defaults,lazytime,gc_merge,compress_algorithm=lz4,compress_chksum"sv);
+
+        const auto& boot_tuning = gucc::fs::get_fs_tuning(FilesystemType::F2fs, DeviceClass::Ssd, ssd, true);
+        REQUIRE_EQ(boot_tuning.mkfs_command, "mkfs.f2fs -q -O extra_attr,inode_checksum,sb_checksum"sv);
+        REQUIRE_EQ(boot_tuning.mount_opts, "defaults,lazytime,gc_merge"sv);
+    }
+}
@@ -418,6 +418,27 @@ TEST_CASE("setup initcpiocfg from config test")
 
         ::fs::remove(filename);
     }
+    SECTION("mdadm + luks config")
+    {
+        REQUIRE(file_utils::create_file_for_overwrite(filename, MKINITCPIO_STR));
+
+        const auto config = initcpio::InitcpioConfig{
+            .filesystem_type = gucc::fs::FilesystemType::Ext4,
+            .is_luks  = true,
+            .is_mdadm = true,
+        };
+        REQUIRE(initcpio::setup_initcpio_config(filename, config));
+
+        auto result = detail::Initcpio{filename};
+        REQUIRE(result.parse_file());
+
+        const std::vector<std::string> expected_hooks{
+            "base", "udev", "keyboard", "autodetect", "microcode", "kms", "modconf", "block",
+            "keymap", "consolefont", "mdadm_udev", "encrypt", "filesystems", "fsck"};
+        REQUIRE_EQ(result.hooks, expected_hooks);
+
+        ::fs::remove(filename);
+    }
     SECTION("btrfs + luks config")
     {
         REQUIRE(file_utils::create_file_for_overwrite(filename, MKINITCPIO_STR));
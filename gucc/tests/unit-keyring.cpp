@@ -0,0 +1,147 @@
+#include "doctest_compatibility.h"
+
+#include "test_temp_root.hpp"
+
+#include "gucc/file_utils.hpp"
+#include "gucc/keyring.hpp"
+#include "gucc/logger.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <spdlog/sinks/callback_sink.h>
+#include <spdlog/spdlog.h>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// an EdDSA primary key (old format packet), a user id and a subkey
+static constexpr auto PUBRING_HEX = "990034045f5e100016092b06010401da470f01010107404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f60"
+                                    "cd1d54657374205061636b61676572203c74406578616d706c652e6f72673e"
+                                    "ce1a045f5e100012101112131415161718191a1b1c1d1e1f20212223"sv;
+static constexpr auto PRIMARY_FPR = "842901C1EAC1D9A503AC7EF9A4F61C0B45A34B21"sv;
+static constexpr auto SUBKEY_FPR  = "491CA2B58D46E4835ACC2FC19952EE2D7931E96E"sv;
+
+// issuer fingerprint in the hashed area, key id in the unhashed one
+static constexpr auto SIG_FPR_HEX = "c22b0400160a0017162104842901c1eac1d9a503ac7ef9a4f61c0b45a34b21000a0910a4f61c0b45a34b21abcd"sv;
+// only a key id, of a key nobody has
+static constexpr auto SIG_KEYID_HEX = "88120400160a0000000a09100123456789abcdef"sv;
+
+auto from_hex(std::string_view hex) -> std::string {
+    std::string bytes{};
+    for (std::size_t i = 0; i + 1 < hex.size(); i += 2) {
+        bytes += static_cast<char>(std::stoi(std::string{hex.substr(i, 2)}, nullptr, 16));
+    }
+    return bytes;
+}
+
+}  // namespace
+
+TEST_CASE("keyring test")
+{
+    auto callback_sink = std::make_shared<spdlog::sinks::callback_sink_mt>([](const spdlog::details::log_msg&) {
+        // noop
+    });
+    auto logger = std::make_shared<spdlog::logger>("default", callback_sink);
+    spdlog::set_default_logger(logger);
+    gucc::logger::set_logger(logger);
+
+    const auto& pubring = from_hex(PUBRING_HEX);
+
+    SECTION("fingerprints")
+    {
+        const auto& fingerprints = gucc::keyring::detail::keyring_fingerprints(pubring);
+        REQUIRE(fingerprints);
+        const std::vector expected{std::string{PRIMARY_FPR}, std::string{SUBKEY_FPR}};
+        REQUIRE_EQ(*fingerprints, expected);
+
+        REQUIRE(gucc::keyring::has_key(*fingerprints, PRIMARY_FPR));
+        // a long key id
+        REQUIRE(gucc::keyring::has_key(*fingerprints, "A4F61C0B45A34B21"sv));
+        REQUIRE_FALSE(gucc::keyring::has_key(*fingerprints, "0123456789ABCDEF"sv));
+        REQUIRE_FALSE(gucc::keyring::has_key(*fingerprints, ""sv));
+
+        // cut in the middle of the subkey
+        REQUIRE(gucc::keyring::detail::keyring_fingerprints(pubring.substr(0, pubring.size() - 4)).error().code == gucc::ErrorCode::ParseError);
+        // v3 keys have no v4 fingerprint
+        REQUIRE_FALSE(gucc::keyring::detail::v4_fingerprint("\x03\x01"sv));
+    }
+    SECTION("signature issuer")
+    {
+        REQUIRE_EQ(gucc::keyring::detail::signature_issuer(from_hex(SIG_FPR_HEX)), std::string{PRIMARY_FPR});
+        REQUIRE_EQ(gucc::keyring::detail::signature_issuer(from_hex(SIG_KEYID_HEX)), "0123456789ABCDEF"s);
+        REQUIRE_FALSE(gucc::keyring::detail::signature_issuer("-----BEGIN PGP SIGNATURE-----\n"sv));
+        REQUIRE_FALSE(gucc::keyring::detail::signature_issuer(pubring));
+    }
+    SECTION("seed target")
+    {
+        const gucc::tests::TempRoot root{"gucc-keyring"};
+        const auto& host_dir     = root.path() / "host-gnupg";
+        const auto& keyrings_dir = root.path() / "keyrings";
+        fs::create_directories(host_dir / "openpgp-revocs.d");
+        fs::create_directories(keyrings_dir);
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((host_dir / "pubring.gpg").string(), pubring));
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((host_dir / "trustdb.gpg").string(), "trust"sv));
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((host_dir / "pubring.gpg.lock").string(), "1"sv));
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((keyrings_dir / "test-trusted").string(), fmt::format("{}:4:\n", PRIMARY_FPR)));
+
+        const auto& mountpoint = (root.path() / "mnt").string();
+        const gucc::keyring::SeedOptions options{.host_dir = host_dir.string(), .keyrings_dir = keyrings_dir.string()};
+        const auto& seeded = gucc::keyring::seed_target(mountpoint, options);
+        REQUIRE(seeded);
+        REQUIRE(seeded->copied);
+        REQUIRE_EQ(seeded->keys, 2);
+        const auto& target_dir = fs::path{mountpoint} / "etc/pacman.d/gnupg";
+        REQUIRE(fs::exists(target_dir / "trustdb.gpg"));
+        REQUIRE(fs::is_directory(target_dir / "openpgp-revocs.d"));
+        REQUIRE_FALSE(fs::exists(target_dir / "pubring.gpg.lock"));
+
+        // a keyring already there is kept
+        const auto& again = gucc::keyring::seed_target(mountpoint, options);
+        REQUIRE(again);
+        REQUIRE_FALSE(again->copied);
+
+        REQUIRE_EQ(again->missing_trusted, 0);
+
+        // a trusted key the keyring lacks is left to the keyring packages
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((keyrings_dir / "other-trusted").string(), "0123456789ABCDEF0123456789ABCDEF01234567:4:\n"sv));
+        const auto& incomplete = gucc::keyring::seed_target(mountpoint, options);
+        REQUIRE(incomplete);
+        REQUIRE_EQ(incomplete->missing_trusted, 1);
+    }
+    SECTION("check signers")
+    {
+        const gucc::tests::TempRoot root{"gucc-keyring-sigs"};
+        const auto& keyring_dir = root.path() / "gnupg";
+        const auto& cache_dir   = root.path() / "pkg";
+        fs::create_directories(keyring_dir);
+        fs::create_directories(cache_dir);
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((keyring_dir / "pubring.gpg").string(), pubring));
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((cache_dir / "a-1-1-any.pkg.tar.zst.sig").string(), from_hex(SIG_FPR_HEX)));
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((cache_dir / "a-1-1-any.pkg.tar.zst").string(), "pkg"sv));
+
+        // a stale file from an earlier install signed by someone else, not part of this one
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((cache_dir / "b-1-1-any.pkg.tar.zst.sig").string(), from_hex(SIG_KEYID_HEX)));
+        const std::vector fetched{(cache_dir / "a-1-1-any.pkg.tar.zst.sig").string()};
+        const auto& checked = gucc::keyring::check_signers(keyring_dir.string(), fetched);
+        REQUIRE(checked);
+        REQUIRE_EQ(*checked, 1);
+
+        const std::vector both{fetched.front(), (cache_dir / "b-1-1-any.pkg.tar.zst.sig").string()};
+        REQUIRE(gucc::keyring::check_signers(keyring_dir.string(), both).error().code == gucc::ErrorCode::NotFound);
+
+        // nothing downloaded yet
+        const std::vector missing{(root.path() / "missing/c-1-1-any.pkg.tar.zst.sig").string()};
+        REQUIRE_EQ(gucc::keyring::check_signers(keyring_dir.string(), missing).value(), 0);
+
+        REQUIRE(gucc::keyring::read_fingerprints(cache_dir.string()).error().code == gucc::ErrorCode::NotFound);
+    }
+}
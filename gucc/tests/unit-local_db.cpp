@@ -0,0 +1,95 @@
+#include "doctest_compatibility.h"
+
+#include "test_temp_root.hpp"
+
+#include "gucc/file_utils.hpp"
+#include "gucc/local_db.hpp"
+#include "gucc/logger.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <spdlog/sinks/callback_sink.h>
+#include <spdlog/spdlog.h>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace fs = std::filesystem;
+
+using gucc::localdb::LocalDatabase;
+
+namespace {
+
+void add_package(const fs::path& root, std::string_view dir_name, std::string_view files) {
+    const auto& pkg_dir = root / "var/lib/pacman/local" / dir_name;
+    fs::create_directories(pkg_dir);
+    REQUIRE(gucc::file_utils::create_file_for_overwrite((pkg_dir / "desc").string(), "%NAME%\nx\n\n"sv));
+    REQUIRE(gucc::file_utils::create_file_for_overwrite((pkg_dir / "files").string(), files));
+}
+
+}  // namespace
+
+TEST_CASE("local db test")
+{
+    auto callback_sink = std::make_shared<spdlog::sinks::callback_sink_mt>([](const spdlog::details::log_msg&) {
+        // noop
+    });
+    auto logger = std::make_shared<spdlog::logger>("default", callback_sink);
+    spdlog::set_default_logger(logger);
+    gucc::logger::set_logger(logger);
+
+    const gucc::tests::TempRoot root{"gucc-local-db"};
+    add_package(root.path(), "grub-2:2.12-3"sv, "%FILES%\netc/\netc/default/grub\nusr/bin/grub-install\n\n%BACKUP%\netc/default/grub\tabc\n"sv);
+    add_package(root.path(), "cachyos-snapper-support-1.0-2"sv, {});
+    REQUIRE(gucc::file_utils::create_file_for_overwrite((root.path() / "var/lib/pacman/local/ALPM_DB_VERSION").string(), "9\n"sv));
+
+    SECTION("queries")
+    {
+        const auto& db = LocalDatabase::open(root.path().string());
+        REQUIRE(db);
+        REQUIRE_EQ(db->size(), 2);
+
+        REQUIRE(db->is_installed("grub"sv));
+        REQUIRE(db->is_installed("cachyos-snapper-support"sv));
+        REQUIRE_FALSE(db->is_installed("cachyos-snapper"sv));
+        REQUIRE_FALSE(db->is_installed("refind"sv));
+        REQUIRE_FALSE(db->is_installed("ALPM_DB_VERSION"sv));
+
+        REQUIRE_EQ(db->version("grub"sv), "2:2.12-3"sv);
+        REQUIRE_EQ(db->version("cachyos-snapper-support"sv), "1.0-2"sv);
+        REQUIRE_FALSE(db->version("refind"sv));
+
+        const std::vector names{"cachyos-snapper-support"sv, "grub"sv};
+        REQUIRE_EQ(db->package_names(), names);
+    }
+    SECTION("files")
+    {
+        const auto& db = LocalDatabase::open(root.path().string());
+        REQUIRE(db);
+
+        const std::vector grub_files{"etc/"s, "etc/default/grub"s, "usr/bin/grub-install"s};
+        const auto& files = db->files("grub"sv);
+        REQUIRE(files);
+        REQUIRE_EQ(*files, grub_files);
+
+        // owns nothing
+        const auto& meta_files = db->files("cachyos-snapper-support"sv);
+        REQUIRE(meta_files);
+        REQUIRE(meta_files->empty());
+
+        REQUIRE(db->files("refind"sv).error().code == gucc::ErrorCode::NotFound);
+    }
+    SECTION("one-shot probes")
+    {
+        REQUIRE(gucc::localdb::is_installed("grub"sv, root.path().string()));
+        REQUIRE_FALSE(gucc::localdb::is_installed("limine"sv, root.path().string()));
+
+        // a root without a pacman db has nothing installed
+        const gucc::tests::TempRoot empty_root{"gucc-local-db-empty"};
+        REQUIRE(LocalDatabase::open(empty_root.path().string()).error().code == gucc::ErrorCode::NotFound);
+        REQUIRE_FALSE(gucc::localdb::is_installed("grub"sv, empty_root.path().string()));
+    }
+}
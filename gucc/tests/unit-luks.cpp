@@ -0,0 +1,62 @@
+#include "doctest_compatibility.h"
+
+#include "gucc/luks.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+using gucc::crypto::LuksPbkdfParams;
+using gucc::crypto::LuksPerfOptions;
+
+TEST_CASE("luks test")
+{
+    static constexpr auto BENCHMARK_OUTPUT = "# Tests are approximate using memory only (no storage IO).\n"
+                                             "argon2id      4 iterations, 1048576 memory, 4 parallel threads (CPUs) for 256-bit key (requested 2000 ms time)\n"sv;
+    static constexpr LuksPbkdfParams PARAMS{.iterations = 4, .memory_kib = 1048576, .parallel = 4};
+
+    SECTION("benchmark parsing")
+    {
+        REQUIRE_EQ(gucc::crypto::detail::parse_pbkdf_benchmark(BENCHMARK_OUTPUT), std::optional{PARAMS});
+
+        REQUIRE_FALSE(gucc::crypto::detail::parse_pbkdf_benchmark(""sv).has_value());
+        REQUIRE_FALSE(gucc::crypto::detail::parse_pbkdf_benchmark("PBKDF2-sha256    1872457 iterations per second for 256-bit key\n"sv).has_value());
+        // cut short
+        REQUIRE_FALSE(gucc::crypto::detail::parse_pbkdf_benchmark("argon2id      4 iterations, 1048576 memory\n"sv).has_value());
+    }
+    SECTION("pbkdf flags")
+    {
+        REQUIRE_EQ(gucc::crypto::luks2_pbkdf_flags(PARAMS), "--pbkdf argon2id --pbkdf-force-iterations 4 --pbkdf-memory 1048576 --pbkdf-parallel 4");
+
+        REQUIRE_EQ(gucc::crypto::detail::with_pbkdf_flags(""sv, PARAMS), "--pbkdf argon2id --pbkdf-force-iterations 4 --pbkdf-memory 1048576 --pbkdf-parallel 4");
+        REQUIRE_EQ(gucc::crypto::detail::with_pbkdf_flags("--sector-size 4096"sv, PARAMS),
+            "--pbkdf argon2id --pbkdf-force-iterations 4 --pbkdf-memory 1048576 --pbkdf-parallel 4 --sector-size 4096");
+
+        // the caller's choice wins
+        REQUIRE_EQ(gucc::crypto::detail::with_pbkdf_flags("--pbkdf pbkdf2 --pbkdf-force-iterations 1000"sv, PARAMS), "--pbkdf pbkdf2 --pbkdf-force-iterations 1000");
+        REQUIRE_EQ(gucc::crypto::detail::with_pbkdf_flags("--iter-time 500"sv, PARAMS), "--iter-time 500");
+        // calibration failed
+        REQUIRE_EQ(gucc::crypto::detail::with_pbkdf_flags("-s 512"sv, std::nullopt), "-s 512");
+    }
+    SECTION("perf flags")
+    {
+        REQUIRE(gucc::crypto::luks2_format_perf_flags(LuksPerfOptions{}).empty());
+        REQUIRE(gucc::crypto::luks2_open_perf_flags(LuksPerfOptions{}).empty());
+        REQUIRE(gucc::crypto::luks1_open_perf_flags(LuksPerfOptions{}).empty());
+        REQUIRE(gucc::crypto::luks_crypttab_perf_options(LuksPerfOptions{}).empty());
+
+        const LuksPerfOptions nvme{.sector_size = 4096, .no_read_workqueue = true, .no_write_workqueue = true};
+        REQUIRE_EQ(gucc::crypto::luks2_format_perf_flags(nvme), "--sector-size 4096");
+        REQUIRE_EQ(gucc::crypto::luks2_open_perf_flags(nvme), "--perf-no_read_workqueue --perf-no_write_workqueue --persistent");
+        REQUIRE_EQ(gucc::crypto::luks1_open_perf_flags(nvme), "--perf-no_read_workqueue --perf-no_write_workqueue");
+        REQUIRE_EQ(gucc::crypto::luks_crypttab_perf_options(nvme), "no-read-workqueue,no-write-workqueue");
+
+        const LuksPerfOptions reads_only{.no_read_workqueue = true};
+        REQUIRE(gucc::crypto::luks2_format_perf_flags(reads_only).empty());
+        REQUIRE_EQ(gucc::crypto::luks2_open_perf_flags(reads_only), "--perf-no_read_workqueue --persistent");
+        REQUIRE_EQ(gucc::crypto::luks_crypttab_perf_options(reads_only), "no-read-workqueue");
+    }
+}
@@ -3,7 +3,9 @@
 #include "gucc/logger.hpp"
 #include "gucc/lvm.hpp"
 
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include <spdlog/sinks/callback_sink.h>
 #include <spdlog/spdlog.h>
@@ -50,63 +52,146 @@ TEST_CASE("lvm test")
     }
 }
 
-TEST_CASE("parse_vgs_output test")
+TEST_CASE("lvm fullreport test")
 {
-    using gucc::lvm::parse_vgs_output;
-
-    SECTION("empty input")
-    {
-        auto result = parse_vgs_output(""sv);
-        CHECK(result.empty());
-    }
-
-    SECTION("single volume group")
+    using gucc::lvm::detail::parse_lvm_fullreport;
+
+    // lvm fullreport --reportformat json --units b --nosuffix, with the columns gucc asks for
+    static constexpr auto FULLREPORT_TEST = R"json({
+      "report": [
+          {
+              "vg": [
+                  {"vg_name":"cachyos-vg", "vg_uuid":"Xo3b6Q-1v2S-vb3S-Q5c4-2Aa1-dc8e-ZZ4u1T", "vg_size":"511574704128", "vg_free":"10737418240", "vg_extent_size":"4194304"}
+              ]
+              ,
+              "pv": [
+                  {"pv_name":"/dev/nvme0n1p2", "pv_uuid":"4hZ0Lk-a1B2-c3D4-e5F6-g7H8-i9J0-kLmNoP", "vg_name":"cachyos-vg", "pv_size":"511574704128", "pv_free":"10737418240"}
+              ]
+              ,
+              "lv": [
+                  {"lv_name":"root", "lv_uuid":"rootuu-0000-0000-0000-0000-0000-000001", "vg_name":"cachyos-vg", "lv_path":"/dev/cachyos-vg/root", "lv_size":"107374182400", "lv_attr":"-wi-ao----", "pool_lv":"", "origin":""},
+                  {"lv_name":"home", "lv_uuid":"homeuu-0000-0000-0000-0000-0000-000002", "vg_name":"cachyos-vg", "lv_path":"/dev/cachyos-vg/home", "lv_size":"393463103488", "lv_attr":"-wi-------", "pool_lv":"", "origin":""},
+                  {"lv_name":"[home_rimage_0]", "lv_uuid":"hiddenuu-0000-0000-0000-0000-0000-03", "vg_name":"cachyos-vg", "lv_path":"", "lv_size":"4194304", "lv_attr":"iwi-aor---", "pool_lv":"", "origin":""}
+              ]
+              ,
+              "pvseg": [
+                  {"pvseg_start":"0"}
+              ]
+              ,
+              "seg": [
+                  {"lv_uuid":"rootuu-0000-0000-0000-0000-0000-000001", "seg_start":"0", "seg_size":"107374182400", "segtype":"linear", "stripes":"1", "devices":"/dev/nvme0n1p2(0)"},
+                  {"lv_uuid":"homeuu-0000-0000-0000-0000-0000-000002", "seg_start":"0", "seg_size":"214748364800", "segtype":"striped", "stripes":"2", "devices":"/dev/nvme0n1p2(25600),/dev/sdb1(0)"},
+                  {"lv_uuid":"homeuu-0000-0000-0000-0000-0000-000002", "seg_start":"214748364800", "seg_size":"178714738688", "segtype":"linear", "stripes":"1", "devices":"/dev/nvme0n1p2(76800)"}
+              ]
+          }
+          ,
+          {
+              "vg": [
+              ]
+              ,
+              "pv": [
+                  {"pv_name":"/dev/sdc1", "pv_uuid":"orphan-0000-0000-0000-0000-0000-000000", "vg_name":"", "pv_size":"1000204886016", "pv_free":"1000204886016"}
+              ]
+              ,
+              "lv": [
+              ]
+              ,
+              "pvseg": [
+              ]
+              ,
+              "seg": [
+              ]
+          }
+      ]
+      ,
+      "log": [
+      ]
+  }
+)json"sv;
+
+    SECTION("volume groups and physical volumes")
     {
-        constexpr auto input = "  vg0\t100.00g\n"sv;
-        auto result = parse_vgs_output(input);
-        REQUIRE(result.size() == 1);
-        CHECK(result[0].first == "vg0");
-        CHECK(result[0].second == "100.00g");
+        const auto& report = parse_lvm_fullreport(FULLREPORT_TEST);
+        REQUIRE(report.has_value());
+
+        REQUIRE_EQ(report->volume_groups.size(), 1);
+        const auto& vg = report->volume_groups[0];
+        CHECK_EQ(vg.name, "cachyos-vg"sv);
+        CHECK_EQ(vg.size, 511574704128ULL);
+        CHECK_EQ(vg.free, 10737418240ULL);
+        CHECK_EQ(vg.extent_size, 4194304ULL);
+
+        REQUIRE_EQ(report->physical_volumes.size(), 2);
+        CHECK_EQ(report->physical_volumes[0].name, "/dev/nvme0n1p2"sv);
+        CHECK_EQ(report->physical_volumes[0].vg_name, "cachyos-vg"sv);
+        // orphan PV
+        CHECK_EQ(report->physical_volumes[1].name, "/dev/sdc1"sv);
+        CHECK(report->physical_volumes[1].vg_name.empty());
+        CHECK_EQ(report->physical_volumes[1].free, 1000204886016ULL);
     }
 
-    SECTION("multiple volume groups")
+    SECTION("logical volumes and segments")
     {
-        constexpr auto input = "  vg0\t100.00g\n  vg1\t500.00g\n  vg_data\t1000.00g\n"sv;
-        auto result = parse_vgs_output(input);
-        REQUIRE(result.size() == 3);
-        CHECK(result[0].first == "vg0");
-        CHECK(result[0].second == "100.00g");
-        CHECK(result[1].first == "vg1");
-        CHECK(result[1].second == "500.00g");
-        CHECK(result[2].first == "vg_data");
-        CHECK(result[2].second == "1000.00g");
+        const auto& report = parse_lvm_fullreport(FULLREPORT_TEST);
+        REQUIRE(report.has_value());
+        REQUIRE_EQ(report->logical_volumes.size(), 3);
+
+        const auto& root = report->logical_volumes[0];
+        CHECK_EQ(root.path, "/dev/cachyos-vg/root"sv);
+        CHECK_EQ(root.size, 107374182400ULL);
+        CHECK(root.is_active());
+        REQUIRE_EQ(root.segments.size(), 1);
+        CHECK_EQ(root.segments[0].type, "linear"sv);
+        CHECK_EQ(root.segments[0].devices, std::vector<std::string>{"/dev/nvme0n1p2"});
+
+        const auto& home = report->logical_volumes[1];
+        CHECK_FALSE(home.is_active());
+        REQUIRE_EQ(home.segments.size(), 2);
+        CHECK_EQ(home.segments[0].stripes, 2);
+        const std::vector<std::string> striped_devices{"/dev/nvme0n1p2", "/dev/sdb1"};
+        CHECK_EQ(home.segments[0].devices, striped_devices);
+        CHECK_EQ(home.segments[1].start, 214748364800ULL);
+
+        CHECK(report->logical_volumes[2].path.empty());
     }
 
-    SECTION("handles whitespace")
+    SECTION("numbers from json_std")
     {
-        constexpr auto input = "  vg0  \t  50.00g  \n"sv;
-        auto result = parse_vgs_output(input);
-        REQUIRE(result.size() == 1);
-        CHECK(result[0].first == "vg0");
-        CHECK(result[0].second == "50.00g");
+        static constexpr auto input = R"({"report":[{"vg":[{"vg_name":"vg0","vg_size":1073741824,"vg_free":0}],"pv":[],"lv":[],"seg":[]}]})"sv;
+        const auto& report = parse_lvm_fullreport(input);
+        REQUIRE(report.has_value());
+        REQUIRE_EQ(report->volume_groups.size(), 1);
+        CHECK_EQ(report->volume_groups[0].size, 1073741824ULL);
+        CHECK_EQ(report->volume_groups[0].free, 0);
+
+        static constexpr auto no_stripes = R"({"report":[{"lv":[{"lv_name":"root","lv_uuid":"u1"}],"seg":[{"lv_uuid":"u1","seg_start":0,"seg_size":4194304,"segtype":"linear"}]}]})"sv;
+        const auto& linear = parse_lvm_fullreport(no_stripes);
+        REQUIRE(linear.has_value());
+        REQUIRE_EQ(linear->logical_volumes.size(), 1);
+        REQUIRE_EQ(linear->logical_volumes[0].segments.size(), 1);
+        CHECK_EQ(linear->logical_volumes[0].segments[0].stripes, 1);
     }
 
-    SECTION("filters empty lines")
+    SECTION("empty and malformed output")
     {
-        constexpr auto input = "\n  vg0\t100.00g\n\n  vg1\t200.00g\n\n"sv;
-        auto result = parse_vgs_output(input);
-        REQUIRE(result.size() == 2);
-        CHECK(result[0].first == "vg0");
-        CHECK(result[1].first == "vg1");
+        const auto& empty = parse_lvm_fullreport(R"({"report":[]})"sv);
+        REQUIRE(empty.has_value());
+        CHECK(empty->volume_groups.empty());
+        CHECK(empty->logical_volumes.empty());
+
+        const auto& malformed = parse_lvm_fullreport(R"({"report":[{"vg":[)"sv);
+        REQUIRE_FALSE(malformed.has_value());
+        CHECK_EQ(malformed.error().code, gucc::ErrorCode::ParseError);
     }
 
-    SECTION("typical vgs output")
+    SECTION("segment devices")
     {
-        // Output from: vgs -o vg_name,vg_size --noheading --separator='\t' --units=g
-        constexpr auto input = "  cachyos-vg\t476.45g\n"sv;
-        auto result = parse_vgs_output(input);
-        REQUIRE(result.size() == 1);
-        CHECK(result[0].first == "cachyos-vg");
-        CHECK(result[0].second == "476.45g");
+        using gucc::lvm::detail::parse_segment_devices;
+        CHECK(parse_segment_devices(""sv).empty());
+        CHECK_EQ(parse_segment_devices("/dev/sda2(0)"sv), std::vector<std::string>{"/dev/sda2"});
+        // raid and thin LVs are backed by hidden sub LVs
+        const std::vector<std::string> raid_images{"home_rimage_0", "home_rimage_1"};
+        CHECK_EQ(parse_segment_devices("home_rimage_0(0),home_rimage_1(0)"sv), raid_images);
+        CHECK_EQ(parse_segment_devices("pool0_tdata(0)"sv), std::vector<std::string>{"pool0_tdata"});
     }
 }
@@ -0,0 +1,108 @@
+#include "doctest_compatibility.h"
+
+#include "gucc/lvm_cache.hpp"
+#include "gucc/process.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+using gucc::lvm::LvmCacheConfig;
+using gucc::lvm::LvmCacheMode;
+
+namespace {
+
+inline constexpr std::uint64_t GIB         = 1024ULL * 1024 * 1024;
+inline constexpr std::uint64_t EXTENT_SIZE = 4ULL * 1024 * 1024;
+
+// /home on two HDDs, cached by a NVMe partition
+auto home_cache_config(LvmCacheMode mode) -> LvmCacheConfig {
+    return LvmCacheConfig{
+        .vg_name        = "vgcachyos"s,
+        .lv_name        = "home"s,
+        .origin_devices = {"/dev/sda"s, "/dev/sdb"s},
+        .cache_device   = "/dev/nvme0n1p3"s,
+        .mode           = mode,
+    };
+}
+
+}  // namespace
+
+TEST_CASE("lvm cache test")
+{
+    SECTION("mode names")
+    {
+        REQUIRE_EQ(gucc::lvm::string_to_lvm_cache_mode("writeback"sv), LvmCacheMode::Writeback);
+        REQUIRE_EQ(gucc::lvm::string_to_lvm_cache_mode("writecache"sv), LvmCacheMode::Writecache);
+        REQUIRE_FALSE(gucc::lvm::string_to_lvm_cache_mode("writearound"sv).has_value());
+        REQUIRE_EQ(gucc::lvm::lvm_cache_mode_to_string(LvmCacheMode::Writethrough), "writethrough"sv);
+    }
+    SECTION("plan")
+    {
+        const auto& config = home_cache_config(LvmCacheMode::Writethrough);
+
+        // partial extents are dropped
+        const auto& plan = gucc::lvm::plan_lvm_cache(config, 4000 * GIB, 200 * GIB + 1024, EXTENT_SIZE);
+        REQUIRE(plan.has_value());
+        REQUIRE_EQ(plan->origin_size, 4000 * GIB);
+        REQUIRE_EQ(plan->cache_size, 200 * GIB);
+        // 200GiB in at most a million chunks
+        REQUIRE_EQ(plan->chunk_size, 256 * 1024);
+        REQUIRE(plan->warnings.empty());
+
+        // small caches keep the smallest chunk
+        const auto& small_plan = gucc::lvm::plan_lvm_cache(config, 4000 * GIB, 50 * GIB, EXTENT_SIZE);
+        REQUIRE(small_plan.has_value());
+        REQUIRE_EQ(small_plan->chunk_size, 64 * 1024);
+    }
+    SECTION("plan warnings")
+    {
+        // dirty data lives on a single device
+        const auto& writeback = gucc::lvm::plan_lvm_cache(home_cache_config(LvmCacheMode::Writeback), 4000 * GIB, 200 * GIB, EXTENT_SIZE);
+        REQUIRE(writeback.has_value());
+        REQUIRE_EQ(writeback->warnings.size(), 1);
+
+        // no chunks for dm-writecache, cache under 1% of the origin
+        const auto& writecache = gucc::lvm::plan_lvm_cache(home_cache_config(LvmCacheMode::Writecache), 4000 * GIB, 16 * GIB, EXTENT_SIZE);
+        REQUIRE(writecache.has_value());
+        REQUIRE_EQ(writecache->chunk_size, 0);
+        REQUIRE_EQ(writecache->warnings.size(), 2);
+    }
+    SECTION("invalid plans")
+    {
+        const auto& config = home_cache_config(LvmCacheMode::Writethrough);
+        REQUIRE_FALSE(gucc::lvm::plan_lvm_cache(config, 4000 * GIB, 512ULL * 1024 * 1024, EXTENT_SIZE).has_value());
+        REQUIRE_FALSE(gucc::lvm::plan_lvm_cache(config, 100 * GIB, 100 * GIB, EXTENT_SIZE).has_value());
+        REQUIRE_FALSE(gucc::lvm::plan_lvm_cache(config, 4000 * GIB, 200 * GIB, 0).has_value());
+    }
+    SECTION("lvm commands")
+    {
+        auto config = home_cache_config(LvmCacheMode::Writeback);
+        const gucc::lvm::LvmCachePlan plan{.origin_size = 4000 * GIB, .cache_size = 200 * GIB, .chunk_size = 256 * 1024};
+
+        REQUIRE_EQ(gucc::lvm::detail::vgcreate_cmd(config),
+            "vgcreate -y 'vgcachyos' '/dev/sda' '/dev/sdb' '/dev/nvme0n1p3'");
+        REQUIRE_EQ(gucc::lvm::detail::lvcreate_origin_cmd(config),
+            "lvcreate -y --wipesignatures y -n 'home' -l 100%PVS 'vgcachyos' '/dev/sda' '/dev/sdb'");
+        REQUIRE_EQ(gucc::lvm::detail::lvcreate_cachevol_cmd(config, plan),
+            "lvcreate -y --wipesignatures y -n 'home_cache' -L 214748364800b 'vgcachyos' '/dev/nvme0n1p3'");
+        REQUIRE_EQ(gucc::lvm::detail::lvconvert_cache_cmd(config, plan),
+            "lvconvert -y --type cache --cachevol 'home_cache' --cachemode writeback --chunksize 256k 'vgcachyos/home'");
+
+        config.mode = LvmCacheMode::Writecache;
+        REQUIRE_EQ(gucc::lvm::detail::lvconvert_cache_cmd(config, plan),
+            "lvconvert -y --type writecache --cachevol 'home_cache' 'vgcachyos/home'");
+    }
+    SECTION("dry run")
+    {
+        // no VG to size the cache from, the path of the LV is still known
+        gucc::utils::default_runner().set_dry_run(true);
+        const auto& lv_path = gucc::lvm::create_cached_lv(home_cache_config(LvmCacheMode::Writethrough));
+        gucc::utils::default_runner().set_dry_run(false);
+        REQUIRE(lv_path);
+        REQUIRE_EQ(*lv_path, "/dev/vgcachyos/home"sv);
+    }
+}
@@ -0,0 +1,187 @@
+#include "doctest_compatibility.h"
+
+#include "test_http_server.hpp"
+#include "test_temp_root.hpp"
+
+#include "gucc/file_utils.hpp"
+#include "gucc/mirrors.hpp"
+#include "gucc/process.hpp"
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+using namespace std::chrono_literals;
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+using gucc::mirrors::MirrorProbe;
+
+namespace {
+
+inline constexpr auto PACMAN_CONF = R"([options]
+HoldPkg     = pacman glibc
+Architecture = auto
+
+#ParallelDownloads = 5
+
+[core]
+Include = /etc/pacman.d/mirrorlist
+)"sv;
+
+}  // namespace
+
+TEST_CASE("mirrors test")
+{
+    SECTION("parse mirrorlist")
+    {
+        static constexpr auto MIRRORLIST = R"(## Germany
+Server = https://mirror.example.de/archlinux/$repo/os/$arch
+#Server = https://disabled.example.org/$repo/os/$arch
+  Server=https://cdn77.cachyos.org/repo/$arch_v3/$repo
+ServerName = not a server
+)"sv;
+        const std::vector expected{"https://mirror.example.de/archlinux/$repo/os/$arch"s, "https://cdn77.cachyos.org/repo/$arch_v3/$repo"s};
+        REQUIRE_EQ(gucc::mirrors::parse_mirrorlist(MIRRORLIST), expected);
+    }
+    SECTION("probe url")
+    {
+        REQUIRE_EQ(gucc::mirrors::detail::probe_url("https://mirror.example.de/archlinux/$repo/os/$arch"sv, "core"sv),
+            "https://mirror.example.de/archlinux/core/os/x86_64/core.db");
+        REQUIRE_EQ(gucc::mirrors::detail::probe_url("https://cdn77.cachyos.org/repo/$arch_v3/$repo/"sv, "cachyos-v3"sv),
+            "https://cdn77.cachyos.org/repo/x86_64_v3/cachyos-v3/cachyos-v3.db");
+    }
+    SECTION("mirror set hash")
+    {
+        const auto& hash = gucc::mirrors::detail::mirror_set_hash({"https://a/$repo"s, "https://b/$repo"s});
+        REQUIRE_EQ(hash.size(), 16);
+        // a ranked list is the same set
+        REQUIRE_EQ(gucc::mirrors::detail::mirror_set_hash({"https://b/$repo"s, "https://a/$repo"s, "https://a/$repo"s}), hash);
+        REQUIRE(gucc::mirrors::detail::mirror_set_hash({"https://a/$repo"s}) != hash);
+    }
+    SECTION("rank order")
+    {
+        const std::vector<MirrorProbe> probes{
+            MirrorProbe{.url = "dead"s},
+            MirrorProbe{.url = "near"s, .reachable = true, .latency_ms = 5.0},
+            MirrorProbe{.url = "slow"s, .reachable = true, .latency_ms = 20.0, .bytes_per_sec = 512.0 * 1024.0},
+            MirrorProbe{.url = "fast"s, .reachable = true, .latency_ms = 40.0, .bytes_per_sec = 20.0 * 1024.0 * 1024.0},
+            MirrorProbe{.url = "dead too"s},
+        };
+        const std::vector<std::size_t> expected{3, 2, 1, 0, 4};
+        REQUIRE_EQ(gucc::mirrors::detail::rank_order(probes), expected);
+    }
+    SECTION("rank header")
+    {
+        const std::vector servers{"https://a/$repo"s, "https://b/$repo"s};
+        const auto& content = gucc::mirrors::detail::render_mirrorlist(servers, {.ranked_at = 1760000000, .source = "0123456789abcdef"s, .bandwidth = 12345678.0});
+        REQUIRE_EQ(content,
+            "# Ranked by cachyos-installer\n## ranked_at = 1760000000\n## source = 0123456789abcdef\n## bandwidth = 12345678\n\n"
+            "Server = https://a/$repo\nServer = https://b/$repo\n");
+        REQUIRE_EQ(gucc::mirrors::parse_mirrorlist(content), servers);
+
+        const auto& header = gucc::mirrors::detail::parse_rank_header(content);
+        REQUIRE(header);
+        REQUIRE_EQ(header->ranked_at, 1760000000);
+        REQUIRE_EQ(header->source, "0123456789abcdef");
+        REQUIRE_EQ(header->bandwidth, 12345678.0);
+
+        // a plain mirrorlist
+        REQUIRE_FALSE(gucc::mirrors::detail::parse_rank_header("Server = https://a/$repo\n"sv));
+    }
+    SECTION("parallel downloads")
+    {
+        REQUIRE_EQ(gucc::mirrors::parallel_downloads_for(0.0), 2);
+        REQUIRE_EQ(gucc::mirrors::parallel_downloads_for(1024.0 * 1024.0), 2);
+        REQUIRE_EQ(gucc::mirrors::parallel_downloads_for(12.0 * 1024.0 * 1024.0), 6);
+        REQUIRE_EQ(gucc::mirrors::parallel_downloads_for(1e9), 16);
+
+        // the commented out default is enabled
+        REQUIRE_EQ(gucc::mirrors::detail::with_parallel_downloads(PACMAN_CONF, 8),
+            "[options]\nHoldPkg     = pacman glibc\nArchitecture = auto\n\nParallelDownloads = 8\n\n[core]\nInclude = /etc/pacman.d/mirrorlist\n");
+        // and replaced later on
+        const auto& conf = gucc::mirrors::detail::with_parallel_downloads(gucc::mirrors::detail::with_parallel_downloads(PACMAN_CONF, 8), 3);
+        REQUIRE(conf.contains("\nParallelDownloads = 3\n"sv));
+        REQUIRE_FALSE(conf.contains("ParallelDownloads = 8"sv));
+
+        // added right after [options] when missing
+        REQUIRE_EQ(gucc::mirrors::detail::with_parallel_downloads("[options]\nColor\n\n[core]\nInclude = x"sv, 4),
+            "[options]\nParallelDownloads = 4\nColor\n\n[core]\nInclude = x");
+    }
+    SECTION("probe local mirrors")
+    {
+        const std::string body(256 * 1024, 'x');
+        const gucc::tests::LocalHttpServer fast{body};
+        // far away and a slow link
+        const gucc::tests::LocalHttpServer slow{body, 150ms, 20ms};
+
+        const std::vector urls{slow.url("/core.db"), fast.url("/core.db"), "http://127.0.0.1:9/core.db"s};
+        // two latency waves
+        const auto& report = gucc::mirrors::probe_mirrors(urls, {.timeout = 2000ms, .latency_batch = 2});
+        REQUIRE_EQ(report.probes.size(), 3);
+        REQUIRE(report.probes[0].reachable);
+        REQUIRE(report.probes[1].reachable);
+        REQUIRE_FALSE(report.probes[2].reachable);
+        REQUIRE(report.probes[0].latency_ms > report.probes[1].latency_ms);
+        REQUIRE(report.probes[1].bytes_per_sec > report.probes[0].bytes_per_sec);
+        REQUIRE(report.bandwidth > 0.0);
+
+        const std::vector<std::size_t> expected{1, 0, 2};
+        REQUIRE_EQ(gucc::mirrors::detail::rank_order(report.probes), expected);
+    }
+    SECTION("rank mirrorlist with cache")
+    {
+        const gucc::tests::TempRoot root{"gucc-mirrors"};
+        const std::string body(64 * 1024, 'x');
+        const gucc::tests::LocalHttpServer fast{body};
+        const gucc::tests::LocalHttpServer slow{body, 150ms, 20ms};
+
+        const auto& mirrorlist_path = (root.path() / "mirrorlist").string();
+        const auto& mirrorlist      = fmt::format("Server = {}/$repo/os/$arch\nServer = {}/$repo/os/$arch\n", slow.url(), fast.url());
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(mirrorlist_path, mirrorlist));
+
+        const gucc::mirrors::RankOptions options{
+            .mirrorlists = {{.path = mirrorlist_path, .probe_repo = "core"s}},
+            .cache_dir   = (root.path() / "cache").string(),
+            .probe       = {.timeout = 2000ms},
+        };
+
+        // dry-run neither probes nor rewrites the list
+        auto& runner = gucc::utils::default_runner();
+        runner.set_dry_run(true);
+        const auto& dry = gucc::mirrors::rank_mirrors(options);
+        runner.set_dry_run(false);
+        REQUIRE(dry);
+        REQUIRE_EQ(dry->probed_lists, 0);
+        REQUIRE_EQ(fast.requests() + slow.requests(), 0);
+        REQUIRE_EQ(gucc::file_utils::read_whole_file(mirrorlist_path), mirrorlist);
+
+        const auto& ranked = gucc::mirrors::rank_mirrors(options);
+        REQUIRE(ranked);
+        REQUIRE_EQ(ranked->probed_lists, 1);
+        REQUIRE_EQ(ranked->cached_lists, 0);
+        REQUIRE(ranked->parallel_downloads >= 2);
+        const std::vector expected{fmt::format("{}/$repo/os/$arch", fast.url()), fmt::format("{}/$repo/os/$arch", slow.url())};
+        REQUIRE_EQ(gucc::mirrors::parse_mirrorlist(gucc::file_utils::read_whole_file(mirrorlist_path)), expected);
+
+        // the next install reuses the ranking without touching the mirrors
+        const auto requests = fast.requests() + slow.requests();
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(mirrorlist_path, mirrorlist));
+        const auto& cached = gucc::mirrors::rank_mirrors(options);
+        REQUIRE(cached);
+        REQUIRE_EQ(cached->cached_lists, 1);
+        REQUIRE_EQ(cached->probed_lists, 0);
+        REQUIRE_EQ(fast.requests() + slow.requests(), requests);
+        REQUIRE(gucc::file_utils::read_whole_file(mirrorlist_path).starts_with("# Ranked by cachyos-installer"sv));
+
+        // a different set of servers is probed again
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(mirrorlist_path, fmt::format("Server = {}/$repo/os/$arch\n", fast.url())));
+        const auto& reprobed = gucc::mirrors::rank_mirrors(options);
+        REQUIRE(reprobed);
+        REQUIRE_EQ(reprobed->probed_lists, 1);
+        REQUIRE(fast.requests() + slow.requests() > requests);
+    }
+}
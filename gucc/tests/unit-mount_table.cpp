@@ -0,0 +1,146 @@
+#include "doctest_compatibility.h"
+
+#include "gucc/mount_table.hpp"
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+// installer target mounted on /mnt, with a stacked /mnt/boot and a sibling /mnt2
+static constexpr auto MOUNTINFO_INSTALL_TEST = R"(22 1 0:21 / /proc rw,nosuid,nodev,noexec,relatime shared:5 - proc proc rw
+23 1 0:22 / /sys rw,nosuid,nodev,noexec,relatime shared:6 - sysfs sys rw
+1 1 0:28 / / rw,relatime shared:1 - overlay airootfs rw,lowerdir=/run/archiso/airootfs
+40 1 259:3 / /mnt rw,relatime shared:20 - btrfs /dev/nvme0n1p3 rw,ssd,discard=async,space_cache=v2,subvolid=256,subvol=/@
+41 40 259:3 /@home /mnt/home rw,relatime shared:21 - btrfs /dev/nvme0n1p3 rw,ssd,discard=async,space_cache=v2,subvolid=257,subvol=/@home
+42 40 259:1 / /mnt/boot rw,relatime shared:22 - vfat /dev/nvme0n1p1 rw,fmask=0022,dmask=0022
+43 42 259:1 / /mnt/boot/efi rw,relatime shared:23 - vfat /dev/nvme0n1p1 rw,fmask=0022,dmask=0022
+44 42 0:45 / /mnt/boot rw,relatime shared:24 - tmpfs tmpfs rw,size=1024k
+45 1 8:17 / /mnt2 rw,relatime shared:25 - ext4 /dev/sdb1 rw
+46 1 8:18 / /mnt-old rw,relatime - ext4 /dev/sdb2 rw
+47 40 8:19 / /mnt/data\040disk rw,relatime - xfs /dev/disk/by-label/data\040disk rw,attr2,inode64
+)"sv;
+
+auto mountpoints_of(const std::vector<const gucc::mtab::MountInfoEntry*>& entries) -> std::vector<std::string_view> {
+    std::vector<std::string_view> result{};
+    for (const auto* entry : entries) {
+        result.push_back(entry->mountpoint);
+    }
+    return result;
+}
+
+}  // namespace
+
+TEST_CASE("mount table test")
+{
+    SECTION("parse fields")
+    {
+        const auto& mount_table = gucc::mtab::MountTable::parse(MOUNTINFO_INSTALL_TEST);
+        REQUIRE(mount_table.has_value());
+        REQUIRE_EQ(mount_table->entries().size(), 11);
+
+        const auto* home = mount_table->find_by_id(41);
+        REQUIRE(home != nullptr);
+        REQUIRE_EQ(home->parent_id, 40);
+        REQUIRE_EQ(home->major, 259);
+        REQUIRE_EQ(home->minor, 3);
+        REQUIRE_EQ(home->root, "/@home"sv);
+        REQUIRE_EQ(home->mountpoint, "/mnt/home"sv);
+        REQUIRE_EQ(home->mount_opts, "rw,relatime"sv);
+        REQUIRE_EQ(home->fstype, "btrfs"sv);
+        REQUIRE_EQ(home->source, "/dev/nvme0n1p3"sv);
+        REQUIRE_EQ(home->super_opts, "rw,ssd,discard=async,space_cache=v2,subvolid=257,subvol=/@home"sv);
+
+        // no optional fields
+        const auto* old = mount_table->find_by_id(46);
+        REQUIRE(old != nullptr);
+        REQUIRE_EQ(old->fstype, "ext4"sv);
+
+        REQUIRE(mount_table->find_by_id(100) == nullptr);
+    }
+    SECTION("octal escapes")
+    {
+        const auto& mount_table = gucc::mtab::MountTable::parse(MOUNTINFO_INSTALL_TEST);
+        REQUIRE(mount_table.has_value());
+
+        const auto* data = mount_table->find_by_mountpoint("/mnt/data disk"sv);
+        REQUIRE(data != nullptr);
+        REQUIRE_EQ(data->source, "/dev/disk/by-label/data disk"sv);
+
+        REQUIRE_EQ(gucc::mtab::decode_mount_escapes("/a\\040b\\011c\\134d"sv), "/a b\tc\\d");
+        // not an escape
+        REQUIRE_EQ(gucc::mtab::decode_mount_escapes("/a\\09"sv), "/a\\09");
+    }
+    SECTION("lookup by mountpoint")
+    {
+        const auto& mount_table = gucc::mtab::MountTable::parse(MOUNTINFO_INSTALL_TEST);
+        REQUIRE(mount_table.has_value());
+
+        const auto* root = mount_table->find_by_mountpoint("/mnt/"sv);
+        REQUIRE(root != nullptr);
+        REQUIRE_EQ(root->mount_id, 40);
+
+        // the tmpfs covers the ESP
+        const auto* boot = mount_table->find_by_mountpoint("/mnt/boot"sv);
+        REQUIRE(boot != nullptr);
+        REQUIRE_EQ(boot->fstype, "tmpfs"sv);
+
+        REQUIRE(mount_table->find_by_mountpoint("/mnt/var"sv) == nullptr);
+    }
+    SECTION("mounts under a mountpoint")
+    {
+        const auto& mount_table = gucc::mtab::MountTable::parse(MOUNTINFO_INSTALL_TEST);
+        REQUIRE(mount_table.has_value());
+
+        const auto& mounts = mount_table->mounts_under("/mnt"sv);
+        const auto& mountpoints = mountpoints_of(mounts);
+        REQUIRE_EQ(mountpoints.size(), 6);
+        // /mnt2 and /mnt-old are not below /mnt
+        for (const auto mountpoint : mountpoints) {
+            REQUIRE(mountpoint != "/mnt2"sv);
+            REQUIRE(mountpoint != "/mnt-old"sv);
+        }
+        REQUIRE_EQ(mountpoints.back(), "/mnt"sv);
+
+        // every mount comes before its parent
+        for (std::size_t i = 0; i < mounts.size(); ++i) {
+            for (std::size_t j = i + 1; j < mounts.size(); ++j) {
+                REQUIRE(mounts[j]->parent_id != mounts[i]->mount_id);
+            }
+        }
+
+        REQUIRE_EQ(mountpoints_of(mount_table->mounts_under("/mnt/boot"sv)).size(), 3);
+        REQUIRE_EQ(mount_table->mounts_under("/"sv).size(), 11);
+        REQUIRE(mount_table->mounts_under("/srv"sv).empty());
+    }
+    SECTION("mounts under a plain directory")
+    {
+        // nothing is mounted on /target itself
+        static constexpr auto content = R"(1 1 0:28 / / rw - ext4 /dev/sda1 rw
+30 1 8:2 / /target/boot rw - vfat /dev/sda2 rw
+31 1 8:3 / /target/home rw - ext4 /dev/sda3 rw
+32 31 8:4 / /target/home/user rw - ext4 /dev/sda4 rw
+)"sv;
+        const auto& mount_table = gucc::mtab::MountTable::parse(content);
+        REQUIRE(mount_table.has_value());
+
+        const auto& mounts = mount_table->mounts_under("/target"sv);
+        REQUIRE_EQ(mounts.size(), 3);
+        const auto& mountpoints = mountpoints_of(mounts);
+        const auto user_it = std::ranges::find(mountpoints, "/target/home/user"sv);
+        const auto home_it = std::ranges::find(mountpoints, "/target/home"sv);
+        REQUIRE(user_it < home_it);
+    }
+    SECTION("malformed content")
+    {
+        REQUIRE(!gucc::mtab::MountTable::parse("22 1 0:21 / /proc rw\n"sv).has_value());
+        REQUIRE(!gucc::mtab::MountTable::parse("x 1 0:21 / /proc rw - proc proc rw\n"sv).has_value());
+
+        const auto& empty_table = gucc::mtab::MountTable::parse(""sv);
+        REQUIRE(empty_table.has_value());
+        REQUIRE(empty_table->entries().empty());
+    }
+}
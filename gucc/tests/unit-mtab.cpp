@@ -172,4 +172,12 @@ TEST_CASE("mtab test")
         // Cleanup.
         fs::remove(filename);
     }
+    SECTION("escaped paths")
+    {
+        static constexpr auto content = "/dev/sdb1 /mnt/data\\040disk ext4 rw,relatime 0 0\n"sv;
+
+        const auto& mtab_entries = gucc::mtab::parse_mtab_content(content, "/mnt"sv);
+        REQUIRE_EQ(mtab_entries.size(), 1);
+        REQUIRE_EQ(mtab_entries[0].mountpoint, "/mnt/data disk");
+    }
 }
@@ -0,0 +1,184 @@
+#include "doctest_compatibility.h"
+
+#include "test_http_server.hpp"
+#include "test_temp_root.hpp"
+
+#include "gucc/file_utils.hpp"
+#include "gucc/logger.hpp"
+#include "gucc/offline_bundle.hpp"
+#include "gucc/process.hpp"
+#include "gucc/sha256.hpp"
+#include "gucc/sync_db.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <spdlog/sinks/callback_sink.h>
+#include <spdlog/spdlog.h>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+static constexpr auto PACMAN_CONF = R"([options]
+HoldPkg     = pacman glibc
+SigLevel    = Required DatabaseOptional
+
+[core]
+Include = /etc/pacman.d/mirrorlist
+
+[extra]
+SigLevel = PackageRequired
+Server = https://mirror.example.org/$repo/os/$arch
+)"sv;
+
+static constexpr auto FOO_CONTENT = "foo package"sv;
+static constexpr auto BAR_CONTENT = "bar package"sv;
+
+auto make_desc(std::string_view name, std::string_view content, std::string_view extra = {}) -> std::string {
+    return fmt::format("%FILENAME%\n{0}-1-1-x86_64.pkg.tar.zst\n\n%NAME%\n{0}\n\n%VERSION%\n1-1\n\n%CSIZE%\n{1}\n\n%ISIZE%\n400\n\n%SHA256SUM%\n{2}\n\n{3}",
+        name, content.size(), gucc::hash::sha256_hex(content), extra);
+}
+
+}  // namespace
+
+TEST_CASE("offline bundle test")
+{
+    auto callback_sink = std::make_shared<spdlog::sinks::callback_sink_mt>([](const spdlog::details::log_msg&) {
+        // noop
+    });
+    auto logger = std::make_shared<spdlog::logger>("default", callback_sink);
+    spdlog::set_default_logger(logger);
+    gucc::logger::set_logger(logger);
+
+    SECTION("bundle servers")
+    {
+        const std::vector repos{"core"s};
+        REQUIRE_EQ(gucc::bundle::detail::with_bundle_servers(PACMAN_CONF, "/run/bundle"sv, repos),
+            "[options]\nHoldPkg     = pacman glibc\nSigLevel    = Required DatabaseOptional\n\n[core]\nServer = file:///run/bundle/repos/$repo\n\n");
+
+        // the repo keeps its other settings
+        const std::vector both{"core"s, "extra"s};
+        const auto& conf = gucc::bundle::detail::with_bundle_servers(PACMAN_CONF, "/run/bundle"sv, both);
+        REQUIRE(conf.ends_with("[extra]\nServer = file:///run/bundle/repos/$repo\nSigLevel = PackageRequired\n"sv));
+        REQUIRE_FALSE(conf.contains("mirror.example.org"sv));
+        REQUIRE_FALSE(conf.contains("Include"sv));
+    }
+    SECTION("build and use")
+    {
+        const gucc::tests::TempRoot root{"gucc-bundle"};
+        const auto& sync_dir   = root.path() / "sync";
+        const auto& bundle_dir = (root.path() / "bundle").string();
+        const auto& conf_path  = (root.path() / "pacman.conf").string();
+        fs::create_directories(sync_dir);
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(conf_path, PACMAN_CONF));
+
+        const std::vector core_entries{
+            gucc::syncdb::DbEntry{.dir = "foo-1-1"s, .desc = make_desc("foo"sv, FOO_CONTENT, "%DEPENDS%\nbar\n\n"sv)},
+            gucc::syncdb::DbEntry{.dir = "bar-1-1"s, .desc = make_desc("bar"sv, BAR_CONTENT)},
+            gucc::syncdb::DbEntry{.dir = "baz-1-1"s, .desc = make_desc("baz"sv, "baz"sv)},
+        };
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((sync_dir / "core.db").string(), gucc::syncdb::write_db_tar(core_entries)));
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((sync_dir / "extra.db").string(), gucc::syncdb::write_db_tar({})));
+
+        // fetched by an earlier build, nothing is left to download
+        const auto& core_dir = gucc::bundle::repo_dir(bundle_dir, "core"sv);
+        fs::create_directories(core_dir);
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(core_dir + "/foo-1-1-x86_64.pkg.tar.zst", FOO_CONTENT));
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(core_dir + "/foo-1-1-x86_64.pkg.tar.zst.sig", "sig"sv));
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(core_dir + "/bar-1-1-x86_64.pkg.tar.zst", BAR_CONTENT));
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(core_dir + "/bar-1-1-x86_64.pkg.tar.zst.sig", "sig"sv));
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(core_dir + "/foo-0.9-1-x86_64.pkg.tar.zst", "old"sv));
+
+        const gucc::bundle::BuildOptions options{.pacman_config = conf_path, .sync_dir = sync_dir.string()};
+        const std::vector targets{"foo"s};
+        const auto& built = gucc::bundle::build(bundle_dir, targets, options);
+        REQUIRE(built);
+        REQUIRE_EQ(built->packages, 2);
+        REQUIRE_EQ(built->download_size, FOO_CONTENT.size() + BAR_CONTENT.size());
+        REQUIRE_FALSE(fs::exists(core_dir + "/foo-0.9-1-x86_64.pkg.tar.zst"));
+
+        // the bundle db carries what was bundled
+        const auto& bundled = gucc::syncdb::read_db_entries(core_dir + "/core.db");
+        REQUIRE(bundled);
+        REQUIRE_EQ(bundled->size(), 2);
+        REQUIRE_EQ(bundled->front().desc, core_entries[0].desc);
+        const auto& extra = gucc::syncdb::read_db_entries(gucc::bundle::repo_dir(bundle_dir, "extra"sv) + "/extra.db");
+        REQUIRE(extra);
+        REQUIRE(extra->empty());
+
+        const std::vector missing_targets{"nope"s};
+        REQUIRE(gucc::bundle::build(bundle_dir, missing_targets, options).error().code == gucc::ErrorCode::NotFound);
+
+        // a repo the bundle lacks is dropped
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(conf_path, fmt::format("{}\n[multilib]\nInclude = /etc/pacman.d/mirrorlist\n", PACMAN_CONF)));
+        REQUIRE(gucc::bundle::use_bundle(conf_path, bundle_dir));
+        const auto& conf = gucc::file_utils::read_whole_file(conf_path);
+        REQUIRE(conf.contains(fmt::format("[core]\nServer = file://{}/repos/$repo\n", bundle_dir)));
+        REQUIRE(conf.contains("[extra]"sv));
+        REQUIRE_FALSE(conf.contains("[multilib]"sv));
+
+        REQUIRE(gucc::bundle::use_bundle(conf_path, (root.path() / "nope").string()).error().code == gucc::ErrorCode::NotFound);
+    }
+    SECTION("build from fresh sync dbs")
+    {
+        const gucc::tests::TempRoot root{"gucc-bundle-sync"};
+        const auto& bundle_dir = (root.path() / "bundle").string();
+        const auto& conf_path  = (root.path() / "pacman.conf").string();
+
+        const std::vector core_entries{
+            gucc::syncdb::DbEntry{.dir = "foo-1-1"s, .desc = make_desc("foo"sv, FOO_CONTENT, "%DEPENDS%\nbar\n\n"sv)},
+            gucc::syncdb::DbEntry{.dir = "bar-1-1"s, .desc = make_desc("bar"sv, BAR_CONTENT)},
+        };
+        const gucc::tests::LocalHttpServer mirror{gucc::tests::LocalHttpServer::Files{
+            {"/core/core.db", gucc::syncdb::write_db_tar(core_entries)},
+            {"/core/foo-1-1-x86_64.pkg.tar.zst", std::string{FOO_CONTENT}},
+            {"/core/foo-1-1-x86_64.pkg.tar.zst.sig", "sig"s},
+            {"/core/bar-1-1-x86_64.pkg.tar.zst", std::string{BAR_CONTENT}},
+            {"/core/bar-1-1-x86_64.pkg.tar.zst.sig", "sig"s},
+        }};
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(conf_path, fmt::format("[options]\nSigLevel = Required\n\n[core]\nServer = {}/$repo\n", mirror.url())));
+
+        // a db left from an earlier build is fetched again
+        fs::create_directories(fs::path{bundle_dir} / "sync");
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(bundle_dir + "/sync/core.db", gucc::syncdb::write_db_tar({})));
+
+        const std::vector targets{"foo"s};
+        const auto& built = gucc::bundle::build(bundle_dir, targets, {.pacman_config = conf_path});
+        REQUIRE(built);
+        REQUIRE_EQ(built->packages, 2);
+        REQUIRE_EQ(gucc::file_utils::read_whole_file(bundle_dir + "/sync/core.db"), gucc::syncdb::write_db_tar(core_entries));
+        REQUIRE(fs::exists(gucc::bundle::repo_dir(bundle_dir, "core"sv) + "/foo-1-1-x86_64.pkg.tar.zst"));
+    }
+    SECTION("attach and detach")
+    {
+        const gucc::tests::TempRoot root{"gucc-bundle-attach"};
+        const auto& bundle_dir = "/run/cachyos bundle"s;
+        const auto& mountpoint = (root.path() / "target").string();
+        const auto& host_conf  = (root.path() / "pacman.conf").string();
+        const auto& target_dir = root.path() / "target/run/cachyos bundle";
+        fs::create_directories(root.path() / "target/etc");
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(host_conf, PACMAN_CONF));
+
+        // nothing is bind mounted, not even the directory is created
+        auto& runner = gucc::utils::default_runner();
+        runner.set_dry_run(true);
+        const auto& attached = gucc::bundle::attach(bundle_dir, mountpoint + "/");
+        runner.set_dry_run(false);
+        REQUIRE(attached);
+        REQUIRE_FALSE(fs::exists(target_dir));
+
+        // not a mountpoint, so the directory isn't ours to remove. Only the config goes back
+        fs::create_directories(target_dir);
+        REQUIRE(gucc::bundle::detach(bundle_dir, mountpoint, host_conf));
+        REQUIRE(fs::exists(target_dir));
+        REQUIRE_EQ(gucc::file_utils::read_whole_file(mountpoint + "/etc/pacman.conf"), PACMAN_CONF);
+    }
+}
@@ -0,0 +1,103 @@
+#include "doctest_compatibility.h"
+
+#include "test_temp_root.hpp"
+
+#include "gucc/file_utils.hpp"
+#include "gucc/logger.hpp"
+#include "gucc/package_cache.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <spdlog/sinks/callback_sink.h>
+#include <spdlog/spdlog.h>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+static constexpr auto PACMAN_CONF = R"([options]
+#RootDir     = /
+#CacheDir    = /var/cache/pacman/pkg/
+HoldPkg     = pacman glibc
+
+[core]
+Include = /etc/pacman.d/mirrorlist
+)"sv;
+
+}  // namespace
+
+TEST_CASE("package cache test")
+{
+    auto callback_sink = std::make_shared<spdlog::sinks::callback_sink_mt>([](const spdlog::details::log_msg&) {
+        // noop
+    });
+    auto logger = std::make_shared<spdlog::logger>("default", callback_sink);
+    spdlog::set_default_logger(logger);
+    gucc::logger::set_logger(logger);
+
+    const std::vector cache_dirs{"/mnt/var/cache/pacman/pkg"s, "/var/cache/pacman/pkg"s};
+
+    SECTION("cache dirs")
+    {
+        // the commented out default turns into ours
+        REQUIRE_EQ(gucc::pkgcache::detail::with_cache_dirs(PACMAN_CONF, cache_dirs),
+            "[options]\n#RootDir     = /\nCacheDir = /mnt/var/cache/pacman/pkg\nCacheDir = /var/cache/pacman/pkg\nHoldPkg     = pacman glibc\n\n[core]\nInclude = /etc/pacman.d/mirrorlist\n");
+
+        // and is replaced once set
+        const std::vector other{"/other"s};
+        const auto& conf = gucc::pkgcache::detail::with_cache_dirs(gucc::pkgcache::detail::with_cache_dirs(PACMAN_CONF, cache_dirs), other);
+        REQUIRE(conf.contains("\nCacheDir = /other\nHoldPkg"sv));
+        REQUIRE_FALSE(conf.contains("/mnt/var/cache"sv));
+
+        // added right after [options] when missing
+        REQUIRE_EQ(gucc::pkgcache::detail::with_cache_dirs("[options]\nColor\n\n[core]\nInclude = x"sv, other),
+            "[options]\nCacheDir = /other\nColor\n\n[core]\nInclude = x");
+        // a CacheDir key in a repo section is not ours to touch
+        REQUIRE_EQ(gucc::pkgcache::detail::with_cache_dirs("[core]\nCacheDir = x"sv, other),
+            "[core]\nCacheDir = x\n[options]\nCacheDir = /other\n");
+    }
+    SECTION("target cache")
+    {
+        const gucc::tests::TempRoot root{"gucc-pkgcache"};
+        const auto& conf_path = (root.path() / "pacman.conf").string();
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(conf_path, PACMAN_CONF));
+
+        const auto& mountpoint = (root.path() / "mnt").string();
+        const auto& target_dir = gucc::pkgcache::use_target_cache(conf_path, mountpoint);
+        REQUIRE(target_dir);
+        REQUIRE_EQ(*target_dir, mountpoint + "/var/cache/pacman/pkg");
+        REQUIRE(fs::is_directory(*target_dir));
+        REQUIRE(gucc::file_utils::read_whole_file(conf_path).contains(fmt::format("CacheDir = {}\nCacheDir = /var/cache/pacman/pkg\n", *target_dir)));
+    }
+    SECTION("prune")
+    {
+        REQUIRE(gucc::pkgcache::detail::is_cache_file("linux-6.12.1-1-x86_64.pkg.tar.zst"sv));
+        REQUIRE(gucc::pkgcache::detail::is_cache_file("linux-6.12.1-1-x86_64.pkg.tar.zst.sig"sv));
+        REQUIRE(gucc::pkgcache::detail::is_cache_file("linux-6.12.1-1-x86_64.pkg.tar.zst.part"sv));
+        REQUIRE_FALSE(gucc::pkgcache::detail::is_cache_file("notes.txt"sv));
+
+        const gucc::tests::TempRoot root{"gucc-pkgcache-prune"};
+        const auto& cache_dir = root.path().string();
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(cache_dir + "/a-1-1-any.pkg.tar.zst", "12345"sv));
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(cache_dir + "/a-1-1-any.pkg.tar.zst.sig", "1"sv));
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(cache_dir + "/keep.txt", "1"sv));
+        fs::create_directories(root.path() / "download-abc123");
+
+        const auto& pruned = gucc::pkgcache::prune(cache_dir);
+        REQUIRE(pruned);
+        REQUIRE_EQ(pruned->files, 2);
+        REQUIRE_EQ(pruned->bytes, 6);
+        REQUIRE(fs::exists(root.path() / "keep.txt"));
+        REQUIRE_FALSE(fs::exists(root.path() / "download-abc123"));
+
+        REQUIRE(gucc::pkgcache::prune((root.path() / "missing").string()).error().code == gucc::ErrorCode::FileIo);
+    }
+}
@@ -0,0 +1,185 @@
+#include "doctest_compatibility.h"
+
+#include "test_http_server.hpp"
+#include "test_temp_root.hpp"
+
+#include "gucc/file_utils.hpp"
+#include "gucc/package_download.hpp"
+#include "gucc/sha256.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+using namespace std::chrono_literals;
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace fs = std::filesystem;
+
+using gucc::download::PackageFile;
+using gucc::tests::LocalHttpServer;
+
+namespace {
+
+auto make_package(std::string_view filename, std::string_view content) -> PackageFile {
+    return PackageFile{.repo = "core"s, .filename = std::string{filename}, .size = content.size(), .sha256sum = gucc::hash::sha256_hex(content)};
+}
+
+auto repo_files(const std::vector<std::pair<std::string, std::string>>& files) -> LocalHttpServer::Files {
+    LocalHttpServer::Files served{};
+    for (const auto& [filename, content] : files) {
+        served.emplace(fmt::format("/core/os/x86_64/{}", filename), content);
+        served.emplace(fmt::format("/core/os/x86_64/{}.sig", filename), "signature of " + filename);
+    }
+    return served;
+}
+
+auto server_of(const LocalHttpServer& server) -> std::string {
+    return fmt::format("{}/$repo/os/$arch", server.url());
+}
+
+}  // namespace
+
+TEST_CASE("package download test")
+{
+    SECTION("sha256")
+    {
+        REQUIRE_EQ(gucc::hash::sha256_hex(""sv), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+        REQUIRE_EQ(gucc::hash::sha256_hex("abc"sv), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        REQUIRE_EQ(gucc::hash::sha256_hex("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"sv), "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+
+        // fed in uneven pieces
+        const std::string million(1000000, 'a');
+        gucc::hash::Sha256 hasher{};
+        for (std::size_t offset = 0; offset < million.size(); offset += 4099) {
+            hasher.update(std::string_view{million}.substr(offset, 4099));
+        }
+        REQUIRE_EQ(hasher.finish(), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+        const gucc::tests::TempRoot root{"gucc-sha256"};
+        const auto& file_path = (root.path() / "file").string();
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(file_path, million));
+        REQUIRE_EQ(gucc::hash::sha256_file(file_path), "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"s);
+        REQUIRE_FALSE(gucc::hash::sha256_file((root.path() / "missing").string()));
+    }
+    SECTION("parse status line")
+    {
+        REQUIRE_EQ(gucc::download::detail::parse_status_line("HTTP/1.1 206 Partial Content\r\n"sv), 206);
+        REQUIRE_EQ(gucc::download::detail::parse_status_line("HTTP/2 200\r\n"sv), 200);
+        REQUIRE_FALSE(gucc::download::detail::parse_status_line("Content-Length: 200\r\n"sv));
+        REQUIRE_FALSE(gucc::download::detail::parse_status_line("HTTP/1.1"sv));
+    }
+    SECTION("repo servers")
+    {
+        const gucc::tests::TempRoot root{"gucc-repo-servers"};
+        const auto& mirrorlist_path = (root.path() / "mirrorlist").string();
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(mirrorlist_path, "Server = https://a/$repo/os/$arch\n#Server = https://off/$repo\nServer = https://b/$repo/os/$arch\n"sv));
+
+        const auto& conf = fmt::format("[options]\nServer = https://ignored\n\n[core]\nInclude = {0}\n\n# [testing]\n[cachyos]\nServer = https://c/$arch/$repo\nInclude = {0}\n", mirrorlist_path);
+        const auto& conf_path = (root.path() / "pacman.conf").string();
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(conf_path, conf));
+
+        const auto& servers = gucc::download::repo_servers(conf_path);
+        REQUIRE_EQ(servers.size(), 2);
+        const std::vector core{"https://a/$repo/os/$arch"s, "https://b/$repo/os/$arch"s};
+        const std::vector cachyos{"https://c/$arch/$repo"s, "https://a/$repo/os/$arch"s, "https://b/$repo/os/$arch"s};
+        REQUIRE_EQ(servers.at("core"), core);
+        REQUIRE_EQ(servers.at("cachyos"), cachyos);
+    }
+    SECTION("download over several mirrors")
+    {
+        const gucc::tests::TempRoot root{"gucc-download"};
+        const std::vector<std::pair<std::string, std::string>> files{
+            {"linux-6.11-1-x86_64.pkg.tar.zst"s, std::string(200 * 1024, 'l')},
+            {"glibc-2.40-1-x86_64.pkg.tar.zst"s, std::string(120 * 1024, 'g')},
+            {"bash-5.2-1-x86_64.pkg.tar.zst"s, std::string(80 * 1024, 'b')},
+            {"zstd-1.5-1-x86_64.pkg.tar.zst"s, std::string(40 * 1024, 'z')},
+        };
+        // slow enough for the transfers to overlap
+        const LocalHttpServer first{repo_files(files), 0ms, 5ms};
+        const LocalHttpServer second{repo_files(files), 0ms, 5ms};
+
+        std::vector<PackageFile> packages{};
+        for (const auto& [filename, content] : files) {
+            packages.push_back(make_package(filename, content));
+        }
+        const gucc::download::RepoServers servers{{"core"s, {server_of(first), server_of(second)}}};
+        const gucc::download::DownloadOptions options{
+            .cache_dir              = (root.path() / "pkg").string(),
+            .max_connections        = 4,
+            .connections_per_mirror = 2,
+            .verify_workers         = 2,
+        };
+
+        const auto& result = gucc::download::download_packages(packages, servers, options);
+        REQUIRE(result);
+        REQUIRE(result->failed.empty());
+        REQUIRE_EQ(result->downloaded, 8);
+        REQUIRE_EQ(result->cached, 0);
+        for (const auto& [filename, content] : files) {
+            REQUIRE_EQ(gucc::file_utils::read_whole_file((root.path() / "pkg" / filename).string()), content);
+            REQUIRE_EQ(gucc::file_utils::read_whole_file((root.path() / "pkg" / (filename + ".sig")).string()), "signature of " + filename);
+            REQUIRE_FALSE(fs::exists(root.path() / "pkg" / (filename + ".part")));
+        }
+        // the best ranked mirror filled up, the rest went to the next one
+        REQUIRE(first.max_concurrent() <= 2);
+        REQUIRE(second.max_concurrent() <= 2);
+        REQUIRE(first.requests() > 0);
+        REQUIRE(second.requests() > 0);
+
+        // a second run finds everything in the cache
+        const auto requests = first.requests() + second.requests();
+        const auto& again   = gucc::download::download_packages(packages, servers, options);
+        REQUIRE(again);
+        REQUIRE_EQ(again->cached, 8);
+        REQUIRE_EQ(again->downloaded, 0);
+        REQUIRE_EQ(first.requests() + second.requests(), requests);
+    }
+    SECTION("corrupt mirror and resume")
+    {
+        const gucc::tests::TempRoot root{"gucc-download-resume"};
+        const auto& content  = std::string(96 * 1024, 'p') + std::string(32 * 1024, 'q');
+        const auto& filename = "pacman-7.0-1-x86_64.pkg.tar.zst"s;
+        // the best ranked mirror carries a broken copy
+        const LocalHttpServer corrupt{repo_files({{filename, std::string(content.size(), 'x')}})};
+        const LocalHttpServer good{repo_files({{filename, content}})};
+
+        const gucc::download::RepoServers servers{{"core"s, {server_of(corrupt), server_of(good)}}};
+        const auto& cache_dir = root.path() / "pkg";
+        const std::vector packages{make_package(filename, content)};
+        const gucc::download::DownloadOptions options{.cache_dir = cache_dir.string(), .signatures = false};
+
+        const auto& result = gucc::download::download_packages(packages, servers, options);
+        REQUIRE(result);
+        REQUIRE(result->failed.empty());
+        REQUIRE_EQ(result->downloaded, 1);
+        REQUIRE_EQ(gucc::file_utils::read_whole_file((cache_dir / filename).string()), content);
+
+        // an interrupted transfer continues where it stopped
+        fs::remove(cache_dir / filename);
+        REQUIRE(gucc::file_utils::create_file_for_overwrite((cache_dir / (filename + ".part")).string(), std::string_view{content}.substr(0, 96 * 1024)));
+        const gucc::download::RepoServers good_only{{"core"s, {server_of(good)}}};
+        const auto& resumed = gucc::download::download_packages(packages, good_only, options);
+        REQUIRE(resumed);
+        REQUIRE_EQ(resumed->resumed, 1);
+        REQUIRE_EQ(resumed->bytes, 32 * 1024);
+        REQUIRE_EQ(gucc::file_utils::read_whole_file((cache_dir / filename).string()), content);
+    }
+    SECTION("missing everywhere")
+    {
+        const gucc::tests::TempRoot root{"gucc-download-missing"};
+        const LocalHttpServer mirror{repo_files({{"other-1.0-1-any.pkg.tar.zst"s, "other"s}})};
+        const gucc::download::RepoServers servers{{"core"s, {server_of(mirror)}}};
+        const std::vector packages{make_package("gone-1.0-1-any.pkg.tar.zst"sv, "gone"sv), PackageFile{.repo = "extra"s, .filename = "elsewhere-1.0-1-any.pkg.tar.zst"s}};
+
+        const auto& result = gucc::download::download_packages(packages, servers, {.cache_dir = (root.path() / "pkg").string()});
+        REQUIRE(result);
+        REQUIRE_EQ(result->downloaded, 0);
+        REQUIRE_EQ(result->failed.size(), 4);
+    }
+}
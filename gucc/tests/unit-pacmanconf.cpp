@@ -152,4 +152,14 @@ TEST_CASE("pacman conf test")
         // Cleanup.
         fs::remove(filename);
     }
+    SECTION("options key")
+    {
+        // a repeated key is set once, the repo sections keep theirs
+        static constexpr std::string_view conf{"[options]\n#CacheDir = /a\nColor\nCacheDir = /b\n\n[core]\nCacheDir = /c\n"};
+        REQUIRE_EQ(detail::pacmanconf::with_options_key(conf, "CacheDir", "CacheDir = /x\nCacheDir = /y\n"),
+            "[options]\nCacheDir = /x\nCacheDir = /y\nColor\n\n[core]\nCacheDir = /c\n");
+
+        // nothing to set drops the key
+        REQUIRE_EQ(detail::pacmanconf::with_options_key(conf, "CacheDir", ""), "[options]\nColor\n\n[core]\nCacheDir = /c\n");
+    }
 }
@@ -0,0 +1,208 @@
+#include "doctest_compatibility.h"
+
+#include "gucc/partition_table.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace {
+
+constexpr std::uint64_t MiB = 1024ULL * 1024ULL;
+constexpr std::uint64_t GiB = 1024ULL * MiB;
+
+auto read_le64(std::span<const std::uint8_t> buf, std::size_t offset) -> std::uint64_t {
+    std::uint64_t value{};
+    for (std::size_t i = 0; i < 8; ++i) {
+        value |= static_cast<std::uint64_t>(buf[offset + i]) << (i * 8);
+    }
+    return value;
+}
+
+auto read_le32(std::span<const std::uint8_t> buf, std::size_t offset) -> std::uint32_t {
+    return static_cast<std::uint32_t>(read_le64(buf, offset) & 0xFFFFFFFFULL);
+}
+
+}  // namespace
+
+TEST_CASE("partition table test")
+{
+    using gucc::disk::DiskGeometry;
+    using gucc::disk::PartitionTableType;
+
+    SECTION("parse partition size")
+    {
+        using gucc::disk::parse_partition_size;
+
+        REQUIRE_EQ(parse_partition_size("2G"sv, 512, 0), 2 * GiB);
+        REQUIRE_EQ(parse_partition_size("4GiB"sv, 512, 0), 4 * GiB);
+        REQUIRE_EQ(parse_partition_size("512M"sv, 512, 0), 512 * MiB);
+        REQUIRE_EQ(parse_partition_size("10GB"sv, 512, 0), 10'000'000'000ULL);
+        REQUIRE_EQ(parse_partition_size("2048"sv, 512, 0), 2048 * 512ULL);
+        REQUIRE_EQ(parse_partition_size("2048"sv, 4096, 0), 2048 * 4096ULL);
+        REQUIRE_EQ(parse_partition_size("50%"sv, 512, 100 * GiB), 50 * GiB);
+        REQUIRE(!parse_partition_size(""sv, 512, 0));
+        REQUIRE(!parse_partition_size("G"sv, 512, 0));
+        REQUIRE(!parse_partition_size("12X"sv, 512, 0));
+        REQUIRE(!parse_partition_size("150%"sv, 512, 0));
+    }
+    SECTION("guid round trip")
+    {
+        using gucc::disk::detail::format_guid;
+        using gucc::disk::detail::parse_guid;
+
+        const auto guid = parse_guid("C12A7328-F81F-11D2-BA4B-00A0C93EC93B"sv);
+        REQUIRE(guid);
+        // mixed endian on-disk layout
+        REQUIRE_EQ((*guid)[0], 0x28);
+        REQUIRE_EQ((*guid)[3], 0xC1);
+        REQUIRE_EQ((*guid)[8], 0xBA);
+        REQUIRE_EQ((*guid)[15], 0x3B);
+        REQUIRE_EQ(format_guid(*guid), "C12A7328-F81F-11D2-BA4B-00A0C93EC93B"s);
+        REQUIRE(!parse_guid("C12A7328F81F11D2BA4B00A0C93EC93B"sv));
+        REQUIRE(!parse_guid("Z12A7328-F81F-11D2-BA4B-00A0C93EC93B"sv));
+    }
+    SECTION("crc32")
+    {
+        static constexpr auto CHECK_INPUT = "123456789"sv;
+        const std::vector<std::uint8_t> data(CHECK_INPUT.begin(), CHECK_INPUT.end());
+        REQUIRE_EQ(gucc::disk::detail::crc32(data), 0xCBF43926U);
+    }
+    SECTION("gpt layout")
+    {
+        const std::vector<gucc::fs::Partition> partitions{
+            gucc::fs::Partition{.fstype = "vfat"s, .mountpoint = "/boot"s, .device = "/dev/nvme0n1p1"s, .size = "2G"s},
+            gucc::fs::Partition{.fstype = "linuxswap"s, .mountpoint = ""s, .device = "/dev/nvme0n1p2"s, .size = "16G"s},
+            gucc::fs::Partition{.fstype = "btrfs"s, .mountpoint = "/"s, .device = "/dev/nvme0n1p3"s},
+            gucc::fs::Partition{.fstype = "btrfs"s, .mountpoint = "/home"s, .device = "/dev/nvme0n1p3"s, .subvolume = "/@home"s},
+        };
+        const DiskGeometry geometry{.logical_sector_size = 512, .size_bytes = 100 * GiB};
+
+        const auto& layout = gucc::disk::plan_partition_table("/dev/nvme0n1"sv, partitions, geometry, true);
+        REQUIRE(layout);
+        REQUIRE_EQ(layout->type, PartitionTableType::Gpt);
+        REQUIRE_EQ(layout->first_usable_lba, 34);
+        REQUIRE_EQ(layout->last_usable_lba, (100 * GiB / 512) - 34);
+        REQUIRE_EQ(layout->entries.size(), 3);
+
+        const auto& esp = layout->entries[0];
+        REQUIRE_EQ(esp.device, "/dev/nvme0n1p1"s);
+        REQUIRE_EQ(esp.start_lba, 2048);
+        REQUIRE_EQ((esp.end_lba - esp.start_lba + 1) * 512, 2 * GiB);
+        REQUIRE(esp.bootable);
+        REQUIRE_EQ(gucc::disk::detail::format_guid(esp.type_guid), "C12A7328-F81F-11D2-BA4B-00A0C93EC93B"s);
+
+        const auto& swap = layout->entries[1];
+        REQUIRE_EQ(swap.start_lba, esp.end_lba + 1);
+        REQUIRE_EQ(gucc::disk::detail::format_guid(swap.type_guid), "0657FD6D-A4AB-43C4-84E5-0933C84B4F4F"s);
+
+        // fill partition ends on the last aligned sector
+        const auto& root = layout->entries[2];
+        REQUIRE_EQ(root.device, "/dev/nvme0n1p3"s);
+        REQUIRE_EQ((root.end_lba + 1) % 2048, 0);
+        REQUIRE(root.end_lba <= layout->last_usable_lba);
+        REQUIRE_EQ(gucc::disk::detail::format_guid(root.type_guid), "0FC63DAF-8483-4772-8E79-3D69D8477DE4"s);
+
+        const auto& entries    = gucc::disk::detail::serialize_gpt_entries(*layout);
+        const auto entries_crc = gucc::disk::detail::crc32(std::span{entries}.first(128 * 128));
+        REQUIRE_EQ(entries.size(), 128 * 128);
+        REQUIRE_EQ(read_le64(entries, 32), 2048);
+        REQUIRE_EQ(read_le64(entries, 128 + 32), swap.start_lba);
+
+        const auto& header = gucc::disk::detail::serialize_gpt_header(*layout, entries_crc, true);
+        const std::string_view signature(reinterpret_cast<const char*>(header.data()), 8);
+        REQUIRE_EQ(signature, "EFI PART"sv);
+        REQUIRE_EQ(read_le64(header, 24), 1);
+        REQUIRE_EQ(read_le64(header, 32), (100 * GiB / 512) - 1);
+        REQUIRE_EQ(read_le32(header, 88), entries_crc);
+
+        // header crc covers the header with the crc field zeroed
+        auto header_copy = std::vector<std::uint8_t>(header.begin(), header.begin() + 92);
+        std::fill_n(header_copy.begin() + 16, 4, std::uint8_t{0});
+        REQUIRE_EQ(read_le32(header, 16), gucc::disk::detail::crc32(header_copy));
+
+        const auto& backup = gucc::disk::detail::serialize_gpt_header(*layout, entries_crc, false);
+        REQUIRE_EQ(read_le64(backup, 24), (100 * GiB / 512) - 1);
+        REQUIRE_EQ(read_le64(backup, 72), layout->last_usable_lba + 1);
+
+        const auto& mbr = gucc::disk::detail::serialize_mbr(*layout);
+        REQUIRE_EQ(mbr[446 + 4], 0xEE);
+        REQUIRE_EQ(mbr[510], 0x55);
+        REQUIRE_EQ(mbr[511], 0xAA);
+    }
+    SECTION("gpt layout on 4k sectors")
+    {
+        const std::vector<gucc::fs::Partition> partitions{
+            gucc::fs::Partition{.fstype = "vfat"s, .mountpoint = "/boot"s, .device = "/dev/sda1"s, .size = "4GiB"s},
+            gucc::fs::Partition{.fstype = "xfs"s, .mountpoint = "/"s, .device = "/dev/sda2"s},
+        };
+        const DiskGeometry geometry{.logical_sector_size = 4096, .size_bytes = 64 * GiB};
+
+        const auto& layout = gucc::disk::plan_partition_table("/dev/sda"sv, partitions, geometry, true);
+        REQUIRE(layout);
+        REQUIRE_EQ(layout->first_usable_lba, 6);
+        REQUIRE_EQ(layout->entries[0].start_lba, 256);
+        REQUIRE_EQ(layout->entries[1].device, "/dev/sda2"s);
+        REQUIRE_EQ(gucc::disk::detail::serialize_gpt_entries(*layout).size(), 128 * 128);
+    }
+    SECTION("dos layout")
+    {
+        const std::vector<gucc::fs::Partition> partitions{
+            gucc::fs::Partition{.fstype = "ext4"s, .mountpoint = "/boot"s, .device = "/dev/sda1"s, .size = "1GiB"s},
+            gucc::fs::Partition{.fstype = "ext4"s, .mountpoint = "/"s, .device = "/dev/sda2"s, .size = "100%"s},
+        };
+        const DiskGeometry geometry{.logical_sector_size = 512, .size_bytes = 20 * GiB};
+
+        const auto& layout = gucc::disk::plan_partition_table("/dev/sda"sv, partitions, geometry, false);
+        REQUIRE(layout);
+        REQUIRE_EQ(layout->type, PartitionTableType::Dos);
+        REQUIRE_EQ(layout->entries.size(), 2);
+        REQUIRE_EQ(layout->entries[1].end_lba, (20 * GiB / 512) - 1);
+
+        const auto& mbr = gucc::disk::detail::serialize_mbr(*layout);
+        REQUIRE_EQ(mbr[446], 0x00);
+        REQUIRE_EQ(mbr[446 + 4], 0x83);
+        REQUIRE_EQ(read_le32(mbr, 446 + 8), 2048);
+        REQUIRE_EQ(read_le32(mbr, 446 + 12), 1 * GiB / 512);
+        REQUIRE_EQ(read_le32(mbr, 462 + 8), 2048 + (1 * GiB / 512));
+        REQUIRE_EQ(mbr[510], 0x55);
+        REQUIRE_EQ(mbr[511], 0xAA);
+    }
+    SECTION("invalid schemas")
+    {
+        const DiskGeometry geometry{.logical_sector_size = 512, .size_bytes = 8 * GiB};
+
+        REQUIRE(!gucc::disk::plan_partition_table("/dev/sda"sv, {}, geometry, true));
+
+        const std::vector<gucc::fs::Partition> too_big{
+            gucc::fs::Partition{.fstype = "vfat"s, .mountpoint = "/boot"s, .device = "/dev/sda1"s, .size = "16G"s},
+        };
+        const auto& too_big_res = gucc::disk::plan_partition_table("/dev/sda"sv, too_big, geometry, true);
+        REQUIRE(!too_big_res);
+        REQUIRE_EQ(too_big_res.error().code, gucc::ErrorCode::InvalidArgument);
+
+        const std::vector<gucc::fs::Partition> bad_size{
+            gucc::fs::Partition{.fstype = "vfat"s, .mountpoint = "/boot"s, .device = "/dev/sda1"s, .size = "2Q"s},
+        };
+        const auto& bad_size_res = gucc::disk::plan_partition_table("/dev/sda"sv, bad_size, geometry, true);
+        REQUIRE(!bad_size_res);
+        REQUIRE_EQ(bad_size_res.error().code, gucc::ErrorCode::ParseError);
+
+        const std::vector<gucc::fs::Partition> too_many{
+            gucc::fs::Partition{.fstype = "ext4"s, .device = "/dev/sda1"s, .size = "1G"s},
+            gucc::fs::Partition{.fstype = "ext4"s, .device = "/dev/sda2"s, .size = "1G"s},
+            gucc::fs::Partition{.fstype = "ext4"s, .device = "/dev/sda3"s, .size = "1G"s},
+            gucc::fs::Partition{.fstype = "ext4"s, .device = "/dev/sda4"s, .size = "1G"s},
+            gucc::fs::Partition{.fstype = "ext4"s, .mountpoint = "/"s, .device = "/dev/sda5"s},
+        };
+        const auto& too_many_res = gucc::disk::plan_partition_table("/dev/sda"sv, too_many, geometry, false);
+        REQUIRE(!too_many_res);
+        REQUIRE_EQ(too_many_res.error().code, gucc::ErrorCode::Unsupported);
+    }
+}
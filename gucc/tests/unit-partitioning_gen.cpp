@@ -288,6 +288,23 @@ TEST_CASE("partitioning_gen")
             REQUIRE_EQ(partitions[1].mountpoint, "/"sv);
             REQUIRE_EQ(partitions[1].mount_opts, "defaults,noatime,compress=zstd:1"sv);
         }
+        SECTION("sizes aligned to device topology")
+        {
+            gucc::fs::DefaultPartitionSchemaConfig config{
+                .root_fs_type        = gucc::fs::FilesystemType::Xfs,
+                .efi_partition_size  = "1000KiB"s,
+                .swap_partition_size = "8GiB"s,
+                .is_ssd              = true,
+                .boot_mountpoint     = "/boot"s,
+                .alignment_bytes     = 3 * 1024 * 1024,
+            };
+            const auto& partitions = gucc::disk::generate_partition_schema_from_config("/dev/md0"sv, config, true);
+            REQUIRE_EQ(partitions.size(), 3);
+            REQUIRE_EQ(partitions[0].device, "/dev/md0p1"sv);
+            REQUIRE_EQ(partitions[0].size, "3MiB"sv);
+            REQUIRE_EQ(partitions[1].size, "8193MiB"sv);
+            REQUIRE(partitions[2].size.empty());
+        }
     }
     SECTION("partition schema validation test")
     {
@@ -0,0 +1,233 @@
+#include "doctest_compatibility.h"
+
+#include "test_temp_root.hpp"
+
+#include "gucc/file_utils.hpp"
+#include "gucc/logger.hpp"
+#include "gucc/package_list.hpp"
+#include "gucc/profile_index.hpp"
+#include "gucc/sha256.hpp"
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/sinks/callback_sink.h>
+#include <spdlog/spdlog.h>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace fs = std::filesystem;
+
+using gucc::profile::ProfileIndex;
+
+namespace {
+
+static constexpr auto VENDORED = R"(
+[base-packages]
+packages = ["base", "base-devel"]
+[base-packages.desktop]
+packages = ["xorg"]
+
+[desktop.kde]
+packages = ["plasma-desktop", "konsole"]
+
+[desktop.xorg]
+packages = ["xorg-server"]
+
+[services]
+units = [
+  { name = "NetworkManager", action = "enable" },
+  { name = "sshd", action = "disable", urgent = true },
+]
+[services.desktop]
+units = [
+  { name = "pipewire", user = true },
+]
+
+[[netinstall.group]]
+name = "Gaming"
+description = "vendored gaming"
+icon = "applications-games"
+packages = ["steam"]
+
+  [[netinstall.group.subgroup]]
+  name = "Gaming Extras"
+  hidden = true
+  packages = ["lutris"]
+
+    [[netinstall.group.subgroup.subgroup]]
+    name = "Emulators"
+    packages = ["retroarch"]
+
+[[netinstall.group]]
+name = "Common"
+critical = true
+bundle = true
+packages = ["base"]
+
+[[netinstall.group]]
+name = "Gaming"
+packages = ["shadowed"]
+)"sv;
+
+static constexpr auto USER_LAYER = R"(
+[desktop.kde]
+packages = ["plasma-desktop", "kate"]
+
+[[netinstall.group]]
+name = "Gaming"
+packages = ["heroic"]
+
+[[netinstall.group]]
+name = "Dev"
+packages = ["gcc", "gdb"]
+)"sv;
+
+void require_same_index(const ProfileIndex& lhs, const ProfileIndex& rhs) {
+    REQUIRE_EQ(lhs.revision(), rhs.revision());
+    REQUIRE_EQ(lhs.base().base_packages, rhs.base().base_packages);
+    REQUIRE_EQ(lhs.base().base_desktop_packages, rhs.base().base_desktop_packages);
+    REQUIRE_EQ(lhs.base().base_services.size(), rhs.base().base_services.size());
+    for (std::size_t i = 0; i < lhs.base().base_services.size(); ++i) {
+        const auto& lhs_service = lhs.base().base_services[i];
+        const auto& rhs_service = rhs.base().base_services[i];
+        REQUIRE_EQ(lhs_service.name, rhs_service.name);
+        REQUIRE_EQ(lhs_service.action, rhs_service.action);
+        REQUIRE_EQ(lhs_service.is_urgent, rhs_service.is_urgent);
+        REQUIRE_EQ(lhs_service.is_user_service, rhs_service.is_user_service);
+    }
+    REQUIRE_EQ(lhs.base().base_desktop_services.size(), rhs.base().base_desktop_services.size());
+    REQUIRE_EQ(lhs.desktops().size(), rhs.desktops().size());
+    REQUIRE_EQ(lhs.groups().size(), rhs.groups().size());
+    for (const auto& desktop : lhs.desktops()) {
+        REQUIRE(rhs.find_desktop(desktop.profile_name) != nullptr);
+        REQUIRE_EQ(rhs.find_desktop(desktop.profile_name)->packages, desktop.packages);
+    }
+    for (const auto& group : lhs.groups()) {
+        REQUIRE(rhs.group_packages(group.name) != nullptr);
+        REQUIRE_EQ(*rhs.group_packages(group.name), *lhs.group_packages(group.name));
+    }
+}
+
+}  // namespace
+
+TEST_CASE("profile index test")
+{
+    auto callback_sink = std::make_shared<spdlog::sinks::callback_sink_mt>([](const spdlog::details::log_msg&) {
+        // noop
+    });
+    auto logger = std::make_shared<spdlog::logger>("default", callback_sink);
+    spdlog::set_default_logger(logger);
+    gucc::logger::set_logger(logger);
+
+    SECTION("lookups")
+    {
+        const auto& index = ProfileIndex::build(VENDORED);
+        REQUIRE(index);
+        REQUIRE_EQ(index->revision(), gucc::hash::sha256_hex(VENDORED));
+
+        const std::vector base{"base"s, "base-devel"s};
+        REQUIRE_EQ(index->base().base_packages, base);
+        REQUIRE_EQ(index->base().base_services.size(), 2);
+        REQUIRE_EQ(index->base().base_desktop_services.size(), 1);
+
+        const std::vector kde{"plasma-desktop"s, "konsole"s};
+        REQUIRE(index->find_desktop("kde"sv) != nullptr);
+        REQUIRE_EQ(index->find_desktop("kde"sv)->packages, kde);
+        REQUIRE(index->find_desktop("gnome"sv) == nullptr);
+
+        // subgroups are expanded depth-first after the group itself
+        const std::vector gaming{"steam"s, "lutris"s, "retroarch"s};
+        REQUIRE(index->group_packages("Gaming"sv) != nullptr);
+        REQUIRE_EQ(*index->group_packages("Gaming"sv), gaming);
+        REQUIRE_EQ(index->find_group("Gaming"sv)->icon, "applications-games"sv);
+        REQUIRE(index->find_group("Common"sv)->critical);
+        REQUIRE(index->find_group("Common"sv)->is_bundle);
+        REQUIRE_EQ(index->groups().size(), 3);
+
+        // only top-level groups are looked up
+        REQUIRE(index->group_packages("Gaming Extras"sv) == nullptr);
+        REQUIRE(index->find_group("Dev"sv) == nullptr);
+
+        REQUIRE_FALSE(ProfileIndex::build("[desktop\nkde = "sv));
+    }
+    SECTION("layered")
+    {
+        const auto& merged = gucc::profile::load_layered_net_profiles({VENDORED, USER_LAYER});
+        REQUIRE(merged);
+        const auto& index = ProfileIndex::build(*merged, gucc::profile::layers_revision({VENDORED, USER_LAYER}));
+        REQUIRE(index);
+
+        // replaced in place, appended after the vendored ones
+        REQUIRE_EQ(index->groups().size(), 4);
+        REQUIRE_EQ(index->groups()[0].name, "Gaming"sv);
+        REQUIRE_EQ(index->groups()[3].name, "Dev"sv);
+        const std::vector gaming{"heroic"s};
+        const std::vector dev{"gcc"s, "gdb"s};
+        const std::vector kde{"plasma-desktop"s, "kate"s};
+        REQUIRE_EQ(*index->group_packages("Gaming"sv), gaming);
+        REQUIRE_EQ(*index->group_packages("Dev"sv), dev);
+        REQUIRE_EQ(index->find_desktop("kde"sv)->packages, kde);
+
+        REQUIRE(gucc::profile::layers_revision({"ab"sv, "c"sv}) != gucc::profile::layers_revision({"a"sv, "bc"sv}));
+        REQUIRE(gucc::profile::layers_revision({VENDORED}) != gucc::profile::layers_revision({VENDORED, USER_LAYER}));
+    }
+    SECTION("snapshot")
+    {
+        const auto& index = ProfileIndex::build(VENDORED, "rev-1"s);
+        REQUIRE(index);
+        const auto& snapshot = index->serialize();
+
+        const auto& loaded = ProfileIndex::deserialize(snapshot, "rev-1"sv);
+        REQUIRE(loaded);
+        require_same_index(*index, *loaded);
+        REQUIRE(loaded->find_group("Gaming"sv)->subgroups[0].hidden);
+
+        // built from another revision
+        REQUIRE_FALSE(ProfileIndex::deserialize(snapshot, "rev-2"sv));
+        // truncated, trailing garbage, wrong magic
+        for (std::size_t size = 0; size < snapshot.size(); size += 7) {
+            REQUIRE_FALSE(ProfileIndex::deserialize(std::string_view{snapshot}.substr(0, size), "rev-1"sv));
+        }
+        REQUIRE_FALSE(ProfileIndex::deserialize(snapshot + "x", "rev-1"sv));
+        REQUIRE_FALSE(ProfileIndex::deserialize("GUCCPIX0"sv, "rev-1"sv));
+    }
+    SECTION("shared across consumers")
+    {
+        const gucc::tests::TempRoot root{"gucc-profile-index"};
+        const auto& profile_path = (root.path() / "net-profiles.toml").string();
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(profile_path, VENDORED));
+
+        const auto& url = fmt::format("file://{}", profile_path);
+        const gucc::package::NetProfileInfo info{
+            .net_profs_url          = url,
+            .net_profs_fallback_url = url,
+            .net_profs_user_path    = {},
+            .fetch_options          = {.cache_dir = {}},
+            .index_snapshot_dir     = (root.path() / "profiles").string(),
+        };
+
+        const auto& index = gucc::package::get_profile_index(info);
+        REQUIRE(index);
+        REQUIRE_EQ(gucc::package::get_profile_index(info), index);
+
+        // the snapshot is picked up by a later run
+        const auto& snapshot_path = root.path() / "profiles" / fmt::format("profile-index-{}.bin", index->revision().substr(0, 32));
+        REQUIRE(fs::exists(snapshot_path));
+        const auto& warm = ProfileIndex::deserialize(gucc::file_utils::read_whole_file(snapshot_path.string()), index->revision());
+        REQUIRE(warm);
+        require_same_index(*index, *warm);
+
+        const auto& desktop = gucc::package::get_pkglist_desktop("kde"sv, info);
+        REQUIRE(desktop);
+        const std::vector kde{"plasma-desktop"s, "konsole"s, "xorg-server"s};
+        REQUIRE_EQ(*desktop, kde);
+        const auto& groups = gucc::package::get_netinstall_groups(info);
+        REQUIRE(groups);
+        REQUIRE_EQ(groups->size(), 3);
+    }
+}
@@ -0,0 +1,245 @@
+#include "doctest_compatibility.h"
+#include "test_loop_devices.hpp"
+#include "test_temp_root.hpp"
+
+#include "gucc/file_utils.hpp"
+#include "gucc/io_utils.hpp"
+#include "gucc/process.hpp"
+#include "gucc/raid.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+using gucc::disk::DiskTopology;
+using gucc::raid::RaidBackend;
+using gucc::raid::RaidLevel;
+using gucc::raid::RaidSetup;
+
+namespace {
+
+inline constexpr std::uint64_t KIB = 1024;
+
+auto md_setup(RaidLevel level, std::uint64_t chunk_size) -> RaidSetup {
+    return RaidSetup{
+        .backend    = RaidBackend::Mdadm,
+        .level      = level,
+        .name       = "cachyos"s,
+        .devices    = {"/dev/nvme0n1p2"s, "/dev/nvme1n1"s, "/dev/nvme2n1"s, "/dev/nvme3n1"s},
+        .chunk_size = chunk_size,
+    };
+}
+
+// stops the md array of a test on scope exit, before the loop devices under it go away
+class ScopedMdArray final {
+ public:
+    explicit ScopedMdArray(std::string name) : m_path(fmt::format("/dev/md/{}", name)) { }
+    ~ScopedMdArray() {
+        gucc::utils::exec(fmt::format("mdadm --stop '{}' 2>/dev/null", m_path));
+    }
+
+    ScopedMdArray(const ScopedMdArray&)                    = delete;
+    auto operator=(const ScopedMdArray&) -> ScopedMdArray& = delete;
+
+ private:
+    std::string m_path;
+};
+
+}  // namespace
+
+TEST_CASE("raid test")
+{
+    SECTION("level names")
+    {
+        REQUIRE_EQ(gucc::raid::string_to_raid_level("raid10"sv), RaidLevel::Raid10);
+        REQUIRE_FALSE(gucc::raid::string_to_raid_level("raid5"sv).has_value());
+        REQUIRE_EQ(gucc::raid::raid_level_to_string(RaidLevel::Raid0), "raid0"sv);
+        REQUIRE_EQ(gucc::raid::raid_min_devices(RaidLevel::Raid1), 2);
+        REQUIRE_EQ(gucc::raid::raid_min_devices(RaidLevel::Raid10), 4);
+    }
+    SECTION("validate")
+    {
+        REQUIRE(gucc::raid::validate_raid_setup(md_setup(RaidLevel::Raid10, 512 * KIB)));
+
+        auto setup = md_setup(RaidLevel::Raid10, 512 * KIB);
+        setup.devices.pop_back();
+        REQUIRE_FALSE(gucc::raid::validate_raid_setup(setup));
+
+        setup = md_setup(RaidLevel::Raid0, 512 * KIB);
+        setup.devices.back() = "/dev/nvme1n1"s;
+        REQUIRE_FALSE(gucc::raid::validate_raid_setup(setup));
+
+        REQUIRE_FALSE(gucc::raid::validate_raid_setup(md_setup(RaidLevel::Raid0, 384 * KIB)));
+
+        setup      = md_setup(RaidLevel::Raid1, 0);
+        setup.name = "md/root"s;
+        REQUIRE_FALSE(gucc::raid::validate_raid_setup(setup));
+
+        // raid0 data, raid10 metadata on two devices
+        setup = RaidSetup{
+            .backend        = RaidBackend::Btrfs,
+            .level          = RaidLevel::Raid0,
+            .metadata_level = RaidLevel::Raid10,
+            .devices        = {"/dev/sda2"s, "/dev/sdb"s},
+        };
+        REQUIRE_FALSE(gucc::raid::validate_raid_setup(setup));
+        setup.metadata_level = RaidLevel::Raid1;
+        REQUIRE(gucc::raid::validate_raid_setup(setup));
+    }
+    SECTION("chunk size")
+    {
+        const std::vector<DiskTopology> nvme{DiskTopology{.physical_block_size = 4096}, DiskTopology{.physical_block_size = 4096}};
+        REQUIRE_EQ(gucc::raid::md_chunk_size_for(RaidLevel::Raid0, nvme), 512 * KIB);
+        REQUIRE_EQ(gucc::raid::md_chunk_size_for(RaidLevel::Raid1, nvme), 0);
+
+        // grown to the largest hint, rounded up to a power of two
+        const std::vector<DiskTopology> hw_raid{DiskTopology{.optimal_io_size = 768 * 1024}, DiskTopology{.minimum_io_size = 64 * 1024}};
+        REQUIRE_EQ(gucc::raid::md_chunk_size_for(RaidLevel::Raid10, hw_raid), 1024 * KIB);
+
+        // bogus hints are ignored
+        const std::vector<DiskTopology> bogus{DiskTopology{.optimal_io_size = 0xFFFF'FFFF}};
+        REQUIRE_EQ(gucc::raid::md_chunk_size_for(RaidLevel::Raid0, bogus), 512 * KIB);
+    }
+    SECTION("array topology")
+    {
+        const std::vector<DiskTopology> members(4, DiskTopology{.logical_block_size = 512, .physical_block_size = 4096});
+
+        const auto& raid10 = gucc::raid::md_array_topology(md_setup(RaidLevel::Raid10, 256 * KIB), members);
+        REQUIRE_EQ(raid10.physical_block_size, 4096);
+        REQUIRE_EQ(raid10.raid_chunk_size, 256 * KIB);
+        REQUIRE_EQ(raid10.optimal_io_size, 512 * KIB);
+
+        const auto& raid0 = gucc::raid::md_array_topology(md_setup(RaidLevel::Raid0, 256 * KIB), members);
+        REQUIRE_EQ(raid0.optimal_io_size, 1024 * KIB);
+
+        const auto& raid1 = gucc::raid::md_array_topology(md_setup(RaidLevel::Raid1, 0), members);
+        REQUIRE_EQ(raid1.raid_chunk_size, 0);
+        REQUIRE_EQ(raid1.optimal_io_size, 0);
+    }
+    SECTION("mdadm commands")
+    {
+        REQUIRE_EQ(gucc::raid::detail::mdadm_create_cmd(md_setup(RaidLevel::Raid10, 512 * KIB)),
+            "mdadm --create '/dev/md/cachyos' --run --metadata=1.2 --homehost=any --level=raid10 --raid-devices=4 --chunk=512K"
+            " '/dev/nvme0n1p2' '/dev/nvme1n1' '/dev/nvme2n1' '/dev/nvme3n1'");
+
+        auto setup = md_setup(RaidLevel::Raid1, 512 * KIB);
+        setup.devices.resize(2);
+        REQUIRE_EQ(gucc::raid::detail::mdadm_create_cmd(setup),
+            "mdadm --create '/dev/md/cachyos' --run --metadata=1.2 --homehost=any --level=raid1 --raid-devices=2 '/dev/nvme0n1p2' '/dev/nvme1n1'");
+    }
+    SECTION("btrfs mkfs")
+    {
+        const RaidSetup setup{
+            .backend = RaidBackend::Btrfs,
+            .level   = RaidLevel::Raid10,
+            .devices = {"/dev/sda2"s, "/dev/sdb"s, "/dev/sdc"s, "/dev/sdd"s},
+        };
+        REQUIRE_EQ(gucc::raid::btrfs_raid_mkfs_command("mkfs.btrfs -f"sv, setup),
+            "mkfs.btrfs -f -d raid10 -m raid1 '/dev/sdb' '/dev/sdc' '/dev/sdd'");
+    }
+    SECTION("mdadm.conf")
+    {
+        static constexpr auto SCAN_OUTPUT = "ARRAY /dev/md/cachyos metadata=1.2 UUID=8f5a2c1e:0b4d7e29:5c3f9a10:2e6b8d47 name=any:cachyos\n"
+                                            "ARRAY /dev/md/data metadata=1.2 UUID=1d2e3f40:5a6b7c8d:9e0f1a2b:3c4d5e6f name=any:data\n"sv;
+
+        // the template has no arrays
+        REQUIRE_EQ(gucc::raid::detail::merge_mdadm_conf("# DEVICE partitions\nMAILADDR root"sv, SCAN_OUTPUT),
+            "# DEVICE partitions\nMAILADDR root\n"
+            "ARRAY /dev/md/cachyos metadata=1.2 UUID=8f5a2c1e:0b4d7e29:5c3f9a10:2e6b8d47 name=any:cachyos\n"
+            "ARRAY /dev/md/data metadata=1.2 UUID=1d2e3f40:5a6b7c8d:9e0f1a2b:3c4d5e6f name=any:data\n");
+
+        // arrays already listed aren't added twice
+        static constexpr auto CONF = "ARRAY /dev/md/data UUID=1d2e3f40:5a6b7c8d:9e0f1a2b:3c4d5e6f\n"sv;
+        REQUIRE_EQ(gucc::raid::detail::merge_mdadm_conf(CONF, SCAN_OUTPUT),
+            "ARRAY /dev/md/data UUID=1d2e3f40:5a6b7c8d:9e0f1a2b:3c4d5e6f\n"
+            "ARRAY /dev/md/cachyos metadata=1.2 UUID=8f5a2c1e:0b4d7e29:5c3f9a10:2e6b8d47 name=any:cachyos\n");
+
+        // no array was created under dry-run, so there is no scan to write
+        const gucc::tests::TempRoot root{"gucc-raid-conf"};
+        auto& runner = gucc::utils::default_runner();
+        runner.set_dry_run(true);
+        const auto& written = gucc::raid::write_mdadm_conf(root.path().string());
+        runner.set_dry_run(false);
+        REQUIRE(written);
+        REQUIRE_FALSE(std::filesystem::exists(root.path() / "etc"));
+    }
+}
+
+TEST_CASE("raid loop devices test")
+{
+    if (!gucc::tests::can_use_loop_devices({"mdadm"sv, "mkfs.btrfs"sv, "mkfs.ext4"sv, "blkid"sv})) {
+        MESSAGE("needs root, loop devices, mdadm and btrfs-progs, skipped");
+        return;
+    }
+    const gucc::tests::TempRoot tmp{"gucc-raid"};
+    // raid10 wants four members, the other levels take them as well
+    const gucc::tests::LoopDevices loops{tmp.path(), 4};
+    REQUIRE_EQ(loops.devices().size(), 4);
+
+    SECTION("md array assembles again from its superblocks")
+    {
+        for (const auto level : {RaidLevel::Raid0, RaidLevel::Raid1, RaidLevel::Raid10}) {
+            const auto level_name = gucc::raid::raid_level_to_string(level);
+            CAPTURE(level_name);
+            const RaidSetup setup{
+                .backend = RaidBackend::Mdadm,
+                .level   = level,
+                .name    = "gucctest"s,
+                .devices = loops.devices(),
+            };
+            const ScopedMdArray array_guard{setup.name};
+            auto md_path = gucc::raid::create_md_array(setup);
+            REQUIRE(md_path);
+            REQUIRE(gucc::utils::exec_checked(fmt::format("mkfs.ext4 -q '{}'", *md_path)));
+            REQUIRE(gucc::raid::stop_md_array(*md_path));
+
+            // what mdadm_udev does on boot
+            md_path = gucc::raid::assemble_md_array(setup);
+            REQUIRE(md_path);
+            REQUIRE_EQ(gucc::utils::exec(fmt::format("blkid -o value -s TYPE '{}'", *md_path)), "ext4"sv);
+            REQUIRE(gucc::utils::exec_checked(fmt::format("mdadm --detail --export '{}' | grep -qx 'MD_LEVEL={}'", *md_path, level_name)));
+            // create_md_array wipes the members again for the next level
+            REQUIRE(gucc::raid::stop_md_array(*md_path));
+        }
+    }
+    SECTION("btrfs raid mounts again after a rescan")
+    {
+        const auto& mountpoint = (tmp.path() / "mnt").string();
+        std::filesystem::create_directory(mountpoint);
+        for (const auto level : {RaidLevel::Raid0, RaidLevel::Raid1, RaidLevel::Raid10}) {
+            const auto level_name = gucc::raid::raid_level_to_string(level);
+            CAPTURE(level_name);
+            const RaidSetup setup{
+                .backend = RaidBackend::Btrfs,
+                .level   = level,
+                .devices = loops.devices(),
+            };
+            const auto& first = loops.devices().front();
+            REQUIRE(gucc::utils::exec_checked(fmt::format("{} '{}'", gucc::raid::btrfs_raid_mkfs_command("mkfs.btrfs -f -q"sv, setup), first)));
+
+            const gucc::tests::ScopedUnmount unmount_guard{mountpoint};
+            REQUIRE(gucc::utils::exec_checked(fmt::format("mount '{}' '{}'", first, mountpoint)));
+            REQUIRE(gucc::file_utils::create_file_for_overwrite(fmt::format("{}/probe", mountpoint), "raid"sv));
+            REQUIRE(gucc::utils::exec_checked(fmt::format("umount '{}'", mountpoint)));
+
+            // the kernel forgets the members, only the superblocks tie them together
+            for (const auto& device : loops.devices()) {
+                REQUIRE(gucc::utils::exec_checked(fmt::format("btrfs device scan --forget '{}'", device)));
+            }
+            REQUIRE(gucc::utils::exec_checked("btrfs device scan >/dev/null"));
+            REQUIRE(gucc::utils::exec_checked(fmt::format("mount '{}' '{}'", first, mountpoint)));
+            REQUIRE_EQ(gucc::file_utils::read_whole_file(fmt::format("{}/probe", mountpoint)), "raid"sv);
+            REQUIRE_EQ(gucc::utils::exec(fmt::format("btrfs filesystem show '{}' | grep -c devid", mountpoint)), "4"sv);
+            REQUIRE(gucc::utils::exec_checked(fmt::format("btrfs filesystem df '{}' | grep -qi '^Data, {}:'", mountpoint, level_name)));
+            REQUIRE(gucc::utils::exec_checked(fmt::format("umount '{}'", mountpoint)));
+        }
+    }
+}
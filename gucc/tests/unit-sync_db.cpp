@@ -0,0 +1,252 @@
+#include "doctest_compatibility.h"
+
+#include "test_temp_root.hpp"
+
+#include "gucc/file_utils.hpp"
+#include "gucc/io_utils.hpp"
+#include "gucc/logger.hpp"
+#include "gucc/sync_db.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+#include <spdlog/sinks/callback_sink.h>
+#include <spdlog/spdlog.h>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace fs = std::filesystem;
+
+using gucc::syncdb::DepMod;
+using gucc::syncdb::SyncDatabase;
+
+namespace {
+
+// ustar header with a valid checksum, enough for tar(1) and the reader alike
+void append_tar_file(std::string& tar, std::string_view path, std::string_view content) {
+    std::string header(512, '\0');
+    header.replace(0, path.size(), path);
+    header.replace(100, 7, "0000644");
+    header.replace(108, 7, "0000000");
+    header.replace(116, 7, "0000000");
+    header.replace(124, 11, fmt::format("{:011o}", content.size()));
+    header.replace(136, 11, "00000000000");
+    header[156] = '0';
+    header.replace(257, 5, "ustar"sv);
+    header.replace(263, 2, "00");
+
+    header.replace(148, 8, "        ");
+    unsigned checksum{};
+    for (const char ch : header) {
+        checksum += static_cast<unsigned char>(ch);
+    }
+    header.replace(148, 6, fmt::format("{:06o}", checksum));
+    header[154] = '\0';
+
+    tar += header;
+    tar += content;
+    tar.append((512 - (content.size() % 512)) % 512, '\0');
+}
+
+auto make_desc(std::string_view name, std::string_view version, std::string_view extra = {}) -> std::string {
+    return fmt::format("%FILENAME%\n{0}-{1}-x86_64.pkg.tar.zst\n\n%NAME%\n{0}\n\n%VERSION%\n{1}\n\n%CSIZE%\n100\n\n%ISIZE%\n400\n\n%SHA256SUM%\nabc\n\n{2}", name, version, extra);
+}
+
+auto make_db(const std::vector<std::pair<std::string, std::string>>& descs) -> std::string {
+    std::string tar{};
+    for (const auto& [dir, desc] : descs) {
+        append_tar_file(tar, fmt::format("{}/desc", dir), desc);
+    }
+    tar.append(1024, '\0');
+    return tar;
+}
+
+auto names_of(const gucc::syncdb::Resolution& resolution) -> std::vector<std::string> {
+    std::vector<std::string> names{};
+    for (const auto& pkg : resolution.packages) {
+        names.emplace_back(pkg.name);
+    }
+    return names;
+}
+
+}  // namespace
+
+TEST_CASE("sync db test")
+{
+    auto callback_sink = std::make_shared<spdlog::sinks::callback_sink_mt>([](const spdlog::details::log_msg&) {
+        // noop
+    });
+    auto logger = std::make_shared<spdlog::logger>("default", callback_sink);
+    spdlog::set_default_logger(logger);
+    gucc::logger::set_logger(logger);
+
+    SECTION("vercmp")
+    {
+        REQUIRE_EQ(gucc::syncdb::vercmp("1.0"sv, "1.0"sv), 0);
+        REQUIRE(gucc::syncdb::vercmp("1.0"sv, "1.0.1"sv) < 0);
+        REQUIRE(gucc::syncdb::vercmp("1.0alpha"sv, "1.0"sv) < 0);
+        REQUIRE(gucc::syncdb::vercmp("1.10"sv, "1.9"sv) > 0);
+        REQUIRE(gucc::syncdb::vercmp("1.0-2"sv, "1.0-10"sv) < 0);
+        REQUIRE(gucc::syncdb::vercmp("1:1.0-1"sv, "2.0-1"sv) > 0);
+        REQUIRE(gucc::syncdb::vercmp("1.0a"sv, "1.0b"sv) < 0);
+        REQUIRE(gucc::syncdb::vercmp("1.001"sv, "1.1"sv) == 0);
+        // without a release on one side only the versions count
+        REQUIRE_EQ(gucc::syncdb::vercmp("2.40"sv, "2.40-3"sv), 0);
+
+        const auto& dep = gucc::syncdb::parse_dependency("glibc>=2.40"sv);
+        REQUIRE_EQ(dep.name, "glibc"sv);
+        REQUIRE_EQ(dep.version, "2.40"sv);
+        REQUIRE(dep.mod == DepMod::Ge);
+        REQUIRE(gucc::syncdb::parse_dependency("sh"sv).mod == DepMod::Any);
+        REQUIRE(gucc::syncdb::parse_dependency("libfoo.so=1-64"sv).mod == DepMod::Eq);
+    }
+    SECTION("resolve")
+    {
+        SyncDatabase db{};
+        const auto& core = make_db({
+            {"bash-5.2-1"s, make_desc("bash"sv, "5.2-1"sv, "%DEPENDS%\nglibc>=2.40\nreadline\n\n%PROVIDES%\nsh\n\n%GROUPS%\nbase\n")},
+            {"glibc-2.40-1"s, make_desc("glibc"sv, "2.40-1"sv, "%GROUPS%\nbase\n")},
+            {"readline-8.2-1"s, make_desc("readline"sv, "8.2-1"sv, "%DEPENDS%\nglibc\nbash\n")},
+            {"foo-1.0-1"s, make_desc("foo"sv, "1.0-1"sv, "%DEPENDS%\nglibc>=3.0\nlibnope.so\n")},
+            {"mesa-24-1"s, make_desc("mesa"sv, "24-1"sv, "%PROVIDES%\nopengl-driver=24\n")},
+            {"iptables-1.8-1"s, make_desc("iptables"sv, "1.8-1"sv)},
+            {"ufw-0.36-1"s, make_desc("ufw"sv, "0.36-1"sv, "%DEPENDS%\niptables\n")},
+        });
+        REQUIRE(db.add_tar("core"sv, core));
+        const auto& extra = make_db({
+            {"bash-6.0-1"s, make_desc("bash"sv, "6.0-1"sv)},
+            {"iptables-nft-1.8-1"s, make_desc("iptables-nft"sv, "1.8-1"sv, "%PROVIDES%\niptables\n\n%CONFLICTS%\niptables\n")},
+        });
+        REQUIRE(db.add_tar("extra"sv, extra));
+        REQUIRE_EQ(db.package_count(), 9);
+        const std::vector repos{"core"s, "extra"s};
+        REQUIRE_EQ(db.repos(), repos);
+
+        // the first repo wins, repo/name pins one
+        REQUIRE_EQ(db.find("bash"sv)->version, "5.2-1"sv);
+        REQUIRE_EQ(db.find("bash"sv)->filename, "bash-5.2-1-x86_64.pkg.tar.zst"sv);
+        REQUIRE_FALSE(db.find("zsh"sv));
+
+        // dependencies first, the readline <-> bash cycle doesn't hang
+        const std::vector bash_targets{"bash"s};
+        const auto& bash = db.resolve(bash_targets);
+        REQUIRE(bash.ok());
+        const std::vector bash_order{"glibc"s, "readline"s, "bash"s};
+        REQUIRE_EQ(names_of(bash), bash_order);
+        REQUIRE_EQ(bash.download_size, 300);
+        REQUIRE_EQ(bash.install_size, 1200);
+
+        const std::vector pinned_targets{"extra/bash"s};
+        REQUIRE_EQ(db.resolve(pinned_targets).packages[0].version, "6.0-1"sv);
+
+        // groups expand to their members, provides are looked up
+        const std::vector group_targets{"base"s};
+        const auto& base = db.resolve(group_targets);
+        REQUIRE(base.ok());
+        REQUIRE_EQ(base.packages.size(), 3);
+        const std::vector provide_targets{"sh"s, "opengl-driver>=20"s};
+        const auto& provided = db.resolve(provide_targets);
+        REQUIRE(provided.ok());
+        REQUIRE(std::ranges::contains(names_of(provided), "mesa"s));
+
+        // unsatisfied versions and unknown names are reported with who wanted them
+        const std::vector foo_targets{"foo"s, "zsh"s};
+        const auto& foo = db.resolve(foo_targets);
+        REQUIRE_FALSE(foo.ok());
+        REQUIRE_EQ(foo.missing.size(), 3);
+        REQUIRE_EQ(foo.missing[0].dependency, "zsh"s);
+        REQUIRE(foo.missing[0].required_by.empty());
+        REQUIRE_EQ(foo.missing[1].dependency, "glibc>=3.0"s);
+        REQUIRE_EQ(foo.missing[1].required_by, "foo"s);
+
+        // a conflict is reported once
+        const std::vector conflict_targets{"iptables"s, "iptables-nft"s};
+        const auto& conflict = db.resolve(conflict_targets);
+        REQUIRE_EQ(conflict.conflicts.size(), 1);
+        REQUIRE_EQ(conflict.conflicts[0].package, "iptables-nft"s);
+        REQUIRE_EQ(conflict.conflicts[0].conflicts_with, "iptables"s);
+
+        // what's already picked satisfies later dependencies
+        const std::vector provider_targets{"iptables-nft"s, "ufw"s};
+        const auto& ufw = db.resolve(provider_targets);
+        REQUIRE(ufw.ok());
+        REQUIRE_EQ(ufw.packages.size(), 2);
+    }
+    SECTION("db files")
+    {
+        const gucc::tests::TempRoot root{"gucc-sync-db"};
+        const auto& tar = make_db({
+            {"glibc-2.40-1"s, make_desc("glibc"sv, "2.40-1"sv)},
+        });
+        const auto& db_path = (root.path() / "core.db").string();
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(db_path, tar));
+
+        const std::vector repos{"core"s};
+        const auto& db = SyncDatabase::load(root.path().string(), repos);
+        REQUIRE(db);
+        REQUIRE_EQ(db->find("glibc"sv)->version, "2.40-1"sv);
+
+        const std::vector missing_repos{"core"s, "nope"s};
+        const auto& missing = SyncDatabase::load(root.path().string(), missing_repos);
+        REQUIRE_FALSE(missing);
+        REQUIRE(missing.error().code == gucc::ErrorCode::NotFound);
+
+        SyncDatabase truncated{};
+        REQUIRE_FALSE(truncated.add_tar("core"sv, std::string_view{tar}.substr(0, 700)));
+
+        // entries as they are on disk, old dbs split them in two
+        const auto& split_tar = [] {
+            std::string split{};
+            append_tar_file(split, "zlib-1.3-1/desc"sv, make_desc("zlib"sv, "1.3-1"sv));
+            append_tar_file(split, "zlib-1.3-1/depends"sv, "%DEPENDS%\nglibc\n"sv);
+            split.append(1024, '\0');
+            return split;
+        }();
+        const auto& split_path = (root.path() / "old.db").string();
+        REQUIRE(gucc::file_utils::create_file_for_overwrite(split_path, split_tar));
+        const auto& split_entries = gucc::syncdb::read_db_entries(split_path);
+        REQUIRE(split_entries);
+        REQUIRE_EQ(split_entries->size(), 1);
+        REQUIRE_EQ(split_entries->front().dir, "zlib-1.3-1"s);
+        REQUIRE(split_entries->front().desc.ends_with("\n\n%DEPENDS%\nglibc\n"sv));
+
+        // written back with names too long for ustar
+        const auto& long_name = std::string(120, 'x');
+        const std::vector entries{
+            split_entries->front(),
+            gucc::syncdb::DbEntry{.dir = long_name + "-1-1", .desc = make_desc(long_name, "1-1"sv, "%DEPENDS%\nzlib\n\n"sv)},
+        };
+        SyncDatabase written{};
+        REQUIRE(written.add_tar("core"sv, gucc::syncdb::write_db_tar(entries)));
+        REQUIRE_EQ(written.package_count(), 2);
+        const std::vector long_targets{long_name};
+        const auto& long_resolution = written.resolve(long_targets);
+        REQUIRE_EQ(long_resolution.packages.size(), 2);
+        REQUIRE_EQ(long_resolution.missing.size(), 1);
+        REQUIRE_EQ(long_resolution.missing.front().dependency, "glibc"s);
+
+        REQUIRE(gucc::syncdb::read_db_entries((root.path() / "missing.db").string()).error().code == gucc::ErrorCode::NotFound);
+
+        // repo-add output is compressed
+        if (fs::exists("/usr/bin/gzip")) {
+            REQUIRE(gucc::utils::exec_checked(fmt::format("/usr/bin/gzip -n '{}'", db_path)));
+            fs::rename(db_path + ".gz", db_path);
+            const auto& compressed = SyncDatabase::load(root.path().string(), repos);
+            REQUIRE(compressed);
+            REQUIRE_EQ(compressed->package_count(), 1);
+
+            // only the tar goes to the parser, the complaint of gzip ends up in the error
+            const auto& corrupt_path = (root.path() / "corrupt.db").string();
+            REQUIRE(gucc::file_utils::create_file_for_overwrite(corrupt_path, "\x1f\x8b\x08\x00garbage"sv));
+            const auto& corrupt = gucc::syncdb::read_db_entries(corrupt_path);
+            REQUIRE_FALSE(corrupt);
+            REQUIRE(corrupt.error().code == gucc::ErrorCode::SubprocessFailed);
+            REQUIRE_FALSE(corrupt.error().context.ends_with(": "sv));
+        }
+    }
+}
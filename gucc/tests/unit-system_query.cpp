@@ -140,6 +140,8 @@ TEST_CASE("system_query")
             CHECK(parse_partition_number("nvme0n1"sv) == 0);
             CHECK(parse_partition_number("/dev/sda"sv) == 0);
             CHECK(parse_partition_number("/dev/nvme0n1"sv) == 0);
+            CHECK(parse_partition_number("/dev/loop0"sv) == 0);
+            CHECK(parse_partition_number("/dev/loop0p3"sv) == 3);
         }
     }
     SECTION("insert_partition_number test")
@@ -171,6 +173,12 @@ TEST_CASE("system_query")
             REQUIRE_EQ(insert_partition_number("/dev/sda"sv, 10), "/dev/sda10");
             REQUIRE_EQ(insert_partition_number("/dev/nvme0n1"sv, 10), "/dev/nvme0n1p10"sv);
         }
+        SECTION("loop and mmc partitions")
+        {
+            REQUIRE_EQ(insert_partition_number("/dev/loop0"sv, 1), "/dev/loop0p1"sv);
+            REQUIRE_EQ(insert_partition_number("/dev/loop12p3"sv, 2), "/dev/loop12p2"sv);
+            REQUIRE_EQ(insert_partition_number("mmcblk0"sv, 2), "mmcblk0p2"sv);
+        }
     }
     SECTION("get_disk_name_from_device test")
     {
@@ -208,6 +216,13 @@ TEST_CASE("system_query")
             CHECK(get_disk_name_from_device("/dev/vda1"sv) == "vda"sv);
             CHECK(get_disk_name_from_device("vdb2"sv) == "vdb"sv);
         }
+        SECTION("loop, mmc and md disks")
+        {
+            CHECK(get_disk_name_from_device("/dev/loop0"sv) == "loop0"sv);
+            CHECK(get_disk_name_from_device("/dev/loop0p1"sv) == "loop0"sv);
+            CHECK(get_disk_name_from_device("mmcblk1p2"sv) == "mmcblk1"sv);
+            CHECK(get_disk_name_from_device("/dev/md127p1"sv) == "md127"sv);
+        }
     }
     SECTION("parse_lsblk_disks_json test")
     {
@@ -0,0 +1,80 @@
+#include "doctest_compatibility.h"
+
+#include "gucc/zfs.hpp"
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace {
+
+auto zpaths_of(const std::vector<const gucc::fs::ZfsDataset*>& datasets) -> std::vector<std::string_view> {
+    std::vector<std::string_view> result{};
+    for (const auto* dataset : datasets) {
+        result.push_back(dataset->zpath);
+    }
+    return result;
+}
+
+auto find_property(const std::vector<gucc::fs::ZfsProperty>& properties, std::string_view name) -> std::string_view {
+    const auto it = std::ranges::find(properties, name, &gucc::fs::ZfsProperty::name);
+    return (it != properties.end()) ? std::string_view{it->value} : ""sv;
+}
+
+}  // namespace
+
+TEST_CASE("zfs dataset creation test")
+{
+    SECTION("parents first")
+    {
+        const std::vector<gucc::fs::ZfsDataset> datasets{
+            {.zpath = "zpcachyos/ROOT/cos/root"s, .mountpoint = "/"s},
+            {.zpath = "zpcachyos/ROOT"s, .mountpoint = "none"s},
+            {.zpath = "zpcachyos/ROOT/cos/home"s, .mountpoint = "/home"s},
+            {.zpath = "zpcachyos/ROOT/cos"s, .mountpoint = "none"s},
+            {.zpath = "zpcachyos/data"s, .mountpoint = "/data"s},
+        };
+        const std::vector<std::string_view> expected{
+            "zpcachyos/ROOT"sv,
+            "zpcachyos/data"sv,
+            "zpcachyos/ROOT/cos"sv,
+            "zpcachyos/ROOT/cos/root"sv,
+            "zpcachyos/ROOT/cos/home"sv,
+        };
+        REQUIRE_EQ(zpaths_of(gucc::fs::detail::zfs_creation_order(datasets)), expected);
+    }
+    SECTION("properties on creation")
+    {
+        const gucc::fs::ZfsDataset plain{.zpath = "zpcachyos/ROOT"s, .mountpoint = "none"s};
+        REQUIRE_EQ(gucc::fs::detail::zfs_create_cmd(plain), "zfs create -p -o 'mountpoint=none' 'zpcachyos/ROOT'");
+
+        const gucc::fs::ZfsDataset tuned{
+            .zpath      = "zpcachyos/ROOT/cos/varlog"s,
+            .mountpoint = "/var/log"s,
+            .properties = {{.name = "recordsize"s, .value = "128K"s}, {.name = "compression"s, .value = "zstd"s}},
+        };
+        REQUIRE_EQ(gucc::fs::detail::zfs_create_cmd(tuned), "zfs create -p -o 'mountpoint=/var/log' -o 'recordsize=128K' -o 'compression=zstd' 'zpcachyos/ROOT/cos/varlog'");
+    }
+    SECTION("role presets")
+    {
+        REQUIRE(gucc::fs::zfs_role_properties(gucc::fs::ZfsDatasetRole::General).empty());
+
+        const auto& database = gucc::fs::zfs_role_properties(gucc::fs::ZfsDatasetRole::Database);
+        REQUIRE_EQ(find_property(database, "recordsize"sv), "16K"sv);
+        REQUIRE_EQ(find_property(database, "logbias"sv), "throughput"sv);
+
+        const auto& vm_images = gucc::fs::zfs_role_properties(gucc::fs::ZfsDatasetRole::VmImages);
+        REQUIRE_EQ(find_property(vm_images, "recordsize"sv), "64K"sv);
+        REQUIRE_EQ(find_property(vm_images, "primarycache"sv), "metadata"sv);
+
+        const auto& logs = gucc::fs::zfs_role_properties(gucc::fs::ZfsDatasetRole::Logs);
+        REQUIRE_EQ(find_property(logs, "compression"sv), "zstd"sv);
+
+        const auto& cache = gucc::fs::zfs_role_properties(gucc::fs::ZfsDatasetRole::Cache);
+        REQUIRE_EQ(find_property(cache, "recordsize"sv), "1M"sv);
+    }
+}
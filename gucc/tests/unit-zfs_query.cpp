@@ -164,4 +164,62 @@ TEST_CASE("zfs_query")
             }
         }
     }
+    SECTION("parse_zpool_list")
+    {
+        // `zpool list -v -Hp -PL` on a mirrored pool with a log device, and a single-disk pool
+        static constexpr auto output = "zpcachyos\t1992864825344\t68719476736\t1924145348608\t3\t3\tONLINE\t/mnt\n"
+                                       "\tmirror-0\t1992864825344\t68719476736\t1924145348608\t3\t3\tONLINE\t-\n"
+                                       "\t/dev/nvme0n1p2\t-\t-\t-\t-\t-\tONLINE\t-\n"
+                                       "\t/dev/nvme1n1p2\t-\t-\t-\t-\t-\tONLINE\t-\n"
+                                       "\tlogs\t-\t-\t-\t-\t-\t-\t-\n"
+                                       "\t/dev/sdc1\t-\t-\t-\t-\t-\tONLINE\t-\n"
+                                       "tank\t1000204886016\t0\t1000204886016\t-\t0\tDEGRADED\t-\n"
+                                       "\t/dev/sdb1\t1000204886016\t0\t1000204886016\t-\t0\tDEGRADED\t-\n"sv;
+
+        const auto pools = detail::parse_zpool_list(output);
+        REQUIRE_EQ(pools.size(), 2u);
+
+        REQUIRE_EQ(pools[0].name, "zpcachyos");
+        REQUIRE_EQ(pools[0].size, 1992864825344ULL);
+        REQUIRE_EQ(pools[0].allocated, 68719476736ULL);
+        REQUIRE_EQ(pools[0].fragmentation, 3u);
+        REQUIRE(pools[0].health == gucc::fs::ZfsPoolHealth::Online);
+        REQUIRE(pools[0].altroot.has_value());
+        REQUIRE_EQ(*pools[0].altroot, "/mnt");
+        const std::vector<std::string> expected_devices{"/dev/nvme0n1p2"s, "/dev/nvme1n1p2"s, "/dev/sdc1"s};
+        REQUIRE_EQ(pools[0].devices, expected_devices);
+
+        REQUIRE_EQ(pools[1].name, "tank");
+        REQUIRE_EQ(pools[1].fragmentation, 0u);
+        REQUIRE(pools[1].health == gucc::fs::ZfsPoolHealth::Degraded);
+        REQUIRE_FALSE(pools[1].altroot.has_value());
+        REQUIRE_EQ(pools[1].devices.size(), 1u);
+        REQUIRE_EQ(pools[1].devices[0], "/dev/sdb1");
+
+        REQUIRE(detail::parse_zpool_list(""sv).empty());
+    }
+    SECTION("apply_zpool_properties")
+    {
+        std::vector<gucc::fs::ZfsPoolInfo> pools(3);
+        pools[0].name = "zpcachyos";
+        pools[1].name = "tank";
+        pools[2].name = "old-pool";
+
+        static constexpr auto output = "zpcachyos\tbootfs\tzpcachyos/ROOT/cos/root\n"
+                                       "zpcachyos\tversion\t-\n"
+                                       "tank\tbootfs\t-\n"
+                                       "tank\tversion\t-\n"
+                                       "old-pool\tbootfs\t-\n"
+                                       "old-pool\tversion\t28\n"
+                                       "gone\tbootfs\tgone/root\n"sv;
+        detail::apply_zpool_properties(output, pools);
+
+        REQUIRE(pools[0].bootfs_set);
+        REQUIRE_FALSE(pools[0].version.has_value());
+        REQUIRE_FALSE(pools[1].bootfs_set);
+        // a dash in the pool name is not an unset bootfs
+        REQUIRE_FALSE(pools[2].bootfs_set);
+        REQUIRE(pools[2].version.has_value());
+        REQUIRE_EQ(*pools[2].version, 28u);
+    }
 }
@@ -0,0 +1,184 @@
+#include "doctest_compatibility.h"
+
+#include "gucc/zfs_topology.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+using gucc::fs::ZfsVdev;
+using gucc::fs::ZfsVdevClass;
+using gucc::fs::ZfsVdevMember;
+using gucc::fs::ZfsVdevType;
+
+namespace {
+
+inline constexpr std::uint64_t GIB = 1024ULL * 1024 * 1024;
+
+auto nvme_member(std::string_view device, std::uint64_t size_gib, std::uint32_t physical_block_size = 512) -> ZfsVdevMember {
+    return ZfsVdevMember{.device = std::string{device}, .size_bytes = size_gib * GIB, .physical_block_size = physical_block_size};
+}
+
+// database host: mirrored data, mirrored special, SLOG and L2ARC
+auto db_host_vdevs() -> std::vector<ZfsVdev> {
+    return {
+        ZfsVdev{.vdev_class = ZfsVdevClass::Data, .type = ZfsVdevType::Mirror, .devices = {"/dev/nvme0n1p2"s, "/dev/nvme1n1"s}},
+        ZfsVdev{.vdev_class = ZfsVdevClass::Special, .type = ZfsVdevType::Mirror, .devices = {"/dev/nvme2n1"s, "/dev/nvme3n1"s}},
+        ZfsVdev{.vdev_class = ZfsVdevClass::Log, .type = ZfsVdevType::Stripe, .devices = {"/dev/nvme4n1"s}},
+        ZfsVdev{.vdev_class = ZfsVdevClass::Cache, .type = ZfsVdevType::Stripe, .devices = {"/dev/nvme5n1"s}},
+    };
+}
+
+auto db_host_members() -> std::vector<ZfsVdevMember> {
+    return {
+        nvme_member("/dev/nvme0n1p2"sv, 1000),
+        nvme_member("/dev/nvme1n1"sv, 1024),
+        nvme_member("/dev/nvme2n1"sv, 64),
+        nvme_member("/dev/nvme3n1"sv, 64),
+        nvme_member("/dev/nvme4n1"sv, 16),
+        nvme_member("/dev/nvme5n1"sv, 256, 4096),
+    };
+}
+
+}  // namespace
+
+TEST_CASE("zfs topology test")
+{
+    SECTION("vdev names")
+    {
+        REQUIRE_EQ(gucc::fs::string_to_zfs_vdev_type("raidz"sv), ZfsVdevType::Raidz1);
+        REQUIRE_EQ(gucc::fs::string_to_zfs_vdev_type("raidz3"sv), ZfsVdevType::Raidz3);
+        REQUIRE_FALSE(gucc::fs::string_to_zfs_vdev_type("raid10"sv).has_value());
+        REQUIRE_EQ(gucc::fs::zfs_vdev_type_to_string(ZfsVdevType::Mirror), "mirror"sv);
+
+        REQUIRE_EQ(gucc::fs::string_to_zfs_vdev_class("special"sv), ZfsVdevClass::Special);
+        REQUIRE_FALSE(gucc::fs::string_to_zfs_vdev_class("dedup"sv).has_value());
+        REQUIRE_EQ(gucc::fs::zfs_vdev_class_to_string(ZfsVdevClass::Cache), "cache"sv);
+    }
+    SECTION("ashift")
+    {
+        REQUIRE_EQ(gucc::fs::zfs_ashift_for_block_size(512), 12);
+        REQUIRE_EQ(gucc::fs::zfs_ashift_for_block_size(4096), 12);
+        REQUIRE_EQ(gucc::fs::zfs_ashift_for_block_size(8192), 13);
+        REQUIRE_EQ(gucc::fs::zfs_ashift_for_block_size(16384), 14);
+        REQUIRE_EQ(gucc::fs::zfs_ashift_for_block_size(1U << 20), 16);
+        REQUIRE_EQ(gucc::fs::zfs_ashift_for_block_size(0), 12);
+    }
+    SECTION("plan")
+    {
+        auto members = db_host_members();
+        // one 8K device raises the ashift of the whole pool
+        members[1].physical_block_size = 8192;
+
+        const auto& plan = gucc::fs::plan_zpool(db_host_vdevs(), members);
+        REQUIRE(plan.has_value());
+        REQUIRE_EQ(plan->ashift, 13);
+        REQUIRE_EQ(plan->data_capacity, 1000 * GIB);
+        REQUIRE(plan->warnings.empty());
+    }
+    SECTION("plan warnings")
+    {
+        auto members = db_host_members();
+        members[1].size_bytes = 2000 * GIB;
+        members[2].size_bytes = 1 * GIB;
+        members[3].size_bytes = 1 * GIB;
+
+        const auto& plan = gucc::fs::plan_zpool(db_host_vdevs(), members);
+        REQUIRE(plan.has_value());
+        // uneven mirror, undersized special vdev
+        REQUIRE_EQ(plan->warnings.size(), 2);
+    }
+    SECTION("invalid layouts")
+    {
+        const auto& members = db_host_members();
+
+        // no data vdev
+        const std::vector<ZfsVdev> cache_only{ZfsVdev{.vdev_class = ZfsVdevClass::Cache, .devices = {"/dev/nvme5n1"s}}};
+        REQUIRE_FALSE(gucc::fs::plan_zpool(cache_only, members).has_value());
+
+        // mirror of one
+        auto vdevs = db_host_vdevs();
+        vdevs[0].devices.pop_back();
+        REQUIRE_FALSE(gucc::fs::plan_zpool(vdevs, members).has_value());
+
+        // raidz2 needs three devices
+        vdevs = db_host_vdevs();
+        vdevs[0].type = ZfsVdevType::Raidz2;
+        REQUIRE_FALSE(gucc::fs::plan_zpool(vdevs, members).has_value());
+
+        // single special device next to mirrored data
+        vdevs = db_host_vdevs();
+        vdevs[1].type = ZfsVdevType::Stripe;
+        vdevs[1].devices.pop_back();
+        REQUIRE_FALSE(gucc::fs::plan_zpool(vdevs, members).has_value());
+
+        // mirrored cache
+        vdevs = db_host_vdevs();
+        vdevs[3] = ZfsVdev{.vdev_class = ZfsVdevClass::Cache, .type = ZfsVdevType::Mirror, .devices = {"/dev/nvme4n1"s, "/dev/nvme5n1"s}};
+        vdevs.erase(vdevs.begin() + 2);
+        REQUIRE_FALSE(gucc::fs::plan_zpool(vdevs, members).has_value());
+
+        // same device twice
+        vdevs = db_host_vdevs();
+        vdevs[2].devices = {"/dev/nvme5n1"s};
+        REQUIRE_FALSE(gucc::fs::plan_zpool(vdevs, members).has_value());
+
+        // too small
+        auto tiny_members          = db_host_members();
+        tiny_members[4].size_bytes = 32ULL * 1024 * 1024;
+        REQUIRE_FALSE(gucc::fs::plan_zpool(db_host_vdevs(), tiny_members).has_value());
+
+        // unknown device
+        vdevs = db_host_vdevs();
+        vdevs[2].devices = {"/dev/sdz"s};
+        REQUIRE_FALSE(gucc::fs::plan_zpool(vdevs, members).has_value());
+    }
+    SECTION("merge root device")
+    {
+        std::vector<ZfsVdev> vdevs{
+            ZfsVdev{.vdev_class = ZfsVdevClass::Log, .devices = {"/dev/nvme4n1"s}},
+            ZfsVdev{.vdev_class = ZfsVdevClass::Data, .type = ZfsVdevType::Mirror, .devices = {"/dev/nvme1n1"s}},
+        };
+        const auto& merged = gucc::fs::zfs_merge_root_device("/dev/nvme0n1p2"sv, vdevs);
+        const std::vector<std::string> expected_members{"/dev/nvme0n1p2"s, "/dev/nvme1n1"s};
+        REQUIRE_EQ(merged.size(), 2);
+        REQUIRE_EQ(merged[1].devices, expected_members);
+
+        // listed already
+        const auto& listed = gucc::fs::zfs_merge_root_device("/dev/nvme1n1"sv, vdevs);
+        REQUIRE_EQ(listed[1].devices.size(), 1);
+
+        // no data vdev
+        const auto& single = gucc::fs::zfs_merge_root_device("/dev/nvme0n1p2"sv, {});
+        REQUIRE_EQ(single.size(), 1);
+        REQUIRE_EQ(single[0].vdev_class, ZfsVdevClass::Data);
+        REQUIRE_EQ(single[0].devices.front(), "/dev/nvme0n1p2"sv);
+    }
+    SECTION("zpool create command")
+    {
+        REQUIRE_EQ(gucc::fs::detail::zpool_vdev_args(db_host_vdevs()),
+            " mirror '/dev/nvme0n1p2' '/dev/nvme1n1' special mirror '/dev/nvme2n1' '/dev/nvme3n1' log '/dev/nvme4n1' cache '/dev/nvme5n1'");
+
+        // classes are grouped, each keyword once
+        const std::vector<ZfsVdev> vdevs{
+            ZfsVdev{.vdev_class = ZfsVdevClass::Cache, .devices = {"/dev/sdc"s}},
+            ZfsVdev{.vdev_class = ZfsVdevClass::Data, .type = ZfsVdevType::Mirror, .devices = {"/dev/sda"s, "/dev/sdb"s}},
+            ZfsVdev{.vdev_class = ZfsVdevClass::Cache, .devices = {"/dev/sdd"s}},
+            ZfsVdev{.vdev_class = ZfsVdevClass::Data, .type = ZfsVdevType::Mirror, .devices = {"/dev/sde"s, "/dev/sdf"s}},
+        };
+        REQUIRE_EQ(gucc::fs::detail::zpool_vdev_args(vdevs),
+            " mirror '/dev/sda' '/dev/sdb' mirror '/dev/sde' '/dev/sdf' cache '/dev/sdc' '/dev/sdd'");
+
+        REQUIRE_EQ(gucc::fs::detail::zpool_create_cmd("zpcachyos"sv, "-f -O atime=off"sv, vdevs, 13, false),
+            "zpool create -f -O atime=off -o ashift=13 'zpcachyos' mirror '/dev/sda' '/dev/sdb' mirror '/dev/sde' '/dev/sdf' cache '/dev/sdc' '/dev/sdd'");
+
+        // explicit ashift wins, encryption
+        const std::vector<ZfsVdev> single{ZfsVdev{.devices = {"/dev/sda2"s}}};
+        REQUIRE_EQ(gucc::fs::detail::zpool_create_cmd("zpcachyos"sv, "-f -o ashift=12"sv, single, 13, true),
+            "zpool create -f -o ashift=12 -O encryption=aes-256-gcm -O keyformat=passphrase 'zpcachyos' '/dev/sda2'");
+    }
+}
@@ -1,3 +1,4 @@
+#include "gucc/disk_topology.hpp"
 #include "gucc/system_query.hpp"
 #ifndef COS_BUILD_STATIC
 #include "gucc/logger.hpp"
@@ -46,6 +47,14 @@ void print_disk_info(const gucc::disk::DiskInfo& disk) {
     if (disk.pttype) {
         fmt::println("  Label:     {}", *disk.pttype);
     }
+    if (const auto& topology = gucc::disk::query_disk_topology(disk.device)) {
+        fmt::println("  Sectors:   {} logical / {} physical", topology->logical_block_size, topology->physical_block_size);
+        fmt::println("  I/O size:  {} minimum / {} optimal", topology->minimum_io_size, topology->optimal_io_size);
+        fmt::println("  Alignment: {}", gucc::disk::format_size(gucc::disk::compute_partition_alignment(*topology)));
+        for (const auto& warning : gucc::disk::get_topology_warnings(disk.device, *topology)) {
+            fmt::print(fmt::fg(fmt::color::yellow), "  Warning:   {}\n", warning);
+        }
+    }
 
     // Print partitions
     if (!disk.partitions.empty()) {
@@ -0,0 +1,194 @@
+#include "gucc/package_profiles.hpp"
+#include "gucc/profile_index.hpp"
+#include "gucc/string_utils.hpp"
+#ifndef COS_BUILD_STATIC
+#include "gucc/logger.hpp"
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>  // for stderr_color_sink_mt
+#include <spdlog/spdlog.h>                    // for set_default_logger, set_level
+
+using namespace std::string_view_literals;
+
+namespace {
+
+struct BenchOptions {
+    std::size_t desktops{200};
+    std::size_t groups{2000};
+    std::size_t packages{20};
+    std::size_t layers{4};
+    std::size_t lookups{100000};
+    /// the old path re-parses the doc per lookup, far fewer of them fit
+    std::size_t legacy_lookups{50};
+};
+
+void print_usage(const char* program_name) {
+    fmt::println(stderr, "Usage: {} [OPTIONS]", program_name);
+    fmt::println(stderr, "\nBenchmark net-profiles lookups against large synthetic layered profiles.");
+    fmt::println(stderr, "\nOptions:");
+    fmt::println(stderr, "  -h, --help               Show this help message");
+    fmt::println(stderr, "  --desktops N             Desktop profiles per layer (default 200)");
+    fmt::println(stderr, "  --groups N               Netinstall groups per layer (default 2000)");
+    fmt::println(stderr, "  --packages N             Packages per profile and group (default 20)");
+    fmt::println(stderr, "  --layers N               Layers merged on top of each other (default 4)");
+    fmt::println(stderr, "  --lookups N              Lookups through the index (default 100000)");
+    fmt::println(stderr, "  --legacy-lookups N       Lookups through a parse per call (default 50)");
+}
+
+// Every layer redefines a quarter of the previous ids and adds as many new ones,
+// so the merge has to both replace and append.
+auto make_layer(const BenchOptions& options, std::size_t layer) -> std::string {
+    const auto first_id = layer * (options.groups / 4);
+    const auto packages = [&](std::string_view prefix, std::size_t id) {
+        std::string list{};
+        for (std::size_t i = 0; i < options.packages; ++i) {
+            list += fmt::format("{}\"{}-{}-{}-l{}\"", (i != 0) ? ", " : "", prefix, id, i, layer);
+        }
+        return list;
+    };
+
+    std::string doc{};
+    if (layer == 0) {
+        doc += fmt::format("[base-packages]\npackages = [{}]\n[base-packages.desktop]\npackages = [{}]\n\n", packages("base"sv, 0), packages("desktop-base"sv, 0));
+    }
+    const auto first_desktop = layer * (options.desktops / 4);
+    for (std::size_t id = first_desktop; id < first_desktop + options.desktops; ++id) {
+        doc += fmt::format("[desktop.de{}]\npackages = [{}]\n\n", id, packages("de"sv, id));
+    }
+    for (std::size_t id = first_id; id < first_id + options.groups; ++id) {
+        doc += fmt::format("[[netinstall.group]]\nname = \"group{}\"\ndescription = \"synthetic group {}\"\npackages = [{}]\n\n", id, id, packages("pkg"sv, id));
+        if (id % 8 == 0) {
+            doc += fmt::format("  [[netinstall.group.subgroup]]\n  name = \"group{}-extras\"\n  packages = [{}]\n\n", id, packages("extra"sv, id));
+        }
+    }
+    return doc;
+}
+
+auto elapsed_ms(std::chrono::steady_clock::time_point start) -> double {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void print_row(std::string_view stage, double total_ms, std::size_t count) {
+    fmt::println("{:<24} {:>12.3f}ms {:>14.1f}us/op", stage, total_ms, (total_ms * 1000.0) / static_cast<double>(std::max<std::size_t>(count, 1)));
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options{};
+
+    // Parse arguments
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "-h"sv || arg == "--help"sv) {
+            print_usage(argv[0]);
+            return 0;
+        }
+
+        std::size_t* target{};
+        if (arg == "--desktops"sv) {
+            target = &options.desktops;
+        } else if (arg == "--groups"sv) {
+            target = &options.groups;
+        } else if (arg == "--packages"sv) {
+            target = &options.packages;
+        } else if (arg == "--layers"sv) {
+            target = &options.layers;
+        } else if (arg == "--lookups"sv) {
+            target = &options.lookups;
+        } else if (arg == "--legacy-lookups"sv) {
+            target = &options.legacy_lookups;
+        }
+        const auto value = (target != nullptr && i + 1 < argc) ? gucc::utils::parse_uint<std::uint64_t>(argv[i + 1]) : std::nullopt;
+        if (!value || *value == 0) {
+            fmt::println(stderr, "Invalid option: {}", arg);
+            print_usage(argv[0]);
+            return 1;
+        }
+        *target = static_cast<std::size_t>(*value);
+        ++i;
+    }
+
+    auto logger = spdlog::stderr_color_mt("cachyos_logger");
+    spdlog::set_default_logger(logger);
+    spdlog::set_level(spdlog::level::warn);
+#ifndef COS_BUILD_STATIC
+    gucc::logger::set_logger(logger);
+#endif
+
+    std::vector<std::string> layer_docs{};
+    std::size_t total_bytes{};
+    for (std::size_t layer = 0; layer < options.layers; ++layer) {
+        layer_docs.emplace_back(make_layer(options, layer));
+        total_bytes += layer_docs.back().size();
+    }
+    const std::vector<std::string_view> layers{layer_docs.begin(), layer_docs.end()};
+    fmt::println("{} layers, {} desktops and {} groups each, {:.1f}MiB of TOML\n", options.layers, options.desktops, options.groups, static_cast<double>(total_bytes) / (1024.0 * 1024.0));
+
+    auto start        = std::chrono::steady_clock::now();
+    const auto merged = gucc::profile::load_layered_net_profiles(layers);
+    if (!merged) {
+        fmt::println(stderr, "Failed to merge the synthetic layers");
+        return 1;
+    }
+    print_row("merge layers", elapsed_ms(start), 1);
+
+    start            = std::chrono::steady_clock::now();
+    const auto index = gucc::profile::ProfileIndex::build(*merged, gucc::profile::layers_revision(layers));
+    if (!index) {
+        fmt::println(stderr, "Failed to build the index: {}", gucc::to_string(index.error()));
+        return 1;
+    }
+    print_row("build index", elapsed_ms(start), 1);
+
+    start               = std::chrono::steady_clock::now();
+    const auto snapshot = index->serialize();
+    print_row("serialize snapshot", elapsed_ms(start), 1);
+
+    start             = std::chrono::steady_clock::now();
+    const auto loaded = gucc::profile::ProfileIndex::deserialize(snapshot, index->revision());
+    if (!loaded) {
+        fmt::println(stderr, "Failed to load the snapshot: {}", gucc::to_string(loaded.error()));
+        return 1;
+    }
+    print_row("load snapshot", elapsed_ms(start), 1);
+
+    const auto desktops = index->desktops();
+    const auto groups   = index->groups();
+
+    // what every consumer did per call before: parse the doc, scan for the id
+    std::size_t found{};
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < options.legacy_lookups; ++i) {
+        const auto& name = groups[(i * 7919) % groups.size()].name;
+        const auto parsed = gucc::profile::parse_netinstall_groups(*merged);
+        if (parsed && std::ranges::find(*parsed, name, &gucc::profile::NetinstallGroup::name) != parsed->end()) {
+            ++found;
+        }
+    }
+    print_row("parse + scan lookup", elapsed_ms(start), options.legacy_lookups);
+
+    start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < options.lookups; ++i) {
+        const auto& group_name   = groups[(i * 7919) % groups.size()].name;
+        const auto& desktop_name = desktops[(i * 104729) % desktops.size()].profile_name;
+        if (loaded->group_packages(group_name) != nullptr && loaded->find_desktop(desktop_name) != nullptr) {
+            ++found;
+        }
+    }
+    print_row("indexed lookup", elapsed_ms(start), options.lookups);
+
+    fmt::println("\nsnapshot: {:.1f}KiB, {} of {} lookups found", static_cast<double>(snapshot.size()) / 1024.0, found, options.legacy_lookups + options.lookups);
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "gucc/sync_db.hpp"
+#ifndef COS_BUILD_STATIC
+#include "gucc/logger.hpp"
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>  // for stderr_color_sink_mt
+#include <spdlog/spdlog.h>                    // for set_default_logger, set_level
+
+using namespace std::string_view_literals;
+
+namespace {
+
+void print_usage(const char* program_name) {
+    fmt::println(stderr, "Usage: {} [OPTIONS] TARGET...", program_name);
+    fmt::println(stderr, "\nResolve targets against the pacman sync databases without pacman.");
+    fmt::println(stderr, "\nOptions:");
+    fmt::println(stderr, "  -h, --help               Show this help message");
+    fmt::println(stderr, "  --config PATH            pacman.conf listing the repos (default /etc/pacman.conf)");
+    fmt::println(stderr, "  --sync-dir PATH          Directory of the <repo>.db files (default /var/lib/pacman/sync)");
+    fmt::println(stderr, "  -v, --verbose            Print the resolved packages in install order");
+}
+
+auto elapsed_ms(std::chrono::steady_clock::time_point start) -> double {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+auto to_mib(std::uint64_t bytes) -> double {
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::string_view config_path{"/etc/pacman.conf"};
+    std::string_view sync_dir{"/var/lib/pacman/sync"};
+    bool verbose{false};
+    std::vector<std::string> targets{};
+
+    // Parse arguments
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "-h"sv || arg == "--help"sv) {
+            print_usage(argv[0]);
+            return 0;
+        }
+        if (arg == "-v"sv || arg == "--verbose"sv) {
+            verbose = true;
+        } else if ((arg == "--config"sv || arg == "--sync-dir"sv) && i + 1 < argc) {
+            ((arg == "--config"sv) ? config_path : sync_dir) = argv[++i];
+        } else if (arg.starts_with('-')) {
+            fmt::println(stderr, "Unknown option: {}", arg);
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            targets.emplace_back(arg);
+        }
+    }
+    if (targets.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    auto logger = spdlog::stderr_color_mt("cachyos_logger");
+    spdlog::set_default_logger(logger);
+    spdlog::set_level(spdlog::level::warn);
+#ifndef COS_BUILD_STATIC
+    gucc::logger::set_logger(logger);
+#endif
+
+    const auto& repos = gucc::syncdb::repos_of_pacman_conf(config_path);
+    if (repos.empty()) {
+        fmt::println(stderr, "No repos found in {}", config_path);
+        return 1;
+    }
+
+    auto start    = std::chrono::steady_clock::now();
+    const auto db = gucc::syncdb::SyncDatabase::load(sync_dir, repos);
+    if (!db) {
+        fmt::println(stderr, "Failed to load the sync dbs: {}", gucc::to_string(db.error()));
+        return 1;
+    }
+    fmt::println("loaded {} packages from {} repos in {:.1f}ms", db->package_count(), repos.size(), elapsed_ms(start));
+
+    start                 = std::chrono::steady_clock::now();
+    const auto resolution = db->resolve(targets);
+    fmt::println("resolved {} packages in {:.3f}ms, {:.1f}MiB download, {:.1f}MiB installed", resolution.packages.size(), elapsed_ms(start), to_mib(resolution.download_size), to_mib(resolution.install_size));
+
+    if (verbose) {
+        for (const auto& pkg : resolution.packages) {
+            fmt::println("  {}/{} {}", pkg.repo, pkg.name, pkg.version);
+        }
+    }
+    for (const auto& missing : resolution.missing) {
+        if (missing.required_by.empty()) {
+            fmt::println("target not found: {}", missing.dependency);
+        } else {
+            fmt::println("unable to satisfy '{}' required by {}", missing.dependency, missing.required_by);
+        }
+    }
+    for (const auto& conflict : resolution.conflicts) {
+        fmt::println("{} and {} are in conflict ({})", conflict.package, conflict.conflicts_with, conflict.rule);
+    }
+    return resolution.ok() ? 0 : 1;
+}
@@ -3,6 +3,7 @@
 #include "gucc/logger.hpp"
 #endif
 
+#include <chrono>
 #include <cstdlib>
 #include <string>
 #include <string_view>
@@ -25,6 +26,7 @@ void print_usage(const char* program_name) {
     fmt::println(stderr, "  -p, --pools      List all imported pools (default if no pool specified)");
     fmt::println(stderr, "  -d, --datasets   List datasets in pool");
     fmt::println(stderr, "  -a, --all        Show all pools and their datasets");
+    fmt::println(stderr, "  -t, --timing     Print how long the queries took");
     fmt::println(stderr, "\nExamples:");
     fmt::println(stderr, "  {}                List all pools", program_name);
     fmt::println(stderr, "  {} zroot          Show pool info for zroot", program_name);
@@ -194,19 +196,24 @@ void list_all() {
         return;
     }
 
+    // one zfs list for all pools
+    const auto& all_datasets = gucc::fs::list_zfs_datasets();
     for (const auto& pool : pools) {
         print_pool_info(pool);
 
         fmt::println("  Datasets:");
-        auto datasets = gucc::fs::list_zfs_datasets(pool.name);
-        if (datasets.empty()) {
-            fmt::println("    (none)");
-        } else {
-            for (const auto& ds : datasets) {
-                std::string mount_str = ds.mountpoint.empty() ? "-" : ds.mountpoint;
-                fmt::println("    {:30} {:15} {}",
-                    ds.name, mount_str, format_size(ds.used));
+        bool has_datasets = false;
+        for (const auto& ds : all_datasets) {
+            if (ds.name != pool.name && !ds.name.starts_with(pool.name + '/')) {
+                continue;
             }
+            has_datasets          = true;
+            std::string mount_str = ds.mountpoint.empty() ? "-" : ds.mountpoint;
+            fmt::println("    {:30} {:15} {}",
+                ds.name, mount_str, format_size(ds.used));
+        }
+        if (!has_datasets) {
+            fmt::println("    (none)");
         }
         fmt::println("");
     }
@@ -216,6 +223,7 @@ int main(int argc, char* argv[]) {
     bool list_pools_only    = false;
     bool list_datasets_flag = false;
     bool show_all           = false;
+    bool show_timing        = false;
     std::string pool_name;
 
     // Parse arguments
@@ -231,6 +239,8 @@ int main(int argc, char* argv[]) {
             list_datasets_flag = true;
         } else if (arg == "-a"sv || arg == "--all"sv) {
             show_all = true;
+        } else if (arg == "-t"sv || arg == "--timing"sv) {
+            show_timing = true;
         } else if (arg.starts_with('-')) {
             fmt::println(stderr, "Unknown option: {}", arg);
             print_usage(argv[0]);
@@ -259,6 +269,7 @@ int main(int argc, char* argv[]) {
     }
 
     // Execute requested action
+    const auto start = std::chrono::steady_clock::now();
     if (show_all) {
         list_all();
     } else if (list_datasets_flag) {
@@ -269,5 +280,10 @@ int main(int argc, char* argv[]) {
         show_pool_info(pool_name);
     }
 
+    if (show_timing) {
+        const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+        fmt::println(stderr, "Queries took {:.1f}ms", elapsed.count());
+    }
+
     return 0;
 }
@@ -10,6 +10,23 @@
 
 namespace cachyos::installer {
 
+/// Packages the install of one bootloader asks for.
+struct BootloaderPackages final {
+    /// Installed on the live system, the bootloader tools run from there.
+    std::vector<std::string> host;
+    /// Installed into the target before the bootloader, a failure aborts it.
+    std::vector<std::string> target;
+    /// Installed into the target afterwards, a failure is only logged.
+    std::vector<std::string> extras;
+};
+
+/// The packages bootloader @p type installs in @p mode, for a root on
+/// filesystem @p root_fs. Both the install paths and the offline bundle
+/// take their lists from here.
+[[nodiscard]] auto bootloader_packages(gucc::bootloader::BootloaderType type,
+    InstallContext::SystemMode mode, std::string_view root_fs) noexcept
+    -> BootloaderPackages;
+
 /// Installs the bootloader selected in the context.
 [[nodiscard]] auto install_bootloader(const InstallContext& ctx) noexcept
     -> std::expected<void, std::string>;
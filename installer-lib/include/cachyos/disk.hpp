@@ -49,8 +49,15 @@ struct MountApplicationResult {
 /// Returns the default set of btrfs subvolumes used by CachyOS.
 [[nodiscard]] auto default_btrfs_subvolumes() noexcept -> std::vector<gucc::fs::BtrfsSubvolume>;
 
+/// Returns the extra btrfs subvolumes for @p server_profile, empty for profiles without any.
+/// `db` gets NOCOW subvolumes for postgres and mysql, `container-host` a compressed
+/// /var/lib/containers and a NOCOW /var/lib/libvirt/images.
+[[nodiscard]] auto server_btrfs_subvolumes(std::string_view server_profile) noexcept -> std::vector<gucc::fs::BtrfsSubvolume>;
+
 /// Returns the default set of ZFS datasets used by CachyOS for a given pool.
-[[nodiscard]] auto default_zfs_datasets(std::string_view zpool_name) noexcept
+/// /var/cache and /var/log are tuned for their workload, the `db` @p server_profile
+/// adds database datasets for /var/lib/postgres and /var/lib/mysql, as btrfs gets subvolumes.
+[[nodiscard]] auto default_zfs_datasets(std::string_view zpool_name, std::string_view server_profile = {}) noexcept
     -> std::vector<gucc::fs::ZfsDataset>;
 
 /// The default ZFS pool name.
@@ -58,8 +65,9 @@ inline constexpr std::string_view kDefaultZpoolName{"zpcachyos"};
 
 /// Builds the default ZFS pool + dataset configuration for @p zpool_name.
 /// When @p passphrase is set the pool is configured for native encryption.
+/// @p server_profile picks the datasets, see default_zfs_datasets.
 [[nodiscard]] auto default_zfs_setup(std::string_view zpool_name,
-    std::optional<std::string> passphrase = std::nullopt) noexcept
+    std::optional<std::string> passphrase = std::nullopt, std::string_view server_profile = {}) noexcept
     -> gucc::fs::ZfsSetupConfig;
 
 /// Returns available mount options for a given filesystem type.
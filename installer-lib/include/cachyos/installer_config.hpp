@@ -35,12 +35,61 @@ struct PartitionConfig {
     std::string size;
     std::string fs_name;
     PartitionType type{PartitionType::Additional};
+
+    /// Device class the mkfs/mount tuning is picked for (e.g. "nvme", "hdd"),
+    /// detected from the device when unset. "generic" turns tuning off.
+    std::optional<std::string> tuning{};
+    /// Replaces the tuned mkfs command, e.g. "mkfs.ext4 -q -E stride=16"
+    std::optional<std::string> mkfs_command{};
+    /// Replaces the tuned mount options
+    std::optional<std::string> mount_opts{};
 };
 
 /// Configuration for a single btrfs subvolume.
 struct SubvolumeConfig {
     std::string subvolume;
     std::string mountpoint;
+    /// Disables copy-on-write for everything created in the subvolume
+    bool nocow{false};
+    /// btrfs.compression property: zstd, lzo, zlib or none
+    std::optional<std::string> compression{};
+    /// Replaces `mount_opts` for this subvolume, only mount flags may differ
+    std::optional<std::string> mount_opts{};
+};
+
+/// Configuration for a single top-level vdev of the root zpool.
+struct ZfsVdevConfig {
+    /// stripe, mirror, raidz1, raidz2 or raidz3
+    std::string type{"stripe"};
+    /// data, special, log or cache
+    std::string vdev_class{"data"};
+    std::vector<std::string> devices{};
+};
+
+/// Configuration of a mountpoint on slow devices, cached by its own partition.
+struct LvmCacheSetupConfig {
+    /// Mountpoint of the partition which becomes the cache, e.g "/home"
+    std::string mountpoint;
+    /// Slow devices (e.g HDDs) the logical volume spans
+    std::vector<std::string> origin_devices{};
+    /// writethrough, writeback or writecache
+    std::string mode{"writethrough"};
+    std::string vg_name{"vgcachyos"};
+};
+
+/// Configuration of a mountpoint spread over several devices.
+/// btrfs uses its own raid profiles, other filesystems go onto an md array.
+struct RaidSetupConfig {
+    /// Mountpoint of the partition which becomes the first member
+    std::string mountpoint{"/"};
+    /// raid0, raid1 or raid10
+    std::string level;
+    /// The other members, whole devices or partitions
+    std::vector<std::string> devices{};
+    /// btrfs metadata profile, ignored for md arrays
+    std::string metadata{"raid1"};
+    /// md array name, ignored for btrfs
+    std::string name{"cachyos"};
 };
 
 /// Main installer configuration.
@@ -69,6 +118,21 @@ struct InstallerConfig {
     /// Reuse the live environment's package cache for the target.
     bool hostcache{true};
 
+    /// Install packages through libalpm in-process instead of pacstrap.
+    /// Falls back to pacstrap when the installer was built without libalpm.
+    bool alpm_backend{false};
+
+    /// With `hostcache`, download packages onto the target disk instead of the
+    /// live environment's cache, which is RAM on the ISO.
+    bool target_cache{false};
+
+    /// Remove the packages from the target's cache once the install is done.
+    bool prune_cache{false};
+
+    /// Directory of an offline bundle to install from instead of the mirrors,
+    /// or to build into with `--build-bundle`.
+    std::optional<std::string> offline_bundle{};
+
     // System settings
     std::optional<std::string> hostname{};
     std::optional<std::string> locale{};
@@ -83,6 +147,14 @@ struct InstallerConfig {
 
     /// Passphrase for native ZFS encryption of the root pool.
     std::optional<std::string> zfs_passphrase{};
+    /// Extra vdevs of the root pool, the root partition joins the first data vdev.
+    std::vector<ZfsVdevConfig> zfs_vdevs{};
+
+    /// Tiered storage: a LV on slow devices with an SSD cache.
+    std::optional<LvmCacheSetupConfig> lvm_cache{};
+
+    /// Multi-device filesystem: md raid or btrfs raid profiles.
+    std::optional<RaidSetupConfig> raid{};
 
     // Packages
     std::optional<std::string> kernel{};
@@ -0,0 +1,37 @@
+#ifndef CACHYOS_INSTALLER_OFFLINE_BUNDLE_HPP
+#define CACHYOS_INSTALLER_OFFLINE_BUNDLE_HPP
+
+#include "cachyos/installer_config.hpp"
+#include "cachyos/types.hpp"
+
+#include <expected>     // for expected
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <vector>       // for vector
+
+namespace cachyos::installer {
+
+// Profile snapshots in `<bundle>/profiles`, the package set was resolved from them.
+inline constexpr std::string_view kBundleNetProfiles{"net-profiles.toml"};
+inline constexpr std::string_view kBundleNetProfilesUser{"net-profiles-user.toml"};
+inline constexpr std::string_view kBundleServerProfiles{"server-profiles.toml"};
+
+/// Points the net and server profile urls of @p ctx at the snapshots of the
+/// bundle in `ctx.offline_bundle`.
+void use_bundle_profiles(InstallContext& ctx) noexcept;
+
+/// Every package an install of @p inputs may ask for: base, desktop or server
+/// profile, netinstall groups, bootloader and shell config. Both microcode
+/// packages are in, the CPU of the installed machine isn't known up front.
+[[nodiscard]] auto bundle_packages(const InstallerConfig& cfg, const InstallerInputs& inputs) noexcept
+    -> std::expected<std::vector<std::string>, std::string>;
+
+/// Builds the offline bundle of the headless config @p cfg at `cfg.offline_bundle`,
+/// from the repos of the host and dbs freshly fetched from their servers.
+/// Running it again on the same directory only downloads what changed.
+[[nodiscard]] auto build_offline_bundle(const InstallerConfig& cfg) noexcept
+    -> std::expected<void, std::string>;
+
+}  // namespace cachyos::installer
+
+#endif  // CACHYOS_INSTALLER_OFFLINE_BUNDLE_HPP
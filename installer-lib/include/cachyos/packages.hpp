@@ -31,6 +31,10 @@ namespace cachyos::installer {
     std::string_view mountpoint, bool hostcache) noexcept
     -> std::expected<void, std::string>;
 
+/// Same as above, through the backend @p ctx asks for.
+[[nodiscard]] auto install_packages(const std::vector<std::string>& packages, const InstallContext& ctx) noexcept
+    -> std::expected<void, std::string>;
+
 /// Removes packages from the target system.
 [[nodiscard]] auto remove_packages(const std::vector<std::string>& packages,
     std::string_view mountpoint) noexcept
@@ -2,8 +2,12 @@
 
 #include "cachyos/types.hpp"
 
+// import gucc
+#include "gucc/luks.hpp"
+
 #include <cstdint>      // for uint64_t
 #include <expected>     // for expected
+#include <optional>     // for optional
 #include <string>       // for string
 #include <string_view>  // for string_view
 #include <vector>       // for vector
@@ -44,8 +48,11 @@ struct ExistingZfsPool {
 
 /// @brief An LVM volume group active on the live system.
 struct ExistingLvmGroup {
-    std::string name;  ///< volume group name
-    std::string size;  ///< group size, the way LVM prints it
+    std::string name;                             ///< volume group name
+    std::uint64_t size{};                         ///< group size in bytes
+    std::uint64_t free{};                         ///< unallocated bytes
+    std::vector<std::string> physical_volumes{};  ///< e.g "/dev/sda2"
+    std::vector<std::string> logical_volumes{};   ///< LV names, hidden LVs left out
 };
 
 /// @brief One row of a btrfs subvolume layout.
@@ -120,8 +127,8 @@ enum class LuksVersion : std::uint8_t {
 
 /// @brief What you need to format a new LUKS partition.
 ///
-/// device, mapper_name and passphrase all have to be non-empty. extra_flags is
-/// optional.
+/// device, mapper_name and passphrase all have to be non-empty. extra_flags,
+/// perf and bypass_workqueues are optional.
 struct LuksFormatRequest {
     /// Block device to format. Will be overwritten.
     std::string device;
@@ -134,6 +141,13 @@ struct LuksFormatRequest {
     std::string extra_flags;
     /// On-disk LUKS header version.
     LuksVersion version{LuksVersion::Luks2};
+    /// dm-crypt sector size and workqueue bypass. Left empty, they are queried from
+    /// req.device with gucc::crypto::query_luks_perf_options. LUKS1 only takes the
+    /// workqueue bypass, its sectors are always 512 bytes.
+    std::optional<gucc::crypto::LuksPerfOptions> perf{};
+    /// Whether the queried options bypass the dm-crypt workqueues on NVMe. Off unless
+    /// asked for, the bypass trades throughput under load for latency.
+    bool bypass_workqueues{false};
 };
 
 /// @brief What you need to open an existing LUKS partition.
@@ -153,8 +167,10 @@ struct LuksOpenRequest {
 /// Formats req.device as LUKS (version from LuksFormatRequest::version) and opens
 /// it as req.mapper_name, so the rest of the plan can treat /dev/mapper/<name>
 /// like a normal block device.
+/// Mapper name, LUKS uuid and the crypttab options of the workqueue bypass are
+/// stored on @p partition, which fstab, crypttab and the kernel cmdline are built from.
 /// @warning wipes everything on req.device.
-[[nodiscard]] auto encrypt_partition(const LuksFormatRequest& req) noexcept
+[[nodiscard]] auto encrypt_partition(const LuksFormatRequest& req, gucc::fs::Partition& partition) noexcept
     -> std::expected<void, std::string>;
 
 /// @brief Open an existing LUKS partition under its mapper name.
@@ -109,7 +109,7 @@ auto detect_crypto(InstallContext& ctx) noexcept
 [[nodiscard]] auto final_validation(const InstallContext& ctx) noexcept
     -> ValidationResult;
 
-/// Copy /tmp/cachyos-install.log into the target and unmount partitions.
+/// Copy /tmp/cachyos-install.log into the target, prune its package cache when asked and unmount partitions.
 [[nodiscard]] auto cleanup(const InstallContext& ctx) noexcept
     -> std::vector<std::string>;
 
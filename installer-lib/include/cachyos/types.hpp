@@ -4,10 +4,13 @@
 // import gucc
 #include "gucc/bootloader.hpp"
 #include "gucc/btrfs.hpp"
+#include "gucc/lvm_cache.hpp"
 #include "gucc/partition.hpp"
+#include "gucc/raid.hpp"
 #include "gucc/server_profiles.hpp"
 #include "gucc/zfs_types.hpp"
 
+#include <chrono>       // for milliseconds
 #include <cstdint>      // for int32_t
 #include <functional>   // for function
 #include <optional>     // for optional
@@ -95,6 +98,12 @@ namespace partition_strategy {
         std::vector<gucc::fs::Partition> partitions;
         std::vector<gucc::fs::BtrfsSubvolume> btrfs_subvolumes;
         std::optional<gucc::fs::ZfsSetupConfig> zfs_setup;
+        /// Moves the partition at `lvm_cache->cache_device` onto a LV of the
+        /// origin devices, the partition itself becomes the cache.
+        std::optional<gucc::lvm::LvmCacheConfig> lvm_cache;
+        /// Spreads the partition at `raid->devices.front()` over the other
+        /// devices, as an md array or as a multi-device btrfs.
+        std::optional<gucc::raid::RaidSetup> raid;
     };
 
     /// Let the installer pick a default layout for @p device.
@@ -140,6 +149,14 @@ struct InstallContext {
     // System
     SystemMode system_mode{SystemMode::UEFI};
     bool hostcache{true};
+    // install through libalpm instead of spawning pacstrap, when gucc has it
+    bool alpm_backend{false};
+    // with hostcache, download into the target's cache instead of the live ISO's RAM
+    bool target_cache{false};
+    // drop the target's package cache once the install is done
+    bool prune_cache{false};
+    // install from the offline bundle in this directory instead of the mirrors
+    std::string offline_bundle;
 
     // Partitions
     std::vector<gucc::fs::Partition> partition_schema;
@@ -147,6 +164,9 @@ struct InstallContext {
     std::string uefi_mount;
     std::vector<std::string> zfs_zpool_names;
     bool zfs_encrypted{false};
+    std::vector<std::string> lvm_volume_groups;
+    std::vector<std::string> md_arrays;
+    bool btrfs_multi_device{false};
 
     /// How the Partition step prepares the target disk.
     PartitionStrategy strategy{partition_strategy::UseExisting{}};
@@ -196,6 +216,9 @@ struct InstallContext {
     std::string net_profiles_fallback_url{kDefaultNetProfilesFallbackUrl};
     std::string net_profiles_user_path;
 
+    /// How long the remote net/server profiles get before their fallback url is fetched too.
+    std::chrono::milliseconds profiles_hedge_delay{1500};
+
     /// Carry the live ISO's NetworkManager system-connections into the target.
     bool carry_live_network{true};
 };
@@ -20,6 +20,7 @@
 #include <fstream>      // for ofstream
 #include <string>       // for string
 #include <string_view>  // for string_view
+#include <vector>       // for vector
 
 #include <fmt/compile.h>
 #include <fmt/format.h>
@@ -62,9 +63,8 @@ void configure_grub_common(gucc::bootloader::GrubConfig& grub_config,
     std::string_view mountpoint,
     std::string_view luks_dev,
     bool is_fde,
-    std::string_view zfs_extra_pkgs,
-    std::string_view non_zfs_extra_pkgs) noexcept {
-    const auto& root_part_fs        = gucc::fs::utils::get_mountpoint_fs(mountpoint);
+    std::string_view root_part_fs,
+    const std::vector<std::string>& extra_pkgs) noexcept {
     const auto& grub_installer_path = fmt::format(FMT_COMPILE("{}/usr/bin/grub_installer.sh"), mountpoint);
 
     // grub config changes for zfs root
@@ -78,10 +78,6 @@ void configure_grub_common(gucc::bootloader::GrubConfig& grub_config,
         const auto& zroot_var             = fmt::format(FMT_COMPILE("zfs={} rw"), mountpoint_source);
         grub_config.cmdline_linux_default = fmt::format(FMT_COMPILE("{} {}"), grub_config.cmdline_linux_default, zroot_var);
         grub_config.cmdline_linux         = fmt::format(FMT_COMPILE("{} {}"), grub_config.cmdline_linux, zroot_var);
-
-        const auto& bash_code = fmt::format(FMT_COMPILE("#!/bin/bash\nln -s /hostlvm /run/lvm\npacman -S --noconfirm --needed {}\n"), zfs_extra_pkgs);
-        std::ofstream grub_installer{grub_installer_path};
-        grub_installer << bash_code;
     } else {
         // disable SAVEDEFAULT if on LVM or BTRFS
         const auto& root_blk_devices = gucc::disk::list_block_devices();
@@ -93,8 +89,11 @@ void configure_grub_common(gucc::bootloader::GrubConfig& grub_config,
         if (is_root_lvm || (root_part_fs == "btrfs"sv)) {
             grub_config.savedefault = std::nullopt;
         }
+    }
 
-        const auto& bash_code = fmt::format(FMT_COMPILE("#!/bin/bash\nln -s /hostlvm /run/lvm\npacman -S --noconfirm --needed {}\n"), non_zfs_extra_pkgs);
+    // closed before the permissions and the sed below touch it
+    {
+        const auto& bash_code = fmt::format(FMT_COMPILE("#!/bin/bash\nln -s /hostlvm /run/lvm\npacman -S --noconfirm --needed {}\n"), fmt::join(extra_pkgs, " "));
         std::ofstream grub_installer{grub_installer_path};
         grub_installer << bash_code;
     }
@@ -175,6 +174,35 @@ auto bios_bootloader(const InstallContext& ctx) noexcept
 
 namespace cachyos::installer {
 
+auto bootloader_packages(gucc::bootloader::BootloaderType type,
+    InstallContext::SystemMode mode, std::string_view root_fs) noexcept
+    -> BootloaderPackages {
+    using gucc::bootloader::BootloaderType;
+    switch (type) {
+    case BootloaderType::Grub: {
+        BootloaderPackages packages{};
+        packages.target = (mode == InstallContext::SystemMode::UEFI)
+            ? std::vector<std::string>{"grub", "efibootmgr", "dosfstools"}
+            : std::vector<std::string>{"grub", "os-prober"};
+        // no btrfs snapshots to boot on a zfs root
+        if (root_fs != "zfs"sv) {
+            packages.target.insert(packages.target.cend(), {"grub-btrfs", "grub-hook"});
+        }
+        return packages;
+    }
+    case BootloaderType::Refind:
+        return {.host = {"refind"}, .extras = {"refind-theme-nord"}};
+    case BootloaderType::SystemdBoot:
+        return {.target = {"systemd-boot-manager"}};
+    case BootloaderType::Limine:
+        if (root_fs == "btrfs"sv) {
+            return {.host = {"cachyos-wallpapers"}, .target = {"limine-mkinitcpio-hook"}, .extras = {"cachyos-snapper-support", "limine-snapper-sync"}};
+        }
+        return {.host = {"cachyos-wallpapers"}, .target = {"limine-mkinitcpio-hook"}};
+    }
+    return {};
+}
+
 auto install_bootloader(const InstallContext& ctx) noexcept
     -> std::expected<void, std::string> {
     if (ctx.system_mode == InstallContext::SystemMode::BIOS) {
@@ -212,10 +240,10 @@ auto install_grub_uefi(const InstallContext& ctx, std::string_view bootid,
     grub_install_config_struct.is_removable = is_volume_removable(mountpoint);
 
     // Configure shared GRUB settings
+    const auto& root_part_fs = gucc::fs::utils::get_mountpoint_fs(mountpoint);
     configure_grub_common(grub_config_struct, grub_install_config_struct,
-        mountpoint, luks_dev, ctx.crypto.is_fde,
-        "grub efibootmgr dosfstools"sv,
-        "grub efibootmgr dosfstools grub-btrfs grub-hook"sv);
+        mountpoint, luks_dev, ctx.crypto.is_fde, root_part_fs,
+        bootloader_packages(ctx.bootloader, InstallContext::SystemMode::UEFI, root_part_fs).target);
 
     const auto& grub_installer_path = fmt::format(FMT_COMPILE("{}/usr/bin/grub_installer.sh"), mountpoint);
 
@@ -287,10 +315,10 @@ auto install_grub_bios(const InstallContext& ctx) noexcept
     grub_config_struct.disable_os_prober = ctx.disable_os_prober;
 
     // Configure shared GRUB settings (ZFS, btrfs, LUKS, FDE, grub_installer.sh)
+    const auto& root_part_fs = gucc::fs::utils::get_mountpoint_fs(mountpoint);
     configure_grub_common(grub_config_struct, grub_install_config_struct,
-        mountpoint, luks_dev, ctx.crypto.is_fde,
-        "grub os-prober"sv,
-        "grub os-prober grub-btrfs grub-hook"sv);
+        mountpoint, luks_dev, ctx.crypto.is_fde, root_part_fs,
+        bootloader_packages(ctx.bootloader, InstallContext::SystemMode::BIOS, root_part_fs).target);
 
     const auto& grub_installer_path = fmt::format(FMT_COMPILE("{}/usr/bin/grub_installer.sh"), mountpoint);
     std::error_code err{};
@@ -324,9 +352,11 @@ auto install_refind(const InstallContext& ctx) noexcept
     const auto& uefi_mount      = ctx.uefi_mount;
     const auto& boot_mountpoint = fmt::format(FMT_COMPILE("{}{}"), mountpoint, uefi_mount);
 
-    auto needed_result = install_needed("refind");
-    if (!needed_result) {
-        return std::unexpected(needed_result.error());
+    const auto& packages = bootloader_packages(ctx.bootloader, ctx.system_mode, gucc::fs::utils::get_mountpoint_fs(mountpoint));
+    for (const auto& pkg : packages.host) {
+        if (auto needed_result = install_needed(pkg); !needed_result) {
+            return std::unexpected(needed_result.error());
+        }
     }
 
     const std::vector<std::string> extra_kernel_versions{
@@ -354,9 +384,9 @@ auto install_refind(const InstallContext& ctx) noexcept
     const auto& refind_conf_content = gucc::file_utils::read_whole_file(fmt::format(FMT_COMPILE("{}/boot/refind_linux.conf"), mountpoint));
     spdlog::info("[DUMP_TO_LOG] :=\n{}", refind_conf_content);
 
-    auto pkg_result = install_packages({"refind-theme-nord"}, mountpoint, ctx.hostcache);
+    auto pkg_result = install_packages(packages.extras, ctx);
     if (!pkg_result) {
-        spdlog::warn("Failed to install refind-theme-nord: {}", pkg_result.error());
+        spdlog::warn("Failed to install {}: {}", fmt::join(packages.extras, " "), pkg_result.error());
     }
 
     spdlog::info("Refind was succesfully installed");
@@ -370,9 +400,10 @@ auto install_systemd_boot(const InstallContext& ctx) noexcept
     const auto& uefi_mount = ctx.uefi_mount;
 
     // preinstall systemd-boot-manager
-    auto pkg_result = install_packages({"systemd-boot-manager"}, mountpoint, ctx.hostcache);
+    const auto& packages = bootloader_packages(ctx.bootloader, ctx.system_mode, gucc::fs::utils::get_mountpoint_fs(mountpoint));
+    auto pkg_result      = install_packages(packages.target, ctx);
     if (!pkg_result) {
-        return std::unexpected(fmt::format("failed to install systemd-boot-manager: {}", pkg_result.error()));
+        return std::unexpected(fmt::format("failed to install {}: {}", fmt::join(packages.target, " "), pkg_result.error()));
     }
 
     const gucc::bootloader::SystemdBootInstallConfig sdboot_config{
@@ -418,15 +449,17 @@ auto install_limine(const InstallContext& ctx) noexcept
     }
 
     // Preinstall limine-mkinitcpio-hook
-    auto pkg_result = install_packages({"limine-mkinitcpio-hook"}, mountpoint, ctx.hostcache);
+    const auto& packages = bootloader_packages(ctx.bootloader, ctx.system_mode, gucc::fs::utils::get_mountpoint_fs(mountpoint));
+    auto pkg_result      = install_packages(packages.target, ctx);
     if (!pkg_result) {
-        return std::unexpected(fmt::format("failed to install limine-mkinitcpio-hook: {}", pkg_result.error()));
+        return std::unexpected(fmt::format("failed to install {}: {}", fmt::join(packages.target, " "), pkg_result.error()));
     }
 
     // Install splash screen
-    auto splash_result = install_needed("cachyos-wallpapers");
-    if (!splash_result) {
-        spdlog::warn("Failed to install cachyos-wallpapers: {}", splash_result.error());
+    for (const auto& pkg : packages.host) {
+        if (auto splash_result = install_needed(pkg); !splash_result) {
+            spdlog::warn("Failed to install {}: {}", pkg, splash_result.error());
+        }
     }
 
     // Copy cachyos splash screen
@@ -443,9 +476,8 @@ auto install_limine(const InstallContext& ctx) noexcept
     }
 
     // Integrate Snapper support for btrfs
-    const auto& filesystem_type = gucc::fs::utils::get_mountpoint_fs(mountpoint);
-    if (filesystem_type == "btrfs"sv) {
-        auto snapper_result = install_packages({"cachyos-snapper-support", "limine-snapper-sync"}, mountpoint, ctx.hostcache);
+    if (!packages.extras.empty()) {
+        auto snapper_result = install_packages(packages.extras, ctx);
         if (!snapper_result) {
             spdlog::warn("Failed to install snapper support: {}", snapper_result.error());
         }
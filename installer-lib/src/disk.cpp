@@ -37,7 +37,14 @@ using namespace std::string_literals;
 namespace {
 
 /// Default ZFS pool creation options shared by all ZFS setup paths.
-constexpr auto kDefaultZpoolOptions{"-f -o ashift=12 -o autotrim=on -O mountpoint=none -O acltype=posixacl -O atime=off -O relatime=off -O xattr=sa -O normalization=formD -O dnodesize=auto"sv};
+/// ashift is picked by gucc from the physical sector size of the vdevs.
+constexpr auto kDefaultZpoolOptions{"-f -o autotrim=on -O mountpoint=none -O acltype=posixacl -O atime=off -O relatime=off -O xattr=sa -O normalization=formD -O dnodesize=auto"sv};
+
+/// Server profile which gets a tuned dataset/subvolume for its database.
+constexpr auto kDatabaseServerProfile{"db"sv};
+
+/// Server profile which gets subvolumes for container and VM storage.
+constexpr auto kContainerHostServerProfile{"container-host"sv};
 
 /// Resolve a partition to the best stable device path for zpool creation.
 auto resolve_zfs_vdev(std::string_view device) noexcept -> std::string {
@@ -91,6 +98,24 @@ auto default_btrfs_subvolumes() noexcept -> std::vector<gucc::fs::BtrfsSubvolume
     };
 }
 
+auto server_btrfs_subvolumes(std::string_view server_profile) noexcept -> std::vector<gucc::fs::BtrfsSubvolume> {
+    using gucc::fs::BtrfsSubvolumeRole;
+
+    if (server_profile == kDatabaseServerProfile) {
+        return {
+            gucc::fs::btrfs_role_subvolume("/@postgres"s, "/var/lib/postgres"s, BtrfsSubvolumeRole::Database),
+            gucc::fs::btrfs_role_subvolume("/@mysql"s, "/var/lib/mysql"s, BtrfsSubvolumeRole::Database),
+        };
+    }
+    if (server_profile == kContainerHostServerProfile) {
+        return {
+            gucc::fs::btrfs_role_subvolume("/@containers"s, "/var/lib/containers"s, BtrfsSubvolumeRole::Containers),
+            gucc::fs::btrfs_role_subvolume("/@libvirt-images"s, "/var/lib/libvirt/images"s, BtrfsSubvolumeRole::VmImages),
+        };
+    }
+    return {};
+}
+
 auto get_available_mount_opts(std::string_view fstype) noexcept -> std::vector<std::string> {
     const auto& fs_type = gucc::fs::string_to_filesystem_type(fstype);
     const auto& fs_opts = gucc::fs::get_available_mount_opts(fs_type);
@@ -169,26 +194,33 @@ auto secure_wipe(std::string_view device) noexcept
     return {};
 }
 
-auto default_zfs_datasets(std::string_view zpool_name) noexcept
+auto default_zfs_datasets(std::string_view zpool_name, std::string_view server_profile) noexcept
     -> std::vector<gucc::fs::ZfsDataset> {
-    return {
+    using gucc::fs::ZfsDatasetRole;
+
+    std::vector<gucc::fs::ZfsDataset> datasets{
         gucc::fs::ZfsDataset{.zpath = fmt::format(FMT_COMPILE("{}/ROOT"), zpool_name), .mountpoint = "none"s},
         gucc::fs::ZfsDataset{.zpath = fmt::format(FMT_COMPILE("{}/ROOT/cos"), zpool_name), .mountpoint = "none"s},
         gucc::fs::ZfsDataset{.zpath = fmt::format(FMT_COMPILE("{}/ROOT/cos/root"), zpool_name), .mountpoint = "/"s},
         gucc::fs::ZfsDataset{.zpath = fmt::format(FMT_COMPILE("{}/ROOT/cos/home"), zpool_name), .mountpoint = "/home"s},
-        gucc::fs::ZfsDataset{.zpath = fmt::format(FMT_COMPILE("{}/ROOT/cos/varcache"), zpool_name), .mountpoint = "/var/cache"s},
-        gucc::fs::ZfsDataset{.zpath = fmt::format(FMT_COMPILE("{}/ROOT/cos/varlog"), zpool_name), .mountpoint = "/var/log"s},
+        gucc::fs::ZfsDataset{.zpath = fmt::format(FMT_COMPILE("{}/ROOT/cos/varcache"), zpool_name), .mountpoint = "/var/cache"s, .properties = gucc::fs::zfs_role_properties(ZfsDatasetRole::Cache)},
+        gucc::fs::ZfsDataset{.zpath = fmt::format(FMT_COMPILE("{}/ROOT/cos/varlog"), zpool_name), .mountpoint = "/var/log"s, .properties = gucc::fs::zfs_role_properties(ZfsDatasetRole::Logs)},
     };
+    if (server_profile == kDatabaseServerProfile) {
+        datasets.emplace_back(gucc::fs::ZfsDataset{.zpath = fmt::format(FMT_COMPILE("{}/ROOT/cos/postgres"), zpool_name), .mountpoint = "/var/lib/postgres"s, .properties = gucc::fs::zfs_role_properties(ZfsDatasetRole::Database)});
+        datasets.emplace_back(gucc::fs::ZfsDataset{.zpath = fmt::format(FMT_COMPILE("{}/ROOT/cos/mysql"), zpool_name), .mountpoint = "/var/lib/mysql"s, .properties = gucc::fs::zfs_role_properties(ZfsDatasetRole::Database)});
+    }
+    return datasets;
 }
 
 auto default_zfs_setup(std::string_view zpool_name,
-    std::optional<std::string> passphrase) noexcept
+    std::optional<std::string> passphrase, std::string_view server_profile) noexcept
     -> gucc::fs::ZfsSetupConfig {
     return gucc::fs::ZfsSetupConfig{
         .zpool_name    = std::string(zpool_name),
         .zpool_options = std::string(kDefaultZpoolOptions),
         .passphrase    = std::move(passphrase),
-        .datasets      = default_zfs_datasets(zpool_name),
+        .datasets      = default_zfs_datasets(zpool_name, server_profile),
     };
 }
 
@@ -240,8 +272,14 @@ auto apply_zfs_root(const gucc::fs::ZfsSetupConfig& zfs_setup,
     std::string_view root_device, std::string_view mountpoint) noexcept
     -> std::expected<void, std::string> {
     const auto& vdev = resolve_zfs_vdev(root_device);
-    if (!gucc::fs::zfs_create_with_config(vdev, zfs_setup)) {
-        return std::unexpected(fmt::format("failed to create zpool '{}' on {}", zfs_setup.zpool_name, vdev));
+
+    // pools remember their members by path, use stable ones
+    auto resolved_setup = zfs_setup;
+    for (auto& extra_vdev : resolved_setup.vdevs) {
+        std::ranges::transform(extra_vdev.devices, extra_vdev.devices.begin(), resolve_zfs_vdev);
+    }
+    if (auto res = gucc::fs::zfs_create_with_config(vdev, resolved_setup); !res) {
+        return std::unexpected(fmt::format("failed to create zpool '{}' on {}: {}", zfs_setup.zpool_name, vdev, gucc::to_string(res.error())));
     }
 
     // catch up exported pool before re-import
@@ -379,8 +417,8 @@ auto apply_btrfs_subvolumes(const std::vector<gucc::fs::BtrfsSubvolume>& subvols
     /* clang-format on */
 
     // Create subvolumes (mount opts are already known from the selection)
-    if (!gucc::fs::btrfs_create_subvols(subvols, selection.device, mountpoint, selection.mount_opts)) {
-        return std::unexpected("failed to create btrfs subvolumes");
+    if (auto res = gucc::fs::btrfs_create_subvols(subvols, selection.device, mountpoint, selection.mount_opts); !res) {
+        return std::unexpected(fmt::format("failed to create btrfs subvolumes: {}", gucc::to_string(res.error())));
     }
 
     if (!gucc::fs::btrfs_append_subvolumes(partitions, subvols)) {
@@ -4,16 +4,21 @@
 #include "cachyos/partition_planner.hpp"
 
 // import gucc
+#include "gucc/fs_tuning.hpp"
+#include "gucc/lvm_cache.hpp"
 #include "gucc/partition_config.hpp"
 #include "gucc/partitioning.hpp"
+#include "gucc/raid.hpp"
 #include "gucc/string_utils.hpp"
 #include "gucc/system_query.hpp"
+#include "gucc/zfs_types.hpp"
 
-#include <algorithm>    // for sort, count_if, find
+#include <algorithm>    // for sort, count_if, find, contains, replace
 #include <cstdint>      // for uint32_t
 #include <iterator>     // for back_inserter
 #include <optional>     // for optional
 #include <ranges>       // for ranges::*
+#include <span>         // for span
 #include <string_view>  // for string_view
 #include <utility>      // for move
 
@@ -25,8 +30,12 @@ using namespace std::string_view_literals;
 
 namespace {
 
+using cachyos::installer::LvmCacheSetupConfig;
 using cachyos::installer::PartitionConfig;
 using cachyos::installer::PartitionType;
+using cachyos::installer::RaidSetupConfig;
+using cachyos::installer::SubvolumeConfig;
+using cachyos::installer::ZfsVdevConfig;
 
 struct NumberedPartition final {
     std::uint32_t number{};
@@ -76,16 +85,23 @@ void validate_contiguous_numbering(const std::vector<NumberedPartition>& sorted,
 
 // NOTE: fs_name is already resolved by the parser, root inherits the global one
 // there and every other type has to carry its own
-[[nodiscard]] auto to_gucc_partition(const PartitionConfig& part,
-    const std::optional<std::string>& mount_opts, bool is_ssd) noexcept -> gucc::fs::Partition {
+[[nodiscard]] auto to_gucc_partition(const PartitionConfig& part, const std::optional<std::string>& mount_opts,
+    const gucc::fs::DeviceProfile& profile, gucc::fs::DeviceClass device_class, bool read_by_bootloader) noexcept -> gucc::fs::Partition {
     const auto fs_type = gucc::fs::string_to_filesystem_type(part.fs_name);
+    if (part.tuning) {
+        device_class = gucc::fs::string_to_device_class(*part.tuning).value_or(device_class);
+    }
+    auto tuning = gucc::fs::get_fs_tuning(fs_type, device_class, profile, read_by_bootloader);
+
+    // per-partition overrides beat the global mount_opts, which beat the tuning
     return gucc::fs::Partition{
-        .fstype     = part.fs_name,
-        .mountpoint = part.mountpoint,
-        .uuid_str   = {},
-        .device     = part.name,
-        .size       = part.size,
-        .mount_opts = mount_opts.value_or(gucc::fs::get_default_mount_opts(fs_type, is_ssd)),
+        .fstype       = part.fs_name,
+        .mountpoint   = part.mountpoint,
+        .uuid_str     = {},
+        .device       = part.name,
+        .size         = part.size,
+        .mount_opts   = part.mount_opts.value_or(mount_opts.value_or(std::move(tuning.mount_opts))),
+        .mkfs_command = part.mkfs_command.value_or(std::move(tuning.mkfs_command)),
     };
 }
 
@@ -151,6 +167,148 @@ template <std::ranges::input_range R>
         | std::ranges::to<std::vector<gucc::fs::BtrfsSubvolume>>();
 }
 
+// configured subvolumes keep their COW, compression and mount option policy
+[[nodiscard]] auto to_gucc_btrfs_subvols(const std::vector<SubvolumeConfig>& subvols, std::vector<std::string>& errors) noexcept
+    -> std::vector<gucc::fs::BtrfsSubvolume> {
+    std::vector<gucc::fs::BtrfsSubvolume> converted{};
+    converted.reserve(subvols.size());
+    for (const auto& subvol : subvols) {
+        gucc::fs::BtrfsSubvolume gucc_subvol{
+            .subvolume   = subvol.subvolume,
+            .mountpoint  = subvol.mountpoint,
+            .nocow       = subvol.nocow,
+            .compression = subvol.compression.value_or(""s),
+            .mount_opts  = subvol.mount_opts,
+        };
+        if (auto res = gucc::fs::validate_btrfs_subvolume(gucc_subvol); !res) {
+            errors.push_back(fmt::format(FMT_COMPILE("'subvolumes': {}"), res.error().context));
+        }
+        converted.push_back(std::move(gucc_subvol));
+    }
+    return converted;
+}
+
+// the install disk is repartitioned, only the root partition may join the pool
+[[nodiscard]] auto to_gucc_zfs_vdevs(const std::vector<ZfsVdevConfig>& vdevs, std::string_view device,
+    const std::vector<NumberedPartition>& numbered, std::vector<std::string>& errors) noexcept
+    -> std::vector<gucc::fs::ZfsVdev> {
+    std::vector<gucc::fs::ZfsVdev> converted{};
+    converted.reserve(vdevs.size());
+    for (const auto& vdev : vdevs) {
+        for (const auto& member : vdev.devices) {
+            if (member == device) {
+                errors.push_back(fmt::format(FMT_COMPILE("'zfs_vdevs' can't use the install device '{}' itself"), member));
+            }
+            const auto part_it = std::ranges::find(numbered, std::string_view{member},
+                [](const NumberedPartition& entry) { return std::string_view{entry.config->name}; });
+            if (part_it != std::ranges::end(numbered) && part_it->config->type != PartitionType::Root) {
+                errors.push_back(fmt::format(FMT_COMPILE("'zfs_vdevs' member '{}' is already mounted at '{}'"), member, part_it->config->mountpoint));
+            }
+        }
+        // installer_config validated the names already
+        converted.push_back(gucc::fs::ZfsVdev{
+            .vdev_class = gucc::fs::string_to_zfs_vdev_class(vdev.vdev_class).value_or(gucc::fs::ZfsVdevClass::Data),
+            .type       = gucc::fs::string_to_zfs_vdev_type(vdev.type).value_or(gucc::fs::ZfsVdevType::Stripe),
+            .devices    = vdev.devices,
+        });
+    }
+    return converted;
+}
+
+// the partition at the mountpoint becomes the cache, the filesystem moves onto the LV
+[[nodiscard]] auto to_gucc_lvm_cache(const LvmCacheSetupConfig& cache, std::string_view device,
+    const std::vector<NumberedPartition>& numbered, std::vector<std::string>& errors) noexcept
+    -> std::optional<gucc::lvm::LvmCacheConfig> {
+    const auto cached_it = std::ranges::find(numbered, std::string_view{cache.mountpoint},
+        [](const NumberedPartition& entry) { return std::string_view{entry.config->mountpoint}; });
+    if (cached_it == std::ranges::end(numbered)) {
+        errors.push_back(fmt::format(FMT_COMPILE("'lvm_cache' mountpoint '{}' has no partition"), cache.mountpoint));
+        return std::nullopt;
+    }
+    if (cached_it->config->type == PartitionType::Boot) {
+        errors.push_back(fmt::format(FMT_COMPILE("'lvm_cache' can't hold the boot partition '{}'"), cache.mountpoint));
+        return std::nullopt;
+    }
+    if (cached_it->config->fs_name == "zfs"sv) {
+        errors.emplace_back("'lvm_cache' can't hold a zfs filesystem");
+        return std::nullopt;
+    }
+
+    for (const auto& origin : cache.origin_devices) {
+        if (origin == device || std::ranges::contains(numbered, std::string_view{origin}, [](const NumberedPartition& entry) { return std::string_view{entry.config->name}; })) {
+            errors.push_back(fmt::format(FMT_COMPILE("'lvm_cache' origin device '{}' is on the install device '{}'"), origin, device));
+        }
+    }
+
+    // "/" -> root, "/var/lib/postgres" -> var_lib_postgres
+    auto lv_name = (cache.mountpoint == "/"sv) ? "root"s : cache.mountpoint.substr(1);
+    std::ranges::replace(lv_name, '/', '_');
+
+    // installer_config validated the mode already
+    return gucc::lvm::LvmCacheConfig{
+        .vg_name        = cache.vg_name,
+        .lv_name        = std::move(lv_name),
+        .origin_devices = cache.origin_devices,
+        .cache_device   = cached_it->config->name,
+        .mode           = gucc::lvm::string_to_lvm_cache_mode(cache.mode).value_or(gucc::lvm::LvmCacheMode::Writethrough),
+    };
+}
+
+// the install device first, members sysfs doesn't know get the defaults
+[[nodiscard]] auto raid_member_topologies(const gucc::disk::DiskTopology& device_topology,
+    const std::vector<std::string>& members) noexcept -> std::vector<gucc::disk::DiskTopology> {
+    std::vector<gucc::disk::DiskTopology> topologies{device_topology};
+    for (const auto& member : members) {
+        topologies.push_back(gucc::disk::query_disk_topology(member).value_or(gucc::disk::DiskTopology{}));
+    }
+    return topologies;
+}
+
+// the partition at the mountpoint is the first member, btrfs spans the devices
+// on its own, any other filesystem goes onto an md array
+[[nodiscard]] auto to_gucc_raid(const RaidSetupConfig& raid, std::string_view device,
+    const std::vector<NumberedPartition>& numbered, std::span<const gucc::disk::DiskTopology> topologies,
+    std::vector<std::string>& errors) noexcept -> std::optional<gucc::raid::RaidSetup> {
+    const auto member_it = std::ranges::find(numbered, std::string_view{raid.mountpoint},
+        [](const NumberedPartition& entry) { return std::string_view{entry.config->mountpoint}; });
+    if (member_it == std::ranges::end(numbered)) {
+        errors.push_back(fmt::format(FMT_COMPILE("'raid' mountpoint '{}' has no partition"), raid.mountpoint));
+        return std::nullopt;
+    }
+    if (member_it->config->type == PartitionType::Boot) {
+        errors.push_back(fmt::format(FMT_COMPILE("'raid' can't hold the boot partition '{}'"), raid.mountpoint));
+        return std::nullopt;
+    }
+    if (member_it->config->fs_name == "zfs"sv) {
+        errors.emplace_back("'raid' can't hold a zfs filesystem, use 'zfs_vdevs'");
+        return std::nullopt;
+    }
+
+    for (const auto& member : raid.devices) {
+        if (member == device || std::ranges::contains(numbered, std::string_view{member}, [](const NumberedPartition& entry) { return std::string_view{entry.config->name}; })) {
+            errors.push_back(fmt::format(FMT_COMPILE("'raid' member '{}' is on the install device '{}'"), member, device));
+        }
+    }
+
+    // installer_config validated the level names already
+    const bool is_btrfs = member_it->config->fs_name == "btrfs"sv;
+    gucc::raid::RaidSetup setup{
+        .backend        = is_btrfs ? gucc::raid::RaidBackend::Btrfs : gucc::raid::RaidBackend::Mdadm,
+        .level          = gucc::raid::string_to_raid_level(raid.level).value_or(gucc::raid::RaidLevel::Raid1),
+        .metadata_level = gucc::raid::string_to_raid_level(raid.metadata).value_or(gucc::raid::RaidLevel::Raid1),
+        .name           = raid.name,
+        .devices        = {member_it->config->name},
+    };
+    setup.devices.insert(setup.devices.end(), raid.devices.begin(), raid.devices.end());
+    if (!is_btrfs) {
+        setup.chunk_size = gucc::raid::md_chunk_size_for(setup.level, topologies);
+    }
+    if (auto res = gucc::raid::validate_raid_setup(setup); !res) {
+        errors.push_back(fmt::format(FMT_COMPILE("'raid': {}"), res.error().context));
+    }
+    return setup;
+}
+
 }  // namespace
 
 namespace cachyos::installer {
@@ -180,10 +338,22 @@ auto headless_strategy_from_config(const InstallerConfig& cfg, bool is_efi) noex
     validate_contiguous_numbering(numbered, errors);
     validate_layout(numbered, is_efi, errors);
 
-    const auto is_ssd    = gucc::disk::is_device_ssd(device);
+    // without a profile of the device stick to the plain defaults
+    auto device_profile     = device.empty() ? std::nullopt : gucc::fs::query_device_profile(device);
+    const auto device_class = device_profile ? gucc::fs::classify_device(*device_profile) : gucc::fs::DeviceClass::Generic;
+    if (!device_profile) {
+        device_profile = gucc::fs::DeviceProfile{.is_rotational = !gucc::disk::is_device_ssd(device)};
+    }
+
+    // GRUB reads kernels from /boot, which lives on root unless it has its own partition
+    const bool has_boot_mount = std::ranges::contains(numbered, "/boot"sv,
+        [](const NumberedPartition& entry) { return std::string_view{entry.config->mountpoint}; });
+    const auto is_read_by_bootloader = [has_boot_mount](std::string_view mountpoint) {
+        return mountpoint == "/boot"sv || (mountpoint == "/"sv && !has_boot_mount);
+    };
     auto converted_parts = numbered
-        | std::ranges::views::transform([&cfg, is_ssd](const NumberedPartition& entry) {
-              return to_gucc_partition(*entry.config, cfg.mount_opts, is_ssd);
+        | std::ranges::views::transform([&cfg, &device_profile, device_class, &is_read_by_bootloader](const NumberedPartition& entry) {
+              return to_gucc_partition(*entry.config, cfg.mount_opts, *device_profile, device_class, is_read_by_bootloader(entry.config->mountpoint));
           })
         | std::ranges::to<std::vector<gucc::fs::Partition>>();
 
@@ -199,18 +369,62 @@ auto headless_strategy_from_config(const InstallerConfig& cfg, bool is_efi) noex
         if (!root_is_btrfs) {
             errors.push_back(fmt::format(FMT_COMPILE("'subvolumes' requires a btrfs root filesystem, but root is '{}'"), root_fs_name));
         } else {
-            btrfs_subvolumes = conv_to_btrfs_subvols(cfg.subvolumes);
+            btrfs_subvolumes = to_gucc_btrfs_subvols(cfg.subvolumes, errors);
         }
     } else if (root_is_btrfs && cfg.use_default_subvolumes) {
         btrfs_subvolumes = conv_to_btrfs_subvols(partition_planner::default_btrfs_layout());
     }
+    // server presets, unless the config mounts something there already. They are
+    // subvolumes next to the root one, so without a root subvolume there is nothing to mount
+    if (root_is_btrfs && cfg.server_profile) {
+        auto presets = server_btrfs_subvolumes(*cfg.server_profile);
+        if (!presets.empty() && !std::ranges::contains(btrfs_subvolumes, "/"sv, &gucc::fs::BtrfsSubvolume::mountpoint)) {
+            errors.push_back(fmt::format(FMT_COMPILE("server profile '{}' needs a btrfs subvolume mounted at '/'"), *cfg.server_profile));
+        }
+        for (auto&& preset : presets) {
+            if (!std::ranges::contains(btrfs_subvolumes, preset.mountpoint, &gucc::fs::BtrfsSubvolume::mountpoint)) {
+                btrfs_subvolumes.push_back(std::move(preset));
+            }
+        }
+    }
 
     // zfs special handling
     std::optional<gucc::fs::ZfsSetupConfig> zfs_setup{};
     if (root_is_zfs) {
-        zfs_setup = default_zfs_setup(kDefaultZpoolName, cfg.zfs_passphrase);
-    } else if (cfg.zfs_passphrase) {
-        errors.push_back(fmt::format(FMT_COMPILE("'zfs_passphrase' requires a zfs root filesystem, but root is '{}'"), root_fs_name));
+        zfs_setup        = default_zfs_setup(kDefaultZpoolName, cfg.zfs_passphrase, cfg.server_profile.value_or(""s));
+        zfs_setup->vdevs = to_gucc_zfs_vdevs(cfg.zfs_vdevs, device, numbered, errors);
+    } else {
+        if (cfg.zfs_passphrase) {
+            errors.push_back(fmt::format(FMT_COMPILE("'zfs_passphrase' requires a zfs root filesystem, but root is '{}'"), root_fs_name));
+        }
+        if (!cfg.zfs_vdevs.empty()) {
+            errors.push_back(fmt::format(FMT_COMPILE("'zfs_vdevs' requires a zfs root filesystem, but root is '{}'"), root_fs_name));
+        }
+    }
+
+    // tiered storage
+    std::optional<gucc::lvm::LvmCacheConfig> lvm_cache{};
+    if (cfg.lvm_cache) {
+        lvm_cache = to_gucc_lvm_cache(*cfg.lvm_cache, device, numbered, errors);
+    }
+
+    // multi-device filesystem
+    std::optional<gucc::raid::RaidSetup> raid{};
+    if (cfg.raid) {
+        const auto& topologies = raid_member_topologies(device_profile->topology, cfg.raid->devices);
+        raid                   = to_gucc_raid(*cfg.raid, device, numbered, topologies, errors);
+
+        // mkfs sees the stripes of the array, not the ones of the install device
+        if (raid && raid->backend == gucc::raid::RaidBackend::Mdadm) {
+            const auto entry_it = std::ranges::find(numbered, std::string_view{raid->devices.front()},
+                [](const NumberedPartition& entry) { return std::string_view{entry.config->name}; });
+            const auto part_it  = std::ranges::find(converted_parts, raid->devices.front(), &gucc::fs::Partition::device);
+            if (entry_it != std::ranges::end(numbered) && part_it != std::ranges::end(converted_parts)) {
+                auto md_profile     = *device_profile;
+                md_profile.topology = gucc::raid::md_array_topology(*raid, topologies);
+                *part_it            = to_gucc_partition(*entry_it->config, cfg.mount_opts, md_profile, device_class, is_read_by_bootloader(entry_it->config->mountpoint));
+            }
+        }
     }
 
     // only errors block the install
@@ -226,6 +440,8 @@ auto headless_strategy_from_config(const InstallerConfig& cfg, bool is_efi) noex
         .partitions       = std::move(converted_parts),
         .btrfs_subvolumes = std::move(btrfs_subvolumes),
         .zfs_setup        = std::move(zfs_setup),
+        .lvm_cache        = std::move(lvm_cache),
+        .raid             = std::move(raid),
     }};
 }
 
@@ -1,17 +1,23 @@
 #include "cachyos/installer_config.hpp"
 
 #include "cachyos/headless_plan.hpp"
+#include "cachyos/offline_bundle.hpp"
 #include "cachyos/packages.hpp"
 #include "cachyos/system.hpp"
 
 // import gucc
 #include "gucc/bootloader.hpp"
+#include "gucc/fs_tuning.hpp"
+#include "gucc/lvm_cache.hpp"
+#include "gucc/raid.hpp"
+#include "gucc/zfs_types.hpp"
 
 #include <cstdint>  // for uint16_t
 
-#include <algorithm>         // for contains
+#include <algorithm>         // for contains, find
 #include <array>             // for array
 #include <expected>          // for expected, unexpected
+#include <filesystem>        // for absolute
 #include <initializer_list>  // for initializer_list
 #include <optional>          // for optional
 #include <ranges>            // for ranges::*
@@ -57,12 +63,19 @@ constexpr std::array kKnownKeys{
     "allow_auto_partition"sv,
     "encrypt_swap"sv,
     "hostcache"sv,
+    "alpm_backend"sv,
+    "target_cache"sv,
+    "prune_cache"sv,
+    "offline_bundle"sv,
     "device"sv,
     "fs_name"sv,
     "mount_opts"sv,
     "partitions"sv,
     "subvolumes"sv,
     "zfs_passphrase"sv,
+    "zfs_vdevs"sv,
+    "lvm_cache"sv,
+    "raid"sv,
     "hostname"sv,
     "locale"sv,
     "xkbmap"sv,
@@ -284,6 +297,9 @@ auto parse_installer_config(std::string_view json_content) noexcept
              {"allow_auto_partition", &config.allow_auto_partition},
              {"encrypt_swap", &config.encrypt_swap},
              {"hostcache", &config.hostcache},
+             {"alpm_backend", &config.alpm_backend},
+             {"target_cache", &config.target_cache},
+             {"prune_cache", &config.prune_cache},
              {"autologin", &config.autologin},
              {"chwd", &config.chwd},
              {"carry_network", &config.carry_network},
@@ -312,6 +328,7 @@ auto parse_installer_config(std::string_view json_content) noexcept
              {"bootloader", &config.bootloader},
              {"server_profile", &config.server_profile},
              {"net_profiles_path", &config.net_profiles_path},
+             {"offline_bundle", &config.offline_bundle},
              {"post_install", &config.post_install},
              {"hw_clock", &config.hw_clock},
          }) {
@@ -430,6 +447,20 @@ auto parse_installer_config(std::string_view json_content) noexcept
                 return std::unexpected("'fs_name' is required for root partition when global fs_name is not set");
             }
 
+            // per-partition tuning overrides
+            for (const auto& [key, out] : std::initializer_list<std::pair<const char*, std::optional<std::string>*>>{
+                     {"tuning", &part_config.tuning},
+                     {"mkfs_command", &part_config.mkfs_command},
+                     {"mount_opts", &part_config.mount_opts},
+                 }) {
+                if (auto err = parse_optional_string(part_obj, key, *out)) {
+                    return std::unexpected(fmt::format(FMT_COMPILE("Partition {}"), *err));
+                }
+            }
+            if (part_config.tuning && !gucc::fs::string_to_device_class(*part_config.tuning)) {
+                return std::unexpected(fmt::format(FMT_COMPILE("Partition 'tuning' must be one of nvme, ssd, hdd, removable, virtual, generic, got '{}'"), *part_config.tuning));
+            }
+
             config.partitions.push_back(std::move(part_config));
         }
     }
@@ -461,6 +492,17 @@ auto parse_installer_config(std::string_view json_content) noexcept
                     .subvolume  = subvol_obj["subvolume"].GetString(),
                     .mountpoint = subvol_obj["mountpoint"].GetString(),
                 };
+                if (auto err = parse_optional_bool(subvol_obj, "nocow", subvol_config.nocow)) {
+                    return std::unexpected(fmt::format(FMT_COMPILE("Subvolume {}"), *err));
+                }
+                for (const auto& [key, out] : std::initializer_list<std::pair<const char*, std::optional<std::string>*>>{
+                         {"compression", &subvol_config.compression},
+                         {"mount_opts", &subvol_config.mount_opts},
+                     }) {
+                    if (auto err = parse_optional_string(subvol_obj, key, *out)) {
+                        return std::unexpected(fmt::format(FMT_COMPILE("Subvolume {}"), *err));
+                    }
+                }
                 config.subvolumes.push_back(std::move(subvol_config));
             }
         } else {
@@ -468,6 +510,163 @@ auto parse_installer_config(std::string_view json_content) noexcept
         }
     }
 
+    // Parse zfs vdevs (optional)
+    if (doc.HasMember("zfs_vdevs")) {
+        if (!doc["zfs_vdevs"].IsArray()) {
+            return std::unexpected("'zfs_vdevs' must be an array");
+        }
+
+        for (const auto& vdev_value : doc["zfs_vdevs"].GetArray()) {
+            if (!vdev_value.IsObject()) {
+                return std::unexpected("Each zfs vdev must be an object");
+            }
+
+            const auto& vdev_obj = vdev_value.GetObject();
+            ZfsVdevConfig vdev_config{};
+            if (auto err = parse_optional_string_array(vdev_obj, "devices", vdev_config.devices)) {
+                return std::unexpected(fmt::format(FMT_COMPILE("zfs vdev {}"), *err));
+            }
+            if (vdev_config.devices.empty()) {
+                return std::unexpected("zfs vdev 'devices' is required and must not be empty");
+            }
+
+            std::optional<std::string> type{};
+            std::optional<std::string> vdev_class{};
+            for (const auto& [key, out] : std::initializer_list<std::pair<const char*, std::optional<std::string>*>>{
+                     {"type", &type},
+                     {"class", &vdev_class},
+                 }) {
+                if (auto err = parse_optional_string(vdev_obj, key, *out)) {
+                    return std::unexpected(fmt::format(FMT_COMPILE("zfs vdev {}"), *err));
+                }
+            }
+            if (type) {
+                if (!gucc::fs::string_to_zfs_vdev_type(*type)) {
+                    return std::unexpected(fmt::format(FMT_COMPILE("zfs vdev 'type' must be one of stripe, mirror, raidz1, raidz2, raidz3, got '{}'"), *type));
+                }
+                vdev_config.type = std::move(*type);
+            }
+            if (vdev_class) {
+                if (!gucc::fs::string_to_zfs_vdev_class(*vdev_class)) {
+                    return std::unexpected(fmt::format(FMT_COMPILE("zfs vdev 'class' must be one of data, special, log, cache, got '{}'"), *vdev_class));
+                }
+                vdev_config.vdev_class = std::move(*vdev_class);
+            }
+
+            config.zfs_vdevs.push_back(std::move(vdev_config));
+        }
+    }
+
+    // Parse lvm cache (optional)
+    if (doc.HasMember("lvm_cache")) {
+        if (!doc["lvm_cache"].IsObject()) {
+            return std::unexpected("'lvm_cache' must be an object");
+        }
+
+        const auto& cache_obj = doc["lvm_cache"].GetObject();
+        if (!cache_obj.HasMember("mountpoint") || !cache_obj["mountpoint"].IsString()) {
+            return std::unexpected("lvm cache 'mountpoint' is required and must be a string");
+        }
+        LvmCacheSetupConfig cache_config{.mountpoint = cache_obj["mountpoint"].GetString()};
+        if (auto err = parse_optional_string_array(cache_obj, "origin_devices", cache_config.origin_devices)) {
+            return std::unexpected(fmt::format(FMT_COMPILE("lvm cache {}"), *err));
+        }
+        if (cache_config.origin_devices.empty()) {
+            return std::unexpected("lvm cache 'origin_devices' is required and must not be empty");
+        }
+
+        std::optional<std::string> mode{};
+        std::optional<std::string> vg_name{};
+        for (const auto& [key, out] : std::initializer_list<std::pair<const char*, std::optional<std::string>*>>{
+                 {"mode", &mode},
+                 {"vg_name", &vg_name},
+             }) {
+            if (auto err = parse_optional_string(cache_obj, key, *out)) {
+                return std::unexpected(fmt::format(FMT_COMPILE("lvm cache {}"), *err));
+            }
+        }
+        if (mode) {
+            if (!gucc::lvm::string_to_lvm_cache_mode(*mode)) {
+                return std::unexpected(fmt::format(FMT_COMPILE("lvm cache 'mode' must be one of writethrough, writeback, writecache, got '{}'"), *mode));
+            }
+            cache_config.mode = std::move(*mode);
+        }
+        if (vg_name) {
+            cache_config.vg_name = std::move(*vg_name);
+        }
+
+        // the partition at the mountpoint turns into the cache
+        const auto cached_it = std::ranges::find(config.partitions, cache_config.mountpoint, &PartitionConfig::mountpoint);
+        if (cached_it == config.partitions.end()) {
+            return std::unexpected(fmt::format(FMT_COMPILE("lvm cache 'mountpoint' '{}' has no partition"), cache_config.mountpoint));
+        }
+        if (cached_it->fs_name == "zfs"sv) {
+            return std::unexpected("lvm cache can't hold a zfs filesystem");
+        }
+        config.lvm_cache = std::move(cache_config);
+    }
+
+    // Parse raid (optional)
+    if (doc.HasMember("raid")) {
+        if (!doc["raid"].IsObject()) {
+            return std::unexpected("'raid' must be an object");
+        }
+
+        const auto& raid_obj = doc["raid"].GetObject();
+        if (!raid_obj.HasMember("level") || !raid_obj["level"].IsString()) {
+            return std::unexpected("raid 'level' is required and must be a string");
+        }
+        RaidSetupConfig raid_config{.level = raid_obj["level"].GetString()};
+        const auto level = gucc::raid::string_to_raid_level(raid_config.level);
+        if (!level) {
+            return std::unexpected(fmt::format(FMT_COMPILE("raid 'level' must be one of raid0, raid1, raid10, got '{}'"), raid_config.level));
+        }
+        if (auto err = parse_optional_string_array(raid_obj, "devices", raid_config.devices)) {
+            return std::unexpected(fmt::format(FMT_COMPILE("raid {}"), *err));
+        }
+        // the partition on the install device is a member too
+        if (raid_config.devices.size() + 1 < gucc::raid::raid_min_devices(*level)) {
+            return std::unexpected(fmt::format(FMT_COMPILE("raid {} needs at least {} 'devices' besides the install device"), raid_config.level, gucc::raid::raid_min_devices(*level) - 1));
+        }
+
+        std::optional<std::string> mountpoint{};
+        std::optional<std::string> metadata{};
+        std::optional<std::string> name{};
+        for (const auto& [key, out] : std::initializer_list<std::pair<const char*, std::optional<std::string>*>>{
+                 {"mountpoint", &mountpoint},
+                 {"metadata", &metadata},
+                 {"name", &name},
+             }) {
+            if (auto err = parse_optional_string(raid_obj, key, *out)) {
+                return std::unexpected(fmt::format(FMT_COMPILE("raid {}"), *err));
+            }
+        }
+        if (mountpoint) {
+            raid_config.mountpoint = std::move(*mountpoint);
+        }
+        if (metadata) {
+            if (!gucc::raid::string_to_raid_level(*metadata)) {
+                return std::unexpected(fmt::format(FMT_COMPILE("raid 'metadata' must be one of raid0, raid1, raid10, got '{}'"), *metadata));
+            }
+            raid_config.metadata = std::move(*metadata);
+        }
+        if (name) {
+            raid_config.name = std::move(*name);
+        }
+
+        const auto raid_it = std::ranges::find(config.partitions, raid_config.mountpoint, &PartitionConfig::mountpoint);
+        if (raid_it == config.partitions.end()) {
+            return std::unexpected(fmt::format(FMT_COMPILE("raid 'mountpoint' '{}' has no partition"), raid_config.mountpoint));
+        }
+        if (raid_it->fs_name == "zfs"sv) {
+            return std::unexpected("raid can't hold a zfs filesystem, use 'zfs_vdevs'");
+        }
+        if (config.lvm_cache && config.lvm_cache->mountpoint == raid_config.mountpoint) {
+            return std::unexpected(fmt::format(FMT_COMPILE("'{}' can't be both cached and a raid"), raid_config.mountpoint));
+        }
+        config.raid = std::move(raid_config);
+    }
+
     // zfs handling
     const auto root_fs = [&config]() -> std::string_view {
         for (const auto& part : config.partitions) {
@@ -481,6 +680,9 @@ auto parse_installer_config(std::string_view json_content) noexcept
     if (config.zfs_passphrase && !root_is_zfs) {
         return std::unexpected(fmt::format(FMT_COMPILE("'zfs_passphrase' requires a zfs root filesystem, but root is '{}'"), root_fs));
     }
+    if (!config.zfs_vdevs.empty() && !root_is_zfs) {
+        return std::unexpected(fmt::format(FMT_COMPILE("'zfs_vdevs' requires a zfs root filesystem, but root is '{}'"), root_fs));
+    }
     if (!config.subvolumes.empty() && root_is_zfs) {
         return std::unexpected("'subvolumes' apply to a btrfs root only");
     }
@@ -573,6 +775,9 @@ auto installer_config_to_inputs(const InstallerConfig& cfg) noexcept
     inputs.ctx.bootloader      = bootloader_from_name(cfg.bootloader);
     inputs.ctx.encrypt_swap    = cfg.encrypt_swap;
     inputs.ctx.hostcache       = cfg.hostcache;
+    inputs.ctx.alpm_backend    = cfg.alpm_backend;
+    inputs.ctx.target_cache    = cfg.target_cache;
+    inputs.ctx.prune_cache     = cfg.prune_cache;
 
     // server related mapings
     inputs.ctx.server_profile         = cfg.server_profile.value_or("");
@@ -583,6 +788,11 @@ auto installer_config_to_inputs(const InstallerConfig& cfg) noexcept
     if (cfg.net_profiles_path) {
         inputs.ctx.net_profiles_user_path = *cfg.net_profiles_path;
     }
+    if (cfg.offline_bundle) {
+        std::error_code ec;
+        inputs.ctx.offline_bundle = std::filesystem::absolute(*cfg.offline_bundle, ec).string();
+        cachyos::installer::use_bundle_profiles(inputs.ctx);
+    }
 
     // fetch and set server profile
     if (auto res = cachyos::installer::init_server_profile(inputs.ctx); !res) {
@@ -591,6 +801,11 @@ auto installer_config_to_inputs(const InstallerConfig& cfg) noexcept
 
     // opts
     inputs.ctx.install_chwd_profiles = cfg.chwd;
+    if (cfg.chwd && cfg.offline_bundle) {
+        // chwd picks its packages on the machine it runs, the bundle can't know them
+        spdlog::warn("'chwd' is ignored with 'offline_bundle'");
+        inputs.ctx.install_chwd_profiles = false;
+    }
     inputs.ctx.carry_live_network    = cfg.carry_network;
     inputs.ctx.disable_os_prober     = !cfg.os_prober;
     inputs.ctx.netinstall_groups     = cfg.netinstall_groups;
@@ -0,0 +1,183 @@
+#include "cachyos/offline_bundle.hpp"
+#include "cachyos/bootloader.hpp"
+#include "cachyos/packages.hpp"
+
+// import gucc
+#include "gucc/error.hpp"
+#include "gucc/fetch_file.hpp"
+#include "gucc/file_utils.hpp"
+#include "gucc/offline_bundle.hpp"
+#include "gucc/package_list.hpp"
+
+#include <algorithm>    // for ranges::sort, ranges::unique
+#include <expected>     // for unexpected
+#include <filesystem>   // for absolute, create_directories, exists
+#include <string>       // for string
+#include <string_view>  // for string_view
+#include <utility>      // for move
+#include <vector>       // for vector
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+using namespace std::string_view_literals;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using cachyos::installer::InstallContext;
+using cachyos::installer::InstallerConfig;
+
+auto profiles_dir_of(std::string_view bundle_dir) noexcept -> std::string {
+    return fmt::format(FMT_COMPILE("{}/{}"), bundle_dir, gucc::bundle::kProfilesDir);
+}
+
+// The profiles the installer would fetch right now, so the bundle and its package set agree.
+auto snapshot_profiles(const InstallerConfig& cfg, std::string_view profiles_dir) noexcept
+    -> std::expected<void, std::string> {
+    std::error_code ec;
+    fs::create_directories(profiles_dir, ec);
+    if (ec) {
+        return std::unexpected(fmt::format(FMT_COMPILE("failed to create '{}': {}"), profiles_dir, ec.message()));
+    }
+
+    const InstallContext defaults{};
+    const auto snapshot = [&](std::string_view url, std::string_view fallback_url, std::string_view name) -> bool {
+        const auto fetched = gucc::fetch::fetch_file_hedged(url, fallback_url, {.hedge_delay = defaults.profiles_hedge_delay});
+        if (!fetched) {
+            return false;
+        }
+        spdlog::info("bundle: {} from '{}'", name, fetched->url);
+        return gucc::file_utils::create_file_for_overwrite(fmt::format(FMT_COMPILE("{}/{}"), profiles_dir, name), fetched->content);
+    };
+
+    if (!snapshot(defaults.net_profiles_url, defaults.net_profiles_fallback_url, cachyos::installer::kBundleNetProfiles)) {
+        return std::unexpected("could not fetch net profiles");
+    }
+    // only a server install needs them, a desktop bundle still carries them when they're reachable
+    if (!snapshot(defaults.server_profiles_url, defaults.server_profiles_fallback_url, cachyos::installer::kBundleServerProfiles)
+        && cfg.server_profile) {
+        return std::unexpected("could not fetch server profiles");
+    }
+    if (cfg.net_profiles_path) {
+        const auto& user_content = gucc::fetch::fetch_file(*cfg.net_profiles_path);
+        const auto& user_path    = fmt::format(FMT_COMPILE("{}/{}"), profiles_dir, cachyos::installer::kBundleNetProfilesUser);
+        if (!user_content || !gucc::file_utils::create_file_for_overwrite(user_path, *user_content)) {
+            return std::unexpected(fmt::format(FMT_COMPILE("could not snapshot '{}'"), *cfg.net_profiles_path));
+        }
+    }
+    return {};
+}
+
+// The lists of the install paths, of both modes, the machine the bundle boots on isn't known.
+auto bundle_bootloader_packages(const InstallContext& ctx) noexcept -> std::vector<std::string> {
+    std::vector<std::string> packages{};
+    for (const auto mode : {InstallContext::SystemMode::UEFI, InstallContext::SystemMode::BIOS}) {
+        const auto& lists = cachyos::installer::bootloader_packages(ctx.bootloader, mode, ctx.filesystem_name);
+        for (const auto* list : {&lists.host, &lists.target, &lists.extras}) {
+            packages.insert(packages.cend(), list->cbegin(), list->cend());
+        }
+    }
+    return packages;
+}
+
+}  // namespace
+
+namespace cachyos::installer {
+
+void use_bundle_profiles(InstallContext& ctx) noexcept {
+    const auto& profiles_dir = profiles_dir_of(ctx.offline_bundle);
+
+    ctx.net_profiles_url             = fmt::format(FMT_COMPILE("file://{}/{}"), profiles_dir, kBundleNetProfiles);
+    ctx.net_profiles_fallback_url    = ctx.net_profiles_url;
+    ctx.server_profiles_url          = fmt::format(FMT_COMPILE("file://{}/{}"), profiles_dir, kBundleServerProfiles);
+    ctx.server_profiles_fallback_url = ctx.server_profiles_url;
+
+    // the user layer the bundle was built with, not whatever the path holds now
+    const auto& user_path = fmt::format(FMT_COMPILE("{}/{}"), profiles_dir, kBundleNetProfilesUser);
+    if (std::error_code ec; fs::exists(user_path, ec)) {
+        ctx.net_profiles_user_path = fmt::format(FMT_COMPILE("file://{}"), user_path);
+    }
+}
+
+auto bundle_packages(const InstallerConfig& cfg, const InstallerInputs& inputs) noexcept
+    -> std::expected<std::vector<std::string>, std::string> {
+    const auto& ctx = inputs.ctx;
+
+    const gucc::package::NetProfileInfo net_profs_info{
+        .net_profs_url          = ctx.net_profiles_url,
+        .net_profs_fallback_url = ctx.net_profiles_fallback_url,
+        .net_profs_user_path    = ctx.net_profiles_user_path,
+        .fetch_options          = {.hedge_delay = ctx.profiles_hedge_delay},
+    };
+    auto packages = gucc::package::get_pkglist_base(ctx.kernel, ctx.filesystem_name, ctx.server_mode, net_profs_info);
+    if (!packages) {
+        return std::unexpected("failed to get base package list");
+    }
+    packages->insert(packages->cend(), {"amd-ucode", "intel-ucode"});
+    if (cfg.lvm_cache) {
+        packages->insert(packages->cend(), {"lvm2", "thin-provisioning-tools"});
+    }
+    if (cfg.raid && ctx.filesystem_name != "btrfs"sv) {
+        packages->emplace_back("mdadm");
+    }
+
+    if (ctx.resolved_server) {
+        packages->insert(packages->cend(), ctx.resolved_server->packages.cbegin(), ctx.resolved_server->packages.cend());
+    } else if (!ctx.desktop.empty()) {
+        const auto& desktop_packages = gucc::package::get_pkglist_desktop(ctx.desktop, net_profs_info);
+        if (!desktop_packages) {
+            return std::unexpected(fmt::format(FMT_COMPILE("failed to get the package list of desktop '{}'"), ctx.desktop));
+        }
+        packages->insert(packages->cend(), desktop_packages->cbegin(), desktop_packages->cend());
+    }
+    const auto& extra = resolve_netinstall_packages(ctx);
+    packages->insert(packages->cend(), extra.cbegin(), extra.cend());
+
+    const auto& bootloader = bundle_bootloader_packages(ctx);
+    packages->insert(packages->cend(), bootloader.cbegin(), bootloader.cend());
+
+    const auto& shell = inputs.user.shell;
+    if (shell.ends_with("zsh"sv) || shell.ends_with("fish"sv)) {
+        packages->emplace_back(fmt::format(FMT_COMPILE("cachyos-{}-config"), shell.ends_with("zsh"sv) ? "zsh"sv : "fish"sv));
+    }
+
+    std::ranges::sort(*packages);
+    const auto [first, last] = std::ranges::unique(*packages);
+    packages->erase(first, last);
+    return std::move(*packages);
+}
+
+auto build_offline_bundle(const InstallerConfig& cfg) noexcept
+    -> std::expected<void, std::string> {
+    if (!cfg.offline_bundle) {
+        return std::unexpected("'offline_bundle' names no directory to build into");
+    }
+    std::error_code ec;
+    const auto& bundle_dir = fs::absolute(*cfg.offline_bundle, ec).string();
+
+    if (auto res = snapshot_profiles(cfg, profiles_dir_of(bundle_dir)); !res) {
+        return std::unexpected(std::move(res).error());
+    }
+    // resolved against the snapshots, exactly as the offline install will
+    auto inputs = installer_config_to_inputs(cfg);
+    if (!inputs) {
+        return std::unexpected(std::move(inputs).error());
+    }
+    const auto& packages = bundle_packages(cfg, *inputs);
+    if (!packages) {
+        return std::unexpected(packages.error());
+    }
+
+    const auto& built = gucc::bundle::build(bundle_dir, *packages);
+    if (!built) {
+        return std::unexpected(fmt::format(FMT_COMPILE("failed to build the bundle: {}"), gucc::to_string(built.error())));
+    }
+    spdlog::info("bundle '{}' is ready: {} packages, {:.1f}MiB installed", bundle_dir, built->packages,
+        static_cast<double>(built->install_size) / (1024.0 * 1024.0));
+    return {};
+}
+
+}  // namespace cachyos::installer
@@ -3,6 +3,7 @@
 #include "cachyos/steps.hpp"
 
 // import gucc
+#include "gucc/alpm_transaction.hpp"
 #include "gucc/logger.hpp"
 #include "gucc/string_utils.hpp"
 
@@ -29,7 +30,10 @@ using namespace cachyos::installer;
 class SinkClearGuard {
  public:
     explicit SinkClearGuard(gucc::utils::ProcessRunner& runner) noexcept : m_runner(runner) { }
-    ~SinkClearGuard() { m_runner.set_line_sink(nullptr); }
+    ~SinkClearGuard() {
+        m_runner.set_line_sink(nullptr);
+        gucc::alpm::set_event_sink(nullptr);
+    }
 
     SinkClearGuard(const SinkClearGuard&)                    = delete;
     SinkClearGuard(SinkClearGuard&&)                         = delete;
@@ -210,6 +214,24 @@ auto run(InstallContext& ctx,
             .fraction = base + (*frac / total),
         });
     });
+    // same for the libalpm backend: downloads fill the first half of the step, installs the second
+    gucc::alpm::set_event_sink([&session, &current_step, &current_msg](const gucc::alpm::TransactionEvent& event) {
+        if (!session.on_progress) {
+            return;
+        }
+        using enum gucc::alpm::EventKind;
+        const double done  = (event.total > 0) ? static_cast<double>(event.done) / static_cast<double>(event.total) : 0.0;
+        const double frac  = (event.kind == Download) ? done * 0.5 : (event.kind == Install) ? 0.5 + (done * 0.5) : 1.0;
+        const auto message = (event.kind == Hook) ? fmt::format("{} ({})", current_msg, event.name) : current_msg;
+
+        constexpr auto total = static_cast<double>(kTotalSteps);
+        const double base    = static_cast<double>(step_index(current_step)) / total;
+        session.on_progress(ProgressEvent{
+            .type     = ProgressEventType::Running,
+            .message  = message,
+            .fraction = base + (frac / total),
+        });
+    });
     const SinkClearGuard sink_guard{session.runner};
 
     const auto begin_step = [&session, &current_step, &current_msg](Step step_obj) {
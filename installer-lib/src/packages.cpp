@@ -9,19 +9,23 @@
 #include "gucc/initcpio.hpp"
 #include "gucc/install.hpp"
 #include "gucc/io_utils.hpp"
+#include "gucc/local_db.hpp"
+#include "gucc/package_download.hpp"
 #include "gucc/package_list.hpp"
 #include "gucc/package_profiles.hpp"
 #include "gucc/plymouth.hpp"
 #include "gucc/server_profiles.hpp"
 #include "gucc/string_utils.hpp"
+#include "gucc/sync_db.hpp"
 #include "gucc/systemd_services.hpp"
 
-#include <algorithm>    // for ranges::find
 #include <expected>     // for unexpected
 #include <filesystem>   // for exists
 #include <fstream>      // for ofstream
+#include <optional>     // for optional
 #include <string>       // for string
 #include <string_view>  // for string_view
+#include <utility>      // for move
 #include <vector>       // for vector
 
 #include <fmt/compile.h>
@@ -80,14 +84,61 @@ auto make_net_profs_info(const InstallContext& ctx) noexcept -> gucc::package::N
         .net_profs_url          = ctx.net_profiles_url,
         .net_profs_fallback_url = ctx.net_profiles_fallback_url,
         .net_profs_user_path    = ctx.net_profiles_user_path,
+        .fetch_options          = {.hedge_delay = ctx.profiles_hedge_delay},
     };
 }
 
-void collect_group_packages(const gucc::profile::NetinstallGroup& group, std::vector<std::string>& out) noexcept {
-    out.insert(out.cend(), group.packages.cbegin(), group.packages.cend());
-    for (const auto& sub : group.subgroups) {
-        collect_group_packages(sub, out);
+auto package_backend(const InstallContext& ctx) noexcept -> gucc::install::PackageBackend {
+    return ctx.alpm_backend ? gucc::install::PackageBackend::Alpm : gucc::install::PackageBackend::Pacstrap;
+}
+
+// Loaded once per run, every package list of the install is checked against it.
+auto host_sync_db() noexcept -> const gucc::syncdb::SyncDatabase* {
+    static const auto db = []() -> std::optional<gucc::syncdb::SyncDatabase> {
+        const auto& repos = gucc::syncdb::repos_of_pacman_conf("/etc/pacman.conf"sv);
+        auto loaded       = gucc::syncdb::SyncDatabase::load("/var/lib/pacman/sync"sv, repos);
+        if (!loaded) {
+            spdlog::debug("skipping package preflight: {}", gucc::to_string(loaded.error()));
+            return std::nullopt;
+        }
+        return std::move(*loaded);
+    }();
+    return db ? &*db : nullptr;
+}
+
+// Reports what pacstrap would fail on before it starts downloading. Only warns,
+// the host dbs can be older than what pacstrap syncs.
+// Returns the files of the resolved packages, what install_base prefetches.
+auto preflight_packages(const std::vector<std::string>& packages) noexcept -> std::vector<gucc::download::PackageFile> {
+    const auto* db = host_sync_db();
+    if (db == nullptr || packages.empty()) {
+        return {};
     }
+    const auto& resolution = db->resolve(packages);
+    for (const auto& missing : resolution.missing) {
+        if (missing.required_by.empty()) {
+            spdlog::warn("preflight: target not found in the host sync dbs: {}", missing.dependency);
+        } else {
+            spdlog::warn("preflight: unable to satisfy '{}' required by {}", missing.dependency, missing.required_by);
+        }
+    }
+    for (const auto& conflict : resolution.conflicts) {
+        spdlog::warn("preflight: {} and {} are in conflict ({})", conflict.package, conflict.conflicts_with, conflict.rule);
+    }
+    spdlog::info("preflight: {} packages to install, {:.1f}MiB to download, {:.1f}MiB installed", resolution.packages.size(),
+        static_cast<double>(resolution.download_size) / (1024.0 * 1024.0), static_cast<double>(resolution.install_size) / (1024.0 * 1024.0));
+
+    std::vector<gucc::download::PackageFile> files{};
+    files.reserve(resolution.packages.size());
+    for (const auto& pkg : resolution.packages) {
+        files.emplace_back(gucc::download::PackageFile{
+            .repo      = std::string{pkg.repo},
+            .filename  = std::string{pkg.filename},
+            .size      = pkg.download_size,
+            .sha256sum = std::string{pkg.sha256sum},
+        });
+    }
+    return files;
 }
 
 }  // namespace
@@ -99,18 +150,18 @@ auto resolve_netinstall_packages(const InstallContext& ctx) noexcept -> std::vec
     if (ctx.netinstall_groups.empty()) {
         return packages;
     }
-    auto groups = gucc::package::get_netinstall_groups(make_net_profs_info(ctx));
-    if (!groups) {
+    const auto index = gucc::package::get_profile_index(make_net_profs_info(ctx));
+    if (!index) {
         spdlog::warn("could not load netinstall groups");
         return packages;
     }
     for (const auto& name : ctx.netinstall_groups) {
-        const auto found = std::ranges::find(*groups, name, &gucc::profile::NetinstallGroup::name);
-        if (found == groups->end()) {
+        const auto* group_packages = index->group_packages(name);
+        if (group_packages == nullptr) {
             spdlog::warn("netinstall group '{}' not found. skipping", name);
             continue;
         }
-        collect_group_packages(*found, packages);
+        packages.insert(packages.cend(), group_packages->cbegin(), group_packages->cend());
     }
     return packages;
 }
@@ -129,8 +180,25 @@ auto install_base(const InstallContext& ctx) noexcept
     if (!pkg_list.has_value()) {
         return std::unexpected("failed to get base package list");
     }
+    // the lvm2 hook activates cached LVs only with cache_check around
+    if (!ctx.lvm_volume_groups.empty()) {
+        pkg_list->insert(pkg_list->cend(), {"lvm2", "thin-provisioning-tools"});
+    }
+    if (!ctx.md_arrays.empty()) {
+        pkg_list->emplace_back("mdadm");
+    }
     const auto& base_pkgs = gucc::utils::join(*pkg_list, ' ');
     spdlog::info("Preparing for pkgs to install: '{}'", base_pkgs);
+    // the server profile gets its own pacstrap later on, checked and prefetched along with base
+    // so a missing package shows up before the first download
+    auto preflight_list = *pkg_list;
+    if (ctx.resolved_server) {
+        const auto& server_pkgs = ctx.resolved_server->packages;
+        const auto extra        = resolve_netinstall_packages(ctx);
+        preflight_list.insert(preflight_list.cend(), server_pkgs.cbegin(), server_pkgs.cend());
+        preflight_list.insert(preflight_list.cend(), extra.cbegin(), extra.cend());
+    }
+    auto prefetch = preflight_packages(preflight_list);
 
     spdlog::info("filesystem type on '{}' := '{}', LVM := {}, LUKS := {}", mountpoint, root_filesystem, ctx.crypto.is_lvm, ctx.crypto.is_luks);
 
@@ -140,14 +208,21 @@ auto install_base(const InstallContext& ctx) noexcept
         .packages        = base_pkgs,
         .keymap          = ctx.keymap,
         .initcpio_config = gucc::initcpio::InitcpioConfig{
-            .filesystem_type  = fs_type,
-            .is_lvm           = ctx.crypto.is_lvm,
-            .is_luks          = ctx.crypto.is_luks,
-            .use_systemd_hook = true,
-            .is_zfs_encrypted = ctx.zfs_encrypted,
+            .filesystem_type       = fs_type,
+            .is_lvm                = ctx.crypto.is_lvm,
+            .is_luks               = ctx.crypto.is_luks,
+            .use_systemd_hook      = true,
+            .is_btrfs_multi_device = ctx.btrfs_multi_device,
+            .is_zfs_encrypted      = ctx.zfs_encrypted,
+            .is_mdadm              = !ctx.md_arrays.empty(),
         },
         .is_zfs             = !ctx.zfs_zpool_names.empty(),
+        .is_mdadm           = !ctx.md_arrays.empty(),
         .hostcache          = ctx.hostcache,
+        .target_cache       = ctx.target_cache,
+        .backend            = package_backend(ctx),
+        .bundle_dir         = ctx.offline_bundle,
+        .prefetch           = std::move(prefetch),
         .host_files_to_copy = {{"/etc/pacman.conf", "/etc/pacman.conf"}},
     };
 
@@ -176,8 +251,9 @@ auto install_desktop_packages(std::string_view desktop, const InstallContext& ct
     pkg_list->insert(pkg_list->cend(), extra.cbegin(), extra.cend());
 
     spdlog::info("Preparing for desktop envs to install: '{}'", gucc::utils::join(*pkg_list, ' '));
+    preflight_packages(*pkg_list);
 
-    auto pkg_result = install_packages(*pkg_list, ctx.mountpoint, ctx.hostcache);
+    auto pkg_result = install_packages(*pkg_list, ctx);
     if (!pkg_result) {
         return std::unexpected(pkg_result.error());
     }
@@ -199,12 +275,14 @@ auto configure_desktop_extras(const InstallContext& ctx) noexcept
         const auto fs_type          = gucc::fs::string_to_filesystem_type(filesystem_type);
 
         const auto initcpio_config = gucc::initcpio::InitcpioConfig{
-            .filesystem_type  = fs_type,
-            .is_lvm           = ctx.crypto.is_lvm,
-            .is_luks          = ctx.crypto.is_luks,
-            .has_plymouth     = true,
-            .use_systemd_hook = true,
-            .is_zfs_encrypted = ctx.zfs_encrypted,
+            .filesystem_type       = fs_type,
+            .is_lvm                = ctx.crypto.is_lvm,
+            .is_luks               = ctx.crypto.is_luks,
+            .has_plymouth          = true,
+            .use_systemd_hook      = true,
+            .is_btrfs_multi_device = ctx.btrfs_multi_device,
+            .is_zfs_encrypted      = ctx.zfs_encrypted,
+            .is_mdadm              = !ctx.md_arrays.empty(),
         };
         const auto initcpio_path = fmt::format(FMT_COMPILE("{}/etc/mkinitcpio.conf"), mountpoint);
         if (gucc::initcpio::setup_initcpio_config(initcpio_path, initcpio_config)) {
@@ -242,6 +320,22 @@ auto install_packages(const std::vector<std::string>& packages,
     return {};
 }
 
+auto install_packages(const std::vector<std::string>& packages, const InstallContext& ctx) noexcept
+    -> std::expected<void, std::string> {
+    /* clang-format off */
+    if (packages.empty()) { return {}; }
+    /* clang-format on */
+
+    const auto& pkgs_str     = gucc::utils::join(packages, ' ');
+    const auto target_config = fmt::format(FMT_COMPILE("{}/etc/pacman.conf"), ctx.mountpoint);
+    // without -c pacstrap caches on the target itself
+    const bool hostcache = ctx.hostcache && !ctx.target_cache;
+    if (auto res = gucc::install::install_packages(ctx.mountpoint, pkgs_str, target_config, hostcache, package_backend(ctx)); !res) {
+        return std::unexpected(fmt::format("failed to install packages: {}: {}", pkgs_str, gucc::to_string(res.error())));
+    }
+    return {};
+}
+
 auto remove_packages(const std::vector<std::string>& packages,
     std::string_view mountpoint) noexcept
     -> std::expected<void, std::string> {
@@ -312,13 +406,14 @@ auto init_server_profile(InstallContext& ctx) noexcept
         return {};
     }
 
-    const auto content = gucc::fetch::fetch_file_from_url(ctx.server_profiles_url, ctx.server_profiles_fallback_url);
-    if (!content) {
+    const auto fetched = gucc::fetch::fetch_file_hedged(ctx.server_profiles_url, ctx.server_profiles_fallback_url, {.hedge_delay = ctx.profiles_hedge_delay});
+    if (!fetched) {
         return std::unexpected(fmt::format(FMT_COMPILE("could not fetch server profiles from '{}' (fallback '{}')"),
             ctx.server_profiles_url, ctx.server_profiles_fallback_url));
     }
+    spdlog::info("server profiles: '{}' ({}, {}s old)", fetched->url, gucc::fetch::fetch_source_to_string(fetched->source), fetched->age.count());
 
-    auto profiles = gucc::profile::parse_server_profiles(*content);
+    auto profiles = gucc::profile::parse_server_profiles(fetched->content);
     if (!profiles) {
         return std::unexpected(fmt::format(FMT_COMPILE("invalid server profiles doc: {}"), gucc::to_string(profiles.error())));
     }
@@ -343,7 +438,7 @@ auto init_server_profile(InstallContext& ctx) noexcept
 auto install_needed(std::string_view pkg) noexcept
     -> std::expected<void, std::string> {
     // Check if already installed
-    if (gucc::utils::exec_checked(fmt::format(FMT_COMPILE("pacman -Qq {} &>/dev/null"), pkg))) {
+    if (gucc::localdb::is_installed(pkg, "/"sv)) {
         return {};
     }
 
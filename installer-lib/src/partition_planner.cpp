@@ -4,6 +4,7 @@
 // import gucc
 #include "gucc/block_devices.hpp"
 #include "gucc/btrfs_query.hpp"
+#include "gucc/fs_utils.hpp"
 #include "gucc/io_utils.hpp"
 #include "gucc/luks.hpp"
 #include "gucc/lvm.hpp"
@@ -83,12 +84,31 @@ auto zfs_pools_inventory() noexcept -> std::vector<ExistingZfsPool> {
 }
 
 auto lvm_groups_inventory() noexcept -> std::vector<ExistingLvmGroup> {
+    auto report = gucc::lvm::read_lvm_report();
+    if (!report) {
+        spdlog::warn("Failed to query LVM: {}", report.error().context);
+        return {};
+    }
+
     std::vector<ExistingLvmGroup> out;
-    for (auto& [name, size] : gucc::lvm::show_volume_groups()) {
-        out.push_back(ExistingLvmGroup{
-            .name = std::move(name),
-            .size = std::move(size),
-        });
+    out.reserve(report->volume_groups.size());
+    for (auto& vg : report->volume_groups) {
+        ExistingLvmGroup group{
+            .name = std::move(vg.name),
+            .size = vg.size,
+            .free = vg.free,
+        };
+        for (auto& pv : report->physical_volumes) {
+            if (pv.vg_name == group.name) {
+                group.physical_volumes.push_back(std::move(pv.name));
+            }
+        }
+        for (auto& lv : report->logical_volumes) {
+            if (lv.vg_name == group.name && !lv.name.starts_with('[')) {
+                group.logical_volumes.push_back(std::move(lv.name));
+            }
+        }
+        out.push_back(std::move(group));
     }
     return out;
 }
@@ -229,24 +249,45 @@ auto prepare_default_zpool(std::string_view partition,
     return {};
 }
 
-auto encrypt_partition(const LuksFormatRequest& req) noexcept
+auto encrypt_partition(const LuksFormatRequest& req, gucc::fs::Partition& partition) noexcept
     -> std::expected<void, std::string> {
     if (auto v = validate_luks_inputs(req.device, req.mapper_name, req.passphrase); !v) {
         return v;
     }
-    const auto format_ok = req.version == LuksVersion::Luks2
-        ? gucc::crypto::luks2_format(req.passphrase, req.device, req.extra_flags)
+    const auto is_luks2 = req.version == LuksVersion::Luks2;
+    auto perf           = req.perf ? *req.perf : gucc::crypto::query_luks_perf_options(req.device, req.bypass_workqueues);
+    if (!is_luks2) {
+        // LUKS1 sectors are fixed at 512 bytes
+        perf.sector_size = 0;
+    }
+
+    const auto& perf_flags   = gucc::crypto::luks2_format_perf_flags(perf);
+    const auto& format_flags = (perf_flags.empty() || req.extra_flags.empty())
+        ? perf_flags + req.extra_flags
+        : fmt::format("{} {}", perf_flags, req.extra_flags);
+    const auto format_ok = is_luks2
+        ? gucc::crypto::luks2_format(req.passphrase, req.device, format_flags)
         : gucc::crypto::luks1_format(req.passphrase, req.device, req.extra_flags);
     if (!format_ok) {
         return std::unexpected(fmt::format("failed to format LUKS partition {}: {}", req.device, format_ok.error().context));
     }
-    const auto open_ok = req.version == LuksVersion::Luks2
-        ? gucc::crypto::luks2_open(req.passphrase, req.device, req.mapper_name)
-        : gucc::crypto::luks1_open(req.passphrase, req.device, req.mapper_name);
+    // --persistent keeps the workqueue flags in a LUKS2 header for every later activation
+    const auto open_ok = is_luks2
+        ? gucc::crypto::luks2_open(req.passphrase, req.device, req.mapper_name, gucc::crypto::luks2_open_perf_flags(perf))
+        : gucc::crypto::luks1_open(req.passphrase, req.device, req.mapper_name, gucc::crypto::luks1_open_perf_flags(perf));
     if (!open_ok) {
         return std::unexpected(fmt::format("failed to open LUKS partition {} as {}: {}",
             req.device, req.mapper_name, open_ok.error().context));
     }
+
+    partition.luks_mapper_name = req.mapper_name;
+    if (const auto& luks_uuid = gucc::fs::utils::get_device_uuid(req.device); !luks_uuid.empty()) {
+        partition.luks_uuid = luks_uuid;
+    }
+    // crypttab is what reaches a LUKS1 device, and it doesn't hurt a LUKS2 one
+    if (auto crypttab_opts = gucc::crypto::luks_crypttab_perf_options(perf); !crypttab_opts.empty()) {
+        partition.luks_crypttab_opts = std::move(crypttab_opts);
+    }
     return {};
 }
 
@@ -1,6 +1,11 @@
 #include "cachyos/disk.hpp"
 #include "cachyos/steps.hpp"
 
+// import gucc
+#include "gucc/error.hpp"
+#include "gucc/offline_bundle.hpp"
+#include "gucc/package_cache.hpp"
+
 #include <fmt/format.h>
 #include <spdlog/spdlog.h>
 
@@ -27,6 +32,19 @@ auto cleanup(const InstallContext& ctx) noexcept -> std::vector<std::string> {
         }
     }
 
+    if (ctx.prune_cache) {
+        if (auto res = gucc::pkgcache::prune(gucc::pkgcache::target_cache_dir(ctx.mountpoint)); !res) {
+            spdlog::warn("prune package cache: {}", gucc::to_string(res.error()));
+        }
+    }
+
+    if (!ctx.offline_bundle.empty()) {
+        if (auto res = gucc::bundle::detach(ctx.offline_bundle, ctx.mountpoint); !res) {
+            spdlog::warn("detach offline bundle: {}", gucc::to_string(res.error()));
+            warnings.emplace_back(fmt::format("detach offline bundle: {}", gucc::to_string(res.error())));
+        }
+    }
+
     if (auto res = umount_partitions(ctx.mountpoint, ctx.zfs_zpool_names, ctx.swap_device); !res) {
         spdlog::warn("Final umount: {}", res.error());
         warnings.emplace_back(fmt::format("Final umount: {}", res.error()));
@@ -14,7 +14,7 @@ auto detect_crypto(InstallContext& ctx) noexcept -> std::expected<void, std::str
         return std::unexpected(res.error());
     }
     ctx.crypto.is_luks   = res->is_luks;
-    ctx.crypto.is_lvm    = res->is_lvm;
+    ctx.crypto.is_lvm    = res->is_lvm || !ctx.lvm_volume_groups.empty();
     ctx.crypto.luks_dev  = std::move(res->luks_dev);
     ctx.crypto.luks_name = std::move(res->luks_name);
     ctx.crypto.luks_uuid = std::move(res->luks_uuid);
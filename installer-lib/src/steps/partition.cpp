@@ -4,10 +4,13 @@
 
 // import gucc
 #include "gucc/fs_utils.hpp"
+#include "gucc/io_utils.hpp"
+#include "gucc/lvm_cache.hpp"
 #include "gucc/mtab.hpp"
 #include "gucc/partition.hpp"
 #include "gucc/partition_config.hpp"
 #include "gucc/partitioning.hpp"
+#include "gucc/raid.hpp"
 
 #include <algorithm>    // for find
 #include <filesystem>   // for path, lexically_relative
@@ -39,8 +42,12 @@ struct overloads : Ts... {
 auto mount_selections_from_schema(const std::vector<gucc::fs::Partition>& partitions,
     const std::vector<gucc::fs::BtrfsSubvolume>& btrfs_subvolumes) noexcept -> MountSelections {
     // derive mkfs command for all available FS, except ZFS which expected to have empty mkfs cmd
-    const auto mkfs_for = [](std::string_view fstype) {
-        return std::string{gucc::fs::get_mkfs_command(gucc::fs::string_to_filesystem_type(fstype))};
+    // a tuned command planned with the partition wins
+    const auto mkfs_for = [](const gucc::fs::Partition& part) {
+        if (!part.mkfs_command.empty()) {
+            return part.mkfs_command;
+        }
+        return std::string{gucc::fs::get_mkfs_command(gucc::fs::string_to_filesystem_type(part.fstype))};
     };
 
     MountSelections mounts{};
@@ -49,7 +56,7 @@ auto mount_selections_from_schema(const std::vector<gucc::fs::Partition>& partit
             mounts.root = {
                 .device           = part.device,
                 .fstype           = part.fstype,
-                .mkfs_command     = mkfs_for(part.fstype),
+                .mkfs_command     = mkfs_for(part),
                 .mount_opts       = part.mount_opts,
                 .format_requested = true,
             };
@@ -64,7 +71,7 @@ auto mount_selections_from_schema(const std::vector<gucc::fs::Partition>& partit
                 .device           = part.device,
                 .mountpoint       = part.mountpoint,
                 .fstype           = part.fstype,
-                .mkfs_command     = mkfs_for(part.fstype),
+                .mkfs_command     = mkfs_for(part),
                 .mount_opts       = part.mount_opts,
                 .format_requested = true,
             });
@@ -148,7 +155,57 @@ auto partition(InstallContext& ctx) noexcept
                     layout.device, gucc::to_string(res.error())));
             }
 
-            auto selections = mount_selections_from_schema(layout.partitions, layout.btrfs_subvolumes);
+            // tiered volume, the filesystem of the cache partition goes onto the cached LV
+            auto partitions = layout.partitions;
+            if (layout.lvm_cache) {
+                const auto& cache_device = layout.lvm_cache->cache_device;
+                const auto cached_it     = std::ranges::find(partitions, cache_device, &gucc::fs::Partition::device);
+                if (cached_it == std::ranges::end(partitions)) {
+                    return std::unexpected(fmt::format("lvm cache device '{}' is not a partition of '{}'", cache_device, layout.device));
+                }
+                // let udev catch up with the new partition table
+                gucc::utils::settle_devices();
+                auto lv_path = gucc::lvm::create_cached_lv(*layout.lvm_cache);
+                if (!lv_path) {
+                    return std::unexpected(fmt::format("failed to create cached volume '{}': {}",
+                        layout.lvm_cache->lv_name, gucc::to_string(lv_path.error())));
+                }
+                cached_it->device = std::move(*lv_path);
+                ctx.lvm_volume_groups.push_back(layout.lvm_cache->vg_name);
+                // bootloader and initcpio run before detect_crypto
+                ctx.crypto.is_lvm = true;
+            }
+
+            // the partition is the first member, the filesystem spans all of them
+            if (layout.raid) {
+                if (auto res = gucc::raid::validate_raid_setup(*layout.raid); !res) {
+                    return std::unexpected(fmt::format("invalid raid layout: {}", gucc::to_string(res.error())));
+                }
+                const auto& member = layout.raid->devices.front();
+                const auto raid_it = std::ranges::find(partitions, member, &gucc::fs::Partition::device);
+                if (raid_it == std::ranges::end(partitions)) {
+                    return std::unexpected(fmt::format("raid member '{}' is not a partition of '{}'", member, layout.device));
+                }
+                if (layout.raid->backend == gucc::raid::RaidBackend::Btrfs) {
+                    if (raid_it->mkfs_command.empty()) {
+                        raid_it->mkfs_command = gucc::fs::get_mkfs_command(gucc::fs::FilesystemType::Btrfs);
+                    }
+                    raid_it->mkfs_command = gucc::raid::btrfs_raid_mkfs_command(raid_it->mkfs_command, *layout.raid);
+                    // the btrfs hook waits for every member of the root
+                    ctx.btrfs_multi_device = ctx.btrfs_multi_device || raid_it->mountpoint == "/"sv;
+                } else {
+                    gucc::utils::settle_devices();
+                    auto md_path = gucc::raid::create_md_array(*layout.raid);
+                    if (!md_path) {
+                        return std::unexpected(fmt::format("failed to create md array '{}': {}",
+                            layout.raid->name, gucc::to_string(md_path.error())));
+                    }
+                    raid_it->device = *md_path;
+                    ctx.md_arrays.push_back(std::move(*md_path));
+                }
+            }
+
+            auto selections = mount_selections_from_schema(partitions, layout.btrfs_subvolumes);
 
             // zfs shits
             if (layout.zfs_setup) {
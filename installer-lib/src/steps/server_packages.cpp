@@ -20,7 +20,7 @@ auto server_packages(const InstallContext& ctx) noexcept -> std::expected<void,
     packages.append_range(extra);
 
     spdlog::info("Installing server profile '{}' packages: '{}'", profile.id, gucc::utils::join(packages, ' '));
-    if (auto res = install_packages(packages, ctx.mountpoint, ctx.hostcache); !res) {
+    if (auto res = install_packages(packages, ctx); !res) {
         spdlog::error("server_packages: {}", res.error());
         return std::unexpected(fmt::format("server_packages: {}", res.error()));
     }
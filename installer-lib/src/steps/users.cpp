@@ -16,7 +16,7 @@ auto users(const UserSettings& user,
         warnings.emplace_back(fmt::format("set_root_password: {}", res.error()));
     }
 
-    if (auto res = create_user(user, ctx.mountpoint, ctx.hostcache); !res) {
+    if (auto res = create_user(user, ctx.mountpoint, ctx.hostcache && !ctx.target_cache); !res) {
         spdlog::error("create_user: {}", res.error());
         warnings.emplace_back(fmt::format("create_user: {}", res.error()));
     }
@@ -2,8 +2,9 @@
 
 // import gucc
 #include "gucc/bootloader.hpp"
-#include "gucc/fs_utils.hpp"
 #include "gucc/io_utils.hpp"
+#include "gucc/local_db.hpp"
+#include "gucc/mount_table.hpp"
 #include "gucc/string_utils.hpp"
 
 #include <array>        // for array
@@ -24,14 +25,11 @@ namespace {
     using gucc::bootloader::BootloaderType;
     switch (ctx.bootloader) {
     case BootloaderType::Grub:
-        return gucc::utils::exec_checked(
-            fmt::format(FMT_COMPILE("arch-chroot {} pacman -Qq grub &> /dev/null"), ctx.mountpoint));
+        return gucc::localdb::is_installed("grub"sv, ctx.mountpoint);
     case BootloaderType::Refind:
-        return gucc::utils::exec_checked(
-            fmt::format(FMT_COMPILE("arch-chroot {} pacman -Qq refind &> /dev/null"), ctx.mountpoint));
+        return gucc::localdb::is_installed("refind"sv, ctx.mountpoint);
     case BootloaderType::Limine:
-        return gucc::utils::exec_checked(
-            fmt::format(FMT_COMPILE("arch-chroot {} pacman -Qq limine &> /dev/null"), ctx.mountpoint));
+        return gucc::localdb::is_installed("limine"sv, ctx.mountpoint);
     case BootloaderType::SystemdBoot:
         // Check both common ESP mount points (loader.conf lives at ESP root).
         return fs::exists(fmt::format(FMT_COMPILE("{}/boot/loader/loader.conf"), ctx.mountpoint))
@@ -44,7 +42,8 @@ namespace {
 namespace cachyos::installer {
 
 auto check_mount(std::string_view mountpoint) noexcept -> bool {
-    return !gucc::fs::utils::get_mountpoint_source(mountpoint).empty();
+    const auto& mount_table = gucc::mtab::MountTable::read();
+    return mount_table && mount_table->find_by_mountpoint(mountpoint) != nullptr;
 }
 
 auto check_base_installed(std::string_view mountpoint) noexcept -> bool {
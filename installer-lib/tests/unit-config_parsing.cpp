@@ -121,6 +121,123 @@ TEST_CASE("config parsing")
 
         CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "ext4", "zfs_passphrase": "hunter2" })"sv).has_value());
         CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "zfs", "subvolumes": [ { "subvolume": "@", "mountpoint": "/" } ] })"sv).has_value());
+
+        auto pooled = parse_installer_config(R"({ "menus": 1, "fs_name": "zfs", "zfs_vdevs": [
+            { "type": "mirror", "devices": [ "/dev/nvme1n1" ] },
+            { "class": "log", "devices": [ "/dev/nvme2n1" ] } ] })"sv);
+        REQUIRE(pooled.has_value());
+        REQUIRE_EQ(pooled->zfs_vdevs.size(), 2);
+        CHECK_EQ(pooled->zfs_vdevs[0].type, "mirror"sv);
+        CHECK_EQ(pooled->zfs_vdevs[0].vdev_class, "data"sv);
+        CHECK_EQ(pooled->zfs_vdevs[1].type, "stripe"sv);
+        CHECK_EQ(pooled->zfs_vdevs[1].vdev_class, "log"sv);
+
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "zfs", "zfs_vdevs": [ { "type": "raid10", "devices": [ "/dev/sdb" ] } ] })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "zfs", "zfs_vdevs": [ { "class": "dedup", "devices": [ "/dev/sdb" ] } ] })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "zfs", "zfs_vdevs": [ { "type": "mirror" } ] })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "ext4", "zfs_vdevs": [ { "devices": [ "/dev/sdb" ] } ] })"sv).has_value());
+    }
+    SECTION("offline bundle")
+    {
+        auto cfg = parse_installer_config(R"({ "menus": 1, "offline_bundle": "/run/media/bundle" })"sv);
+        REQUIRE(cfg.has_value());
+        REQUIRE(cfg->offline_bundle.has_value());
+        CHECK_EQ(*cfg->offline_bundle, "/run/media/bundle"sv);
+
+        CHECK(!parse_installer_config(R"({ "menus": 1, "offline_bundle": true })"sv).has_value());
+    }
+    SECTION("lvm cache")
+    {
+        auto cfg = parse_installer_config(R"({
+            "menus": 1,
+            "fs_name": "ext4",
+            "partitions": [
+                { "name": "/dev/nvme0n1p2", "mountpoint": "/", "size": "100G", "type": "root" },
+                { "name": "/dev/nvme0n1p3", "mountpoint": "/home", "size": "100%", "fs_name": "xfs", "type": "additional" }
+            ],
+            "lvm_cache": { "mountpoint": "/home", "origin_devices": [ "/dev/sda", "/dev/sdb" ], "mode": "writecache" }
+        })"sv);
+        REQUIRE(cfg.has_value());
+        REQUIRE(cfg->lvm_cache.has_value());
+        CHECK_EQ(cfg->lvm_cache->mountpoint, "/home"sv);
+        CHECK_EQ(cfg->lvm_cache->mode, "writecache"sv);
+        CHECK_EQ(cfg->lvm_cache->vg_name, "vgcachyos"sv);
+        CHECK_EQ(cfg->lvm_cache->origin_devices.size(), 2);
+
+        CHECK(parse_installer_config(R"({ "menus": 1, "fs_name": "ext4", "partitions": [ { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root" } ], "lvm_cache": { "mountpoint": "/", "origin_devices": [ "/dev/sdb" ] } })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "ext4", "partitions": [ { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root" } ], "lvm_cache": { "mountpoint": "/", "origin_devices": [ "/dev/sdb" ], "mode": "writearound" } })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "ext4", "partitions": [ { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root" } ], "lvm_cache": { "mountpoint": "/" } })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "ext4", "partitions": [ { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root" } ], "lvm_cache": { "mountpoint": "/home", "origin_devices": [ "/dev/sdb" ] } })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "zfs", "partitions": [ { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root" } ], "lvm_cache": { "mountpoint": "/", "origin_devices": [ "/dev/sdb" ] } })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "lvm_cache": [ "/dev/sdb" ] })"sv).has_value());
+    }
+    SECTION("raid")
+    {
+        auto cfg = parse_installer_config(R"({
+            "menus": 1,
+            "fs_name": "btrfs",
+            "partitions": [
+                { "name": "/dev/nvme0n1p1", "mountpoint": "/boot", "size": "2G", "fs_name": "vfat", "type": "boot" },
+                { "name": "/dev/nvme0n1p2", "mountpoint": "/", "size": "100%", "type": "root" }
+            ],
+            "raid": { "level": "raid10", "devices": [ "/dev/nvme1n1", "/dev/nvme2n1", "/dev/nvme3n1" ] }
+        })"sv);
+        REQUIRE(cfg.has_value());
+        REQUIRE(cfg->raid.has_value());
+        CHECK_EQ(cfg->raid->mountpoint, "/"sv);
+        CHECK_EQ(cfg->raid->level, "raid10"sv);
+        CHECK_EQ(cfg->raid->metadata, "raid1"sv);
+        CHECK_EQ(cfg->raid->name, "cachyos"sv);
+        CHECK_EQ(cfg->raid->devices.size(), 3);
+
+        CHECK(parse_installer_config(R"({ "menus": 1, "fs_name": "ext4", "partitions": [ { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root" } ], "raid": { "level": "raid1", "devices": [ "/dev/sdb" ], "name": "root" } })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "ext4", "partitions": [ { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root" } ], "raid": { "level": "raid5", "devices": [ "/dev/sdb", "/dev/sdc" ] } })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "ext4", "partitions": [ { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root" } ], "raid": { "level": "raid10", "devices": [ "/dev/sdb" ] } })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "ext4", "partitions": [ { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root" } ], "raid": { "devices": [ "/dev/sdb" ] } })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "btrfs", "partitions": [ { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root" } ], "raid": { "level": "raid0", "devices": [ "/dev/sdb" ], "metadata": "dup" } })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "zfs", "partitions": [ { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root" } ], "raid": { "level": "raid1", "devices": [ "/dev/sdb" ] } })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "ext4", "partitions": [ { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root" } ], "lvm_cache": { "mountpoint": "/", "origin_devices": [ "/dev/sdc" ] }, "raid": { "level": "raid1", "devices": [ "/dev/sdb" ] } })"sv).has_value());
+    }
+    SECTION("partition tuning")
+    {
+        auto cfg = parse_installer_config(R"({
+            "menus": 1,
+            "fs_name": "ext4",
+            "partitions": [
+                { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root",
+                  "tuning": "hdd", "mkfs_command": "mkfs.ext4 -q -T huge", "mount_opts": "defaults,noatime" }
+            ]
+        })"sv);
+        REQUIRE(cfg.has_value());
+        REQUIRE_EQ(cfg->partitions.size(), 1);
+        CHECK_EQ(cfg->partitions[0].tuning.value_or(""), "hdd");
+        CHECK_EQ(cfg->partitions[0].mkfs_command.value_or(""), "mkfs.ext4 -q -T huge");
+        CHECK_EQ(cfg->partitions[0].mount_opts.value_or(""), "defaults,noatime");
+
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "ext4", "partitions": [ { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root", "tuning": "floppy" } ] })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "ext4", "partitions": [ { "name": "/dev/sda1", "mountpoint": "/", "size": "100%", "type": "root", "mount_opts": 1 } ] })"sv).has_value());
+    }
+    SECTION("subvolume policy")
+    {
+        auto cfg = parse_installer_config(R"({
+            "menus": 1,
+            "fs_name": "btrfs",
+            "subvolumes": [
+                { "subvolume": "/@", "mountpoint": "/" },
+                { "subvolume": "/@postgres", "mountpoint": "/var/lib/postgres", "nocow": true, "mount_opts": "noatime,nodev,nosuid" },
+                { "subvolume": "/@cache", "mountpoint": "/var/cache", "compression": "zstd" }
+            ]
+        })"sv);
+        REQUIRE(cfg.has_value());
+        REQUIRE_EQ(cfg->subvolumes.size(), 3);
+        CHECK(!cfg->subvolumes[0].nocow);
+        CHECK(!cfg->subvolumes[0].mount_opts.has_value());
+        CHECK(cfg->subvolumes[1].nocow);
+        CHECK_EQ(cfg->subvolumes[1].mount_opts.value_or(""), "noatime,nodev,nosuid");
+        CHECK_EQ(cfg->subvolumes[2].compression.value_or(""), "zstd");
+
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "btrfs", "subvolumes": [ { "subvolume": "/@", "mountpoint": "/", "nocow": "yes" } ] })"sv).has_value());
+        CHECK(!parse_installer_config(R"({ "menus": 1, "fs_name": "btrfs", "subvolumes": [ { "subvolume": "/@", "mountpoint": "/", "compression": 3 } ] })"sv).has_value());
     }
     SECTION("headless")
     {
@@ -181,6 +298,8 @@ TEST_CASE("config parsing")
                  "examples/desktop-zfs.json",
                  "examples/server-web.json",
                  "examples/server-db.json",
+                 "examples/server-db-zfs.json",
+                 "examples/server-web-raid10.json",
                  "examples/server-container-host.json",
                  "examples/server-cockpit.json",
              }) {
@@ -6,6 +6,7 @@
 #include "cachyos/installer_config.hpp"
 
 #include <algorithm>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <variant>
@@ -18,9 +19,12 @@ using namespace std::string_view_literals;
 
 using cachyos::installer::headless_strategy_from_config;
 using cachyos::installer::InstallerConfig;
+using cachyos::installer::LvmCacheSetupConfig;
 using cachyos::installer::PartitionConfig;
 using cachyos::installer::PartitionType;
+using cachyos::installer::RaidSetupConfig;
 using cachyos::installer::SubvolumeConfig;
+using cachyos::installer::ZfsVdevConfig;
 namespace strategy = cachyos::installer::partition_strategy;
 
 namespace {
@@ -241,6 +245,95 @@ TEST_CASE("headless partitioning")
         REQUIRE_EQ(layout->btrfs_subvolumes[0].subvolume, "@"sv);
         REQUIRE_EQ(layout->btrfs_subvolumes[1].mountpoint, "/home"sv);
     }
+    SECTION("subvolume policy is passed through and validated")
+    {
+        auto cfg                   = valid_uefi_config();
+        cfg.use_default_subvolumes = false;
+        cfg.subvolumes             = {
+            SubvolumeConfig{.subvolume = "@"s, .mountpoint = "/"s},
+            SubvolumeConfig{.subvolume = "@images"s, .mountpoint = "/var/lib/images"s, .nocow = true, .mount_opts = "noatime,nodev"s},
+            SubvolumeConfig{.subvolume = "@cache"s, .mountpoint = "/var/cache"s, .compression = "lzo"s},
+        };
+
+        const auto strategy = headless_strategy_from_config(cfg, true);
+        REQUIRE(strategy.has_value());
+        const auto* layout = std::get_if<strategy::CreateLayout>(&*strategy);
+        REQUIRE(layout != nullptr);
+        REQUIRE_EQ(layout->btrfs_subvolumes.size(), 3);
+        REQUIRE(layout->btrfs_subvolumes[1].nocow);
+        REQUIRE_EQ(layout->btrfs_subvolumes[1].mount_opts, std::optional{"noatime,nodev"s});
+        REQUIRE_EQ(layout->btrfs_subvolumes[2].compression, "lzo"sv);
+
+        // NOCOW data is never compressed
+        cfg.subvolumes[1].compression = "zstd"s;
+        const auto invalid = headless_strategy_from_config(cfg, true);
+        REQUIRE_FALSE(invalid.has_value());
+        REQUIRE(contains(joined_errors(invalid.error()), "can't be nocow"sv));
+    }
+    SECTION("btrfs subvolume presets for server profiles")
+    {
+        const auto mountpoint_is = [](std::string_view mountpoint) {
+            return [mountpoint](const auto& subvol) { return subvol.mountpoint == mountpoint; };
+        };
+
+        auto cfg           = valid_uefi_config();
+        cfg.server_profile = "db"s;
+        // a configured mountpoint wins over the preset
+        cfg.use_default_subvolumes = false;
+        cfg.subvolumes             = {
+            SubvolumeConfig{.subvolume = "@"s, .mountpoint = "/"s},
+            SubvolumeConfig{.subvolume = "@pg"s, .mountpoint = "/var/lib/postgres"s, .nocow = true},
+        };
+
+        const auto strategy = headless_strategy_from_config(cfg, true);
+        REQUIRE(strategy.has_value());
+        const auto* layout = std::get_if<strategy::CreateLayout>(&*strategy);
+        REQUIRE(layout != nullptr);
+        const auto& subvols = layout->btrfs_subvolumes;
+        REQUIRE_EQ(std::ranges::count_if(subvols, mountpoint_is("/var/lib/postgres"sv)), 1);
+        REQUIRE_EQ(std::ranges::find_if(subvols, mountpoint_is("/var/lib/postgres"sv))->subvolume, "@pg"sv);
+        const auto mysql = std::ranges::find_if(subvols, mountpoint_is("/var/lib/mysql"sv));
+        REQUIRE(mysql != subvols.end());
+        REQUIRE(mysql->nocow);
+
+        auto container_cfg           = valid_uefi_config();
+        container_cfg.server_profile = "container-host"s;
+        const auto container_strategy = headless_strategy_from_config(container_cfg, true);
+        REQUIRE(container_strategy.has_value());
+        const auto* container_layout = std::get_if<strategy::CreateLayout>(&*container_strategy);
+        REQUIRE(container_layout != nullptr);
+        const auto& container_subvols = container_layout->btrfs_subvolumes;
+        const auto containers         = std::ranges::find_if(container_subvols, mountpoint_is("/var/lib/containers"sv));
+        REQUIRE(containers != container_subvols.end());
+        REQUIRE_EQ(containers->compression, "zstd"sv);
+        const auto images = std::ranges::find_if(container_subvols, mountpoint_is("/var/lib/libvirt/images"sv));
+        REQUIRE(images != container_subvols.end());
+        REQUIRE(images->nocow);
+        // the defaults are still there
+        REQUIRE(std::ranges::any_of(container_subvols, mountpoint_is("/home"sv)));
+
+        // other profiles and non-btrfs roots get no presets
+        auto web_cfg           = valid_uefi_config();
+        web_cfg.server_profile = "web"s;
+        const auto web_strategy = headless_strategy_from_config(web_cfg, true);
+        REQUIRE(web_strategy.has_value());
+        const auto* web_layout = std::get_if<strategy::CreateLayout>(&*web_strategy);
+        REQUIRE(web_layout != nullptr);
+        REQUIRE_FALSE(std::ranges::any_of(web_layout->btrfs_subvolumes, mountpoint_is("/var/lib/containers"sv)));
+
+        // presets sit next to the root subvolume, a layout without one is rejected
+        auto flat_cfg                   = valid_uefi_config();
+        flat_cfg.server_profile         = "db"s;
+        flat_cfg.use_default_subvolumes = false;
+        const auto flat_strategy        = headless_strategy_from_config(flat_cfg, true);
+        REQUIRE_FALSE(flat_strategy.has_value());
+        REQUIRE(contains(joined_errors(flat_strategy.error()), "needs a btrfs subvolume mounted at '/'"sv));
+
+        // a profile without presets is fine on a flat filesystem
+        flat_cfg.server_profile      = "web"s;
+        const auto flat_web_strategy = headless_strategy_from_config(flat_cfg, true);
+        REQUIRE(flat_web_strategy.has_value());
+    }
     SECTION("no subvolumes are invented for a non-btrfs root")
     {
         auto cfg                  = valid_uefi_config();
@@ -279,6 +372,29 @@ TEST_CASE("headless partitioning")
         REQUIRE(std::ranges::all_of(layout->partitions,
             [](const auto& part) { return part.mount_opts == "noatime,compress=zstd"sv; }));
     }
+    SECTION("per-partition tuning overrides")
+    {
+        auto cfg                       = valid_uefi_config();
+        cfg.mount_opts                 = "noatime"s;
+        cfg.partitions[0].mkfs_command = "mkfs.vfat -F32 -S 4096"s;
+        cfg.partitions[1].tuning       = "hdd"s;
+
+        auto strategy = headless_strategy_from_config(cfg, true);
+        REQUIRE(strategy.has_value());
+        const auto* layout = std::get_if<strategy::CreateLayout>(&*strategy);
+        REQUIRE(layout != nullptr);
+        REQUIRE_EQ(layout->partitions[0].mkfs_command, "mkfs.vfat -F32 -S 4096"sv);
+        REQUIRE_EQ(layout->partitions[1].mkfs_command, "mkfs.btrfs -f --nodesize 32k"sv);
+        REQUIRE_EQ(layout->partitions[1].mount_opts, "noatime"sv);
+
+        // the partition's own mount_opts beat the global ones
+        cfg.partitions[1].mount_opts = "defaults,noatime,compress=zstd:6"s;
+        strategy                     = headless_strategy_from_config(cfg, true);
+        REQUIRE(strategy.has_value());
+        layout = std::get_if<strategy::CreateLayout>(&*strategy);
+        REQUIRE(layout != nullptr);
+        REQUIRE_EQ(layout->partitions[1].mount_opts, "defaults,noatime,compress=zstd:6"sv);
+    }
     SECTION("a missing device is rejected")
     {
         auto cfg   = valid_uefi_config();
@@ -330,6 +446,65 @@ TEST_CASE("headless partitioning")
         REQUIRE(layout->zfs_setup->passphrase.has_value());
         REQUIRE_EQ(*layout->zfs_setup->passphrase, "hunter2"sv);
     }
+    SECTION("zfs vdevs")
+    {
+        auto cfg      = valid_zfs_config();
+        cfg.zfs_vdevs = {
+            ZfsVdevConfig{.type = "mirror"s, .vdev_class = "data"s, .devices = {"/dev/nvme1n1"s}},
+            ZfsVdevConfig{.type = "stripe"s, .vdev_class = "cache"s, .devices = {"/dev/nvme2n1"s}},
+        };
+
+        const auto strategy = headless_strategy_from_config(cfg, true);
+        REQUIRE(strategy.has_value());
+        const auto* layout = std::get_if<strategy::CreateLayout>(&*strategy);
+        REQUIRE(layout != nullptr);
+        REQUIRE(layout->zfs_setup.has_value());
+
+        const auto& vdevs = layout->zfs_setup->vdevs;
+        REQUIRE_EQ(vdevs.size(), 2);
+        REQUIRE_EQ(vdevs[0].type, gucc::fs::ZfsVdevType::Mirror);
+        REQUIRE_EQ(vdevs[1].vdev_class, gucc::fs::ZfsVdevClass::Cache);
+    }
+    SECTION("zfs vdevs on the install device")
+    {
+        auto cfg      = valid_zfs_config();
+        cfg.zfs_vdevs = {ZfsVdevConfig{.type = "mirror"s, .devices = {"/dev/nvme0n1"s}}};
+        REQUIRE_FALSE(headless_strategy_from_config(cfg, true).has_value());
+
+        // the ESP is not a vdev
+        cfg.zfs_vdevs = {ZfsVdevConfig{.type = "mirror"s, .devices = {"/dev/nvme0n1p1"s}}};
+        REQUIRE_FALSE(headless_strategy_from_config(cfg, true).has_value());
+    }
+    SECTION("zfs database dataset for the db server profile")
+    {
+        const auto has_postgres = [](const auto& dataset) { return dataset.mountpoint == "/var/lib/postgres"sv; };
+
+        const auto strategy = headless_strategy_from_config(valid_zfs_config(), true);
+        REQUIRE(strategy.has_value());
+        const auto* layout = std::get_if<strategy::CreateLayout>(&*strategy);
+        REQUIRE(layout != nullptr);
+        REQUIRE(layout->zfs_setup.has_value());
+        REQUIRE_FALSE(std::ranges::any_of(layout->zfs_setup->datasets, has_postgres));
+
+        auto cfg           = valid_zfs_config();
+        cfg.server_profile = "db"s;
+
+        const auto db_strategy = headless_strategy_from_config(cfg, true);
+        REQUIRE(db_strategy.has_value());
+        const auto* db_layout = std::get_if<strategy::CreateLayout>(&*db_strategy);
+        REQUIRE(db_layout != nullptr);
+        REQUIRE(db_layout->zfs_setup.has_value());
+
+        const auto& datasets = db_layout->zfs_setup->datasets;
+        const auto postgres  = std::ranges::find_if(datasets, has_postgres);
+        REQUIRE(postgres != datasets.end());
+        REQUIRE(std::ranges::any_of(postgres->properties,
+            [](const auto& property) { return property.name == "recordsize"sv && property.value == "16K"sv; }));
+        const auto mysql = std::ranges::find_if(datasets, [](const auto& dataset) { return dataset.mountpoint == "/var/lib/mysql"sv; });
+        REQUIRE(mysql != datasets.end());
+        REQUIRE(std::ranges::any_of(mysql->properties,
+            [](const auto& property) { return property.name == "recordsize"sv && property.value == "16K"sv; }));
+    }
     SECTION("no zfs_setup for non-zfs")
     {
         const auto strategy = headless_strategy_from_config(valid_uefi_config(), true);
@@ -357,4 +532,109 @@ TEST_CASE("headless partitioning")
         REQUIRE_FALSE(strategy.has_value());
         REQUIRE(contains(joined_errors(strategy.error()), "requires a btrfs root filesystem"sv));
     }
+    SECTION("lvm cache for /home")
+    {
+        auto cfg = valid_uefi_config();
+        cfg.partitions.push_back(PartitionConfig{.name = "/dev/nvme0n1p3"s, .mountpoint = "/home"s, .size = "100G"s, .fs_name = "xfs"s});
+        cfg.lvm_cache = LvmCacheSetupConfig{.mountpoint = "/home"s, .origin_devices = {"/dev/sda"s, "/dev/sdb"s}, .mode = "writeback"s};
+
+        const auto strategy = headless_strategy_from_config(cfg, true);
+        REQUIRE(strategy.has_value());
+        const auto* layout = std::get_if<strategy::CreateLayout>(&*strategy);
+        REQUIRE(layout != nullptr);
+        REQUIRE(layout->lvm_cache.has_value());
+        REQUIRE_EQ(layout->lvm_cache->vg_name, "vgcachyos"sv);
+        REQUIRE_EQ(layout->lvm_cache->lv_name, "home"sv);
+        REQUIRE_EQ(layout->lvm_cache->cache_device, "/dev/nvme0n1p3"sv);
+        REQUIRE_EQ(layout->lvm_cache->origin_devices.size(), 2);
+        REQUIRE_EQ(layout->lvm_cache->mode, gucc::lvm::LvmCacheMode::Writeback);
+
+        // the partition itself is still created
+        REQUIRE_EQ(layout->partitions.size(), 3);
+    }
+    SECTION("lvm cache rejected layouts")
+    {
+        auto cfg      = valid_uefi_config();
+        cfg.lvm_cache = LvmCacheSetupConfig{.mountpoint = "/home"s, .origin_devices = {"/dev/sda"s}};
+        auto strategy = headless_strategy_from_config(cfg, true);
+        REQUIRE_FALSE(strategy.has_value());
+        REQUIRE(contains(joined_errors(strategy.error()), "has no partition"sv));
+
+        // the ESP stays a plain partition
+        cfg.lvm_cache->mountpoint = "/boot"s;
+        REQUIRE_FALSE(headless_strategy_from_config(cfg, true).has_value());
+
+        // origin on the install device
+        cfg.lvm_cache = LvmCacheSetupConfig{.mountpoint = "/"s, .origin_devices = {"/dev/nvme0n1p1"s}};
+        strategy      = headless_strategy_from_config(cfg, true);
+        REQUIRE_FALSE(strategy.has_value());
+        REQUIRE(contains(joined_errors(strategy.error()), "is on the install device"sv));
+
+        auto zfs_cfg      = valid_zfs_config();
+        zfs_cfg.lvm_cache = LvmCacheSetupConfig{.mountpoint = "/"s, .origin_devices = {"/dev/sda"s}};
+        REQUIRE_FALSE(headless_strategy_from_config(zfs_cfg, true).has_value());
+    }
+    SECTION("btrfs raid10 root")
+    {
+        auto cfg = valid_uefi_config();
+        cfg.raid = RaidSetupConfig{.level = "raid10"s, .devices = {"/dev/sdb"s, "/dev/sdc"s, "/dev/sdd"s}};
+
+        const auto strategy = headless_strategy_from_config(cfg, true);
+        REQUIRE(strategy.has_value());
+        const auto* layout = std::get_if<strategy::CreateLayout>(&*strategy);
+        REQUIRE(layout != nullptr);
+        REQUIRE(layout->raid.has_value());
+        REQUIRE_EQ(layout->raid->backend, gucc::raid::RaidBackend::Btrfs);
+        REQUIRE_EQ(layout->raid->level, gucc::raid::RaidLevel::Raid10);
+        REQUIRE_EQ(layout->raid->metadata_level, gucc::raid::RaidLevel::Raid1);
+        REQUIRE_EQ(layout->raid->devices.size(), 4);
+        REQUIRE_EQ(layout->raid->devices.front(), "/dev/nvme0n1p2"sv);
+        REQUIRE_EQ(layout->raid->chunk_size, 0);
+    }
+    SECTION("md raid0 for /srv")
+    {
+        auto cfg = valid_uefi_config();
+        cfg.partitions.push_back(PartitionConfig{.name = "/dev/nvme0n1p3"s, .mountpoint = "/srv"s, .size = "100G"s, .fs_name = "xfs"s, .tuning = "ssd"s});
+        cfg.raid = RaidSetupConfig{.mountpoint = "/srv"s, .level = "raid0"s, .devices = {"/dev/sdb"s}, .name = "srv"s};
+
+        const auto strategy = headless_strategy_from_config(cfg, true);
+        REQUIRE(strategy.has_value());
+        const auto* layout = std::get_if<strategy::CreateLayout>(&*strategy);
+        REQUIRE(layout != nullptr);
+        REQUIRE(layout->raid.has_value());
+        REQUIRE_EQ(layout->raid->backend, gucc::raid::RaidBackend::Mdadm);
+        REQUIRE_EQ(layout->raid->name, "srv"sv);
+        REQUIRE(layout->raid->chunk_size >= 512 * 1024);
+
+        // xfs is laid out for the stripes of the array
+        const auto srv_it = std::ranges::find(layout->partitions, "/srv"sv, &gucc::fs::Partition::mountpoint);
+        REQUIRE(srv_it != layout->partitions.end());
+        REQUIRE(contains(srv_it->mkfs_command, ",sw=2"sv));
+    }
+    SECTION("raid rejected layouts")
+    {
+        auto cfg      = valid_uefi_config();
+        cfg.raid      = RaidSetupConfig{.mountpoint = "/home"s, .level = "raid1"s, .devices = {"/dev/sdb"s}};
+        auto strategy = headless_strategy_from_config(cfg, true);
+        REQUIRE_FALSE(strategy.has_value());
+        REQUIRE(contains(joined_errors(strategy.error()), "has no partition"sv));
+
+        // the ESP stays a plain partition
+        cfg.raid->mountpoint = "/boot"s;
+        REQUIRE_FALSE(headless_strategy_from_config(cfg, true).has_value());
+
+        // member on the install device
+        cfg.raid = RaidSetupConfig{.level = "raid1"s, .devices = {"/dev/nvme0n1p1"s}};
+        strategy = headless_strategy_from_config(cfg, true);
+        REQUIRE_FALSE(strategy.has_value());
+        REQUIRE(contains(joined_errors(strategy.error()), "is on the install device"sv));
+
+        // raid10 needs two mirrors
+        cfg.raid = RaidSetupConfig{.level = "raid10"s, .devices = {"/dev/sdb"s}};
+        REQUIRE_FALSE(headless_strategy_from_config(cfg, true).has_value());
+
+        auto zfs_cfg = valid_zfs_config();
+        zfs_cfg.raid = RaidSetupConfig{.level = "raid1"s, .devices = {"/dev/sdb"s}};
+        REQUIRE_FALSE(headless_strategy_from_config(zfs_cfg, true).has_value());
+    }
 }
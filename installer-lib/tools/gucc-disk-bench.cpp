@@ -0,0 +1,967 @@
+#include "cachyos/disk.hpp"
+#include "cachyos/headless_plan.hpp"
+#include "cachyos/installer_config.hpp"
+#include "cachyos/types.hpp"
+
+// import gucc
+#include "gucc/btrfs.hpp"
+#include "gucc/error.hpp"
+#include "gucc/file_utils.hpp"
+#include "gucc/fstab.hpp"
+#include "gucc/io_utils.hpp"
+#include "gucc/logger.hpp"
+#include "gucc/luks.hpp"
+#include "gucc/lvm.hpp"
+#include "gucc/lvm_cache.hpp"
+#include "gucc/partition_config.hpp"
+#include "gucc/partition_table.hpp"
+#include "gucc/partitioning.hpp"
+#include "gucc/raid.hpp"
+#include "gucc/system_query.hpp"
+
+#include <linux/magic.h>  // for TMPFS_MAGIC
+#include <sys/statfs.h>   // for statfs
+#include <sys/utsname.h>  // for uname
+#include <unistd.h>       // for geteuid
+
+#include <algorithm>     // for sort, find, all_of
+#include <charconv>      // for from_chars
+#include <chrono>        // for steady_clock, duration
+#include <cstdint>       // for uint32_t, uint64_t
+#include <cstdlib>       // for mkdtemp
+#include <expected>      // for expected, unexpected
+#include <filesystem>    // for path, resize_file, remove
+#include <fstream>       // for ofstream
+#include <optional>      // for optional
+#include <string>        // for string
+#include <string_view>   // for string_view
+#include <system_error>  // for error_code, errc
+#include <utility>       // for move, forward
+#include <variant>       // for get_if
+#include <vector>        // for vector
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <spdlog/sinks/stdout_color_sinks.h>  // for stderr_color_sink_mt
+#include <spdlog/spdlog.h>                    // for set_default_logger, set_level
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wold-style-cast"
+#elif defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuseless-cast"
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#endif
+
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace fs = std::filesystem;
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace {
+
+// names that can't clash with the host
+inline constexpr auto BENCH_ZPOOL_NAME = "guccbench"sv;
+inline constexpr auto BENCH_LUKS_NAME  = "guccbench_root"sv;
+inline constexpr auto BENCH_LUKS_PASS  = "guccbench"sv;
+inline constexpr auto BENCH_MD_NAME    = "guccbench"sv;
+inline constexpr auto BENCH_VG_NAME    = "guccbench"sv;
+// the stage measures the disk, not the PBKDF
+inline constexpr auto BENCH_LUKS_FLAGS = "--pbkdf pbkdf2 --pbkdf-force-iterations 1000"sv;
+// pushed through the mapper by the crypt-write/crypt-read stages
+inline constexpr std::uint64_t BENCH_CRYPT_IO_MIB = 256;
+
+inline constexpr std::uint64_t GiB              = 1024ULL * 1024ULL * 1024ULL;
+inline constexpr std::uint64_t DEFAULT_SIZE_GIB = 16;
+
+struct BenchOptions final {
+    std::vector<std::string> configs{};
+    std::uint64_t image_size{DEFAULT_SIZE_GIB * GiB};
+    std::uint32_t runs{1};
+    bool luks{false};
+    /// 4K sectors and no kcryptd workqueues on the LUKS root, forced since loop devices never look like NVMe
+    bool luks_perf{false};
+    /// spawn btrfs/mount per subvolume like before, to compare against the ioctl path
+    bool btrfs_exec{false};
+    /// spread the root over extra loop devices, btrfs natively, anything else as md array
+    std::optional<gucc::raid::RaidLevel> raid{};
+    /// put the root onto a LV of an extra loop device, cached by the root partition
+    std::optional<gucc::lvm::LvmCacheMode> lvm_cache{};
+    /// where the images go, a tmpfs would measure memory instead of the disk
+    std::string image_dir{"."};
+    std::string output{};
+};
+
+struct StageTiming final {
+    std::string name;
+    double ms{};
+};
+
+struct LayoutResult final {
+    std::string config{};
+    std::string root_fs{};
+    std::vector<std::vector<StageTiming>> runs{};
+    std::optional<std::string> error{};
+};
+
+void print_usage(const char* program_name) {
+    fmt::println(stderr, "Usage: {} [OPTIONS] [CONFIG.json...]", program_name);
+    fmt::println(stderr, "\nRuns the disk half of an install on sparse loop devices and reports per-stage timings as JSON.");
+    fmt::println(stderr, "Every partition of the config is remapped onto the loop device. Needs root.");
+    fmt::println(stderr, "\nOptions:");
+    fmt::println(stderr, "  -h, --help         Show this help message");
+    fmt::println(stderr, "  -s, --size GIB     Size of the sparse image (default: {})", DEFAULT_SIZE_GIB);
+    fmt::println(stderr, "  -r, --runs N       Repeat every layout N times (default: 1)");
+    fmt::println(stderr, "  -l, --luks         Put the root filesystem on LUKS2");
+    fmt::println(stderr, "      --luks-perf    Like --luks, with 4K sectors and without the dm-crypt workqueues");
+    fmt::println(stderr, "      --btrfs-exec   Create and mount btrfs subvolumes with btrfs/mount processes");
+    fmt::println(stderr, "      --raid LEVEL   Spread the root over extra loop devices (raid0, raid1, raid10)");
+    fmt::println(stderr, "      --lvm-cache MODE  Move the root onto a LV of an extra loop device, cached by");
+    fmt::println(stderr, "                     the root partition (writethrough, writeback, writecache)");
+    fmt::println(stderr, "  -d, --image-dir DIR  Create the sparse images in DIR (default: current directory),");
+    fmt::println(stderr, "                     which must not be a tmpfs");
+    fmt::println(stderr, "  -o, --output FILE  Write the JSON report to FILE instead of stdout");
+    fmt::println(stderr, "\nWithout configs every examples/*.json of the current directory is used.");
+}
+
+auto parse_uint_arg(std::string_view value) noexcept -> std::optional<std::uint64_t> {
+    std::uint64_t result{};
+    const auto* end      = value.data() + value.size();
+    const auto [ptr, ec] = std::from_chars(value.data(), end, result);
+    if (ec != std::errc{} || ptr != end || result == 0) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+auto kernel_release() noexcept -> std::string {
+    struct utsname uts{};
+    if (::uname(&uts) != 0) {
+        return {};
+    }
+    return uts.release;
+}
+
+/// @brief Sparse image attached as a loop device, torn down in reverse on scope exit.
+class BenchDisk final {
+ public:
+    BenchDisk() = default;
+    BenchDisk(const BenchDisk&) = delete;
+    BenchDisk& operator=(const BenchDisk&) = delete;
+
+    ~BenchDisk() {
+        teardown();
+    }
+
+    auto attach(std::uint64_t image_size, std::string_view image_dir) noexcept -> std::expected<void, std::string> {
+        std::error_code ec{};
+        const auto& dir = fs::absolute(image_dir, ec).string();
+        if (struct statfs dir_stat{}; ::statfs(dir.c_str(), &dir_stat) != 0 || dir_stat.f_type == TMPFS_MAGIC) {
+            return std::unexpected(fmt::format("'{}' is missing or a tmpfs, the images need a real disk", dir));
+        }
+        std::string work_template{fmt::format(FMT_COMPILE("{}/gucc-bench.XXXXXX"), dir)};
+        if (::mkdtemp(work_template.data()) == nullptr) {
+            return std::unexpected(fmt::format("failed to create the work directory in '{}'", dir));
+        }
+        m_work_dir   = std::move(work_template);
+        m_mountpoint = fmt::format(FMT_COMPILE("{}/mnt"), m_work_dir);
+        m_image      = fmt::format(FMT_COMPILE("{}/disk.img"), m_work_dir);
+        if (!fs::create_directory(m_mountpoint, ec)) {
+            return std::unexpected(fmt::format("failed to create the mountpoint '{}'", m_mountpoint));
+        }
+
+        auto device = attach_image(m_image, image_size, "--partscan "sv);
+        if (!device) {
+            return std::unexpected(std::move(device.error()));
+        }
+        m_device = std::move(*device);
+        return {};
+    }
+
+    /// Another loop device of the same size, for multi-device layouts.
+    auto attach_member(std::uint64_t image_size) noexcept -> std::expected<std::string, std::string> {
+        auto& member = m_members.emplace_back(BenchMember{.image = fmt::format(FMT_COMPILE("{}/disk.{}.img"), m_work_dir, m_members.size() + 1)});
+        auto device  = attach_image(member.image, image_size, ""sv);
+        if (!device) {
+            return std::unexpected(std::move(device.error()));
+        }
+        member.device = *device;
+        return device;
+    }
+
+    void teardown() noexcept {
+        if (!m_mountpoint.empty()) {
+            gucc::utils::exec(fmt::format(FMT_COMPILE("umount -R '{}' 2>/dev/null"), m_mountpoint));
+        }
+        if (m_zpool_used) {
+            gucc::utils::exec(fmt::format(FMT_COMPILE("zpool export {} 2>/dev/null"), BENCH_ZPOOL_NAME));
+            m_zpool_used = false;
+        }
+        if (m_luks_used) {
+            gucc::utils::exec(fmt::format(FMT_COMPILE("cryptsetup close {} 2>/dev/null"), BENCH_LUKS_NAME));
+            m_luks_used = false;
+        }
+        // the array holds its members open
+        if (!m_md_array.empty()) {
+            gucc::utils::exec(fmt::format(FMT_COMPILE("mdadm --stop '{}' 2>/dev/null"), m_md_array));
+            m_md_array.clear();
+        }
+        // the cached LV holds its PVs open
+        if (m_vg_used) {
+            gucc::utils::exec(fmt::format(FMT_COMPILE("vgremove -ff -y {} 2>/dev/null"), BENCH_VG_NAME));
+            m_vg_used = false;
+        }
+        if (!m_device.empty()) {
+            gucc::utils::exec(fmt::format(FMT_COMPILE("losetup -d '{}'"), m_device));
+            m_device.clear();
+        }
+
+        std::error_code ec{};
+        for (const auto& member : m_members) {
+            if (!member.device.empty()) {
+                gucc::utils::exec(fmt::format(FMT_COMPILE("losetup -d '{}'"), member.device));
+            }
+            fs::remove(member.image, ec);
+        }
+        m_members.clear();
+        if (!m_image.empty()) {
+            fs::remove(m_image, ec);
+            m_image.clear();
+        }
+        if (!m_mountpoint.empty()) {
+            // only an empty directory, never what may still be mounted on it
+            fs::remove(m_mountpoint, ec);
+            m_mountpoint.clear();
+        }
+        if (!m_work_dir.empty()) {
+            fs::remove(m_work_dir, ec);
+            m_work_dir.clear();
+        }
+    }
+
+    void mark_luks_used() noexcept { m_luks_used = true; }
+    void mark_zpool_used() noexcept { m_zpool_used = true; }
+    void mark_md_array_used(std::string_view array_path) noexcept { m_md_array = array_path; }
+    void mark_vg_used() noexcept { m_vg_used = true; }
+
+    [[nodiscard]] auto device() const noexcept -> std::string_view { return m_device; }
+    [[nodiscard]] auto mountpoint() const noexcept -> std::string_view { return m_mountpoint; }
+
+ private:
+    struct BenchMember final {
+        std::string image{};
+        std::string device{};
+    };
+
+    static auto attach_image(std::string_view image, std::uint64_t image_size, std::string_view losetup_flags) noexcept -> std::expected<std::string, std::string> {
+        std::error_code ec{};
+        std::ofstream{std::string{image}};
+        fs::resize_file(image, image_size, ec);
+        if (ec) {
+            return std::unexpected(fmt::format("failed to create sparse image '{}': {}", image, ec.message()));
+        }
+
+        auto device = gucc::utils::exec(fmt::format(FMT_COMPILE("losetup --find --show {}'{}'"), losetup_flags, image));
+        if (!device.starts_with("/dev/loop"sv)) {
+            return std::unexpected(fmt::format("failed to attach '{}' as a loop device", image));
+        }
+        return device;
+    }
+
+    std::string m_work_dir{};
+    std::string m_image{};
+    std::string m_device{};
+    std::string m_mountpoint{};
+    std::vector<BenchMember> m_members{};
+    std::string m_md_array{};
+    bool m_luks_used{false};
+    bool m_zpool_used{false};
+    bool m_vg_used{false};
+};
+
+/// @brief Points the device and every partition of the config at @p device.
+void remap_config_device(cachyos::installer::InstallerConfig& cfg, std::string_view device) noexcept {
+    cfg.device = std::string{device};
+    for (auto& part : cfg.partitions) {
+        part.name = gucc::disk::insert_partition_number(device, gucc::disk::parse_partition_number(part.name));
+    }
+    // the bench never touches passphrases of the example
+    cfg.zfs_passphrase = std::nullopt;
+    // nor any disk besides its loop devices
+    cfg.raid      = std::nullopt;
+    cfg.lvm_cache = std::nullopt;
+}
+
+auto root_fs_of(const cachyos::installer::InstallerConfig& cfg) noexcept -> std::string {
+    const auto root_it = std::ranges::find(cfg.partitions, cachyos::installer::PartitionType::Root,
+        &cachyos::installer::PartitionConfig::type);
+    if (root_it != std::ranges::end(cfg.partitions)) {
+        return root_it->fs_name;
+    }
+    return cfg.fs_name.value_or(""s);
+}
+
+auto mkfs_command_for(const gucc::fs::Partition& part) noexcept -> std::string {
+    if (!part.mkfs_command.empty()) {
+        return part.mkfs_command;
+    }
+    return std::string{gucc::fs::get_mkfs_command(gucc::fs::string_to_filesystem_type(part.fstype))};
+}
+
+class StageTimer final {
+ public:
+    explicit StageTimer(std::vector<StageTiming>& timings) noexcept : m_timings(timings) { }
+
+    template <typename Func>
+    auto run(std::string_view name, Func&& func) noexcept -> std::expected<void, std::string> {
+        const auto start = std::chrono::steady_clock::now();
+        auto result      = std::forward<Func>(func)();
+        const auto end   = std::chrono::steady_clock::now();
+
+        const auto elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+        auto existing      = std::ranges::find(m_timings, name, &StageTiming::name);
+        if (existing != std::ranges::end(m_timings)) {
+            existing->ms += elapsed;
+        } else {
+            m_timings.emplace_back(StageTiming{.name = std::string{name}, .ms = elapsed});
+        }
+        if (!result) {
+            return std::unexpected(fmt::format("{}: {}", name, result.error()));
+        }
+        return {};
+    }
+
+ private:
+    std::vector<StageTiming>& m_timings;
+};
+
+// erase -> partition -> [lvm-cache] -> [raid] -> [luks -> crypt-write -> crypt-read] -> format -> [zfs] -> mount -> [subvolumes] -> fstab -> umount -> [assemble | lvm-activate]
+auto run_pipeline(const cachyos::installer::InstallerConfig& config, const BenchOptions& options,
+    std::vector<StageTiming>& timings) noexcept -> std::expected<void, std::string> {
+    namespace strategy = cachyos::installer::partition_strategy;
+
+    BenchDisk disk{};
+    if (auto res = disk.attach(options.image_size, options.image_dir); !res) {
+        return res;
+    }
+    const auto device     = std::string{disk.device()};
+    const auto mountpoint = std::string{disk.mountpoint()};
+
+    auto cfg = config;
+    remap_config_device(cfg, device);
+
+    // zfs has its own vdevs
+    if (options.raid && root_fs_of(cfg) != "zfs"sv) {
+        cachyos::installer::RaidSetupConfig raid_config{
+            .level = std::string{gucc::raid::raid_level_to_string(*options.raid)},
+            .name  = std::string{BENCH_MD_NAME},
+        };
+        for (std::size_t i = 1; i < gucc::raid::raid_min_devices(*options.raid); ++i) {
+            auto member = disk.attach_member(options.image_size);
+            if (!member) {
+                return std::unexpected(std::move(member.error()));
+            }
+            raid_config.devices.emplace_back(std::move(*member));
+        }
+        cfg.raid = std::move(raid_config);
+    }
+    if (options.lvm_cache && root_fs_of(cfg) != "zfs"sv) {
+        auto origin = disk.attach_member(options.image_size);
+        if (!origin) {
+            return std::unexpected(std::move(origin.error()));
+        }
+        cfg.lvm_cache = cachyos::installer::LvmCacheSetupConfig{
+            .mountpoint     = "/"s,
+            .origin_devices = {std::move(*origin)},
+            .mode           = std::string{gucc::lvm::lvm_cache_mode_to_string(*options.lvm_cache)},
+            .vg_name        = std::string{BENCH_VG_NAME},
+        };
+    }
+
+    auto plan = cachyos::installer::headless_strategy_from_config(cfg, true);
+    if (!plan) {
+        return std::unexpected(fmt::format("invalid layout: {}", fmt::join(plan.error(), "; ")));
+    }
+
+    std::vector<gucc::fs::Partition> partitions{};
+    std::vector<gucc::fs::BtrfsSubvolume> btrfs_subvolumes{};
+    std::optional<gucc::fs::ZfsSetupConfig> zfs_setup{};
+    std::optional<gucc::raid::RaidSetup> raid_setup{};
+    std::optional<gucc::lvm::LvmCacheConfig> lvm_cache{};
+    if (const auto* layout = std::get_if<strategy::CreateLayout>(&*plan)) {
+        partitions       = layout->partitions;
+        btrfs_subvolumes = layout->btrfs_subvolumes;
+        raid_setup       = layout->raid;
+        lvm_cache        = layout->lvm_cache;
+        if (layout->zfs_setup) {
+            zfs_setup = cachyos::installer::default_zfs_setup(BENCH_ZPOOL_NAME, std::nullopt);
+        }
+    } else {
+        partitions = gucc::disk::generate_default_partition_schema(device, "/boot"sv, true);
+        if (partitions.empty()) {
+            return std::unexpected("failed to generate the default layout"s);
+        }
+    }
+
+    StageTimer timer{timings};
+    auto res = timer.run("erase"sv, [&]() -> std::expected<void, std::string> {
+        if (auto erased = gucc::disk::erase_disk(device); !erased) {
+            return std::unexpected(gucc::to_string(erased.error()));
+        }
+        return {};
+    });
+    if (!res) {
+        return res;
+    }
+
+    // the erase stage already cleared the disk
+    res = timer.run("partition"sv, [&]() -> std::expected<void, std::string> {
+        if (auto created = gucc::disk::make_partition_table(device, partitions, true); !created) {
+            return std::unexpected(gucc::to_string(created.error()));
+        }
+        return {};
+    });
+    if (!res) {
+        return res;
+    }
+
+    auto root_it = std::ranges::find(partitions, "/"sv, &gucc::fs::Partition::mountpoint);
+    if (root_it == std::ranges::end(partitions)) {
+        return std::unexpected("layout has no root partition"s);
+    }
+
+    if (lvm_cache) {
+        res = timer.run("lvm-cache"sv, [&]() -> std::expected<void, std::string> {
+            gucc::utils::settle_devices();
+            disk.mark_vg_used();
+            auto lv_path = gucc::lvm::create_cached_lv(*lvm_cache);
+            if (!lv_path) {
+                return std::unexpected(gucc::to_string(lv_path.error()));
+            }
+            root_it->device = std::move(*lv_path);
+            return {};
+        });
+        if (!res) {
+            return res;
+        }
+    }
+
+    const bool is_md_raid = raid_setup && raid_setup->backend == gucc::raid::RaidBackend::Mdadm;
+    if (raid_setup) {
+        if (options.luks && !is_md_raid) {
+            return std::unexpected("btrfs raid over LUKS needs every member encrypted, use an md array"s);
+        }
+        res = timer.run("raid"sv, [&]() -> std::expected<void, std::string> {
+            if (!is_md_raid) {
+                root_it->mkfs_command = gucc::raid::btrfs_raid_mkfs_command(mkfs_command_for(*root_it), *raid_setup);
+                return {};
+            }
+            auto md_path = gucc::raid::create_md_array(*raid_setup);
+            if (!md_path) {
+                return std::unexpected(gucc::to_string(md_path.error()));
+            }
+            disk.mark_md_array_used(*md_path);
+            root_it->device = std::move(*md_path);
+            return {};
+        });
+        if (!res) {
+            return res;
+        }
+    }
+
+    const gucc::crypto::LuksPerfOptions luks_perf{
+        .sector_size        = options.luks_perf ? 4096U : 0U,
+        .no_read_workqueue  = options.luks_perf,
+        .no_write_workqueue = options.luks_perf,
+    };
+    // the LV or md array under the mapper, empty without LUKS
+    std::string luks_backing{};
+    if (options.luks && !zfs_setup) {
+        res = timer.run("luks"sv, [&]() -> std::expected<void, std::string> {
+            const auto& format_flags = options.luks_perf
+                ? fmt::format(FMT_COMPILE("{} {}"), BENCH_LUKS_FLAGS, gucc::crypto::luks2_format_perf_flags(luks_perf))
+                : std::string{BENCH_LUKS_FLAGS};
+            if (auto formatted = gucc::crypto::luks2_format(BENCH_LUKS_PASS, root_it->device, format_flags); !formatted) {
+                return std::unexpected(gucc::to_string(formatted.error()));
+            }
+            if (auto opened = gucc::crypto::luks2_open(BENCH_LUKS_PASS, root_it->device, BENCH_LUKS_NAME, gucc::crypto::luks2_open_perf_flags(luks_perf)); !opened) {
+                return std::unexpected(gucc::to_string(opened.error()));
+            }
+            disk.mark_luks_used();
+            luks_backing    = root_it->device;
+            root_it->device = fmt::format(FMT_COMPILE("/dev/mapper/{}"), BENCH_LUKS_NAME);
+            return {};
+        });
+        if (!res) {
+            return res;
+        }
+
+        // dm-crypt throughput, direct I/O so the page cache doesn't hide the cipher
+        res = timer.run("crypt-write"sv, [&]() -> std::expected<void, std::string> {
+            if (!gucc::utils::exec_checked(fmt::format(FMT_COMPILE("dd if=/dev/zero of='{}' bs=1M count={} oflag=direct conv=fsync status=none"), root_it->device, BENCH_CRYPT_IO_MIB))) {
+                return std::unexpected(fmt::format("failed to write {}", root_it->device));
+            }
+            return {};
+        });
+        if (!res) {
+            return res;
+        }
+        res = timer.run("crypt-read"sv, [&]() -> std::expected<void, std::string> {
+            if (!gucc::utils::exec_checked(fmt::format(FMT_COMPILE("dd if='{}' of=/dev/null bs=1M count={} iflag=direct status=none"), root_it->device, BENCH_CRYPT_IO_MIB))) {
+                return std::unexpected(fmt::format("failed to read {}", root_it->device));
+            }
+            return {};
+        });
+        if (!res) {
+            return res;
+        }
+    }
+
+    res = timer.run("format"sv, [&]() -> std::expected<void, std::string> {
+        for (const auto& part : partitions) {
+            const auto& mkfs_cmd = mkfs_command_for(part);
+            if (mkfs_cmd.empty()) {
+                continue;
+            }
+            if (!gucc::utils::exec_checked(fmt::format(FMT_COMPILE("{} '{}'"), mkfs_cmd, part.device))) {
+                return std::unexpected(fmt::format("failed to format {} with {}", part.device, mkfs_cmd));
+            }
+        }
+        gucc::utils::settle_devices();
+        return {};
+    });
+    if (!res) {
+        return res;
+    }
+
+    if (zfs_setup) {
+        res = timer.run("zfs"sv, [&]() -> std::expected<void, std::string> {
+            disk.mark_zpool_used();
+            return cachyos::installer::apply_zfs_root(*zfs_setup, root_it->device, mountpoint);
+        });
+        if (!res) {
+            return res;
+        }
+    }
+
+    // already formatted above, from here on only mount
+    std::vector<gucc::fs::Partition> mounted{};
+    const cachyos::installer::RootPartitionSelection root_selection{
+        .device           = root_it->device,
+        .fstype           = root_it->fstype,
+        .mkfs_command     = {},
+        .mount_opts       = root_it->mount_opts,
+        .format_requested = false,
+    };
+    // the pool is already mounted by the zfs stage
+    res = timer.run("mount"sv, [&]() -> std::expected<void, std::string> {
+        if (zfs_setup) {
+            return {};
+        }
+        auto root_res = cachyos::installer::apply_root_partition(root_selection, {}, mountpoint);
+        if (!root_res) {
+            return std::unexpected(root_res.error());
+        }
+        mounted = std::move(root_res->partitions);
+        return {};
+    });
+    if (!res) {
+        return res;
+    }
+
+    if (!btrfs_subvolumes.empty() && !zfs_setup) {
+        res = timer.run("subvolumes"sv, [&]() -> std::expected<void, std::string> {
+            if (!options.btrfs_exec) {
+                return cachyos::installer::apply_btrfs_subvolumes(btrfs_subvolumes, root_selection, mountpoint, mounted);
+            }
+            if (auto created = gucc::fs::detail::btrfs_create_subvols_exec(btrfs_subvolumes, root_selection.device, mountpoint, root_selection.mount_opts); !created) {
+                return std::unexpected(gucc::to_string(created.error()));
+            }
+            if (auto appended = gucc::fs::btrfs_append_subvolumes(mounted, btrfs_subvolumes); !appended) {
+                return std::unexpected(gucc::to_string(appended.error()));
+            }
+            return {};
+        });
+        if (!res) {
+            return res;
+        }
+    }
+
+    res = timer.run("mount"sv, [&]() -> std::expected<void, std::string> {
+        std::vector<cachyos::installer::AdditionalPartSelection> additional{};
+        for (const auto& part : partitions) {
+            if (part.mountpoint.empty() || part.mountpoint == "/"sv || part.fstype == "vfat"sv) {
+                continue;
+            }
+            additional.push_back({
+                .device           = part.device,
+                .mountpoint       = part.mountpoint,
+                .fstype           = part.fstype,
+                .mkfs_command     = {},
+                .mount_opts       = part.mount_opts,
+                .format_requested = false,
+            });
+        }
+        if (auto additional_res = cachyos::installer::apply_additional_partitions(additional, mountpoint, mounted); !additional_res) {
+            return std::unexpected(additional_res.error());
+        }
+
+        const auto esp_it = std::ranges::find(partitions, "vfat"sv, &gucc::fs::Partition::fstype);
+        if (esp_it != std::ranges::end(partitions)) {
+            auto esp_res = cachyos::installer::setup_esp_partition(esp_it->device, esp_it->mountpoint, mountpoint, false);
+            if (!esp_res) {
+                return std::unexpected(esp_res.error());
+            }
+            mounted.emplace_back(std::move(*esp_res));
+        }
+        return {};
+    });
+    if (!res) {
+        return res;
+    }
+
+    res = timer.run("fstab"sv, [&]() -> std::expected<void, std::string> {
+        std::error_code ec{};
+        fs::create_directories(fmt::format(FMT_COMPILE("{}/etc"), mountpoint), ec);
+        if (auto generated = gucc::fs::generate_fstab(mounted, mountpoint); !generated) {
+            return std::unexpected(gucc::to_string(generated.error()));
+        }
+        return {};
+    });
+    if (!res) {
+        return res;
+    }
+
+    const auto zpools = zfs_setup ? std::vector<std::string>{std::string{BENCH_ZPOOL_NAME}} : std::vector<std::string>{};
+    res               = timer.run("umount"sv, [&]() {
+        return cachyos::installer::umount_partitions(mountpoint, zpools, {});
+    });
+    if (!res) {
+        return res;
+    }
+
+    // the checks below run on the device under the mapper, then open it again like the encrypt hook does
+    const auto close_luks = [&]() -> std::expected<void, std::string> {
+        if (!luks_backing.empty() && !gucc::utils::exec_checked(fmt::format(FMT_COMPILE("cryptsetup close {}"), BENCH_LUKS_NAME))) {
+            return std::unexpected(fmt::format("failed to close '{}'", BENCH_LUKS_NAME));
+        }
+        return {};
+    };
+    const auto reopen_luks = [&](std::string_view backing) -> std::expected<void, std::string> {
+        if (luks_backing.empty()) {
+            return {};
+        }
+        if (auto opened = gucc::crypto::luks2_open(BENCH_LUKS_PASS, backing, BENCH_LUKS_NAME, gucc::crypto::luks2_open_perf_flags(luks_perf)); !opened) {
+            return std::unexpected(gucc::to_string(opened.error()));
+        }
+        return {};
+    };
+    const auto& backing_device = luks_backing.empty() ? root_it->device : luks_backing;
+
+    // what the lvm2 hook does on boot, the cache has to come back attached
+    if (lvm_cache) {
+        return timer.run("lvm-activate"sv, [&]() -> std::expected<void, std::string> {
+            if (auto closed = close_luks(); !closed) {
+                return closed;
+            }
+            if (!gucc::utils::exec_checked(fmt::format(FMT_COMPILE("vgchange -an {}"), BENCH_VG_NAME))
+                || !gucc::utils::exec_checked(fmt::format(FMT_COMPILE("vgchange -ay {}"), BENCH_VG_NAME))) {
+                return std::unexpected(fmt::format("failed to reactivate '{}'", BENCH_VG_NAME));
+            }
+            const auto& report = gucc::lvm::read_lvm_report();
+            if (!report) {
+                return std::unexpected(gucc::to_string(report.error()));
+            }
+            const auto lv_it = std::ranges::find(report->logical_volumes, backing_device, &gucc::lvm::LvmLogicalVolume::path);
+            if (lv_it == std::ranges::end(report->logical_volumes) || lv_it->segments.empty()
+                || !lv_it->segments.front().type.ends_with("cache"sv)) {
+                return std::unexpected(fmt::format("'{}' came back without its cache", backing_device));
+            }
+            if (auto opened = reopen_luks(backing_device); !opened) {
+                return opened;
+            }
+            if (!gucc::utils::exec_checked(fmt::format(FMT_COMPILE("mount '{}' '{}'"), root_it->device, mountpoint))) {
+                return std::unexpected(fmt::format("failed to mount the reactivated '{}'", root_it->device));
+            }
+            if (!gucc::utils::exec_checked(fmt::format(FMT_COMPILE("umount '{}'"), mountpoint))) {
+                return std::unexpected(fmt::format("failed to unmount the reactivated '{}'", root_it->device));
+            }
+            return {};
+        });
+    }
+    if (!is_md_raid) {
+        return res;
+    }
+
+    // what the initramfs does on boot, from the superblocks alone
+    return timer.run("assemble"sv, [&]() -> std::expected<void, std::string> {
+        if (auto closed = close_luks(); !closed) {
+            return closed;
+        }
+        if (auto stopped = gucc::raid::stop_md_array(backing_device); !stopped) {
+            return std::unexpected(gucc::to_string(stopped.error()));
+        }
+        auto md_path = gucc::raid::assemble_md_array(*raid_setup);
+        if (!md_path) {
+            return std::unexpected(gucc::to_string(md_path.error()));
+        }
+        disk.mark_md_array_used(*md_path);
+        if (auto opened = reopen_luks(*md_path); !opened) {
+            return opened;
+        }
+        const auto& assembled = luks_backing.empty() ? *md_path : root_it->device;
+        if (!gucc::utils::exec_checked(fmt::format(FMT_COMPILE("mount '{}' '{}'"), assembled, mountpoint))) {
+            return std::unexpected(fmt::format("failed to mount the assembled '{}'", assembled));
+        }
+        if (!gucc::utils::exec_checked(fmt::format(FMT_COMPILE("umount '{}'"), mountpoint))) {
+            return std::unexpected(fmt::format("failed to unmount the assembled '{}'", assembled));
+        }
+        return {};
+    });
+}
+
+auto median_of(std::vector<double> values) noexcept -> double {
+    if (values.empty()) {
+        return 0;
+    }
+    std::ranges::sort(values);
+    const auto middle = values.size() / 2;
+    return (values.size() % 2 != 0) ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
+
+auto make_report(const std::vector<LayoutResult>& results, const BenchOptions& options) noexcept -> std::string {
+    rapidjson::StringBuffer buffer{};
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> writer{buffer};
+
+    writer.StartObject();
+    writer.Key("kernel");
+    writer.String(kernel_release().c_str());
+    writer.Key("image_size");
+    writer.Uint64(options.image_size);
+    writer.Key("runs");
+    writer.Uint(options.runs);
+    writer.Key("luks");
+    writer.Bool(options.luks);
+    writer.Key("luks_perf");
+    writer.Bool(options.luks_perf);
+    writer.Key("crypt_io_bytes");
+    writer.Uint64(options.luks ? BENCH_CRYPT_IO_MIB * 1024 * 1024 : 0);
+    writer.Key("btrfs_subvolumes");
+    writer.String(options.btrfs_exec ? "exec" : "ioctl");
+    writer.Key("raid");
+    writer.String(options.raid ? gucc::raid::raid_level_to_string(*options.raid).data() : "none");
+    writer.Key("lvm_cache");
+    writer.String(options.lvm_cache ? gucc::lvm::lvm_cache_mode_to_string(*options.lvm_cache).data() : "none");
+
+    writer.Key("layouts");
+    writer.StartArray();
+    for (const auto& result : results) {
+        writer.StartObject();
+        writer.Key("config");
+        writer.String(result.config.c_str());
+        writer.Key("root_fs");
+        writer.String(result.root_fs.c_str());
+        writer.Key("ok");
+        writer.Bool(!result.error);
+        if (result.error) {
+            writer.Key("error");
+            writer.String(result.error->c_str());
+        }
+
+        // stage order follows the first run
+        writer.Key("stages");
+        writer.StartArray();
+        double total_ms{};
+        if (!result.runs.empty()) {
+            for (const auto& stage : result.runs.front()) {
+                std::vector<double> samples{};
+                for (const auto& run : result.runs) {
+                    const auto sample = std::ranges::find(run, stage.name, &StageTiming::name);
+                    if (sample != std::ranges::end(run)) {
+                        samples.push_back(sample->ms);
+                    }
+                }
+                const auto median = median_of(samples);
+                total_ms += median;
+
+                writer.StartObject();
+                writer.Key("name");
+                writer.String(stage.name.c_str());
+                writer.Key("median_ms");
+                writer.Double(median);
+                writer.Key("samples_ms");
+                writer.StartArray();
+                for (const auto sample : samples) {
+                    writer.Double(sample);
+                }
+                writer.EndArray();
+                writer.EndObject();
+            }
+        }
+        writer.EndArray();
+        writer.Key("total_ms");
+        writer.Double(total_ms);
+        writer.EndObject();
+    }
+    writer.EndArray();
+    writer.EndObject();
+
+    return std::string{buffer.GetString(), buffer.GetSize()};
+}
+
+auto default_configs() noexcept -> std::vector<std::string> {
+    std::vector<std::string> configs{};
+    std::error_code ec{};
+    for (const auto& entry : fs::directory_iterator{"examples", ec}) {
+        if (entry.path().extension() == ".json") {
+            configs.emplace_back(entry.path().string());
+        }
+    }
+    std::ranges::sort(configs);
+    return configs;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    BenchOptions options{};
+
+    // Parse arguments
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        const auto next_value = [&]() -> std::optional<std::string_view> {
+            if (i + 1 >= argc) {
+                return std::nullopt;
+            }
+            return std::string_view{argv[++i]};
+        };
+
+        if (arg == "-h"sv || arg == "--help"sv) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (arg == "-l"sv || arg == "--luks"sv) {
+            options.luks = true;
+        } else if (arg == "--luks-perf"sv) {
+            options.luks      = true;
+            options.luks_perf = true;
+        } else if (arg == "--btrfs-exec"sv) {
+            options.btrfs_exec = true;
+        } else if (arg == "--raid"sv) {
+            options.raid = next_value().and_then(gucc::raid::string_to_raid_level);
+            if (!options.raid) {
+                fmt::println(stderr, "--raid expects raid0, raid1 or raid10");
+                return 1;
+            }
+        } else if (arg == "--lvm-cache"sv) {
+            options.lvm_cache = next_value().and_then(gucc::lvm::string_to_lvm_cache_mode);
+            if (!options.lvm_cache) {
+                fmt::println(stderr, "--lvm-cache expects writethrough, writeback or writecache");
+                return 1;
+            }
+        } else if (arg == "-d"sv || arg == "--image-dir"sv) {
+            const auto value = next_value();
+            if (!value) {
+                fmt::println(stderr, "--image-dir expects a directory");
+                return 1;
+            }
+            options.image_dir = std::string{*value};
+        } else if (arg == "-s"sv || arg == "--size"sv) {
+            const auto value = next_value().and_then(parse_uint_arg);
+            if (!value) {
+                fmt::println(stderr, "--size expects a positive number of GiB");
+                return 1;
+            }
+            options.image_size = *value * GiB;
+        } else if (arg == "-r"sv || arg == "--runs"sv) {
+            const auto value = next_value().and_then(parse_uint_arg);
+            if (!value) {
+                fmt::println(stderr, "--runs expects a positive number");
+                return 1;
+            }
+            options.runs = static_cast<std::uint32_t>(*value);
+        } else if (arg == "-o"sv || arg == "--output"sv) {
+            const auto value = next_value();
+            if (!value) {
+                fmt::println(stderr, "--output expects a file name");
+                return 1;
+            }
+            options.output = std::string{*value};
+        } else if (arg.starts_with('-')) {
+            fmt::println(stderr, "Unknown option: {}", arg);
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            options.configs.emplace_back(arg);
+        }
+    }
+
+    if (options.raid && options.lvm_cache) {
+        fmt::println(stderr, "--raid and --lvm-cache both take over the root, pick one");
+        return 1;
+    }
+    if (::geteuid() != 0) {
+        fmt::println(stderr, "{} needs root to attach loop devices", argv[0]);
+        return 1;
+    }
+    if (options.configs.empty()) {
+        options.configs = default_configs();
+    }
+    if (options.configs.empty()) {
+        fmt::println(stderr, "No configs given and no examples/*.json found");
+        return 1;
+    }
+
+    // Initialize logger. stdout carries the report
+    auto logger = spdlog::stderr_color_mt("cachyos_logger");
+    spdlog::set_default_logger(logger);
+    spdlog::set_pattern("[%r][%^---%L---%$] %v");
+    spdlog::set_level(spdlog::level::warn);
+    gucc::logger::set_logger(logger);
+
+    std::vector<LayoutResult> results{};
+    for (const auto& config_path : options.configs) {
+        LayoutResult result{.config = config_path};
+
+        const auto& content = gucc::file_utils::read_whole_file(config_path);
+        auto config         = cachyos::installer::parse_installer_config(content);
+        if (!config) {
+            result.error = fmt::format("failed to parse '{}': {}", config_path, config.error());
+            results.emplace_back(std::move(result));
+            continue;
+        }
+        result.root_fs = root_fs_of(*config);
+
+        for (std::uint32_t run = 0; run < options.runs; ++run) {
+            spdlog::info("[{}] run {}/{}", config_path, run + 1, options.runs);
+            auto& timings = result.runs.emplace_back();
+            if (auto res = run_pipeline(*config, options, timings); !res) {
+                result.error = std::move(res.error());
+                break;
+            }
+        }
+        results.emplace_back(std::move(result));
+    }
+
+    const auto& report = make_report(results, options);
+    if (options.output.empty()) {
+        fmt::println("{}", report);
+    } else if (!gucc::file_utils::create_file_for_overwrite(options.output, report)) {
+        fmt::println(stderr, "Failed to write report to '{}'", options.output);
+        return 1;
+    }
+
+    const bool all_ok = std::ranges::all_of(results, [](const LayoutResult& result) { return !result.error; });
+    return all_ok ? 0 : 2;
+}
@@ -3,7 +3,11 @@
 #include "utils.hpp"
 #include "widgets.hpp"
 
+// import installer-lib
+#include "cachyos/partition_planner.hpp"
+
 // import gucc
+#include "gucc/fs_tuning.hpp"
 #include "gucc/io_utils.hpp"
 #include "gucc/luks.hpp"
 #include "gucc/string_utils.hpp"
@@ -24,9 +28,10 @@ using namespace ftxui;
 
 namespace tui {
 
-static constexpr auto luks_menu_body  = "Devices and volumes encrypted using dm_crypt cannot be accessed or\neven seen without being unlocked via a key or password.";
-static constexpr auto luks_menu_body2 = "A seperate boot partition without encryption or logical volume management\n(LVM - unless using BIOS Grub) is required.";
-static constexpr auto luks_menu_body3 = "The Automatic option uses default encryption settings,\nand is recommended for beginners.\nOtherwise, it is possible to specify cypher and key size parameters manually.";
+static constexpr auto luks_menu_body      = "Devices and volumes encrypted using dm_crypt cannot be accessed or\neven seen without being unlocked via a key or password.";
+static constexpr auto luks_menu_body2     = "A seperate boot partition without encryption or logical volume management\n(LVM - unless using BIOS Grub) is required.";
+static constexpr auto luks_menu_body3     = "The Automatic option uses default encryption settings,\nand is recommended for beginners.\nOtherwise, it is possible to specify cypher and key size parameters manually.";
+static constexpr auto luks_bypass_wq_body = "\nBypass the dm-crypt read and write workqueues?\n \nThis lowers the latency on NVMe drives,\nbut can cost throughput under heavy parallel load.\n";
 
 bool select_crypt_partition(const std::string_view& text) noexcept {
     auto* config_instance  = Config::instance();
@@ -149,6 +154,12 @@ bool luks_setup() noexcept {
     if (!tui::get_crypt_password(luks_password)) { return false; }
     /* clang-format on */
 
+    // only NVMe drives take the workqueue bypass, nothing to ask otherwise
+    const auto& partition         = std::get<std::string>(config_data["PARTITION"]);
+    const auto& profile           = gucc::fs::query_device_profile(partition);
+    const bool is_nvme            = profile && gucc::fs::classify_device(*profile) == gucc::fs::DeviceClass::Nvme;
+    config_data["LUKS_BYPASS_WQ"] = (is_nvme && detail::yesno_widget(luks_bypass_wq_body, size(HEIGHT, LESS_THAN, 10) | size(WIDTH, LESS_THAN, 75))) ? 1 : 0;
+
     return true;
 }
 
@@ -162,17 +173,27 @@ void luks_encrypt([[maybe_unused]] const std::string_view& command) noexcept {
     const auto& partition      = std::get<std::string>(config_data["PARTITION"]);
     const auto& luks_root_name = std::get<std::string>(config_data["LUKS_ROOT_NAME"]);
     const auto& luks_password  = std::get<std::string>(config_data["PASSWD"]);
-
-    if (!gucc::crypto::luks1_format(luks_password, partition, command)) {
-        spdlog::error("Failed to format luks1 partition {} with additional flags {}", partition, command);
-        detail::msgbox_widget("\nFailed to format luks1 partition\n");
+    const auto& bypass_wq      = std::get<std::int32_t>(config_data["LUKS_BYPASS_WQ"]);
+
+    // LUKS1, the open path above and GRUB's cryptodisk expect it
+    const cachyos::installer::LuksFormatRequest request{
+        .device            = partition,
+        .mapper_name       = luks_root_name,
+        .passphrase        = luks_password,
+        .extra_flags       = std::string{command},
+        .version           = cachyos::installer::LuksVersion::Luks1,
+        .bypass_workqueues = bypass_wq == 1,
+    };
+    auto part_struct = gucc::fs::Partition{.device = partition};
+    if (auto res = cachyos::installer::encrypt_partition(request, part_struct); !res) {
+        spdlog::error("Failed to encrypt partition {}: {}", partition, res.error());
+        detail::msgbox_widget("\nFailed to encrypt the luks1 partition\n");
+        return;
     }
 
-    // Now open the encrypted partition or LV
-    if (!gucc::crypto::luks1_open(luks_password, partition, luks_root_name)) {
-        spdlog::error("Failed to open luks1 partition {} with name {}", partition, luks_root_name);
-        detail::msgbox_widget("\nFailed to open luks1 partition\n");
-    }
+    auto& luks_partitions = std::get<std::vector<gucc::fs::Partition>>(config_data["LUKS_PARTITIONS"]);
+    std::erase_if(luks_partitions, [&](auto&& part) { return part.luks_mapper_name == part_struct.luks_mapper_name; });
+    luks_partitions.emplace_back(std::move(part_struct));
 #endif
 }
 
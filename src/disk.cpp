@@ -223,9 +223,14 @@ auto mount_existing_subvols(std::vector<gucc::fs::Partition>& partitions) noexce
     return true;
 }
 
-auto lvm_show_vg() noexcept -> std::vector<std::pair<std::string, std::string>> {
+auto lvm_show_vg() noexcept -> std::vector<gucc::lvm::LvmVolumeGroup> {
 #ifdef NDEVENV
-    return gucc::lvm::show_volume_groups();
+    auto report = gucc::lvm::read_lvm_report();
+    if (!report) {
+        spdlog::error("Failed to query volume groups: {}", report.error().context);
+        return {};
+    }
+    return std::move(report->volume_groups);
 #else
     spdlog::info("[DRY-RUN] Would query volume groups");
     return {};
@@ -3,6 +3,7 @@
 
 #include "gucc/bootloader.hpp"
 #include "gucc/btrfs.hpp"
+#include "gucc/lvm.hpp"
 #include "gucc/partition.hpp"
 
 #include <cinttypes>  // for uint8_t
@@ -98,7 +99,7 @@ auto make_esp_headless(std::vector<gucc::fs::Partition>& partitions, std::string
 auto build_partition_with_luks(std::string_view device, std::string_view mountpoint,
     std::string_view fstype, std::string_view mount_opts) noexcept -> gucc::fs::Partition;
 
-auto lvm_show_vg() noexcept -> std::vector<std::pair<std::string, std::string>>;
+auto lvm_show_vg() noexcept -> std::vector<gucc::lvm::LvmVolumeGroup>;
 
 [[nodiscard]] bool zfs_auto_pres(const std::string_view& partition, const std::string_view& zfs_zpool_name) noexcept;
 [[nodiscard]] bool zfs_create_zpool(const std::string_view& partition, const std::string_view& pool_name) noexcept;
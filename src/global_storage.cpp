@@ -45,6 +45,8 @@ bool Config::initialize() noexcept {
         s_config->m_data["LUKS_OPT"]            = "";  // Default or user-defined?
         s_config->m_data["LUKS_UUID"]           = "";
         s_config->m_data["LUKS_ROOT_NAME"]      = "";
+        s_config->m_data["LUKS_PARTITIONS"]     = std::vector<gucc::fs::Partition>{};  // formatted by luks_encrypt
+        s_config->m_data["LUKS_BYPASS_WQ"]      = 0;  // dm-crypt workqueue bypass on NVMe
         s_config->m_data["LVM"]                 = 0;
         s_config->m_data["LVM_LV_NAME"]         = "";  // Name of LV to create or use
         s_config->m_data["LVM_SEP_BOOT"]        = 0;
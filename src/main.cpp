@@ -6,6 +6,7 @@
 // import cachyos
 #include "cachyos/installer_config.hpp"
 #include "cachyos/logging.hpp"
+#include "cachyos/offline_bundle.hpp"
 #include "cachyos/orchestrator.hpp"
 #include "cachyos/session.hpp"
 #include "cachyos/system.hpp"
@@ -29,17 +30,21 @@ using namespace std::string_view_literals;
 
 // TODO(vnepogodin): refactor using argparse
 constexpr std::string_view kUsageMsg = R"(
-Usage: cachyos-installer [--config <path>] [--dry-run] [--version]\n\n"
-  --config <path>  Read installer config from <path> (default: ./settings.json).
-                   A config with \"headless_mode\": true installs unattended;
-                   otherwise the interactive TUI starts.
-  --version        Print version and exit.
-  --help           Show this help and exit.\n
-Must be run as root with an active network connection.
+Usage: cachyos-installer [--config <path>] [--build-bundle <path>] [--dry-run] [--version]\n\n"
+  --config <path>        Read installer config from <path> (default: ./settings.json).
+                         A config with \"headless_mode\": true installs unattended;
+                         otherwise the interactive TUI starts.
+  --build-bundle <path>  Download everything the headless config at <path> installs
+                         into its \"offline_bundle\" directory and exit.
+  --version              Print version and exit.
+  --help                 Show this help and exit.\n
+Must be run as root with an active network connection, unless installing
+from an offline bundle.
 )";
 
 int main(int argc, char** argv) {
     std::string config_path{"settings.json"};
+    bool build_bundle{false};
     for (int i = 1; i < argc; ++i) {
         const std::string_view arg{argv[i]};
         if (arg == "--help"sv || arg == "-h"sv) {
@@ -58,6 +63,16 @@ int main(int argc, char** argv) {
             config_path = argv[++i];
         } else if (arg.starts_with("--config=")) {
             config_path = arg.substr(std::string_view{"--config="}.size());
+        } else if (arg == "--build-bundle"sv) {
+            if (i + 1 >= argc) {
+                fmt::print(stderr, "--build-bundle requires a path argument\n");
+                return 1;
+            }
+            config_path  = argv[++i];
+            build_bundle = true;
+        } else if (arg.starts_with("--build-bundle=")) {
+            config_path  = arg.substr(std::string_view{"--build-bundle="}.size());
+            build_bundle = true;
         } else {
             fmt::print(stderr, "unknown argument '{}' (try --help)\n", arg);
             return 1;
@@ -101,8 +116,11 @@ int main(int argc, char** argv) {
             if (parsed && parsed->headless_mode) {
                 cachyos::installer::logging::attach_stdout_sink();
 
+                // the bundle carries the repos, there is nothing to sync
+                const bool offline = parsed->offline_bundle.has_value() && !build_bundle;
+
                 using namespace std::chrono_literals;
-                if (!cachyos::installer::wait_for_connection(15s)) {
+                if (!offline && !cachyos::installer::wait_for_connection(15s)) {
                     error_inter("An active network connection is required for headless install\n");
                     spdlog::shutdown();
                     return 1;
@@ -112,8 +130,10 @@ int main(int argc, char** argv) {
                 const auto& isa_levels = gucc::cpu::get_isa_levels();
                 spdlog::info("isa_levels:={}", isa_levels);
 
-                if (const auto repo = cachyos::installer::install_cachyos_repo(); !repo) {
-                    spdlog::warn("install_cachyos_repo: {}", repo.error());
+                if (!offline) {
+                    if (const auto repo = cachyos::installer::install_cachyos_repo(); !repo) {
+                        spdlog::warn("install_cachyos_repo: {}", repo.error());
+                    }
                 }
 
                 if (const auto v = cachyos::installer::validate_headless_config(*parsed); !v) {
@@ -121,6 +141,14 @@ int main(int argc, char** argv) {
                     spdlog::shutdown();
                     return -1;
                 }
+                if (build_bundle) {
+                    const auto built = cachyos::installer::build_offline_bundle(*parsed);
+                    if (!built) {
+                        error_inter("Building the offline bundle failed: {}\n", built.error());
+                    }
+                    spdlog::shutdown();
+                    return built ? 0 : 1;
+                }
                 auto inputs = cachyos::installer::installer_config_to_inputs(*parsed);
                 if (!inputs) {
                     error_inter("Headless config conversion failed: {}\n", inputs.error());
@@ -155,6 +183,12 @@ int main(int argc, char** argv) {
         }
     }
 
+    if (build_bundle) {
+        error_inter("--build-bundle requires a config with \"headless_mode\": true\n");
+        spdlog::shutdown();
+        return 1;
+    }
+
     if (!utils::handle_connection()) {
         error_inter("An active network connection could not be detected, please connect and restart the installer.\n");
         return 0;
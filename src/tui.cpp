@@ -1198,15 +1198,15 @@ void lvm_del_vg() noexcept {
     // Build display strings: "name (size)"
     std::vector<std::string> display_list{};
     display_list.reserve(vg_list.size());
-    for (const auto& [name, size] : vg_list) {
-        display_list.push_back(fmt::format(FMT_COMPILE("{} ({})"), name, size));
+    for (const auto& vg : vg_list) {
+        display_list.push_back(fmt::format(FMT_COMPILE("{} ({})"), vg.name, gucc::disk::format_size(vg.size)));
     }
 
     auto screen = ScreenInteractive::Fullscreen();
     std::int32_t selected{};
     std::string sel_vg{};
     auto ok_callback = [&] {
-        sel_vg = vg_list[static_cast<size_t>(selected)].first;
+        sel_vg = vg_list[static_cast<size_t>(selected)].name;
         screen.ExitLoopClosure()();
     };
     /* clang-format off */
@@ -28,6 +28,7 @@
 #include <cstdint>  // for int32_t
 #include <cstdlib>  // for exit
 
+#include <algorithm>      // for ranges::find
 #include <chrono>         // for seconds
 #include <iostream>       // for basic_istream, cin
 #include <string>         // for operator==, string, basic_string, allocator
@@ -109,6 +110,14 @@ auto build_install_context() noexcept -> cachyos::installer::InstallContext {
     ctx.hostcache   = std::get<std::int32_t>(config_data["hostcache"]) != 0;
 
     ctx.partition_schema = std::get<std::vector<gucc::fs::Partition>>(config_data["PARTITION_SCHEMA"]);
+    // dm-crypt flags of the volumes luks_encrypt formatted, for their crypttab entries
+    const auto& luks_partitions = std::get<std::vector<gucc::fs::Partition>>(config_data["LUKS_PARTITIONS"]);
+    for (auto& part : ctx.partition_schema) {
+        const auto& encrypted = std::ranges::find(luks_partitions, part.luks_mapper_name, &gucc::fs::Partition::luks_mapper_name);
+        if (part.luks_mapper_name && encrypted != luks_partitions.end()) {
+            part.luks_crypttab_opts = encrypted->luks_crypttab_opts;
+        }
+    }
     ctx.swap_device      = std::get<std::string>(config_data["SWAP_DEVICE"]);
     ctx.uefi_mount       = std::get<std::string>(config_data["UEFI_MOUNT"]);
     ctx.zfs_zpool_names  = std::get<std::vector<std::string>>(config_data["ZFS_ZPOOL_NAMES"]);